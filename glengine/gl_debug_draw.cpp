@@ -0,0 +1,213 @@
+#include "gl_debug_draw.h"
+
+#include "gl_camera.h"
+#include "gl_engine.h"
+#include "gl_logger.h"
+#include "gl_utils.h"
+#include "generated/shaders/debug_draw.glsl.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr int circle_segments = 32;
+
+/// any unit vector orthogonal to v
+math::Vector3f orthogonal(const math::Vector3f &v) {
+    const math::Vector3f axis = std::abs(v.x) < 0.9f ? math::Vector3f{1, 0, 0} : math::Vector3f{0, 1, 0};
+    return math::normalized(v.cross(axis));
+}
+
+} // namespace
+
+namespace glengine {
+
+bool DebugDraw::init(GLEngine &eng) {
+    ResourceManager &rm = eng.resource_manager();
+    sg_shader shader = rm.get_or_create_shader(*debug_draw_shader_desc(sg_query_backend()));
+
+    sg_pipeline_desc pip_desc = {0};
+    pip_desc.layout.buffers[0].stride = sizeof(DebugVertex);
+    pip_desc.layout.attrs[ATTR_vs_debug_draw_vertex_pos].format = SG_VERTEXFORMAT_FLOAT3;
+    pip_desc.layout.attrs[ATTR_vs_debug_draw_vertex_color].format = SG_VERTEXFORMAT_UBYTE4N;
+    pip_desc.shader = shader;
+    pip_desc.primitive_type = SG_PRIMITIVETYPE_LINES;
+    // debug lines don't write the depth, not to hide each other or to show in the ssao
+    pip_desc.depth = {.pixel_format = SG_PIXELFORMAT_DEPTH_STENCIL, .compare = SG_COMPAREFUNC_LESS_EQUAL};
+    pip_desc.color_count = eng._config.use_mrt ? 3 : 1;
+    pip_desc.sample_count = sg_query_features().msaa_render_targets ? eng._config.msaa_samples : 1;
+    pip_desc.label = "debug draw pipeline";
+    _pip = rm.get_or_create_pipeline(pip_desc);
+    pip_desc.depth.compare = SG_COMPAREFUNC_ALWAYS;
+    pip_desc.label = "debug draw overlay pipeline";
+    _overlay_pip = rm.get_or_create_pipeline(pip_desc);
+    return _pip.id != SG_INVALID_ID && _overlay_pip.id != SG_INVALID_ID;
+}
+
+void DebugDraw::terminate() {
+    sg_destroy_buffer(_buffer);
+    _buffer = {SG_INVALID_ID};
+    _lines.clear();
+    _overlay_lines.clear();
+    _stats = DebugDrawStats();
+}
+
+void DebugDraw::line(const math::Vector3f &a, const math::Vector3f &b, Color color, bool depth_test) {
+    auto &l = lines(depth_test);
+    l.push_back({a, color});
+    l.push_back({b, color});
+}
+
+void DebugDraw::aabb(const AABB &box, Color color, bool depth_test) {
+    this->box(math::create_translation(box.center), box.size, color, depth_test);
+}
+
+void DebugDraw::box(const math::Matrix4f &tf, const math::Vector3f &size, Color color, bool depth_test) {
+    math::Vector3f corners[8];
+    for (int i = 0; i < 8; i++) {
+        corners[i] = tf * math::Vector3f{(i & 1 ? 0.5f : -0.5f) * size.x, (i & 2 ? 0.5f : -0.5f) * size.y,
+                                         (i & 4 ? 0.5f : -0.5f) * size.z};
+    }
+    // the corners of an edge differ by one bit
+    for (int i = 0; i < 8; i++) {
+        for (int bit = 1; bit < 8; bit <<= 1) {
+            if (!(i & bit)) {
+                line(corners[i], corners[i | bit], color, depth_test);
+            }
+        }
+    }
+}
+
+void DebugDraw::circle(const math::Vector3f &center, const math::Vector3f &normal, float radius, Color color,
+                       bool depth_test) {
+    const math::Vector3f u = orthogonal(normal) * radius;
+    const math::Vector3f v = math::normalized(normal).cross(u);
+    auto &l = lines(depth_test);
+    math::Vector3f prev = center + u;
+    for (int i = 1; i <= circle_segments; i++) {
+        const float a = 2.0f * float(M_PI) * i / circle_segments;
+        const math::Vector3f p = center + u * std::cos(a) + v * std::sin(a);
+        l.push_back({prev, color});
+        l.push_back({p, color});
+        prev = p;
+    }
+}
+
+void DebugDraw::sphere(const math::Vector3f &center, float radius, Color color, bool depth_test) {
+    circle(center, {1, 0, 0}, radius, color, depth_test);
+    circle(center, {0, 1, 0}, radius, color, depth_test);
+    circle(center, {0, 0, 1}, radius, color, depth_test);
+}
+
+void DebugDraw::axes(const math::Matrix4f &tf, float size, bool depth_test) {
+    const math::Vector3f origin = tf * math::Vector3f{0, 0, 0};
+    line(origin, tf * math::Vector3f{size, 0, 0}, {255, 0, 0, 255}, depth_test);
+    line(origin, tf * math::Vector3f{0, size, 0}, {0, 255, 0, 255}, depth_test);
+    line(origin, tf * math::Vector3f{0, 0, size}, {0, 0, 255, 255}, depth_test);
+}
+
+void DebugDraw::frustum(const math::Matrix4f &view_projection, Color color, bool depth_test) {
+    // corners of the clip space cube back to world space, same bit layout as box()
+    const math::Matrix4f inv = math::inverse(view_projection);
+    math::Vector3f corners[8];
+    for (int i = 0; i < 8; i++) {
+        const math::Vector4f p = inv * math::Vector4f{i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f,
+                                                      1.0f};
+        corners[i] = math::Vector3f{p.x, p.y, p.z} * (1.0f / p.w);
+    }
+    for (int i = 0; i < 8; i++) {
+        for (int bit = 1; bit < 8; bit <<= 1) {
+            if (!(i & bit)) {
+                line(corners[i], corners[i | bit], color, depth_test);
+            }
+        }
+    }
+}
+
+void DebugDraw::frustum(const Camera &cam, Color color, bool depth_test) {
+    frustum(cam.projection() * cam.inverse_transform(), color, depth_test);
+}
+
+void DebugDraw::arrow(const math::Vector3f &from, const math::Vector3f &to, Color color, bool depth_test) {
+    line(from, to, color, depth_test);
+    const math::Vector3f dir = to - from;
+    const float len = math::length(dir);
+    if (len <= 0.0f) {
+        return;
+    }
+    // four lines for the head, a fifth of the arrow long
+    const math::Vector3f back = dir * (-0.2f);
+    const math::Vector3f u = orthogonal(dir) * (0.06f * len);
+    const math::Vector3f v = (dir * (1.0f / len)).cross(u);
+    line(to, to + back + u, color, depth_test);
+    line(to, to + back - u, color, depth_test);
+    line(to, to + back + v, color, depth_test);
+    line(to, to + back - v, color, depth_test);
+}
+
+void DebugDraw::upload() {
+    _num_uploaded = 0;
+    _num_overlay_uploaded = 0;
+    if (!enabled) {
+        _lines.clear();
+        _overlay_lines.clear();
+        return;
+    }
+    const size_t needed = _lines.size() + _overlay_lines.size();
+    if (needed == 0) {
+        return;
+    }
+    // the buffer only grows, to the next power of two
+    if (needed > _stats.capacity) {
+        uint32_t capacity = std::max<uint32_t>(_stats.capacity, 4096);
+        while (capacity < needed) {
+            capacity *= 2;
+        }
+        sg_destroy_buffer(_buffer);
+        _buffer = sg_make_buffer((sg_buffer_desc){.size = capacity * sizeof(DebugVertex),
+                                                  .type = SG_BUFFERTYPE_VERTEXBUFFER,
+                                                  .usage = SG_USAGE_STREAM,
+                                                  .label = "debug-draw-vertices"});
+        _stats.capacity = capacity;
+        log_debug("debug draw: %u vertices buffer", capacity);
+    }
+    // both sets of lines are appended to the buffer, and drawn from their offsets
+    if (!_lines.empty()) {
+        _offset = sg_append_buffer(_buffer, {_lines.data(), _lines.size() * sizeof(DebugVertex)});
+        _num_uploaded = uint32_t(_lines.size());
+    }
+    if (!_overlay_lines.empty()) {
+        _overlay_offset =
+            sg_append_buffer(_buffer, {_overlay_lines.data(), _overlay_lines.size() * sizeof(DebugVertex)});
+        _num_overlay_uploaded = uint32_t(_overlay_lines.size());
+    }
+    _lines.clear();
+    _overlay_lines.clear();
+}
+
+void DebugDraw::draw(const Camera &cam) {
+    _stats.num_vertices = _num_uploaded + _num_overlay_uploaded;
+    _stats.num_draws = 0;
+    const math::Matrix4f view_projection = cam.projection() * cam.inverse_transform();
+    debug_draw_params_t params = {.view_projection = view_projection};
+    auto draw_lines = [&](sg_pipeline pip, int offset, uint32_t num) {
+        if (num == 0) {
+            return;
+        }
+        sg_apply_pipeline(pip);
+        sg_bindings bind = {0};
+        bind.vertex_buffers[0] = _buffer;
+        bind.vertex_buffer_offsets[0] = offset;
+        sg_apply_bindings(bind);
+        sg_apply_uniforms(SG_SHADERSTAGE_VS, SLOT_debug_draw_params, SG_RANGE(params));
+        sg_draw(0, num, 1);
+        _stats.num_draws++;
+    };
+    draw_lines(_pip, _offset, _num_uploaded);
+    draw_lines(_overlay_pip, _overlay_offset, _num_overlay_uploaded);
+    _num_uploaded = 0;
+    _num_overlay_uploaded = 0;
+}
+
+} // namespace glengine
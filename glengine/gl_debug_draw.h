@@ -0,0 +1,78 @@
+#pragma once
+
+#include "gl_types.h"
+#include "math/vmath.h"
+
+#include "sokol_gfx.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace glengine {
+
+struct AABB;
+class Camera;
+class GLEngine;
+
+struct DebugDrawStats {
+    uint32_t num_vertices = 0; ///< drawn by the last frame
+    uint32_t num_draws = 0;    ///< draw calls of the last frame
+    uint32_t capacity = 0;     ///< vertices of the buffer
+};
+
+/// immediate mode debug drawing (see GLEngine::debug_draw): the primitives added during a frame are drawn by the next
+/// GLEngine::render(), at the end of the offscreen pass, and then discarded. Everything is made of lines, collected in
+/// a single streaming buffer with a draw call for the depth tested lines and one for the overlay ones, whatever the
+/// number of primitives. Debug primitives are not selectable
+class DebugDraw {
+  public:
+    bool init(GLEngine &eng);
+    void terminate();
+
+    // primitives, in world space. With depth_test false they are drawn on top of the scene
+    void line(const math::Vector3f &a, const math::Vector3f &b, Color color, bool depth_test = true);
+    void aabb(const AABB &box, Color color, bool depth_test = true);
+    /// box of the given size, centered in the origin of tf
+    void box(const math::Matrix4f &tf, const math::Vector3f &size, Color color, bool depth_test = true);
+    void circle(const math::Vector3f &center, const math::Vector3f &normal, float radius, Color color,
+                bool depth_test = true);
+    /// three great circles
+    void sphere(const math::Vector3f &center, float radius, Color color, bool depth_test = true);
+    /// x, y and z axes of tf, in red, green and blue
+    void axes(const math::Matrix4f &tf, float size = 1.0f, bool depth_test = true);
+    /// frustum of a view projection matrix (projection * view)
+    void frustum(const math::Matrix4f &view_projection, Color color, bool depth_test = true);
+    void frustum(const Camera &cam, Color color, bool depth_test = true);
+    void arrow(const math::Vector3f &from, const math::Vector3f &to, Color color, bool depth_test = true);
+
+    /// upload the primitives of the frame, has to be called outside of the passes
+    void upload();
+    /// draw the uploaded primitives in the current pass, and discard them
+    void draw(const Camera &cam);
+
+    const DebugDrawStats &stats() const { return _stats; }
+
+    bool enabled = true; ///< when false, the primitives are discarded without being drawn
+
+  private:
+    struct DebugVertex {
+        math::Vector3f pos;
+        Color color;
+    };
+
+    std::vector<DebugVertex> &lines(bool depth_test) { return depth_test ? _lines : _overlay_lines; }
+
+    sg_pipeline _pip = {SG_INVALID_ID};
+    sg_pipeline _overlay_pip = {SG_INVALID_ID};
+    sg_buffer _buffer = {SG_INVALID_ID};
+    std::vector<DebugVertex> _lines;
+    std::vector<DebugVertex> _overlay_lines;
+    // offsets of the uploaded lines in the buffer, and their number of vertices
+    int _offset = 0;
+    int _overlay_offset = 0;
+    uint32_t _num_uploaded = 0;
+    uint32_t _num_overlay_uploaded = 0;
+    DebugDrawStats _stats;
+};
+
+} // namespace glengine
@@ -37,6 +37,9 @@ struct State {
     struct {
         Pass pass;
     } offscreen;
+    struct {
+        Pass pass; // on the color and depth images of the offscreen pass
+    } post;
     struct {
         Pass pass;
         EffectSSAO effect;
@@ -83,6 +86,7 @@ bool GLEngine::init(Context *context, const Config &config) {
 
     // resource manager
     _resource_manager.init();
+    _resource_manager._upload_queue = _config.deferred_uploads ? &_upload_queue : nullptr;
     // add standard resources
     for (int i = 0; i < ResourceManager::DefaultImageNum; i++) {
         _state->default_textures[i] = _resource_manager.default_image((ResourceManager::DefaultImage)i);
@@ -97,6 +101,11 @@ bool GLEngine::init(Context *context, const Config &config) {
     create_ssao_pass();
     // final pass
     create_fsq_pass();
+    // debug annotations, drawn at the end of the offscreen pass
+    _debug_draw.init(*this);
+    _text_labels.init(*this);
+    _grid.init(*this);
+    _meshlet_culler.init();
 
     // create root of the scene
     _root = new Object();
@@ -124,6 +133,13 @@ bool GLEngine::render() {
     _camera_manipulator.update(_camera);
     _camera.update(fbsize.x, fbsize.y);
 
+    MICROPROFILE_ENTERI("glengine", "uploads", MP_AUTO);
+    _upload_queue.process();
+    _debug_draw.upload();
+    _text_labels.upload(_camera, fbsize.x, fbsize.y);
+    _meshlet_culler.begin_frame(_config.meshlets);
+    MICROPROFILE_LEAVE();
+
     // /////////////////// //
     // main offscreen pass //
     // /////////////////// //
@@ -132,11 +148,38 @@ bool GLEngine::render() {
 
     /// \todo this is inefficient because there is no pipeline state caching - replace with a proper renderer that
     /// implements draw call sorting and optimization
-    _root->draw(_camera, math::matrix4_identity<float>());
+    _render_stats = RenderStats();
+    _root->draw(_camera, math::matrix4_identity<float>(), _config.lod, &_render_stats, &_meshlet_culler);
+    // user draw functions
+    for (auto &fun : _draw_functions) {
+        fun();
+    }
+    // ground grid, blended over the opaque objects
+    _grid.draw(_camera);
+    // debug/annotations stage
+    _debug_draw.draw(_camera);
+    if (!_config.use_mrt) {
+        for (auto &fun : _post_draw_functions) {
+            fun();
+        }
+    }
 
     sg_end_pass();
     MICROPROFILE_LEAVE();
 
+    // ///////// //
+    // post pass //
+    // ///////// //
+    if (_config.use_mrt && !_post_draw_functions.empty()) {
+        MICROPROFILE_ENTERI("glengine", "post pass", MP_AUTO);
+        sg_begin_pass(_state->post.pass.pass_id, &_state->post.pass.pass_action);
+        for (auto &fun : _post_draw_functions) {
+            fun();
+        }
+        sg_end_pass();
+        MICROPROFILE_LEAVE();
+    }
+
     // //// //
     // ssao //
     // //// //
@@ -176,6 +219,8 @@ bool GLEngine::render() {
     fsq_params_t fsq_params = {_state->fsq.debug ? 1.0f : 0.0f, _camera.near_plane(), _camera.far_plane()};
     sg_apply_uniforms(SG_SHADERSTAGE_FS, SLOT_fsq_params, SG_RANGE(fsq_params));
     sg_draw(0, 4, 1);
+    // text annotations, on top of the final image
+    _text_labels.draw();
 
     // Start the Dear ImGui frame
     MICROPROFILE_ENTERI("glengine", "imgui", MP_AUTO);
@@ -244,6 +289,12 @@ bool GLEngine::terminate() {
     // destroying objects
     log_info("Glengine: delete objects");
     delete _root;
+    // pending uploads are dropped, their resources are destroyed with the others
+    _upload_queue.terminate();
+    _debug_draw.terminate();
+    _text_labels.terminate();
+    _grid.terminate();
+    _meshlet_culler.terminate();
     // deallocate all resources
     log_info("Glengine: shut down resource manager");
     _resource_manager.terminate();
@@ -272,6 +323,7 @@ Object *GLEngine::create_object(const std::vector<Renderable> &renderables, Obje
 
 Mesh *GLEngine::create_mesh() {
     Mesh *mesh = new Mesh();
+    mesh->upload_queue = _resource_manager._upload_queue;
     _resource_manager.register_mesh(mesh);
     return mesh;
 }
@@ -322,6 +374,19 @@ void GLEngine::add_ui_function(std::function<void(void)> fun) {
     _ui_functions.push_back(fun);
 }
 
+void GLEngine::add_draw_function(std::function<void(void)> fun) {
+    _draw_functions.push_back(fun);
+}
+
+void GLEngine::add_post_draw_function(std::function<void(void)> fun) {
+    _post_draw_functions.push_back(fun);
+}
+
+sg_image GLEngine::scene_depth() const {
+    return _config.use_mrt ? _state->offscreen.pass.pass_desc.color_attachments[2].image
+                           : _state->default_textures[glengine::ResourceManager::White];
+}
+
 // called initially and when window size changes
 void GLEngine::create_offscreen_pass() {
     glengine::State &state = *_state;
@@ -329,6 +394,7 @@ void GLEngine::create_offscreen_pass() {
     const int height = _context->window_height();
     const int msaa_samples = _config.msaa_samples;
     // destroy previous resource (no-op if the current resource id is invalid)
+    sg_destroy_pass(state.post.pass.pass_id);
     sg_destroy_pass(state.offscreen.pass.pass_id);
     sg_destroy_image(state.offscreen.pass.pass_desc.color_attachments[0].image);
     sg_destroy_image(state.offscreen.pass.pass_desc.color_attachments[1].image);
@@ -384,6 +450,17 @@ void GLEngine::create_offscreen_pass() {
                                                       .value = {0.5f, 0.5f, 0.5f, 1.0f}}; // null normal
         state.offscreen.pass.pass_action.colors[2] = {.action = SG_ACTION_CLEAR,
                                                       .value = {1.0f, 1.0f, 1.0f, 1.0f}}; // far plane
+        // post pass, on the same color and depth images, while the encoded depth is read as a texture
+        state.post.pass.pass_desc = {0};
+        const sg_pass_desc &offscreen_desc = state.offscreen.pass.pass_desc;
+        state.post.pass.pass_desc.color_attachments[0].image = offscreen_desc.color_attachments[0].image;
+        state.post.pass.pass_desc.depth_stencil_attachment.image = offscreen_desc.depth_stencil_attachment.image;
+        state.post.pass.pass_desc.label = "post pass";
+        state.post.pass.pass_id = sg_make_pass(&state.post.pass.pass_desc);
+        state.post.pass.pass_action = {};
+        state.post.pass.pass_action.colors[0] = {.action = SG_ACTION_LOAD};
+        state.post.pass.pass_action.depth = {.action = SG_ACTION_LOAD};
+        state.post.pass.pass_action.stencil = {.action = SG_ACTION_LOAD};
     }
 }
 
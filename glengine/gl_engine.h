@@ -2,8 +2,13 @@
 
 #include "gl_camera.h"
 #include "gl_camera_manipulator.h"
+#include "gl_debug_draw.h"
+#include "gl_infinite_grid.h"
+#include "gl_meshlets.h"
 #include "gl_resource_manager.h"
+#include "gl_text_labels.h"
 #include "gl_object.h"
+#include "gl_upload_queue.h"
 
 #include <cstdint>
 #include <functional>
@@ -22,6 +27,13 @@ class GLEngine {
         bool show_imgui_statistics = false;
         uint16_t msaa_samples = 4;
         bool use_mrt = false;
+        /// meshes and resource manager images are uploaded through the upload queue, within its per-frame budget.
+        /// Resources are not drawn until uploaded, so this is for streaming content rather than static scenes
+        bool deferred_uploads = false;
+        /// selection of the levels of detail of the meshes, per frame
+        LodParams lod;
+        /// culling of the meshlets of the meshes, per frame
+        MeshletParams meshlets;
     };
 
   public:
@@ -39,6 +51,16 @@ class GLEngine {
 
     /// get resource manager
     ResourceManager &resource_manager() { return _resource_manager; }
+    /// uploads drained at the beginning of each frame (see Config::deferred_uploads)
+    UploadQueue &upload_queue() { return _upload_queue; }
+    /// debug primitives of the frame, to be added before each render() (see DebugDraw)
+    DebugDraw &debug_draw() { return _debug_draw; }
+    /// text labels of the frame, to be added before each render() (see TextLabels)
+    TextLabels &text_labels() { return _text_labels; }
+    /// procedural ground grid, disabled by default (see InfiniteGrid)
+    InfiniteGrid &grid() { return _grid; }
+    /// renderables of the objects drawn by the last frame, with and without the levels of detail and the meshlets
+    const RenderStats &render_stats() const { return _render_stats; }
 
     // /////// //
     // objects //
@@ -69,7 +91,7 @@ class GLEngine {
     Mesh *create_box_mesh(const math::Vector3f &size = {1.0f, 1.0f, 1.0f});
     /// sphere
     Mesh *create_sphere_mesh(float radius = 1.0f, uint32_t subdiv = 10);
-    /// grid
+    /// grid (see also grid() for an infinite one)
     Mesh *create_grid_mesh(float len = 100.0f, float step = 5.0f);
 
     // ///////// //
@@ -93,6 +115,15 @@ class GLEngine {
     // // //
     /// add a function to be called during the UI rendering
     void add_ui_function(std::function<void(void)> fun);
+    /// add a function to be called in the offscreen pass, after the objects are drawn (i.e. custom renderers)
+    void add_draw_function(std::function<void(void)> fun);
+    /// add a function to be called after the offscreen pass, in a pass on its color and depth attachments with a
+    /// single color target (i.e. renderers reading the depth of the scene through scene_depth()). Without MRT there
+    /// is no depth to read, and the functions are called at the end of the offscreen pass instead
+    void add_post_draw_function(std::function<void(void)> fun);
+    /// depth of the offscreen pass, encoded in rgba (see encodeDepth in common.glsl.inc), or a white texture (the far
+    /// plane) without MRT. Changes when the window is resized, and is only valid in the post draw functions
+    sg_image scene_depth() const;
 
     void create_offscreen_pass();
     void create_ssao_pass();
@@ -109,6 +140,12 @@ class GLEngine {
     Camera _camera;
     CameraManipulator _camera_manipulator;
     ResourceManager _resource_manager;
+    UploadQueue _upload_queue;
+    DebugDraw _debug_draw;
+    TextLabels _text_labels;
+    InfiniteGrid _grid;
+    MeshletCuller _meshlet_culler;
+    RenderStats _render_stats;
 
     Object *_root = nullptr;
 
@@ -116,6 +153,8 @@ class GLEngine {
     State *_state = nullptr; ///< persistent state needed by the renderer
 
     std::vector<std::function<void(void)>> _ui_functions;
+    std::vector<std::function<void(void)>> _draw_functions;
+    std::vector<std::function<void(void)>> _post_draw_functions;
 };
 
 } // namespace glengine
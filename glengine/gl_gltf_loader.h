@@ -0,0 +1,41 @@
+#pragma once
+
+#include "gl_mesh_simplifier.h"
+#include "gl_meshlets.h"
+
+#include <vector>
+
+namespace glengine {
+
+class GLEngine;
+class Object;
+struct Renderable;
+
+struct GltfImportOptions {
+    /// levels of detail for the meshes that aren't kept quantized (see generate_lods), selected when drawn by the
+    /// screen size of the objects (see Renderable::select_lod)
+    bool generate_lods = false;
+    LodOptions lods;
+    /// meshlets for the meshes that aren't kept quantized (see build_meshlets), culled when drawn (see MeshletCuller)
+    bool build_meshlets = false;
+    MeshletOptions meshlets;
+    /// the base color textures of the unlit materials (and of no other material) with the same sampling share one
+    /// image: a texture array when they have the same size, else an atlas of at most atlas_max_size texels (only for
+    /// repeating textures), so that these materials differ only by their uniforms
+    bool batch_textures = false;
+    uint32_t atlas_max_size = 4096;
+};
+
+/// flat import of the default scene of a gltf file: node transforms are baked into the vertices, so every node using
+/// a mesh gets its own copy of the buffers
+std::vector<Renderable> create_from_gltf(GLEngine &eng, const char *filename);
+std::vector<Renderable> create_from_gltf(GLEngine &eng, const char *filename, const GltfImportOptions &options);
+
+/// hierarchical import: one object per node with the node transform, under a root object (returned) that converts
+/// from the y-up gltf convention. Meshes are created once per gltf mesh and shared by all the nodes using them.
+/// Returns nullptr if the file can't be loaded
+Object *create_object_from_gltf(GLEngine &eng, const char *filename, Object *parent = nullptr);
+Object *create_object_from_gltf(GLEngine &eng, const char *filename, const GltfImportOptions &options,
+                                Object *parent = nullptr);
+
+} // namespace glengine
@@ -0,0 +1,513 @@
+#include "gl_gltf_mesh.h"
+#include "gl_logger.h"
+#include "gl_meshopt_codec.h"
+#include "gl_thread_pool.h"
+
+#include "tinygltf/tiny_gltf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <string>
+
+namespace {
+
+template <typename T> float read_component(const uint8_t *p) {
+    T v;
+    memcpy(&v, p, sizeof(T));
+    return float(v);
+}
+
+float read_component(const uint8_t *p, int component_type, bool normalized) {
+    switch (component_type) {
+    case TINYGLTF_COMPONENT_TYPE_FLOAT:
+        return read_component<float>(p);
+    case TINYGLTF_COMPONENT_TYPE_BYTE: {
+        float v = read_component<int8_t>(p);
+        return normalized ? std::max(v / 127.0f, -1.0f) : v;
+    }
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE: {
+        float v = read_component<uint8_t>(p);
+        return normalized ? v / 255.0f : v;
+    }
+    case TINYGLTF_COMPONENT_TYPE_SHORT: {
+        float v = read_component<int16_t>(p);
+        return normalized ? std::max(v / 32767.0f, -1.0f) : v;
+    }
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+        float v = read_component<uint16_t>(p);
+        return normalized ? v / 65535.0f : v;
+    }
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+        return read_component<uint32_t>(p);
+    default:
+        return 0.0f;
+    }
+}
+
+// start of the data of an accessor and its stride, or nullptr if the accessor doesn't fit in its buffer
+const uint8_t *accessor_data(const tinygltf::Model &model, int index, size_t &stride) {
+    if (index < 0 || index >= int(model.accessors.size())) {
+        return nullptr;
+    }
+    const tinygltf::Accessor &acc = model.accessors[index];
+    if (acc.bufferView < 0 || acc.bufferView >= int(model.bufferViews.size())) {
+        return nullptr; // sparse accessors without a buffer view are not supported
+    }
+    const tinygltf::BufferView &view = model.bufferViews[acc.bufferView];
+    if (view.buffer < 0 || view.buffer >= int(model.buffers.size())) {
+        return nullptr;
+    }
+    const tinygltf::Buffer &buffer = model.buffers[view.buffer];
+    const int byte_stride = acc.ByteStride(view);
+    const int component_size = tinygltf::GetComponentSizeInBytes(acc.componentType);
+    const int num_components = tinygltf::GetNumComponentsInType(acc.type);
+    if (byte_stride <= 0 || component_size <= 0 || num_components <= 0) {
+        return nullptr;
+    }
+    stride = size_t(byte_stride);
+    const size_t begin = view.byteOffset + acc.byteOffset;
+    const size_t element_size = size_t(component_size) * num_components;
+    if (acc.count > 0 && begin + stride * (acc.count - 1) + element_size > buffer.data.size()) {
+        return nullptr;
+    }
+    return buffer.data.data() + begin;
+}
+
+int attribute(const tinygltf::Primitive &primitive, const char *name) {
+    auto it = primitive.attributes.find(name);
+    return it != primitive.attributes.end() ? it->second : -1;
+}
+
+// indices of a primitive, checked against the number of vertices, or a trivial index list when it has none
+bool primitive_indices(const tinygltf::Model &model, const tinygltf::Primitive &primitive, size_t num_vertices,
+                       std::vector<uint32_t> &indices) {
+    if (primitive.indices < 0) {
+        indices.resize(num_vertices);
+        for (size_t i = 0; i < num_vertices; i++) {
+            indices[i] = uint32_t(i);
+        }
+        return true;
+    }
+    if (!glengine::gltf_read_indices(model, primitive.indices, indices)) {
+        log_warning("gltf: skipping primitive (index data format not supported)");
+        return false;
+    }
+    for (uint32_t index : indices) {
+        if (index >= num_vertices) {
+            log_warning("gltf: skipping primitive (index out of range)");
+            return false;
+        }
+    }
+    return true;
+}
+
+int32_t read_integer(const uint8_t *p, int component_type) {
+    switch (component_type) {
+    case TINYGLTF_COMPONENT_TYPE_BYTE:
+        return int32_t(int8_t(p[0]));
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        return int32_t(p[0]);
+    case TINYGLTF_COMPONENT_TYPE_SHORT: {
+        int16_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT: {
+        uint16_t v;
+        memcpy(&v, p, sizeof(v));
+        return v;
+    }
+    default:
+        return 0;
+    }
+}
+
+// a buffer view compressed with EXT_meshopt_compression
+struct MeshoptView {
+    int view = -1;
+    const uint8_t *data = nullptr; ///< compressed data
+    size_t size = 0;
+    size_t count = 0;  ///< number of elements
+    size_t stride = 0; ///< size of the elements
+    std::string mode;
+    glengine::MeshoptFilter filter = glengine::MeshoptFilter::None;
+    size_t offset = 0; ///< of the decoded data in the new buffer
+    bool ok = false;
+};
+
+bool parse_meshopt_view(const tinygltf::Model &model, int index, const tinygltf::Value &ext, MeshoptView &mv) {
+    auto integer = [&ext](const char *name, int default_value) {
+        return ext.Has(name) && ext.Get(name).IsNumber() ? ext.Get(name).GetNumberAsInt() : default_value;
+    };
+    auto string = [&ext](const char *name, const char *default_value) {
+        return ext.Has(name) && ext.Get(name).IsString() ? ext.Get(name).Get<std::string>() : default_value;
+    };
+    const int buffer = integer("buffer", -1);
+    const int offset = integer("byteOffset", 0);
+    const int length = integer("byteLength", -1);
+    const int stride = integer("byteStride", -1);
+    const int count = integer("count", -1);
+    if (buffer < 0 || buffer >= int(model.buffers.size()) || offset < 0 || length < 0 || stride <= 0 || count < 0 ||
+        size_t(offset) + size_t(length) > model.buffers[buffer].data.size()) {
+        return false;
+    }
+    const std::string filter = string("filter", "NONE");
+    mv.view = index;
+    mv.data = model.buffers[buffer].data.data() + offset;
+    mv.size = size_t(length);
+    mv.count = size_t(count);
+    mv.stride = size_t(stride);
+    mv.mode = string("mode", "");
+    mv.filter = filter == "OCTAHEDRAL"    ? glengine::MeshoptFilter::Octahedral
+                : filter == "QUATERNION"  ? glengine::MeshoptFilter::Quaternion
+                : filter == "EXPONENTIAL" ? glengine::MeshoptFilter::Exponential
+                                          : glengine::MeshoptFilter::None;
+    return filter == "NONE" || mv.filter != glengine::MeshoptFilter::None;
+}
+
+bool decode_meshopt_view(MeshoptView &mv, uint8_t *dst) {
+    if (mv.mode == "ATTRIBUTES") {
+        return glengine::meshopt_decode_vertex_buffer(dst, mv.count, mv.stride, mv.data, mv.size) &&
+               glengine::meshopt_decode_filter(mv.filter, dst, mv.count, mv.stride);
+    }
+    if (mv.mode == "TRIANGLES") {
+        return glengine::meshopt_decode_index_buffer(dst, mv.count, mv.stride, mv.data, mv.size);
+    }
+    if (mv.mode == "INDICES") {
+        return glengine::meshopt_decode_index_sequence(dst, mv.count, mv.stride, mv.data, mv.size);
+    }
+    return false;
+}
+
+int8_t snorm8(float v) {
+    return int8_t(std::lround(std::min(std::max(v, -1.0f), 1.0f) * 127.0f));
+}
+
+} // namespace
+
+namespace glengine {
+
+bool gltf_decode_meshopt(tinygltf::Model &model) {
+    std::vector<MeshoptView> views;
+    size_t total = 0;
+    for (int i = 0; i < int(model.bufferViews.size()); i++) {
+        auto ext = model.bufferViews[i].extensions.find("EXT_meshopt_compression");
+        if (ext == model.bufferViews[i].extensions.end()) {
+            continue;
+        }
+        MeshoptView mv;
+        if (!parse_meshopt_view(model, i, ext->second, mv)) {
+            log_error("gltf: invalid EXT_meshopt_compression data in buffer view %d", i);
+            return false;
+        }
+        mv.offset = total;
+        total += (mv.count * mv.stride + 15) & ~size_t(15);
+        views.push_back(mv);
+    }
+    if (views.empty()) {
+        return true;
+    }
+    tinygltf::Buffer decoded;
+    decoded.data.resize(total);
+    parallel_for(0, uint32_t(views.size()), 1, [&views, &decoded](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            views[i].ok = decode_meshopt_view(views[i], decoded.data.data() + views[i].offset);
+        }
+    });
+    for (const auto &mv : views) {
+        if (!mv.ok) {
+            log_error("gltf: unable to decode buffer view %d (EXT_meshopt_compression, mode %s)", mv.view,
+                      mv.mode.c_str());
+            return false;
+        }
+        tinygltf::BufferView &view = model.bufferViews[mv.view];
+        view.buffer = int(model.buffers.size());
+        view.byteOffset = mv.offset;
+        view.byteLength = mv.count * mv.stride;
+    }
+    log_debug("gltf: decoded %d compressed buffer views, %zu bytes", int(views.size()), total);
+    model.buffers.push_back(std::move(decoded));
+    return true;
+}
+
+math::Matrix4f gltf_node_transform(const tinygltf::Node &node) {
+    math::Matrix4f tf = math::matrix4_identity<float>();
+    const auto &m = node.matrix;
+    const auto &t = node.translation;
+    const auto &r = node.rotation;
+    const auto &s = node.scale;
+    // the node can _either_ have a tf matrix or a set of T/R/S data
+    if (m.size() == 16) {
+        for (int i = 0; i < 16; i++) {
+            tf.data[i] = float(m[i]);
+        }
+    } else if (t.size() >= 3 || r.size() >= 4 || s.size() >= 3) {
+        math::Vector3f translation = {0, 0, 0};
+        math::Vector3f scale = {1, 1, 1};
+        math::Quatf rotation = {1, 0, 0, 0};
+        if (t.size() >= 3) {
+            translation = {float(t[0]), float(t[1]), float(t[2])};
+        }
+        if (s.size() >= 3) {
+            scale = {float(s[0]), float(s[1]), float(s[2])};
+        }
+        if (r.size() >= 4) {
+            rotation = {float(r[3]), float(r[0]), float(r[1]), float(r[2])};
+        }
+        tf = math::create_translation(translation) * math::create_transformation({0.0f, 0.0f, 0.0f}, rotation) *
+             math::create_scaling(scale);
+    }
+    return tf;
+}
+
+math::Matrix4f gltf_root_transform() {
+    return math::create_transformation({0, 0, 0}, math::quat_from_euler_321<float>(M_PI_2, 0, 0));
+}
+
+bool gltf_read_accessor(const tinygltf::Model &model, int accessor, uint32_t num_components,
+                        std::vector<float> &out) {
+    size_t stride = 0;
+    const uint8_t *data = accessor_data(model, accessor, stride);
+    if (!data) {
+        return false;
+    }
+    const tinygltf::Accessor &acc = model.accessors[accessor];
+    const int component_size = tinygltf::GetComponentSizeInBytes(acc.componentType);
+    const uint32_t n = std::min(num_components, uint32_t(tinygltf::GetNumComponentsInType(acc.type)));
+    out.assign(acc.count * num_components, 0.0f);
+    for (size_t i = 0; i < acc.count; i++) {
+        const uint8_t *element = data + i * stride;
+        for (uint32_t c = 0; c < n; c++) {
+            out[i * num_components + c] = read_component(element + c * component_size, acc.componentType,
+                                                         acc.normalized);
+        }
+    }
+    return true;
+}
+
+bool gltf_read_indices(const tinygltf::Model &model, int accessor, std::vector<uint32_t> &out) {
+    size_t stride = 0;
+    const uint8_t *data = accessor_data(model, accessor, stride);
+    if (!data) {
+        return false;
+    }
+    const tinygltf::Accessor &acc = model.accessors[accessor];
+    out.resize(acc.count);
+    switch (acc.componentType) {
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        for (size_t i = 0; i < acc.count; i++) {
+            out[i] = data[i * stride];
+        }
+        return true;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        for (size_t i = 0; i < acc.count; i++) {
+            uint16_t v;
+            memcpy(&v, data + i * stride, sizeof(v));
+            out[i] = v;
+        }
+        return true;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT:
+        for (size_t i = 0; i < acc.count; i++) {
+            memcpy(&out[i], data + i * stride, sizeof(uint32_t));
+        }
+        return true;
+    default:
+        out.clear();
+        return false;
+    }
+}
+
+bool gltf_primitive_mesh_data(const tinygltf::Model &model, const tinygltf::Primitive &primitive,
+                              const math::Matrix4f &tf, MeshData &md) {
+    if (primitive.mode != TINYGLTF_MODE_TRIANGLES) {
+        log_warning("gltf: skipping primitive (only triangles are supported for now)");
+        return false;
+    }
+    std::vector<float> positions, normals, texcoords, tangents;
+    if (!gltf_read_accessor(model, attribute(primitive, "POSITION"), 3, positions)) {
+        log_warning("gltf: skipping primitive without readable positions");
+        return false;
+    }
+    const size_t num_vertices = positions.size() / 3;
+    if (num_vertices < 3) {
+        log_warning("gltf: skipping empty primitive");
+        return false;
+    }
+    // optional attributes must have one element per vertex
+    auto optional = [&](const char *name, uint32_t num_components, std::vector<float> &out) {
+        if (gltf_read_accessor(model, attribute(primitive, name), num_components, out) &&
+            out.size() != num_vertices * num_components) {
+            out.clear();
+        }
+    };
+    optional("NORMAL", 3, normals);
+    optional("TEXCOORD_0", 2, texcoords);
+    optional("TANGENT", 4, tangents);
+
+    auto rot = tf;
+    math::set_translation(rot, {0, 0, 0});
+    md.vertices.resize(num_vertices);
+    for (size_t vi = 0; vi < num_vertices; vi++) {
+        Vertex &v = md.vertices[vi];
+        const float *p = &positions[vi * 3];
+        v.pos = tf * math::Vector3f{p[0], p[1], p[2]};
+        v.color = {150, 150, 150, 255};
+        if (!normals.empty()) {
+            const float *n = &normals[vi * 3];
+            v.normal = rot * math::Vector3f{n[0], n[1], n[2]};
+        } else {
+            v.normal = {0.0f, 0.0f, 0.0f};
+        }
+        v.tex_coords = texcoords.empty() ? math::Vector2f{0.0f, 0.0f}
+                                         : math::Vector2f{texcoords[vi * 2], texcoords[vi * 2 + 1]};
+        if (!tangents.empty()) {
+            const float *t = &tangents[vi * 4];
+            v.tangent = rot * math::Vector3f{t[0], t[1], t[2]};
+        } else {
+            v.tangent = {0.0f, 0.0f, 0.0f};
+        }
+    }
+    return primitive_indices(model, primitive, num_vertices, md.indices);
+}
+
+bool gltf_primitive_is_quantized(const tinygltf::Model &model, const tinygltf::Primitive &primitive) {
+    const int position = attribute(primitive, "POSITION");
+    return position >= 0 && position < int(model.accessors.size()) &&
+           model.accessors[position].componentType != TINYGLTF_COMPONENT_TYPE_FLOAT;
+}
+
+bool gltf_primitive_quantized_data(const tinygltf::Model &model, const tinygltf::Primitive &primitive,
+                                   const math::Matrix4f &tf, QuantizedMeshData &qmd) {
+    if (primitive.mode != TINYGLTF_MODE_TRIANGLES || !gltf_primitive_is_quantized(model, primitive)) {
+        return false;
+    }
+    const int position = attribute(primitive, "POSITION");
+    size_t stride = 0;
+    const uint8_t *data = accessor_data(model, position, stride);
+    const tinygltf::Accessor &acc = model.accessors[position];
+    if (!data || acc.count < 3 || tinygltf::GetNumComponentsInType(acc.type) < 3) {
+        return false;
+    }
+    // the SHORT4N value f = q / 32767 is mapped back to the value of the accessor by scale * f + offset.
+    // 8 bit values are shifted to 16 bits and unsigned ones are centered on 0; q = -32768 is clamped to -32767 (1
+    // unit error for the lowest value, at most) since SNORM formats can't represent it linearly
+    const bool normalized = acc.normalized;
+    float scale = 0.0f, offset = 0.0f;
+    int32_t shift = 0, center = 0, lowest = std::numeric_limits<int32_t>::lowest();
+    switch (acc.componentType) {
+    case TINYGLTF_COMPONENT_TYPE_BYTE:
+        shift = 8, lowest = normalized ? -127 : lowest;
+        scale = 32767.0f / 256.0f / (normalized ? 127.0f : 1.0f);
+        break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_BYTE:
+        shift = 8, center = 128;
+        scale = 32767.0f / 256.0f / (normalized ? 255.0f : 1.0f);
+        offset = 128.0f / (normalized ? 255.0f : 1.0f);
+        break;
+    case TINYGLTF_COMPONENT_TYPE_SHORT:
+        lowest = normalized ? -32767 : lowest;
+        scale = normalized ? 1.0f : 32767.0f;
+        break;
+    case TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT:
+        center = 32768;
+        scale = 32767.0f / (normalized ? 65535.0f : 1.0f);
+        offset = 32768.0f / (normalized ? 65535.0f : 1.0f);
+        break;
+    default:
+        return false;
+    }
+    const size_t num_vertices = acc.count;
+    const int component_size = tinygltf::GetComponentSizeInBytes(acc.componentType);
+
+    // the other attributes are converted from floats, which is lossless for the 8 bit normals and tangents and the
+    // 8 and 16 bit texture coordinates allowed by KHR_mesh_quantization
+    std::vector<float> normals, texcoords, tangents;
+    auto optional = [&](const char *name, uint32_t num_components, std::vector<float> &out) {
+        if (gltf_read_accessor(model, attribute(primitive, name), num_components, out) &&
+            out.size() != num_vertices * num_components) {
+            out.clear();
+        }
+    };
+    optional("NORMAL", 3, normals);
+    optional("TEXCOORD_0", 2, texcoords);
+    optional("TANGENT", 4, tangents);
+    for (float uv : texcoords) {
+        if (uv < 0.0f || uv > 1.0f) {
+            log_debug("gltf: texture coordinates outside [0,1], the primitive can't stay quantized");
+            return false;
+        }
+    }
+
+    qmd.vertices.resize(num_vertices);
+    for (size_t vi = 0; vi < num_vertices; vi++) {
+        QuantizedVertex &v = qmd.vertices[vi];
+        const uint8_t *element = data + vi * stride;
+        for (int c = 0; c < 3; c++) {
+            const int32_t value = std::max(read_integer(element + c * component_size, acc.componentType), lowest);
+            v.pos[c] = int16_t(std::max((value - center) * (1 << shift), -32767));
+        }
+        v.pos[3] = 0;
+        v.color = {150, 150, 150, 255};
+        for (int c = 0; c < 3; c++) {
+            v.normal[c] = normals.empty() ? 0 : snorm8(normals[vi * 3 + c]);
+            v.tangent[c] = tangents.empty() ? 0 : snorm8(tangents[vi * 4 + c]);
+        }
+        v.normal[3] = 0;
+        v.tangent[3] = tangents.empty() || tangents[vi * 4 + 3] >= 0.0f ? 127 : -127;
+        for (int c = 0; c < 2; c++) {
+            v.tex_coords[c] = texcoords.empty() ? 0 : uint16_t(std::lround(texcoords[vi * 2 + c] * 65535.0f));
+        }
+    }
+    qmd.dequantization = tf * math::create_translation<float>({offset, offset, offset}) *
+                         math::create_scaling<float>({scale, scale, scale});
+    return primitive_indices(model, primitive, num_vertices, qmd.indices);
+}
+
+bool gltf_node_instances(const tinygltf::Model &model, const tinygltf::Node &node,
+                         std::vector<math::Matrix4f> &instances) {
+    auto ext = node.extensions.find("EXT_mesh_gpu_instancing");
+    if (ext == node.extensions.end() || !ext->second.Has("attributes")) {
+        return false;
+    }
+    const tinygltf::Value &attributes = ext->second.Get("attributes");
+    auto read = [&](const char *name, uint32_t num_components, std::vector<float> &out) {
+        if (!attributes.Has(name) || !attributes.Get(name).IsNumber()) {
+            return true;
+        }
+        return gltf_read_accessor(model, attributes.Get(name).GetNumberAsInt(), num_components, out);
+    };
+    std::vector<float> translations, rotations, scales;
+    if (!read("TRANSLATION", 3, translations) || !read("ROTATION", 4, rotations) || !read("SCALE", 3, scales)) {
+        log_warning("gltf: invalid instance attributes");
+        return false;
+    }
+    const size_t count = std::max({translations.size() / 3, rotations.size() / 4, scales.size() / 3});
+    if (count == 0 || (!translations.empty() && translations.size() != count * 3) ||
+        (!rotations.empty() && rotations.size() != count * 4) || (!scales.empty() && scales.size() != count * 3)) {
+        log_warning("gltf: instance attributes with different counts");
+        return false;
+    }
+    instances.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        math::Vector3f translation = {0, 0, 0};
+        math::Vector3f scale = {1, 1, 1};
+        math::Quatf rotation = {1, 0, 0, 0};
+        if (!translations.empty()) {
+            translation = {translations[i * 3], translations[i * 3 + 1], translations[i * 3 + 2]};
+        }
+        if (!rotations.empty()) {
+            const float *r = &rotations[i * 4];
+            rotation = {r[3], r[0], r[1], r[2]};
+        }
+        if (!scales.empty()) {
+            scale = {scales[i * 3], scales[i * 3 + 1], scales[i * 3 + 2]};
+        }
+        instances[i] = math::create_translation(translation) *
+                       math::create_transformation({0.0f, 0.0f, 0.0f}, rotation) * math::create_scaling(scale);
+    }
+    return true;
+}
+
+} // namespace glengine
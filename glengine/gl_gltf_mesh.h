@@ -0,0 +1,63 @@
+#pragma once
+
+#include "gl_prefabs.h"
+#include "math/vmath.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace tinygltf {
+class Model;
+class Node;
+struct Primitive;
+} // namespace tinygltf
+
+namespace glengine {
+
+/// decode the buffer views compressed with EXT_meshopt_compression (on the worker threads, one task per view) into a
+/// new buffer, and point the views to it: accessors then read them as uncompressed data. Returns false if a view
+/// can't be decoded
+bool gltf_decode_meshopt(tinygltf::Model &model);
+
+/// local transform of a gltf node (either its matrix, or its translation/rotation/scale)
+math::Matrix4f gltf_node_transform(const tinygltf::Node &node);
+
+/// transform applied at the root of gltf scenes, which are y-up, to match the z-up convention of the engine
+math::Matrix4f gltf_root_transform();
+
+/// read the elements of an accessor as floats, num_components per element (missing components are set to 0).
+/// Any component type and byte stride allowed by the spec is supported, normalized integers are converted to [0,1]
+/// or [-1,1]. Returns false if the accessor has no data, or if it points outside of its buffer
+bool gltf_read_accessor(const tinygltf::Model &model, int accessor, uint32_t num_components, std::vector<float> &out);
+/// read an index accessor (unsigned byte, short or int)
+bool gltf_read_indices(const tinygltf::Model &model, int accessor, std::vector<uint32_t> &out);
+
+/// vertices and indices of a triangle list primitive with the transform tf applied. Primitives without indices
+/// get a trivial index list. Returns false (and logs why) for unsupported primitives
+bool gltf_primitive_mesh_data(const tinygltf::Model &model, const tinygltf::Primitive &primitive,
+                              const math::Matrix4f &tf, MeshData &md);
+
+/// mesh data kept quantized (KHR_mesh_quantization), see QuantizedVertex
+struct QuantizedMeshData {
+    std::vector<QuantizedVertex> vertices;
+    std::vector<uint32_t> indices;
+    math::Matrix4f dequantization = math::matrix4_identity<float>(); ///< from the SHORT4N positions to mesh space
+};
+
+/// true if the positions of the primitive are stored as integers (KHR_mesh_quantization)
+bool gltf_primitive_is_quantized(const tinygltf::Model &model, const tinygltf::Primitive &primitive);
+
+/// vertices of a primitive with quantized positions, without converting them to floats: 8 and 16 bit positions are
+/// stored in 16 bits, and the offset and scale of the conversion are folded into the dequantization transform, with
+/// tf applied after them. Normals and tangents are stored in 8 bits, texture coordinates in 16 bits. Returns false
+/// for primitives that don't fit the quantized layout (float positions, or texture coordinates outside [0,1]), that
+/// have to use gltf_primitive_mesh_data instead
+bool gltf_primitive_quantized_data(const tinygltf::Model &model, const tinygltf::Primitive &primitive,
+                                   const math::Matrix4f &tf, QuantizedMeshData &qmd);
+
+/// transforms of the instances of a node (EXT_mesh_gpu_instancing), in the space of the node.
+/// Returns false if the node has no (valid) instances
+bool gltf_node_instances(const tinygltf::Model &model, const tinygltf::Node &node,
+                         std::vector<math::Matrix4f> &instances);
+
+} // namespace glengine
@@ -0,0 +1,816 @@
+#include "gl_gltf_reader.h"
+#include "gl_logger.h"
+
+#include "tinygltf/tiny_gltf.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+namespace {
+
+// bump allocator: the text of the file and the strings with escape sequences live as long as the reader, and are
+// freed at once with it
+class Arena {
+  public:
+    char *allocate(size_t size) {
+        if (_used + size > _capacity) {
+            _capacity = std::max(size, BLOCK_SIZE);
+            _blocks.emplace_back(new char[_capacity]);
+            _used = 0;
+        }
+        char *p = _blocks.back().get() + _used;
+        _used += size;
+        return p;
+    }
+
+  private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+    std::vector<std::unique_ptr<char[]>> _blocks;
+    size_t _capacity = 0;
+    size_t _used = 0;
+};
+
+// pull parser over a json text: values are read by the caller as it walks the document, objects and arrays call a
+// function for each of their members or elements. On a syntax error the reader stops, and every further read fails
+class JsonReader {
+  public:
+    JsonReader(const char *text, size_t size, Arena &arena)
+    : _begin(text)
+    , _p(text)
+    , _end(text + size)
+    , _arena(arena) {}
+
+    bool ok() const { return _error == nullptr; }
+    const char *error() const { return _error; }
+    /// line of the error, or of the current position
+    int line() const { return 1 + int(std::count(_begin, _p, '\n')); }
+
+    /// member(std::string_view key) is called for each member, and has to read or skip its value
+    template <typename F> void object(F &&member) {
+        if (!expect('{')) {
+            return;
+        }
+        if (consume('}')) {
+            return;
+        }
+        do {
+            std::string_view key;
+            if (!read(key) || !expect(':')) {
+                return;
+            }
+            member(key);
+        } while (ok() && consume(','));
+        expect('}');
+    }
+
+    /// element() is called for each element, and has to read or skip it
+    template <typename F> void array(F &&element) {
+        if (!expect('[')) {
+            return;
+        }
+        if (consume(']')) {
+            return;
+        }
+        do {
+            element();
+        } while (ok() && consume(','));
+        expect(']');
+    }
+
+    bool read(std::string_view &s);
+    bool read(double &v);
+    bool read(bool &v);
+
+    bool read(std::string &s) {
+        std::string_view view;
+        if (read(view)) {
+            s.assign(view.data(), view.size());
+        }
+        return ok();
+    }
+
+    template <typename T> bool read_integer(T &v) {
+        double d = 0.0;
+        if (read(d)) {
+            if (d != std::floor(d) || d < double(std::numeric_limits<T>::lowest()) ||
+                d > double(std::numeric_limits<T>::max())) {
+                return fail("integer expected");
+            }
+            v = T(d);
+        }
+        return ok();
+    }
+    bool read(int &v) { return read_integer(v); }
+    bool read(size_t &v) { return read_integer(v); }
+
+    template <typename T> bool read(std::vector<T> &v) {
+        v.clear();
+        array([this, &v]() {
+            v.emplace_back();
+            read(v.back());
+        });
+        return ok();
+    }
+
+    /// any value, as a tinygltf value (used for extensions)
+    tinygltf::Value value();
+    void skip();
+
+  private:
+    void skip_whitespace() {
+        while (_p < _end && (*_p == ' ' || *_p == '\n' || *_p == '\r' || *_p == '\t')) {
+            _p++;
+        }
+    }
+    char peek() {
+        skip_whitespace();
+        return _p < _end ? *_p : '\0';
+    }
+    bool consume(char c) {
+        if (peek() == c) {
+            _p++;
+            return true;
+        }
+        return false;
+    }
+    bool expect(char c) {
+        if (ok() && !consume(c)) {
+            snprintf(_message, sizeof(_message), "'%c' expected", c);
+            return fail(_message);
+        }
+        return ok();
+    }
+    bool fail(const char *message) {
+        if (ok()) {
+            _error = message;
+            _end = _p; // stop parsing
+        }
+        return false;
+    }
+    bool literal(const char *word) {
+        const size_t len = strlen(word);
+        if (size_t(_end - _p) < len || memcmp(_p, word, len) != 0) {
+            return fail("invalid literal");
+        }
+        _p += len;
+        return true;
+    }
+    bool unescape(const char *begin, const char *end, std::string_view &s);
+
+    const char *_begin;
+    const char *_p;
+    const char *_end;
+    Arena &_arena;
+    const char *_error = nullptr;
+    char _message[16];
+};
+
+bool JsonReader::read(std::string_view &s) {
+    if (!expect('"')) {
+        return false;
+    }
+    const char *begin = _p;
+    bool escaped = false;
+    while (_p < _end && *_p != '"') {
+        if (*_p == '\\') {
+            escaped = true;
+            _p++;
+        }
+        _p++;
+    }
+    if (_p >= _end) {
+        return fail("unterminated string");
+    }
+    const char *end = _p++;
+    if (!escaped) {
+        s = std::string_view(begin, size_t(end - begin));
+        return true;
+    }
+    return unescape(begin, end, s);
+}
+
+// escape sequences never make the string longer, the unescaped string fits in the size of the original one
+bool JsonReader::unescape(const char *begin, const char *end, std::string_view &s) {
+    char *out = _arena.allocate(size_t(end - begin));
+    char *o = out;
+    for (const char *p = begin; p < end; p++) {
+        if (*p != '\\') {
+            *o++ = *p;
+            continue;
+        }
+        switch (*++p) {
+        case 'b':
+            *o++ = '\b';
+            break;
+        case 'f':
+            *o++ = '\f';
+            break;
+        case 'n':
+            *o++ = '\n';
+            break;
+        case 'r':
+            *o++ = '\r';
+            break;
+        case 't':
+            *o++ = '\t';
+            break;
+        case 'u': {
+            if (end - p < 5) {
+                return fail("invalid unicode escape sequence");
+            }
+            char hex[5] = {p[1], p[2], p[3], p[4], '\0'};
+            char *hex_end = nullptr;
+            uint32_t c = uint32_t(strtoul(hex, &hex_end, 16));
+            if (hex_end != hex + 4) {
+                return fail("invalid unicode escape sequence");
+            }
+            p += 4;
+            // utf-8 encoding, surrogate pairs are kept as two code points: names and uris don't use them
+            if (c < 0x80) {
+                *o++ = char(c);
+            } else if (c < 0x800) {
+                *o++ = char(0xc0 | (c >> 6));
+                *o++ = char(0x80 | (c & 0x3f));
+            } else {
+                *o++ = char(0xe0 | (c >> 12));
+                *o++ = char(0x80 | ((c >> 6) & 0x3f));
+                *o++ = char(0x80 | (c & 0x3f));
+            }
+            break;
+        }
+        default: // '"', '\\' and '/'
+            *o++ = *p;
+            break;
+        }
+    }
+    s = std::string_view(out, size_t(o - out));
+    return true;
+}
+
+bool JsonReader::read(double &v) {
+    const char c = peek();
+    if (c != '-' && (c < '0' || c > '9')) {
+        return fail("number expected");
+    }
+    // the text is null terminated, strtod stops at the end of the number
+    char *end = nullptr;
+    v = strtod(_p, &end);
+    if (end == _p || end > _end) {
+        return fail("invalid number");
+    }
+    _p = end;
+    return true;
+}
+
+bool JsonReader::read(bool &v) {
+    const char c = peek();
+    if (c == 't') {
+        v = true;
+        return literal("true");
+    }
+    if (c == 'f') {
+        v = false;
+        return literal("false");
+    }
+    return fail("boolean expected");
+}
+
+tinygltf::Value JsonReader::value() {
+    switch (peek()) {
+    case '{': {
+        tinygltf::Value::Object obj;
+        object([this, &obj](std::string_view key) { obj[std::string(key)] = value(); });
+        return tinygltf::Value(std::move(obj));
+    }
+    case '[': {
+        tinygltf::Value::Array arr;
+        array([this, &arr]() { arr.push_back(value()); });
+        return tinygltf::Value(std::move(arr));
+    }
+    case '"': {
+        std::string s;
+        read(s);
+        return tinygltf::Value(std::move(s));
+    }
+    case 't':
+    case 'f': {
+        bool b = false;
+        read(b);
+        return tinygltf::Value(b);
+    }
+    case 'n':
+        literal("null");
+        return tinygltf::Value();
+    default: {
+        // integers are kept as integers, as tinygltf does
+        double d = 0.0;
+        read(d);
+        if (d == std::floor(d) && std::fabs(d) <= double(std::numeric_limits<int>::max())) {
+            return tinygltf::Value(int(d));
+        }
+        return tinygltf::Value(d);
+    }
+    }
+}
+
+void JsonReader::skip() {
+    switch (peek()) {
+    case '{':
+        object([this](std::string_view) { skip(); });
+        break;
+    case '[':
+        array([this]() { skip(); });
+        break;
+    case '"': {
+        std::string_view s;
+        read(s);
+        break;
+    }
+    case 't':
+    case 'f': {
+        bool b;
+        read(b);
+        break;
+    }
+    case 'n':
+        literal("null");
+        break;
+    default: {
+        double d;
+        read(d);
+        break;
+    }
+    }
+}
+
+// model parts
+
+void read_extensions(JsonReader &r, tinygltf::ExtensionMap &extensions) {
+    r.object([&r, &extensions](std::string_view key) { extensions[std::string(key)] = r.value(); });
+}
+
+// array of objects, each one read by read_element(r, element)
+template <typename T, typename F> void read_objects(JsonReader &r, std::vector<T> &v, F &&read_element) {
+    r.array([&]() {
+        v.emplace_back();
+        read_element(r, v.back());
+    });
+}
+
+template <typename T> void read_texture_info(JsonReader &r, T &info) {
+    r.object([&r, &info](std::string_view key) {
+        if (key == "index") {
+            r.read(info.index);
+        } else if (key == "texCoord") {
+            r.read(info.texCoord);
+        } else if constexpr (std::is_same_v<T, tinygltf::NormalTextureInfo>) {
+            if (key == "scale") {
+                r.read(info.scale);
+            } else {
+                r.skip();
+            }
+        } else if constexpr (std::is_same_v<T, tinygltf::OcclusionTextureInfo>) {
+            if (key == "strength") {
+                r.read(info.strength);
+            } else {
+                r.skip();
+            }
+        } else {
+            r.skip();
+        }
+    });
+}
+
+int accessor_type(std::string_view type) {
+    static const std::pair<const char *, int> types[] = {
+        {"SCALAR", TINYGLTF_TYPE_SCALAR}, {"VEC2", TINYGLTF_TYPE_VEC2}, {"VEC3", TINYGLTF_TYPE_VEC3},
+        {"VEC4", TINYGLTF_TYPE_VEC4},     {"MAT2", TINYGLTF_TYPE_MAT2}, {"MAT3", TINYGLTF_TYPE_MAT3},
+        {"MAT4", TINYGLTF_TYPE_MAT4}};
+    for (const auto &t : types) {
+        if (type == t.first) {
+            return t.second;
+        }
+    }
+    return -1;
+}
+
+void read_accessor(JsonReader &r, tinygltf::Accessor &acc) {
+    r.object([&r, &acc](std::string_view key) {
+        if (key == "bufferView") {
+            r.read(acc.bufferView);
+        } else if (key == "byteOffset") {
+            r.read(acc.byteOffset);
+        } else if (key == "componentType") {
+            r.read(acc.componentType);
+        } else if (key == "normalized") {
+            r.read(acc.normalized);
+        } else if (key == "count") {
+            r.read(acc.count);
+        } else if (key == "type") {
+            std::string_view type;
+            r.read(type);
+            acc.type = accessor_type(type);
+        } else if (key == "min") {
+            r.read(acc.minValues);
+        } else if (key == "max") {
+            r.read(acc.maxValues);
+        } else if (key == "name") {
+            r.read(acc.name);
+        } else if (key == "sparse") {
+            // not supported by the engine: only flagged, the values are read from the buffer view
+            acc.sparse.isSparse = true;
+            r.skip();
+        } else {
+            r.skip();
+        }
+    });
+}
+
+void read_attributes(JsonReader &r, std::map<std::string, int> &attributes) {
+    r.object([&r, &attributes](std::string_view key) { r.read(attributes[std::string(key)]); });
+}
+
+void read_primitive(JsonReader &r, tinygltf::Primitive &primitive) {
+    primitive.mode = TINYGLTF_MODE_TRIANGLES;
+    r.object([&r, &primitive](std::string_view key) {
+        if (key == "attributes") {
+            read_attributes(r, primitive.attributes);
+        } else if (key == "indices") {
+            r.read(primitive.indices);
+        } else if (key == "material") {
+            r.read(primitive.material);
+        } else if (key == "mode") {
+            r.read(primitive.mode);
+        } else if (key == "targets") {
+            read_objects(r, primitive.targets, read_attributes);
+        } else if (key == "extensions") {
+            read_extensions(r, primitive.extensions);
+        } else {
+            r.skip();
+        }
+    });
+}
+
+void read_mesh(JsonReader &r, tinygltf::Mesh &mesh) {
+    r.object([&r, &mesh](std::string_view key) {
+        if (key == "primitives") {
+            read_objects(r, mesh.primitives, read_primitive);
+        } else if (key == "name") {
+            r.read(mesh.name);
+        } else {
+            r.skip();
+        }
+    });
+}
+
+void read_node(JsonReader &r, tinygltf::Node &node) {
+    r.object([&r, &node](std::string_view key) {
+        if (key == "mesh") {
+            r.read(node.mesh);
+        } else if (key == "children") {
+            r.read(node.children);
+        } else if (key == "matrix") {
+            r.read(node.matrix);
+        } else if (key == "translation") {
+            r.read(node.translation);
+        } else if (key == "rotation") {
+            r.read(node.rotation);
+        } else if (key == "scale") {
+            r.read(node.scale);
+        } else if (key == "name") {
+            r.read(node.name);
+        } else if (key == "extensions") {
+            read_extensions(r, node.extensions);
+        } else {
+            r.skip();
+        }
+    });
+}
+
+void read_scene(JsonReader &r, tinygltf::Scene &scene) {
+    r.object([&r, &scene](std::string_view key) {
+        if (key == "nodes") {
+            r.read(scene.nodes);
+        } else if (key == "name") {
+            r.read(scene.name);
+        } else {
+            r.skip();
+        }
+    });
+}
+
+void read_buffer(JsonReader &r, tinygltf::Buffer &buffer, size_t &size) {
+    r.object([&r, &buffer, &size](std::string_view key) {
+        if (key == "uri") {
+            r.read(buffer.uri);
+        } else if (key == "byteLength") {
+            r.read(size);
+        } else if (key == "name") {
+            r.read(buffer.name);
+        } else if (key == "extensions") {
+            read_extensions(r, buffer.extensions);
+        } else {
+            r.skip();
+        }
+    });
+}
+
+void read_buffer_view(JsonReader &r, tinygltf::BufferView &view) {
+    r.object([&r, &view](std::string_view key) {
+        if (key == "buffer") {
+            r.read(view.buffer);
+        } else if (key == "byteOffset") {
+            r.read(view.byteOffset);
+        } else if (key == "byteLength") {
+            r.read(view.byteLength);
+        } else if (key == "byteStride") {
+            r.read(view.byteStride);
+        } else if (key == "target") {
+            r.read(view.target);
+        } else if (key == "name") {
+            r.read(view.name);
+        } else if (key == "extensions") {
+            read_extensions(r, view.extensions);
+        } else {
+            r.skip();
+        }
+    });
+}
+
+void read_pbr(JsonReader &r, tinygltf::PbrMetallicRoughness &pbr) {
+    r.object([&r, &pbr](std::string_view key) {
+        if (key == "baseColorFactor") {
+            r.read(pbr.baseColorFactor);
+        } else if (key == "baseColorTexture") {
+            read_texture_info(r, pbr.baseColorTexture);
+        } else if (key == "metallicFactor") {
+            r.read(pbr.metallicFactor);
+        } else if (key == "roughnessFactor") {
+            r.read(pbr.roughnessFactor);
+        } else if (key == "metallicRoughnessTexture") {
+            read_texture_info(r, pbr.metallicRoughnessTexture);
+        } else {
+            r.skip();
+        }
+    });
+}
+
+void read_material(JsonReader &r, tinygltf::Material &mtl) {
+    mtl.emissiveFactor = {0.0, 0.0, 0.0};
+    r.object([&r, &mtl](std::string_view key) {
+        if (key == "pbrMetallicRoughness") {
+            read_pbr(r, mtl.pbrMetallicRoughness);
+        } else if (key == "normalTexture") {
+            read_texture_info(r, mtl.normalTexture);
+        } else if (key == "occlusionTexture") {
+            read_texture_info(r, mtl.occlusionTexture);
+        } else if (key == "emissiveTexture") {
+            read_texture_info(r, mtl.emissiveTexture);
+        } else if (key == "emissiveFactor") {
+            r.read(mtl.emissiveFactor);
+        } else if (key == "alphaMode") {
+            r.read(mtl.alphaMode);
+        } else if (key == "alphaCutoff") {
+            r.read(mtl.alphaCutoff);
+        } else if (key == "doubleSided") {
+            r.read(mtl.doubleSided);
+        } else if (key == "name") {
+            r.read(mtl.name);
+        } else if (key == "extensions") {
+            read_extensions(r, mtl.extensions);
+        } else {
+            r.skip();
+        }
+    });
+}
+
+void read_texture(JsonReader &r, tinygltf::Texture &tex) {
+    r.object([&r, &tex](std::string_view key) {
+        if (key == "source") {
+            r.read(tex.source);
+        } else if (key == "sampler") {
+            r.read(tex.sampler);
+        } else if (key == "name") {
+            r.read(tex.name);
+        } else if (key == "extensions") {
+            read_extensions(r, tex.extensions);
+        } else {
+            r.skip();
+        }
+    });
+}
+
+void read_sampler(JsonReader &r, tinygltf::Sampler &sampler) {
+    r.object([&r, &sampler](std::string_view key) {
+        if (key == "minFilter") {
+            r.read(sampler.minFilter);
+        } else if (key == "magFilter") {
+            r.read(sampler.magFilter);
+        } else if (key == "wrapS") {
+            r.read(sampler.wrapS);
+        } else if (key == "wrapT") {
+            r.read(sampler.wrapT);
+        } else if (key == "name") {
+            r.read(sampler.name);
+        } else {
+            r.skip();
+        }
+    });
+}
+
+void read_image(JsonReader &r, tinygltf::Image &img) {
+    r.object([&r, &img](std::string_view key) {
+        if (key == "uri") {
+            r.read(img.uri);
+        } else if (key == "bufferView") {
+            r.read(img.bufferView);
+        } else if (key == "mimeType") {
+            r.read(img.mimeType);
+        } else if (key == "name") {
+            r.read(img.name);
+        } else {
+            r.skip();
+        }
+    });
+}
+
+// buffers are loaded after parsing, with the sizes they have in the file
+void read_model(JsonReader &r, tinygltf::Model &model, std::vector<size_t> &buffer_sizes) {
+    r.object([&r, &model, &buffer_sizes](std::string_view key) {
+        if (key == "accessors") {
+            read_objects(r, model.accessors, read_accessor);
+        } else if (key == "bufferViews") {
+            read_objects(r, model.bufferViews, read_buffer_view);
+        } else if (key == "buffers") {
+            r.array([&r, &model, &buffer_sizes]() {
+                model.buffers.emplace_back();
+                buffer_sizes.push_back(0);
+                read_buffer(r, model.buffers.back(), buffer_sizes.back());
+            });
+        } else if (key == "meshes") {
+            read_objects(r, model.meshes, read_mesh);
+        } else if (key == "nodes") {
+            read_objects(r, model.nodes, read_node);
+        } else if (key == "scenes") {
+            read_objects(r, model.scenes, read_scene);
+        } else if (key == "scene") {
+            r.read(model.defaultScene);
+        } else if (key == "materials") {
+            read_objects(r, model.materials, read_material);
+        } else if (key == "textures") {
+            read_objects(r, model.textures, read_texture);
+        } else if (key == "samplers") {
+            read_objects(r, model.samplers, read_sampler);
+        } else if (key == "images") {
+            read_objects(r, model.images, read_image);
+        } else if (key == "extensionsUsed") {
+            r.read(model.extensionsUsed);
+        } else if (key == "extensionsRequired") {
+            r.read(model.extensionsRequired);
+        } else {
+            r.skip();
+        }
+    });
+}
+
+// external files
+
+bool read_file(const std::string &filename, std::vector<unsigned char> &data) {
+    FILE *f = fopen(filename.c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    data.resize(size > 0 ? size_t(size) : 0);
+    const bool ok = size >= 0 && fread(data.data(), 1, data.size(), f) == data.size();
+    fclose(f);
+    return ok;
+}
+
+// uris are percent-encoded
+std::string uri_path(const std::string &directory, const std::string &uri) {
+    std::string path = directory;
+    for (size_t i = 0; i < uri.size(); i++) {
+        if (uri[i] == '%' && i + 2 < uri.size() && isxdigit(uri[i + 1]) && isxdigit(uri[i + 2])) {
+            const char hex[3] = {uri[i + 1], uri[i + 2], '\0'};
+            path += char(strtol(hex, nullptr, 16));
+            i += 2;
+        } else {
+            path += uri[i];
+        }
+    }
+    return path;
+}
+
+bool load_buffer(const std::string &directory, int index, size_t size, tinygltf::Buffer &buffer) {
+    if (buffer.uri.empty()) {
+        // the fallback buffer of EXT_meshopt_compression has no data, its views are decoded from another buffer
+        auto ext = buffer.extensions.find("EXT_meshopt_compression");
+        if (ext != buffer.extensions.end() && ext->second.Has("fallback") && ext->second.Get("fallback").IsBool() &&
+            ext->second.Get("fallback").Get<bool>()) {
+            return true;
+        }
+        log_error("gltf reader: buffer %d has no uri", index);
+        return false;
+    }
+    if (tinygltf::IsDataURI(buffer.uri)) {
+        std::string mime_type;
+        if (!tinygltf::DecodeDataURI(&buffer.data, mime_type, buffer.uri, size, true)) {
+            log_error("gltf reader: invalid data uri in buffer %d", index);
+            return false;
+        }
+        return true;
+    }
+    const std::string path = uri_path(directory, buffer.uri);
+    if (!read_file(path, buffer.data)) {
+        log_error("gltf reader: unable to read buffer file '%s'", path.c_str());
+        return false;
+    }
+    if (buffer.data.size() < size) {
+        log_error("gltf reader: buffer file '%s' is smaller than its byte length (%zu < %zu)", path.c_str(),
+                  buffer.data.size(), size);
+        return false;
+    }
+    buffer.data.resize(size);
+    return true;
+}
+
+// missing images are not an error, the textures using them fall back to the default ones of the materials
+void load_image(const std::string &directory, tinygltf::Image &img) {
+    img.as_is = true;
+    if (img.bufferView >= 0 || img.uri.empty()) {
+        return;
+    }
+    if (tinygltf::IsDataURI(img.uri)) {
+        std::string mime_type;
+        if (!tinygltf::DecodeDataURI(&img.image, mime_type, img.uri, 0, false)) {
+            log_warning("gltf reader: invalid data uri in image '%s'", img.name.c_str());
+        }
+        img.mimeType = mime_type;
+        return;
+    }
+    const std::string path = uri_path(directory, img.uri);
+    if (!read_file(path, img.image)) {
+        log_warning("gltf reader: unable to read image file '%s'", path.c_str());
+        img.image.clear();
+    }
+}
+
+} // namespace
+
+namespace glengine {
+
+bool gltf_read(const char *filename, tinygltf::Model &model) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) {
+        log_error("gltf reader: unable to open '%s'", filename);
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    Arena arena;
+    char *text = arena.allocate(size_t(std::max(size, 0L)) + 1);
+    const bool read_ok = size >= 0 && fread(text, 1, size_t(size), f) == size_t(size);
+    fclose(f);
+    if (!read_ok) {
+        log_error("gltf reader: unable to read '%s'", filename);
+        return false;
+    }
+    text[size] = '\0';
+
+    model = tinygltf::Model();
+    JsonReader r(text, size_t(size), arena);
+    std::vector<size_t> buffer_sizes;
+    read_model(r, model, buffer_sizes);
+    if (!r.ok()) {
+        log_error("gltf reader: %s at line %d of '%s'", r.error(), r.line(), filename);
+        return false;
+    }
+
+    std::string directory = filename;
+    const size_t pos = directory.find_last_of("/\\");
+    directory = pos != std::string::npos ? directory.substr(0, pos + 1) : "";
+    for (int i = 0; i < int(model.buffers.size()); i++) {
+        if (!load_buffer(directory, i, buffer_sizes[i], model.buffers[i])) {
+            return false;
+        }
+    }
+    for (auto &img : model.images) {
+        load_image(directory, img);
+    }
+    return true;
+}
+
+} // namespace glengine
@@ -0,0 +1,18 @@
+#pragma once
+
+namespace tinygltf {
+class Model;
+} // namespace tinygltf
+
+namespace glengine {
+
+/// streaming reader of .gltf files, used instead of tinygltf for the ascii format. The json text is parsed in a
+/// single pass without building a document tree: the values are stored directly in the model, and only the parts
+/// used by the engine are read (scenes, nodes, meshes, accessors, buffers, buffer views, materials, textures,
+/// samplers and images). Animations, skins, cameras and extras are skipped. Strings point into the text, or into an
+/// arena when they have escape sequences, so parsing doesn't allocate memory besides the model itself.
+/// Buffers are loaded, and images are kept encoded, as done by the tinygltf loader with an image loader keeping the
+/// encoded data (Image::as_is). Returns false (and logs why) if the file can't be read or parsed
+bool gltf_read(const char *filename, tinygltf::Model &model);
+
+} // namespace glengine
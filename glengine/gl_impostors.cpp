@@ -0,0 +1,133 @@
+#include "gl_impostors.h"
+#include "gl_camera.h"
+#include "gl_engine.h"
+#include "gl_logger.h"
+#include "generated/shaders/impostors.glsl.h"
+
+#include <algorithm>
+#include <cstddef>
+
+namespace {
+
+// corners of a unit box as a triangle strip of 14 vertices, all its triangles clockwise seen from the outside
+const float box_strip[14][3] = {{0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {1, 1, 0}, {1, 1, 1}, {1, 0, 0}, {1, 0, 1},
+                                {0, 0, 0}, {0, 0, 1}, {0, 1, 0}, {0, 1, 1}, {1, 1, 1}, {0, 0, 1}, {1, 0, 1}};
+
+} // namespace
+
+namespace glengine {
+
+bool Impostors::init(GLEngine &eng) {
+    ResourceManager &rm = eng.resource_manager();
+    const float quad[] = {-1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f};
+    _quad = sg_make_buffer((sg_buffer_desc){.size = sizeof(quad), .data = SG_RANGE(quad), .label = "impostor-quad"});
+    _box = sg_make_buffer(
+        (sg_buffer_desc){.size = sizeof(box_strip), .data = SG_RANGE(box_strip), .label = "impostor-box"});
+
+    // the proxy geometry is in buffer 0, the instances in buffer 1
+    sg_pipeline_desc pip_desc = {0};
+    pip_desc.layout.buffers[1].stride = sizeof(SphereImpostor);
+    pip_desc.layout.buffers[1].step_func = SG_VERTEXSTEP_PER_INSTANCE;
+    pip_desc.layout.attrs[ATTR_vs_impostor_sphere_corner] = {.buffer_index = 0, .format = SG_VERTEXFORMAT_FLOAT2};
+    pip_desc.layout.attrs[ATTR_vs_impostor_sphere_center_radius] = {
+        .buffer_index = 1, .offset = offsetof(SphereImpostor, center), .format = SG_VERTEXFORMAT_FLOAT4};
+    pip_desc.layout.attrs[ATTR_vs_impostor_sphere_instance_color] = {
+        .buffer_index = 1, .offset = offsetof(SphereImpostor, color), .format = SG_VERTEXFORMAT_UBYTE4N};
+    pip_desc.shader = rm.get_or_create_shader(*impostor_sphere_shader_desc(sg_query_backend()));
+    pip_desc.primitive_type = SG_PRIMITIVETYPE_TRIANGLE_STRIP;
+    pip_desc.depth = {.pixel_format = SG_PIXELFORMAT_DEPTH_STENCIL,
+                      .compare = SG_COMPAREFUNC_LESS_EQUAL,
+                      .write_enabled = true};
+    pip_desc.color_count = eng._config.use_mrt ? 3 : 1;
+    pip_desc.sample_count = sg_query_features().msaa_render_targets ? eng._config.msaa_samples : 1;
+    pip_desc.label = "sphere impostors pipeline";
+    _sphere_pip = rm.get_or_create_pipeline(pip_desc);
+
+    pip_desc.layout = {};
+    pip_desc.layout.buffers[1].stride = sizeof(CylinderImpostor);
+    pip_desc.layout.buffers[1].step_func = SG_VERTEXSTEP_PER_INSTANCE;
+    pip_desc.layout.attrs[ATTR_vs_impostor_cylinder_corner] = {.buffer_index = 0, .format = SG_VERTEXFORMAT_FLOAT3};
+    pip_desc.layout.attrs[ATTR_vs_impostor_cylinder_a_radius] = {
+        .buffer_index = 1, .offset = offsetof(CylinderImpostor, a), .format = SG_VERTEXFORMAT_FLOAT4};
+    pip_desc.layout.attrs[ATTR_vs_impostor_cylinder_b_pos] = {
+        .buffer_index = 1, .offset = offsetof(CylinderImpostor, b), .format = SG_VERTEXFORMAT_FLOAT3};
+    pip_desc.layout.attrs[ATTR_vs_impostor_cylinder_instance_color] = {
+        .buffer_index = 1, .offset = offsetof(CylinderImpostor, color), .format = SG_VERTEXFORMAT_UBYTE4N};
+    pip_desc.shader = rm.get_or_create_shader(*impostor_cylinder_shader_desc(sg_query_backend()));
+    // only the back faces of the boxes, the ray casting gives the front surface
+    pip_desc.cull_mode = SG_CULLMODE_FRONT;
+    pip_desc.face_winding = SG_FACEWINDING_CW;
+    pip_desc.label = "cylinder impostors pipeline";
+    _cylinder_pip = rm.get_or_create_pipeline(pip_desc);
+    return _sphere_pip.id != SG_INVALID_ID && _cylinder_pip.id != SG_INVALID_ID;
+}
+
+void Impostors::terminate() {
+    for (sg_buffer buffer : {_quad, _box, _spheres, _cylinders}) {
+        sg_destroy_buffer(buffer);
+    }
+    _quad = _box = _spheres = _cylinders = {SG_INVALID_ID};
+    _sphere_capacity = _cylinder_capacity = 0;
+    _stats = ImpostorStats();
+}
+
+void Impostors::upload(sg_buffer &buffer, uint32_t &capacity, const void *data, uint32_t count, uint32_t stride,
+                       const char *label) {
+    if (count == 0) {
+        return;
+    }
+    if (count > capacity) {
+        uint32_t new_capacity = std::max<uint32_t>(capacity, 1024);
+        while (new_capacity < count) {
+            new_capacity *= 2;
+        }
+        sg_destroy_buffer(buffer);
+        buffer = sg_make_buffer((sg_buffer_desc){.size = size_t(new_capacity) * stride,
+                                                 .type = SG_BUFFERTYPE_VERTEXBUFFER,
+                                                 .usage = SG_USAGE_DYNAMIC,
+                                                 .label = label});
+        capacity = new_capacity;
+        log_debug("impostors: %u instances buffer (%s)", new_capacity, label);
+    }
+    sg_update_buffer(buffer, {data, size_t(count) * stride});
+}
+
+void Impostors::update() {
+    _stats.num_spheres = uint32_t(spheres.size());
+    _stats.num_cylinders = uint32_t(cylinders.size());
+    _stats.num_vertices = uint64_t(_stats.num_spheres) * 4 + uint64_t(_stats.num_cylinders) * 14;
+    upload(_spheres, _sphere_capacity, spheres.data(), _stats.num_spheres, sizeof(SphereImpostor),
+           "impostor-spheres");
+    upload(_cylinders, _cylinder_capacity, cylinders.data(), _stats.num_cylinders, sizeof(CylinderImpostor),
+           "impostor-cylinders");
+}
+
+void Impostors::draw(const Camera &cam) {
+    _stats.num_draws = 0;
+    const math::Matrix4f &proj = cam.projection();
+    const bool perspective = proj(3, 2) != 0.0f;
+    const math::Vector3f light = cam.inverse_transform() * light_pos;
+    impostor_params_t params = {.view = cam.inverse_transform(),
+                                .projection = proj,
+                                .light_pos = {light.x, light.y, light.z, 1.0f},
+                                .options = {perspective ? 1.0f : 0.0f, cam.near_plane() * 1.001f, 0.0f, 0.0f}};
+    auto draw_instances = [&](sg_pipeline pip, sg_buffer geometry, sg_buffer instances, int num_vertices,
+                              uint32_t count) {
+        if (count == 0) {
+            return;
+        }
+        sg_apply_pipeline(pip);
+        sg_bindings bind = {0};
+        bind.vertex_buffers[0] = geometry;
+        bind.vertex_buffers[1] = instances;
+        sg_apply_bindings(bind);
+        sg_apply_uniforms(SG_SHADERSTAGE_VS, SLOT_impostor_params, SG_RANGE(params));
+        sg_apply_uniforms(SG_SHADERSTAGE_FS, SLOT_impostor_params, SG_RANGE(params));
+        sg_draw(0, num_vertices, int(count));
+        _stats.num_draws++;
+    };
+    draw_instances(_sphere_pip, _quad, _spheres, 4, _stats.num_spheres);
+    draw_instances(_cylinder_pip, _box, _cylinders, 14, _stats.num_cylinders);
+}
+
+} // namespace glengine
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "gl_types.h"
+#include "math/vmath.h"
+
+#include "sokol_gfx.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace glengine {
+
+class Camera;
+class GLEngine;
+
+struct SphereImpostor {
+    math::Vector3f center;
+    float radius;
+    Color color;
+};
+
+/// cylinder from a to b, with flat caps
+struct CylinderImpostor {
+    math::Vector3f a;
+    float radius;
+    math::Vector3f b;
+    Color color;
+};
+
+struct ImpostorStats {
+    uint32_t num_spheres = 0;   ///< uploaded by the last update
+    uint32_t num_cylinders = 0;
+    uint64_t num_vertices = 0;  ///< per frame, 4 per sphere and 14 per cylinder
+    uint32_t num_draws = 0;     ///< of the last frame
+};
+
+/// analytic spheres and capped cylinders (i.e. atoms and bonds, particles, graph nodes and edges), instead of
+/// tessellated meshes: each sphere is a quad facing the camera and each cylinder a box, instanced with a single draw
+/// call per shape, and ray cast in the fragment shader. The fragments get the exact depth and normal of the surface,
+/// so impostors intersect with the rest of the scene and are shaded, and seen by the ssao, like meshes with the
+/// diffuse material. The instances are in world space and retained: update() has to be called after changing them,
+/// and draw() in the offscreen pass (see GLEngine::add_draw_function). A sphere takes 4 vertices and 2 triangles,
+/// against 231 vertices and 360 triangles for create_sphere_data at subdiv 10: about 58 times fewer vertices and 180
+/// times fewer triangles, the cost moves to the fragments covered by the quads
+class Impostors {
+  public:
+    bool init(GLEngine &eng);
+    void terminate();
+
+    /// upload the instances, has to be called outside of the passes, at most once per frame
+    void update();
+    /// draw the uploaded instances in the current pass
+    void draw(const Camera &cam);
+
+    const ImpostorStats &stats() const { return _stats; }
+
+    std::vector<SphereImpostor> spheres;
+    std::vector<CylinderImpostor> cylinders;
+    math::Vector3f light_pos = {100.0f, 100.0f, 100.0f}; ///< in world space, as the one of the diffuse material
+
+  private:
+    /// buffer of the instances, it only grows to the next power of two
+    void upload(sg_buffer &buffer, uint32_t &capacity, const void *data, uint32_t count, uint32_t stride,
+                const char *label);
+
+    sg_pipeline _sphere_pip = {SG_INVALID_ID};
+    sg_pipeline _cylinder_pip = {SG_INVALID_ID};
+    sg_buffer _quad = {SG_INVALID_ID};
+    sg_buffer _box = {SG_INVALID_ID};
+    sg_buffer _spheres = {SG_INVALID_ID};
+    sg_buffer _cylinders = {SG_INVALID_ID};
+    uint32_t _sphere_capacity = 0;
+    uint32_t _cylinder_capacity = 0;
+    ImpostorStats _stats;
+};
+
+} // namespace glengine
@@ -0,0 +1,66 @@
+#include "gl_infinite_grid.h"
+#include "gl_camera.h"
+#include "gl_engine.h"
+#include "generated/shaders/infinite_grid.glsl.h"
+
+namespace {
+
+math::Vector4f to_vec4(glengine::Color c) {
+    return {c.r / 255.0f, c.g / 255.0f, c.b / 255.0f, c.a / 255.0f};
+}
+
+} // namespace
+
+namespace glengine {
+
+bool InfiniteGrid::init(GLEngine &eng) {
+    ResourceManager &rm = eng.resource_manager();
+    const float quad[] = {-1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f};
+    _quad = sg_make_buffer((sg_buffer_desc){.size = sizeof(quad), .data = SG_RANGE(quad), .label = "grid-quad"});
+
+    sg_pipeline_desc pip_desc = {0};
+    pip_desc.layout.attrs[ATTR_vs_infinite_grid_corner].format = SG_VERTEXFORMAT_FLOAT2;
+    pip_desc.shader = rm.get_or_create_shader(*infinite_grid_shader_desc(sg_query_backend()));
+    pip_desc.primitive_type = SG_PRIMITIVETYPE_TRIANGLE_STRIP;
+    // the depth is tested but not written, the lines are blended over the scene
+    pip_desc.depth = {.pixel_format = SG_PIXELFORMAT_DEPTH_STENCIL, .compare = SG_COMPAREFUNC_LESS_EQUAL};
+    pip_desc.color_count = eng._config.use_mrt ? 3 : 1;
+    pip_desc.colors[0].blend = {.enabled = true,
+                                .src_factor_rgb = SG_BLENDFACTOR_SRC_ALPHA,
+                                .dst_factor_rgb = SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA};
+    // normals and depth are left to the scene, for the ssao
+    pip_desc.colors[1].write_mask = SG_COLORMASK_NONE;
+    pip_desc.colors[2].write_mask = SG_COLORMASK_NONE;
+    pip_desc.sample_count = sg_query_features().msaa_render_targets ? eng._config.msaa_samples : 1;
+    pip_desc.label = "infinite grid pipeline";
+    _pip = rm.get_or_create_pipeline(pip_desc);
+    return _pip.id != SG_INVALID_ID;
+}
+
+void InfiniteGrid::terminate() {
+    sg_destroy_buffer(_quad);
+    _quad = {SG_INVALID_ID};
+}
+
+void InfiniteGrid::draw(const Camera &cam) {
+    if (!enabled || step <= 0.0f) {
+        return;
+    }
+    const math::Matrix4f view_projection = cam.projection() * cam.inverse_transform();
+    infinite_grid_params_t params = {.view_projection = view_projection,
+                                     .inv_view_projection = math::inverse(view_projection),
+                                     .minor_color = to_vec4(minor_color),
+                                     .major_color = to_vec4(major_color),
+                                     .x_axis_color = to_vec4(x_axis_color),
+                                     .y_axis_color = to_vec4(y_axis_color),
+                                     .options = {step, float(major_every), line_width, height}};
+    sg_apply_pipeline(_pip);
+    sg_bindings bind = {0};
+    bind.vertex_buffers[0] = _quad;
+    sg_apply_bindings(bind);
+    sg_apply_uniforms(SG_SHADERSTAGE_VS, SLOT_infinite_grid_params, SG_RANGE(params));
+    sg_apply_uniforms(SG_SHADERSTAGE_FS, SLOT_infinite_grid_params, SG_RANGE(params));
+    sg_draw(0, 4, 1);
+}
+
+} // namespace glengine
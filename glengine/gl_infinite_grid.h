@@ -0,0 +1,41 @@
+#pragma once
+
+#include "gl_types.h"
+
+#include "sokol_gfx.h"
+
+namespace glengine {
+
+class Camera;
+class GLEngine;
+
+/// procedural grid on a horizontal plane (see GLEngine::grid), in place of a lines mesh from create_grid_data: a
+/// fullscreen quad is ray cast against the plane, and the lines are anti-aliased from the screen space derivatives, so
+/// it has no extent and costs a single draw call of 4 vertices. The minor lines fade out when they get denser than a
+/// few pixels. The grid is depth tested against the scene with the depth of the plane, and writes no depth. It is
+/// blended on the color target only, it is not seen by the ssao
+class InfiniteGrid {
+  public:
+    bool init(GLEngine &eng);
+    void terminate();
+
+    /// draw the grid in the current pass, after the opaque objects
+    void draw(const Camera &cam);
+
+    bool enabled = false;
+    float step = 1.0f;       ///< between the minor lines
+    int major_every = 5;     ///< every how many minor lines there is a major one
+    float line_width = 1.0f; ///< in pixels
+    float height = 0.0f;     ///< z of the plane
+    // same colors as create_grid_data
+    Color minor_color = {40, 40, 40, 255};
+    Color major_color = {70, 70, 70, 255};
+    Color x_axis_color = {120, 20, 20, 255};
+    Color y_axis_color = {20, 120, 20, 255};
+
+  private:
+    sg_pipeline _pip = {SG_INVALID_ID};
+    sg_buffer _quad = {SG_INVALID_ID};
+};
+
+} // namespace glengine
@@ -19,6 +19,12 @@ class Material {
 
     virtual void apply_uniforms(const common_uniform_params_t &params) {}
 
+    /// pipeline for meshes with the given vertex layout, instanced pipelines read the per-instance transforms from
+    /// vertex buffer 1 (see Renderable::set_instances). Returns an invalid pipeline for unsupported variants
+    virtual sg_pipeline pipeline(VertexLayout layout, bool instanced) const {
+        return layout == VertexLayout::Default && !instanced ? pip : sg_pipeline{SG_INVALID_ID};
+    }
+
     template <typename T>
         T* as() { return this; }
 
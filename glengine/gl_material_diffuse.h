@@ -37,6 +37,31 @@ class MaterialDiffuseTextured : public Material {
     virtual void apply_uniforms(const common_uniform_params_t &params) override;
 
     sg_image tex_diffuse = {0};
+    /// placement of the texture when tex_diffuse is an atlas: offset (x,y) and scale (z,w) of the uvs. The uvs repeat
+    /// within the rect (see TextureAtlas::uv_rects)
+    math::Vector4f uv_rect = {0.0f, 0.0f, 1.0f, 1.0f};
+};
+
+/// textured diffuse material sampling one layer of a texture array: materials using the same array share their
+/// image binding, and only differ by uniforms
+class MaterialDiffuseTextureArray : public Material {
+  public:
+    MaterialDiffuseTextureArray()
+    : Material() {
+        color = {255, 255, 255, 255};
+    }
+    virtual ~MaterialDiffuseTextureArray() = default;
+
+    virtual bool init(GLEngine &eng, sg_primitive_type primitive,
+                      sg_index_type idx_type = SG_INDEXTYPE_NONE) override;
+
+    virtual void update_bindings(sg_bindings &bind) override;
+
+    virtual void apply_uniforms(const common_uniform_params_t &params) override;
+
+    sg_image tex_diffuse_array = {0};
+    uint32_t layer = 0;
+    math::Vector4f uv_rect = {0.0f, 0.0f, 1.0f, 1.0f};
 };
 
 } // namespace glengine
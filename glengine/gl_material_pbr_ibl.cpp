@@ -24,27 +24,57 @@ namespace glengine {
 bool MaterialPBRIBL::init(GLEngine &eng, sg_primitive_type primitive, sg_index_type idx_type) {
     ResourceManager &rm = eng.resource_manager();
     sg_shader offscreen_vertexcolor = rm.get_or_create_shader(*offscreen_pbr_ibl_shader_desc(sg_query_backend()));
+    sg_shader offscreen_instanced =
+        rm.get_or_create_shader(*offscreen_pbr_ibl_instanced_shader_desc(sg_query_backend()));
 
     const int offscreen_sample_count = sg_query_features().msaa_render_targets ? eng._config.msaa_samples : 1;
-    sg_pipeline_desc pip_desc = {0};
-    pip_desc.layout.buffers[0].stride = sizeof(Vertex);
-    pip_desc.layout.attrs[ATTR_vs_pbr_ibl_a_Position].format = SG_VERTEXFORMAT_FLOAT3;
-    pip_desc.layout.attrs[ATTR_vs_pbr_ibl_a_Color].format = SG_VERTEXFORMAT_UBYTE4N;
-    pip_desc.layout.attrs[ATTR_vs_pbr_ibl_a_Normal].format = SG_VERTEXFORMAT_FLOAT3;
-    pip_desc.layout.attrs[ATTR_vs_pbr_ibl_a_UV1].format = SG_VERTEXFORMAT_FLOAT2;
-    pip_desc.layout.attrs[ATTR_vs_pbr_ibl_a_Tangent].format = SG_VERTEXFORMAT_FLOAT3;
-    pip_desc.shader = offscreen_vertexcolor, pip_desc.primitive_type = primitive, pip_desc.index_type = idx_type;
-    pip_desc.depth = {.pixel_format = SG_PIXELFORMAT_DEPTH_STENCIL, .compare = SG_COMPAREFUNC_LESS_EQUAL, .write_enabled = true};
-    if (eng._config.use_mrt) {
-        pip_desc.color_count = 3;
-    } else { // only 1 color attachment
-        pip_desc.color_count = 1;
+    for (VertexLayout layout : {VertexLayout::Default, VertexLayout::Quantized}) {
+        for (bool instanced : {false, true}) {
+            // both shaders have the same vertex attributes slots, the instanced one adds the transform rows
+            sg_pipeline_desc pip_desc = {0};
+            if (layout == VertexLayout::Default) {
+                pip_desc.layout.buffers[0].stride = sizeof(Vertex);
+                pip_desc.layout.attrs[ATTR_vs_pbr_ibl_a_Position].format = SG_VERTEXFORMAT_FLOAT3;
+                pip_desc.layout.attrs[ATTR_vs_pbr_ibl_a_Color].format = SG_VERTEXFORMAT_UBYTE4N;
+                pip_desc.layout.attrs[ATTR_vs_pbr_ibl_a_Normal].format = SG_VERTEXFORMAT_FLOAT3;
+                pip_desc.layout.attrs[ATTR_vs_pbr_ibl_a_UV1].format = SG_VERTEXFORMAT_FLOAT2;
+                pip_desc.layout.attrs[ATTR_vs_pbr_ibl_a_Tangent].format = SG_VERTEXFORMAT_FLOAT3;
+            } else {
+                pip_desc.layout.buffers[0].stride = sizeof(QuantizedVertex);
+                pip_desc.layout.attrs[ATTR_vs_pbr_ibl_a_Position].format = SG_VERTEXFORMAT_SHORT4N;
+                pip_desc.layout.attrs[ATTR_vs_pbr_ibl_a_Color].format = SG_VERTEXFORMAT_UBYTE4N;
+                pip_desc.layout.attrs[ATTR_vs_pbr_ibl_a_Normal].format = SG_VERTEXFORMAT_BYTE4N;
+                pip_desc.layout.attrs[ATTR_vs_pbr_ibl_a_UV1].format = SG_VERTEXFORMAT_USHORT2N;
+                pip_desc.layout.attrs[ATTR_vs_pbr_ibl_a_Tangent].format = SG_VERTEXFORMAT_BYTE4N;
+            }
+            if (instanced) {
+                pip_desc.layout.buffers[1].stride = 3 * sizeof(math::Vector4f);
+                pip_desc.layout.buffers[1].step_func = SG_VERTEXSTEP_PER_INSTANCE;
+                const int rows[3] = {ATTR_vs_pbr_ibl_instanced_a_InstanceRow0, ATTR_vs_pbr_ibl_instanced_a_InstanceRow1,
+                                     ATTR_vs_pbr_ibl_instanced_a_InstanceRow2};
+                for (int r = 0; r < 3; r++) {
+                    pip_desc.layout.attrs[rows[r]].format = SG_VERTEXFORMAT_FLOAT4;
+                    pip_desc.layout.attrs[rows[r]].buffer_index = 1;
+                }
+            }
+            pip_desc.shader = instanced ? offscreen_instanced : offscreen_vertexcolor;
+            pip_desc.primitive_type = primitive, pip_desc.index_type = idx_type;
+            pip_desc.depth = {.pixel_format = SG_PIXELFORMAT_DEPTH_STENCIL,
+                              .compare = SG_COMPAREFUNC_LESS_EQUAL,
+                              .write_enabled = true};
+            if (eng._config.use_mrt) {
+                pip_desc.color_count = 3;
+            } else { // only 1 color attachment
+                pip_desc.color_count = 1;
+            }
+            pip_desc.cull_mode = SG_CULLMODE_NONE;
+            pip_desc.face_winding = SG_FACEWINDING_CCW;
+            pip_desc.sample_count = offscreen_sample_count;
+            pip_desc.label = "PBR pipeline";
+            _pipelines[int(layout)][instanced ? 1 : 0] = rm.get_or_create_pipeline(pip_desc);
+        }
     }
-    pip_desc.cull_mode = SG_CULLMODE_NONE;
-    pip_desc.face_winding = SG_FACEWINDING_CCW;
-    pip_desc.sample_count = offscreen_sample_count;
-    pip_desc.label = "PBR pipeline";
-    pip = rm.get_or_create_pipeline(pip_desc);
+    pip = _pipelines[int(VertexLayout::Default)][0];
     // placeholder textures
     if (!have_placeholders) {
         placeholders.lut = rm.get_or_create_image("../resources/textures/lut_ggx.png");
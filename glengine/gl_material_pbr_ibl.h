@@ -23,6 +23,10 @@ class MaterialPBRIBL : public Material {
 
     virtual void apply_uniforms(const common_uniform_params_t &params) override;
 
+    /// all the layouts are supported, with and without instancing
+    virtual sg_pipeline pipeline(VertexLayout layout, bool instanced) const override {
+        return _pipelines[int(layout)][instanced ? 1 : 0];
+    }
 
     math::Vector3f emissive_factor = {0.0f,0.0f,0.0f};
     float metallic_factor = 1.0f;
@@ -32,6 +36,9 @@ class MaterialPBRIBL : public Material {
     sg_image tex_normal = {0};
     sg_image tex_occlusion = {0};
     sg_image tex_emissive = {0};
+
+  private:
+    sg_pipeline _pipelines[2][2] = {}; ///< by vertex layout, and instancing
 };
 
 } // namespace glengine
@@ -2,10 +2,12 @@
 
 // #include "gl_context.h"
 #include "gl_types.h"
+#include "gl_upload_queue.h"
 
 // #include "gl_shader.h"
 // #include "gl_texture.h"
 
+#include <algorithm>
 #include <vector>
 
 namespace glengine {
@@ -18,35 +20,148 @@ bool Mesh::init(const std::vector<Vertex> &vertices_, const std::vector<uint32_t
     return true;
 }
 
+bool Mesh::init(const std::vector<QuantizedVertex> &vertices_, const std::vector<uint32_t> &indices_,
+                const math::Matrix4f &dequantization_, sg_usage usage) {
+    vertices.clear();
+    quantized_vertices = vertices_;
+    indices = indices_;
+    dequantization = dequantization_;
+    layout = VertexLayout::Quantized;
+    _usage = usage;
+    setup_mesh();
+    return true;
+}
+
+math::Vector3f Mesh::position(size_t i) const {
+    if (layout == VertexLayout::Quantized) {
+        const int16_t *p = quantized_vertices[i].pos;
+        // same conversion as the SHORT4N vertex format
+        auto snorm = [](int16_t v) { return std::max(v / 32767.0f, -1.0f); };
+        return dequantization * math::Vector3f{snorm(p[0]), snorm(p[1]), snorm(p[2])};
+    }
+    return vertices[i].pos;
+}
+
+void Mesh::set_lods(const std::vector<MeshLod> &lods_) {
+    lods = lods_;
+    const size_t n = num_vertices();
+    math::Vector3f lo = n > 0 ? position(0) : math::Vector3f{0.0f, 0.0f, 0.0f}, hi = lo;
+    for (size_t i = 1; i < n; i++) {
+        const math::Vector3f p = position(i);
+        for (int c = 0; c < 3; c++) {
+            lo[c] = std::min(lo[c], p[c]);
+            hi[c] = std::max(hi[c], p[c]);
+        }
+    }
+    const math::Vector3f center = (lo + hi) * 0.5f;
+    float radius = 0.0f;
+    for (size_t i = 0; i < n; i++) {
+        radius = std::max(radius, math::length(position(i) - center));
+    }
+    bounding_sphere = {center.x, center.y, center.z, radius};
+}
+
+void Mesh::set_meshlets(const std::vector<Meshlet> &meshlets_) {
+    meshlets = meshlets_;
+    const size_t stride = meshlet_stride();
+    meshlet_bounds.assign(stride * 8, 0.0f);
+    for (size_t i = 0; i < meshlets.size(); i++) {
+        const Meshlet &m = meshlets[i];
+        const float bounds[8] = {m.center.x,    m.center.y,    m.center.z,    m.radius,
+                                 m.cone_axis.x, m.cone_axis.y, m.cone_axis.z, m.cone_cutoff};
+        for (size_t s = 0; s < 8; s++) {
+            meshlet_bounds[s * stride + i] = bounds[s];
+        }
+    }
+}
+
+sg_range Mesh::vertex_data() const {
+    if (layout == VertexLayout::Quantized) {
+        return {quantized_vertices.data(), quantized_vertices.size() * sizeof(QuantizedVertex)};
+    }
+    return {vertices.data(), vertices.size() * sizeof(Vertex)};
+}
+
+size_t Mesh::vertex_stride() const {
+    return layout == VertexLayout::Quantized ? sizeof(QuantizedVertex) : sizeof(Vertex);
+}
+
+void Mesh::mark_dirty(size_t first, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    if (!_marked || _dirty_begin == _dirty_end) {
+        _dirty_begin = first;
+        _dirty_end = first + count;
+    } else {
+        _dirty_begin = std::min(_dirty_begin, first);
+        _dirty_end = std::max(_dirty_end, first + count);
+    }
+    _marked = true;
+}
+
+void Mesh::mark_indices_dirty() {
+    if (!_marked) {
+        _dirty_begin = _dirty_end = 0;
+    }
+    _marked = true;
+    _indices_dirty = true;
+}
+
+void Mesh::append(const Vertex *vertices_, size_t count) {
+    mark_dirty(vertices.size(), count);
+    vertices.insert(vertices.end(), vertices_, vertices_ + count);
+}
+
+sg_buffer Mesh::make_buffer(const sg_buffer_desc &desc) {
+    return upload_queue ? upload_queue->make_buffer(desc) : sg_make_buffer(desc);
+}
+
+void Mesh::update_buffer(sg_buffer buf, const sg_range &data) {
+    if (upload_queue) {
+        upload_queue->update_buffer(buf, data);
+    } else {
+        sg_update_buffer(buf, data);
+    }
+}
+
 void Mesh::setup_mesh() {
-    vbuf_size = vertices.size() * sizeof(Vertex);
+    _marked = false;
+    _indices_dirty = false;
+    if (page_size > 0 && _usage != SG_USAGE_IMMUTABLE && indices.empty()) {
+        _uploaded_vertices = 0;
+        update_pages();
+        return;
+    }
+    const sg_range vdata = vertex_data();
+    vbuf_size = vdata.size;
     ibuf_size = indices.size() * sizeof(uint32_t);
     if (_usage == SG_USAGE_IMMUTABLE) {
         // init with info and content
-        vbuf = sg_make_buffer((sg_buffer_desc){.size = vbuf_size,
-                                               .type = SG_BUFFERTYPE_VERTEXBUFFER,
-                                               .usage = _usage,
-                                               .data = {vertices.data(), vbuf_size},
-                                               .label = "mesh-vertices"});
+        vbuf = make_buffer((sg_buffer_desc){.size = vbuf_size,
+                                            .type = SG_BUFFERTYPE_VERTEXBUFFER,
+                                            .usage = _usage,
+                                            .data = vdata,
+                                            .label = "mesh-vertices"});
 
         if (indices.size() > 0) {
-            ibuf = sg_make_buffer((sg_buffer_desc){.size = ibuf_size,
-                                                   .type = SG_BUFFERTYPE_INDEXBUFFER,
-                                                   .usage = _usage,
-                                                   .data = {indices.data(), ibuf_size},
-                                                   .label = "mesh-indices"});
+            ibuf = make_buffer((sg_buffer_desc){.size = ibuf_size,
+                                                .type = SG_BUFFERTYPE_INDEXBUFFER,
+                                                .usage = _usage,
+                                                .data = {indices.data(), ibuf_size},
+                                                .label = "mesh-indices"});
         }
     } else { // dynamic and streaming mesh buffers have to be declared and initialized in 2 steps
-        vbuf = sg_make_buffer((sg_buffer_desc){.size = vbuf_size,
-                                               .type = SG_BUFFERTYPE_VERTEXBUFFER,
-                                               .usage = _usage,
-                                               .label = "mesh-vertices"});
+        vbuf = make_buffer((sg_buffer_desc){.size = vbuf_size,
+                                            .type = SG_BUFFERTYPE_VERTEXBUFFER,
+                                            .usage = _usage,
+                                            .label = "mesh-vertices"});
 
         if (indices.size() > 0) {
-            ibuf = sg_make_buffer((sg_buffer_desc){.size = ibuf_size,
-                                                   .type = SG_BUFFERTYPE_INDEXBUFFER,
-                                                   .usage = _usage,
-                                                   .label = "mesh-indices"});
+            ibuf = make_buffer((sg_buffer_desc){.size = ibuf_size,
+                                                .type = SG_BUFFERTYPE_INDEXBUFFER,
+                                                .usage = _usage,
+                                                .label = "mesh-indices"});
         }
         update_buffers();
     }
@@ -54,33 +169,129 @@ void Mesh::setup_mesh() {
 
 // update the data in the buffers. buffers have to be already allocated
 bool Mesh::update_buffers() {
+    if (paged()) {
+        update_pages();
+        return true;
+    }
+    // without marks everything is uploaded
+    bool vertices_dirty = !_marked || _dirty_begin < _dirty_end;
+    bool indices_dirty = !_marked || _indices_dirty;
+    _marked = false;
+    _indices_dirty = false;
     // in case the new data is bigger than the actual buffers, create a bigger one
-    uint32_t new_vbuf_size = vertices.size() * sizeof(Vertex);
+    const sg_range vdata = vertex_data();
+    uint32_t new_vbuf_size = vdata.size;
     uint32_t new_ibuf_size = indices.size() * sizeof(uint32_t);
     if (new_vbuf_size > vbuf_size) {
         sg_destroy_buffer(vbuf);
-        vbuf = sg_make_buffer((sg_buffer_desc){.size = new_vbuf_size,
-                                               .type = SG_BUFFERTYPE_VERTEXBUFFER,
-                                               .usage = _usage,
-                                               .label = "mesh-vertices"});
+        vbuf = make_buffer((sg_buffer_desc){.size = new_vbuf_size,
+                                            .type = SG_BUFFERTYPE_VERTEXBUFFER,
+                                            .usage = _usage,
+                                            .label = "mesh-vertices"});
         vbuf_size = new_vbuf_size;
+        vertices_dirty = true;
     }
     if (new_ibuf_size > ibuf_size) {
         sg_destroy_buffer(ibuf);
-        ibuf = sg_make_buffer((sg_buffer_desc){.size = new_ibuf_size,
-                                               .type = SG_BUFFERTYPE_INDEXBUFFER,
-                                               .usage = _usage,
-                                               .label = "mesh-vertices"});
+        ibuf = make_buffer((sg_buffer_desc){.size = new_ibuf_size,
+                                            .type = SG_BUFFERTYPE_INDEXBUFFER,
+                                            .usage = _usage,
+                                            .label = "mesh-vertices"});
         ibuf_size = new_ibuf_size;
+        indices_dirty = true;
     }
     // update_buffers content
-    sg_update_buffer(vbuf, {vertices.data(), vertices.size() * sizeof(Vertex)});
-    if (ibuf.id != SG_INVALID_ID) {
-        sg_update_buffer(ibuf, {indices.data(), indices.size() * sizeof(uint32_t)});
+    if (vertices_dirty) {
+        update_buffer(vbuf, vdata);
+    }
+    if (ibuf.id != SG_INVALID_ID && indices_dirty) {
+        update_buffer(ibuf, {indices.data(), indices.size() * sizeof(uint32_t)});
     }
     return true;
 }
 
+// upload the dirty pages, creating the missing ones, and compute the draw ranges
+void Mesh::update_pages() {
+    const size_t stride = vertex_stride();
+    const size_t n = num_vertices();
+    const size_t num_pages = std::max<size_t>((n + page_size - 1) / page_size, 1);
+    while (pages.size() < num_pages) {
+        pages.push_back(make_buffer((sg_buffer_desc){.size = (page_size + page_overlap) * stride,
+                                                     .type = SG_BUFFERTYPE_VERTEXBUFFER,
+                                                     .usage = _usage,
+                                                     .label = "mesh-page"}));
+    }
+    vbuf = pages[0];
+    vbuf_size = uint32_t(pages.size() * (page_size + page_overlap) * stride);
+    // a page holds its vertices followed by the overlap ones, those of the last page wrap around to the first vertices
+    const size_t last = num_pages - 1;
+    std::vector<bool> dirty(num_pages, !_marked);
+    auto mark = [&](size_t begin, size_t end) {
+        end = std::min(end, n);
+        if (begin >= end) {
+            return;
+        }
+        for (size_t p = begin / page_size; p <= (end - 1) / page_size; p++) {
+            dirty[p] = true;
+        }
+        if (begin % page_size < page_overlap && begin >= page_size) {
+            dirty[begin / page_size - 1] = true;
+        }
+        if (begin < page_overlap) {
+            dirty[last] = true;
+        }
+    };
+    mark(_dirty_begin, _dirty_end);
+    if (n != _uploaded_vertices) {
+        mark(std::min(n, _uploaded_vertices), n);
+        dirty[last] = true;
+    }
+    _marked = false;
+    _uploaded_vertices = n;
+    const uint8_t *src = (const uint8_t *)vertex_data().ptr;
+    auto page_count = [&](size_t p) { return p * page_size < n ? std::min<size_t>(page_size, n - p * page_size) : 0; };
+    for (size_t p = 0; p < num_pages; p++) {
+        if (!dirty[p] || n == 0) {
+            continue;
+        }
+        const size_t first = p * page_size;
+        const size_t count = page_count(p);
+        _page_data.assign(src + first * stride, src + (first + count) * stride);
+        for (size_t i = 0; i < page_overlap; i++) {
+            const uint8_t *v = src + (first + count + i) % n * stride;
+            _page_data.insert(_page_data.end(), v, v + stride);
+        }
+        update_buffer(pages[p], {_page_data.data(), _page_data.size()});
+    }
+
+    _draw_ranges.clear();
+    if (n == 0) {
+        return;
+    }
+    auto add = [&](size_t p, size_t first, size_t end) {
+        if (end > first) {
+            _draw_ranges.push_back({pages[p], uint32_t(first), uint32_t(end - first)});
+        }
+    };
+    const size_t start = draw_start < n ? draw_start : 0;
+    if (start == 0) {
+        for (size_t p = 0; p <= last; p++) {
+            add(p, 0, page_count(p) + (p < last ? page_overlap : 0));
+        }
+        return;
+    }
+    // from the start to the end, wrapping around (the overlap of the last page is the first vertex), and from the
+    // first vertex back to the start. The vertex before the start is the last one drawn
+    const size_t h = start / page_size;
+    const size_t offset = start % page_size;
+    add(h, offset, page_count(h) + page_overlap);
+    for (size_t i = 1; i < num_pages; i++) {
+        const size_t p = (h + i) % num_pages;
+        add(p, 0, page_count(p) + (i < last || offset > 0 ? page_overlap : 0));
+    }
+    add(h, 0, offset);
+}
+
 void Mesh::update_bindings(sg_bindings &bind) {
     bind.vertex_buffers[0] = vbuf;
     bind.index_buffer = ibuf;
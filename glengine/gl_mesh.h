@@ -8,6 +8,8 @@
 
 namespace glengine {
 
+class UploadQueue;
+
 /// Very simple mesh class, that can allocate and update the verted and (optionally) index data.
 /// The class is _completely passive_ so after updating the vertices or indices data you have to explicitly
 /// call the update() function.
@@ -16,23 +18,99 @@ class Mesh {
     // mesh data
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
+    // quantized mesh data (layout == VertexLayout::Quantized), vertices is empty
+    std::vector<QuantizedVertex> quantized_vertices;
+    math::Matrix4f dequantization = math::matrix4_identity<float>(); ///< from quantized positions to mesh space
+    VertexLayout layout = VertexLayout::Default;
+    /// levels of detail, ranges of the indices (see set_lods). Empty to draw all the indices
+    std::vector<MeshLod> lods;
+    /// center (xyz) and radius (w) of the vertices in mesh space, set with the levels of detail
+    math::Vector4f bounding_sphere = {0.0f, 0.0f, 0.0f, 0.0f};
+    /// clusters of the triangles of the full level, culled per frame (see set_meshlets and MeshletCuller). Empty to
+    /// draw the indices as they are
+    std::vector<Meshlet> meshlets;
+    /// bounds of the meshlets as 8 streams for the simd culling (center x, y, z, radius, cone axis x, y, z, cutoff),
+    /// each padded to a multiple of 8 meshlets
+    std::vector<float> meshlet_bounds;
 
     Mesh() = default;
 
     bool init(const std::vector<Vertex> &vertices_, const std::vector<uint32_t> &indices_ = {},
               sg_usage usage = SG_USAGE_IMMUTABLE);
+    /// quantized mesh, the dequantization transform has to be applied to the positions (see Object::draw)
+    bool init(const std::vector<QuantizedVertex> &vertices_, const std::vector<uint32_t> &indices_,
+              const math::Matrix4f &dequantization_, sg_usage usage = SG_USAGE_IMMUTABLE);
     // update the opengl buffers to reflect the vertices and indices arrays
     bool update_buffers();
+    /// mark vertices [first, first + count) as changed. Once something is marked, update_buffers() only uploads the
+    /// marked data: the pages holding the vertices for a paged mesh (the whole vertex buffer otherwise), and the
+    /// indices if marked too. Without marks, update_buffers() uploads everything
+    void mark_dirty(size_t first, size_t count);
+    void mark_indices_dirty();
+    /// add vertices at the end and mark them dirty
+    void append(const Vertex *vertices_, size_t count);
 
     void update_bindings(sg_bindings &bind);
 
+    size_t num_vertices() const {
+        return layout == VertexLayout::Quantized ? quantized_vertices.size() : vertices.size();
+    }
+    /// position of a vertex in mesh space, whatever the layout
+    math::Vector3f position(size_t i) const;
+    /// set the levels of detail, and the bounding sphere their screen size is measured with (see
+    /// Renderable::select_lod)
+    void set_lods(const std::vector<MeshLod> &lods_);
+    /// set the meshlets, and their bounds by streams
+    void set_meshlets(const std::vector<Meshlet> &meshlets_);
+    /// meshlets per stream of meshlet_bounds
+    size_t meshlet_stride() const { return (meshlets.size() + 7) & ~size_t(7); }
+
     sg_buffer vbuf = {0};
     sg_buffer ibuf = {SG_INVALID_ID};
     uint32_t   vbuf_size = 0;
     uint32_t   ibuf_size = 0;
     sg_usage _usage = SG_USAGE_IMMUTABLE;
 
+    // paged meshes
+    /// vertices per page, 0 for a single vertex buffer. Has to be set before init, and only applies to non-indexed
+    /// dynamic and streaming meshes: the vertices are split in pages with a buffer each, so that changing or appending
+    /// a few vertices only uploads their pages. Paged meshes are drawn with a draw call per page
+    uint32_t page_size = 0;
+    /// vertices repeated at the start of the next page, so that strips are continuous across pages (1 for line strips)
+    uint32_t page_overlap = 0;
+    /// first vertex drawn: vertices are drawn from there to the end, then from the start (see RingMesh). Only for
+    /// paged meshes
+    uint32_t draw_start = 0;
+    struct DrawRange {
+        sg_buffer buffer;
+        uint32_t first;
+        uint32_t count;
+    };
+    /// buffers of a paged mesh, vbuf is the first one
+    std::vector<sg_buffer> pages;
+    bool paged() const { return !pages.empty(); }
+    /// draw calls of a paged mesh, in order. Updated by update_buffers()
+    const std::vector<DrawRange> &draw_ranges() const { return _draw_ranges; }
+    /// per-instance transforms drawn with the mesh (see Renderable::set_instances), destroyed with it
+    std::vector<sg_buffer> instance_buffers;
+    /// buffers are created and updated through the queue when set (see GLEngine::Config::deferred_uploads)
+    UploadQueue *upload_queue = nullptr;
+
   private:
     void setup_mesh();
+    sg_buffer make_buffer(const sg_buffer_desc &desc);
+    void update_buffer(sg_buffer buf, const sg_range &data);
+    sg_range vertex_data() const;
+    size_t vertex_stride() const;
+    void update_pages();
+
+    // dirty data since the last update_buffers()
+    bool _marked = false;
+    size_t _dirty_begin = 0;
+    size_t _dirty_end = 0;
+    bool _indices_dirty = false;
+    size_t _uploaded_vertices = 0; ///< vertices of the last paged update
+    std::vector<uint8_t> _page_data;
+    std::vector<DrawRange> _draw_ranges;
 };
 } // namespace glengine
@@ -0,0 +1,210 @@
+#include "gl_mesh_optimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+namespace {
+
+constexpr int CACHE_SIZE = 32;
+
+// scores of the Forsyth algorithm: vertices recently used score high (the last three used slightly less, since
+// the triangle just emitted already used them), and vertices with few remaining triangles score high so that they
+// are not left behind
+struct VertexScoreTable {
+    float cache[CACHE_SIZE];
+    float valence[64];
+
+    VertexScoreTable() {
+        for (int i = 0; i < CACHE_SIZE; i++) {
+            cache[i] = i < 3 ? 0.75f : std::pow(1.0f - float(i - 3) / (CACHE_SIZE - 3), 1.5f);
+        }
+        valence[0] = 0.0f;
+        for (int i = 1; i < 64; i++) {
+            valence[i] = 2.0f / std::sqrt(float(i));
+        }
+    }
+};
+
+float vertex_score(const VertexScoreTable &table, int cache_position, uint32_t remaining) {
+    if (remaining == 0) {
+        return -1.0f;
+    }
+    const float cache_score = cache_position >= 0 ? table.cache[cache_position] : 0.0f;
+    return cache_score + table.valence[std::min(remaining, 63u)];
+}
+
+} // namespace
+
+namespace glengine {
+
+size_t deduplicate_vertices(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices) {
+    struct VertexHash {
+        size_t operator()(const Vertex &v) const {
+            const uint8_t *p = reinterpret_cast<const uint8_t *>(&v);
+            size_t h = 1469598103934665603ull;
+            for (size_t i = 0; i < sizeof(Vertex); i++) {
+                h = (h ^ p[i]) * 1099511628211ull;
+            }
+            return h;
+        }
+    };
+    struct VertexEqual {
+        bool operator()(const Vertex &a, const Vertex &b) const { return memcmp(&a, &b, sizeof(Vertex)) == 0; }
+    };
+    static_assert(sizeof(Vertex) == 48, "Vertex is expected to have no padding");
+    std::unordered_map<Vertex, uint32_t, VertexHash, VertexEqual> unique;
+    unique.reserve(vertices.size());
+    std::vector<uint32_t> remap(vertices.size());
+    std::vector<Vertex> result;
+    result.reserve(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        auto it = unique.emplace(vertices[i], uint32_t(result.size()));
+        if (it.second) {
+            result.push_back(vertices[i]);
+        }
+        remap[i] = it.first->second;
+    }
+    for (auto &idx : indices) {
+        idx = remap[idx];
+    }
+    vertices.swap(result);
+    return vertices.size();
+}
+
+void optimize_vertex_cache(uint32_t *indices, size_t index_count, size_t vertex_count) {
+    static const VertexScoreTable table;
+    const size_t num_triangles = index_count / 3;
+    if (num_triangles == 0) {
+        return;
+    }
+    // vertex -> triangles adjacency
+    std::vector<uint32_t> remaining(vertex_count, 0);
+    for (size_t i = 0; i < num_triangles * 3; i++) {
+        remaining[indices[i]]++;
+    }
+    std::vector<uint32_t> offsets(vertex_count + 1, 0);
+    for (size_t v = 0; v < vertex_count; v++) {
+        offsets[v + 1] = offsets[v] + remaining[v];
+    }
+    std::vector<uint32_t> adjacency(num_triangles * 3);
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t t = 0; t < num_triangles; t++) {
+        for (int k = 0; k < 3; k++) {
+            adjacency[fill[indices[t * 3 + k]]++] = uint32_t(t);
+        }
+    }
+    std::vector<int> cache_position(vertex_count, -1);
+    std::vector<float> score(vertex_count);
+    for (size_t v = 0; v < vertex_count; v++) {
+        score[v] = vertex_score(table, -1, remaining[v]);
+    }
+    std::vector<float> triangle_score(num_triangles);
+    std::vector<bool> emitted(num_triangles, false);
+    for (size_t t = 0; t < num_triangles; t++) {
+        triangle_score[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+    }
+    std::vector<uint32_t> output(num_triangles * 3);
+    uint32_t cache[CACHE_SIZE + 3];
+    int cache_count = 0;
+    size_t scan_cursor = 0;
+    int64_t best = -1;
+    for (size_t out = 0; out < num_triangles; out++) {
+        if (best < 0) {
+            // nothing adjacent to the cache: pick the best remaining triangle
+            float best_score = -1.0f;
+            for (; scan_cursor < num_triangles && emitted[scan_cursor]; scan_cursor++) {
+            }
+            for (size_t t = scan_cursor; t < num_triangles; t++) {
+                if (!emitted[t] && triangle_score[t] > best_score) {
+                    best_score = triangle_score[t];
+                    best = int64_t(t);
+                }
+            }
+        }
+        const uint32_t tri = uint32_t(best);
+        emitted[tri] = true;
+        uint32_t new_cache[CACHE_SIZE + 3];
+        int new_count = 0;
+        for (int k = 0; k < 3; k++) {
+            const uint32_t v = indices[tri * 3 + k];
+            output[out * 3 + k] = v;
+            new_cache[new_count++] = v;
+            // remove the triangle from the vertex adjacency
+            uint32_t *adj = adjacency.data() + offsets[v];
+            for (uint32_t a = 0; a < remaining[v]; a++) {
+                if (adj[a] == tri) {
+                    adj[a] = adj[remaining[v] - 1];
+                    break;
+                }
+            }
+            remaining[v]--;
+        }
+        for (int c = 0; c < cache_count; c++) {
+            const uint32_t v = cache[c];
+            if (v != new_cache[0] && v != new_cache[1] && v != new_cache[2]) {
+                new_cache[new_count++] = v;
+            }
+        }
+        // update the scores of the vertices in the cache (and of those evicted), then of their triangles
+        for (int c = 0; c < new_count; c++) {
+            const uint32_t v = new_cache[c];
+            cache_position[v] = c < CACHE_SIZE ? c : -1;
+            score[v] = vertex_score(table, cache_position[v], remaining[v]);
+        }
+        best = -1;
+        float best_score = -1.0f;
+        for (int c = 0; c < new_count; c++) {
+            const uint32_t v = new_cache[c];
+            for (uint32_t a = 0; a < remaining[v]; a++) {
+                const uint32_t t = adjacency[offsets[v] + a];
+                const float s = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+                triangle_score[t] = s;
+                if (c < CACHE_SIZE && s > best_score) {
+                    best_score = s;
+                    best = int64_t(t);
+                }
+            }
+        }
+        cache_count = std::min(new_count, CACHE_SIZE);
+        memcpy(cache, new_cache, cache_count * sizeof(uint32_t));
+    }
+    memcpy(indices, output.data(), num_triangles * 3 * sizeof(uint32_t));
+}
+
+size_t optimize_vertex_fetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices) {
+    const uint32_t unused = ~0u;
+    std::vector<uint32_t> remap(vertices.size(), unused);
+    std::vector<Vertex> result;
+    result.reserve(vertices.size());
+    for (auto &idx : indices) {
+        if (remap[idx] == unused) {
+            remap[idx] = uint32_t(result.size());
+            result.push_back(vertices[idx]);
+        }
+        idx = remap[idx];
+    }
+    vertices.swap(result);
+    return vertices.size();
+}
+
+float average_cache_miss_ratio(const uint32_t *indices, size_t index_count, size_t vertex_count,
+                               uint32_t cache_size) {
+    if (index_count < 3) {
+        return 0.0f;
+    }
+    // FIFO cache: a vertex is in the cache if it was loaded less than cache_size misses ago
+    std::vector<uint64_t> loaded_at(vertex_count, 0);
+    uint64_t misses = 0;
+    for (size_t i = 0; i < index_count; i++) {
+        const uint32_t v = indices[i];
+        if (loaded_at[v] == 0 || misses + 1 - loaded_at[v] > cache_size) {
+            misses++;
+            loaded_at[v] = misses;
+        }
+    }
+    return float(misses) / float(index_count / 3);
+}
+
+} // namespace glengine
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "gl_types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace glengine {
+
+/// merge the vertices that are bitwise identical, and remap the indices. Returns the new number of vertices
+size_t deduplicate_vertices(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+/// reorder the triangles of an indexed triangle list to improve the post-transform vertex cache hit rate
+/// (Tom Forsyth's linear-speed vertex cache optimization)
+void optimize_vertex_cache(uint32_t *indices, size_t index_count, size_t vertex_count);
+
+/// reorder the vertices in the order they are first referenced by the indices (better memory locality when fetching
+/// vertices), unreferenced vertices are removed. Returns the new number of vertices
+size_t optimize_vertex_fetch(std::vector<Vertex> &vertices, std::vector<uint32_t> &indices);
+
+/// average number of vertex shader invocations per triangle with a FIFO cache of the given size (lower is better,
+/// 0.5 is the optimum for regular grids, 3 means no reuse at all)
+float average_cache_miss_ratio(const uint32_t *indices, size_t index_count, size_t vertex_count,
+                               uint32_t cache_size = 16);
+
+} // namespace glengine
@@ -0,0 +1,586 @@
+#include "gl_mesh_simplifier.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <unordered_map>
+
+namespace {
+
+using glengine::Vertex;
+
+constexpr uint32_t INVALID = ~0u;
+constexpr int NUM_ATTRIBUTES = 5;      // normal and texture coordinates
+constexpr float BORDER_WEIGHT = 10.0f; // of the planes along the open borders, against the triangle planes
+constexpr float SEAM_WEIGHT = 1.0f;    // of the planes along the attribute seams
+
+enum Kind : uint8_t {
+    Manifold, ///< inside the mesh, without seam
+    Border,   ///< on an open border
+    Seam,     ///< on an attribute seam, with two vertices sharing its position
+    Locked,   ///< anything else, never collapsed
+    NumKinds,
+};
+
+// collapses allowed from a kind (row) onto a kind (column)
+const bool CAN_COLLAPSE[NumKinds][NumKinds] = {
+    {true, true, true, true},
+    {false, true, false, false},
+    {false, false, true, false},
+    {false, false, false, false},
+};
+
+// edges between the kinds that also exist in the opposite direction (in the topology of the positions for the
+// seams): only one of the two is a candidate
+const bool HAS_OPPOSITE[NumKinds][NumKinds] = {
+    {true, true, true, true},
+    {true, false, true, false},
+    {true, true, true, true},
+    {true, false, true, false},
+};
+
+/// weighted sum of squared distances to planes: p^T A p + 2 b.p + c
+struct Quadric {
+    float a00 = 0.0f, a11 = 0.0f, a22 = 0.0f, a01 = 0.0f, a02 = 0.0f, a12 = 0.0f;
+    float b0 = 0.0f, b1 = 0.0f, b2 = 0.0f;
+    float c = 0.0f;
+    float w = 0.0f;
+};
+
+/// sums of w g and w d of an attribute linear over the triangles (g.p + d), for the attribute quadrics
+struct Gradient {
+    float g0 = 0.0f, g1 = 0.0f, g2 = 0.0f;
+    float d = 0.0f;
+};
+
+void add(Quadric &q, const Quadric &r) {
+    q.a00 += r.a00, q.a11 += r.a11, q.a22 += r.a22, q.a01 += r.a01, q.a02 += r.a02, q.a12 += r.a12;
+    q.b0 += r.b0, q.b1 += r.b1, q.b2 += r.b2;
+    q.c += r.c;
+    q.w += r.w;
+}
+
+void add(Gradient &g, const Gradient &r) {
+    g.g0 += r.g0, g.g1 += r.g1, g.g2 += r.g2;
+    g.d += r.d;
+}
+
+// (n.p + d)^2, times w. Without the weight for the attribute quadrics
+void add_plane(Quadric &q, const math::Vector3f &n, float d, float w, bool weight = true) {
+    q.a00 += w * n.x * n.x, q.a11 += w * n.y * n.y, q.a22 += w * n.z * n.z;
+    q.a01 += w * n.x * n.y, q.a02 += w * n.x * n.z, q.a12 += w * n.y * n.z;
+    q.b0 += w * n.x * d, q.b1 += w * n.y * d, q.b2 += w * n.z * d;
+    q.c += w * d * d;
+    q.w += weight ? w : 0.0f;
+}
+
+float evaluate(const Quadric &q, const math::Vector3f &p) {
+    return q.a00 * p.x * p.x + q.a11 * p.y * p.y + q.a22 * p.z * p.z +
+           2.0f * (q.a01 * p.x * p.y + q.a02 * p.x * p.z + q.a12 * p.y * p.z) +
+           2.0f * (q.b0 * p.x + q.b1 * p.y + q.b2 * p.z) + q.c;
+}
+
+/// triangles around each vertex, as the other two vertices in winding order
+struct Adjacency {
+    std::vector<uint32_t> offsets; ///< vertex count + 1
+    std::vector<uint32_t> data;    ///< pairs of vertices
+
+    // of the indices, mapped by remap when not null
+    void build(const std::vector<uint32_t> &indices, size_t vertex_count, const uint32_t *remap) {
+        offsets.assign(vertex_count + 1, 0);
+        auto vertex = [&](size_t i) { return remap ? remap[indices[i]] : indices[i]; };
+        for (size_t i = 0; i < indices.size(); i++) {
+            offsets[vertex(i) + 1] += 2;
+        }
+        std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+        data.resize(offsets.back());
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i += 3) {
+            const uint32_t v[3] = {vertex(i), vertex(i + 1), vertex(i + 2)};
+            for (int k = 0; k < 3; k++) {
+                data[fill[v[k]]++] = v[(k + 1) % 3];
+                data[fill[v[k]]++] = v[(k + 2) % 3];
+            }
+        }
+    }
+
+    bool has_edge(uint32_t a, uint32_t b) const {
+        for (uint32_t i = offsets[a]; i < offsets[a + 1]; i += 2) {
+            if (data[i] == b) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+struct Collapse {
+    uint32_t v0;
+    uint32_t v1;
+    bool bidirectional; ///< v1 onto v0 is allowed too, the cheaper direction is kept
+    float error;
+};
+
+class Simplifier {
+  public:
+    Simplifier(const std::vector<Vertex> &vertices, const glengine::SimplifyOptions &options)
+    : _vertices(vertices)
+    , _options(options) {}
+
+    float run(const std::vector<uint32_t> &indices, size_t target_index_count, float target_error,
+              std::vector<uint32_t> &result);
+
+  private:
+    void rescale();
+    void build_wedges();
+    void classify(const std::vector<uint32_t> &indices);
+    void fill_quadrics(const std::vector<uint32_t> &indices);
+    void pick_collapses(const std::vector<uint32_t> &indices);
+    float collapse_error(uint32_t v0, uint32_t v1) const;
+    float attribute_error(uint32_t v0, uint32_t v1) const;
+    bool has_flips(uint32_t v0, uint32_t v1) const;
+    /// the vertex on the other side of a seam that v0's twin collapses onto, when v0 collapses onto v1
+    uint32_t seam_target(uint32_t v0, uint32_t v1) const {
+        const uint32_t w0 = _wedge[v0];
+        return _loop[v0] == v1 ? _loopback[w0] : _loop[w0];
+    }
+
+    const std::vector<Vertex> &_vertices;
+    glengine::SimplifyOptions _options;
+    float _scale = 1.0f;                  ///< from mesh units to the unit cube
+    std::vector<math::Vector3f> _positions; ///< in the unit cube
+    std::vector<float> _attributes;         ///< weighted, NUM_ATTRIBUTES per vertex
+    std::vector<uint32_t> _remap;           ///< first vertex with the same position
+    std::vector<uint32_t> _wedge;           ///< next vertex with the same position, circular
+    std::vector<Kind> _kinds;
+    std::vector<uint32_t> _loop;     ///< next vertex along the open edge from a border or seam vertex
+    std::vector<uint32_t> _loopback; ///< previous vertex along the open edge
+    std::vector<Quadric> _quadrics;  ///< of the positions, by remapped vertex
+    std::vector<Quadric> _attribute_quadrics;
+    std::vector<Gradient> _gradients; ///< NUM_ATTRIBUTES per vertex
+    Adjacency _adjacency;             ///< of the positions, for the flips
+    std::vector<Collapse> _collapses;
+};
+
+void Simplifier::rescale() {
+    const size_t n = _vertices.size();
+    math::Vector3f lo = n ? _vertices[0].pos : math::Vector3f{0.0f, 0.0f, 0.0f}, hi = lo;
+    for (const Vertex &v : _vertices) {
+        for (int c = 0; c < 3; c++) {
+            lo[c] = std::min(lo[c], v.pos[c]);
+            hi[c] = std::max(hi[c], v.pos[c]);
+        }
+    }
+    const float extent = std::max({hi.x - lo.x, hi.y - lo.y, hi.z - lo.z});
+    _scale = extent > 0.0f ? 1.0f / extent : 1.0f;
+    _positions.resize(n);
+    _attributes.resize(n * NUM_ATTRIBUTES);
+    for (size_t i = 0; i < n; i++) {
+        const Vertex &v = _vertices[i];
+        _positions[i] = (v.pos - lo) * _scale;
+        float *a = &_attributes[i * NUM_ATTRIBUTES];
+        a[0] = v.normal.x * _options.normal_weight;
+        a[1] = v.normal.y * _options.normal_weight;
+        a[2] = v.normal.z * _options.normal_weight;
+        a[3] = v.tex_coords.x * _options.uv_weight;
+        a[4] = v.tex_coords.y * _options.uv_weight;
+    }
+}
+
+void Simplifier::build_wedges() {
+    struct PositionHash {
+        size_t operator()(const math::Vector3f &p) const {
+            uint32_t bits[3];
+            memcpy(bits, &p, sizeof(bits));
+            return size_t(bits[0] * 73856093u ^ bits[1] * 19349663u ^ bits[2] * 83492791u);
+        }
+    };
+    struct PositionEqual {
+        bool operator()(const math::Vector3f &a, const math::Vector3f &b) const {
+            return a.x == b.x && a.y == b.y && a.z == b.z;
+        }
+    };
+    const size_t n = _vertices.size();
+    std::unordered_map<math::Vector3f, uint32_t, PositionHash, PositionEqual> first;
+    first.reserve(n);
+    _remap.resize(n);
+    _wedge.resize(n);
+    for (uint32_t i = 0; i < n; i++) {
+        const uint32_t r = first.emplace(_vertices[i].pos, i).first->second;
+        _remap[i] = r;
+        _wedge[i] = i;
+        if (r != i) {
+            _wedge[i] = _wedge[r];
+            _wedge[r] = i;
+        }
+    }
+}
+
+void Simplifier::classify(const std::vector<uint32_t> &indices) {
+    const uint32_t n = uint32_t(_vertices.size());
+    // open edges of the attribute topology: a single one in and out for the vertices along a border or a seam,
+    // more are marked with the vertex itself
+    Adjacency attribute_adjacency;
+    attribute_adjacency.build(indices, n, nullptr);
+    _loop.assign(n, INVALID);
+    _loopback.assign(n, INVALID);
+    for (uint32_t v = 0; v < n; v++) {
+        for (uint32_t i = attribute_adjacency.offsets[v]; i < attribute_adjacency.offsets[v + 1]; i += 2) {
+            const uint32_t t = attribute_adjacency.data[i];
+            if (!attribute_adjacency.has_edge(t, v)) {
+                _loopback[t] = _loopback[t] == INVALID ? v : t;
+                _loop[v] = _loop[v] == INVALID ? t : v;
+            }
+        }
+    }
+    auto single_open_edge = [&](uint32_t v) {
+        return _loop[v] != INVALID && _loop[v] != v && _loopback[v] != INVALID && _loopback[v] != v;
+    };
+    _kinds.assign(n, Locked);
+    for (uint32_t v = 0; v < n; v++) {
+        if (_remap[v] != v) {
+            continue;
+        }
+        const uint32_t w = _wedge[v];
+        if (w == v) {
+            // vertices without any open edge are taken as manifold, even if more than two triangles share an edge
+            if (_loop[v] == INVALID && _loopback[v] == INVALID) {
+                _kinds[v] = Manifold;
+            } else if (single_open_edge(v)) {
+                _kinds[v] = _options.lock_border ? Locked : Border;
+            }
+        } else if (_wedge[w] == v && single_open_edge(v) && single_open_edge(w) &&
+                   _remap[_loop[v]] == _remap[_loopback[w]] && _remap[_loopback[v]] == _remap[_loop[w]]) {
+            // the open edges of the two sides of a seam join the same positions, in opposite directions
+            _kinds[v] = Seam;
+        }
+    }
+    for (uint32_t v = 0; v < n; v++) {
+        _kinds[v] = _kinds[_remap[v]];
+    }
+}
+
+void Simplifier::fill_quadrics(const std::vector<uint32_t> &indices) {
+    const size_t n = _vertices.size();
+    _quadrics.assign(n, Quadric());
+    _attribute_quadrics.assign(n, Quadric());
+    _gradients.assign(n * NUM_ATTRIBUTES, Gradient());
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        const uint32_t v[3] = {indices[i], indices[i + 1], indices[i + 2]};
+        const math::Vector3f &p0 = _positions[v[0]];
+        const math::Vector3f e1 = _positions[v[1]] - p0, e2 = _positions[v[2]] - p0;
+        math::Vector3f normal = e1.cross(e2);
+        const float area = math::length(normal) * 0.5f;
+        if (area <= 0.0f) {
+            continue;
+        }
+        normal /= area * 2.0f;
+        // the square root of the area keeps the error linear with the size of the triangles
+        const float weight = std::sqrt(area);
+        Quadric plane;
+        add_plane(plane, normal, -normal.dot(p0), weight);
+        for (int k = 0; k < 3; k++) {
+            add(_quadrics[_remap[v[k]]], plane);
+        }
+
+        // attributes as linear functions over the triangle, g.p + d: gradient from the barycentric coordinates
+        Quadric attribute_quadric;
+        attribute_quadric.w = weight;
+        Gradient gradients[NUM_ATTRIBUTES];
+        const float d00 = e1.dot(e1), d01 = e1.dot(e2), d11 = e2.dot(e2);
+        const float denom = d00 * d11 - d01 * d01;
+        if (denom > 0.0f) {
+            for (int a = 0; a < NUM_ATTRIBUTES; a++) {
+                const float a0 = _attributes[v[0] * NUM_ATTRIBUTES + a];
+                const float da1 = _attributes[v[1] * NUM_ATTRIBUTES + a] - a0;
+                const float da2 = _attributes[v[2] * NUM_ATTRIBUTES + a] - a0;
+                const math::Vector3f g =
+                    e1 * ((d11 * da1 - d01 * da2) / denom) + e2 * ((d00 * da2 - d01 * da1) / denom);
+                const float d = a0 - g.dot(p0);
+                add_plane(attribute_quadric, g, d, weight, false);
+                gradients[a] = {g.x * weight, g.y * weight, g.z * weight, d * weight};
+            }
+        }
+        for (int k = 0; k < 3; k++) {
+            add(_attribute_quadrics[v[k]], attribute_quadric);
+            for (int a = 0; a < NUM_ATTRIBUTES; a++) {
+                add(_gradients[v[k] * NUM_ATTRIBUTES + a], gradients[a]);
+            }
+        }
+
+        // planes perpendicular to the triangle along its open edges, so that borders and seams keep their shape
+        for (int k = 0; k < 3; k++) {
+            const uint32_t i0 = v[k], i1 = v[(k + 1) % 3];
+            const Kind k0 = _kinds[i0], k1 = _kinds[i1];
+            const bool open0 = k0 == Border || k0 == Seam, open1 = k1 == Border || k1 == Seam;
+            if ((!open0 && !open1) || (open0 && _loop[i0] != i1) || (open1 && _loopback[i1] != i0)) {
+                continue;
+            }
+            // both sides of a seam have the edge
+            if (HAS_OPPOSITE[k0][k1] && _remap[i1] > _remap[i0]) {
+                continue;
+            }
+            const math::Vector3f edge = _positions[i1] - _positions[i0];
+            const float length = math::length(edge);
+            if (length <= 0.0f) {
+                continue;
+            }
+            math::Vector3f perpendicular = edge.cross(normal);
+            math::normalize(perpendicular);
+            Quadric edge_plane;
+            add_plane(edge_plane, perpendicular, -perpendicular.dot(_positions[i0]),
+                      length * (k0 == Border || k1 == Border ? BORDER_WEIGHT : SEAM_WEIGHT));
+            add(_quadrics[_remap[i0]], edge_plane);
+            add(_quadrics[_remap[i1]], edge_plane);
+        }
+    }
+}
+
+float Simplifier::attribute_error(uint32_t v0, uint32_t v1) const {
+    const Quadric &q = _attribute_quadrics[v0];
+    if (q.w <= 0.0f) {
+        return 0.0f;
+    }
+    const math::Vector3f &p = _positions[v1];
+    float error = evaluate(q, p);
+    for (int a = 0; a < NUM_ATTRIBUTES; a++) {
+        const Gradient &g = _gradients[v0 * NUM_ATTRIBUTES + a];
+        const float s = _attributes[v1 * NUM_ATTRIBUTES + a];
+        error += q.w * s * s - 2.0f * s * (g.g0 * p.x + g.g1 * p.y + g.g2 * p.z + g.d);
+    }
+    return std::fabs(error) / q.w;
+}
+
+float Simplifier::collapse_error(uint32_t v0, uint32_t v1) const {
+    const Quadric &q = _quadrics[_remap[v0]];
+    float error = q.w > 0.0f ? std::fabs(evaluate(q, _positions[v1])) / q.w : 0.0f;
+    error += attribute_error(v0, v1);
+    if (_kinds[v0] == Seam) {
+        const uint32_t w1 = seam_target(v0, v1);
+        if (w1 == INVALID || _remap[w1] != _remap[v1]) {
+            return FLT_MAX; // the other side of the seam doesn't follow
+        }
+        error += attribute_error(_wedge[v0], w1);
+    }
+    return error;
+}
+
+bool Simplifier::has_flips(uint32_t v0, uint32_t v1) const {
+    const uint32_t r0 = _remap[v0], r1 = _remap[v1];
+    const math::Vector3f &p0 = _positions[r0], &p1 = _positions[r1];
+    for (uint32_t i = _adjacency.offsets[r0]; i < _adjacency.offsets[r0 + 1]; i += 2) {
+        const uint32_t a = _adjacency.data[i], b = _adjacency.data[i + 1];
+        if (a == r1 || b == r1) {
+            continue; // removed by the collapse
+        }
+        const math::Vector3f &pa = _positions[a], &pb = _positions[b];
+        const math::Vector3f n0 = (pa - p0).cross(pb - p0);
+        const math::Vector3f n1 = (pa - p1).cross(pb - p1);
+        // rotations of the triangles past ~75 degrees count as flips too, they fold the surface
+        if (n0.dot(n1) <= 0.25f * std::sqrt(math::length2(n0) * math::length2(n1))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void Simplifier::pick_collapses(const std::vector<uint32_t> &indices) {
+    _collapses.clear();
+    for (size_t i = 0; i < indices.size(); i += 3) {
+        for (int k = 0; k < 3; k++) {
+            const uint32_t i0 = indices[i + k], i1 = indices[i + (k + 1) % 3];
+            const Kind k0 = _kinds[i0], k1 = _kinds[i1];
+            if ((!CAN_COLLAPSE[k0][k1] && !CAN_COLLAPSE[k1][k0]) || _remap[i0] == _remap[i1]) {
+                continue;
+            }
+            // the opposite half edge is picked instead
+            if (HAS_OPPOSITE[k0][k1] && _remap[i1] > _remap[i0]) {
+                continue;
+            }
+            // borders and seams only collapse along themselves
+            if (k0 == k1 && (k0 == Border || k0 == Seam) && _loop[i0] != i1) {
+                continue;
+            }
+            if (CAN_COLLAPSE[k0][k1] && CAN_COLLAPSE[k1][k0]) {
+                _collapses.push_back({i0, i1, true, 0.0f});
+            } else if (CAN_COLLAPSE[k0][k1]) {
+                _collapses.push_back({i0, i1, false, 0.0f});
+            } else {
+                _collapses.push_back({i1, i0, false, 0.0f});
+            }
+        }
+    }
+    for (Collapse &c : _collapses) {
+        c.error = collapse_error(c.v0, c.v1);
+        if (c.bidirectional) {
+            const float reverse = collapse_error(c.v1, c.v0);
+            if (reverse < c.error) {
+                std::swap(c.v0, c.v1);
+                c.error = reverse;
+            }
+        }
+    }
+    std::sort(_collapses.begin(), _collapses.end(),
+              [](const Collapse &a, const Collapse &b) { return a.error < b.error; });
+}
+
+float Simplifier::run(const std::vector<uint32_t> &indices, size_t target_index_count, float target_error,
+                      std::vector<uint32_t> &result) {
+    result = indices;
+    const uint32_t n = uint32_t(_vertices.size());
+    rescale();
+    build_wedges();
+    classify(result);
+    fill_quadrics(result);
+
+    std::vector<uint32_t> collapse_remap(n);
+    std::iota(collapse_remap.begin(), collapse_remap.end(), 0u);
+    std::vector<uint8_t> locked(n);
+    const float error_limit = target_error * target_error;
+    float max_error = 0.0f;
+    while (result.size() > target_index_count) {
+        _adjacency.build(result, n, _remap.data());
+        pick_collapses(result);
+        if (_collapses.empty()) {
+            break;
+        }
+        // most collapses remove two triangles. Many of the cheapest ones are locked by a previous one of the pass,
+        // the pass goes somewhat past the error of the goal to keep the order roughly global
+        const size_t triangle_goal = (result.size() - target_index_count) / 3;
+        size_t edge_goal = triangle_goal / 2 + 1;
+        std::fill(locked.begin(), locked.end(), uint8_t(0));
+        size_t num_removed = 0, num_collapses = 0;
+        for (const Collapse &c : _collapses) {
+            const float error_goal = edge_goal < _collapses.size() ? 1.5f * _collapses[edge_goal].error : FLT_MAX;
+            if (c.error > std::min(error_goal, error_limit) || num_removed >= triangle_goal) {
+                break;
+            }
+            const uint32_t r0 = _remap[c.v0], r1 = _remap[c.v1];
+            if (locked[r0] || locked[r1]) {
+                continue;
+            }
+            if (has_flips(c.v0, c.v1)) {
+                edge_goal++; // not a candidate of this pass, nor of the next ones
+                continue;
+            }
+            collapse_remap[c.v0] = c.v1;
+            add(_quadrics[r1], _quadrics[r0]);
+            add(_attribute_quadrics[c.v1], _attribute_quadrics[c.v0]);
+            for (int a = 0; a < NUM_ATTRIBUTES; a++) {
+                add(_gradients[c.v1 * NUM_ATTRIBUTES + a], _gradients[c.v0 * NUM_ATTRIBUTES + a]);
+            }
+            if (_kinds[c.v0] == Seam) {
+                const uint32_t w0 = _wedge[c.v0], w1 = seam_target(c.v0, c.v1);
+                collapse_remap[w0] = w1;
+                add(_attribute_quadrics[w1], _attribute_quadrics[w0]);
+                for (int a = 0; a < NUM_ATTRIBUTES; a++) {
+                    add(_gradients[w1 * NUM_ATTRIBUTES + a], _gradients[w0 * NUM_ATTRIBUTES + a]);
+                }
+            }
+            // the triangles around the collapsed vertex don't change again in this pass, so that the flip tests
+            // see their final positions
+            locked[r0] = locked[r1] = 1;
+            for (uint32_t i = _adjacency.offsets[r0]; i < _adjacency.offsets[r0 + 1]; i++) {
+                locked[_adjacency.data[i]] = 1;
+            }
+            num_removed += _kinds[c.v0] == Border ? 1 : 2;
+            num_collapses++;
+            max_error = std::max(max_error, c.error);
+        }
+        if (num_collapses == 0) {
+            break;
+        }
+
+        // remap the triangles and drop the degenerate ones
+        size_t count = 0;
+        for (size_t i = 0; i < result.size(); i += 3) {
+            const uint32_t a = collapse_remap[result[i]], b = collapse_remap[result[i + 1]],
+                           c = collapse_remap[result[i + 2]];
+            if (_remap[a] != _remap[b] && _remap[a] != _remap[c] && _remap[b] != _remap[c]) {
+                result[count++] = a;
+                result[count++] = b;
+                result[count++] = c;
+            }
+        }
+        result.resize(count);
+        // the loops skip the collapsed vertices, a vertex collapsed back along its loop takes the next one
+        for (std::vector<uint32_t> *loop : {&_loop, &_loopback}) {
+            for (uint32_t v = 0; v < n; v++) {
+                const uint32_t l = (*loop)[v];
+                if (l != INVALID && l != v) {
+                    const uint32_t r = collapse_remap[l];
+                    (*loop)[v] = r == v ? (*loop)[l] : r;
+                }
+            }
+        }
+        for (uint32_t v = 0; v < n; v++) {
+            collapse_remap[v] = v;
+        }
+    }
+    return std::sqrt(max_error) / _scale;
+}
+
+} // namespace
+
+namespace glengine {
+
+float simplify_mesh(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+                    size_t target_index_count, float target_error, std::vector<uint32_t> &result,
+                    const SimplifyOptions &options) {
+    Simplifier simplifier(vertices, options);
+    return simplifier.run(indices, target_index_count, target_error, result);
+}
+
+uint32_t generate_lods(MeshData &md, const LodOptions &options) {
+    md.lods.clear();
+    if (md.indices.empty() || md.indices.size() % 3 != 0) {
+        return 0;
+    }
+    // bounding sphere of the referenced vertices, for the screen sizes
+    math::Vector3f lo = md.vertices[md.indices[0]].pos, hi = lo;
+    for (uint32_t i : md.indices) {
+        for (int c = 0; c < 3; c++) {
+            lo[c] = std::min(lo[c], md.vertices[i].pos[c]);
+            hi[c] = std::max(hi[c], md.vertices[i].pos[c]);
+        }
+    }
+    const math::Vector3f center = (lo + hi) * 0.5f;
+    float radius = 0.0f;
+    for (uint32_t i : md.indices) {
+        radius = std::max(radius, math::length(md.vertices[i].pos - center));
+    }
+    const float size = std::max({hi.x - lo.x, hi.y - lo.y, hi.z - lo.z});
+
+    md.lods.push_back({0, uint32_t(md.indices.size()), 0.0f, FLT_MAX});
+    std::vector<uint32_t> source = md.indices, lod;
+    float error = 0.0f;
+    for (uint32_t level = 0; level < options.max_lods; level++) {
+        const size_t target = std::max(size_t(source.size() * options.ratio) / 3, size_t(options.min_triangles)) * 3;
+        const float remaining = options.max_error - (size > 0.0f ? error / size : 0.0f);
+        if (source.size() <= target || remaining <= 0.0f) {
+            break;
+        }
+        const float level_error = simplify_mesh(md.vertices, source, target, remaining, lod, options.simplify);
+        if (lod.empty() || lod.size() * 10 > source.size() * 9) {
+            break;
+        }
+        error += level_error;
+        MeshLod l;
+        l.first_index = uint32_t(md.indices.size());
+        l.num_indices = uint32_t(lod.size());
+        l.error = error;
+        l.screen_size = error > 0.0f ? 2.0f * radius * options.pixel_error / (error * options.reference_height)
+                                     : FLT_MAX;
+        md.indices.insert(md.indices.end(), lod.begin(), lod.end());
+        md.lods.push_back(l);
+        source.swap(lod);
+    }
+    if (md.lods.size() == 1) {
+        md.lods.clear();
+    }
+    return md.lods.empty() ? 0 : uint32_t(md.lods.size() - 1);
+}
+
+} // namespace glengine
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "gl_prefabs.h"
+#include "gl_types.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace glengine {
+
+struct SimplifyOptions {
+    float normal_weight = 0.5f; ///< of the normals in the error, against the positions in units of the mesh size
+    float uv_weight = 0.5f;     ///< of the texture coordinates in the error
+    bool lock_border = false;   ///< keep the vertices of the open borders of the mesh
+};
+
+/// simplify an indexed triangle list by edge collapses, in order of their quadric error (Garland and Heckbert),
+/// extended with the normals and texture coordinates (attribute quadrics, Hoppe) so that the shading is preserved
+/// too. Vertices collapse onto one of their neighbours: the result indexes the same vertices. The open borders only
+/// collapse along themselves, the attribute seams (vertices sharing a position) on both sides at once, vertices
+/// where more than two attribute sets meet are kept, and the collapses folding a triangle over are rejected. Stops
+/// at target_index_count indices or when the next collapse has an error above target_error, relative to the size
+/// of the mesh. Returns the error reached, in mesh units
+float simplify_mesh(const std::vector<Vertex> &vertices, const std::vector<uint32_t> &indices,
+                    size_t target_index_count, float target_error, std::vector<uint32_t> &result,
+                    const SimplifyOptions &options = {});
+
+struct LodOptions {
+    uint32_t max_lods = 4;            ///< levels besides the full mesh
+    float ratio = 0.5f;               ///< target triangles of a level, relative to the previous one
+    float max_error = 0.05f;          ///< of the coarsest level, relative to the size of the mesh
+    uint32_t min_triangles = 64;      ///< of the coarsest level
+    float pixel_error = 1.0f;         ///< on screen when a level is switched to (see MeshLod::screen_size)
+    float reference_height = 1080.0f; ///< of the viewport for pixel_error
+    SimplifyOptions simplify;
+};
+
+/// append a chain of levels of detail to the indices of md, each simplified from the previous one, and set md.lods
+/// (the first is the full mesh). The error of a level adds up the errors of the chain, and its screen size is where
+/// that error projects to pixel_error on a viewport of reference_height. The chain stops early when a level removes
+/// less than a tenth of the triangles. Returns the number of levels besides the full mesh, md.lods is left empty
+/// when there is none
+uint32_t generate_lods(MeshData &md, const LodOptions &options = {});
+
+} // namespace glengine
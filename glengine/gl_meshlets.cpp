@@ -0,0 +1,439 @@
+#include "gl_meshlets.h"
+#include "gl_camera.h"
+#include "gl_logger.h"
+#include "gl_mesh.h"
+#include "gl_renderable.h"
+#include "gl_utils.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <unordered_map>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using glengine::Vertex;
+
+constexpr uint32_t INVALID = ~0u;
+
+double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// same index for the vertices sharing a position, so that the meshlets grow across the attribute seams
+std::vector<uint32_t> weld_positions(const std::vector<Vertex> &vertices, uint32_t &num_positions) {
+    struct Hash {
+        size_t operator()(const math::Vector3f &p) const {
+            uint32_t h[3];
+            memcpy(h, &p.x, sizeof(float)), memcpy(h + 1, &p.y, sizeof(float)), memcpy(h + 2, &p.z, sizeof(float));
+            return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+        }
+    };
+    struct Equal {
+        bool operator()(const math::Vector3f &a, const math::Vector3f &b) const {
+            return a.x == b.x && a.y == b.y && a.z == b.z;
+        }
+    };
+    std::unordered_map<math::Vector3f, uint32_t, Hash, Equal> positions;
+    positions.reserve(vertices.size());
+    std::vector<uint32_t> remap(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++) {
+        remap[i] = positions.emplace(vertices[i].pos, uint32_t(positions.size())).first->second;
+    }
+    num_positions = uint32_t(positions.size());
+    return remap;
+}
+
+// sphere around the box of the vertices, and cone of the normals of the triangles
+void compute_bounds(const Vertex *vertices, const uint32_t *indices, uint32_t num_indices,
+                    const std::vector<math::Vector3f> &normals, const uint32_t *triangles,
+                    glengine::Meshlet &meshlet) {
+    math::Vector3f lo = vertices[indices[0]].pos, hi = lo;
+    for (uint32_t i = 1; i < num_indices; i++) {
+        const math::Vector3f &p = vertices[indices[i]].pos;
+        for (int c = 0; c < 3; c++) {
+            lo[c] = std::min(lo[c], p[c]);
+            hi[c] = std::max(hi[c], p[c]);
+        }
+    }
+    meshlet.center = (lo + hi) * 0.5f;
+    meshlet.radius = 0.0f;
+    for (uint32_t i = 0; i < num_indices; i++) {
+        meshlet.radius = std::max(meshlet.radius, math::length(vertices[indices[i]].pos - meshlet.center));
+    }
+    // the cone is left open (cutoff of 1) when the normals spread over a half space, or nearly: it would never cull
+    math::Vector3f axis = {0.0f, 0.0f, 0.0f};
+    for (uint32_t t = 0; t < num_indices / 3; t++) {
+        axis = axis + normals[triangles[t]];
+    }
+    meshlet.cone_axis = {0.0f, 0.0f, 1.0f};
+    meshlet.cone_cutoff = 1.0f;
+    const float length = math::length(axis);
+    if (length < 1e-6f) {
+        return;
+    }
+    axis = axis * (1.0f / length);
+    float min_dot = 1.0f;
+    for (uint32_t t = 0; t < num_indices / 3; t++) {
+        const math::Vector3f &n = normals[triangles[t]];
+        // degenerate triangles have no normal, and face nowhere
+        if (n.dot(n) > 0.0f) {
+            min_dot = std::min(min_dot, n.dot(axis));
+        }
+    }
+    meshlet.cone_axis = axis;
+    if (min_dot > 0.1f) {
+        meshlet.cone_cutoff = std::sqrt(1.0f - min_dot * min_dot);
+    }
+}
+
+// ///////////////////////////////////////////////////// //
+// lanes of the tests: one meshlet, then 4 or 8 at once //
+// ///////////////////////////////////////////////////// //
+struct f1 {
+    static constexpr uint32_t width = 1;
+    float v;
+    static f1 load(const float *p) { return {*p}; }
+    static f1 set(float s) { return {s}; }
+};
+inline f1 operator+(f1 a, f1 b) { return {a.v + b.v}; }
+inline f1 operator-(f1 a, f1 b) { return {a.v - b.v}; }
+inline f1 operator*(f1 a, f1 b) { return {a.v * b.v}; }
+inline f1 vmin(f1 a, f1 b) { return {std::min(a.v, b.v)}; }
+inline f1 vsqrt(f1 a) { return {std::sqrt(a.v)}; }
+// bit i set when lane i is above 0
+inline uint32_t positive_bits(f1 a) { return a.v > 0.0f ? 1u : 0u; }
+
+#if defined(__AVX2__)
+struct f8 {
+    static constexpr uint32_t width = 8;
+    __m256 v;
+    static f8 load(const float *p) { return {_mm256_loadu_ps(p)}; }
+    static f8 set(float s) { return {_mm256_set1_ps(s)}; }
+};
+inline f8 operator+(f8 a, f8 b) { return {_mm256_add_ps(a.v, b.v)}; }
+inline f8 operator-(f8 a, f8 b) { return {_mm256_sub_ps(a.v, b.v)}; }
+inline f8 operator*(f8 a, f8 b) { return {_mm256_mul_ps(a.v, b.v)}; }
+inline f8 vmin(f8 a, f8 b) { return {_mm256_min_ps(a.v, b.v)}; }
+inline f8 vsqrt(f8 a) { return {_mm256_sqrt_ps(a.v)}; }
+inline uint32_t positive_bits(f8 a) {
+    return uint32_t(_mm256_movemask_ps(_mm256_cmp_ps(a.v, _mm256_setzero_ps(), _CMP_GT_OQ)));
+}
+using fw = f8;
+#elif defined(__SSE2__)
+struct f4 {
+    static constexpr uint32_t width = 4;
+    __m128 v;
+    static f4 load(const float *p) { return {_mm_loadu_ps(p)}; }
+    static f4 set(float s) { return {_mm_set1_ps(s)}; }
+};
+inline f4 operator+(f4 a, f4 b) { return {_mm_add_ps(a.v, b.v)}; }
+inline f4 operator-(f4 a, f4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline f4 operator*(f4 a, f4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+inline f4 vmin(f4 a, f4 b) { return {_mm_min_ps(a.v, b.v)}; }
+inline f4 vsqrt(f4 a) { return {_mm_sqrt_ps(a.v)}; }
+inline uint32_t positive_bits(f4 a) { return uint32_t(_mm_movemask_ps(_mm_cmpgt_ps(a.v, _mm_setzero_ps()))); }
+using fw = f4;
+#else
+using fw = f1;
+#endif
+
+// bounds of the meshlets by streams (see Mesh::meshlet_bounds), and the view in the space of the mesh
+struct CullKernel {
+    const float *bounds;
+    size_t stride;
+    bool frustum;
+    math::Vector4f planes[6]; ///< normalized
+    bool cone;
+    math::Vector4f eye; ///< w is 0 for an orthographic camera: the direction towards it
+};
+
+// visible[i] for the meshlets [0, count), count a multiple of the lanes: the smallest margin of the tests has to be
+// positive, the distance of the sphere to the inner side of the planes, and its clearance from the back of the cone
+template <typename F> void cull_kernel(const CullKernel &k, size_t count, uint8_t *visible) {
+    const float *b = k.bounds;
+    const size_t s = k.stride;
+    for (size_t i = 0; i < count; i += F::width) {
+        const F cx = F::load(b + i), cy = F::load(b + s + i), cz = F::load(b + 2 * s + i);
+        const F r = F::load(b + 3 * s + i);
+        F margin = F::set(FLT_MAX);
+        if (k.frustum) {
+            for (const math::Vector4f &p : k.planes) {
+                margin = vmin(margin, F::set(p.x) * cx + F::set(p.y) * cy + F::set(p.z) * cz + F::set(p.w) + r);
+            }
+        }
+        if (k.cone) {
+            // from the eye to the center, or along the view for an orthographic camera (the radius doesn't count)
+            const F w = F::set(k.eye.w);
+            const F vx = cx * w - F::set(k.eye.x), vy = cy * w - F::set(k.eye.y), vz = cz * w - F::set(k.eye.z);
+            const F ax = F::load(b + 4 * s + i), ay = F::load(b + 5 * s + i), az = F::load(b + 6 * s + i);
+            const F cutoff = F::load(b + 7 * s + i);
+            margin = vmin(margin, cutoff * vsqrt(vx * vx + vy * vy + vz * vz) + r * w - (vx * ax + vy * ay + vz * az));
+        }
+        const uint32_t bits = positive_bits(margin);
+        for (uint32_t j = 0; j < F::width; j++) {
+            visible[i + j] = uint8_t(bits >> j & 1u);
+        }
+    }
+}
+
+} // namespace
+
+namespace glengine {
+
+uint32_t build_meshlets(MeshData &md, const MeshletOptions &options) {
+    md.meshlets.clear();
+    const uint32_t first = md.lods.empty() ? 0 : md.lods[0].first_index;
+    const uint32_t num_triangles = (md.lods.empty() ? uint32_t(md.indices.size()) : md.lods[0].num_indices) / 3;
+    if (num_triangles == 0) {
+        return 0;
+    }
+    const uint32_t max_vertices = std::max(options.max_vertices, 3u);
+    const uint32_t max_triangles = std::max(options.max_triangles, 1u);
+    const uint32_t *indices = md.indices.data() + first;
+    uint32_t num_positions = 0;
+    const std::vector<uint32_t> remap = weld_positions(md.vertices, num_positions);
+
+    // triangles around each position
+    std::vector<uint32_t> offsets(num_positions + 1, 0);
+    for (uint32_t i = 0; i < num_triangles * 3; i++) {
+        offsets[remap[indices[i]] + 1]++;
+    }
+    for (uint32_t p = 0; p < num_positions; p++) {
+        offsets[p + 1] += offsets[p];
+    }
+    std::vector<uint32_t> adjacency(num_triangles * 3);
+    std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+    for (uint32_t i = 0; i < num_triangles * 3; i++) {
+        adjacency[fill[remap[indices[i]]]++] = i / 3;
+    }
+
+    // normals on the side of the vertex normals, and centroids
+    std::vector<math::Vector3f> normals(num_triangles), centroids(num_triangles);
+    for (uint32_t t = 0; t < num_triangles; t++) {
+        const Vertex &v0 = md.vertices[indices[t * 3]];
+        const Vertex &v1 = md.vertices[indices[t * 3 + 1]];
+        const Vertex &v2 = md.vertices[indices[t * 3 + 2]];
+        math::Vector3f n = (v1.pos - v0.pos).cross(v2.pos - v0.pos);
+        const float length = math::length(n);
+        n = length > 0.0f ? n * (1.0f / length) : math::Vector3f{0.0f, 0.0f, 0.0f};
+        normals[t] = n.dot(v0.normal + v1.normal + v2.normal) < 0.0f ? n * -1.0f : n;
+        centroids[t] = (v0.pos + v1.pos + v2.pos) * (1.0f / 3.0f);
+    }
+
+    std::vector<uint8_t> emitted(num_triangles, 0);
+    std::vector<uint32_t> position_tag(num_positions, INVALID);   // meshlet holding the position
+    std::vector<uint32_t> candidate_tag(num_triangles, INVALID); // meshlet the triangle is a candidate of
+    std::vector<uint32_t> order;                                 // triangles by meshlet
+    order.reserve(num_triangles);
+    std::vector<uint32_t> candidates;
+    uint32_t cursor = 0;
+    while (true) {
+        // seed: the first triangle left, in the order of the indices (usually close to the previous meshlet)
+        while (cursor < num_triangles && emitted[cursor]) {
+            cursor++;
+        }
+        if (cursor == num_triangles) {
+            break;
+        }
+        const uint32_t id = uint32_t(md.meshlets.size());
+        Meshlet meshlet;
+        meshlet.first_index = first + uint32_t(order.size()) * 3;
+        const uint32_t first_triangle = uint32_t(order.size());
+        uint32_t num_vertices = 0;
+        math::Vector3f center_sum = {0.0f, 0.0f, 0.0f}, normal_sum = {0.0f, 0.0f, 0.0f};
+        candidates.clear();
+        uint32_t t = cursor;
+        while (t != INVALID) {
+            emitted[t] = 1;
+            order.push_back(t);
+            center_sum = center_sum + centroids[t];
+            normal_sum = normal_sum + normals[t];
+            for (int c = 0; c < 3; c++) {
+                const uint32_t p = remap[indices[t * 3 + c]];
+                if (position_tag[p] == id) {
+                    continue;
+                }
+                position_tag[p] = id;
+                num_vertices++;
+                for (uint32_t a = offsets[p]; a < offsets[p + 1]; a++) {
+                    const uint32_t n = adjacency[a];
+                    if (!emitted[n] && candidate_tag[n] != id) {
+                        candidate_tag[n] = id;
+                        candidates.push_back(n);
+                    }
+                }
+            }
+            if (order.size() - first_triangle == max_triangles) {
+                break;
+            }
+            // next: the candidate adding the fewest vertices, then the closest to the center and the average normal
+            const math::Vector3f center = center_sum * (1.0f / float(order.size() - first_triangle));
+            const float normal_length = math::length(normal_sum);
+            const math::Vector3f axis =
+                normal_length > 0.0f ? normal_sum * (1.0f / normal_length) : math::Vector3f{0.0f, 0.0f, 0.0f};
+            t = INVALID;
+            uint32_t best_extra = 4;
+            float best_score = FLT_MAX;
+            for (size_t c = 0; c < candidates.size();) {
+                const uint32_t n = candidates[c];
+                if (emitted[n]) {
+                    candidates[c] = candidates.back();
+                    candidates.pop_back();
+                    continue;
+                }
+                c++;
+                uint32_t extra = 0;
+                for (int k = 0; k < 3; k++) {
+                    extra += position_tag[remap[indices[n * 3 + k]]] != id ? 1 : 0;
+                }
+                if (num_vertices + extra > max_vertices || extra > best_extra) {
+                    continue;
+                }
+                const float score = math::length(centroids[n] - center) *
+                                    (1.0f + options.cone_weight * (1.0f - normals[n].dot(axis)));
+                if (extra < best_extra || score < best_score) {
+                    t = n;
+                    best_extra = extra;
+                    best_score = score;
+                }
+            }
+        }
+        // the triangles of a meshlet keep the order they had, usually optimized for the vertex cache
+        std::sort(order.begin() + first_triangle, order.end());
+        meshlet.num_indices = (uint32_t(order.size()) - first_triangle) * 3;
+        md.meshlets.push_back(meshlet);
+    }
+
+    // triangles in the order of the meshlets, then their bounds
+    std::vector<uint32_t> reordered(num_triangles * 3);
+    for (uint32_t t = 0; t < num_triangles; t++) {
+        memcpy(&reordered[t * 3], indices + order[t] * 3, 3 * sizeof(uint32_t));
+    }
+    std::copy(reordered.begin(), reordered.end(), md.indices.begin() + first);
+    for (Meshlet &meshlet : md.meshlets) {
+        compute_bounds(md.vertices.data(), md.indices.data() + meshlet.first_index, meshlet.num_indices, normals,
+                       order.data() + (meshlet.first_index - first) / 3, meshlet);
+    }
+    return uint32_t(md.meshlets.size());
+}
+
+bool MeshletCuller::init(uint32_t capacity) {
+    _capacity = std::max(capacity, 1024u);
+    _buffer = sg_make_buffer((sg_buffer_desc){.size = _capacity * sizeof(uint32_t),
+                                              .type = SG_BUFFERTYPE_INDEXBUFFER,
+                                              .usage = SG_USAGE_STREAM,
+                                              .label = "meshlet-indices"});
+    return sg_query_buffer_state(_buffer) == SG_RESOURCESTATE_VALID;
+}
+
+void MeshletCuller::terminate() {
+    sg_destroy_buffer(_buffer);
+    _buffer = {SG_INVALID_ID};
+    _capacity = 0;
+}
+
+void MeshletCuller::begin_frame(const MeshletParams &params) {
+    _params = params;
+    // the buffer only grows, to the next power of two
+    if (_needed > _capacity && _buffer.id != SG_INVALID_ID) {
+        uint32_t capacity = _capacity;
+        while (capacity < _needed) {
+            capacity *= 2;
+        }
+        sg_destroy_buffer(_buffer);
+        init(capacity);
+        log_debug("meshlet culling: %u indices buffer", capacity);
+    }
+    _used = 0;
+    _needed = 0;
+}
+
+void MeshletCuller::cull(Renderable &r, const Camera &cam, const math::Matrix4f &model, RenderStats *stats) {
+    const Mesh &mesh = *r.mesh;
+    if (!_params.enabled || mesh.meshlets.empty() || r.lod != 0 || r.instances.id != SG_INVALID_ID ||
+        _buffer.id == SG_INVALID_ID) {
+        r.reset_culling();
+        return;
+    }
+    const double start = now_ms();
+
+    // the frustum planes and the eye in the space of the mesh, where the bounds are
+    CullKernel k;
+    k.bounds = mesh.meshlet_bounds.data();
+    k.stride = mesh.meshlet_stride();
+    k.frustum = _params.frustum;
+    const math::Matrix4f model_view = cam.inverse_transform() * model;
+    frustum_planes(cam.projection() * model_view, k.planes);
+    for (math::Vector4f &p : k.planes) {
+        const float length = math::length(math::Vector3f{p.x, p.y, p.z});
+        p = length > 0.0f ? p * (1.0f / length) : math::Vector4f{0.0f, 0.0f, 0.0f, 1.0f};
+    }
+    k.cone = _params.cone;
+    const bool orthographic = cam.projection()(3, 2) == 0.0f;
+    k.eye = math::inverse(model_view) *
+            (orthographic ? math::Vector4f{0.0f, 0.0f, 1.0f, 0.0f} : math::Vector4f{0.0f, 0.0f, 0.0f, 1.0f});
+    if (!orthographic && k.eye.w != 0.0f) {
+        k.eye = k.eye * (1.0f / k.eye.w);
+    }
+    _visible.resize(k.stride);
+    if (_params.simd) {
+        cull_kernel<fw>(k, k.stride, _visible.data());
+    } else {
+        cull_kernel<f1>(k, k.stride, _visible.data());
+    }
+
+    // indices of the visible meshlets, the consecutive ones copied at once
+    const std::vector<Meshlet> &meshlets = mesh.meshlets;
+    _indices.clear();
+    uint32_t num_visible = 0;
+    for (size_t i = 0; i < meshlets.size();) {
+        if (!_visible[i]) {
+            i++;
+            continue;
+        }
+        const uint32_t begin = meshlets[i].first_index;
+        uint32_t end = begin + meshlets[i].num_indices;
+        size_t j = i + 1;
+        while (j < meshlets.size() && _visible[j] && meshlets[j].first_index == end) {
+            end += meshlets[j++].num_indices;
+        }
+        _indices.insert(_indices.end(), mesh.indices.begin() + begin, mesh.indices.begin() + end);
+        num_visible += uint32_t(j - i);
+        i = j;
+    }
+    if (num_visible == meshlets.size()) {
+        r.reset_culling();
+    } else if (_indices.empty()) {
+        r.culled = true;
+        r.num_culled_indices = 0;
+    } else {
+        const uint32_t count = uint32_t(_indices.size());
+        _needed += count;
+        if (_used + count > _capacity) {
+            r.reset_culling();
+        } else {
+            r.bind.index_buffer = _buffer;
+            r.bind.index_buffer_offset = sg_append_buffer(_buffer, {_indices.data(), count * sizeof(uint32_t)});
+            r.culled = true;
+            r.num_culled_indices = count;
+            _used += count;
+        }
+    }
+    if (stats) {
+        stats->num_meshlets += uint32_t(meshlets.size());
+        stats->num_meshlets_visible += num_visible;
+        stats->meshlet_cull_ms += float(now_ms() - start);
+    }
+}
+
+} // namespace glengine
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "gl_prefabs.h"
+#include "gl_types.h"
+
+#include "sokol_gfx.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace glengine {
+
+class Camera;
+struct Renderable;
+struct RenderStats;
+
+struct MeshletOptions {
+    uint32_t max_vertices = 64;   ///< distinct positions of a meshlet
+    uint32_t max_triangles = 124; ///< of a meshlet
+    float cone_weight = 0.5f;     ///< of the normals against the distance when growing a meshlet, for tighter cones
+};
+
+/// split the full level of md (all the indices without levels of detail) in meshlets, and set md.meshlets: the
+/// triangles are reordered so that each meshlet is a range of the indices, in their previous order within it (the
+/// order of the vertex cache optimization is mostly kept). A meshlet grows from a seed triangle by
+/// its neighbours across the edges (and the attribute seams), preferring the ones adding the fewest vertices, then
+/// the closest to its center and with the normal the closest to its average. The triangles face the side of their
+/// vertex normals for the cones. Returns the number of meshlets
+uint32_t build_meshlets(MeshData &md, const MeshletOptions &options = {});
+
+/// culling of the meshlets (see MeshletCuller)
+struct MeshletParams {
+    bool enabled = true; ///< else the meshes are drawn whole
+    bool frustum = true; ///< cull the meshlets out of the view frustum
+    /// cull the meshlets facing away from the camera. The materials draw both sides of the triangles: only for closed
+    /// meshes, or surfaces that are never seen from behind
+    bool cone = true;
+    bool simd = true; ///< scalar tests when false, for comparison
+};
+
+/// culls the meshlets of the renderables against the frustum and by their normal cones when they are drawn, and
+/// writes the indices of the visible ones to a stream index buffer shared by the frame, drawn in place of the
+/// indices of the mesh. The tests run on the bounds of 4 or 8 meshlets at once (SSE or AVX2), in the space of the
+/// mesh. Renderables with all their meshlets visible keep their indices, instanced ones and the coarser levels of
+/// detail are not culled. The buffer grows at the beginning of a frame when the previous one needed more, the
+/// renderables that overflow it are drawn whole
+class MeshletCuller {
+  public:
+    bool init(uint32_t capacity = 1u << 20);
+    void terminate();
+
+    /// at the beginning of a frame, before the objects are drawn
+    void begin_frame(const MeshletParams &params);
+    /// cull the meshlets of r with the model transform, and point its bindings at the visible ones (see
+    /// Renderable::culled), or back at the indices of its mesh. Adds the meshlets to stats
+    void cull(Renderable &r, const Camera &cam, const math::Matrix4f &model, RenderStats *stats);
+
+    /// indices of the buffer
+    uint32_t capacity() const { return _capacity; }
+
+  private:
+    MeshletParams _params;
+    sg_buffer _buffer = {SG_INVALID_ID};
+    uint32_t _capacity = 0;
+    uint32_t _used = 0;   ///< indices appended by the frame
+    uint32_t _needed = 0; ///< indices the frame would have appended without overflow
+    std::vector<uint8_t> _visible;
+    std::vector<uint32_t> _indices;
+};
+
+} // namespace glengine
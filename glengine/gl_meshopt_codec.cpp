@@ -0,0 +1,692 @@
+#include "gl_meshopt_codec.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// ///////////// //
+// vertex codec  //
+// ///////////// //
+constexpr uint8_t VERTEX_HEADER = 0xa0;
+constexpr size_t VERTEX_BLOCK_SIZE_BYTES = 8192;
+constexpr size_t VERTEX_BLOCK_MAX_SIZE = 256;
+constexpr size_t BYTE_GROUP_SIZE = 16;
+constexpr size_t BYTE_GROUP_DECODE_LIMIT = 24; ///< largest encoded group: 8 bytes of 4 bit values, 16 exceptions
+constexpr size_t TAIL_MAX_SIZE = 32;
+
+// number of vertices per block: the transposed block fits in VERTEX_BLOCK_SIZE_BYTES, in whole byte groups
+size_t vertex_block_size(size_t vertex_size) {
+    size_t result = VERTEX_BLOCK_SIZE_BYTES / vertex_size;
+    result &= ~(BYTE_GROUP_SIZE - 1);
+    return std::min(result, VERTEX_BLOCK_MAX_SIZE);
+}
+
+inline uint8_t zigzag8(uint8_t v) {
+    return uint8_t((int8_t(v) >> 7) ^ (v << 1));
+}
+
+inline uint8_t unzigzag8(uint8_t v) {
+    return uint8_t(-(v & 1) ^ (v >> 1));
+}
+
+// encoded size of a group of 16 bytes with the given bits per value (values that don't fit are stored as extra bytes)
+size_t group_measure(const uint8_t *buffer, int bits) {
+    if (bits == 0) {
+        return std::all_of(buffer, buffer + BYTE_GROUP_SIZE, [](uint8_t v) { return v == 0; }) ? 0 : ~size_t(0);
+    }
+    if (bits == 8) {
+        return BYTE_GROUP_SIZE;
+    }
+    size_t result = BYTE_GROUP_SIZE * bits / 8;
+    const uint8_t sentinel = uint8_t((1 << bits) - 1);
+    for (size_t i = 0; i < BYTE_GROUP_SIZE; i++) {
+        result += buffer[i] >= sentinel;
+    }
+    return result;
+}
+
+void encode_group(std::vector<uint8_t> &data, const uint8_t *buffer, int bits) {
+    if (bits == 0) {
+        return;
+    }
+    if (bits == 8) {
+        data.insert(data.end(), buffer, buffer + BYTE_GROUP_SIZE);
+        return;
+    }
+    // fixed part: bits per value, most significant first. Variable part: the values >= sentinel
+    const size_t per_byte = 8 / bits;
+    const uint8_t sentinel = uint8_t((1 << bits) - 1);
+    for (size_t i = 0; i < BYTE_GROUP_SIZE; i += per_byte) {
+        uint8_t byte = 0;
+        for (size_t k = 0; k < per_byte; k++) {
+            byte = uint8_t((byte << bits) | std::min(buffer[i + k], sentinel));
+        }
+        data.push_back(byte);
+    }
+    for (size_t i = 0; i < BYTE_GROUP_SIZE; i++) {
+        if (buffer[i] >= sentinel) {
+            data.push_back(buffer[i]);
+        }
+    }
+}
+
+// one stream of bytes (size multiple of 16): 2 bits of header per group (0, 2, 4 or 8 bits), then the groups
+void encode_bytes(std::vector<uint8_t> &data, const uint8_t *buffer, size_t size) {
+    const size_t header = data.size();
+    data.resize(data.size() + (size / BYTE_GROUP_SIZE + 3) / 4, 0);
+    for (size_t i = 0; i < size; i += BYTE_GROUP_SIZE) {
+        int best_bits = 8;
+        size_t best_size = group_measure(buffer + i, 8);
+        for (int bits : {0, 2, 4}) {
+            const size_t group_size = group_measure(buffer + i, bits);
+            if (group_size < best_size) {
+                best_bits = bits;
+                best_size = group_size;
+            }
+        }
+        const int bitslog2 = best_bits == 0 ? 0 : best_bits == 2 ? 1 : best_bits == 4 ? 2 : 3;
+        const size_t group = i / BYTE_GROUP_SIZE;
+        data[header + group / 4] |= uint8_t(bitslog2 << ((group % 4) * 2));
+        encode_group(data, buffer + i, best_bits);
+    }
+}
+
+const uint8_t *decode_group(const uint8_t *data, uint8_t *buffer, int bitslog2) {
+    switch (bitslog2) {
+    case 0:
+        memset(buffer, 0, BYTE_GROUP_SIZE);
+        return data;
+    case 1: {
+        const uint8_t *extra = data + 4;
+        for (size_t i = 0; i < 4; i++) {
+            const uint8_t byte = data[i];
+            for (int k = 0; k < 4; k++) {
+                const uint8_t v = (byte >> (6 - 2 * k)) & 3;
+                buffer[i * 4 + k] = v == 3 ? *extra++ : v;
+            }
+        }
+        return extra;
+    }
+    case 2: {
+        const uint8_t *extra = data + 8;
+        for (size_t i = 0; i < 8; i++) {
+            const uint8_t byte = data[i];
+            const uint8_t hi = byte >> 4, lo = byte & 15;
+            buffer[i * 2] = hi == 15 ? *extra++ : hi;
+            buffer[i * 2 + 1] = lo == 15 ? *extra++ : lo;
+        }
+        return extra;
+    }
+    default:
+        memcpy(buffer, data, BYTE_GROUP_SIZE);
+        return data + BYTE_GROUP_SIZE;
+    }
+}
+
+const uint8_t *decode_bytes(const uint8_t *data, const uint8_t *data_end, uint8_t *buffer, size_t size) {
+    const size_t header_size = (size / BYTE_GROUP_SIZE + 3) / 4;
+    if (size_t(data_end - data) < header_size) {
+        return nullptr;
+    }
+    const uint8_t *header = data;
+    data += header_size;
+    for (size_t i = 0; i < size; i += BYTE_GROUP_SIZE) {
+        // the tail after the last block guarantees that a valid stream always has this much data left
+        if (size_t(data_end - data) < BYTE_GROUP_DECODE_LIMIT) {
+            return nullptr;
+        }
+        const size_t group = i / BYTE_GROUP_SIZE;
+        data = decode_group(data, buffer + i, (header[group / 4] >> ((group % 4) * 2)) & 3);
+    }
+    return data;
+}
+
+#if defined(__SSE2__)
+inline __m128i unzigzag8(__m128i v) {
+    const __m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(v, _mm_set1_epi8(1)));
+    const __m128i value = _mm_and_si128(_mm_srli_epi16(v, 1), _mm_set1_epi8(127));
+    return _mm_xor_si128(sign, value);
+}
+
+// deltas of 4 consecutive bytes of the vertices (4 streams of count bytes, count multiple of 16) added to the previous
+// vertex: the streams are transposed to one 32 bit lane per vertex, and accumulated with a prefix sum of the lanes
+void decode_deltas4(const uint8_t streams[4][VERTEX_BLOCK_MAX_SIZE], size_t count, uint8_t *vertices,
+                    size_t vertex_size, const uint8_t *last) {
+    int32_t last4;
+    memcpy(&last4, last, 4);
+    __m128i prev = _mm_set1_epi32(last4);
+    for (size_t i = 0; i < count; i += 16) {
+        const __m128i b0 = unzigzag8(_mm_loadu_si128((const __m128i *)(streams[0] + i)));
+        const __m128i b1 = unzigzag8(_mm_loadu_si128((const __m128i *)(streams[1] + i)));
+        const __m128i b2 = unzigzag8(_mm_loadu_si128((const __m128i *)(streams[2] + i)));
+        const __m128i b3 = unzigzag8(_mm_loadu_si128((const __m128i *)(streams[3] + i)));
+        const __m128i t0 = _mm_unpacklo_epi8(b0, b1);
+        const __m128i t1 = _mm_unpackhi_epi8(b0, b1);
+        const __m128i t2 = _mm_unpacklo_epi8(b2, b3);
+        const __m128i t3 = _mm_unpackhi_epi8(b2, b3);
+        __m128i rows[4] = {_mm_unpacklo_epi16(t0, t2), _mm_unpackhi_epi16(t0, t2), _mm_unpacklo_epi16(t1, t3),
+                           _mm_unpackhi_epi16(t1, t3)};
+        for (int r = 0; r < 4; r++) {
+            __m128i v = rows[r];
+            v = _mm_add_epi8(v, _mm_slli_si128(v, 4));
+            v = _mm_add_epi8(v, _mm_slli_si128(v, 8));
+            v = _mm_add_epi8(v, prev);
+            prev = _mm_shuffle_epi32(v, 0xff);
+            uint8_t *out = vertices + (i + r * 4) * vertex_size;
+            for (int k = 0; k < 4; k++) {
+                const int32_t value = _mm_cvtsi128_si32(v);
+                memcpy(out + k * vertex_size, &value, 4);
+                v = _mm_srli_si128(v, 4);
+            }
+        }
+    }
+}
+#else
+void decode_deltas4(const uint8_t streams[4][VERTEX_BLOCK_MAX_SIZE], size_t count, uint8_t *vertices,
+                    size_t vertex_size, const uint8_t *last) {
+    for (size_t k = 0; k < 4; k++) {
+        uint8_t p = last[k];
+        for (size_t i = 0; i < count; i++) {
+            p = uint8_t(unzigzag8(streams[k][i]) + p);
+            vertices[i * vertex_size + k] = p;
+        }
+    }
+}
+#endif
+
+const uint8_t *decode_vertex_block(const uint8_t *data, const uint8_t *data_end, uint8_t *vertices, size_t count,
+                                   size_t vertex_size, uint8_t last[256]) {
+    uint8_t streams[4][VERTEX_BLOCK_MAX_SIZE];
+    uint8_t transposed[VERTEX_BLOCK_SIZE_BYTES];
+    const size_t count_aligned = (count + BYTE_GROUP_SIZE - 1) & ~(BYTE_GROUP_SIZE - 1);
+    for (size_t k = 0; k < vertex_size; k += 4) {
+        for (size_t j = 0; j < 4; j++) {
+            data = decode_bytes(data, data_end, streams[j], count_aligned);
+            if (!data) {
+                return nullptr;
+            }
+        }
+        decode_deltas4(streams, count_aligned, transposed + k, vertex_size, last + k);
+    }
+    memcpy(vertices, transposed, count * vertex_size);
+    memcpy(last, transposed + vertex_size * (count - 1), vertex_size);
+    return data;
+}
+
+// //////////// //
+// index codec  //
+// //////////// //
+constexpr uint8_t INDEX_HEADER = 0xe0;
+constexpr uint8_t SEQUENCE_HEADER = 0xd0;
+constexpr int INDEX_VERSION = 1;
+
+/// pairs of (b, c) vertex FIFO codes of the triangles starting a new strip, the most frequent ones are stored in the
+/// stream and referenced with 4 bits. Entries can't use code 15 (explicit index)
+constexpr uint8_t CODE_AUX_TABLE[16] = {0x00, 0x76, 0x87, 0x56, 0x67, 0x78, 0xa9, 0x86,
+                                        0x65, 0x89, 0x68, 0x98, 0x01, 0x69, 0x00, 0x00};
+
+constexpr uint32_t TRIANGLE_INDEX_ORDER[3][3] = {{0, 1, 2}, {1, 2, 0}, {2, 0, 1}};
+
+struct IndexFifos {
+    uint32_t edges[16][2];
+    uint32_t vertices[16];
+    size_t edge_offset = 0;
+    size_t vertex_offset = 0;
+
+    IndexFifos() {
+        memset(edges, -1, sizeof(edges));
+        memset(vertices, -1, sizeof(vertices));
+    }
+
+    void push_edge(uint32_t a, uint32_t b) {
+        edges[edge_offset][0] = a;
+        edges[edge_offset][1] = b;
+        edge_offset = (edge_offset + 1) & 15;
+    }
+    void push_vertex(uint32_t v, bool cond = true) {
+        vertices[vertex_offset] = v;
+        vertex_offset = (vertex_offset + cond) & 15;
+    }
+    /// position of the edge matching one of the edges of the triangle (fifo index << 2 | rotation), or -1
+    int find_edge(uint32_t a, uint32_t b, uint32_t c) const {
+        for (int i = 0; i < 16; i++) {
+            const size_t index = (edge_offset - 1 - i) & 15;
+            const uint32_t e0 = edges[index][0], e1 = edges[index][1];
+            if (e0 == a && e1 == b) {
+                return (i << 2) | 0;
+            }
+            if (e0 == b && e1 == c) {
+                return (i << 2) | 1;
+            }
+            if (e0 == c && e1 == a) {
+                return (i << 2) | 2;
+            }
+        }
+        return -1;
+    }
+    int find_vertex(uint32_t v) const {
+        for (int i = 0; i < 16; i++) {
+            if (vertices[(vertex_offset - 1 - i) & 15] == v) {
+                return i;
+            }
+        }
+        return -1;
+    }
+};
+
+void encode_vbyte(std::vector<uint8_t> &data, uint32_t v) {
+    while (v >= 128) {
+        data.push_back(uint8_t((v & 127) | 128));
+        v >>= 7;
+    }
+    data.push_back(uint8_t(v));
+}
+
+uint32_t decode_vbyte(const uint8_t *&data) {
+    uint32_t result = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        const uint8_t byte = *data++;
+        result |= uint32_t(byte & 127) << shift;
+        if (byte < 128) {
+            break;
+        }
+    }
+    return result;
+}
+
+void encode_index(std::vector<uint8_t> &data, uint32_t index, uint32_t last) {
+    const uint32_t d = index - last;
+    encode_vbyte(data, (d << 1) ^ uint32_t(int32_t(d) >> 31));
+}
+
+uint32_t decode_index(const uint8_t *&data, uint32_t last) {
+    const uint32_t v = decode_vbyte(data);
+    return last + ((v >> 1) ^ uint32_t(-int32_t(v & 1)));
+}
+
+inline void write_index(void *dst, size_t i, size_t size, uint32_t v) {
+    if (size == 2) {
+        static_cast<uint16_t *>(dst)[i] = uint16_t(v);
+    } else {
+        static_cast<uint32_t *>(dst)[i] = v;
+    }
+}
+
+// //////// //
+// filters  //
+// //////// //
+template <typename T> void decode_filter_oct(T *data, size_t count) {
+    const float max = float((1 << (sizeof(T) * 8 - 1)) - 1);
+    for (size_t i = 0; i < count; i++) {
+        // z is reconstructed from x and y, with the encoded z holding 1.0 at the same precision
+        float x = float(data[i * 4 + 0]);
+        float y = float(data[i * 4 + 1]);
+        const float z = float(data[i * 4 + 2]) - std::fabs(x) - std::fabs(y);
+        const float t = std::min(z, 0.0f);
+        x += x >= 0.0f ? t : -t;
+        y += y >= 0.0f ? t : -t;
+        const float s = max / std::sqrt(x * x + y * y + z * z);
+        data[i * 4 + 0] = T(std::lround(x * s));
+        data[i * 4 + 1] = T(std::lround(y * s));
+        data[i * 4 + 2] = T(std::lround(z * s));
+    }
+}
+
+void decode_filter_quat(int16_t *data, size_t count) {
+    const float scale = 1.0f / std::sqrt(2.0f);
+    for (size_t i = 0; i < count; i++) {
+        // the 2 low bits of w are the index of the largest component (omitted), the others its scale
+        const int sf = data[i * 4 + 3] | 3;
+        const float ss = scale / float(sf);
+        const float x = float(data[i * 4 + 0]) * ss;
+        const float y = float(data[i * 4 + 1]) * ss;
+        const float z = float(data[i * 4 + 2]) * ss;
+        const float w = std::sqrt(std::max(1.0f - x * x - y * y - z * z, 0.0f));
+        const int qc = data[i * 4 + 3] & 3;
+        data[i * 4 + ((qc + 1) & 3)] = int16_t(std::lround(x * 32767.0f));
+        data[i * 4 + ((qc + 2) & 3)] = int16_t(std::lround(y * 32767.0f));
+        data[i * 4 + ((qc + 3) & 3)] = int16_t(std::lround(z * 32767.0f));
+        data[i * 4 + ((qc + 0) & 3)] = int16_t(std::lround(w * 32767.0f));
+    }
+}
+
+void decode_filter_exp(uint32_t *data, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        const uint32_t v = data[i];
+        const int32_t mantissa = int32_t(v << 8) >> 8;
+        const int32_t exponent = int32_t(v) >> 24;
+        const float f = std::ldexp(float(mantissa), exponent);
+        memcpy(&data[i], &f, sizeof(f));
+    }
+}
+
+} // namespace
+
+namespace glengine {
+
+bool meshopt_decode_vertex_buffer(void *dst, size_t count, size_t size, const uint8_t *data, size_t data_size) {
+    if (size == 0 || size > 256 || size % 4 != 0 || data_size < 1 + size) {
+        return false;
+    }
+    const uint8_t *data_end = data + data_size;
+    if ((data[0] & 0xf0) != VERTEX_HEADER || (data[0] & 0x0f) > 0) {
+        return false;
+    }
+    data++;
+    // the first vertex is stored at the end of the stream, as the base of the deltas of the first block
+    uint8_t last[256];
+    memcpy(last, data_end - size, size);
+    uint8_t *vertices = static_cast<uint8_t *>(dst);
+    const size_t block_size = vertex_block_size(size);
+    for (size_t offset = 0; offset < count; offset += block_size) {
+        data = decode_vertex_block(data, data_end, vertices + offset * size, std::min(block_size, count - offset),
+                                   size, last);
+        if (!data) {
+            return false;
+        }
+    }
+    return size_t(data_end - data) == std::max(size, TAIL_MAX_SIZE);
+}
+
+void meshopt_encode_vertex_buffer(const void *vertices, size_t count, size_t size, std::vector<uint8_t> &data) {
+    assert(size > 0 && size <= 256 && size % 4 == 0);
+    const uint8_t *src = static_cast<const uint8_t *>(vertices);
+    data.clear();
+    data.push_back(VERTEX_HEADER);
+    uint8_t first[256] = {};
+    if (count > 0) {
+        memcpy(first, src, size);
+    }
+    uint8_t last[256];
+    memcpy(last, first, size);
+    uint8_t buffer[VERTEX_BLOCK_MAX_SIZE];
+    const size_t block_size = vertex_block_size(size);
+    for (size_t offset = 0; offset < count; offset += block_size) {
+        const size_t n = std::min(block_size, count - offset);
+        const size_t n_aligned = (n + BYTE_GROUP_SIZE - 1) & ~(BYTE_GROUP_SIZE - 1);
+        const uint8_t *block = src + offset * size;
+        for (size_t k = 0; k < size; k++) {
+            memset(buffer, 0, sizeof(buffer));
+            uint8_t p = last[k];
+            for (size_t i = 0; i < n; i++) {
+                buffer[i] = zigzag8(uint8_t(block[i * size + k] - p));
+                p = block[i * size + k];
+            }
+            encode_bytes(data, buffer, n_aligned);
+        }
+        memcpy(last, block + (n - 1) * size, size);
+    }
+    // the tail (first vertex, padded to 32 bytes) lets the decoder read whole groups without bounds checks
+    if (size < TAIL_MAX_SIZE) {
+        data.resize(data.size() + TAIL_MAX_SIZE - size, 0);
+    }
+    data.insert(data.end(), first, first + size);
+}
+
+bool meshopt_decode_index_buffer(void *dst, size_t count, size_t size, const uint8_t *data, size_t data_size) {
+    // smallest valid stream: header, one code per triangle and the 16 bytes table
+    if (count % 3 != 0 || (size != 2 && size != 4) || data_size < 1 + count / 3 + 16) {
+        return false;
+    }
+    if ((data[0] & 0xf0) != INDEX_HEADER || (data[0] & 0x0f) > INDEX_VERSION) {
+        return false;
+    }
+    const int version = data[0] & 0x0f;
+    const int fecmax = version >= 1 ? 13 : 15;
+    IndexFifos fifo;
+    uint32_t next = 0, last = 0;
+    const uint8_t *code = data + 1;
+    const uint8_t *extra = code + count / 3;
+    // each triangle reads at most 16 bytes of extra data (an aux byte and 3 varints), the table at the end of the
+    // stream is the padding that makes this safe
+    const uint8_t *extra_safe_end = data + data_size - 16;
+    const uint8_t *code_aux_table = extra_safe_end;
+    for (size_t i = 0; i < count; i += 3) {
+        if (extra > extra_safe_end) {
+            return false;
+        }
+        const uint8_t codetri = *code++;
+        uint32_t a, b, c;
+        if (codetri < 0xf0) {
+            // edge from the fifo, and the third vertex: new, from the fifo, or encoded
+            const int fe = codetri >> 4;
+            a = fifo.edges[(fifo.edge_offset - 1 - fe) & 15][0];
+            b = fifo.edges[(fifo.edge_offset - 1 - fe) & 15][1];
+            const int fec = codetri & 15;
+            bool push = true;
+            if (fec == 0) {
+                c = next++;
+            } else if (fec < fecmax) {
+                c = fifo.vertices[(fifo.vertex_offset - 1 - fec) & 15];
+                push = false;
+            } else {
+                // 13 and 14 are the previous encoded index -1 and +1
+                c = last = fec != 15 ? last + (fec == 13 ? -1 : 1) : decode_index(extra, last);
+            }
+            write_index(dst, i + 0, size, a);
+            write_index(dst, i + 1, size, b);
+            write_index(dst, i + 2, size, c);
+            fifo.push_vertex(c, push);
+            fifo.push_edge(c, b);
+            fifo.push_edge(a, c);
+        } else {
+            // new triangle: a is next (or encoded), b and c are new, from the fifo, or encoded
+            int fea = 0, feb, fec;
+            if (codetri < 0xfe) {
+                const uint8_t codeaux = code_aux_table[codetri & 15];
+                feb = codeaux >> 4;
+                fec = codeaux & 15;
+            } else {
+                const uint8_t codeaux = *extra++;
+                fea = codetri == 0xfe ? 0 : 15;
+                feb = codeaux >> 4;
+                fec = codeaux & 15;
+                if (codeaux == 0) { // restart
+                    next = 0;
+                }
+            }
+            a = fea == 0 ? next++ : 0;
+            b = feb == 0 ? next++ : fifo.vertices[(fifo.vertex_offset - feb) & 15];
+            c = fec == 0 ? next++ : fifo.vertices[(fifo.vertex_offset - fec) & 15];
+            if (fea == 15) {
+                last = a = decode_index(extra, last);
+            }
+            if (feb == 15) {
+                last = b = decode_index(extra, last);
+            }
+            if (fec == 15) {
+                last = c = decode_index(extra, last);
+            }
+            write_index(dst, i + 0, size, a);
+            write_index(dst, i + 1, size, b);
+            write_index(dst, i + 2, size, c);
+            fifo.push_vertex(a);
+            fifo.push_vertex(b, feb == 0 || feb == 15);
+            fifo.push_vertex(c, fec == 0 || fec == 15);
+            fifo.push_edge(b, a);
+            fifo.push_edge(c, b);
+            fifo.push_edge(a, c);
+        }
+    }
+    // all the extra data must have been read, up to the table
+    return extra == extra_safe_end;
+}
+
+void meshopt_encode_index_buffer(const uint32_t *indices, size_t count, std::vector<uint8_t> &data) {
+    assert(count % 3 == 0);
+    // codes are written first, one per triangle, then the extra data
+    std::vector<uint8_t> extra;
+    data.assign(1 + count / 3, 0);
+    data[0] = INDEX_HEADER | INDEX_VERSION;
+    IndexFifos fifo;
+    uint32_t next = 0, last = 0;
+    const int fecmax = 13;
+    for (size_t i = 0; i < count; i += 3) {
+        uint8_t &code = data[1 + i / 3];
+        const int fer = fifo.find_edge(indices[i + 0], indices[i + 1], indices[i + 2]);
+        if (fer >= 0 && (fer >> 2) < 15) {
+            // the triangle shares an edge with a recent one, rotated so that the shared edge is a-b
+            const uint32_t *order = TRIANGLE_INDEX_ORDER[fer & 3];
+            const uint32_t a = indices[i + order[0]], b = indices[i + order[1]], c = indices[i + order[2]];
+            const int fe = fer >> 2;
+            const int fc = fifo.find_vertex(c);
+            int fec = (fc >= 1 && fc < fecmax) ? fc : (c == next) ? (next++, 0) : 15;
+            if (fec == 15) {
+                if (c + 1 == last) {
+                    fec = 13, last = c;
+                } else if (c == last + 1) {
+                    fec = 14, last = c;
+                }
+            }
+            code = uint8_t((fe << 4) | fec);
+            if (fec == 15) {
+                encode_index(extra, c, last), last = c;
+            }
+            if (fec == 0 || fec >= fecmax) {
+                fifo.push_vertex(c);
+            }
+            fifo.push_edge(c, b);
+            fifo.push_edge(a, c);
+        } else {
+            // rotate the triangle so that a is the next new vertex when possible
+            const uint32_t i0 = indices[i + 0], i1 = indices[i + 1], i2 = indices[i + 2];
+            const int rotation = i1 == next ? 1 : i2 == next ? 2 : 0;
+            const uint32_t *order = TRIANGLE_INDEX_ORDER[rotation];
+            const uint32_t a = indices[i + order[0]], b = indices[i + order[1]], c = indices[i + order[2]];
+            (void)i0;
+            // 0 1 2 restarts the numbering (concatenated meshes)
+            bool reset = false;
+            if (a == 0 && b == 1 && c == 2 && next > 0) {
+                reset = true;
+                next = 0;
+                memset(fifo.vertices, -1, sizeof(fifo.vertices));
+            }
+            const int fb = fifo.find_vertex(b);
+            const int fc = fifo.find_vertex(c);
+            const int fea = (a == next) ? (next++, 0) : 15;
+            const int feb = (fb >= 0 && fb < 14) ? (fb + 1) : (b == next) ? (next++, 0) : 15;
+            const int fec = (fc >= 0 && fc < 14) ? (fc + 1) : (c == next) ? (next++, 0) : 15;
+            const uint8_t codeaux = uint8_t((feb << 4) | fec);
+            int codeaux_index = -1;
+            for (int t = 0; t < 14; t++) {
+                if (CODE_AUX_TABLE[t] == codeaux) {
+                    codeaux_index = t;
+                    break;
+                }
+            }
+            if (fea == 0 && codeaux_index >= 0 && !reset) {
+                code = uint8_t(0xf0 | codeaux_index);
+            } else {
+                code = uint8_t(0xf0 | 14 | fea);
+                extra.push_back(codeaux);
+            }
+            if (fea == 15) {
+                encode_index(extra, a, last), last = a;
+            }
+            if (feb == 15) {
+                encode_index(extra, b, last), last = b;
+            }
+            if (fec == 15) {
+                encode_index(extra, c, last), last = c;
+            }
+            if (fea == 0 || fea == 15) {
+                fifo.push_vertex(a);
+            }
+            if (feb == 0 || feb == 15) {
+                fifo.push_vertex(b);
+            }
+            if (fec == 0 || fec == 15) {
+                fifo.push_vertex(c);
+            }
+            fifo.push_edge(b, a);
+            fifo.push_edge(c, b);
+            fifo.push_edge(a, c);
+        }
+    }
+    data.insert(data.end(), extra.begin(), extra.end());
+    data.insert(data.end(), CODE_AUX_TABLE, CODE_AUX_TABLE + 16);
+}
+
+bool meshopt_decode_index_sequence(void *dst, size_t count, size_t size, const uint8_t *data, size_t data_size) {
+    // smallest valid stream: header, one byte per index and a 4 bytes tail
+    if ((size != 2 && size != 4) || data_size < 1 + count + 4) {
+        return false;
+    }
+    if ((data[0] & 0xf0) != SEQUENCE_HEADER || (data[0] & 0x0f) > INDEX_VERSION) {
+        return false;
+    }
+    const uint8_t *p = data + 1;
+    // each index reads at most 5 bytes, the tail makes this safe
+    const uint8_t *safe_end = data + data_size - 4;
+    uint32_t last[2] = {0, 0};
+    for (size_t i = 0; i < count; i++) {
+        if (p >= safe_end) {
+            return false;
+        }
+        uint32_t v = decode_vbyte(p);
+        // the low bit selects one of the 2 baselines the delta is relative to
+        const uint32_t current = v & 1;
+        v >>= 1;
+        const uint32_t index = last[current] + ((v >> 1) ^ uint32_t(-int32_t(v & 1)));
+        last[current] = index;
+        write_index(dst, i, size, index);
+    }
+    return p == safe_end;
+}
+
+void meshopt_encode_index_sequence(const uint32_t *indices, size_t count, std::vector<uint8_t> &data) {
+    data.clear();
+    data.push_back(SEQUENCE_HEADER | INDEX_VERSION);
+    uint32_t last[2] = {0, 0};
+    uint32_t current = 0;
+    for (size_t i = 0; i < count; i++) {
+        const uint32_t index = indices[i];
+        // switch baseline when the delta gets too large to fit in one byte
+        const int32_t cd = int32_t(index - last[current]);
+        current ^= uint32_t((cd < 0 ? -cd : cd) >= 30);
+        const uint32_t d = index - last[current];
+        const uint32_t v = (d << 1) ^ uint32_t(int32_t(d) >> 31);
+        encode_vbyte(data, (v << 1) | current);
+        last[current] = index;
+    }
+    data.resize(data.size() + 4, 0);
+}
+
+bool meshopt_decode_filter(MeshoptFilter filter, void *data, size_t count, size_t size) {
+    switch (filter) {
+    case MeshoptFilter::None:
+        return true;
+    case MeshoptFilter::Octahedral:
+        if (size == 4) {
+            decode_filter_oct(static_cast<int8_t *>(data), count);
+            return true;
+        }
+        if (size == 8) {
+            decode_filter_oct(static_cast<int16_t *>(data), count);
+            return true;
+        }
+        return false;
+    case MeshoptFilter::Quaternion:
+        if (size != 8) {
+            return false;
+        }
+        decode_filter_quat(static_cast<int16_t *>(data), count);
+        return true;
+    case MeshoptFilter::Exponential:
+        if (size % 4 != 0) {
+            return false;
+        }
+        decode_filter_exp(static_cast<uint32_t *>(data), count * (size / 4));
+        return true;
+    }
+    return false;
+}
+
+} // namespace glengine
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace glengine {
+
+// codecs of the EXT_meshopt_compression gltf extension (meshoptimizer vertex codec version 0, index codec version 1).
+// Vertex buffers are encoded in blocks of vertices, one byte stream per byte of the vertex: the deltas to the previous
+// vertex are zigzag encoded and packed in groups of 16 bytes using 0, 2, 4 or 8 bits. Triangle indices are encoded
+// with a FIFO of recent edges and vertices, and index sequences as varint deltas. Decoders validate their input and
+// return false on invalid data, they never read or write out of bounds
+
+/// decode count vertices of size bytes (multiple of 4, at most 256)
+bool meshopt_decode_vertex_buffer(void *dst, size_t count, size_t size, const uint8_t *data, size_t data_size);
+/// decode count indices (multiple of 3) of size bytes (2 or 4) encoded as triangles
+bool meshopt_decode_index_buffer(void *dst, size_t count, size_t size, const uint8_t *data, size_t data_size);
+/// decode count indices of size bytes (2 or 4) encoded as a sequence
+bool meshopt_decode_index_sequence(void *dst, size_t count, size_t size, const uint8_t *data, size_t data_size);
+
+/// filters applied on top of the vertex codec, to make quantized normals, rotations and floats more compressible
+enum class MeshoptFilter {
+    None,
+    Octahedral,  ///< normals and tangents: 4 x 8 or 16 bit snorm, from octahedral encoding
+    Quaternion,  ///< rotations: 4 x 16 bit snorm, from 3 components and the index of the largest one
+    Exponential, ///< 32 bit floats, from 24 bit mantissa and 8 bit exponent
+};
+
+/// decode the filtered data of count elements of size bytes in place. Returns false for sizes the filter can't handle
+bool meshopt_decode_filter(MeshoptFilter filter, void *data, size_t count, size_t size);
+
+/// encoders, used by the tools to produce compressed assets (lossless, filters are not applied)
+void meshopt_encode_vertex_buffer(const void *vertices, size_t count, size_t size, std::vector<uint8_t> &data);
+/// indices of a triangle list (count multiple of 3), better compressed after optimize_vertex_cache and
+/// optimize_vertex_fetch
+void meshopt_encode_index_buffer(const uint32_t *indices, size_t count, std::vector<uint8_t> &data);
+void meshopt_encode_index_sequence(const uint32_t *indices, size_t count, std::vector<uint8_t> &data);
+
+} // namespace glengine
@@ -0,0 +1,313 @@
+#include "gl_mipmap.h"
+#include "gl_thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+using namespace glengine;
+
+constexpr uint32_t LINEAR_TO_SRGB_TABLE_SIZE = 65536;
+constexpr int KAISER_TAPS = 6;
+
+// lookup tables used to move between 8bit (sRGB or unorm) values and linear floats.
+// decode tables have 512 entries: the first 256 are used for rgb, the second 256 for alpha, so that a single
+// (gather) lookup with an offset of 256 on the alpha lane decodes a full pixel
+struct ColorTables {
+    float srgb_decode[512];
+    float unorm_decode[512];
+    uint8_t srgb_encode[LINEAR_TO_SRGB_TABLE_SIZE];
+    float kaiser_weights[KAISER_TAPS];
+
+    ColorTables() {
+        for (int i = 0; i < 256; i++) {
+            float c = i / 255.0f;
+            srgb_decode[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            srgb_decode[256 + i] = c;
+            unorm_decode[i] = c;
+            unorm_decode[256 + i] = c;
+        }
+        for (uint32_t i = 0; i < LINEAR_TO_SRGB_TABLE_SIZE; i++) {
+            float l = float(i) / (LINEAR_TO_SRGB_TABLE_SIZE - 1);
+            float s = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+            srgb_encode[i] = uint8_t(std::min(std::max(s * 255.0f + 0.5f, 0.0f), 255.0f));
+        }
+        // Kaiser-windowed sinc (alpha=4, radius of 3 source pixels), evaluated at the 6 source pixel centers
+        // around the center of the destination pixel (-2.5 .. 2.5), and normalized
+        auto bessel_i0 = [](double x) {
+            double sum = 1.0, term = 1.0;
+            for (int k = 1; k < 32; k++) {
+                term *= (x / (2.0 * k)) * (x / (2.0 * k));
+                sum += term;
+            }
+            return sum;
+        };
+        const double alpha = 4.0, radius = 3.0;
+        double total = 0.0;
+        double w[KAISER_TAPS];
+        for (int k = 0; k < KAISER_TAPS; k++) {
+            double d = k - 2.5;                      // distance in source pixels
+            double x = d * 0.5;                      // distance in destination pixels (cutoff at dest nyquist)
+            double sinc = std::sin(M_PI * x) / (M_PI * x);
+            double t = d / radius;
+            double window = bessel_i0(alpha * std::sqrt(std::max(0.0, 1.0 - t * t))) / bessel_i0(alpha);
+            w[k] = sinc * window;
+            total += w[k];
+        }
+        for (int k = 0; k < KAISER_TAPS; k++) {
+            kaiser_weights[k] = float(w[k] / total);
+        }
+    }
+};
+
+const ColorTables &color_tables() {
+    static ColorTables tables;
+    return tables;
+}
+
+// ///////////////////////// //
+// 4-wide float (one pixel)  //
+// ///////////////////////// //
+#if defined(__SSE2__)
+struct f4 {
+    __m128 v;
+};
+inline f4 f4_zero() { return {_mm_setzero_ps()}; }
+inline f4 f4_load(const float *p) { return {_mm_loadu_ps(p)}; }
+inline void f4_store(f4 a, float *p) { _mm_storeu_ps(p, a.v); }
+inline f4 f4_set(float r, float g, float b, float a) { return {_mm_set_ps(a, b, g, r)}; }
+inline f4 operator+(f4 a, f4 b) { return {_mm_add_ps(a.v, b.v)}; }
+inline f4 operator*(f4 a, float s) { return {_mm_mul_ps(a.v, _mm_set1_ps(s))}; }
+#else
+struct f4 {
+    float v[4];
+};
+inline f4 f4_zero() { return {{0.0f, 0.0f, 0.0f, 0.0f}}; }
+inline f4 f4_load(const float *p) { return {{p[0], p[1], p[2], p[3]}}; }
+inline void f4_store(f4 a, float *p) { memcpy(p, a.v, sizeof(a.v)); }
+inline f4 f4_set(float r, float g, float b, float a) { return {{r, g, b, a}}; }
+inline f4 operator+(f4 a, f4 b) { return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}}; }
+inline f4 operator*(f4 a, float s) { return {{a.v[0] * s, a.v[1] * s, a.v[2] * s, a.v[3] * s}}; }
+#endif
+
+inline f4 decode_pixel(const uint8_t *p, const float *lut) {
+    return f4_set(lut[p[0]], lut[p[1]], lut[p[2]], lut[256 + p[3]]);
+}
+
+inline uint8_t encode_unorm(float v) {
+    return uint8_t(std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f);
+}
+
+inline uint8_t encode_srgb(float v, const uint8_t *table) {
+    return table[uint32_t(std::min(std::max(v, 0.0f), 1.0f) * (LINEAR_TO_SRGB_TABLE_SIZE - 1) + 0.5f)];
+}
+
+inline void encode_pixel(const float *c, uint8_t *out, bool srgb, const ColorTables &tables) {
+    if (srgb) {
+        out[0] = encode_srgb(c[0], tables.srgb_encode);
+        out[1] = encode_srgb(c[1], tables.srgb_encode);
+        out[2] = encode_srgb(c[2], tables.srgb_encode);
+    } else {
+        out[0] = encode_unorm(c[0]);
+        out[1] = encode_unorm(c[1]);
+        out[2] = encode_unorm(c[2]);
+    }
+    out[3] = encode_unorm(c[3]);
+}
+
+struct LevelJob {
+    const uint8_t *src;
+    uint32_t src_w, src_h;
+    uint8_t *dst;
+    uint32_t dst_w, dst_h;
+    bool srgb;
+};
+
+// ////////// //
+// box filter //
+// ////////// //
+// 2x2 average. An odd source dimension has no pair for its last row or column: the last destination row or column
+// averages 3 source ones instead of dropping it
+void box_filter_rows(const LevelJob &job, uint32_t y0, uint32_t y1) {
+    const ColorTables &tables = color_tables();
+    const float *lut = job.srgb ? tables.srgb_decode : tables.unorm_decode;
+    const bool odd_w = job.src_w > 1 && (job.src_w & 1);
+    const bool odd_h = job.src_h > 1 && (job.src_h & 1);
+    // the destination pixels filtered from 2x2 source ones
+    const uint32_t pair_w = odd_w ? job.dst_w - 1 : job.dst_w;
+    for (uint32_t y = y0; y < y1; y++) {
+        const uint32_t num_rows = (odd_h && y + 1 == job.dst_h) ? 3 : 2;
+        const uint8_t *rows[3];
+        for (uint32_t k = 0; k < 3; k++) {
+            rows[k] = job.src + size_t(std::min(2 * y + k, job.src_h - 1)) * job.src_w * 4;
+        }
+        uint8_t *out = job.dst + size_t(y) * job.dst_w * 4;
+        uint32_t x = 0;
+#if defined(__AVX2__)
+        // two destination pixels per iteration: gather-decode 4 source pixels per row (16 channels)
+        const __m256i alpha_offset = _mm256_setr_epi32(0, 0, 0, 256, 0, 0, 0, 256);
+        const __m256 quarter = _mm256_set1_ps(0.25f);
+        alignas(32) float sum[8];
+        for (; num_rows == 2 && 2 * x + 3 < job.src_w && x + 1 < pair_w; x += 2) {
+            const uint8_t *p0 = rows[0] + 8 * x;
+            const uint8_t *p1 = rows[1] + 8 * x;
+            __m256i i00 = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p0)), alpha_offset);
+            __m256i i01 = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(p0 + 8))), alpha_offset);
+            __m256i i10 = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)p1)), alpha_offset);
+            __m256i i11 = _mm256_add_epi32(_mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(p1 + 8))), alpha_offset);
+            __m256 a = _mm256_add_ps(_mm256_i32gather_ps(lut, i00, 4), _mm256_i32gather_ps(lut, i10, 4));
+            __m256 b = _mm256_add_ps(_mm256_i32gather_ps(lut, i01, 4), _mm256_i32gather_ps(lut, i11, 4));
+            // a = [p(2x) | p(2x+1)], b = [p(2x+2) | p(2x+3)] -> [p(2x)+p(2x+1) | p(2x+2)+p(2x+3)]
+            __m256 s = _mm256_add_ps(_mm256_permute2f128_ps(a, b, 0x20), _mm256_permute2f128_ps(a, b, 0x31));
+            _mm256_store_ps(sum, _mm256_mul_ps(s, quarter));
+            encode_pixel(sum, out + 4 * x, job.srgb, tables);
+            encode_pixel(sum + 4, out + 4 * x + 4, job.srgb, tables);
+        }
+#endif
+        for (; x < job.dst_w; x++) {
+            const uint32_t num_columns = x < pair_w ? 2 : 3;
+            f4 s = f4_zero();
+            for (uint32_t j = 0; j < num_rows; j++) {
+                for (uint32_t i = 0; i < num_columns; i++) {
+                    s = s + decode_pixel(rows[j] + 4 * std::min(2 * x + i, job.src_w - 1), lut);
+                }
+            }
+            float c[4];
+            f4_store(s * (1.0f / float(num_rows * num_columns)), c);
+            encode_pixel(c, out + 4 * x, job.srgb, tables);
+        }
+    }
+}
+
+// ///////////// //
+// kaiser filter //
+// ///////////// //
+// horizontal pass of one source row into dst_w filtered (linear) pixels
+void kaiser_filter_row(const LevelJob &job, uint32_t sy, float *decoded, float *out) {
+    const ColorTables &tables = color_tables();
+    const float *lut = job.srgb ? tables.srgb_decode : tables.unorm_decode;
+    const float *w = tables.kaiser_weights;
+    const uint8_t *row = job.src + size_t(sy) * job.src_w * 4;
+    for (uint32_t x = 0; x < job.src_w; x++) {
+        f4_store(decode_pixel(row + 4 * x, lut), decoded + 4 * x);
+    }
+    const int last = int(job.src_w) - 1;
+    for (uint32_t x = 0; x < job.dst_w; x++) {
+        const int sx = 2 * int(x) - 2;
+        f4 s = f4_zero();
+        if (sx >= 0 && sx + KAISER_TAPS - 1 <= last) {
+            for (int k = 0; k < KAISER_TAPS; k++) {
+                s = s + f4_load(decoded + 4 * (sx + k)) * w[k];
+            }
+        } else { // clamp to edge
+            for (int k = 0; k < KAISER_TAPS; k++) {
+                s = s + f4_load(decoded + 4 * std::min(std::max(sx + k, 0), last)) * w[k];
+            }
+        }
+        f4_store(s, out + 4 * x);
+    }
+}
+
+void kaiser_filter_rows(const LevelJob &job, uint32_t y0, uint32_t y1) {
+    const ColorTables &tables = color_tables();
+    const float *w = tables.kaiser_weights;
+    const int last = int(job.src_h) - 1;
+    // source rows needed by this band (clamped to the image)
+    const int first_row = std::max(2 * int(y0) - 2, 0);
+    const int last_row = std::min(2 * int(y1 - 1) + 3, last);
+    const size_t row_floats = size_t(job.dst_w) * 4;
+    std::vector<float> decoded(size_t(job.src_w) * 4);
+    std::vector<float> rows(size_t(last_row - first_row + 1) * row_floats);
+    for (int sy = first_row; sy <= last_row; sy++) {
+        kaiser_filter_row(job, sy, decoded.data(), rows.data() + (sy - first_row) * row_floats);
+    }
+    // vertical pass
+    std::vector<float> sum(row_floats);
+    for (uint32_t y = y0; y < y1; y++) {
+        const int sy = 2 * int(y) - 2;
+        const float *taps[KAISER_TAPS];
+        for (int k = 0; k < KAISER_TAPS; k++) {
+            taps[k] = rows.data() + (std::min(std::max(sy + k, 0), last) - first_row) * row_floats;
+        }
+        for (uint32_t x = 0; x < job.dst_w; x++) {
+            f4 s = f4_zero();
+            for (int k = 0; k < KAISER_TAPS; k++) {
+                s = s + f4_load(taps[k] + 4 * x) * w[k];
+            }
+            f4_store(s, sum.data() + 4 * x);
+        }
+        uint8_t *out = job.dst + size_t(y) * job.dst_w * 4;
+        for (uint32_t x = 0; x < job.dst_w; x++) {
+            encode_pixel(sum.data() + 4 * x, out + 4 * x, job.srgb, tables);
+        }
+    }
+}
+
+} // namespace
+
+namespace glengine {
+
+uint32_t mip_level_count(uint32_t width, uint32_t height) {
+    uint32_t levels = 1;
+    while ((width > 1 || height > 1) && levels < MipChain::MAX_LEVELS) {
+        width = std::max(width / 2, 1u);
+        height = std::max(height / 2, 1u);
+        levels++;
+    }
+    return levels;
+}
+
+bool build_mip_chain(const uint8_t *pixels, uint32_t width, uint32_t height, MipChain &chain,
+                     const MipChainOptions &options) {
+    if (!pixels || width == 0 || height == 0) {
+        return false;
+    }
+    // compute the layout of the chain, and allocate the whole buffer at once
+    chain.num_levels = std::min(mip_level_count(width, height), std::max(options.max_levels, 1u));
+    size_t total_size = 0;
+    uint32_t w = width, h = height;
+    for (uint32_t level = 0; level < chain.num_levels; level++) {
+        chain.levels[level] = {w, h, total_size, size_t(w) * h * 4};
+        total_size += chain.levels[level].size;
+        w = std::max(w / 2, 1u);
+        h = std::max(h / 2, 1u);
+    }
+    chain.data.resize(total_size);
+    memcpy(chain.data.data(), pixels, chain.levels[0].size);
+    // make sure the lookup tables are initialized before going wide
+    color_tables();
+    // cascade: every level is filtered from the previous one
+    for (uint32_t level = 1; level < chain.num_levels; level++) {
+        const MipChain::Level &src = chain.levels[level - 1];
+        const MipChain::Level &dst = chain.levels[level];
+        LevelJob job{chain.level_data(level - 1), src.width, src.height, chain.level_data(level),
+                     dst.width, dst.height, options.srgb};
+        auto filter_rows = [&job, &options](uint32_t y0, uint32_t y1) {
+            if (options.filter == MipFilter::Kaiser) {
+                kaiser_filter_rows(job, y0, y1);
+            } else {
+                box_filter_rows(job, y0, y1);
+            }
+        };
+        // small levels are not worth the synchronization cost
+        const bool go_wide = options.parallel && size_t(dst.width) * dst.height >= 128 * 128;
+        if (go_wide) {
+            const uint32_t grain = std::max(8u, dst.height / (4 * (default_thread_pool().size() + 1)));
+            parallel_for(0, dst.height, grain, filter_rows);
+        } else {
+            filter_rows(0, dst.height);
+        }
+    }
+    return true;
+}
+
+} // namespace glengine
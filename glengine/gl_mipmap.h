@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace glengine {
+
+/// filter used to downsample a mip level into the next one
+enum class MipFilter {
+    Box,    ///< 2x2 average: fast, slightly blurry. Default for images created at runtime
+    Kaiser, ///< separable 6-tap Kaiser-windowed sinc: sharper, recommended for offline generation
+};
+
+/// mip chain of an rgba8 image, stored in a single contiguous buffer (level 0 first, tightly packed)
+struct MipChain {
+    static constexpr uint32_t MAX_LEVELS = 16; ///< same as SG_MAX_MIPMAPS
+    struct Level {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        size_t offset = 0; ///< byte offset of the level in the data buffer
+        size_t size = 0;   ///< size in bytes of the level
+    };
+
+    uint32_t num_levels = 0;
+    Level levels[MAX_LEVELS];
+    std::vector<uint8_t> data;
+
+    uint8_t *level_data(uint32_t level) { return data.data() + levels[level].offset; }
+    const uint8_t *level_data(uint32_t level) const { return data.data() + levels[level].offset; }
+};
+
+struct MipChainOptions {
+    MipFilter filter = MipFilter::Box;
+    bool srgb = true; ///< rgb channels are sRGB-encoded (color textures); use false for normal maps and other data
+    uint32_t max_levels = MipChain::MAX_LEVELS; ///< limit the number of generated levels (level 0 included)
+    bool parallel = true;                       ///< split the work of each level across the worker threads
+};
+
+/// number of levels of a full mip chain (down to 1x1) for an image of the given size
+uint32_t mip_level_count(uint32_t width, uint32_t height);
+
+/// build the mip chain of an rgba8 image.
+/// Level 0 is a copy of the input, and every level N is filtered from level N-1 (not from the full resolution
+/// image), so the total cost is ~4/3 of a single pass over the source. Filtering is done in linear space, and
+/// the whole chain is written into one buffer allocated upfront.
+bool build_mip_chain(const uint8_t *pixels, uint32_t width, uint32_t height, MipChain &chain,
+                     const MipChainOptions &options = {});
+
+} // namespace glengine
@@ -2,9 +2,11 @@
 #include "gl_camera.h"
 #include "gl_mesh.h"
 #include "gl_logger.h"
+#include "gl_meshlets.h"
 
 #include "microprofile/microprofile.h"
 
+#include <cstring>
 #include <vector>
 #include <set>
 
@@ -74,27 +76,65 @@ Object *Object::detach_child(Object *ro) {
     return nullptr;
 }
 
-bool Object::draw(const Camera &cam, const math::Matrix4f &parent_tf) {
+bool Object::draw(const Camera &cam, const math::Matrix4f &parent_tf, const LodParams &lod, RenderStats *stats,
+                  MeshletCuller *culler) {
+    const Renderable *prev = nullptr;
+    draw_tree(cam, parent_tf, lod, stats, culler, prev);
+    return true;
+}
+
+void Object::draw_tree(const Camera &cam, const math::Matrix4f &parent_tf, const LodParams &lod, RenderStats *stats,
+                       MeshletCuller *culler, const Renderable *&prev) {
     // MICROPROFILE_SCOPEI("renderobject", "draw", MP_AUTO);
     math::Matrix4f curr_tf = parent_tf * _transform * _scale;
     if (_visible) {
         for (auto &go : _renderables) {
             // MICROPROFILE_SCOPEI("renderobject", "render_renderables", MP_AUTO);
             // renderer.render_items.push_back({&cam, &go, curr_tf, _id});
-            go.apply_pipeline();
-            go.apply_bindings();
+            // level of detail and visible meshlets first, they change what is bound
+            const bool switched = go.select_lod(cam, curr_tf, lod);
+            if (culler) {
+                culler->cull(go, cam, curr_tf, stats);
+            } else {
+                go.reset_culling();
+            }
+            if (stats) {
+                stats->num_triangles += uint64_t(go.num_elements()) * go.num_instances / 3;
+                stats->num_triangles_full += uint64_t(go.num_elements(true)) * go.num_instances / 3;
+                stats->num_lod_switches += switched ? 1 : 0;
+            }
+            if (go.culled && go.num_culled_indices == 0) {
+                continue;
+            }
+            // consecutive renderables with the same pipeline and bindings (same mesh, and materials sharing an atlas
+            // or a texture array), in this object or the previous ones, only need their uniforms. Paged meshes bind
+            // their pages when drawn
+            if (!prev || prev->mesh->paged() || prev->pipeline().id != go.pipeline().id ||
+                memcmp(&prev->bind, &go.bind, sizeof(go.bind)) != 0) {
+                go.apply_pipeline();
+                go.apply_bindings();
+                if (stats) {
+                    stats->num_bindings++;
+                }
+            }
+            prev = &go;
             glengine::common_uniform_params_t obj_params;
-            obj_params.model = curr_tf;
+            // quantized positions are mapped to mesh space by the model transform, or by the instance transforms
+            obj_params.model = go.mesh->layout == VertexLayout::Quantized && go.instances.id == SG_INVALID_ID
+                                   ? curr_tf * go.mesh->dequantization
+                                   : curr_tf;
             obj_params.view = cam.inverse_transform();
             obj_params.projection = cam.projection();
             go.apply_uniforms(obj_params);
             go.draw();
+            if (stats) {
+                stats->num_draws++;
+            }
         }
         for (auto &c : _children) {
-            c->draw(cam, curr_tf);
+            c->draw_tree(cam, curr_tf, lod, stats, culler, prev);
         }
     }
-    return true;
 }
 
 Object &Object::set_transform(const math::Matrix4f &tf) {
@@ -10,6 +10,8 @@
 
 namespace glengine {
 
+class MeshletCuller;
+
 class Object final {
   public:
     Object(Object *parent = nullptr, ID id = NULL_ID);
@@ -45,7 +47,15 @@ class Object final {
     Object &set_scale(const math::Vector3f &scl);
     Object &set_visible(bool flag);
 
-    bool draw(const Camera &cam, const math::Matrix4f &parent_tf);
+    /// draw the visible renderables and children, selecting the levels of detail of their meshes with lod, culling
+    /// their meshlets with culler when not null, and counting them in stats when not null. The pipeline and bindings
+    /// are applied only when they differ from the ones of the previous draw, across the objects of the tree
+    bool draw(const Camera &cam, const math::Matrix4f &parent_tf, const LodParams &lod = LodParams(),
+              RenderStats *stats = nullptr, MeshletCuller *culler = nullptr);
+
+    /// draw, with the renderable drawn last (nullptr if none), the bindings of which are still applied
+    void draw_tree(const Camera &cam, const math::Matrix4f &parent_tf, const LodParams &lod, RenderStats *stats,
+                   MeshletCuller *culler, const Renderable *&prev);
 
     // //// //
     // data //
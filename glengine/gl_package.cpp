@@ -0,0 +1,651 @@
+#include "gl_package.h"
+#include "gl_logger.h"
+#include "gl_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+constexpr uint32_t PACKAGE_MAGIC = 0x474B5047; // "GPKG"
+constexpr uint32_t PACKAGE_VERSION = 1;
+constexpr uint64_t PACKAGE_ALIGNMENT = 16;
+
+struct PackageHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t num_entries;
+    uint32_t reserved;
+    uint64_t toc_offset;
+};
+
+// followed by the name (name_length bytes, not null terminated)
+struct PackageTocEntry {
+    uint64_t offset;
+    uint64_t size;
+    uint32_t type;
+    uint32_t name_length;
+};
+
+enum MeshFlags : uint32_t {
+    MESH_NORMALS = 1,   ///< the normals stream is present (otherwise normals are zero)
+    MESH_TANGENTS = 2,  ///< the tangents stream is present (otherwise tangents are zero)
+    MESH_INDEX32 = 4,   ///< 32 bit indices
+    MESH_LODS = 8,      ///< the indices are followed by the levels of detail (count, then MeshLod each)
+    MESH_MESHLETS = 16, ///< then by the meshlets (count, then Meshlet each)
+};
+
+struct MeshHeader {
+    uint32_t num_vertices;
+    uint32_t num_indices;
+    int32_t material;
+    uint32_t flags;
+    float pos_min[3];
+    float pos_extent[3];
+    float uv_min[2];
+    float uv_extent[2];
+};
+
+/// append-only binary writer for the entries data
+class Writer {
+  public:
+    explicit Writer(std::vector<uint8_t> &data)
+    : _data(data) {}
+
+    void write(const void *ptr, size_t size) {
+        const uint8_t *bytes = static_cast<const uint8_t *>(ptr);
+        _data.insert(_data.end(), bytes, bytes + size);
+    }
+    template <typename T> void write(const T &v) { write(&v, sizeof(T)); }
+    void write_string(const std::string &s) {
+        write(uint32_t(s.size()));
+        write(s.data(), s.size());
+    }
+
+  private:
+    std::vector<uint8_t> &_data;
+};
+
+/// bounds-checked reader, every read fails once the end of the data is reached
+class Reader {
+  public:
+    Reader(const uint8_t *data, size_t size)
+    : _data(data)
+    , _size(size) {}
+
+    bool read(void *ptr, size_t size) {
+        if (size > _size - _pos) {
+            _pos = _size;
+            return false;
+        }
+        memcpy(ptr, _data + _pos, size);
+        _pos += size;
+        return true;
+    }
+    template <typename T> bool read(T &v) { return read(&v, sizeof(T)); }
+    size_t remaining() const { return _size - _pos; }
+    bool read_string(std::string &s) {
+        uint32_t length = 0;
+        if (!read(length) || length > _size - _pos) {
+            return false;
+        }
+        s.assign(reinterpret_cast<const char *>(_data + _pos), length);
+        _pos += length;
+        return true;
+    }
+
+  private:
+    const uint8_t *_data;
+    size_t _size;
+    size_t _pos = 0;
+};
+
+uint16_t quantize_unorm16(float v, float min, float extent) {
+    const float t = extent > 0.0f ? (v - min) / extent : 0.0f;
+    return uint16_t(std::lround(std::min(std::max(t, 0.0f), 1.0f) * 65535.0f));
+}
+
+float dequantize_unorm16(uint16_t q, float min, float extent) {
+    return min + float(q) * (extent / 65535.0f);
+}
+
+float sign_not_zero(float v) {
+    return v >= 0.0f ? 1.0f : -1.0f;
+}
+
+// octahedral encoding of a direction (zero vectors are encoded as +z)
+void oct_encode(const math::Vector3f &v, int16_t out[2]) {
+    const float l1 = std::fabs(v.x) + std::fabs(v.y) + std::fabs(v.z);
+    float x = l1 > 0.0f ? v.x / l1 : 0.0f;
+    float y = l1 > 0.0f ? v.y / l1 : 0.0f;
+    if (v.z < 0.0f) {
+        const float ox = (1.0f - std::fabs(y)) * sign_not_zero(x);
+        const float oy = (1.0f - std::fabs(x)) * sign_not_zero(y);
+        x = ox;
+        y = oy;
+    }
+    out[0] = int16_t(std::lround(std::min(std::max(x, -1.0f), 1.0f) * 32767.0f));
+    out[1] = int16_t(std::lround(std::min(std::max(y, -1.0f), 1.0f) * 32767.0f));
+}
+
+math::Vector3f oct_decode(const int16_t in[2]) {
+    float x = std::max(in[0] / 32767.0f, -1.0f);
+    float y = std::max(in[1] / 32767.0f, -1.0f);
+    const float z = 1.0f - std::fabs(x) - std::fabs(y);
+    if (z < 0.0f) {
+        const float ox = (1.0f - std::fabs(y)) * sign_not_zero(x);
+        const float oy = (1.0f - std::fabs(x)) * sign_not_zero(y);
+        x = ox;
+        y = oy;
+    }
+    math::Vector3f v = {x, y, z};
+    math::normalize(v);
+    return v;
+}
+
+uint32_t count_bits(uint8_t mask) {
+    uint32_t count = 0;
+    for (; mask; mask &= mask - 1) {
+        count++;
+    }
+    return count;
+}
+
+bool is_zero(const math::Vector3f &v) {
+    return v.x == 0.0f && v.y == 0.0f && v.z == 0.0f;
+}
+
+} // namespace
+
+namespace glengine {
+
+void encode_mesh(const MeshData &md, int32_t material, std::vector<uint8_t> &data) {
+    MeshHeader header = {};
+    header.num_vertices = uint32_t(md.vertices.size());
+    header.num_indices = uint32_t(md.indices.size());
+    header.material = material;
+    header.flags = md.vertices.size() > 0x10000 ? uint32_t(MESH_INDEX32) : 0u;
+    header.flags |= md.lods.empty() ? 0u : uint32_t(MESH_LODS);
+    header.flags |= md.meshlets.empty() ? 0u : uint32_t(MESH_MESHLETS);
+    float pos_max[3] = {0.0f, 0.0f, 0.0f}, uv_max[2] = {0.0f, 0.0f};
+    for (size_t i = 0; i < md.vertices.size(); i++) {
+        const Vertex &v = md.vertices[i];
+        const float pos[3] = {v.pos.x, v.pos.y, v.pos.z};
+        const float uv[2] = {v.tex_coords.x, v.tex_coords.y};
+        for (int c = 0; c < 3; c++) {
+            header.pos_min[c] = i == 0 ? pos[c] : std::min(header.pos_min[c], pos[c]);
+            pos_max[c] = i == 0 ? pos[c] : std::max(pos_max[c], pos[c]);
+        }
+        for (int c = 0; c < 2; c++) {
+            header.uv_min[c] = i == 0 ? uv[c] : std::min(header.uv_min[c], uv[c]);
+            uv_max[c] = i == 0 ? uv[c] : std::max(uv_max[c], uv[c]);
+        }
+        header.flags |= is_zero(v.normal) ? 0u : uint32_t(MESH_NORMALS);
+        header.flags |= is_zero(v.tangent) ? 0u : uint32_t(MESH_TANGENTS);
+    }
+    for (int c = 0; c < 3; c++) {
+        header.pos_extent[c] = pos_max[c] - header.pos_min[c];
+    }
+    for (int c = 0; c < 2; c++) {
+        header.uv_extent[c] = uv_max[c] - header.uv_min[c];
+    }
+
+    data.clear();
+    Writer w(data);
+    w.write(header);
+    for (const Vertex &v : md.vertices) {
+        const uint16_t q[3] = {quantize_unorm16(v.pos.x, header.pos_min[0], header.pos_extent[0]),
+                               quantize_unorm16(v.pos.y, header.pos_min[1], header.pos_extent[1]),
+                               quantize_unorm16(v.pos.z, header.pos_min[2], header.pos_extent[2])};
+        w.write(q);
+    }
+    for (const Vertex &v : md.vertices) {
+        w.write(v.color);
+    }
+    if (header.flags & MESH_NORMALS) {
+        for (const Vertex &v : md.vertices) {
+            int16_t oct[2];
+            oct_encode(v.normal, oct);
+            w.write(oct);
+        }
+    }
+    for (const Vertex &v : md.vertices) {
+        const uint16_t q[2] = {quantize_unorm16(v.tex_coords.x, header.uv_min[0], header.uv_extent[0]),
+                               quantize_unorm16(v.tex_coords.y, header.uv_min[1], header.uv_extent[1])};
+        w.write(q);
+    }
+    if (header.flags & MESH_TANGENTS) {
+        for (const Vertex &v : md.vertices) {
+            int16_t oct[2];
+            oct_encode(v.tangent, oct);
+            w.write(oct);
+        }
+    }
+    for (uint32_t index : md.indices) {
+        if (header.flags & MESH_INDEX32) {
+            w.write(index);
+        } else {
+            w.write(uint16_t(index));
+        }
+    }
+    if (header.flags & MESH_LODS) {
+        w.write(uint32_t(md.lods.size()));
+        w.write(md.lods.data(), md.lods.size() * sizeof(MeshLod));
+    }
+    if (header.flags & MESH_MESHLETS) {
+        w.write(uint32_t(md.meshlets.size()));
+        w.write(md.meshlets.data(), md.meshlets.size() * sizeof(Meshlet));
+    }
+}
+
+bool decode_mesh(const uint8_t *data, size_t size, MeshData &md, int32_t &material) {
+    Reader r(data, size);
+    MeshHeader header;
+    if (!r.read(header)) {
+        return false;
+    }
+    const size_t index_size = (header.flags & MESH_INDEX32) ? 4 : 2;
+    const size_t vertex_size = 6 + 4 + 4 + ((header.flags & MESH_NORMALS) ? 4 : 0) +
+                               ((header.flags & MESH_TANGENTS) ? 4 : 0);
+    const size_t streams_size = vertex_size * header.num_vertices + index_size * header.num_indices;
+    // the levels of detail and the meshlets follow the streams, checked when read
+    if (size - sizeof(header) < streams_size) {
+        return false;
+    }
+    material = header.material;
+    md.vertices.resize(header.num_vertices);
+    for (Vertex &v : md.vertices) {
+        uint16_t q[3];
+        r.read(q);
+        v.pos = {dequantize_unorm16(q[0], header.pos_min[0], header.pos_extent[0]),
+                 dequantize_unorm16(q[1], header.pos_min[1], header.pos_extent[1]),
+                 dequantize_unorm16(q[2], header.pos_min[2], header.pos_extent[2])};
+    }
+    for (Vertex &v : md.vertices) {
+        r.read(v.color);
+    }
+    for (Vertex &v : md.vertices) {
+        int16_t oct[2] = {0, 0};
+        v.normal = (header.flags & MESH_NORMALS) && r.read(oct) ? oct_decode(oct) : math::Vector3f{0.0f, 0.0f, 0.0f};
+    }
+    for (Vertex &v : md.vertices) {
+        uint16_t q[2];
+        r.read(q);
+        v.tex_coords = {dequantize_unorm16(q[0], header.uv_min[0], header.uv_extent[0]),
+                        dequantize_unorm16(q[1], header.uv_min[1], header.uv_extent[1])};
+    }
+    for (Vertex &v : md.vertices) {
+        int16_t oct[2] = {0, 0};
+        v.tangent = (header.flags & MESH_TANGENTS) && r.read(oct) ? oct_decode(oct) : math::Vector3f{0.0f, 0.0f, 0.0f};
+    }
+    md.indices.resize(header.num_indices);
+    for (uint32_t &index : md.indices) {
+        if (header.flags & MESH_INDEX32) {
+            r.read(index);
+        } else {
+            uint16_t index16 = 0;
+            r.read(index16);
+            index = index16;
+        }
+        if (index >= header.num_vertices) {
+            return false;
+        }
+    }
+    md.lods.clear();
+    if (header.flags & MESH_LODS) {
+        uint32_t num_lods = 0;
+        if (!r.read(num_lods) || num_lods > r.remaining() / sizeof(MeshLod)) {
+            return false;
+        }
+        md.lods.resize(num_lods);
+        r.read(md.lods.data(), num_lods * sizeof(MeshLod));
+        for (const MeshLod &lod : md.lods) {
+            if (lod.first_index > header.num_indices || lod.num_indices > header.num_indices - lod.first_index) {
+                return false;
+            }
+        }
+    }
+    md.meshlets.clear();
+    if (header.flags & MESH_MESHLETS) {
+        uint32_t num_meshlets = 0;
+        if (!r.read(num_meshlets) || num_meshlets > r.remaining() / sizeof(Meshlet)) {
+            return false;
+        }
+        md.meshlets.resize(num_meshlets);
+        r.read(md.meshlets.data(), num_meshlets * sizeof(Meshlet));
+        // the bounds are of the positions before their quantization: grown by half a step of it
+        const float margin = 0.5f / 65535.0f *
+                             math::length(math::Vector3f{header.pos_extent[0], header.pos_extent[1],
+                                                         header.pos_extent[2]});
+        for (Meshlet &meshlet : md.meshlets) {
+            if (meshlet.first_index > header.num_indices ||
+                meshlet.num_indices > header.num_indices - meshlet.first_index || meshlet.num_indices % 3 != 0) {
+                return false;
+            }
+            meshlet.radius += margin;
+        }
+    }
+    return r.remaining() == 0;
+}
+
+void encode_materials(const std::vector<PackageMaterial> &materials, std::vector<uint8_t> &data) {
+    data.clear();
+    Writer w(data);
+    w.write(uint32_t(materials.size()));
+    for (const auto &mtl : materials) {
+        w.write_string(mtl.name);
+        w.write(mtl.base_color);
+        w.write(mtl.emissive);
+        w.write(mtl.metallic);
+        w.write(mtl.roughness);
+        w.write(uint32_t(mtl.unlit));
+        for (const auto &texture : mtl.textures) {
+            w.write_string(texture);
+        }
+    }
+}
+
+bool decode_materials(const uint8_t *data, size_t size, std::vector<PackageMaterial> &materials) {
+    Reader r(data, size);
+    uint32_t count = 0;
+    if (!r.read(count)) {
+        return false;
+    }
+    materials.clear();
+    for (uint32_t i = 0; i < count; i++) {
+        PackageMaterial mtl;
+        uint32_t unlit = 0;
+        bool ok = r.read_string(mtl.name) && r.read(mtl.base_color) && r.read(mtl.emissive) && r.read(mtl.metallic) &&
+                  r.read(mtl.roughness) && r.read(unlit);
+        for (auto &texture : mtl.textures) {
+            ok = ok && r.read_string(texture);
+        }
+        if (!ok) {
+            return false;
+        }
+        mtl.unlit = unlit != 0;
+        materials.push_back(std::move(mtl));
+    }
+    return true;
+}
+
+void encode_model(const PackageModel &model, std::vector<uint8_t> &data) {
+    data.clear();
+    Writer w(data);
+    w.write_string(model.materials);
+    w.write(uint32_t(model.meshes.size()));
+    for (const auto &mesh : model.meshes) {
+        w.write_string(mesh);
+    }
+}
+
+bool decode_model(const uint8_t *data, size_t size, PackageModel &model) {
+    Reader r(data, size);
+    uint32_t count = 0;
+    if (!r.read_string(model.materials) || !r.read(count)) {
+        return false;
+    }
+    model.meshes.resize(std::min<size_t>(count, size));
+    for (auto &mesh : model.meshes) {
+        if (!r.read_string(mesh)) {
+            return false;
+        }
+    }
+    return model.meshes.size() == count;
+}
+
+void encode_cells(const PackageCells &cells, std::vector<uint8_t> &data) {
+    data.clear();
+    Writer w(data);
+    w.write_string(cells.materials);
+    w.write(cells.cell_size);
+    w.write(uint32_t(cells.cells.size()));
+    for (const auto &cell : cells.cells) {
+        w.write(cell.bbox_min);
+        w.write(cell.bbox_max);
+        w.write(cell.gpu_bytes);
+        w.write(uint32_t(cell.meshes.size()));
+        for (const auto &mesh : cell.meshes) {
+            w.write_string(mesh);
+        }
+    }
+}
+
+bool decode_cells(const uint8_t *data, size_t size, PackageCells &cells) {
+    Reader r(data, size);
+    uint32_t count = 0;
+    if (!r.read_string(cells.materials) || !r.read(cells.cell_size) || !r.read(count)) {
+        return false;
+    }
+    cells.cells.resize(std::min<size_t>(count, size));
+    for (auto &cell : cells.cells) {
+        uint32_t num_meshes = 0;
+        if (!r.read(cell.bbox_min) || !r.read(cell.bbox_max) || !r.read(cell.gpu_bytes) || !r.read(num_meshes)) {
+            return false;
+        }
+        cell.meshes.resize(std::min<size_t>(num_meshes, size));
+        for (auto &mesh : cell.meshes) {
+            if (!r.read_string(mesh)) {
+                return false;
+            }
+        }
+        if (cell.meshes.size() != num_meshes) {
+            return false;
+        }
+    }
+    return cells.cells.size() == count;
+}
+
+void encode_point_cloud(const PackagePointCloud &cloud, std::vector<uint8_t> &data) {
+    data.clear();
+    Writer w(data);
+    w.write_string(cloud.points);
+    w.write(cloud.bbox_min);
+    w.write(cloud.size);
+    w.write(cloud.grid_resolution);
+    w.write(cloud.num_points);
+    w.write(uint32_t(cloud.nodes.size()));
+    for (const auto &node : cloud.nodes) {
+        w.write(node.offset);
+        w.write(node.num_points);
+        w.write(node.first_child);
+        w.write(node.child_mask);
+    }
+}
+
+bool decode_point_cloud(const uint8_t *data, size_t size, PackagePointCloud &cloud) {
+    Reader r(data, size);
+    uint32_t count = 0;
+    if (!r.read_string(cloud.points) || !r.read(cloud.bbox_min) || !r.read(cloud.size) ||
+        !r.read(cloud.grid_resolution) || !r.read(cloud.num_points) || !r.read(count)) {
+        return false;
+    }
+    cloud.nodes.resize(std::min<size_t>(count, size));
+    for (auto &node : cloud.nodes) {
+        if (!r.read(node.offset) || !r.read(node.num_points) || !r.read(node.first_child) ||
+            !r.read(node.child_mask)) {
+            return false;
+        }
+    }
+    if (cloud.nodes.size() != count) {
+        return false;
+    }
+    // the children must follow their parent, so that the hierarchy can be walked without checking for cycles
+    for (size_t i = 0; i < cloud.nodes.size(); i++) {
+        const PackagePointNode &node = cloud.nodes[i];
+        const uint32_t num_children = count_bits(node.child_mask);
+        if (num_children && (node.first_child <= i || uint64_t(node.first_child) + num_children > count)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool write_package(const char *filename, const std::vector<PackageData> &entries) {
+    PackageWriter writer;
+    if (!writer.open(filename)) {
+        return false;
+    }
+    for (const auto &entry : entries) {
+        writer.add(entry);
+    }
+    return writer.close();
+}
+
+PackageWriter::~PackageWriter() {
+    close();
+}
+
+bool PackageWriter::open(const char *filename) {
+    close();
+    _file = fopen(filename, "wb");
+    if (!_file) {
+        log_error("unable to create package '%s'", filename);
+        return false;
+    }
+    _filename = filename;
+    _entries.clear();
+    // the header is written again by close, with the position of the table of contents
+    const PackageHeader header = {PACKAGE_MAGIC, PACKAGE_VERSION, 0, 0, 0};
+    _ok = fwrite(&header, sizeof(header), 1, _file) == 1;
+    _offset = sizeof(header);
+    _in_entry = false;
+    return true;
+}
+
+bool PackageWriter::close() {
+    if (!_file) {
+        return false;
+    }
+    end_entry();
+    PackageHeader header = {PACKAGE_MAGIC, PACKAGE_VERSION, uint32_t(_entries.size()), 0, _offset};
+    for (size_t i = 0; i < _entries.size() && _ok; i++) {
+        const PackageEntry &entry = _entries[i];
+        const PackageTocEntry toc = {entry.offset, entry.size, uint32_t(entry.type), uint32_t(entry.name.size())};
+        _ok = fwrite(&toc, sizeof(toc), 1, _file) == 1;
+        _ok = _ok && fwrite(entry.name.data(), 1, entry.name.size(), _file) == entry.name.size();
+    }
+    _ok = _ok && file_seek(_file, 0) && fwrite(&header, sizeof(header), 1, _file) == 1;
+    _ok = fclose(_file) == 0 && _ok;
+    _file = nullptr;
+    if (!_ok) {
+        log_error("error writing package '%s'", _filename.c_str());
+    }
+    return _ok;
+}
+
+bool PackageWriter::add(const PackageData &entry) {
+    begin_entry(entry.name, entry.type);
+    write(entry.data.data(), entry.data.size());
+    end_entry();
+    return _ok;
+}
+
+void PackageWriter::begin_entry(const std::string &name, PackageEntryType type) {
+    end_entry();
+    const uint8_t padding[PACKAGE_ALIGNMENT] = {0};
+    const uint64_t aligned = (_offset + PACKAGE_ALIGNMENT - 1) / PACKAGE_ALIGNMENT * PACKAGE_ALIGNMENT;
+    _ok = _ok && _file && fwrite(padding, 1, aligned - _offset, _file) == aligned - _offset;
+    _offset = aligned;
+    _entries.push_back({name, type, aligned, 0});
+    _in_entry = true;
+}
+
+bool PackageWriter::write(const void *data, size_t size) {
+    _ok = _ok && _file && _in_entry && (size == 0 || fwrite(data, 1, size, _file) == size);
+    _offset += size;
+    if (_in_entry) {
+        _entries.back().size += size;
+    }
+    return _ok;
+}
+
+void PackageWriter::end_entry() {
+    _in_entry = false;
+}
+
+uint64_t PackageWriter::entry_size() const {
+    return _in_entry ? _entries.back().size : 0;
+}
+
+Package::~Package() {
+    close();
+}
+
+bool Package::open(const char *filename) {
+    close();
+    _file = fopen(filename, "rb");
+    if (!_file) {
+        return false;
+    }
+    PackageHeader header;
+    const int64_t size = file_size(_file);
+    if (size < 0 || !file_seek(_file, 0) || fread(&header, sizeof(header), 1, _file) != 1 ||
+        header.magic != PACKAGE_MAGIC || header.version != PACKAGE_VERSION || header.toc_offset > uint64_t(size)) {
+        log_error("'%s' is not a valid package", filename);
+        close();
+        return false;
+    }
+    // the table of contents is read at once, then parsed
+    std::vector<uint8_t> toc(uint64_t(size) - header.toc_offset);
+    bool ok = file_seek(_file, header.toc_offset) && fread(toc.data(), 1, toc.size(), _file) == toc.size();
+    Reader r(toc.data(), toc.size());
+    for (uint32_t i = 0; i < header.num_entries && ok; i++) {
+        PackageTocEntry toc_entry;
+        PackageEntry entry;
+        ok = r.read(toc_entry) && toc_entry.offset + toc_entry.size <= header.toc_offset;
+        if (ok) {
+            entry.name.resize(toc_entry.name_length);
+            ok = r.read(&entry.name[0], toc_entry.name_length);
+        }
+        entry.type = PackageEntryType(toc_entry.type);
+        entry.offset = toc_entry.offset;
+        entry.size = toc_entry.size;
+        if (ok) {
+            _index[entry.name] = _entries.size();
+            _entries.push_back(std::move(entry));
+        }
+    }
+    if (!ok) {
+        log_error("the table of contents of package '%s' is corrupted", filename);
+        close();
+        return false;
+    }
+    _filename = filename;
+    return true;
+}
+
+void Package::close() {
+    if (_file) {
+        fclose(_file);
+        _file = nullptr;
+    }
+    _filename.clear();
+    _entries.clear();
+    _index.clear();
+}
+
+const PackageEntry *Package::find(const std::string &name) const {
+    auto it = _index.find(name);
+    return it != _index.end() ? &_entries[it->second] : nullptr;
+}
+
+bool Package::read(const PackageEntry &entry, std::vector<uint8_t> &data) {
+    if (!_file) {
+        return false;
+    }
+    data.resize(entry.size);
+    return file_seek(_file, entry.offset) && fread(data.data(), 1, data.size(), _file) == data.size();
+}
+
+bool Package::read(const PackageEntry &entry, uint64_t offset, uint64_t size, std::vector<uint8_t> &data) {
+    if (!_file || offset > entry.size) {
+        return false;
+    }
+    data.resize(std::min(size, entry.size - offset));
+    return file_seek(_file, entry.offset + offset) && fread(data.data(), 1, data.size(), _file) == data.size();
+}
+
+} // namespace glengine
@@ -0,0 +1,187 @@
+#pragma once
+
+#include "gl_prefabs.h"
+#include "math/vmath.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace glengine {
+
+class GLEngine;
+struct Renderable;
+
+/// type of the entries of a package (.gpkg)
+enum class PackageEntryType : uint32_t {
+    Mesh = 1,      ///< quantized vertices and indices (see encode_mesh)
+    Texture = 2,   ///< texture file (.gtex) with its whole mip chain
+    Materials = 3, ///< material table of a model (see encode_materials)
+    Model = 4,     ///< materials and meshes of a model (see encode_model)
+    Cells = 5,     ///< meshes of a model grouped in spatial cells, for streaming (see encode_cells)
+    PointCloud = 6,       ///< octree of a point cloud (see encode_point_cloud)
+    PointCloudPoints = 7, ///< quantized points of all the nodes of a point cloud (see PointCloudPoint)
+};
+
+/// entry of the table of contents of a package
+struct PackageEntry {
+    std::string name;
+    PackageEntryType type = PackageEntryType::Mesh;
+    uint64_t offset = 0; ///< position of the data in the file
+    uint64_t size = 0;
+};
+
+/// material of a model, textures are referenced by the name of their entry (empty when unused)
+struct PackageMaterial {
+    enum TextureSlot { BaseColor, MetallicRoughness, Normal, Occlusion, Emissive, NumTextureSlots };
+
+    std::string name;
+    math::Vector4f base_color = {1.0f, 1.0f, 1.0f, 1.0f};
+    math::Vector3f emissive = {0.0f, 0.0f, 0.0f};
+    float metallic = 1.0f;
+    float roughness = 1.0f;
+    bool unlit = false;
+    std::string textures[NumTextureSlots];
+};
+
+/// a model: the name of its Materials entry and of its Mesh entries (each mesh stores its material index)
+struct PackageModel {
+    std::string materials;
+    std::vector<std::string> meshes;
+};
+
+/// meshes are stored quantized, one stream per attribute: positions as 16 bit fixed point in their bounding box,
+/// normals and tangents octahedral encoded in 2x16 bits, texture coordinates as 16 bit fixed point in their range,
+/// and 16 bit indices when possible, followed by the levels of detail and the meshlets if any. Material is the index
+/// in the materials table of the model (-1 if none)
+void encode_mesh(const MeshData &md, int32_t material, std::vector<uint8_t> &data);
+bool decode_mesh(const uint8_t *data, size_t size, MeshData &md, int32_t &material);
+
+void encode_materials(const std::vector<PackageMaterial> &materials, std::vector<uint8_t> &data);
+bool decode_materials(const uint8_t *data, size_t size, std::vector<PackageMaterial> &materials);
+
+void encode_model(const PackageModel &model, std::vector<uint8_t> &data);
+bool decode_model(const uint8_t *data, size_t size, PackageModel &model);
+
+/// cell of a streamed model: the Mesh entries of the triangles it contains, their bounds and their size once
+/// uploaded (vertex and index buffers)
+struct PackageCell {
+    math::Vector3f bbox_min = {0.0f, 0.0f, 0.0f};
+    math::Vector3f bbox_max = {0.0f, 0.0f, 0.0f};
+    uint64_t gpu_bytes = 0;
+    std::vector<std::string> meshes;
+};
+
+/// model split in the cells of a regular grid (see split_mesh_in_cells), with the name of its Materials entry
+struct PackageCells {
+    std::string materials;
+    float cell_size = 0.0f;
+    std::vector<PackageCell> cells;
+};
+
+void encode_cells(const PackageCells &cells, std::vector<uint8_t> &data);
+bool decode_cells(const uint8_t *data, size_t size, PackageCells &cells);
+
+/// node of a point cloud octree: its points are a subsample of the points in its bounds, the ones of its children
+/// add detail in between (they are never repeated). Points are quantized in the bounds of the node
+struct PackagePointNode {
+    uint64_t offset = 0;      ///< of the points in the PointCloudPoints entry, in bytes
+    uint32_t num_points = 0;
+    uint32_t first_child = 0; ///< the children of a node are consecutive, in the order of their octants
+    uint8_t child_mask = 0;   ///< octants (x | y << 1 | z << 2) with a child
+};
+
+/// octree of a point cloud (see PointCloudBuilder), the points of the nodes are in a separate entry so that they can
+/// be read one node at a time. The bounds of the root are a cube, the ones of the nodes follow from their octants
+struct PackagePointCloud {
+    std::string points; ///< name of the PointCloudPoints entry
+    math::Vector3f bbox_min = {0.0f, 0.0f, 0.0f};
+    float size = 0.0f;            ///< edge of the root cube
+    uint32_t grid_resolution = 0; ///< the spacing of the points of a node is its size divided by the resolution
+    uint64_t num_points = 0;
+    std::vector<PackagePointNode> nodes; ///< breadth first, from the root
+};
+
+void encode_point_cloud(const PackagePointCloud &cloud, std::vector<uint8_t> &data);
+bool decode_point_cloud(const uint8_t *data, size_t size, PackagePointCloud &cloud);
+
+/// entry to write, with its encoded data
+struct PackageData {
+    std::string name;
+    PackageEntryType type = PackageEntryType::Mesh;
+    std::vector<uint8_t> data;
+};
+
+/// package files: a header, the data of the entries (16 bytes aligned), then the table of contents with the name,
+/// type, offset and size of every entry. Entry names must be unique
+bool write_package(const char *filename, const std::vector<PackageData> &entries);
+
+/// package written as its entries come, for data too large to be held in memory: the data of an entry can be written
+/// in parts between begin_entry and end_entry. The table of contents is written by close (see write_package)
+class PackageWriter {
+  public:
+    ~PackageWriter();
+
+    bool open(const char *filename);
+    /// write the table of contents and close the file. Returns false if any write failed since open
+    bool close();
+
+    /// the whole entry at once
+    bool add(const PackageData &entry);
+    /// start a new entry, ending the current one
+    void begin_entry(const std::string &name, PackageEntryType type);
+    /// append data to the current entry
+    bool write(const void *data, size_t size);
+    void end_entry();
+    /// bytes written so far in the current entry (offset of the next write within the entry)
+    uint64_t entry_size() const;
+
+  private:
+    FILE *_file = nullptr;
+    std::string _filename;
+    bool _ok = false;
+    bool _in_entry = false;
+    uint64_t _offset = 0; ///< end of the data written so far
+    std::vector<PackageEntry> _entries;
+};
+
+/// read access to a package: opening only reads the header and the table of contents, entries are read on demand
+class Package {
+  public:
+    ~Package();
+
+    bool open(const char *filename);
+    void close();
+
+    const std::string &filename() const { return _filename; }
+    const std::vector<PackageEntry> &entries() const { return _entries; }
+    /// entry with the given name, or nullptr
+    const PackageEntry *find(const std::string &name) const;
+    bool read(const PackageEntry &entry, std::vector<uint8_t> &data);
+    /// part of an entry, size is clamped to the end of the entry
+    bool read(const PackageEntry &entry, uint64_t offset, uint64_t size, std::vector<uint8_t> &data);
+
+  private:
+    FILE *_file = nullptr;
+    std::string _filename;
+    std::vector<PackageEntry> _entries;
+    std::unordered_map<std::string, size_t> _index; ///< entries by name
+};
+
+class Material;
+class TextureStreamer;
+
+/// materials of a Materials entry, with their textures uploaded (see create_from_package). Missing or invalid
+/// entries give an empty table
+std::vector<Material *> create_package_materials(GLEngine &eng, Package &package, const std::string &name,
+                                                 TextureStreamer *textures = nullptr);
+
+/// create the renderables of a model stored in a package (the first model of the package if name is null).
+/// Textures are uploaded with their cooked format and mip chain, and shared through the image cache. With a texture
+/// streamer, only their smallest levels are uploaded, and the finer ones are streamed by the streamer updates
+std::vector<Renderable> create_from_package(GLEngine &eng, const char *filename, const char *name = nullptr,
+                                            TextureStreamer *textures = nullptr);
+
+} // namespace glengine
@@ -0,0 +1,473 @@
+#include "gl_particles.h"
+#include "gl_camera.h"
+#include "gl_engine.h"
+#include "gl_logger.h"
+#include "gl_thread_pool.h"
+#include "generated/shaders/particles.glsl.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// float streams of the billboards: x, y, z, size, followed by the color stream in its own buffer
+constexpr uint32_t NUM_FLOAT_STREAMS = 4;
+// particles per task of the worker threads
+constexpr uint32_t SIMULATION_GRAIN = 16384;
+
+// ////////////////////////////////////////////////////// //
+// lanes of the kernels: one particle, then 4 or 8 at once //
+// ////////////////////////////////////////////////////// //
+struct f1 {
+    static constexpr uint32_t width = 1;
+    float v;
+    static f1 load(const float *p) { return {*p}; }
+    static f1 set(float s) { return {s}; }
+    void store(float *p) const { memcpy(p, &v, sizeof(v)); }
+};
+inline f1 operator+(f1 a, f1 b) { return {a.v + b.v}; }
+inline f1 operator-(f1 a, f1 b) { return {a.v - b.v}; }
+inline f1 operator*(f1 a, f1 b) { return {a.v * b.v}; }
+inline f1 operator/(f1 a, f1 b) { return {a.v / b.v}; }
+inline f1 vmin(f1 a, f1 b) { return {std::min(a.v, b.v)}; }
+inline f1 vmax(f1 a, f1 b) { return {std::max(a.v, b.v)}; }
+inline f1 vsqrt(f1 a) { return {std::sqrt(a.v)}; }
+// x where a < b, else 0
+inline f1 zero_unless_less(f1 a, f1 b, f1 x) { return {a.v < b.v ? x.v : 0.0f}; }
+// a >= b in any of the lanes
+inline bool any_greater_equal(f1 a, f1 b) { return a.v >= b.v; }
+// channels from 0 to 255 packed as rgba8
+inline void store_rgba(f1 r, f1 g, f1 b, f1 a, uint32_t *p) {
+    *p = uint32_t(r.v) | uint32_t(g.v) << 8 | uint32_t(b.v) << 16 | uint32_t(a.v) << 24;
+}
+
+#if defined(__AVX2__)
+struct f8 {
+    static constexpr uint32_t width = 8;
+    __m256 v;
+    static f8 load(const float *p) { return {_mm256_loadu_ps(p)}; }
+    static f8 set(float s) { return {_mm256_set1_ps(s)}; }
+    void store(float *p) const { _mm256_storeu_ps(p, v); }
+};
+inline f8 operator+(f8 a, f8 b) { return {_mm256_add_ps(a.v, b.v)}; }
+inline f8 operator-(f8 a, f8 b) { return {_mm256_sub_ps(a.v, b.v)}; }
+inline f8 operator*(f8 a, f8 b) { return {_mm256_mul_ps(a.v, b.v)}; }
+inline f8 operator/(f8 a, f8 b) { return {_mm256_div_ps(a.v, b.v)}; }
+inline f8 vmin(f8 a, f8 b) { return {_mm256_min_ps(a.v, b.v)}; }
+inline f8 vmax(f8 a, f8 b) { return {_mm256_max_ps(a.v, b.v)}; }
+inline f8 vsqrt(f8 a) { return {_mm256_sqrt_ps(a.v)}; }
+inline f8 zero_unless_less(f8 a, f8 b, f8 x) { return {_mm256_and_ps(_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ), x.v)}; }
+inline bool any_greater_equal(f8 a, f8 b) { return _mm256_movemask_ps(_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ)) != 0; }
+inline void store_rgba(f8 r, f8 g, f8 b, f8 a, uint32_t *p) {
+    __m256i c = _mm256_cvttps_epi32(r.v);
+    c = _mm256_or_si256(c, _mm256_slli_epi32(_mm256_cvttps_epi32(g.v), 8));
+    c = _mm256_or_si256(c, _mm256_slli_epi32(_mm256_cvttps_epi32(b.v), 16));
+    c = _mm256_or_si256(c, _mm256_slli_epi32(_mm256_cvttps_epi32(a.v), 24));
+    _mm256_storeu_si256((__m256i *)p, c);
+}
+using fw = f8;
+#elif defined(__SSE2__)
+struct f4 {
+    static constexpr uint32_t width = 4;
+    __m128 v;
+    static f4 load(const float *p) { return {_mm_loadu_ps(p)}; }
+    static f4 set(float s) { return {_mm_set1_ps(s)}; }
+    void store(float *p) const { _mm_storeu_ps(p, v); }
+};
+inline f4 operator+(f4 a, f4 b) { return {_mm_add_ps(a.v, b.v)}; }
+inline f4 operator-(f4 a, f4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+inline f4 operator*(f4 a, f4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+inline f4 operator/(f4 a, f4 b) { return {_mm_div_ps(a.v, b.v)}; }
+inline f4 vmin(f4 a, f4 b) { return {_mm_min_ps(a.v, b.v)}; }
+inline f4 vmax(f4 a, f4 b) { return {_mm_max_ps(a.v, b.v)}; }
+inline f4 vsqrt(f4 a) { return {_mm_sqrt_ps(a.v)}; }
+inline f4 zero_unless_less(f4 a, f4 b, f4 x) { return {_mm_and_ps(_mm_cmplt_ps(a.v, b.v), x.v)}; }
+inline bool any_greater_equal(f4 a, f4 b) { return _mm_movemask_ps(_mm_cmpge_ps(a.v, b.v)) != 0; }
+inline void store_rgba(f4 r, f4 g, f4 b, f4 a, uint32_t *p) {
+    __m128i c = _mm_cvttps_epi32(r.v);
+    c = _mm_or_si128(c, _mm_slli_epi32(_mm_cvttps_epi32(g.v), 8));
+    c = _mm_or_si128(c, _mm_slli_epi32(_mm_cvttps_epi32(b.v), 16));
+    c = _mm_or_si128(c, _mm_slli_epi32(_mm_cvttps_epi32(a.v), 24));
+    _mm_storeu_si128((__m128i *)p, c);
+}
+using fw = f4;
+#else
+using fw = f1;
+#endif
+
+// xorshift, its state scrambled from the seed
+struct Random {
+    uint32_t state;
+
+    explicit Random(uint32_t seed) {
+        seed = (seed ^ (seed >> 16)) * 0x85ebca6bu;
+        seed = (seed ^ (seed >> 13)) * 0xc2b2ae35u;
+        state = (seed ^ (seed >> 16)) | 1u;
+    }
+    /// uniform in [0, 1)
+    float next() {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return float(state >> 8) / 16777216.0f;
+    }
+    /// uniform in the unit sphere
+    math::Vector3f in_sphere() {
+        math::Vector3f p;
+        do {
+            p = {next() * 2.0f - 1.0f, next() * 2.0f - 1.0f, next() * 2.0f - 1.0f};
+        } while (p.x * p.x + p.y * p.y + p.z * p.z > 1.0f);
+        return p;
+    }
+};
+
+// arrays and constants of a simulation step
+struct Kernel {
+    float *px, *py, *pz;
+    float *vx, *vy, *vz;
+    float *age;
+    const float *inv_life;
+    float *out_x, *out_y, *out_z, *out_size;
+    uint32_t *out_color;
+    float dt;
+    float damping;         // of the velocity over dt
+    float acceleration[3]; // gravity and wind
+    float attractor[3];
+    float attractor_strength;
+    float size_start, size_delta;
+    float colors[4][4];    // keys of the ramp, channels from 0 to 255
+};
+
+// integrate one lane of particles, age them, and write their billboards
+template <typename V> inline void simulate_lanes(const Kernel &k, uint32_t i) {
+    const V dt = V::set(k.dt);
+    V px = V::load(k.px + i), py = V::load(k.py + i), pz = V::load(k.pz + i);
+    V vx = V::load(k.vx + i), vy = V::load(k.vy + i), vz = V::load(k.vz + i);
+    // forces: constant acceleration, plus the attractor (falling off with the squared distance beyond a unit)
+    const V dx = V::set(k.attractor[0]) - px, dy = V::set(k.attractor[1]) - py, dz = V::set(k.attractor[2]) - pz;
+    const V r2 = dx * dx + dy * dy + dz * dz + V::set(1.0f);
+    const V pull = V::set(k.attractor_strength) / (r2 * vsqrt(r2));
+    // semi-implicit euler, with the drag as an exponential decay
+    const V damping = V::set(k.damping);
+    vx = (vx + (V::set(k.acceleration[0]) + dx * pull) * dt) * damping;
+    vy = (vy + (V::set(k.acceleration[1]) + dy * pull) * dt) * damping;
+    vz = (vz + (V::set(k.acceleration[2]) + dz * pull) * dt) * damping;
+    px = px + vx * dt;
+    py = py + vy * dt;
+    pz = pz + vz * dt;
+    const V age = V::load(k.age + i) + dt;
+    px.store(k.px + i);
+    py.store(k.py + i);
+    pz.store(k.pz + i);
+    vx.store(k.vx + i);
+    vy.store(k.vy + i);
+    vz.store(k.vz + i);
+    age.store(k.age + i);
+
+    // ramps over the life, the particles dying in this step are not drawn
+    const V life = age * V::load(k.inv_life + i);
+    const V one = V::set(1.0f), zero = V::set(0.0f);
+    const V t = vmin(vmax(life, zero), one);
+    const V size = V::set(k.size_start) + V::set(k.size_delta) * t;
+    zero_unless_less(life, one, size).store(k.out_size + i);
+    // piecewise linear between the keys, one segment after the other
+    const V s = t * V::set(3.0f);
+    const V s0 = vmin(s, one), s1 = vmin(vmax(s - one, zero), one), s2 = vmax(s - V::set(2.0f), zero);
+    V c[4];
+    for (int ch = 0; ch < 4; ch++) {
+        c[ch] = V::set(k.colors[0][ch]) + V::set(k.colors[1][ch] - k.colors[0][ch]) * s0 +
+                V::set(k.colors[2][ch] - k.colors[1][ch]) * s1 + V::set(k.colors[3][ch] - k.colors[2][ch]) * s2 +
+                V::set(0.5f);
+    }
+    store_rgba(c[0], c[1], c[2], c[3], k.out_color + i);
+    px.store(k.out_x + i);
+    py.store(k.out_y + i);
+    pz.store(k.out_z + i);
+}
+
+template <typename V> void simulate_range(const Kernel &k, uint32_t begin, uint32_t end) {
+    uint32_t i = begin;
+    for (; i + V::width <= end; i += V::width) {
+        simulate_lanes<V>(k, i);
+    }
+    for (; i < end; i++) {
+        simulate_lanes<f1>(k, i);
+    }
+}
+
+} // namespace
+
+namespace glengine {
+
+bool ParticleSystem::init(GLEngine &eng) {
+    ResourceManager &rm = eng.resource_manager();
+    const float quad[] = {-1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f};
+    _quad = sg_make_buffer((sg_buffer_desc){.size = sizeof(quad), .data = SG_RANGE(quad), .label = "particle-quad"});
+
+    // the quad is in buffer 0, and the streams of the particles in buffers 1 to 5: the float ones from the same buffer,
+    // then the colors
+    sg_pipeline_desc pip_desc = {0};
+    for (int b = 1; b <= int(NUM_FLOAT_STREAMS) + 1; b++) {
+        pip_desc.layout.buffers[b].stride = 4;
+        pip_desc.layout.buffers[b].step_func = SG_VERTEXSTEP_PER_INSTANCE;
+    }
+    pip_desc.layout.attrs[ATTR_vs_particles_corner] = {.buffer_index = 0, .format = SG_VERTEXFORMAT_FLOAT2};
+    pip_desc.layout.attrs[ATTR_vs_particles_pos_x] = {.buffer_index = 1, .format = SG_VERTEXFORMAT_FLOAT};
+    pip_desc.layout.attrs[ATTR_vs_particles_pos_y] = {.buffer_index = 2, .format = SG_VERTEXFORMAT_FLOAT};
+    pip_desc.layout.attrs[ATTR_vs_particles_pos_z] = {.buffer_index = 3, .format = SG_VERTEXFORMAT_FLOAT};
+    pip_desc.layout.attrs[ATTR_vs_particles_size] = {.buffer_index = 4, .format = SG_VERTEXFORMAT_FLOAT};
+    pip_desc.layout.attrs[ATTR_vs_particles_instance_color] = {.buffer_index = 5,
+                                                                .format = SG_VERTEXFORMAT_UBYTE4N};
+    pip_desc.shader = rm.get_or_create_shader(*particles_shader_desc(sg_query_backend()));
+    pip_desc.primitive_type = SG_PRIMITIVETYPE_TRIANGLE_STRIP;
+    // the depth is tested but not written, the particles are blended over the scene
+    pip_desc.depth = {.pixel_format = SG_PIXELFORMAT_DEPTH_STENCIL, .compare = SG_COMPAREFUNC_LESS_EQUAL};
+    pip_desc.color_count = eng._config.use_mrt ? 3 : 1;
+    pip_desc.colors[0].blend = {.enabled = true,
+                                .src_factor_rgb = SG_BLENDFACTOR_ONE,
+                                .dst_factor_rgb =
+                                    params.additive ? SG_BLENDFACTOR_ONE : SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA};
+    // normals and depth are left to the scene, for the ssao
+    pip_desc.colors[1].write_mask = SG_COLORMASK_NONE;
+    pip_desc.colors[2].write_mask = SG_COLORMASK_NONE;
+    pip_desc.sample_count = sg_query_features().msaa_render_targets ? eng._config.msaa_samples : 1;
+    pip_desc.label = "particles pipeline";
+    _pip = rm.get_or_create_pipeline(pip_desc);
+    return _pip.id != SG_INVALID_ID;
+}
+
+void ParticleSystem::terminate() {
+    sg_destroy_buffer(_quad);
+    sg_destroy_buffer(_float_buffer);
+    sg_destroy_buffer(_color_buffer);
+    _quad = _float_buffer = _color_buffer = {SG_INVALID_ID};
+    _buffer_capacity = 0;
+    _num_uploaded = 0;
+    clear();
+    _stats = ParticleStats();
+}
+
+void ParticleSystem::clear() {
+    _count = 0;
+    _spawn_debt.clear();
+}
+
+void ParticleSystem::reserve(uint32_t capacity) {
+    if (capacity <= _px.size()) {
+        return;
+    }
+    uint32_t new_capacity = std::max<uint32_t>(uint32_t(_px.size()), 1024);
+    while (new_capacity < capacity) {
+        new_capacity *= 2;
+    }
+    for (std::vector<float> *v : {&_px, &_py, &_pz, &_vx, &_vy, &_vz, &_age, &_inv_life}) {
+        v->resize(new_capacity);
+    }
+}
+
+void ParticleSystem::for_each_chunk(uint32_t begin, uint32_t end,
+                                    const std::function<void(uint32_t, uint32_t)> &fun) {
+    if (params.parallel) {
+        parallel_for(begin, end, SIMULATION_GRAIN, fun);
+        return;
+    }
+    for (uint32_t chunk = begin; chunk < end; chunk += SIMULATION_GRAIN) {
+        fun(chunk, std::min(chunk + SIMULATION_GRAIN, end));
+    }
+}
+
+void ParticleSystem::move_particles(uint32_t from, uint32_t to, uint32_t count) {
+    for (std::vector<float> *v : {&_px, &_py, &_pz, &_vx, &_vy, &_vz, &_age, &_inv_life}) {
+        std::copy_n(v->data() + from, count, v->data() + to);
+    }
+}
+
+void ParticleSystem::kill() {
+    // the dead particles of each chunk are replaced by the last living ones of the same chunk, which stays in cache
+    const uint32_t count = _count;
+    const uint32_t num_chunks = (_count + SIMULATION_GRAIN - 1) / SIMULATION_GRAIN;
+    _chunk_alive.assign(num_chunks, 0);
+    for_each_chunk(0, _count, [this](uint32_t begin, uint32_t end) {
+        uint32_t i = begin;
+        while (i < end) {
+            // the living particles are skipped a whole lane at a time
+            if (params.simd) {
+                while (i + fw::width <= end &&
+                       !any_greater_equal(fw::load(&_age[i]) * fw::load(&_inv_life[i]), fw::set(1.0f))) {
+                    i += fw::width;
+                }
+                if (i >= end) {
+                    break;
+                }
+            }
+            if (_age[i] * _inv_life[i] >= 1.0f) {
+                move_particles(--end, i, 1);
+            } else {
+                i++;
+            }
+        }
+        _chunk_alive[begin / SIMULATION_GRAIN] = end - begin;
+    });
+    // then the holes left at the end of the first chunks are filled with the particles of the last ones, moving
+    // contiguous ranges
+    uint32_t hole = 0, donor = num_chunks > 0 ? num_chunks - 1 : 0;
+    while (hole < donor) {
+        const uint32_t hole_begin = hole * SIMULATION_GRAIN + _chunk_alive[hole];
+        const uint32_t hole_end = (hole + 1) * SIMULATION_GRAIN;
+        if (hole_begin == hole_end) {
+            hole++;
+        } else if (_chunk_alive[donor] == 0) {
+            donor--;
+        } else {
+            const uint32_t n = std::min(hole_end - hole_begin, _chunk_alive[donor]);
+            _chunk_alive[donor] -= n;
+            move_particles(donor * SIMULATION_GRAIN + _chunk_alive[donor], hole_begin, n);
+            _chunk_alive[hole] += n;
+        }
+    }
+    _count = num_chunks > 0 ? hole * SIMULATION_GRAIN + _chunk_alive[hole] : 0;
+    _stats.num_killed = count - _count;
+}
+
+void ParticleSystem::spawn(float dt) {
+    _spawn_debt.resize(emitters.size(), 0.0f);
+    const uint32_t count = _count;
+    for (size_t e = 0; e < emitters.size(); e++) {
+        const ParticleEmitter &emitter = emitters[e];
+        _spawn_debt[e] += std::max(emitter.rate, 0.0f) * dt;
+        const uint32_t room = params.max_particles - std::min(_count, params.max_particles);
+        const uint32_t n = std::min(uint32_t(_spawn_debt[e]), room);
+        _spawn_debt[e] -= float(uint32_t(_spawn_debt[e]));
+        reserve(_count + n);
+        // the random numbers of each chunk only depend on the seed and on the chunk, whatever the threads
+        const uint32_t seed = ++_seed;
+        for_each_chunk(_count, _count + n, [this, &emitter, seed](uint32_t begin, uint32_t end) {
+            Random random(seed * 0x9e3779b9u + begin);
+            for (uint32_t i = begin; i < end; i++) {
+                const math::Vector3f p = emitter.position + random.in_sphere() * emitter.radius;
+                const math::Vector3f v = emitter.velocity + random.in_sphere() * emitter.spread;
+                const float life = emitter.life_min + (emitter.life_max - emitter.life_min) * random.next();
+                _px[i] = p.x;
+                _py[i] = p.y;
+                _pz[i] = p.z;
+                _vx[i] = v.x;
+                _vy[i] = v.y;
+                _vz[i] = v.z;
+                _age[i] = 0.0f;
+                _inv_life[i] = 1.0f / std::max(life, 1e-3f);
+            }
+        });
+        _count += n;
+    }
+    _stats.num_spawned = _count - count;
+}
+
+void ParticleSystem::simulate(float dt) {
+    const double start = now_ms();
+    kill();
+    spawn(dt);
+    _float_streams.resize(size_t(_count) * NUM_FLOAT_STREAMS);
+    _colors.resize(_count);
+
+    const math::Vector3f acceleration = params.gravity + params.wind;
+    Kernel k = {.px = _px.data(),
+                .py = _py.data(),
+                .pz = _pz.data(),
+                .vx = _vx.data(),
+                .vy = _vy.data(),
+                .vz = _vz.data(),
+                .age = _age.data(),
+                .inv_life = _inv_life.data(),
+                .out_x = _float_streams.data(),
+                .out_y = _float_streams.data() + _count,
+                .out_z = _float_streams.data() + _count * 2,
+                .out_size = _float_streams.data() + _count * 3,
+                .out_color = _colors.data(),
+                .dt = dt,
+                .damping = std::exp(-std::max(params.drag, 0.0f) * dt),
+                .acceleration = {acceleration.x, acceleration.y, acceleration.z},
+                .attractor = {params.attractor.x, params.attractor.y, params.attractor.z},
+                .attractor_strength = params.attractor_strength,
+                .size_start = params.size_start,
+                .size_delta = params.size_end - params.size_start};
+    for (int key = 0; key < 4; key++) {
+        const Color &c = params.colors[key];
+        k.colors[key][0] = c.r;
+        k.colors[key][1] = c.g;
+        k.colors[key][2] = c.b;
+        k.colors[key][3] = c.a;
+    }
+    auto run = [this, &k](uint32_t begin, uint32_t end) {
+        if (params.simd) {
+            simulate_range<fw>(k, begin, end);
+        } else {
+            simulate_range<f1>(k, begin, end);
+        }
+    };
+    for_each_chunk(0, _count, run);
+    _stats.num_particles = _count;
+    _stats.simulate_ms = now_ms() - start;
+}
+
+void ParticleSystem::update() {
+    _num_uploaded = _count;
+    if (_count == 0) {
+        return;
+    }
+    if (_count > _buffer_capacity) {
+        uint32_t new_capacity = std::max<uint32_t>(_buffer_capacity, 1024);
+        while (new_capacity < _count) {
+            new_capacity *= 2;
+        }
+        sg_destroy_buffer(_float_buffer);
+        sg_destroy_buffer(_color_buffer);
+        sg_buffer_desc desc = {.size = size_t(new_capacity) * NUM_FLOAT_STREAMS * sizeof(float),
+                               .type = SG_BUFFERTYPE_VERTEXBUFFER,
+                               .usage = SG_USAGE_STREAM,
+                               .label = "particles"};
+        _float_buffer = sg_make_buffer(desc);
+        desc.size = size_t(new_capacity) * sizeof(uint32_t);
+        desc.label = "particle-colors";
+        _color_buffer = sg_make_buffer(desc);
+        _buffer_capacity = new_capacity;
+        _stats.buffer_size = new_capacity * (NUM_FLOAT_STREAMS * sizeof(float) + sizeof(uint32_t));
+        log_debug("particles: %u particles buffers", new_capacity);
+    }
+    sg_update_buffer(_float_buffer, {_float_streams.data(), size_t(_count) * NUM_FLOAT_STREAMS * sizeof(float)});
+    sg_update_buffer(_color_buffer, {_colors.data(), size_t(_count) * sizeof(uint32_t)});
+}
+
+void ParticleSystem::draw(const Camera &cam) {
+    _stats.num_draws = 0;
+    if (_num_uploaded == 0) {
+        return;
+    }
+    particle_params_t particle_params = {.view = cam.inverse_transform(), .projection = cam.projection()};
+    sg_apply_pipeline(_pip);
+    sg_bindings bind = {0};
+    bind.vertex_buffers[0] = _quad;
+    for (uint32_t s = 0; s < NUM_FLOAT_STREAMS; s++) {
+        bind.vertex_buffers[s + 1] = _float_buffer;
+        bind.vertex_buffer_offsets[s + 1] = int(s * _num_uploaded * sizeof(float));
+    }
+    bind.vertex_buffers[NUM_FLOAT_STREAMS + 1] = _color_buffer;
+    sg_apply_bindings(bind);
+    sg_apply_uniforms(SG_SHADERSTAGE_VS, SLOT_particle_params, SG_RANGE(particle_params));
+    sg_draw(0, 4, int(_num_uploaded));
+    _stats.num_draws++;
+}
+
+} // namespace glengine
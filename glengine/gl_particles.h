@@ -0,0 +1,108 @@
+#pragma once
+
+#include "gl_types.h"
+#include "math/vmath.h"
+
+#include "sokol_gfx.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace glengine {
+
+class Camera;
+class GLEngine;
+
+/// source of particles, spawned at a constant rate within a sphere
+struct ParticleEmitter {
+    math::Vector3f position = {0.0f, 0.0f, 0.0f};
+    float radius = 0.0f;                          ///< of the sphere where the particles are spawned
+    math::Vector3f velocity = {0.0f, 0.0f, 5.0f}; ///< initial, in world units per second
+    float spread = 1.0f;                          ///< random velocity added to the initial one, up to this length
+    float rate = 1000.0f;                         ///< particles per second
+    float life_min = 1.0f;                        ///< in seconds, random between min and max
+    float life_max = 2.0f;
+};
+
+struct ParticleParams {
+    uint32_t max_particles = 1 << 20;
+    math::Vector3f gravity = {0.0f, 0.0f, -9.81f};
+    float drag = 0.1f;                          ///< fraction of the velocity lost per second
+    math::Vector3f wind = {0.0f, 0.0f, 0.0f};   ///< acceleration, added to the gravity
+    math::Vector3f attractor = {0.0f, 0.0f, 0.0f};
+    float attractor_strength = 0.0f;            ///< acceleration towards the attractor, softened within a unit
+    float size_start = 0.1f;                    ///< in world units, interpolated over the life of the particles
+    float size_end = 0.05f;
+    /// color ramp over the life of the particles, with evenly spaced keys
+    Color colors[4] = {{255, 240, 160, 255}, {255, 140, 40, 200}, {150, 40, 20, 120}, {40, 40, 40, 0}};
+    bool additive = true; ///< additive blending, else alpha blended without sorting (used by init)
+    bool parallel = true; ///< split the simulation across the worker threads
+    bool simd = true;     ///< scalar kernels when false, for comparison
+};
+
+struct ParticleStats {
+    uint32_t num_particles = 0; ///< alive after the last simulation step
+    uint32_t num_spawned = 0;   ///< by the last simulation step
+    uint32_t num_killed = 0;
+    uint32_t num_draws = 0;     ///< of the last frame
+    uint32_t buffer_size = 0;   ///< bytes of the streamed buffers
+    double simulate_ms = 0.0;
+};
+
+/// particles without an Object nor a Renderable each: the state is stored as a structure of arrays, one array per
+/// component, and simulated on the cpu by SIMD kernels (SSE2 or AVX2, 4 or 8 particles at once) split across the
+/// worker threads. The integration (gravity, wind, drag and an attractor), the lifetime and the ramps of color and
+/// size are a single pass over the arrays, which also writes the streams drawn as instanced billboards: positions,
+/// sizes and colors are uploaded in two buffers per frame, and drawn with a single draw call. The dead particles are
+/// replaced by living ones moved from the end, so the order is not preserved. simulate() is cpu only and can run
+/// without a gpu
+class ParticleSystem {
+  public:
+    bool init(GLEngine &eng);
+    void terminate();
+
+    /// advance the particles by dt seconds: spawn, kill, then integrate them
+    void simulate(float dt);
+    /// upload the particles, has to be called outside of the passes, at most once per frame
+    void update();
+    /// draw the uploaded particles in the current pass
+    void draw(const Camera &cam);
+
+    void clear();
+    uint32_t size() const { return _count; }
+    const ParticleStats &stats() const { return _stats; }
+
+    ParticleParams params;
+    std::vector<ParticleEmitter> emitters;
+
+  private:
+    void reserve(uint32_t capacity);
+    void spawn(float dt);
+    void kill();
+    /// call fun on the chunks of the range, on the worker threads when parallel
+    void for_each_chunk(uint32_t begin, uint32_t end, const std::function<void(uint32_t, uint32_t)> &fun);
+    void move_particles(uint32_t from, uint32_t to, uint32_t count);
+
+    /// state of the particles, one array per component
+    std::vector<float> _px, _py, _pz;
+    std::vector<float> _vx, _vy, _vz;
+    std::vector<float> _age, _inv_life;
+    uint32_t _count = 0;
+    /// streams of the billboards, each of _count elements, in the layout of the buffers: x, y, z, size, then the colors
+    std::vector<float> _float_streams;
+    std::vector<uint32_t> _colors;
+    std::vector<float> _spawn_debt;     ///< fraction of a particle left by each emitter
+    std::vector<uint32_t> _chunk_alive; ///< living particles at the start of each chunk, while killing
+    uint32_t _seed = 0;                 ///< of the random numbers, one per emitter and step
+
+    sg_pipeline _pip = {SG_INVALID_ID};
+    sg_buffer _quad = {SG_INVALID_ID};
+    sg_buffer _float_buffer = {SG_INVALID_ID};
+    sg_buffer _color_buffer = {SG_INVALID_ID};
+    uint32_t _buffer_capacity = 0; ///< particles, of both buffers
+    uint32_t _num_uploaded = 0;
+    ParticleStats _stats;
+};
+
+} // namespace glengine
@@ -0,0 +1,824 @@
+#include "gl_point_cloud.h"
+#include "gl_camera.h"
+#include "gl_engine.h"
+#include "gl_logger.h"
+#include "gl_thread_pool.h"
+#include "gl_utils.h"
+#include "generated/shaders/point_cloud.glsl.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <mutex>
+#include <queue>
+
+namespace {
+
+double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint16_t quantize(float v, float min, float scale) {
+    return uint16_t(std::min(std::max((v - min) * scale + 0.5f, 0.0f), 65535.0f));
+}
+
+// points of a node, quantized in its bounds
+void quantize_points(const std::vector<math::Vector3f> &positions, const std::vector<glengine::Color> &colors,
+                     const math::Vector3f &bbox_min, float size, glengine::PointCloudPoint *dst) {
+    const float scale = 65535.0f / size;
+    for (size_t k = 0; k < positions.size(); k++) {
+        const math::Vector3f &p = positions[k];
+        dst[k] = {{quantize(p.x, bbox_min.x, scale), quantize(p.y, bbox_min.y, scale),
+                   quantize(p.z, bbox_min.z, scale), 0},
+                  colors[k]};
+    }
+}
+
+// cell of the sampling grid of a node containing a position (in cells from the node min) along an axis
+uint32_t grid_cell(float local, uint32_t res) {
+    return std::min(uint32_t(std::max(local, 0.0f)), res - 1);
+}
+
+// octant (x | y << 1 | z << 2) of a position in cells from the node min
+uint32_t octant_of(const math::Vector3f &local, uint32_t res) {
+    return (local.x >= res * 0.5f ? 1 : 0) | (local.y >= res * 0.5f ? 2 : 0) | (local.z >= res * 0.5f ? 4 : 0);
+}
+
+math::Vector3f octant_min(const math::Vector3f &bbox_min, float half, uint32_t octant) {
+    return bbox_min + math::Vector3f{octant & 1 ? half : 0.0f, octant & 2 ? half : 0.0f, octant & 4 ? half : 0.0f};
+}
+
+uint32_t count_children(uint8_t child_mask) {
+    uint32_t count = 0;
+    for (; child_mask; child_mask &= child_mask - 1) {
+        count++;
+    }
+    return count;
+}
+
+// at most 8^4 chunks, so that their spill buffers of 64 KB stay within 256 MB
+constexpr uint32_t MAX_CHUNK_LEVEL = 4;
+constexpr size_t CHUNK_BUFFER_POINTS = 4096;
+
+} // namespace
+
+namespace glengine {
+
+// /////// //
+// builder //
+// /////// //
+
+void PointCloudBuilder::init(const math::Vector3f &bbox_min, const math::Vector3f &bbox_max,
+                             const PointCloudBuildParams &params) {
+    _params = params;
+    // the cells of a node are indexed with 32 bits
+    _params.grid_resolution = std::min(std::max(_params.grid_resolution, 2u), 1024u);
+    _params.max_leaf_points = std::max(_params.max_leaf_points, 1u);
+    _nodes.clear();
+    _num_points = 0;
+    const math::Vector3f extent = bbox_max - bbox_min;
+    create_node(bbox_min, std::max(std::max(std::max(extent.x, extent.y), extent.z), 1e-6f), 0);
+}
+
+uint32_t PointCloudBuilder::create_node(const math::Vector3f &bbox_min, float size, uint32_t level) {
+    _nodes.emplace_back();
+    Node &node = _nodes.back();
+    node.bbox_min = bbox_min;
+    node.size = size;
+    node.level = level;
+    std::fill(node.children, node.children + 8, -1);
+    return uint32_t(_nodes.size() - 1);
+}
+
+void PointCloudBuilder::add(const math::Vector3f &pos, Color color) {
+    if (_nodes.empty()) {
+        return;
+    }
+    const Node &root = _nodes[0];
+    const math::Vector3f clamped = {std::min(std::max(pos.x, root.bbox_min.x), root.bbox_min.x + root.size),
+                                    std::min(std::max(pos.y, root.bbox_min.y), root.bbox_min.y + root.size),
+                                    std::min(std::max(pos.z, root.bbox_min.z), root.bbox_min.z + root.size)};
+    insert(0, clamped, color);
+    _num_points++;
+}
+
+void PointCloudBuilder::insert(uint32_t index, const math::Vector3f &pos, Color color) {
+    const uint32_t res = _params.grid_resolution;
+    for (;;) {
+        Node &node = _nodes[index];
+        if (node.leaf) {
+            node.positions.push_back(pos);
+            node.colors.push_back(color);
+            if (node.positions.size() > _params.max_leaf_points && node.level < _params.max_depth) {
+                split(index);
+            }
+            return;
+        }
+        // the first point in a cell of the grid stays in the node, the others go down to the children
+        const math::Vector3f local = (pos - node.bbox_min) * (float(res) / node.size);
+        const uint32_t cx = grid_cell(local.x, res), cy = grid_cell(local.y, res), cz = grid_cell(local.z, res);
+        if (node.cells.insert((cz * res + cy) * res + cx).second) {
+            node.positions.push_back(pos);
+            node.colors.push_back(color);
+            return;
+        }
+        const uint32_t octant = octant_of(local, res);
+        if (node.children[octant] < 0) {
+            const float half = node.size * 0.5f;
+            // creating the child invalidates node
+            const uint32_t child = create_node(octant_min(node.bbox_min, half, octant), half, node.level + 1);
+            _nodes[index].children[octant] = int32_t(child);
+        }
+        index = uint32_t(_nodes[index].children[octant]);
+    }
+}
+
+void PointCloudBuilder::split(uint32_t index) {
+    std::vector<math::Vector3f> positions = std::move(_nodes[index].positions);
+    std::vector<Color> colors = std::move(_nodes[index].colors);
+    _nodes[index].positions.clear();
+    _nodes[index].colors.clear();
+    _nodes[index].leaf = false;
+    for (size_t i = 0; i < positions.size(); i++) {
+        insert(index, positions[i], colors[i]);
+    }
+}
+
+uint32_t PointCloudBuilder::create_path(const uint8_t *octants, uint32_t depth) {
+    uint32_t index = 0;
+    for (uint32_t level = 0; level < depth; level++) {
+        _nodes[index].leaf = false;
+        const uint32_t octant = octants[level];
+        if (_nodes[index].children[octant] < 0) {
+            const float half = _nodes[index].size * 0.5f;
+            const uint32_t child = create_node(octant_min(_nodes[index].bbox_min, half, octant), half, level + 1);
+            _nodes[index].children[octant] = int32_t(child);
+        }
+        index = uint32_t(_nodes[index].children[octant]);
+    }
+    return index;
+}
+
+void PointCloudBuilder::build(PackagePointCloud &cloud, std::vector<uint8_t> &points) const {
+    cloud = PackagePointCloud();
+    points.clear();
+    if (_nodes.empty()) {
+        return;
+    }
+    cloud.bbox_min = _nodes[0].bbox_min;
+    cloud.size = _nodes[0].size;
+    cloud.grid_resolution = _params.grid_resolution;
+    cloud.num_points = _num_points;
+    points.reserve(_num_points * sizeof(PointCloudPoint));
+    // breadth first, the children of each node are appended to the order as it is visited
+    std::vector<uint32_t> order = {0};
+    for (size_t i = 0; i < order.size(); i++) {
+        const Node &node = _nodes[order[i]];
+        PackagePointNode pn;
+        pn.offset = points.size();
+        pn.num_points = uint32_t(node.positions.size());
+        pn.first_child = uint32_t(order.size());
+        for (uint32_t octant = 0; octant < 8; octant++) {
+            if (node.children[octant] >= 0) {
+                pn.child_mask |= uint8_t(1 << octant);
+                order.push_back(uint32_t(node.children[octant]));
+            }
+        }
+        if (!pn.child_mask) {
+            pn.first_child = 0;
+        }
+        points.resize(points.size() + node.positions.size() * sizeof(PointCloudPoint));
+        quantize_points(node.positions, node.colors, node.bbox_min, node.size,
+                        reinterpret_cast<PointCloudPoint *>(points.data() + pn.offset));
+        cloud.nodes.push_back(pn);
+    }
+}
+
+void PointCloudBuilder::build(const std::string &name, std::vector<PackageData> &entries) const {
+    PackagePointCloud cloud;
+    PackageData points = {name + "/points", PackageEntryType::PointCloudPoints, {}};
+    build(cloud, points.data);
+    cloud.points = points.name;
+    PackageData entry = {name, PackageEntryType::PointCloud, {}};
+    encode_point_cloud(cloud, entry.data);
+    entries.push_back(std::move(entry));
+    entries.push_back(std::move(points));
+}
+
+// /////////////// //
+// chunked builder //
+// /////////////// //
+
+PointCloudChunkedBuilder::~PointCloudChunkedBuilder() {
+    clear();
+}
+
+bool PointCloudChunkedBuilder::init(const math::Vector3f &bbox_min, const math::Vector3f &bbox_max,
+                                    const std::string &temp_path, const PointCloudBuildParams &params,
+                                    uint32_t chunk_level) {
+    clear();
+    _params = params;
+    _chunk_level = std::min({chunk_level, params.max_depth, MAX_CHUNK_LEVEL});
+    _temp_path = temp_path;
+    // the leaves of the levels above the chunks are the chunk roots, they are never split
+    PointCloudBuildParams upper_params = params;
+    upper_params.max_depth = _chunk_level;
+    _upper.init(bbox_min, bbox_max, upper_params);
+    _params.grid_resolution = _upper._params.grid_resolution;
+    _chunks.resize(size_t(1) << (3 * _chunk_level));
+    _num_points = 0;
+    _num_nodes = 0;
+    _ok = true;
+    return true;
+}
+
+std::string PointCloudChunkedBuilder::chunk_path(uint32_t chunk) const {
+    return _temp_path + ".chunk" + std::to_string(chunk);
+}
+
+void PointCloudChunkedBuilder::clear() {
+    for (uint32_t c = 0; c < _chunks.size(); c++) {
+        if (_chunks[c].num_points > _chunks[c].buffer.size()) {
+            remove(chunk_path(c).c_str());
+        }
+    }
+    _chunks.clear();
+    _upper = PointCloudBuilder();
+    _ok = false;
+}
+
+bool PointCloudChunkedBuilder::add(const math::Vector3f &pos, Color color) {
+    if (!_ok) {
+        return false;
+    }
+    // the chunk follows from the octants of the point in the levels above, as PointCloudBuilder::insert finds them
+    const PointCloudBuilder::Node &root = _upper._nodes[0];
+    const math::Vector3f clamped = {std::min(std::max(pos.x, root.bbox_min.x), root.bbox_min.x + root.size),
+                                    std::min(std::max(pos.y, root.bbox_min.y), root.bbox_min.y + root.size),
+                                    std::min(std::max(pos.z, root.bbox_min.z), root.bbox_min.z + root.size)};
+    const uint32_t res = _params.grid_resolution;
+    math::Vector3f bbox_min = root.bbox_min;
+    float size = root.size;
+    uint32_t chunk = 0;
+    for (uint32_t level = 0; level < _chunk_level; level++) {
+        const uint32_t octant = octant_of((clamped - bbox_min) * (float(res) / size), res);
+        chunk = chunk * 8 + octant;
+        size *= 0.5f;
+        bbox_min = octant_min(bbox_min, size, octant);
+    }
+    Chunk &c = _chunks[chunk];
+    if (c.buffer.empty()) {
+        c.buffer.reserve(CHUNK_BUFFER_POINTS);
+    }
+    c.buffer.push_back({clamped, color});
+    c.num_points++;
+    _num_points++;
+    if (c.buffer.size() >= CHUNK_BUFFER_POINTS) {
+        _ok = flush(chunk);
+    }
+    return _ok;
+}
+
+bool PointCloudChunkedBuilder::flush(uint32_t chunk) {
+    Chunk &c = _chunks[chunk];
+    if (c.buffer.empty()) {
+        return true;
+    }
+    // the file is created by the first flush, files left by a previous build are overwritten
+    const std::string path = chunk_path(chunk);
+    FILE *f = fopen(path.c_str(), c.num_points > c.buffer.size() ? "ab" : "wb");
+    bool ok = f && fwrite(c.buffer.data(), sizeof(ChunkPoint), c.buffer.size(), f) == c.buffer.size();
+    ok = f && fclose(f) == 0 && ok;
+    if (!ok) {
+        log_error("point cloud: unable to write '%s'", path.c_str());
+    }
+    // the buffer is released, it is allocated again by the next point of the chunk
+    std::vector<ChunkPoint>().swap(c.buffer);
+    return ok;
+}
+
+bool PointCloudChunkedBuilder::build(const char *filename, const std::string &name,
+                                     const std::vector<PackageData> &entries) {
+    bool ok = _ok;
+    for (uint32_t c = 0; c < _chunks.size() && ok; c++) {
+        ok = flush(c);
+    }
+    PackageWriter writer;
+    ok = ok && writer.open(filename);
+    for (size_t i = 0; i < entries.size() && ok; i++) {
+        ok = writer.add(entries[i]);
+    }
+    PackagePointCloud cloud;
+    cloud.points = name + "/points";
+    writer.begin_entry(cloud.points, PackageEntryType::PointCloudPoints);
+
+    const uint32_t res = _params.grid_resolution;
+    std::vector<std::vector<PackagePointNode>> subtrees(_chunks.size()); ///< the nodes of every chunk
+    std::vector<PackagePointNode> upper_points;                          ///< points of the levels above the chunks
+    std::vector<int64_t> upper_chunks;                                   ///< chunk of the chunk roots, or -1
+    std::vector<uint8_t> data;
+    std::vector<ChunkPoint> points;
+    for (uint32_t c = 0; c < _chunks.size() && ok; c++) {
+        if (_chunks[c].num_points == 0) {
+            continue;
+        }
+        const std::string path = chunk_path(c);
+        points.resize(_chunks[c].num_points);
+        FILE *f = fopen(path.c_str(), "rb");
+        ok = f && fread(points.data(), sizeof(ChunkPoint), points.size(), f) == points.size();
+        if (f) {
+            fclose(f);
+        }
+        remove(path.c_str());
+        _chunks[c].num_points = 0;
+        if (!ok) {
+            log_error("point cloud: unable to read '%s'", path.c_str());
+            break;
+        }
+
+        // the levels above down to the chunk root, which gets the bounds and the level of the chunk in the octree
+        uint8_t octants[MAX_CHUNK_LEVEL];
+        for (uint32_t level = 0; level < _chunk_level; level++) {
+            octants[level] = uint8_t((c >> (3 * (_chunk_level - 1 - level))) & 7);
+        }
+        const uint32_t chunk_root = _upper.create_path(octants, _chunk_level);
+        std::vector<uint32_t> path_nodes = {0};
+        for (uint32_t level = 0; level < _chunk_level; level++) {
+            path_nodes.push_back(uint32_t(_upper._nodes[path_nodes.back()].children[octants[level]]));
+        }
+        const PointCloudBuilder::Node &root = _upper._nodes[chunk_root];
+        PointCloudBuilder chunk;
+        chunk.init(root.bbox_min, root.bbox_min + math::Vector3f{root.size, root.size, root.size}, _params);
+        chunk._nodes[0].bbox_min = root.bbox_min;
+        chunk._nodes[0].size = root.size;
+        chunk._nodes[0].level = _chunk_level;
+        for (const ChunkPoint &p : points) {
+            chunk.add(p.pos, p.color);
+        }
+        std::vector<ChunkPoint>().swap(points);
+
+        // the nodes below the chunk root are final: they are written as they are
+        std::vector<math::Vector3f> positions = std::move(chunk._nodes[0].positions);
+        std::vector<Color> colors = std::move(chunk._nodes[0].colors);
+        chunk._nodes[0].positions.clear();
+        chunk._nodes[0].colors.clear();
+        PackagePointCloud sub;
+        chunk.build(sub, data);
+        chunk = PointCloudBuilder();
+        const uint64_t base = writer.entry_size();
+        ok = writer.write(data.data(), data.size());
+        for (auto &node : sub.nodes) {
+            node.offset += base;
+        }
+        subtrees[c] = std::move(sub.nodes);
+
+        // merge: the points of the chunk root go up to the first level above with their cell free, as if they had
+        // been inserted from the root. Only the path of the chunk is involved, so the chunk root is final too
+        for (size_t k = 0; k < positions.size(); k++) {
+            uint32_t level = 0;
+            for (; level < _chunk_level; level++) {
+                PointCloudBuilder::Node &node = _upper._nodes[path_nodes[level]];
+                const math::Vector3f local = (positions[k] - node.bbox_min) * (float(res) / node.size);
+                const uint32_t cx = grid_cell(local.x, res), cy = grid_cell(local.y, res);
+                const uint32_t cz = grid_cell(local.z, res);
+                if (node.cells.insert((cz * res + cy) * res + cx).second) {
+                    node.positions.push_back(positions[k]);
+                    node.colors.push_back(colors[k]);
+                    break;
+                }
+            }
+            if (level == _chunk_level) {
+                _upper._nodes[chunk_root].positions.push_back(positions[k]);
+                _upper._nodes[chunk_root].colors.push_back(colors[k]);
+            }
+        }
+        PointCloudBuilder::Node &leaf = _upper._nodes[chunk_root];
+        data.resize(leaf.positions.size() * sizeof(PointCloudPoint));
+        quantize_points(leaf.positions, leaf.colors, leaf.bbox_min, leaf.size,
+                        reinterpret_cast<PointCloudPoint *>(data.data()));
+        upper_points.resize(_upper._nodes.size());
+        upper_chunks.resize(_upper._nodes.size(), -1);
+        upper_points[chunk_root].offset = writer.entry_size();
+        upper_points[chunk_root].num_points = uint32_t(leaf.positions.size());
+        upper_chunks[chunk_root] = c;
+        ok = ok && writer.write(data.data(), data.size());
+        std::vector<math::Vector3f>().swap(leaf.positions);
+        std::vector<Color>().swap(leaf.colors);
+    }
+
+    // the levels above the chunks
+    upper_points.resize(_upper._nodes.size());
+    upper_chunks.resize(_upper._nodes.size(), -1);
+    for (uint32_t i = 0; i < _upper._nodes.size() && ok; i++) {
+        const PointCloudBuilder::Node &node = _upper._nodes[i];
+        if (upper_chunks[i] >= 0) {
+            continue;
+        }
+        data.resize(node.positions.size() * sizeof(PointCloudPoint));
+        quantize_points(node.positions, node.colors, node.bbox_min, node.size,
+                        reinterpret_cast<PointCloudPoint *>(data.data()));
+        upper_points[i].offset = writer.entry_size();
+        upper_points[i].num_points = uint32_t(node.positions.size());
+        ok = writer.write(data.data(), data.size());
+    }
+    writer.end_entry();
+
+    // breadth first over the levels above the chunks, then the nodes of the chunks (the chunk is -1 for the levels
+    // above, the nodes of which are the ones of _upper)
+    struct NodeRef {
+        int64_t chunk;
+        uint32_t node;
+    };
+    std::vector<NodeRef> order;
+    if (ok && !upper_chunks.empty()) {
+        order.push_back({-1, 0});
+    }
+    for (size_t i = 0; i < order.size(); i++) {
+        const NodeRef ref = order[i];
+        PackagePointNode pn;
+        if (ref.chunk < 0 && upper_chunks[ref.node] < 0) {
+            const PointCloudBuilder::Node &node = _upper._nodes[ref.node];
+            pn = upper_points[ref.node];
+            pn.first_child = uint32_t(order.size());
+            for (uint32_t octant = 0; octant < 8; octant++) {
+                if (node.children[octant] >= 0) {
+                    pn.child_mask |= uint8_t(1 << octant);
+                    order.push_back({-1, uint32_t(node.children[octant])});
+                }
+            }
+        } else {
+            // a chunk root takes its points from the levels above and its children from the chunk
+            const int64_t chunk = ref.chunk < 0 ? upper_chunks[ref.node] : ref.chunk;
+            const uint32_t index = ref.chunk < 0 ? 0 : ref.node;
+            const PackagePointNode &sub = subtrees[chunk][index];
+            pn = ref.chunk < 0 ? upper_points[ref.node] : sub;
+            pn.child_mask = sub.child_mask;
+            pn.first_child = uint32_t(order.size());
+            for (uint32_t k = 0, n = count_children(sub.child_mask); k < n; k++) {
+                order.push_back({chunk, sub.first_child + k});
+            }
+        }
+        if (!pn.child_mask) {
+            pn.first_child = 0;
+        }
+        cloud.nodes.push_back(pn);
+    }
+
+    cloud.bbox_min = _upper._nodes.empty() ? math::Vector3f{0.0f, 0.0f, 0.0f} : _upper._nodes[0].bbox_min;
+    cloud.size = _upper._nodes.empty() ? 0.0f : _upper._nodes[0].size;
+    cloud.grid_resolution = res;
+    cloud.num_points = _num_points;
+    _num_nodes = uint32_t(cloud.nodes.size());
+    PackageData entry = {name, PackageEntryType::PointCloud, {}};
+    encode_point_cloud(cloud, entry.data);
+    ok = ok && writer.add(entry);
+    ok = writer.close() && ok;
+    clear();
+    return ok;
+}
+
+// //////// //
+// renderer //
+// //////// //
+
+/// state shared with the loads running on the worker threads
+struct PointCloud::Shared {
+    struct Loaded {
+        uint32_t node;
+        bool ok;
+        std::vector<uint8_t> data;
+    };
+
+    bool from_package = false;
+    Package package;
+    PackageEntry points_entry;
+    std::vector<uint8_t> points; ///< when the cloud is in memory
+    std::mutex package_mutex;
+    std::mutex loaded_mutex;
+    std::deque<Loaded> loaded;
+};
+
+bool PointCloud::init(GLEngine &eng, const char *filename, const char *name) {
+    terminate();
+    auto shared = std::make_shared<Shared>();
+    Package &package = shared->package;
+    if (!package.open(filename)) {
+        log_error("point cloud: unable to open package '%s'", filename);
+        return false;
+    }
+    const PackageEntry *entry = nullptr;
+    for (const auto &e : package.entries()) {
+        if (e.type == PackageEntryType::PointCloud && (!name || e.name == name)) {
+            entry = &e;
+            break;
+        }
+    }
+    std::vector<uint8_t> data;
+    PackagePointCloud cloud;
+    if (!entry || !package.read(*entry, data) || !decode_point_cloud(data.data(), data.size(), cloud)) {
+        log_error("point cloud: package '%s' has no valid point cloud '%s'", filename, name ? name : "");
+        return false;
+    }
+    const PackageEntry *points = package.find(cloud.points);
+    if (!points || points->type != PackageEntryType::PointCloudPoints) {
+        log_error("point cloud: package '%s' has no points entry '%s'", filename, cloud.points.c_str());
+        return false;
+    }
+    shared->from_package = true;
+    shared->points_entry = *points;
+    _shared = shared;
+    return init_nodes(eng, cloud);
+}
+
+bool PointCloud::init(GLEngine &eng, const PackagePointCloud &cloud, std::vector<uint8_t> &&points) {
+    terminate();
+    _shared = std::make_shared<Shared>();
+    _shared->points = std::move(points);
+    return init_nodes(eng, cloud);
+}
+
+bool PointCloud::init_nodes(GLEngine &eng, const PackagePointCloud &cloud) {
+    const uint64_t points_size = _shared->from_package ? _shared->points_entry.size : _shared->points.size();
+    _nodes.resize(cloud.nodes.size());
+    bool ok = !_nodes.empty() && cloud.size > 0.0f && cloud.grid_resolution > 0;
+    if (ok) {
+        _nodes[0].bbox_min = cloud.bbox_min;
+        _nodes[0].size = cloud.size;
+    }
+    // the bounds of the children follow from the ones of their parent, which come first
+    for (uint32_t i = 0; i < _nodes.size() && ok; i++) {
+        const PackagePointNode &pn = cloud.nodes[i];
+        Node &node = _nodes[i];
+        node.offset = pn.offset;
+        node.num_points = pn.num_points;
+        node.first_child = pn.first_child;
+        node.child_mask = pn.child_mask;
+        ok = node.offset + node_bytes(node) <= points_size;
+        for (uint32_t octant = 0, child = pn.first_child; octant < 8 && ok; octant++) {
+            if (!(pn.child_mask & (1 << octant))) {
+                continue;
+            }
+            ok = child > i && child < _nodes.size();
+            if (ok) {
+                const float half = node.size * 0.5f;
+                _nodes[child].bbox_min = node.bbox_min + math::Vector3f{octant & 1 ? half : 0.0f,
+                                                                        octant & 2 ? half : 0.0f,
+                                                                        octant & 4 ? half : 0.0f};
+                _nodes[child].size = half;
+            }
+            child++;
+        }
+    }
+    if (!ok) {
+        log_error("point cloud: invalid octree");
+        _nodes.clear();
+        _shared.reset();
+        return false;
+    }
+    _eng = &eng;
+    _grid_resolution = cloud.grid_resolution;
+
+    ResourceManager &rm = eng.resource_manager();
+    sg_shader shader = rm.get_or_create_shader(*point_cloud_shader_desc(sg_query_backend()));
+    sg_pipeline_desc pip_desc = {0};
+    pip_desc.layout.buffers[0].stride = sizeof(PointCloudPoint);
+    pip_desc.layout.attrs[ATTR_vs_point_cloud_vertex_pos].format = SG_VERTEXFORMAT_USHORT4N;
+    pip_desc.layout.attrs[ATTR_vs_point_cloud_vertex_color].format = SG_VERTEXFORMAT_UBYTE4N;
+    pip_desc.shader = shader;
+    pip_desc.primitive_type = SG_PRIMITIVETYPE_POINTS;
+    pip_desc.depth = {.pixel_format = SG_PIXELFORMAT_DEPTH_STENCIL,
+                      .compare = SG_COMPAREFUNC_LESS_EQUAL,
+                      .write_enabled = true};
+    pip_desc.color_count = eng._config.use_mrt ? 3 : 1;
+    pip_desc.sample_count = sg_query_features().msaa_render_targets ? eng._config.msaa_samples : 1;
+    pip_desc.label = "point cloud pipeline";
+    _pip = rm.get_or_create_pipeline(pip_desc);
+
+    _stats = PointCloudStats();
+    _stats.num_nodes = uint32_t(_nodes.size());
+    _stats.total_points = cloud.num_points;
+    log_info("point cloud: %u nodes, %llu points, %.1f MB", _stats.num_nodes, (unsigned long long)cloud.num_points,
+             points_size / 1048576.0);
+    return _pip.id != SG_INVALID_ID;
+}
+
+void PointCloud::terminate() {
+    for (uint32_t i = 0; i < _nodes.size(); i++) {
+        if (_nodes[i].state == NodeState::Resident) {
+            evict(i);
+        }
+    }
+    _nodes.clear();
+    _selected.clear();
+    // the pending loads keep their own reference, their results are never used
+    _shared.reset();
+    _stats = PointCloudStats();
+}
+
+AABB PointCloud::bounds() const {
+    if (_nodes.empty()) {
+        return {{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}};
+    }
+    const float size = _nodes[0].size;
+    return {_nodes[0].bbox_min + math::Vector3f{size, size, size} * 0.5f, {size, size, size}};
+}
+
+void PointCloud::request(uint32_t index) {
+    Node &node = _nodes[index];
+    node.state = NodeState::Loading;
+    _stats.pending_loads++;
+    _stats.pending_bytes += node_bytes(node);
+    default_thread_pool().submit([shared = _shared, index, offset = node.offset, size = node_bytes(node)]() {
+        Shared::Loaded loaded = {index, true, {}};
+        if (shared->from_package) {
+            std::lock_guard<std::mutex> lock(shared->package_mutex);
+            loaded.ok = shared->package.read(shared->points_entry, offset, size, loaded.data) &&
+                        loaded.data.size() == size;
+        } else {
+            loaded.data.assign(shared->points.begin() + offset, shared->points.begin() + offset + size);
+        }
+        std::lock_guard<std::mutex> lock(shared->loaded_mutex);
+        shared->loaded.push_back(std::move(loaded));
+    });
+}
+
+void PointCloud::upload(uint32_t index, const std::vector<uint8_t> &data) {
+    Node &node = _nodes[index];
+    // the chunked builder can leave nodes without points, they only lead to their children
+    const sg_buffer_desc desc = {.size = data.size(),
+                                 .type = SG_BUFFERTYPE_VERTEXBUFFER,
+                                 .usage = SG_USAGE_IMMUTABLE,
+                                 .data = {data.data(), data.size()},
+                                 .label = "point-cloud-node"};
+    if (!data.empty()) {
+        node.buffer = _eng->_config.deferred_uploads ? _eng->upload_queue().make_buffer(desc) : sg_make_buffer(desc);
+    }
+    node.state = NodeState::Resident;
+    node.last_selected = _frame; // not to be evicted before being drawn
+    _stats.resident_nodes++;
+    _stats.resident_bytes += node_bytes(node);
+    _stats.num_loads++;
+}
+
+void PointCloud::evict(uint32_t index) {
+    Node &node = _nodes[index];
+    sg_destroy_buffer(node.buffer);
+    node.buffer = {SG_INVALID_ID};
+    node.state = NodeState::Unloaded;
+    _stats.resident_nodes--;
+    _stats.resident_bytes -= node_bytes(node);
+    _stats.num_evictions++;
+}
+
+void PointCloud::update(const Camera &cam, float viewport_height) {
+    if (!_shared) {
+        return;
+    }
+    const double start = now_ms();
+    _frame++;
+
+    // upload the nodes loaded since the last update
+    for (uint32_t uploads = 0; uploads < params.max_uploads_per_frame;) {
+        Shared::Loaded loaded;
+        {
+            std::lock_guard<std::mutex> lock(_shared->loaded_mutex);
+            if (_shared->loaded.empty()) {
+                break;
+            }
+            loaded = std::move(_shared->loaded.front());
+            _shared->loaded.pop_front();
+        }
+        Node &node = _nodes[loaded.node];
+        _stats.pending_loads--;
+        _stats.pending_bytes -= node_bytes(node);
+        if (!loaded.ok) {
+            log_warning("point cloud: unable to read node %u", loaded.node);
+            node.state = NodeState::Failed;
+            continue;
+        }
+        upload(loaded.node, loaded.data);
+        uploads++;
+    }
+
+    // everything is done in the space of the cloud, with the camera position and the scale of the transform
+    const math::Matrix4f &proj = cam.projection();
+    const bool perspective = proj(3, 2) != 0.0f;
+    _pixels_per_unit = 0.5f * viewport_height * proj(1, 1);
+    const math::Matrix4f &cam_tf = cam.transform();
+    const math::Vector3f cam_pos = math::inverse(transform) * math::Vector3f{cam_tf(0, 3), cam_tf(1, 3), cam_tf(2, 3)};
+    const float scale = math::length(math::Vector3f{transform(0, 0), transform(1, 0), transform(2, 0)});
+    math::Vector4f planes[6];
+    frustum_planes(proj * cam.inverse_transform() * transform, planes);
+    // size on screen in pixels of a length at the distance of a node
+    auto projected = [&](const Node &node, float length) {
+        if (!perspective) {
+            return length * scale * _pixels_per_unit;
+        }
+        const float half = node.size * 0.5f;
+        const math::Vector3f center = node.bbox_min + math::Vector3f{half, half, half};
+        const float distance = std::max((math::length(center - cam_pos) - half * 1.7320508f) * scale,
+                                        cam.near_plane());
+        return length * scale * _pixels_per_unit / distance;
+    };
+
+    // select the nodes largest on screen first: a node is refined while its spacing is larger than the error, and its
+    // children can only be selected once it is resident
+    _selected.clear();
+    std::vector<uint32_t> requests;
+    uint64_t num_points = 0;
+    std::priority_queue<std::pair<float, uint32_t>> queue;
+    if (intersects(planes, _nodes[0].bbox_min, _nodes[0].bbox_min + math::Vector3f{1, 1, 1} * _nodes[0].size)) {
+        queue.push({projected(_nodes[0], _nodes[0].size), 0});
+    }
+    while (!queue.empty()) {
+        const uint32_t index = queue.top().second;
+        queue.pop();
+        Node &node = _nodes[index];
+        if (node.state != NodeState::Resident) {
+            if (node.state == NodeState::Unloaded) {
+                requests.push_back(index);
+            }
+            continue;
+        }
+        if (num_points + node.num_points > params.point_budget && !_selected.empty()) {
+            break;
+        }
+        _selected.push_back(index);
+        num_points += node.num_points;
+        node.last_selected = _frame;
+        if (projected(node, node.size / _grid_resolution) <= params.max_error) {
+            continue;
+        }
+        for (uint32_t octant = 0, child = node.first_child; octant < 8; octant++) {
+            if (node.child_mask & (1 << octant)) {
+                const Node &c = _nodes[child];
+                if (intersects(planes, c.bbox_min, c.bbox_min + math::Vector3f{1, 1, 1} * c.size)) {
+                    queue.push({projected(c, c.size), child});
+                }
+                child++;
+            }
+        }
+    }
+    _stats.visible_nodes = uint32_t(_selected.size());
+    _stats.visible_points = num_points;
+
+    // make room by evicting the nodes unused for the longest time, the deepest first so that the parents stay
+    std::vector<uint32_t> unused;
+    bool collected = false;
+    size_t evicted = 0;
+    auto make_room = [&](uint64_t bytes) {
+        if (!collected && _stats.resident_bytes + _stats.pending_bytes + bytes > params.memory_budget) {
+            collected = true;
+            for (uint32_t i = 0; i < _nodes.size(); i++) {
+                if (_nodes[i].state == NodeState::Resident && _nodes[i].last_selected != _frame) {
+                    unused.push_back(i);
+                }
+            }
+            std::sort(unused.begin(), unused.end(), [this](uint32_t a, uint32_t b) {
+                return _nodes[a].last_selected < _nodes[b].last_selected ||
+                       (_nodes[a].last_selected == _nodes[b].last_selected && _nodes[a].size < _nodes[b].size);
+            });
+        }
+        while (_stats.resident_bytes + _stats.pending_bytes + bytes > params.memory_budget && evicted < unused.size()) {
+            evict(unused[evicted++]);
+        }
+        return _stats.resident_bytes + _stats.pending_bytes + bytes <= params.memory_budget;
+    };
+    make_room(0);
+    // the requests are already sorted, largest on screen first
+    for (uint32_t index : requests) {
+        if (_stats.pending_loads >= params.max_pending_loads || !make_room(node_bytes(_nodes[index]))) {
+            break;
+        }
+        request(index);
+    }
+    _stats.update_ms = now_ms() - start;
+}
+
+void PointCloud::draw(const Camera &cam) {
+    if (_selected.empty()) {
+        return;
+    }
+    sg_apply_pipeline(_pip);
+    point_cloud_params_t p;
+    p.model_view_projection = cam.projection() * cam.inverse_transform() * transform;
+    const float scale = math::length(math::Vector3f{transform(0, 0), transform(1, 0), transform(2, 0)});
+    p.point_params = {params.point_size, params.adaptive_point_size ? _pixels_per_unit * scale : 0.0f,
+                      std::max(params.max_point_size, params.point_size), 0.0f};
+    for (uint32_t index : _selected) {
+        const Node &node = _nodes[index];
+        if (node.num_points == 0) {
+            continue;
+        }
+        sg_bindings bind = {0};
+        bind.vertex_buffers[0] = node.buffer;
+        sg_apply_bindings(bind);
+        p.node_min = {node.bbox_min.x, node.bbox_min.y, node.bbox_min.z, node.size / _grid_resolution};
+        p.node_size = {node.size, node.size, node.size, 0.0f};
+        sg_apply_uniforms(SG_SHADERSTAGE_VS, SLOT_point_cloud_params, SG_RANGE(p));
+        sg_draw(0, int(node.num_points), 1);
+    }
+}
+
+} // namespace glengine
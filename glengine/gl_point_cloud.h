@@ -0,0 +1,216 @@
+#pragma once
+
+#include "gl_package.h"
+#include "gl_types.h"
+#include "gl_utils.h"
+#include "math/vmath.h"
+
+#include "sokol_gfx.h"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace glengine {
+
+class Camera;
+class GLEngine;
+
+/// point of a cloud as stored and uploaded, 12 bytes instead of the 48 of a Vertex: the position is quantized in the
+/// bounds of its octree node
+struct PointCloudPoint {
+    uint16_t pos[4]; ///< x, y, z in the node bounds, w unused
+    Color color;
+};
+
+struct PointCloudBuildParams {
+    uint32_t grid_resolution = 128;   ///< cells per edge of the sampling grid of a node
+    uint32_t max_leaf_points = 20000; ///< a leaf with more points is split in an inner node and its children
+    uint32_t max_depth = 16;          ///< leaves at this depth are never split
+};
+
+/// incremental construction of a point cloud octree: points can be added in any order and at any time, and build
+/// gives the octree of the points added so far. Leaves keep all their points until they are split, then each node
+/// keeps at most one point per cell of its sampling grid and passes the others to its children, so that every
+/// level is a uniform subsample of the cloud at twice the resolution of its parent. The octree is built in memory:
+/// 16 bytes per point (position and color, more while the vectors grow), plus an entry of the set of occupied cells
+/// (about 40 bytes) for the points kept by the inner nodes, and build() adds the 12 bytes per point of its output.
+/// Clouds that don't fit are built by PointCloudChunkedBuilder
+class PointCloudBuilder {
+  public:
+    /// bounds of the cloud: points added outside of them are clamped
+    void init(const math::Vector3f &bbox_min, const math::Vector3f &bbox_max, const PointCloudBuildParams &params = {});
+    void add(const math::Vector3f &pos, Color color);
+
+    /// the hierarchy of the octree and the points of its nodes (the data of the PointCloudPoints entry). The name of
+    /// the points entry is left empty
+    void build(PackagePointCloud &cloud, std::vector<uint8_t> &points) const;
+    /// same as above, as the PointCloud (named name) and PointCloudPoints (name/points) entries of a package
+    void build(const std::string &name, std::vector<PackageData> &entries) const;
+
+    uint64_t num_points() const { return _num_points; }
+    uint32_t num_nodes() const { return uint32_t(_nodes.size()); }
+
+  private:
+    friend class PointCloudChunkedBuilder;
+
+    struct Node {
+        math::Vector3f bbox_min;
+        float size;
+        uint32_t level;
+        int32_t children[8];
+        bool leaf = true;
+        std::vector<math::Vector3f> positions;
+        std::vector<Color> colors;
+        std::unordered_set<uint32_t> cells; ///< occupied cells of the sampling grid, inner nodes only
+    };
+
+    void insert(uint32_t index, const math::Vector3f &pos, Color color);
+    void split(uint32_t index);
+    uint32_t create_node(const math::Vector3f &bbox_min, float size, uint32_t level);
+    /// node at the end of a path of octants from the root (level 1 first), created with its ancestors, which are inner
+    /// nodes
+    uint32_t create_path(const uint8_t *octants, uint32_t depth);
+
+    PointCloudBuildParams _params;
+    std::vector<Node> _nodes;
+    uint64_t _num_points = 0;
+};
+
+/// out-of-core construction of a point cloud octree like the one of PointCloudBuilder, for clouds that don't fit in
+/// memory. add() sorts the points by chunk, the nodes at chunk_level, into temporary files. build() then builds the
+/// chunks one at a time with a PointCloudBuilder and writes their nodes to the package as soon as they are done, and
+/// merges the points left in the root of every chunk into the levels above the chunks, which keep one point per cell
+/// as usual. In memory are the largest chunk, the levels above the chunks and a spill buffer of 64 KB per chunk
+/// (8^chunk_level chunks)
+class PointCloudChunkedBuilder {
+  public:
+    ~PointCloudChunkedBuilder();
+
+    /// bounds of the cloud: points added outside of them are clamped. The temporary files are named after temp_path
+    /// (i.e. the package being built) followed by .chunk<n>
+    bool init(const math::Vector3f &bbox_min, const math::Vector3f &bbox_max, const std::string &temp_path,
+              const PointCloudBuildParams &params = {}, uint32_t chunk_level = 3);
+    bool add(const math::Vector3f &pos, Color color);
+
+    /// write the package, with the entries followed by the PointCloud (named name) and PointCloudPoints (name/points)
+    /// entries of the octree. The temporary files are removed, and the builder is left empty
+    bool build(const char *filename, const std::string &name, const std::vector<PackageData> &entries = {});
+
+    uint64_t num_points() const { return _num_points; }
+    /// of the last build
+    uint32_t num_nodes() const { return _num_nodes; }
+
+  private:
+    struct ChunkPoint {
+        math::Vector3f pos;
+        Color color;
+    };
+    struct Chunk {
+        uint64_t num_points = 0; ///< in the temporary file and the buffer
+        std::vector<ChunkPoint> buffer;
+    };
+
+    std::string chunk_path(uint32_t chunk) const;
+    bool flush(uint32_t chunk);
+    void clear();
+
+    PointCloudBuildParams _params;
+    uint32_t _chunk_level = 0;
+    std::string _temp_path;
+    PointCloudBuilder _upper; ///< the levels above the chunks, the chunk roots are its leaves
+    std::vector<Chunk> _chunks;
+    uint64_t _num_points = 0;
+    uint32_t _num_nodes = 0;
+    bool _ok = false;
+};
+
+/// settings of the point cloud rendering, they can be changed at any time
+struct PointCloudParams {
+    uint32_t point_budget = 5000000; ///< points drawn per frame, nodes are selected by projected size until reached
+    float max_error = 2.0f;          ///< nodes are refined while the spacing of their points is larger on screen
+    float point_size = 2.0f;         ///< in pixels
+    bool adaptive_point_size = true; ///< points as large as the projected spacing of their node, at least point_size
+    float max_point_size = 16.0f;    ///< of the adaptive size, in pixels
+    uint64_t memory_budget = uint64_t(512) << 20; ///< vertex buffers of the resident and pending nodes
+    uint32_t max_pending_loads = 8;               ///< nodes read by the worker threads at the same time
+    uint32_t max_uploads_per_frame = 16;          ///< nodes uploaded per update, to bound the cost of a frame
+};
+
+struct PointCloudStats {
+    uint32_t num_nodes = 0;
+    uint32_t resident_nodes = 0;
+    uint32_t visible_nodes = 0; ///< drawn by the last frame
+    uint32_t pending_loads = 0; ///< nodes being read, or waiting to be uploaded
+    uint64_t total_points = 0;
+    uint64_t visible_points = 0;
+    uint64_t resident_bytes = 0;
+    uint64_t pending_bytes = 0;
+    uint64_t num_loads = 0; ///< nodes uploaded since init
+    uint64_t num_evictions = 0;
+    double update_ms = 0.0; ///< spent by the last update (selection, requests and uploads)
+};
+
+/// out-of-core rendering of a point cloud octree (see PointCloudBuilder): each frame the nodes are selected by
+/// screen space error against the camera, largest on screen first, until the point budget is reached. Only the
+/// selected nodes whose parent is resident are requested: their points are read on the worker threads and uploaded by
+/// update() on the main thread. Resident nodes that haven't been selected for the longest time are evicted to stay
+/// within the memory budget. Nodes are drawn with one draw call each, as points in the offscreen pass (see
+/// GLEngine::add_draw_function)
+class PointCloud {
+  public:
+    /// open the PointCloud entry of a package (the first one if name is null), its points are read on demand
+    bool init(GLEngine &eng, const char *filename, const char *name = nullptr);
+    /// same as above, with the points in memory (i.e. just built)
+    bool init(GLEngine &eng, const PackagePointCloud &cloud, std::vector<uint8_t> &&points);
+    /// evict all the nodes. Loads still running on the worker threads are discarded
+    void terminate();
+
+    /// select the nodes for the camera, request the missing ones and upload the nodes loaded since the last update.
+    /// Has to be called on the main thread, once per frame before rendering
+    void update(const Camera &cam, float viewport_height);
+    /// draw the nodes selected by the last update, in the current pass
+    void draw(const Camera &cam);
+
+    const PointCloudStats &stats() const { return _stats; }
+    /// bounds of the root node, in the space of transform
+    AABB bounds() const;
+
+    math::Matrix4f transform = math::matrix4_identity<float>();
+    PointCloudParams params;
+
+  private:
+    enum class NodeState { Unloaded, Loading, Resident, Failed };
+    struct Node {
+        math::Vector3f bbox_min;
+        float size;
+        uint64_t offset;
+        uint32_t num_points;
+        uint32_t first_child;
+        uint8_t child_mask;
+        NodeState state = NodeState::Unloaded;
+        uint64_t last_selected = 0; ///< frame
+        sg_buffer buffer = {SG_INVALID_ID};
+    };
+    struct Shared;
+
+    bool init_nodes(GLEngine &eng, const PackagePointCloud &cloud);
+    void request(uint32_t index);
+    void upload(uint32_t index, const std::vector<uint8_t> &data);
+    void evict(uint32_t index);
+    uint64_t node_bytes(const Node &node) const { return uint64_t(node.num_points) * sizeof(PointCloudPoint); }
+
+    GLEngine *_eng = nullptr;
+    sg_pipeline _pip = {SG_INVALID_ID};
+    std::vector<Node> _nodes;
+    uint32_t _grid_resolution = 1;
+    std::shared_ptr<Shared> _shared; ///< package and loaded nodes, also owned by the pending loads
+    std::vector<uint32_t> _selected;
+    float _pixels_per_unit = 0.0f; ///< at distance 1, for the viewport of the last update
+    uint64_t _frame = 0;
+    PointCloudStats _stats;
+};
+
+} // namespace glengine
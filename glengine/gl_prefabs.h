@@ -9,6 +9,10 @@ namespace glengine {
 struct MeshData {
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
+    /// levels of detail, ranges of the indices from the full mesh (see generate_lods), empty without
+    std::vector<MeshLod> lods;
+    /// clusters of the triangles of the full mesh (see build_meshlets), empty without
+    std::vector<Meshlet> meshlets;
 };
 
 MeshData create_axis_data();
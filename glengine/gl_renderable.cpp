@@ -1,8 +1,13 @@
 #include "gl_renderable.h"
 
+#include "gl_camera.h"
 #include "gl_mesh.h"
 #include "gl_material.h"
 
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
 namespace glengine {
 
 Renderable::Renderable(Mesh *msh, Material *mtl) {
@@ -27,10 +32,22 @@ void Renderable::update_bindings() {
     assert(material && "invalid material pointer");
     mesh->update_bindings(bind);
     material->update_bindings(bind);
+    bind.vertex_buffers[1] = instances;
+    culled = false;
+}
+
+void Renderable::set_instances(sg_buffer buffer, uint32_t num_) {
+    instances = buffer;
+    num_instances = buffer.id != SG_INVALID_ID ? num_ : 1;
+    bind.vertex_buffers[1] = instances;
+}
+
+sg_pipeline Renderable::pipeline() const {
+    return material->pipeline(mesh->layout, instances.id != SG_INVALID_ID);
 }
 
 void Renderable::apply_pipeline() {
-    sg_apply_pipeline(material->pip);
+    sg_apply_pipeline(pipeline());
 }
 
 void Renderable::apply_bindings() {
@@ -41,11 +58,77 @@ void Renderable::apply_uniforms(const common_uniform_params_t &params) {
     material->apply_uniforms(params);
 }
 
+bool Renderable::select_lod(const Camera &cam, const math::Matrix4f &model, const LodParams &params) {
+    const uint32_t prev = lod;
+    const std::vector<MeshLod> &lods = mesh->lods;
+    if (!params.enabled || lods.size() < 2 || instances.id != SG_INVALID_ID) {
+        lod = 0;
+        return lod != prev;
+    }
+    // radius scaled by the largest axis of the model transform, over the clip w of the center: the diameter over the
+    // height of the viewport, for perspective and orthographic projections
+    const math::Vector4f &sphere = mesh->bounding_sphere;
+    float scale = 0.0f;
+    for (int c = 0; c < 3; c++) {
+        scale = std::max(scale, math::length(math::Vector3f{model(0, c), model(1, c), model(2, c)}));
+    }
+    const math::Vector4f clip = cam.projection() * cam.inverse_transform() * model *
+                                math::Vector4f{sphere.x, sphere.y, sphere.z, 1.0f};
+    const float size = clip.w > 0.0f ? params.bias * sphere.w * scale * cam.projection()(1, 1) / clip.w : FLT_MAX;
+    // finer while the current level is too coarse, then coarser once well within the next level
+    lod = std::min(lod, uint32_t(lods.size() - 1));
+    while (lod > 0 && size > lods[lod].screen_size) {
+        lod--;
+    }
+    while (lod + 1 < lods.size() && size <= lods[lod + 1].screen_size * (1.0f - params.hysteresis)) {
+        lod++;
+    }
+    return lod != prev;
+}
+
+void Renderable::reset_culling() {
+    if (culled) {
+        bind.index_buffer = mesh->ibuf;
+        bind.index_buffer_offset = 0;
+        culled = false;
+        num_culled_indices = 0;
+    }
+}
+
+uint32_t Renderable::num_elements(bool full) const {
+    if (mesh->indices.empty()) {
+        return uint32_t(mesh->num_vertices());
+    }
+    if (culled && !full) {
+        return num_culled_indices;
+    }
+    if (mesh->lods.empty()) {
+        return uint32_t(mesh->indices.size());
+    }
+    return mesh->lods[full ? 0 : std::min(lod, uint32_t(mesh->lods.size() - 1))].num_indices;
+}
+
 void Renderable::draw() {
-    if (mesh->indices.size() > 0) {
-        sg_draw(0, mesh->indices.size(), 1);
+    if (mesh->paged()) {
+        // a draw call per page, bound in place of the first vertex buffer
+        sg_bindings page_bind = bind;
+        for (const auto &range : mesh->draw_ranges()) {
+            page_bind.vertex_buffers[0] = range.buffer;
+            sg_apply_bindings(page_bind);
+            sg_draw(range.first, range.count, num_instances);
+        }
+        return;
+    }
+    if (culled) {
+        // from the offset of the bindings
+        sg_draw(0, num_culled_indices, num_instances);
+    } else if (!mesh->lods.empty()) {
+        const MeshLod &level = mesh->lods[std::min(lod, uint32_t(mesh->lods.size() - 1))];
+        sg_draw(level.first_index, level.num_indices, num_instances);
+    } else if (mesh->indices.size() > 0) {
+        sg_draw(0, mesh->indices.size(), num_instances);
     } else {
-        sg_draw(0, mesh->vertices.size(), 1);
+        sg_draw(0, mesh->num_vertices(), num_instances);
     }
 }
 
@@ -10,9 +10,29 @@
 
 namespace glengine {
 
+class Camera;
 class Mesh;
 class Material;
 
+/// selection of the levels of detail of the meshes (see Mesh::lods)
+struct LodParams {
+    bool enabled = true;     ///< else the full meshes are drawn
+    float bias = 1.0f;       ///< scale of the screen sizes, above 1 for finer levels
+    float hysteresis = 0.1f; ///< a level is left for a coarser one this fraction below its screen size
+};
+
+/// counters of the renderables drawn in a frame
+struct RenderStats {
+    uint32_t num_draws = 0;
+    uint32_t num_bindings = 0;       ///< draws that applied their pipeline and bindings, the others share the previous
+    uint64_t num_triangles = 0;      ///< submitted (elements / 3), with the selected levels of detail
+    uint64_t num_triangles_full = 0; ///< that the full meshes would have submitted
+    uint32_t num_lod_switches = 0;
+    uint32_t num_meshlets = 0;         ///< tested by the culling (see MeshletCuller)
+    uint32_t num_meshlets_visible = 0; ///< drawn, out of num_meshlets
+    float meshlet_cull_ms = 0.0f;      ///< of the tests and the copies of the visible indices
+};
+
 struct Renderable {
     Renderable(Mesh *msh, Material *mtl);
 
@@ -21,6 +41,15 @@ struct Renderable {
     Mesh *mesh = nullptr;
     Material *material = nullptr;
     sg_bindings bind = {0};
+    /// per-instance transforms (see set_instances), invalid when the renderable is drawn once
+    sg_buffer instances = {SG_INVALID_ID};
+    uint32_t num_instances = 1;
+    /// level of detail of the mesh drawn (see select_lod)
+    uint32_t lod = 0;
+    /// the index buffer of the bindings holds the visible meshlets of the mesh for the frame, num_culled_indices of
+    /// them, in place of its indices (see MeshletCuller::cull)
+    bool culled = false;
+    uint32_t num_culled_indices = 0;
 
     /// update both the content of the mesh buffers and the bindings
     /// Note: updating the buffers can be expensive; if the mesh data is unchanged, prefer update_bindings() instead
@@ -28,10 +57,29 @@ struct Renderable {
     /// only update the bindings.
     void update_bindings();
 
+    /// draw num_ instances, with the transforms in buffer (3 rows of an affine matrix per instance, applied before
+    /// the model transform). Requires a material with an instanced pipeline for the mesh layout
+    void set_instances(sg_buffer buffer, uint32_t num_);
+
+    /// pipeline of the material for the layout of the mesh, and instancing
+    sg_pipeline pipeline() const;
+
     void apply_pipeline();
     void apply_bindings();
     void apply_uniforms(const common_uniform_params_t &params);
 
+    /// select the level of detail for the screen size of the mesh bounding sphere with the model transform: the
+    /// coarsest level whose screen size is above it, keeping the current one within the hysteresis. Instanced
+    /// renderables keep the full mesh. Returns true if the level changed
+    bool select_lod(const Camera &cam, const math::Matrix4f &model, const LodParams &params);
+
+    /// point the bindings back at the indices of the mesh, when its meshlets were culled
+    void reset_culling();
+
+    /// elements (vertices or indices) drawn per instance at the current level of detail and after the culling of the
+    /// meshlets, or of the full mesh
+    uint32_t num_elements(bool full = false) const;
+
     void draw();
 };
 
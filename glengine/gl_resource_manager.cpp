@@ -3,46 +3,124 @@
 #include "gl_logger.h"
 #include "gl_material.h"
 #include "gl_mesh.h"
+#include "gl_mipmap.h"
+#include "gl_texture_atlas.h"
+#include "gl_texture_compression.h"
+#include "gl_thread_pool.h"
+#include "gl_upload_queue.h"
 
 #include "stb/stb_image.h"
-#include "stb/stb_image_resize.h"
+
+#include <algorithm>
+#include <cstring>
 
 namespace {
 
-// generate mipmaps for all the possible levels
-int generate_mipmaps(uint8_t *mip_levels[SG_MAX_MIPMAPS], int img_width, int img_height, int channels,
-                     sg_image_desc &img_desc) {
-    int level = 1;
-    for (level = 1; level < SG_MAX_MIPMAPS; level++) {
-        uint32_t w = img_width / (1 << level);
-        uint32_t h = img_height / (1 << level);
-        if (w < 1 || h < 1) {
-            break;
-        }
-        mip_levels[level] = (uint8_t *)malloc(w * h * channels);
-        printf("generate mipmap level %d with resolution %dx%d\n", level, w, h);
-        // resize image (starting from the original image). Use explicit call, setting all options
-        if (!stbir_resize_uint8_generic(mip_levels[0], img_width, img_height, 0, // input image data
-                                        mip_levels[level], w, h, 0,              // output image data
-                                        channels, channels == 3 ? STBIR_ALPHA_CHANNEL_NONE : 3, 0, STBIR_EDGE_CLAMP,
-                                        STBIR_FILTER_BOX, STBIR_COLORSPACE_SRGB, 0)) {
-            printf("Error resizing image to %dx%d\n", w, h);
-            break;
-        }
+// fill the image descriptor with all the levels of the mip chain
+void set_mip_chain(const glengine::MipChain &chain, sg_image_desc &img_desc) {
+    for (uint32_t level = 0; level < chain.num_levels; level++) {
+        img_desc.data.subimage[0][level] = {
+            .ptr = chain.level_data(level),
+            .size = chain.levels[level].size,
+        };
+    }
+    img_desc.num_mipmaps = chain.num_levels;
+    log_debug("generated %d mipmap levels", chain.num_levels);
+}
+
+bool uses_mipmaps(sg_filter filter) {
+    return filter == SG_FILTER_NEAREST_MIPMAP_NEAREST || filter == SG_FILTER_NEAREST_MIPMAP_LINEAR ||
+           filter == SG_FILTER_LINEAR_MIPMAP_NEAREST || filter == SG_FILTER_LINEAR_MIPMAP_LINEAR;
+}
+
+// same filter, sampling only the base level
+sg_filter without_mipmaps(sg_filter filter) {
+    if (filter == SG_FILTER_NEAREST_MIPMAP_NEAREST || filter == SG_FILTER_NEAREST_MIPMAP_LINEAR) {
+        return SG_FILTER_NEAREST;
+    }
+    return uses_mipmaps(filter) ? SG_FILTER_LINEAR : filter;
+}
+
+// filters and wrap modes of the image: the requested min filter is kept, unless there are no mipmaps to sample from
+void set_sampler(const glengine::ImageParams &params, uint32_t num_levels, sg_image_desc &img_desc) {
+    img_desc.min_filter = num_levels > 1 ? params.min_filter : without_mipmaps(params.min_filter);
+    img_desc.mag_filter = params.mag_filter;
+    img_desc.wrap_u = params.wrap_u;
+    img_desc.wrap_v = params.wrap_v;
+    img_desc.max_anisotropy = params.max_anisotropy;
+    img_desc.max_lod = params.max_lod;
+}
+
+sg_pixel_format pixel_format(glengine::TextureFormat format) {
+    switch (format) {
+    case glengine::TextureFormat::BC1:
+        return SG_PIXELFORMAT_BC1_RGBA;
+    case glengine::TextureFormat::BC3:
+        return SG_PIXELFORMAT_BC3_RGBA;
+    case glengine::TextureFormat::BC4:
+        return SG_PIXELFORMAT_BC4_R;
+    case glengine::TextureFormat::BC5:
+        return SG_PIXELFORMAT_BC5_RG;
+    default:
+        return SG_PIXELFORMAT_RGBA8;
+    }
+}
+
+// fill the image descriptor with the levels of a compressed image, in the format of the image
+void set_levels(const glengine::CompressedImage &image, sg_image_desc &img_desc) {
+    img_desc.width = image.levels[0].width;
+    img_desc.height = image.levels[0].height;
+    img_desc.pixel_format = pixel_format(image.format);
+    img_desc.num_mipmaps = image.num_levels;
+    for (uint32_t level = 0; level < image.num_levels; level++) {
         img_desc.data.subimage[0][level] = {
-            .ptr = mip_levels[level],
-            .size = w * h * channels,
+            .ptr = image.level_data(level),
+            .size = image.levels[level].size,
         };
     }
-    img_desc.num_mipmaps = level;
-    // img_desc.min_lod = 0.0f;
-    // img_desc.max_lod = 9.0f;
-    img_desc.min_filter = SG_FILTER_LINEAR_MIPMAP_NEAREST;
-    img_desc.min_filter = SG_FILTER_LINEAR_MIPMAP_LINEAR;
-    printf("generated %d mipmap levels\n", level);
-    printf("generated %d mipmap levels\n", img_desc.num_mipmaps);
+}
+
+bool has_extension(const char *filename, const char *extension) {
+    const size_t len = strlen(filename), ext_len = strlen(extension);
+    return len >= ext_len && strcmp(filename + len - ext_len, extension) == 0;
+}
 
-    return level;
+// cache key of an image identified by its source: the same source sampled differently is a different image
+uint64_t image_key(uint64_t source_key, const glengine::ImageParams &params) {
+    struct {
+        uint64_t source;
+        uint32_t gen_mipmaps, srgb, min_filter, mag_filter, wrap_u, wrap_v, max_anisotropy, flip_vertically;
+        float max_lod;
+        uint32_t padding;
+    } key = {source_key,
+             params.gen_mipmaps,
+             params.srgb,
+             uint32_t(params.min_filter),
+             uint32_t(params.mag_filter),
+             uint32_t(params.wrap_u),
+             uint32_t(params.wrap_v),
+             params.max_anisotropy,
+             params.flip_vertically,
+             params.max_lod,
+             0};
+    return glengine::murmur_hash2_64(&key, sizeof(key), 12345678);
+}
+
+// mip chain of an rgba8 image, with all the levels when the params sample mipmaps
+bool build_image_chain(const uint8_t *pixels, int width, int height, const glengine::ImageParams &params,
+                       glengine::MipChain &chain) {
+    glengine::MipChainOptions options;
+    options.srgb = params.srgb;
+    options.max_levels = params.gen_mipmaps && uses_mipmaps(params.min_filter) ? glengine::MipChain::MAX_LEVELS : 1;
+    return build_mip_chain(pixels, width, height, chain, options);
+}
+
+// settings of the images loaded through the original (filename/data, gen_mipmaps) interface
+glengine::ImageParams legacy_params(bool gen_mipmaps) {
+    glengine::ImageParams params;
+    params.gen_mipmaps = gen_mipmaps;
+    params.flip_vertically = true;
+    return params;
 }
 
 } // namespace
@@ -84,6 +162,9 @@ void ResourceManager::terminate() {
     log_info("ResourceManager: cleanup meshes");
     for (auto &mesh : _meshes) {
         log_debug("Destroying mesh %p", &mesh);
+        for (sg_buffer buf : mesh->instance_buffers) {
+            sg_destroy_buffer(buf);
+        }
         delete mesh;
     }
     // cleanup materials
@@ -104,6 +185,7 @@ void ResourceManager::terminate() {
         sg_destroy_image(_default_images[i]);
     }
     _images.clear();
+    _image_files.clear();
     // cleanup pipeline resources
     log_info("ResourceManager: cleanup pipelines");
     for (auto it : _pipelines) {
@@ -134,73 +216,322 @@ sg_image ResourceManager::get_or_create_image(const sg_image_desc &desc) {
 }
 
 sg_image ResourceManager::get_or_create_image(const char *filename, bool gen_mipmaps) {
-    int img_width, img_height, num_channels;
-    const int desired_channels = 4;
-    stbi_set_flip_vertically_on_load(true);
-    uint8_t *mip_levels[SG_MAX_MIPMAPS] = {0};
-    mip_levels[0] = stbi_load(filename, &img_width, &img_height, &num_channels, desired_channels);
-    if (mip_levels[0]) {
-        sg_image_desc img_desc = {0};
-        img_desc.width = img_width;
-        img_desc.height = img_height;
-        img_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
-        img_desc.min_filter = SG_FILTER_LINEAR;
-        img_desc.mag_filter = SG_FILTER_LINEAR;
-        img_desc.data.subimage[0][0] = {
-            .ptr = mip_levels[0],
-            .size = uint32_t(img_width * img_height * desired_channels),
-        };
-        img_desc.label = filename;
-        // generate mipmaps
-        if (gen_mipmaps) {
-            generate_mipmaps(mip_levels, img_width, img_height, desired_channels, img_desc);
+    return get_or_create_image(filename, legacy_params(gen_mipmaps));
+}
+
+sg_image ResourceManager::get_or_create_image(const uint8_t *data, int32_t len, bool gen_mipmaps) {
+    return get_or_create_image(data, len, legacy_params(gen_mipmaps));
+}
+
+sg_image ResourceManager::get_or_create_image(const char *filename, const ImageParams &params) {
+    // a stat is enough to find out whether the file is already loaded, and a modified file is loaded again
+    const std::string path = normalize_path(filename);
+    struct {
+        uint64_t path_hash;
+        int64_t mtime;
+    } source = {murmur_hash2_64(path.data(), int(path.size()), 12345678), file_mtime(filename)};
+    if (source.mtime < 0) {
+        log_warning("ResourceManager: unable to access image '%s'", filename);
+        return {SG_INVALID_ID};
+    }
+    const uint64_t source_key = murmur_hash2_64(&source, sizeof(source), 12345678);
+    sg_image img = find_image(source_key, params);
+    if (img.id != SG_INVALID_ID) {
+        return img;
+    }
+    // the image of the previous version of a modified file gets the new content in place, keeping its handle. It is
+    // kept as it is when the new version can't be loaded
+    const uint64_t file_key = image_key(source.path_hash, params);
+    const uint64_t key = image_key(source_key, params);
+    uint64_t previous_key = 0;
+    sg_image previous = {SG_INVALID_ID};
+    auto file = _image_files.find(file_key);
+    if (file != _image_files.end() && _images.count(file->second) > 0) {
+        previous_key = file->second;
+        previous = _images[previous_key];
+    }
+    const bool reload = previous.id != SG_INVALID_ID;
+    if (has_extension(filename, ".gtex")) {
+        CompressedImage image;
+        if (!load_texture_file(filename, image)) {
+            log_warning("ResourceManager: unable to load texture file '%s'", filename);
+            return previous;
         }
-        img_desc.max_anisotropy = 4;
-        sg_image img = get_or_create_image(img_desc);
-        for (int i = 0; i < SG_MAX_MIPMAPS; i++) {
-            if (mip_levels[i]) {
-                stbi_image_free(mip_levels[i]);
-            }
+        if (!reload) {
+            img = create_image(source_key, params, image, filename);
+        } else if (replace_image(previous, params, image, filename)) {
+            img = previous;
+        }
+    } else {
+        int img_width, img_height, num_channels;
+        stbi_set_flip_vertically_on_load_thread(params.flip_vertically);
+        uint8_t *pixels = stbi_load(filename, &img_width, &img_height, &num_channels, 4);
+        if (!pixels) {
+            log_warning("ResourceManager: unable to decode image '%s'", filename);
+            return previous;
+        }
+        MipChain chain;
+        if (!reload) {
+            img = create_image(source_key, params, pixels, img_width, img_height, filename);
+        } else if (build_image_chain(pixels, img_width, img_height, params, chain) &&
+                   replace_image(previous, params, chain, filename)) {
+            img = previous;
+        }
+        stbi_image_free(pixels);
+    }
+    if (img.id == SG_INVALID_ID) {
+        if (reload) {
+            destroy_image(previous);
         }
         return img;
     }
-    return {SG_INVALID_ID};
+    if (reload) {
+        log_info("Reloaded image %s into %u", filename, img.id);
+        _images.erase(previous_key);
+        _images[key] = img;
+    }
+    _image_files[file_key] = key;
+    return img;
 }
 
-sg_image ResourceManager::get_or_create_image(const uint8_t *data, int32_t len, bool gen_mipmaps) {
+sg_image ResourceManager::get_or_create_image(const uint8_t *data, int32_t len, const ImageParams &params) {
+    const uint64_t source_key = murmur_hash2_64(data, len, 12345678);
+    sg_image img = find_image(source_key, params);
+    if (img.id != SG_INVALID_ID) {
+        return img;
+    }
+    char label[32];
+    snprintf(label, sizeof(label), "ptr:%p len:%d", data, len);
+    if (is_texture_file(data, len)) {
+        CompressedImage image;
+        if (!load_texture_file(data, len, image)) {
+            log_warning("ResourceManager: invalid texture file (%s)", label);
+            return {SG_INVALID_ID};
+        }
+        return create_image(source_key, params, image, label);
+    }
     int img_width, img_height, num_channels;
-    const int desired_channels = 4;
-    stbi_set_flip_vertically_on_load(true);
-    uint8_t *mip_levels[SG_MAX_MIPMAPS] = {0};
-    mip_levels[0] = stbi_load_from_memory(data, len, &img_width, &img_height, &num_channels, desired_channels);
-    if (mip_levels[0]) {
-        char label[32];
-        sprintf(label, "ptr:%p len:%d", data, len);
-        sg_image_desc img_desc = {0};
-        img_desc.width = img_width;
-        img_desc.height = img_height;
+    stbi_set_flip_vertically_on_load_thread(params.flip_vertically);
+    uint8_t *pixels = stbi_load_from_memory(data, len, &img_width, &img_height, &num_channels, 4);
+    if (!pixels) {
+        log_warning("ResourceManager: unable to decode image (%s)", label);
+        return {SG_INVALID_ID};
+    }
+    img = create_image(source_key, params, pixels, img_width, img_height, label);
+    stbi_image_free(pixels);
+    return img;
+}
+
+sg_image ResourceManager::find_image(uint64_t source_key, const ImageParams &params) {
+    auto it = _images.find(image_key(source_key, params));
+    return it != _images.end() ? it->second : sg_image{SG_INVALID_ID};
+}
+
+sg_image ResourceManager::create_image(uint64_t source_key, const ImageParams &params, const uint8_t *pixels,
+                                       int width, int height, const char *label) {
+    sg_image img = find_image(source_key, params);
+    if (img.id != SG_INVALID_ID) {
+        return img;
+    }
+    MipChain chain;
+    if (!build_image_chain(pixels, width, height, params, chain)) {
+        return {SG_INVALID_ID};
+    }
+    return create_image(source_key, params, chain, label);
+}
+
+sg_image ResourceManager::create_image(uint64_t source_key, const ImageParams &params, const MipChain &chain,
+                                       const char *label) {
+    const uint64_t key = image_key(source_key, params);
+    if (_images.count(key) > 0) {
+        return _images[key];
+    }
+    if (chain.num_levels == 0) {
+        return {SG_INVALID_ID};
+    }
+    sg_image_desc img_desc = {0};
+    img_desc.width = chain.levels[0].width;
+    img_desc.height = chain.levels[0].height;
+    img_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+    set_mip_chain(chain, img_desc);
+    set_sampler(params, chain.num_levels, img_desc);
+    img_desc.label = label;
+    log_info("Creating image %s", label ? label : "");
+    sg_image img = make_image(img_desc);
+    log_info("Created image %u", img.id);
+    _images[key] = img;
+    return img;
+}
+
+sg_image ResourceManager::create_image(uint64_t source_key, const ImageParams &params, const CompressedImage &image,
+                                       const char *label) {
+    const uint64_t key = image_key(source_key, params);
+    if (_images.count(key) > 0) {
+        return _images[key];
+    }
+    if (image.num_levels == 0) {
+        return {SG_INVALID_ID};
+    }
+    const sg_pixel_format format = pixel_format(image.format);
+    if (!sg_query_pixelformat(format).sample) {
+        log_info("ResourceManager: %s textures are not supported, decompressing '%s'",
+                 texture_format_name(image.format), label ? label : "");
+        MipChain chain;
+        decompress_mip_chain(image, chain);
+        return create_image(source_key, params, chain, label);
+    }
+    sg_image_desc img_desc = {0};
+    set_levels(image, img_desc);
+    set_sampler(params, image.num_levels, img_desc);
+    img_desc.label = label;
+    log_info("Creating %s image %s", texture_format_name(image.format), label ? label : "");
+    sg_image img = make_image(img_desc);
+    log_info("Created image %u", img.id);
+    _images[key] = img;
+    return img;
+}
+
+bool ResourceManager::replace_image(sg_image img, const ImageParams &params, const CompressedImage &image,
+                                    const char *label) {
+    if (image.num_levels == 0 || sg_query_image_state(img) == SG_RESOURCESTATE_INVALID) {
+        return false;
+    }
+    sg_image_desc img_desc = {0};
+    MipChain chain;
+    if (sg_query_pixelformat(pixel_format(image.format)).sample) {
+        set_levels(image, img_desc);
+    } else {
+        decompress_mip_chain(image, chain);
+        img_desc.width = chain.levels[0].width;
+        img_desc.height = chain.levels[0].height;
         img_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
-        img_desc.min_filter = SG_FILTER_LINEAR;
-        img_desc.mag_filter = SG_FILTER_LINEAR;
-        img_desc.data.subimage[0][0] = {
-            .ptr = mip_levels[0],
-            .size = uint32_t(img_width * img_height * desired_channels),
-        };
-        img_desc.label = label;
-        // generate mipmaps
-        if (gen_mipmaps) {
-            generate_mipmaps(mip_levels, img_width, img_height, desired_channels, img_desc);
+        set_mip_chain(chain, img_desc);
+    }
+    set_sampler(params, image.num_levels, img_desc);
+    img_desc.label = label;
+    return reinit_image(img, img_desc);
+}
+
+bool ResourceManager::replace_image(sg_image img, const ImageParams &params, const MipChain &chain,
+                                    const char *label) {
+    if (chain.num_levels == 0 || sg_query_image_state(img) == SG_RESOURCESTATE_INVALID) {
+        return false;
+    }
+    sg_image_desc img_desc = {0};
+    img_desc.width = chain.levels[0].width;
+    img_desc.height = chain.levels[0].height;
+    img_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+    set_mip_chain(chain, img_desc);
+    set_sampler(params, chain.num_levels, img_desc);
+    img_desc.label = label;
+    return reinit_image(img, img_desc);
+}
+
+sg_image ResourceManager::create_texture_array(uint64_t source_key, const ImageParams &params,
+                                               const uint8_t *const *layers, uint32_t num_layers, int width,
+                                               int height, const char *label) {
+    const uint64_t key = image_key(source_key, params);
+    if (_images.count(key) > 0) {
+        return _images[key];
+    }
+    if (num_layers == 0 || width <= 0 || height <= 0) {
+        return {SG_INVALID_ID};
+    }
+    // mip chains of the layers are built in parallel, then each level is stored with all its layers one after the
+    // other, which is the layout sokol expects for array images
+    MipChainOptions options;
+    options.srgb = params.srgb;
+    options.max_levels = params.gen_mipmaps && uses_mipmaps(params.min_filter) ? MipChain::MAX_LEVELS : 1;
+    options.parallel = false;
+    std::vector<MipChain> chains(num_layers);
+    parallel_for(0, num_layers, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            build_mip_chain(layers[i], width, height, chains[i], options);
         }
-        img_desc.max_anisotropy = 4;
-        sg_image img = get_or_create_image(img_desc);
-        for (int i = 0; i < SG_MAX_MIPMAPS; i++) {
-            if (mip_levels[i]) {
-                stbi_image_free(mip_levels[i]);
-            }
+    });
+    const uint32_t num_levels = chains[0].num_levels;
+    std::vector<std::vector<uint8_t>> levels(num_levels);
+    sg_image_desc img_desc = {0};
+    img_desc.type = SG_IMAGETYPE_ARRAY;
+    img_desc.width = width;
+    img_desc.height = height;
+    img_desc.num_slices = int(num_layers);
+    img_desc.num_mipmaps = int(num_levels);
+    img_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+    for (uint32_t level = 0; level < num_levels; level++) {
+        const size_t layer_size = chains[0].levels[level].size;
+        levels[level].resize(layer_size * num_layers);
+        for (uint32_t i = 0; i < num_layers; i++) {
+            memcpy(levels[level].data() + layer_size * i, chains[i].level_data(level), layer_size);
         }
+        img_desc.data.subimage[0][level] = {
+            .ptr = levels[level].data(),
+            .size = levels[level].size(),
+        };
+    }
+    set_sampler(params, num_levels, img_desc);
+    img_desc.label = label;
+    log_info("Creating texture array %s (%d layers)", label ? label : "", num_layers);
+    sg_image img = make_image(img_desc);
+    log_info("Created image %u", img.id);
+    _images[key] = img;
+    return img;
+}
+
+sg_image ResourceManager::create_atlas(uint64_t source_key, const ImageParams &params, const TextureAtlas &atlas,
+                                       const char *label) {
+    // GL requires complete mip chains: the whole chain is uploaded, and the levels that would bleed across images
+    // are excluded with max_lod
+    ImageParams atlas_params = params;
+    atlas_params.max_lod = std::min(params.max_lod, float(atlas.max_levels - 1));
+    sg_image img = find_image(source_key, atlas_params);
+    if (img.id != SG_INVALID_ID) {
         return img;
     }
-    return {SG_INVALID_ID};
+    MipChainOptions options;
+    options.srgb = params.srgb;
+    options.max_levels = params.gen_mipmaps ? MipChain::MAX_LEVELS : 1;
+    MipChain chain;
+    if (!build_mip_chain(atlas.pixels.data(), atlas.width, atlas.height, chain, options)) {
+        return {SG_INVALID_ID};
+    }
+    return create_image(source_key, atlas_params, chain, label);
+}
+
+bool ResourceManager::reinit_image(sg_image img, const sg_image_desc &desc) {
+    if (_upload_queue) {
+        _upload_queue->remake_image(img, desc);
+        return true;
+    }
+    // the slot is kept, only the backend resource is destroyed and created again
+    sg_uninit_image(img);
+    sg_init_image(img, &desc);
+    return sg_query_image_state(img) == SG_RESOURCESTATE_VALID;
+}
+
+void ResourceManager::destroy_image(sg_image img) {
+    for (const sg_image &default_image : _default_images) {
+        if (default_image.id == img.id) {
+            return;
+        }
+    }
+    bool found = false;
+    for (auto it = _images.begin(); it != _images.end();) {
+        if (it->second.id == img.id) {
+            it = _images.erase(it);
+            found = true;
+        } else {
+            ++it;
+        }
+    }
+    if (found) {
+        log_debug("Destroying image %u", img.id);
+        sg_destroy_image(img);
+    }
+}
+
+sg_image ResourceManager::make_image(const sg_image_desc &desc) {
+    return _upload_queue ? _upload_queue->make_image(desc) : sg_make_image(desc);
 }
 
 sg_image ResourceManager::default_image(DefaultImage type) {
@@ -241,4 +572,20 @@ void ResourceManager::register_mesh(Mesh *msh) {
     _meshes.insert(msh);
 }
 
+void ResourceManager::destroy_mesh(Mesh *msh) {
+    if (_meshes.erase(msh) > 0) {
+        for (sg_buffer page : msh->pages) {
+            if (page.id != msh->vbuf.id) {
+                sg_destroy_buffer(page);
+            }
+        }
+        for (sg_buffer buf : msh->instance_buffers) {
+            sg_destroy_buffer(buf);
+        }
+        sg_destroy_buffer(msh->vbuf);
+        sg_destroy_buffer(msh->ibuf);
+        delete msh;
+    }
+}
+
 } // namespace glengine
@@ -11,6 +11,23 @@ namespace glengine {
 
 class Material;
 class Mesh;
+struct MipChain;
+struct CompressedImage;
+struct TextureAtlas;
+class UploadQueue;
+
+/// color space and sampler settings of an image created from rgba8 pixels
+struct ImageParams {
+    bool gen_mipmaps = true;
+    bool srgb = true; ///< color data, mipmaps are filtered in linear space. Use false for normal maps and other data
+    sg_filter min_filter = SG_FILTER_LINEAR_MIPMAP_LINEAR;
+    sg_filter mag_filter = SG_FILTER_LINEAR;
+    sg_wrap wrap_u = SG_WRAP_REPEAT;
+    sg_wrap wrap_v = SG_WRAP_REPEAT;
+    uint32_t max_anisotropy = 4;
+    float max_lod = 1000.0f;      ///< lowest resolution mip level that can be sampled
+    bool flip_vertically = false; ///< only used when decoding encoded (png, jpg, ...) images
+};
 
 /// class used to manage resources (materials, shaders, pipelines etc.)
 class ResourceManager {
@@ -31,6 +48,38 @@ class ResourceManager {
     sg_image get_or_create_image(const sg_image_desc &desc);
     sg_image get_or_create_image(const char *filename, bool gen_mipmaps = false);
     sg_image get_or_create_image(const uint8_t *data, int32_t len, bool gen_mipmaps = false);
+    /// encoded (png, jpg, ...) images are decoded only on a cache miss: files are looked up by path and modification
+    /// time, in-memory data by the hash of its content. A modified file is loaded again into the image of its previous
+    /// version, keeping its handle. Texture files (.gtex) are uploaded with their own mip chain and format, block
+    /// compressed data is decompressed on the CPU when the backend can't sample it
+    sg_image get_or_create_image(const char *filename, const ImageParams &params);
+    sg_image get_or_create_image(const uint8_t *data, int32_t len, const ImageParams &params);
+    /// images identified by a user-defined source key (i.e. the hash of a resolved uri, or of the encoded content),
+    /// so that the same source is decoded and uploaded only once. find_image returns an invalid handle on a miss
+    sg_image find_image(uint64_t source_key, const ImageParams &params);
+    sg_image create_image(uint64_t source_key, const ImageParams &params, const uint8_t *pixels, int width,
+                          int height, const char *label = nullptr);
+    /// same as above, with a mip chain already built (i.e. on a worker thread)
+    sg_image create_image(uint64_t source_key, const ImageParams &params, const MipChain &chain,
+                          const char *label = nullptr);
+    sg_image create_image(uint64_t source_key, const ImageParams &params, const CompressedImage &image,
+                          const char *label = nullptr);
+    /// replace the content of an image created by the resource manager, keeping its handle so that the materials
+    /// using it don't need to be updated. The size and number of levels can change (i.e. streamed mip levels).
+    /// With an upload queue, the image is replaced when the queue gets to it
+    bool replace_image(sg_image img, const ImageParams &params, const CompressedImage &image,
+                       const char *label = nullptr);
+    bool replace_image(sg_image img, const ImageParams &params, const MipChain &chain, const char *label = nullptr);
+    /// 2D texture array with one layer per rgba8 image (all of the same size), so that materials using different
+    /// layers share the same binding. Each layer gets its own mip chain
+    sg_image create_texture_array(uint64_t source_key, const ImageParams &params, const uint8_t *const *layers,
+                                  uint32_t num_layers, int width, int height, const char *label = nullptr);
+    /// image of a texture atlas (see build_texture_atlas), sampling is limited to the mip levels that don't bleed
+    sg_image create_atlas(uint64_t source_key, const ImageParams &params, const TextureAtlas &atlas,
+                          const char *label = nullptr);
+    /// destroy an image created by the resource manager and drop its cache entries, i.e. the image of a file that was
+    /// modified or removed. The default images are kept
+    void destroy_image(sg_image img);
     /// default images
     sg_image default_image(DefaultImage type);
     /// shader creation/retrieval
@@ -40,13 +89,24 @@ class ResourceManager {
 
     void register_material(Material *mtl);
     void register_mesh(Mesh *msh);
+    /// destroy a registered mesh and its buffers, for geometry that doesn't live as long as the engine (i.e. streamed)
+    void destroy_mesh(Mesh *msh);
 
     std::array<sg_image, DefaultImageNum> _default_images;
     std::unordered_map<uint64_t, sg_image> _images;
+    /// cache key of the image of the last version of each file, by path and params
+    std::unordered_map<uint64_t, uint64_t> _image_files;
     std::unordered_map<uint64_t, sg_shader> _shaders;
     std::unordered_map<uint64_t, sg_pipeline> _pipelines;
     std::set<Material *> _materials;
     std::set<Mesh *> _meshes;
+    /// images with content are created through the queue when set (see GLEngine::Config::deferred_uploads)
+    UploadQueue *_upload_queue = nullptr;
+
+  private:
+    sg_image make_image(const sg_image_desc &desc);
+    /// new content for an image, through the upload queue when there is one
+    bool reinit_image(sg_image img, const sg_image_desc &desc);
 };
 
 } // namespace glengine
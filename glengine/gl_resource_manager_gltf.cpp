@@ -1,4 +1,7 @@
 #include "gl_engine.h"
+#include "gl_gltf_loader.h"
+#include "gl_gltf_mesh.h"
+#include "gl_gltf_reader.h"
 #include "gl_resource_manager.h"
 #include "gl_prefabs.h"
 #include "gl_logger.h"
@@ -7,6 +10,10 @@
 #include "gl_material_diffuse.h"
 #include "gl_material_pbr.h"
 #include "gl_material_pbr_ibl.h"
+#include "gl_mipmap.h"
+#include "gl_texture_atlas.h"
+#include "gl_thread_pool.h"
+#include "gl_utils.h"
 
 #include "math/vmath.h"
 #include "stb/stb_image.h"
@@ -14,6 +21,7 @@
 
 #include "sokol_gfx.h"
 
+#include <algorithm>
 #include <set>
 
 using namespace glengine;
@@ -26,162 +34,201 @@ std::string get_file_extension(const std::string &filename) {
     return "";
 }
 
-math::Matrix4f extract_transform(const tinygltf::Node &node) {
-    math::Matrix4f tf = math::matrix4_identity<float>();
-    const auto &m = node.matrix;
-    const auto &t = node.translation;
-    const auto &r = node.rotation;
-    const auto &s = node.scale;
-    // the node can _either_ have a tf matrix or a set of T/R/S data
-    if (m.size() > 0) {
-        for (int i = 0; i < 16; i++) {
-            tf.data[i] = m[i];
-        }
-    } else if (t.size() >= 3 || r.size() >= 4 || s.size() >= 3) {
-        math::Vector3f translation = {0, 0, 0};
-        math::Vector3f scale = {1, 1, 1};
-        math::Quatf rotation = {1, 0, 0, 0};
-        if (t.size() >= 3) {
-            translation = {float(t[0]), float(t[1]), float(t[2])};
-        }
-        if (s.size() >= 3) {
-            scale = {float(s[0]), float(s[1]), float(s[2])};
-        }
-        if (r.size() >= 4) {
-            rotation = {float(r[3]), float(r[0]), float(r[1]), float(r[2])};
-            log_info("model rotation %f %f %f %f", float(r[0]), float(r[1]), float(r[2]), float(r[3]));
-        }
-        tf = math::create_translation(translation) * math::create_transformation({0.0f, 0.0f, 0.0f}, rotation) *
-             math::create_scaling(scale);
+std::string get_directory(const std::string &filename) {
+    size_t pos = filename.find_last_of("/\\");
+    return pos != std::string::npos ? filename.substr(0, pos + 1) : "";
+}
+
+// image loader that keeps the encoded data instead of decoding it: images are decoded in GltfLoader::load_textures,
+// on the worker threads, and only when they are not in the image cache yet. Images stored in a buffer view are
+// read from the buffer directly
+bool keep_encoded_image(tinygltf::Image *image, const int, std::string *, std::string *, int, int,
+                        const unsigned char *bytes, int size, void *) {
+    if (image->bufferView < 0) {
+        image->image.assign(bytes, bytes + size);
+    }
+    image->as_is = true;
+    return true;
+}
+
+sg_filter gltf_filter(int filter, sg_filter default_filter) {
+    switch (filter) {
+    case TINYGLTF_TEXTURE_FILTER_NEAREST:
+        return SG_FILTER_NEAREST;
+    case TINYGLTF_TEXTURE_FILTER_LINEAR:
+        return SG_FILTER_LINEAR;
+    case TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_NEAREST:
+        return SG_FILTER_NEAREST_MIPMAP_NEAREST;
+    case TINYGLTF_TEXTURE_FILTER_LINEAR_MIPMAP_NEAREST:
+        return SG_FILTER_LINEAR_MIPMAP_NEAREST;
+    case TINYGLTF_TEXTURE_FILTER_NEAREST_MIPMAP_LINEAR:
+        return SG_FILTER_NEAREST_MIPMAP_LINEAR;
+    case TINYGLTF_TEXTURE_FILTER_LINEAR_MIPMAP_LINEAR:
+        return SG_FILTER_LINEAR_MIPMAP_LINEAR;
+    default:
+        return default_filter;
+    }
+}
+
+sg_wrap gltf_wrap(int wrap) {
+    switch (wrap) {
+    case TINYGLTF_TEXTURE_WRAP_CLAMP_TO_EDGE:
+        return SG_WRAP_CLAMP_TO_EDGE;
+    case TINYGLTF_TEXTURE_WRAP_MIRRORED_REPEAT:
+        return SG_WRAP_MIRRORED_REPEAT;
+    default:
+        return SG_WRAP_REPEAT;
     }
-    return tf;
+}
+
+bool is_unlit(const tinygltf::Material &mtl) { return mtl.extensions.count("KHR_materials_unlit") > 0; }
+
+bool same_params(const ImageParams &a, const ImageParams &b) {
+    return a.gen_mipmaps == b.gen_mipmaps && a.srgb == b.srgb && a.min_filter == b.min_filter &&
+           a.mag_filter == b.mag_filter && a.wrap_u == b.wrap_u && a.wrap_v == b.wrap_v &&
+           a.max_anisotropy == b.max_anisotropy && a.max_lod == b.max_lod && a.flip_vertically == b.flip_vertically;
 }
 
 class GltfLoader {
   public:
-    GltfLoader(const std::string &filename, GLEngine &eng)
+    GltfLoader(const std::string &filename, GLEngine &eng, const GltfImportOptions &options)
     : _filename(filename)
     , _eng(eng)
-    , _rm(eng.resource_manager()) {}
+    , _rm(eng.resource_manager())
+    , _options(options) {}
+
+    /// material of a primitive, created once per gltf material
+    glengine::Material *material(const tinygltf::Model &model, const tinygltf::Primitive &primitive) {
+        auto it = _materials.find(primitive.material);
+        if (it != _materials.end()) {
+            return it->second;
+        }
+        glengine::Material *material = nullptr;
+        if (primitive.material >= 0 && primitive.material < int(model.materials.size())) {
+            material = create_material(model.materials[primitive.material]);
+        } else {
+            material = _eng.create_material<glengine::MaterialDiffuse>(SG_PRIMITIVETYPE_TRIANGLES, SG_INDEXTYPE_UINT32);
+        }
+        _materials[primitive.material] = material;
+        return material;
+    }
 
-    bool load_mesh(const tinygltf::Model &model, const tinygltf::Mesh &mesh, const math::Matrix4f &tf) {
+    /// one renderable per primitive of the mesh, with the transform tf baked into the vertices. Primitives with
+    /// quantized positions (KHR_mesh_quantization) stay quantized when their material supports it, tf is then part of
+    /// their dequantization transform. Instanced meshes also need a material pipeline with instancing for the layout.
+    /// The other ones get their levels of detail when enabled by the options
+    bool load_mesh(const tinygltf::Model &model, const tinygltf::Mesh &mesh, const math::Matrix4f &tf,
+                   std::vector<Renderable> &renderables, bool instanced = false) {
         for (size_t pi = 0; pi < mesh.primitives.size(); ++pi) {
-            tinygltf::Primitive primitive = mesh.primitives[pi];
-            // for (const auto & attr : primitive.attributes) {
-            //     log_warning("prim attr: %s %d", attr.first.c_str(), attr.second);
-            // }
-            if (primitive.mode != TINYGLTF_MODE_TRIANGLES || primitive.attributes.count("POSITION") == 0) {
-                printf("SKIP (only triangles are supported for now)!\n");
-                continue;
-            }
-            // position
-            const tinygltf::Accessor &pos_accessor = model.accessors[primitive.attributes["POSITION"]];
-            if (pos_accessor.type != TINYGLTF_TYPE_VEC3 ||
-                pos_accessor.componentType != TINYGLTF_COMPONENT_TYPE_FLOAT) {
-                printf("SKIP: position vertex/index data format not supported yet\n");
-                continue;
-            }
-            const tinygltf::BufferView &pos_bufferView = model.bufferViews[pos_accessor.bufferView];
-            const tinygltf::Buffer &pos_buffer = model.buffers[pos_bufferView.buffer];
-            math::Vector3f *positions =
-                (math::Vector3f *)(pos_buffer.data.data() + pos_bufferView.byteOffset + pos_accessor.byteOffset);
-            // normal
-            math::Vector3f *normals = nullptr;
-            if (primitive.attributes.count("NORMAL") != 0) {
-                const tinygltf::Accessor &norm_accessor = model.accessors[primitive.attributes["NORMAL"]];
-                if (norm_accessor.type == TINYGLTF_TYPE_VEC3 ||
-                    norm_accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) {
-                    const tinygltf::BufferView &norm_bufferView = model.bufferViews[norm_accessor.bufferView];
-                    const tinygltf::Buffer &norm_buffer = model.buffers[norm_bufferView.buffer];
-                    normals = (math::Vector3f *)(norm_buffer.data.data() + norm_bufferView.byteOffset +
-                                                 norm_accessor.byteOffset);
+            const tinygltf::Primitive &primitive = mesh.primitives[pi];
+            glengine::Material *mtl = material(model, primitive);
+            glengine::Mesh *msh = nullptr;
+            if (gltf_primitive_is_quantized(model, primitive) &&
+                mtl->pipeline(VertexLayout::Quantized, instanced).id != SG_INVALID_ID) {
+                QuantizedMeshData qmd;
+                if (gltf_primitive_quantized_data(model, primitive, tf, qmd)) {
+                    msh = _eng.create_mesh();
+                    msh->init(qmd.vertices, qmd.indices, qmd.dequantization);
+                    _num_quantized++;
                 }
             }
-            // tangent
-            math::Vector4f *tangents = nullptr;
-            if (primitive.attributes.count("TANGENT") != 0) {
-                const tinygltf::Accessor &tang_accessor = model.accessors[primitive.attributes["TANGENT"]];
-                if (tang_accessor.type == TINYGLTF_TYPE_VEC3 ||
-                    tang_accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) {
-                    const tinygltf::BufferView &tang_bufferView = model.bufferViews[tang_accessor.bufferView];
-                    const tinygltf::Buffer &tang_buffer = model.buffers[tang_bufferView.buffer];
-                    tangents = (math::Vector4f *)(tang_buffer.data.data() + tang_bufferView.byteOffset +
-                                                  tang_accessor.byteOffset);
+            if (!msh) {
+                glengine::MeshData md;
+                if (!gltf_primitive_mesh_data(model, primitive, tf, md)) {
+                    continue;
                 }
-            }
-            // texcoord
-            math::Vector2f *texcoords = nullptr;
-            if (primitive.attributes.count("TEXCOORD_0") != 0) {
-                const tinygltf::Accessor &tc0_accessor = model.accessors[primitive.attributes["TEXCOORD_0"]];
-                if (tc0_accessor.type == TINYGLTF_TYPE_VEC2 ||
-                    tc0_accessor.componentType == TINYGLTF_COMPONENT_TYPE_FLOAT) {
-                    const tinygltf::BufferView &tc0_bufferView = model.bufferViews[tc0_accessor.bufferView];
-                    const tinygltf::Buffer &tc0_buffer = model.buffers[tc0_bufferView.buffer];
-                    texcoords = (math::Vector2f *)(tc0_buffer.data.data() + tc0_bufferView.byteOffset +
-                                                   tc0_accessor.byteOffset);
+                if (_options.generate_lods) {
+                    _num_lods += generate_lods(md, _options.lods);
                 }
-            }
-            // indices
-            uint32_t *indices_int = nullptr;
-            uint16_t *indices_short = nullptr;
-            const tinygltf::Accessor &indexAccessor = model.accessors[primitive.indices];
-            if (indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT ||
-                indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_SHORT) {
-                const tinygltf::BufferView &indexbufferView = model.bufferViews[indexAccessor.bufferView];
-                const tinygltf::Buffer &indexbuffer = model.buffers[indexbufferView.buffer];
-                indices_int =
-                    (uint32_t *)(indexbuffer.data.data() + indexbufferView.byteOffset + indexAccessor.byteOffset);
-                indices_short =
-                    (uint16_t *)(indexbuffer.data.data() + indexbufferView.byteOffset + indexAccessor.byteOffset);
-            } else {
-                printf("SKIP indices: index data format not supported yet\n");
-            }
-            // create vertices
-            if (pos_accessor.count < 3) {
-                printf("empty mesh\n");
-                continue;
-            }
-            glengine::MeshData md;
-            auto rot = tf;
-            math::set_translation(rot, {0, 0, 0});
-            for (uint32_t vi = 0; vi < pos_accessor.count; vi++) {
-                auto pos = tf * positions[vi];
-                auto norm = normals ? rot * normals[vi] : math::Vector3f{0.0f, 0.0f, 0.0f};
-                auto tc0 = texcoords ? math::Vector2f{texcoords[vi].s, texcoords[vi].t} : math::Vector2f{0.0f, 0.0f};
-                auto tang = tangents ? rot * tangents[vi] : math::Vector4f{0.0f, 0.0f, 0.0f, 1.0f};
-                // printf("(%5.3f,%5.3f,%5.3f) ", tang.x, tang.y, tang.z);
-                md.vertices.push_back({pos, {150, 150, 150, 255}, norm, tc0, {tang.x, tang.y, tang.z}});
-            }
-            if (indexAccessor.componentType == TINYGLTF_COMPONENT_TYPE_UNSIGNED_INT) {
-                for (uint32_t ii = 0; ii < indexAccessor.count; ii++) {
-                    md.indices.push_back(indices_int[ii]);
+                if (_options.build_meshlets) {
+                    _num_meshlets += build_meshlets(md, _options.meshlets);
                 }
-            } else {
-                for (uint32_t ii = 0; ii < indexAccessor.count; ii++) {
-                    md.indices.push_back(indices_short[ii]);
+                msh = _eng.create_mesh();
+                msh->init(md.vertices, md.indices);
+                if (!md.lods.empty()) {
+                    msh->set_lods(md.lods);
+                }
+                if (!md.meshlets.empty()) {
+                    msh->set_meshlets(md.meshlets);
                 }
             }
-            glengine::Mesh *mesh = _eng.create_mesh();
-            mesh->init(md.vertices, md.indices);
-            // material
-            glengine::Material *material = nullptr;
-            if (primitive.material >= 0) {
-                const tinygltf::Material &mtl = model.materials[primitive.material];
-                material = create_material(mtl);
-            } else {
-                material = _eng.create_material<glengine::MaterialDiffuse>(
-                    SG_PRIMITIVETYPE_TRIANGLES, md.indices.size() > 0 ? SG_INDEXTYPE_UINT32 : SG_INDEXTYPE_NONE);
+            _buffer_bytes += msh->vbuf_size + msh->ibuf_size;
+            renderables.push_back({msh, mtl});
+        }
+        return true;
+    }
+
+    /// true if the materials of all the primitives of the mesh can draw instances
+    bool supports_instancing(const tinygltf::Model &model, const tinygltf::Mesh &mesh) {
+        for (const auto &primitive : mesh.primitives) {
+            if (material(model, primitive)->pipeline(VertexLayout::Default, true).id == SG_INVALID_ID) {
+                return false;
             }
-            Renderable go{mesh, material};
-            _renderables.push_back(go);
         }
         return true;
     }
 
+    /// vertex buffer with the per-instance transforms pre * instance * post (see Renderable::set_instances)
+    sg_buffer instance_buffer(const std::vector<math::Matrix4f> &instances, const math::Matrix4f &pre,
+                              const math::Matrix4f &post) {
+        std::vector<math::Vector4f> rows;
+        rows.reserve(instances.size() * 3);
+        for (const auto &instance : instances) {
+            const math::Matrix4f m = pre * instance * post;
+            for (int r = 0; r < 3; r++) {
+                rows.push_back({m(r, 0), m(r, 1), m(r, 2), m(r, 3)});
+            }
+        }
+        const size_t size = rows.size() * sizeof(math::Vector4f);
+        _buffer_bytes += size;
+        const sg_buffer_desc desc = {.size = size,
+                                     .type = SG_BUFFERTYPE_VERTEXBUFFER,
+                                     .data = {rows.data(), size},
+                                     .label = "gltf-instances"};
+        return _eng._config.deferred_uploads ? _eng.upload_queue().make_buffer(desc) : sg_make_buffer(desc);
+    }
+
+    /// draw the renderables (in mesh space) once per instance, with the transform pre applied after the instance
+    /// transforms. Meshes with the default layout share the same buffer, quantized ones get their dequantization
+    /// folded into theirs. The buffers belong to the mesh they are created for (the first one when shared), and are
+    /// destroyed with it
+    void set_instances(Renderable *begin, Renderable *end, const math::Matrix4f &pre,
+                       const std::vector<math::Matrix4f> &instances) {
+        sg_buffer shared = {SG_INVALID_ID};
+        for (Renderable *r = begin; r != end; r++) {
+            sg_buffer buffer = shared;
+            if (r->mesh->layout == VertexLayout::Quantized) {
+                buffer = instance_buffer(instances, pre, r->mesh->dequantization);
+                r->mesh->instance_buffers.push_back(buffer);
+            } else if (buffer.id == SG_INVALID_ID) {
+                buffer = shared = instance_buffer(instances, pre, math::matrix4_identity<float>());
+                r->mesh->instance_buffers.push_back(buffer);
+            }
+            r->set_instances(buffer, uint32_t(instances.size()));
+        }
+        _num_instanced += int(end - begin);
+    }
+
+    /// flat import: node transforms are baked into the vertices, every node gets its own buffers. Nodes with
+    /// instances (EXT_mesh_gpu_instancing) are drawn with instancing when their materials support it, and get one
+    /// copy of the mesh per instance otherwise
     void load_node(const tinygltf::Model &model, const tinygltf::Node &node, const math::Matrix4f &parent_tf) {
-        math::Matrix4f tf = extract_transform(node);
+        math::Matrix4f tf = gltf_node_transform(node);
         if ((node.mesh >= 0) && (node.mesh < int(model.meshes.size()))) {
-            load_mesh(model, model.meshes[node.mesh], parent_tf * tf);
+            const tinygltf::Mesh &mesh = model.meshes[node.mesh];
+            std::vector<math::Matrix4f> instances;
+            if (!gltf_node_instances(model, node, instances)) {
+                load_mesh(model, mesh, parent_tf * tf, _renderables);
+            } else if (supports_instancing(model, mesh)) {
+                const size_t first = _renderables.size();
+                load_mesh(model, mesh, math::matrix4_identity<float>(), _renderables, true);
+                set_instances(_renderables.data() + first, _renderables.data() + _renderables.size(),
+                              parent_tf * tf, instances);
+            } else {
+                for (const auto &instance : instances) {
+                    load_mesh(model, mesh, parent_tf * tf * instance, _renderables);
+                }
+            }
         }
 
         for (size_t i = 0; i < node.children.size(); i++) {
@@ -190,25 +237,300 @@ class GltfLoader {
         }
     }
 
+    /// renderables of a gltf mesh in its own space, created the first time a node uses it and shared afterwards
+    const std::vector<Renderable> &shared_mesh(const tinygltf::Model &model, int index) {
+        auto it = _shared_meshes.find(index);
+        if (it == _shared_meshes.end()) {
+            it = _shared_meshes.insert({index, {}}).first;
+            load_mesh(model, model.meshes[index], math::matrix4_identity<float>(), it->second);
+        }
+        return it->second;
+    }
+
+    /// hierarchical import: one object per node, with the node transform, sharing the meshes across nodes
+    void load_node(const tinygltf::Model &model, const tinygltf::Node &node, Object *parent) {
+        Object *obj = _eng.create_object(parent);
+        obj->set_transform(gltf_node_transform(node));
+        _num_objects++;
+        if ((node.mesh >= 0) && (node.mesh < int(model.meshes.size()))) {
+            const auto &renderables = shared_mesh(model, node.mesh);
+            std::vector<math::Matrix4f> instances;
+            if (!gltf_node_instances(model, node, instances)) {
+                obj->add_renderable(renderables.data(), uint32_t(renderables.size()));
+            } else if (std::all_of(renderables.begin(), renderables.end(), [](const Renderable &r) {
+                           return r.material->pipeline(r.mesh->layout, true).id != SG_INVALID_ID;
+                       })) {
+                // the buffers of the mesh are still shared, only the instance transforms are per node
+                std::vector<Renderable> instanced(renderables);
+                set_instances(instanced.data(), instanced.data() + instanced.size(), math::matrix4_identity<float>(),
+                              instances);
+                obj->add_renderable(instanced.data(), uint32_t(instanced.size()));
+            } else { // one child object per instance
+                for (const auto &instance : instances) {
+                    Object *child = _eng.create_object(obj);
+                    child->set_transform(instance);
+                    child->add_renderable(renderables.data(), uint32_t(renderables.size()));
+                    _num_objects++;
+                }
+            }
+        }
+        for (size_t i = 0; i < node.children.size(); i++) {
+            assert((node.children[i] >= 0) && (node.children[i] < int(model.nodes.size())));
+            load_node(model, model.nodes[node.children[i]], obj);
+        }
+    }
+
+    // base color and emissive textures hold sRGB colors, the others (normal, metallic/roughness, occlusion) hold
+    // linear data and must not be filtered as colors
+    std::set<int> srgb_textures(const tinygltf::Model &model) {
+        std::set<int> textures;
+        for (const auto &mtl : model.materials) {
+            textures.insert(mtl.pbrMetallicRoughness.baseColorTexture.index);
+            textures.insert(mtl.emissiveTexture.index);
+        }
+        return textures;
+    }
+
+    // encoded data of an image (see keep_encoded_image)
+    static std::pair<const uint8_t *, int> encoded_image(const tinygltf::Model &model, const tinygltf::Image &img) {
+        if (img.bufferView >= 0 && img.bufferView < int(model.bufferViews.size())) {
+            const tinygltf::BufferView &view = model.bufferViews[img.bufferView];
+            const tinygltf::Buffer &buffer = model.buffers[view.buffer];
+            return {buffer.data.data() + view.byteOffset, int(view.byteLength)};
+        }
+        return {img.image.data(), int(img.image.size())};
+    }
+
+    // key identifying where the image comes from: the resolved path and modification time of external files, or the
+    // hash of the encoded data for embedded images, so that loading the same image twice (even from different
+    // models) hits the cache before decoding
+    uint64_t image_source_key(const tinygltf::Model &model, const tinygltf::Image &img) {
+        if (img.bufferView >= 0 || img.uri.compare(0, 5, "data:") == 0) {
+            auto encoded = encoded_image(model, img);
+            return murmur_hash2_64(encoded.first, encoded.second, 12345678);
+        }
+        const std::string path = normalize_path(get_directory(_filename) + img.uri);
+        struct {
+            uint64_t path_hash;
+            int64_t mtime;
+        } source = {murmur_hash2_64(path.data(), int(path.size()), 12345678), file_mtime(path.c_str())};
+        return murmur_hash2_64(&source, sizeof(source), 12345678);
+    }
+
+    ImageParams texture_params(const tinygltf::Model &model, const tinygltf::Texture &tex, bool srgb) {
+        ImageParams params;
+        params.srgb = srgb;
+        if (tex.sampler >= 0 && tex.sampler < int(model.samplers.size())) {
+            const tinygltf::Sampler &sampler = model.samplers[tex.sampler];
+            params.min_filter = gltf_filter(sampler.minFilter, SG_FILTER_LINEAR_MIPMAP_LINEAR);
+            params.mag_filter = gltf_filter(sampler.magFilter, SG_FILTER_LINEAR);
+            params.wrap_u = gltf_wrap(sampler.wrapS);
+            params.wrap_v = gltf_wrap(sampler.wrapT);
+        }
+        return params;
+    }
+
+    // base color textures of the unlit materials that no other material samples, they share images with
+    // GltfImportOptions::batch_textures (see batch_textures)
+    std::set<int> batched_textures(const tinygltf::Model &model) {
+        std::set<int> textures, others;
+        if (!_options.batch_textures) {
+            return textures;
+        }
+        for (const auto &mtl : model.materials) {
+            const auto &pbr = mtl.pbrMetallicRoughness;
+            if (is_unlit(mtl)) {
+                textures.insert(pbr.baseColorTexture.index);
+            } else {
+                others.insert({pbr.baseColorTexture.index, pbr.metallicRoughnessTexture.index, mtl.normalTexture.index,
+                               mtl.emissiveTexture.index, mtl.occlusionTexture.index});
+            }
+        }
+        for (int texture : others) {
+            textures.erase(texture);
+        }
+        textures.erase(-1);
+        return textures;
+    }
+
+    struct PendingImage {
+        uint64_t source_key;
+        ImageParams params;
+        const tinygltf::Image *img;
+        std::vector<int> textures;
+        bool batch = false; ///< only level 0 is decoded, see batch_textures
+        MipChain chain;
+        bool ok = false;
+    };
+
+    /// the batched images with the same sampling share one image: a texture array when they all have the same
+    /// size, else an atlas when they repeat (the materials wrap the uvs within their rect) and fit in
+    /// GltfImportOptions::atlas_max_size. The others get their own image. Returns the number of images batched
+    int batch_textures(const std::vector<PendingImage *> &images) {
+        int num_batched = 0;
+        std::vector<bool> grouped(images.size(), false);
+        for (size_t i = 0; i < images.size(); i++) {
+            if (grouped[i]) {
+                continue;
+            }
+            std::vector<PendingImage *> group;
+            for (size_t j = i; j < images.size(); j++) {
+                if (!grouped[j] && same_params(images[j]->params, images[i]->params)) {
+                    group.push_back(images[j]);
+                    grouped[j] = true;
+                }
+            }
+            // the shared image is identified by the sources of its images, in order
+            std::vector<uint64_t> keys;
+            for (const PendingImage *p : group) {
+                keys.push_back(p->source_key);
+            }
+            const uint64_t key = murmur_hash2_64(keys.data(), int(keys.size() * sizeof(uint64_t)), 12345678);
+            const ImageParams &params = group[0]->params;
+            const MipChain::Level &first = group[0]->chain.levels[0];
+            const bool same_size = std::all_of(group.begin(), group.end(), [&first](const PendingImage *p) {
+                return p->chain.levels[0].width == first.width && p->chain.levels[0].height == first.height;
+            });
+            if (group.size() > 1 && same_size) {
+                std::vector<const uint8_t *> layers;
+                for (const PendingImage *p : group) {
+                    layers.push_back(p->chain.level_data(0));
+                }
+                sg_image array = _rm.create_texture_array(key, params, layers.data(), uint32_t(layers.size()),
+                                                          int(first.width), int(first.height), "gltf texture array");
+                if (array.id != SG_INVALID_ID) {
+                    for (size_t layer = 0; layer < group.size(); layer++) {
+                        for (int tex : group[layer]->textures) {
+                            _tx_batch[tex] = {array, int(layer), {0.0f, 0.0f, 1.0f, 1.0f}};
+                        }
+                    }
+                    num_batched += int(group.size());
+                    continue;
+                }
+            }
+            if (group.size() > 1 && params.wrap_u == SG_WRAP_REPEAT && params.wrap_v == SG_WRAP_REPEAT) {
+                std::vector<AtlasImage> atlas_images;
+                for (const PendingImage *p : group) {
+                    atlas_images.push_back({p->chain.level_data(0), p->chain.levels[0].width,
+                                            p->chain.levels[0].height});
+                }
+                TextureAtlas atlas;
+                sg_image image = {SG_INVALID_ID};
+                if (build_texture_atlas(atlas_images, _options.atlas_max_size, 4, atlas)) {
+                    image = _rm.create_atlas(key, params, atlas, "gltf texture atlas");
+                }
+                if (image.id != SG_INVALID_ID) {
+                    for (size_t k = 0; k < group.size(); k++) {
+                        for (int tex : group[k]->textures) {
+                            _tx_batch[tex] = {image, -1, atlas.uv_rects[k]};
+                        }
+                    }
+                    num_batched += int(group.size());
+                    continue;
+                }
+            }
+            for (const PendingImage *p : group) {
+                sg_image image = _rm.create_image(p->source_key, p->params, p->chain.level_data(0),
+                                                  int(p->chain.levels[0].width), int(p->chain.levels[0].height),
+                                                  p->img->uri.c_str());
+                for (int tex : p->textures) {
+                    _tx_map[tex] = image;
+                }
+            }
+        }
+        return num_batched;
+    }
+
     bool load_textures(const tinygltf::Model &model) {
-        for (uint32_t i = 0; i < model.images.size(); i++) {
-            const tinygltf::Image &img = model.images[i];
-            log_debug("gltf loader: texture with index %d, name '%s', and uri '%s'", i, img.name.c_str(),
-                      img.uri.c_str());
-            // log_debug("image %d %d %d",img.component, img.bits, img.pixel_type);
-            sg_image_desc img_desc = {0};
-            img_desc.width = img.width;
-            img_desc.height = img.height;
-            img_desc.pixel_format = SG_PIXELFORMAT_RGBA8;
-            img_desc.min_filter = SG_FILTER_LINEAR;
-            img_desc.mag_filter = SG_FILTER_LINEAR;
-            img_desc.data.subimage[0][0] = {
-                .ptr = img.image.data(),
-                .size = img.image.size(),
-            };
-            img_desc.label = img.uri.c_str();
-            _tx_map[i] = sg_make_image(img_desc);
+        const std::set<int> srgb = srgb_textures(model);
+        const std::set<int> batched = batched_textures(model);
+        std::vector<PendingImage> pending;
+        [[maybe_unused]] int num_shared = 0;
+        for (int i = 0; i < int(model.textures.size()); i++) {
+            const tinygltf::Texture &tex = model.textures[i];
+            if (tex.source < 0 || tex.source >= int(model.images.size())) {
+                log_warning("gltf loader: texture %d has no image source", i);
+                continue;
+            }
+            const tinygltf::Image &img = model.images[tex.source];
+            log_debug("gltf loader: texture with index %d, image %d, name '%s', and uri '%s'", i, tex.source,
+                      img.name.c_str(), img.uri.c_str());
+            const ImageParams params = texture_params(model, tex, srgb.count(i) > 0);
+            // batched images are decoded even when cached, their placement in the shared image is needed
+            const bool batch = batched.count(i) > 0;
+            // a texture file (.gtex) next to an external image is used instead of it: its mip chain is already
+            // built, and it can be block compressed
+            if (!batch && img.bufferView < 0 && !img.uri.empty() && img.uri.compare(0, 5, "data:") != 0) {
+                const std::string path = normalize_path(get_directory(_filename) + img.uri);
+                const std::string texture_file = path.substr(0, path.find_last_of('.')) + ".gtex";
+                if (file_mtime(texture_file.c_str()) >= 0) {
+                    sg_image image = _rm.get_or_create_image(texture_file.c_str(), params);
+                    if (image.id != SG_INVALID_ID) {
+                        _tx_map[i] = image;
+                        continue;
+                    }
+                }
+            }
+            const uint64_t source_key = image_source_key(model, img);
+            sg_image cached = batch ? sg_image{SG_INVALID_ID} : _rm.find_image(source_key, params);
+            if (cached.id != SG_INVALID_ID) {
+                _tx_map[i] = cached;
+                num_shared++;
+                continue;
+            }
+            if (encoded_image(model, img).second == 0) {
+                log_warning("gltf loader: image '%s' has no data", img.uri.c_str());
+                continue;
+            }
+            // several textures can share the same image and sampler
+            auto same = std::find_if(pending.begin(), pending.end(), [&](const PendingImage &p) {
+                return p.source_key == source_key && same_params(p.params, params) && p.batch == batch;
+            });
+            if (same != pending.end()) {
+                same->textures.push_back(i);
+            } else {
+                pending.push_back({source_key, params, &img, {i}, batch});
+            }
+        }
+        // decoding and mip chains are done on the worker threads, one image per task; only the uploads stay on
+        // this thread. gltf texture coordinates have their origin at the top-left corner: rows are not flipped
+        parallel_for(0, uint32_t(pending.size()), 1, [&pending, &model](uint32_t begin, uint32_t end) {
+            stbi_set_flip_vertically_on_load_thread(false);
+            for (uint32_t k = begin; k < end; k++) {
+                PendingImage &p = pending[k];
+                auto encoded = encoded_image(model, *p.img);
+                int width, height, num_channels;
+                uint8_t *pixels =
+                    stbi_load_from_memory(encoded.first, encoded.second, &width, &height, &num_channels, 4);
+                if (!pixels) {
+                    continue;
+                }
+                MipChainOptions options;
+                options.srgb = p.params.srgb;
+                options.max_levels = p.batch ? 1 : MipChain::MAX_LEVELS;
+                options.parallel = false;
+                p.ok = build_mip_chain(pixels, width, height, p.chain, options);
+                stbi_image_free(pixels);
+            }
+        });
+        std::vector<PendingImage *> batch;
+        for (auto &p : pending) {
+            if (!p.ok) {
+                log_warning("gltf loader: unable to create image '%s'", p.img->uri.c_str());
+                continue;
+            }
+            if (p.batch) {
+                batch.push_back(&p);
+                continue;
+            }
+            sg_image img = _rm.create_image(p.source_key, p.params, p.chain, p.img->uri.c_str());
+            for (int tex : p.textures) {
+                _tx_map[tex] = img;
+            }
         }
+        [[maybe_unused]] const int num_batched = batch_textures(batch);
+        log_debug("gltf loader: %d textures, %d images created (%d batched), %d shared with previous loads",
+                  int(model.textures.size()), int(pending.size()), num_batched, num_shared);
         return true;
     }
 
@@ -243,23 +565,35 @@ class GltfLoader {
         return true;
     }
 
+    /// image of a gltf texture, or the fallback when the texture couldn't be loaded
+    sg_image texture(int index, sg_image fallback) const {
+        auto it = _tx_map.find(index);
+        return it != _tx_map.end() ? it->second : fallback;
+    }
+
     std::string material_fullname(const tinygltf::Material &mtl) { return _filename + std::string("_") + mtl.name; }
 
     glengine::Material *create_material(const tinygltf::Material &mtl) {
         std::string mtl_name = material_fullname(mtl);
-        bool is_unlit = false;
-        for (auto &ext : mtl.extensions) {
-            if (ext.first == "KHR_materials_unlit") {
-                is_unlit = true;
-                log_info("material %s is using KHR_materials_unlit extension - disabling PBR", mtl_name.c_str());
-            }
-        }
         auto &pbr = mtl.pbrMetallicRoughness;
-        if (is_unlit) {
-            if (pbr.baseColorTexture.index >= 0) {
+        if (is_unlit(mtl)) {
+            log_info("material %s is using KHR_materials_unlit extension - disabling PBR", mtl_name.c_str());
+            auto batched = _tx_batch.find(pbr.baseColorTexture.index);
+            if (batched != _tx_batch.end() && batched->second.layer >= 0) {
+                auto material = _eng.create_material<glengine::MaterialDiffuseTextureArray>(
+                    SG_PRIMITIVETYPE_TRIANGLES, SG_INDEXTYPE_UINT32);
+                material->tex_diffuse_array = batched->second.image;
+                material->layer = uint32_t(batched->second.layer);
+                return material;
+            } else if (pbr.baseColorTexture.index >= 0) {
                 auto material = _eng.create_material<glengine::MaterialDiffuseTextured>(SG_PRIMITIVETYPE_TRIANGLES,
                                                                                         SG_INDEXTYPE_UINT32);
-                material->tex_diffuse = _tx_map[pbr.baseColorTexture.index];
+                if (batched != _tx_batch.end()) {
+                    material->tex_diffuse = batched->second.image;
+                    material->uv_rect = batched->second.uv_rect;
+                } else {
+                    material->tex_diffuse = texture(pbr.baseColorTexture.index, material->tex_diffuse);
+                }
                 return material;
             } else {
                 auto material =
@@ -273,23 +607,24 @@ class GltfLoader {
             auto material =
                 _eng.create_material<glengine::MaterialPBRIBL>(SG_PRIMITIVETYPE_TRIANGLES, SG_INDEXTYPE_UINT32);
             if (pbr.baseColorTexture.index >= 0) {
-                material->tex_diffuse = _tx_map[pbr.baseColorTexture.index];
+                material->tex_diffuse = texture(pbr.baseColorTexture.index, material->tex_diffuse);
             }
             material->roughness_factor = pbr.roughnessFactor;
             material->metallic_factor = pbr.metallicFactor;
             if (pbr.metallicRoughnessTexture.index >= 0) {
-                material->tex_metallic_roughness = _tx_map[pbr.metallicRoughnessTexture.index];
+                material->tex_metallic_roughness =
+                    texture(pbr.metallicRoughnessTexture.index, material->tex_metallic_roughness);
             }
             if (mtl.normalTexture.index >= 0) {
-                material->tex_normal = _tx_map[mtl.normalTexture.index];
+                material->tex_normal = texture(mtl.normalTexture.index, material->tex_normal);
             }
             material->emissive_factor = {(float)mtl.emissiveFactor[0], (float)mtl.emissiveFactor[1],
                                          (float)mtl.emissiveFactor[2]};
             if (mtl.emissiveTexture.index >= 0) {
-                material->tex_emissive = _tx_map[mtl.emissiveTexture.index];
+                material->tex_emissive = texture(mtl.emissiveTexture.index, material->tex_emissive);
             }
             if (mtl.occlusionTexture.index >= 0) {
-                material->tex_occlusion = _tx_map[mtl.occlusionTexture.index];
+                material->tex_occlusion = texture(mtl.occlusionTexture.index, material->tex_occlusion);
             }
             return material;
         }
@@ -302,26 +637,37 @@ class GltfLoader {
     std::string _filename = "";
     GLEngine &_eng;
     ResourceManager &_rm;
-    std::unordered_map<uint32_t, sg_image> _tx_map;
+    GltfImportOptions _options;
+    std::unordered_map<uint32_t, sg_image> _tx_map; ///< images by gltf texture index
+    struct BatchedTexture {
+        sg_image image;         ///< texture array or atlas
+        int layer;              ///< in the texture array, -1 for an atlas
+        math::Vector4f uv_rect; ///< in the atlas
+    };
+    std::unordered_map<int, BatchedTexture> _tx_batch; ///< by gltf texture index, see batch_textures
     std::vector<Mesh *> _meshes;
     std::vector<Renderable> _renderables;
+    std::unordered_map<int, Material *> _materials;                  ///< by gltf material index
+    std::unordered_map<int, std::vector<Renderable>> _shared_meshes; ///< by gltf mesh index
+    size_t _buffer_bytes = 0;                                         ///< size of the vertex and index buffers
+    int _num_objects = 0;
+    int _num_quantized = 0; ///< meshes kept quantized
+    int _num_instanced = 0; ///< renderables drawn with instancing
+    int _num_lods = 0;      ///< levels of detail generated, besides the full meshes
+    int _num_meshlets = 0;
 };
 
-} // namespace
-
-namespace glengine {
-
-std::vector<Renderable> create_from_gltf(GLEngine &eng, const char *filename) {
-    MeshData md;
-    tinygltf::Model model;
+bool load_gltf(const char *filename, tinygltf::Model &model) {
     tinygltf::TinyGLTF loader;
+    loader.SetImageLoader(keep_encoded_image, nullptr);
     std::string err;
     std::string warn;
 
     printf("loading gltf model: %s\n", filename);
     bool ret = false;
     if (get_file_extension(filename) == "gltf") {
-        ret = loader.LoadASCIIFromFile(&model, &err, &warn, filename);
+        // streaming reader, without the json document tinygltf builds before filling the model
+        ret = gltf_read(filename, model);
     } else { // assume binary gltf (usually .glb)
         ret = loader.LoadBinaryFromFile(&model, &err, &warn, filename);
     }
@@ -334,27 +680,90 @@ std::vector<Renderable> create_from_gltf(GLEngine &eng, const char *filename) {
     }
     if (!ret) {
         printf("Failed to parse glTF\n");
-        return std::vector<Renderable>();
+        return false;
+    }
+    if (model.scenes.empty()) {
+        printf("the glTF file has no scenes\n");
+        return false;
+    }
+    static const char *supported_extensions[] = {"KHR_materials_unlit", "KHR_mesh_quantization",
+                                                  "EXT_mesh_gpu_instancing", "EXT_meshopt_compression"};
+    for (const auto &ext : model.extensionsRequired) {
+        if (std::none_of(std::begin(supported_extensions), std::end(supported_extensions),
+                         [&ext](const char *name) { return ext == name; })) {
+            log_warning("gltf loader: required extension %s is not supported", ext.c_str());
+        }
+    }
+    if (!gltf_decode_meshopt(model)) {
+        return false;
     }
-
     log_debug("the model has %d buffers\n", (int)model.buffers.size());
     log_debug("the model has %d textures\n", (int)model.images.size());
-    const tinygltf::Scene &scene = model.scenes[model.defaultScene];
+    return true;
+}
+
+const tinygltf::Scene &default_scene(const tinygltf::Model &model) {
+    return model.scenes[model.defaultScene >= 0 && model.defaultScene < int(model.scenes.size()) ? model.defaultScene
+                                                                                                 : 0];
+}
+
+} // namespace
+
+namespace glengine {
+
+std::vector<Renderable> create_from_gltf(GLEngine &eng, const char *filename) {
+    return create_from_gltf(eng, filename, GltfImportOptions());
+}
+
+std::vector<Renderable> create_from_gltf(GLEngine &eng, const char *filename, const GltfImportOptions &options) {
+    tinygltf::Model model;
+    if (!load_gltf(filename, model)) {
+        return std::vector<Renderable>();
+    }
+    const tinygltf::Scene &scene = default_scene(model);
     log_debug("the scene has %d nodes\n", (int)scene.nodes.size());
-    GltfLoader ml(filename, eng);
+    GltfLoader ml(filename, eng, options);
     ml.load_textures(model);
     log_debug("loaded %d textures\n", (int)ml._tx_map.size());
     ml.parse_materials(model, true);
     // this loader makes the assumption that the entire scene is a single model
-    math::Matrix4f root_tf = math::matrix4_identity<float>();
-    root_tf = math::create_transformation(
-        {0, 0, 0}, math::quat_from_euler_321<float>(M_PI_2, 0, 0)); // because by default gltf are y-up
-    // root_tf = math::matrix4_identity<float>();
+    const math::Matrix4f root_tf = gltf_root_transform(); // because by default gltf are y-up
     for (size_t i = 0; i < scene.nodes.size(); ++i) {
         assert((scene.nodes[i] >= 0) && (scene.nodes[i] < int(model.nodes.size())));
         ml.load_node(model, model.nodes[scene.nodes[i]], root_tf);
     }
+    log_info("gltf loader: %d renderables (%d quantized, %d instanced, %d levels of detail, %d meshlets), %zu bytes "
+             "of vertex, index and instance buffers",
+             int(ml.renderables().size()), ml._num_quantized, ml._num_instanced, ml._num_lods, ml._num_meshlets,
+             ml._buffer_bytes);
     return ml.renderables();
 }
 
+Object *create_object_from_gltf(GLEngine &eng, const char *filename, Object *parent) {
+    return create_object_from_gltf(eng, filename, GltfImportOptions(), parent);
+}
+
+Object *create_object_from_gltf(GLEngine &eng, const char *filename, const GltfImportOptions &options,
+                                Object *parent) {
+    tinygltf::Model model;
+    if (!load_gltf(filename, model)) {
+        return nullptr;
+    }
+    const tinygltf::Scene &scene = default_scene(model);
+    GltfLoader ml(filename, eng, options);
+    ml.load_textures(model);
+    ml.parse_materials(model);
+    Object *root = eng.create_object(parent);
+    root->set_transform(gltf_root_transform()); // because by default gltf are y-up
+    for (size_t i = 0; i < scene.nodes.size(); ++i) {
+        assert((scene.nodes[i] >= 0) && (scene.nodes[i] < int(model.nodes.size())));
+        ml.load_node(model, model.nodes[scene.nodes[i]], root);
+    }
+    log_info("gltf loader: %d objects, %d shared meshes (%d quantized renderables, %d instanced, %d levels of "
+             "detail, %d meshlets), %zu bytes of vertex, index and instance buffers",
+             ml._num_objects, int(ml._shared_meshes.size()), ml._num_quantized, ml._num_instanced, ml._num_lods,
+             ml._num_meshlets, ml._buffer_bytes);
+    return root;
+}
+
 } // namespace glengine
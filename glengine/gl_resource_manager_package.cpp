@@ -0,0 +1,206 @@
+#include "gl_engine.h"
+#include "gl_resource_manager.h"
+#include "gl_package.h"
+#include "gl_logger.h"
+#include "gl_mesh.h"
+#include "gl_material_diffuse.h"
+#include "gl_material_pbr_ibl.h"
+#include "gl_texture_compression.h"
+#include "gl_texture_streamer.h"
+#include "gl_utils.h"
+
+#include "sokol_gfx.h"
+
+using namespace glengine;
+
+namespace {
+
+class PackageLoader {
+  public:
+    PackageLoader(Package &package, GLEngine &eng, TextureStreamer *streamer)
+    : _package(package)
+    , _eng(eng)
+    , _rm(eng.resource_manager())
+    , _streamer(streamer) {
+        const std::string path = normalize_path(package.filename());
+        struct {
+            uint64_t path_hash;
+            int64_t mtime;
+        } source = {murmur_hash2_64(path.data(), int(path.size()), 12345678), file_mtime(path.c_str())};
+        _package_key = murmur_hash2_64(&source, sizeof(source), 12345678);
+    }
+
+    /// image of a texture entry, looked up in the image cache by package (path and modification time) and entry
+    /// name before reading it. Returns the fallback if the entry is missing or invalid
+    sg_image texture(const std::string &name, bool srgb, sg_image fallback) {
+        if (name.empty()) {
+            return fallback;
+        }
+        struct {
+            uint64_t package_key;
+            uint64_t name_hash;
+        } source = {_package_key, murmur_hash2_64(name.data(), int(name.size()), 12345678)};
+        const uint64_t source_key = murmur_hash2_64(&source, sizeof(source), 12345678);
+        ImageParams params;
+        params.srgb = srgb;
+        sg_image img = _rm.find_image(source_key, params);
+        if (img.id != SG_INVALID_ID) {
+            return img;
+        }
+        if (_streamer) {
+            img = _streamer->create_image(_package, name, source_key, params);
+            return img.id != SG_INVALID_ID ? img : fallback;
+        }
+        const PackageEntry *entry = _package.find(name);
+        CompressedImage image;
+        if (!entry || entry->type != PackageEntryType::Texture || !_package.read(*entry, _data) ||
+            !load_texture_file(_data.data(), _data.size(), image)) {
+            log_warning("package loader: invalid texture '%s'", name.c_str());
+            return fallback;
+        }
+        img = _rm.create_image(source_key, params, image, name.c_str());
+        return img.id != SG_INVALID_ID ? img : fallback;
+    }
+
+    Material *create_material(const PackageMaterial &mtl) {
+        using Slot = PackageMaterial::TextureSlot;
+        if (mtl.unlit) {
+            if (!mtl.textures[Slot::BaseColor].empty()) {
+                auto material =
+                    _eng.create_material<MaterialDiffuseTextured>(SG_PRIMITIVETYPE_TRIANGLES, SG_INDEXTYPE_UINT32);
+                material->tex_diffuse = texture(mtl.textures[Slot::BaseColor], true, material->tex_diffuse);
+                if (_streamer) {
+                    _streamer->add_material(material, {material->tex_diffuse});
+                }
+                return material;
+            }
+            auto material = _eng.create_material<MaterialDiffuse>(SG_PRIMITIVETYPE_TRIANGLES, SG_INDEXTYPE_UINT32);
+            material->color = {uint8_t(mtl.base_color.x * 255), uint8_t(mtl.base_color.y * 255),
+                               uint8_t(mtl.base_color.z * 255), 255};
+            return material;
+        }
+        auto material = _eng.create_material<MaterialPBRIBL>(SG_PRIMITIVETYPE_TRIANGLES, SG_INDEXTYPE_UINT32);
+        material->tex_diffuse = texture(mtl.textures[Slot::BaseColor], true, material->tex_diffuse);
+        material->roughness_factor = mtl.roughness;
+        material->metallic_factor = mtl.metallic;
+        material->tex_metallic_roughness =
+            texture(mtl.textures[Slot::MetallicRoughness], false, material->tex_metallic_roughness);
+        material->tex_normal = texture(mtl.textures[Slot::Normal], false, material->tex_normal);
+        material->emissive_factor = mtl.emissive;
+        material->tex_emissive = texture(mtl.textures[Slot::Emissive], true, material->tex_emissive);
+        material->tex_occlusion = texture(mtl.textures[Slot::Occlusion], false, material->tex_occlusion);
+        if (_streamer) {
+            _streamer->add_material(material, {material->tex_diffuse, material->tex_metallic_roughness,
+                                               material->tex_normal, material->tex_emissive, material->tex_occlusion});
+        }
+        return material;
+    }
+
+    bool load_model(const PackageEntry &model_entry) {
+        PackageModel model;
+        if (!_package.read(model_entry, _data) || !decode_model(_data.data(), _data.size(), model)) {
+            log_error("package loader: invalid model '%s'", model_entry.name.c_str());
+            return false;
+        }
+        std::vector<PackageMaterial> materials;
+        const PackageEntry *materials_entry = _package.find(model.materials);
+        if (!materials_entry || !_package.read(*materials_entry, _data) ||
+            !decode_materials(_data.data(), _data.size(), materials)) {
+            log_warning("package loader: model '%s' has no valid materials", model_entry.name.c_str());
+        }
+        // materials are created on first use, and shared by the meshes of the model
+        std::vector<Material *> created(materials.size(), nullptr);
+        MeshData md;
+        for (const auto &name : model.meshes) {
+            const PackageEntry *entry = _package.find(name);
+            int32_t material_index = -1;
+            if (!entry || !_package.read(*entry, _data) ||
+                !decode_mesh(_data.data(), _data.size(), md, material_index)) {
+                log_warning("package loader: invalid mesh '%s'", name.c_str());
+                continue;
+            }
+            Mesh *mesh = _eng.create_mesh();
+            mesh->init(md.vertices, md.indices);
+            if (!md.lods.empty()) {
+                mesh->set_lods(md.lods);
+            }
+            if (!md.meshlets.empty()) {
+                mesh->set_meshlets(md.meshlets);
+            }
+            Material *material = nullptr;
+            if (material_index >= 0 && material_index < int32_t(materials.size())) {
+                if (!created[material_index]) {
+                    created[material_index] = create_material(materials[material_index]);
+                }
+                material = created[material_index];
+            } else {
+                material = _eng.create_material<MaterialDiffuse>(SG_PRIMITIVETYPE_TRIANGLES, SG_INDEXTYPE_UINT32);
+            }
+            _renderables.push_back({mesh, material});
+        }
+        return true;
+    }
+
+    /// all the materials of a Materials entry
+    std::vector<Material *> load_materials(const std::string &name) {
+        std::vector<PackageMaterial> materials;
+        const PackageEntry *entry = _package.find(name);
+        if (!entry || !_package.read(*entry, _data) || !decode_materials(_data.data(), _data.size(), materials)) {
+            log_warning("package loader: invalid materials '%s'", name.c_str());
+            return {};
+        }
+        std::vector<Material *> created;
+        for (const auto &mtl : materials) {
+            created.push_back(create_material(mtl));
+        }
+        return created;
+    }
+
+    std::vector<Renderable> &renderables() { return _renderables; }
+
+  private:
+    Package &_package;
+    GLEngine &_eng;
+    ResourceManager &_rm;
+    TextureStreamer *_streamer = nullptr; ///< streams the textures when not null
+    uint64_t _package_key = 0;
+    std::vector<uint8_t> _data; ///< entry data, reused across reads
+    std::vector<Renderable> _renderables;
+};
+
+} // namespace
+
+namespace glengine {
+
+std::vector<Material *> create_package_materials(GLEngine &eng, Package &package, const std::string &name,
+                                                 TextureStreamer *textures) {
+    PackageLoader loader(package, eng, textures);
+    return loader.load_materials(name);
+}
+
+std::vector<Renderable> create_from_package(GLEngine &eng, const char *filename, const char *name,
+                                            TextureStreamer *textures) {
+    Package package;
+    if (!package.open(filename)) {
+        log_error("unable to open package '%s'", filename);
+        return {};
+    }
+    const PackageEntry *model = nullptr;
+    for (const auto &entry : package.entries()) {
+        if (entry.type == PackageEntryType::Model && (!name || entry.name == name)) {
+            model = &entry;
+            break;
+        }
+    }
+    if (!model) {
+        log_error("package '%s' has no model '%s'", filename, name ? name : "");
+        return {};
+    }
+    PackageLoader loader(package, eng, textures);
+    loader.load_model(*model);
+    log_debug("loaded %d renderables from model '%s' of package '%s'", int(loader.renderables().size()),
+              model->name.c_str(), filename);
+    return loader.renderables();
+}
+
+} // namespace glengine
@@ -0,0 +1,59 @@
+#include "gl_ring_mesh.h"
+#include "gl_mesh.h"
+
+#include <algorithm>
+
+namespace glengine {
+
+void RingMesh::init(Mesh *mesh, uint32_t capacity, uint32_t page_size, uint32_t page_overlap) {
+    _mesh = mesh;
+    _capacity = std::max<uint32_t>(capacity, 1);
+    _next = 0;
+    _full = false;
+    _changed = false;
+    _mesh->page_size = std::max<uint32_t>(std::min(page_size, capacity), 1);
+    _mesh->page_overlap = page_overlap;
+    _mesh->draw_start = 0;
+    _mesh->vertices.reserve(_capacity);
+    _mesh->init({}, {}, SG_USAGE_STREAM);
+}
+
+size_t RingMesh::size() const {
+    return _full ? _capacity : _next;
+}
+
+void RingMesh::push(const Vertex &v) {
+    if (_full) {
+        _mesh->vertices[_next] = v;
+        _mesh->mark_dirty(_next, 1);
+    } else {
+        _mesh->append(&v, 1);
+    }
+    _next++;
+    if (_next == _capacity) {
+        _next = 0;
+        _full = true;
+    }
+    // the oldest vertex is the next one to be overwritten
+    _mesh->draw_start = uint32_t(_full ? _next : 0);
+    _changed = true;
+}
+
+void RingMesh::clear() {
+    _mesh->vertices.clear();
+    _mesh->draw_start = 0;
+    _next = 0;
+    _full = false;
+    _changed = true;
+}
+
+void RingMesh::update() {
+    // without marks the mesh would upload all its pages
+    if (!_changed) {
+        return;
+    }
+    _mesh->update_buffers();
+    _changed = false;
+}
+
+} // namespace glengine
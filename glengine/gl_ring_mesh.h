@@ -0,0 +1,38 @@
+#pragma once
+
+#include "gl_types.h"
+
+#include <cstddef>
+#include <cstdint>
+
+namespace glengine {
+
+class Mesh;
+
+/// fixed capacity window over a stream of vertices (time series, trails): once full, push() overwrites the oldest
+/// vertex. The mesh is paged (see Mesh::page_size) and drawn from the oldest vertex to the newest one, so that an
+/// update only uploads the pages written since the previous one
+class RingMesh {
+  public:
+    /// initialize a mesh created by the engine (see GLEngine::create_mesh) as a paged streaming mesh. page_overlap has
+    /// to be 1 for line strips
+    void init(Mesh *mesh, uint32_t capacity, uint32_t page_size = 1024, uint32_t page_overlap = 1);
+
+    void push(const Vertex &v);
+    void clear();
+    /// upload the pushed vertices, once per frame. Nothing is uploaded if nothing was pushed since the previous update
+    void update();
+
+    Mesh *mesh() const { return _mesh; }
+    size_t size() const;
+    size_t capacity() const { return _capacity; }
+
+  private:
+    Mesh *_mesh = nullptr;
+    size_t _capacity = 0;
+    size_t _next = 0; ///< where the next vertex is written
+    bool _full = false;
+    bool _changed = false; ///< pushed or cleared since the last update
+};
+
+} // namespace glengine
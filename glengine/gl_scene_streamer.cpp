@@ -0,0 +1,293 @@
+#include "gl_scene_streamer.h"
+#include "gl_engine.h"
+#include "gl_logger.h"
+#include "gl_material_diffuse.h"
+#include "gl_mesh.h"
+#include "gl_object.h"
+#include "gl_package.h"
+#include "gl_thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+
+namespace {
+
+// transform from the space of an object to the world
+math::Matrix4f world_transform(glengine::Object *obj) {
+    math::Matrix4f tf = math::matrix4_identity<float>();
+    for (; obj; obj = obj->parent()) {
+        tf = obj->transform() * obj->_scale * tf;
+    }
+    return tf;
+}
+
+float distance_to_box(const math::Vector3f &p, const math::Vector3f &bbox_min, const math::Vector3f &bbox_max) {
+    const float dx = std::max(std::max(bbox_min.x - p.x, p.x - bbox_max.x), 0.0f);
+    const float dy = std::max(std::max(bbox_min.y - p.y, p.y - bbox_max.y), 0.0f);
+    const float dz = std::max(std::max(bbox_min.z - p.z, p.z - bbox_max.z), 0.0f);
+    return std::sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+} // namespace
+
+namespace glengine {
+
+void split_mesh_in_cells(const MeshData &md, float cell_size, std::map<std::array<int32_t, 3>, MeshData> &cells) {
+    // index of each vertex in the cell of the current triangle, per cell
+    std::map<std::array<int32_t, 3>, std::unordered_map<uint32_t, uint32_t>> remaps;
+    for (size_t t = 0; t + 2 < md.indices.size(); t += 3) {
+        const uint32_t *tri = &md.indices[t];
+        if (tri[0] >= md.vertices.size() || tri[1] >= md.vertices.size() || tri[2] >= md.vertices.size()) {
+            continue;
+        }
+        const math::Vector3f centroid =
+            (md.vertices[tri[0]].pos + md.vertices[tri[1]].pos + md.vertices[tri[2]].pos) * (1.0f / 3.0f);
+        const std::array<int32_t, 3> key = {int32_t(std::floor(centroid.x / cell_size)),
+                                            int32_t(std::floor(centroid.y / cell_size)),
+                                            int32_t(std::floor(centroid.z / cell_size))};
+        MeshData &cell = cells[key];
+        auto &remap = remaps[key];
+        for (int k = 0; k < 3; k++) {
+            auto it = remap.emplace(tri[k], uint32_t(cell.vertices.size()));
+            if (it.second) {
+                cell.vertices.push_back(md.vertices[tri[k]]);
+            }
+            cell.indices.push_back(it.first->second);
+        }
+    }
+}
+
+/// state shared with the loads running on the worker threads
+struct SceneStreamer::Shared {
+    struct Loaded {
+        uint32_t cell;
+        bool ok;
+        std::vector<std::pair<MeshData, int32_t>> meshes; ///< with their material index
+    };
+
+    Package package;
+    std::mutex package_mutex; ///< package reads, the decoding is done in parallel
+    std::mutex loaded_mutex;
+    std::deque<Loaded> loaded;
+};
+
+bool SceneStreamer::init(GLEngine &eng, const char *filename, const char *name, Object *parent,
+                         TextureStreamer *textures) {
+    terminate();
+    _eng = &eng;
+    _shared = std::make_shared<Shared>();
+    Package &package = _shared->package;
+    if (!package.open(filename)) {
+        log_error("scene streamer: unable to open package '%s'", filename);
+        return false;
+    }
+    const PackageEntry *entry = nullptr;
+    for (const auto &e : package.entries()) {
+        if (e.type == PackageEntryType::Cells && (!name || e.name == name)) {
+            entry = &e;
+            break;
+        }
+    }
+    std::vector<uint8_t> data;
+    PackageCells cells;
+    if (!entry || !package.read(*entry, data) || !decode_cells(data.data(), data.size(), cells)) {
+        log_error("scene streamer: package '%s' has no valid cells '%s'", filename, name ? name : "");
+        return false;
+    }
+    _materials = create_package_materials(eng, package, cells.materials, textures);
+    _default_material = eng.create_material<MaterialDiffuse>(SG_PRIMITIVETYPE_TRIANGLES, SG_INDEXTYPE_UINT32);
+    _root = eng.create_object(parent);
+    _stats = StreamingStats();
+    _cells.resize(cells.cells.size());
+    for (size_t i = 0; i < _cells.size(); i++) {
+        const PackageCell &pc = cells.cells[i];
+        _cells[i].bbox_min = pc.bbox_min;
+        _cells[i].bbox_max = pc.bbox_max;
+        _cells[i].gpu_bytes = pc.gpu_bytes;
+        _cells[i].meshes = pc.meshes;
+        _stats.total_bytes += pc.gpu_bytes;
+    }
+    _stats.num_cells = uint32_t(_cells.size());
+    log_info("scene streamer: '%s' has %u cells of size %.1f, %llu bytes of buffers", entry->name.c_str(),
+             _stats.num_cells, cells.cell_size, (unsigned long long)_stats.total_bytes);
+    return true;
+}
+
+void SceneStreamer::terminate() {
+    for (uint32_t i = 0; i < _cells.size(); i++) {
+        if (_cells[i].state == CellState::Resident) {
+            evict(i);
+        }
+    }
+    _cells.clear();
+    delete _root;
+    _root = nullptr;
+    // the pending loads keep their own reference, their results are never used
+    _shared.reset();
+    _stats = StreamingStats();
+}
+
+AABB SceneStreamer::bounds() const {
+    if (_cells.empty()) {
+        return {{0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 0.0f}};
+    }
+    math::Vector3f bbox_min = _cells[0].bbox_min, bbox_max = _cells[0].bbox_max;
+    for (const auto &cell : _cells) {
+        bbox_min = {std::min(bbox_min.x, cell.bbox_min.x), std::min(bbox_min.y, cell.bbox_min.y),
+                    std::min(bbox_min.z, cell.bbox_min.z)};
+        bbox_max = {std::max(bbox_max.x, cell.bbox_max.x), std::max(bbox_max.y, cell.bbox_max.y),
+                    std::max(bbox_max.z, cell.bbox_max.z)};
+    }
+    return {(bbox_min + bbox_max) * 0.5f, bbox_max - bbox_min};
+}
+
+void SceneStreamer::request(uint32_t index) {
+    Cell &cell = _cells[index];
+    cell.state = CellState::Loading;
+    _stats.pending_loads++;
+    _stats.pending_bytes += cell.gpu_bytes;
+    default_thread_pool().submit([shared = _shared, index, meshes = cell.meshes]() {
+        Shared::Loaded loaded = {index, true, {}};
+        std::vector<uint8_t> data;
+        for (const auto &name : meshes) {
+            {
+                std::lock_guard<std::mutex> lock(shared->package_mutex);
+                const PackageEntry *entry = shared->package.find(name);
+                loaded.ok = entry && shared->package.read(*entry, data);
+            }
+            loaded.meshes.emplace_back();
+            loaded.ok = loaded.ok && decode_mesh(data.data(), data.size(), loaded.meshes.back().first,
+                                                 loaded.meshes.back().second);
+            if (!loaded.ok) {
+                log_warning("scene streamer: invalid mesh '%s'", name.c_str());
+                break;
+            }
+        }
+        std::lock_guard<std::mutex> lock(shared->loaded_mutex);
+        shared->loaded.push_back(std::move(loaded));
+    });
+}
+
+void SceneStreamer::upload(uint32_t index, std::vector<std::pair<MeshData, int32_t>> &meshes) {
+    Cell &cell = _cells[index];
+    std::vector<Renderable> renderables;
+    for (auto &m : meshes) {
+        Mesh *mesh = _eng->create_mesh();
+        mesh->init(m.first.vertices, m.first.indices);
+        if (!m.first.lods.empty()) {
+            mesh->set_lods(m.first.lods);
+        }
+        if (!m.first.meshlets.empty()) {
+            mesh->set_meshlets(m.first.meshlets);
+        }
+        cell.resident_meshes.push_back(mesh);
+        Material *material = m.second >= 0 && m.second < int32_t(_materials.size()) ? _materials[m.second]
+                                                                                     : _default_material;
+        renderables.push_back({mesh, material});
+    }
+    cell.object = _eng->create_object(renderables, _root);
+    cell.state = CellState::Resident;
+    _stats.resident_cells++;
+    _stats.resident_bytes += cell.gpu_bytes;
+    _stats.num_loads++;
+}
+
+void SceneStreamer::evict(uint32_t index) {
+    Cell &cell = _cells[index];
+    delete cell.object;
+    cell.object = nullptr;
+    for (Mesh *mesh : cell.resident_meshes) {
+        _eng->resource_manager().destroy_mesh(mesh);
+    }
+    cell.resident_meshes.clear();
+    cell.state = CellState::Unloaded;
+    _stats.resident_cells--;
+    _stats.resident_bytes -= cell.gpu_bytes;
+    _stats.num_evictions++;
+}
+
+void SceneStreamer::update(const Camera &cam) {
+    if (!_shared) {
+        return;
+    }
+    // camera position in the space of the cells
+    const math::Matrix4f &cam_tf = cam.transform();
+    const math::Vector3f cam_pos =
+        math::inverse(world_transform(_root)) * math::Vector3f{cam_tf(0, 3), cam_tf(1, 3), cam_tf(2, 3)};
+    for (auto &cell : _cells) {
+        cell.distance = distance_to_box(cam_pos, cell.bbox_min, cell.bbox_max);
+    }
+    const float evict_distance = std::max(params.evict_distance, params.load_distance);
+    const float hysteresis = evict_distance - params.load_distance;
+
+    // upload the loaded cells still in range, the others are discarded
+    for (uint32_t uploads = 0; uploads < params.max_uploads_per_frame;) {
+        Shared::Loaded loaded;
+        {
+            std::lock_guard<std::mutex> lock(_shared->loaded_mutex);
+            if (_shared->loaded.empty()) {
+                break;
+            }
+            loaded = std::move(_shared->loaded.front());
+            _shared->loaded.pop_front();
+        }
+        Cell &cell = _cells[loaded.cell];
+        _stats.pending_loads--;
+        _stats.pending_bytes -= cell.gpu_bytes;
+        if (!loaded.ok || cell.distance > evict_distance) {
+            cell.state = CellState::Unloaded;
+            _stats.num_cancelled++;
+            continue;
+        }
+        upload(loaded.cell, loaded.meshes);
+        uploads++;
+    }
+
+    // evict the cells out of range, then the furthest ones if the budget has been lowered
+    std::vector<uint32_t> resident;
+    for (uint32_t i = 0; i < _cells.size(); i++) {
+        if (_cells[i].state == CellState::Resident) {
+            if (_cells[i].distance > evict_distance) {
+                evict(i);
+            } else {
+                resident.push_back(i);
+            }
+        }
+    }
+    std::sort(resident.begin(), resident.end(),
+              [this](uint32_t a, uint32_t b) { return _cells[a].distance > _cells[b].distance; });
+    size_t furthest = 0;
+    while (_stats.resident_bytes + _stats.pending_bytes > params.memory_budget && furthest < resident.size()) {
+        evict(resident[furthest++]);
+    }
+
+    // request the nearest cells in range, as long as they fit in the budget
+    std::vector<uint32_t> candidates;
+    for (uint32_t i = 0; i < _cells.size(); i++) {
+        if (_cells[i].state == CellState::Unloaded && _cells[i].distance <= params.load_distance) {
+            candidates.push_back(i);
+        }
+    }
+    std::sort(candidates.begin(), candidates.end(),
+              [this](uint32_t a, uint32_t b) { return _cells[a].distance < _cells[b].distance; });
+    for (uint32_t index : candidates) {
+        if (_stats.pending_loads >= params.max_pending_loads) {
+            break;
+        }
+        const Cell &cell = _cells[index];
+        // make room with the cells clearly further away, so that two cells never replace each other back and forth
+        while (_stats.resident_bytes + _stats.pending_bytes + cell.gpu_bytes > params.memory_budget &&
+               furthest < resident.size() && _cells[resident[furthest]].distance > cell.distance + hysteresis) {
+            evict(resident[furthest++]);
+        }
+        if (_stats.resident_bytes + _stats.pending_bytes + cell.gpu_bytes > params.memory_budget) {
+            break;
+        }
+        request(index);
+    }
+}
+
+} // namespace glengine
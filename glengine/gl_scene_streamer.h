@@ -0,0 +1,103 @@
+#pragma once
+
+#include "gl_prefabs.h"
+#include "gl_utils.h"
+#include "math/vmath.h"
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace glengine {
+
+class Camera;
+class GLEngine;
+class Material;
+class Mesh;
+class Object;
+class TextureStreamer;
+
+/// split the triangles of a mesh in the cells of a regular grid of the given size, by the position of their centroid.
+/// Triangles are appended to the meshes of the cells already in the map, vertices shared by triangles of different
+/// cells are duplicated
+void split_mesh_in_cells(const MeshData &md, float cell_size, std::map<std::array<int32_t, 3>, MeshData> &cells);
+
+/// settings of the streaming, they can be changed at any time
+struct StreamingParams {
+    float load_distance = 100.0f;  ///< cells closer to the camera are loaded (distance to their bounds)
+    float evict_distance = 150.0f; ///< resident cells further away are evicted. The gap with load_distance avoids
+                                   ///< loading and evicting the same cells when the camera moves back and forth
+    uint64_t memory_budget = uint64_t(256) << 20; ///< vertex and index buffers of the resident and pending cells
+    uint32_t max_pending_loads = 4;               ///< cells read and decoded at the same time by the worker threads
+    uint32_t max_uploads_per_frame = 2;           ///< cells uploaded per update, to bound the cost of a frame
+};
+
+struct StreamingStats {
+    uint32_t num_cells = 0;
+    uint32_t resident_cells = 0;
+    uint32_t pending_loads = 0; ///< cells being read and decoded, or waiting to be uploaded
+    uint64_t resident_bytes = 0;
+    uint64_t pending_bytes = 0;
+    uint64_t total_bytes = 0; ///< of all the cells
+    uint64_t num_loads = 0;   ///< cells uploaded since init
+    uint64_t num_evictions = 0;
+    uint64_t num_cancelled = 0; ///< loads discarded because the cell went out of range before its upload
+};
+
+/// streaming of a model split in cells by the asset cooker (Cells entry of a package, see split_mesh_in_cells): only
+/// the cells near the camera are resident on the gpu. Cells are read and decoded on the worker threads, and uploaded
+/// by update() on the main thread. Loads are done nearest first and never exceed the memory budget, making room by
+/// evicting resident cells that are further away than the cell to load (by more than the hysteresis gap).
+/// Materials and their textures are created once, when the streamer is initialized
+class SceneStreamer {
+  public:
+    /// open the Cells entry of a package (the first one if name is null). The resident cells are children of root(),
+    /// created under parent (or the scene root). The textures of the materials are streamed by textures if not null
+    bool init(GLEngine &eng, const char *filename, const char *name = nullptr, Object *parent = nullptr,
+              TextureStreamer *textures = nullptr);
+    /// evict all the cells and destroy the root object. Loads still running on the worker threads are discarded.
+    /// Has to be called before GLEngine::terminate, which destroys the remaining objects and meshes
+    void terminate();
+
+    /// evict and request cells for the position of the camera, and upload the cells loaded since the last update.
+    /// Has to be called on the main thread, once per frame before rendering
+    void update(const Camera &cam);
+
+    Object *root() { return _root; }
+    const StreamingStats &stats() const { return _stats; }
+    /// bounding box of all the cells, resident or not, in the space of root()
+    AABB bounds() const;
+
+    StreamingParams params;
+
+  private:
+    enum class CellState { Unloaded, Loading, Resident };
+    struct Cell {
+        math::Vector3f bbox_min;
+        math::Vector3f bbox_max;
+        uint64_t gpu_bytes = 0;
+        std::vector<std::string> meshes; ///< package entries
+        CellState state = CellState::Unloaded;
+        float distance = 0.0f; ///< to the camera, at the last update
+        Object *object = nullptr;
+        std::vector<Mesh *> resident_meshes;
+    };
+    struct Shared;
+
+    void request(uint32_t index);
+    void upload(uint32_t index, std::vector<std::pair<MeshData, int32_t>> &meshes);
+    void evict(uint32_t index);
+
+    GLEngine *_eng = nullptr;
+    Object *_root = nullptr;
+    std::vector<Cell> _cells;
+    std::vector<Material *> _materials;
+    Material *_default_material = nullptr;
+    std::shared_ptr<Shared> _shared; ///< package and loaded cells, also owned by the pending loads
+    StreamingStats _stats;
+};
+
+} // namespace glengine
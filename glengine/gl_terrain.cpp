@@ -0,0 +1,394 @@
+#include "gl_terrain.h"
+#include "gl_camera.h"
+#include "gl_engine.h"
+#include "gl_logger.h"
+#include "generated/shaders/terrain.glsl.h"
+
+#include "stb/stb_image.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/// whether the box is within radius of the point
+bool in_range(const math::Vector3f &bbox_min, const math::Vector3f &bbox_max, const math::Vector3f &p, float radius) {
+    const float dx = std::max(std::max(bbox_min.x - p.x, p.x - bbox_max.x), 0.0f);
+    const float dy = std::max(std::max(bbox_min.y - p.y, p.y - bbox_max.y), 0.0f);
+    const float dz = std::max(std::max(bbox_min.z - p.z, p.z - bbox_max.z), 0.0f);
+    return dx * dx + dy * dy + dz * dz <= radius * radius;
+}
+
+// ranges of the root level, never out of range nor morphing
+constexpr float root_range = 1e30f;
+
+} // namespace
+
+namespace glengine {
+
+bool load_heightmap_png(const char *filename, Heightmap &heightmap) {
+    int width, height, num_channels;
+    uint16_t *pixels = stbi_load_16(filename, &width, &height, &num_channels, 1);
+    if (!pixels) {
+        log_error("unable to load heightmap '%s'", filename);
+        return false;
+    }
+    heightmap.width = uint32_t(width);
+    heightmap.height = uint32_t(height);
+    heightmap.samples.assign(pixels, pixels + size_t(width) * height);
+    heightmap.min_height = 0.0f;
+    heightmap.max_height = 1.0f;
+    stbi_image_free(pixels);
+    return true;
+}
+
+bool load_heightmap_raw(const char *filename, uint32_t width, uint32_t height, Heightmap &heightmap) {
+    std::vector<float> heights(size_t(width) * height);
+    FILE *f = fopen(filename, "rb");
+    const bool ok = f && fread(heights.data(), sizeof(float), heights.size(), f) == heights.size();
+    if (f) {
+        fclose(f);
+    }
+    if (!ok || heights.empty()) {
+        log_error("unable to read %ux%u heights from '%s'", width, height, filename);
+        return false;
+    }
+    const auto minmax = std::minmax_element(heights.begin(), heights.end());
+    heightmap.width = width;
+    heightmap.height = height;
+    heightmap.min_height = *minmax.first;
+    heightmap.max_height = *minmax.second;
+    const float scale = heightmap.max_height > heightmap.min_height
+                            ? 65535.0f / (heightmap.max_height - heightmap.min_height)
+                            : 0.0f;
+    heightmap.samples.resize(heights.size());
+    for (size_t i = 0; i < heights.size(); i++) {
+        heightmap.samples[i] = uint16_t((heights[i] - heightmap.min_height) * scale + 0.5f);
+    }
+    return true;
+}
+
+bool Terrain::init(GLEngine &eng, const Heightmap &heightmap) {
+    const uint32_t n = params.grid_resolution;
+    const uint32_t tile_size = params.tile_size;
+    if (heightmap.width < 2 || heightmap.height < 2 ||
+        heightmap.samples.size() != size_t(heightmap.width) * heightmap.height) {
+        log_error("terrain: invalid heightmap");
+        return false;
+    }
+    if (n < 2 || (n & (n - 1)) || tile_size < n || (tile_size & (tile_size - 1))) {
+        log_error("terrain: the grid resolution and the tile size have to be powers of two");
+        return false;
+    }
+    _width = heightmap.width;
+    _height = heightmap.height;
+    _min_height = heightmap.min_height;
+    _max_height = heightmap.max_height;
+    const float height_scale = (_max_height - _min_height) / 65535.0f;
+    auto sample = [&](uint32_t x, uint32_t y) { return heightmap.samples[size_t(y) * _width + x]; };
+
+    // levels of the quadtree, until a node covers the heightmap
+    const uint32_t extent = std::max(_width, _height) - 1;
+    uint32_t num_levels = 1;
+    while ((n << (num_levels - 1)) < extent) {
+        num_levels++;
+    }
+    // min and max heights of the leaves, then of their parents
+    _node_heights.assign(num_levels, {});
+    _nodes_x.assign(num_levels, 0);
+    _nodes_y.assign(num_levels, 0);
+    _nodes_x[0] = (_width - 2) / n + 1;
+    _nodes_y[0] = (_height - 2) / n + 1;
+    _node_heights[0].resize(size_t(_nodes_x[0]) * _nodes_y[0]);
+    for (uint32_t ny = 0; ny < _nodes_y[0]; ny++) {
+        for (uint32_t nx = 0; nx < _nodes_x[0]; nx++) {
+            uint16_t lo = 65535, hi = 0;
+            for (uint32_t y = ny * n; y <= std::min((ny + 1) * n, _height - 1); y++) {
+                for (uint32_t x = nx * n; x <= std::min((nx + 1) * n, _width - 1); x++) {
+                    lo = std::min(lo, sample(x, y));
+                    hi = std::max(hi, sample(x, y));
+                }
+            }
+            _node_heights[0][ny * _nodes_x[0] + nx] = {_min_height + lo * height_scale,
+                                                       _min_height + hi * height_scale};
+        }
+    }
+    for (uint32_t level = 1; level < num_levels; level++) {
+        const uint32_t child_x = _nodes_x[level - 1], child_y = _nodes_y[level - 1];
+        _nodes_x[level] = (child_x + 1) / 2;
+        _nodes_y[level] = (child_y + 1) / 2;
+        _node_heights[level].assign(size_t(_nodes_x[level]) * _nodes_y[level], {_max_height, _min_height});
+        for (uint32_t y = 0; y < child_y; y++) {
+            for (uint32_t x = 0; x < child_x; x++) {
+                const math::Vector2f &c = _node_heights[level - 1][y * child_x + x];
+                math::Vector2f &p = _node_heights[level][(y / 2) * _nodes_x[level] + x / 2];
+                p = {std::min(p.x, c.x), std::max(p.y, c.y)};
+            }
+        }
+    }
+
+    // height textures: tiles sharing their border samples, and an overview for the nodes larger than a tile. The
+    // samples are surrounded by an apron of one texel, the neighbouring samples, so that the normals at the borders of
+    // a tile are the ones of its neighbours
+    const sg_pixel_format format =
+        sg_query_pixelformat(SG_PIXELFORMAT_R16).sample ? SG_PIXELFORMAT_R16 : SG_PIXELFORMAT_R32F;
+    auto make_tile = [&](uint32_t x0, uint32_t y0, uint32_t step, const char *label) {
+        Tile tile = {.x = x0, .y = y0, .step = step};
+        // the last samples are the border of the heightmap, even off the step of the overview
+        const uint32_t w = std::min(tile_size, (_width - 1 - x0 + step - 1) / step) + 3;
+        const uint32_t h = std::min(tile_size, (_height - 1 - y0 + step - 1) / step) + 3;
+        // sample of a texel, the apron clamped to the heightmap
+        auto sample_of = [step](uint32_t t, uint32_t first, uint32_t size) {
+            return t == 0 ? (first >= step ? first - step : 0) : std::min(first + (t - 1) * step, size - 1);
+        };
+        std::vector<uint16_t> texels(size_t(w) * h);
+        for (uint32_t y = 0; y < h; y++) {
+            const uint32_t sy = sample_of(y, y0, _height);
+            for (uint32_t x = 0; x < w; x++) {
+                texels[size_t(y) * w + x] = sample(sample_of(x, x0, _width), sy);
+            }
+        }
+        std::vector<float> texels_f;
+        sg_image_desc desc = {0};
+        desc.width = int(w);
+        desc.height = int(h);
+        desc.pixel_format = format;
+        desc.min_filter = SG_FILTER_NEAREST;
+        desc.mag_filter = SG_FILTER_NEAREST;
+        desc.wrap_u = SG_WRAP_CLAMP_TO_EDGE;
+        desc.wrap_v = SG_WRAP_CLAMP_TO_EDGE;
+        if (format == SG_PIXELFORMAT_R16) {
+            desc.data.subimage[0][0] = {texels.data(), texels.size() * sizeof(uint16_t)};
+        } else {
+            texels_f.resize(texels.size());
+            std::transform(texels.begin(), texels.end(), texels_f.begin(), [](uint16_t t) { return t / 65535.0f; });
+            desc.data.subimage[0][0] = {texels_f.data(), texels_f.size() * sizeof(float)};
+        }
+        desc.label = label;
+        tile.image = eng._config.deferred_uploads ? eng.upload_queue().make_image(desc) : sg_make_image(desc);
+        _stats.texture_bytes += desc.data.subimage[0][0].size;
+        _tiles.push_back(tile);
+    };
+    _stats.texture_bytes = 0;
+    _tiles_x = (_width - 2) / tile_size + 1;
+    const uint32_t tiles_y = (_height - 2) / tile_size + 1;
+    for (uint32_t y = 0; y < tiles_y; y++) {
+        for (uint32_t x = 0; x < _tiles_x; x++) {
+            make_tile(x * tile_size, y * tile_size, 1, "terrain-tile");
+        }
+    }
+    if ((n << (num_levels - 1)) > tile_size) {
+        // the vertices of the nodes using the overview have to fall on its samples
+        uint32_t step = 1;
+        while ((extent + step - 1) / step > tile_size) {
+            step *= 2;
+        }
+        if (step > 2 * tile_size / n) {
+            log_error("terrain: %ux%u heightmap too large for tiles of %u", _width, _height, tile_size);
+            terminate();
+            return false;
+        }
+        make_tile(0, 0, step, "terrain-overview");
+    }
+
+    // the grid shared by the chunks, its indices by quarter so that each can be drawn alone
+    std::vector<float> grid;
+    for (uint32_t y = 0; y <= n; y++) {
+        for (uint32_t x = 0; x <= n; x++) {
+            grid.push_back(float(x));
+            grid.push_back(float(y));
+        }
+    }
+    std::vector<uint32_t> indices;
+    for (uint32_t quarter = 0; quarter < 4; quarter++) {
+        const uint32_t qx = (quarter & 1) * n / 2, qy = (quarter >> 1) * n / 2;
+        for (uint32_t y = qy; y < qy + n / 2; y++) {
+            for (uint32_t x = qx; x < qx + n / 2; x++) {
+                // the diagonals all go the same way, so that the morphed grid matches the one of the parent level
+                const uint32_t i = y * (n + 1) + x;
+                indices.insert(indices.end(), {i, i + 1, i + n + 2, i, i + n + 2, i + n + 1});
+            }
+        }
+    }
+    _vertices = sg_make_buffer((sg_buffer_desc){.size = grid.size() * sizeof(float),
+                                                .data = {grid.data(), grid.size() * sizeof(float)},
+                                                .label = "terrain-grid-vertices"});
+    _indices = sg_make_buffer((sg_buffer_desc){.size = indices.size() * sizeof(uint32_t),
+                                               .type = SG_BUFFERTYPE_INDEXBUFFER,
+                                               .data = {indices.data(), indices.size() * sizeof(uint32_t)},
+                                               .label = "terrain-grid-indices"});
+
+    ResourceManager &rm = eng.resource_manager();
+    sg_pipeline_desc pip_desc = {0};
+    pip_desc.layout.attrs[ATTR_vs_terrain_grid_pos].format = SG_VERTEXFORMAT_FLOAT2;
+    pip_desc.shader = rm.get_or_create_shader(*terrain_shader_desc(sg_query_backend()));
+    pip_desc.index_type = SG_INDEXTYPE_UINT32;
+    pip_desc.cull_mode = SG_CULLMODE_BACK;
+    pip_desc.face_winding = SG_FACEWINDING_CCW;
+    pip_desc.depth = {.pixel_format = SG_PIXELFORMAT_DEPTH_STENCIL,
+                      .compare = SG_COMPAREFUNC_LESS_EQUAL,
+                      .write_enabled = true};
+    pip_desc.color_count = eng._config.use_mrt ? 3 : 1;
+    pip_desc.sample_count = sg_query_features().msaa_render_targets ? eng._config.msaa_samples : 1;
+    pip_desc.label = "terrain pipeline";
+    _pip = rm.get_or_create_pipeline(pip_desc);
+
+    _stats.num_levels = num_levels;
+    _stats.num_tiles = uint32_t(_tiles.size());
+    log_info("terrain: %ux%u samples, %u levels, %u height textures (%.1f MB)", _width, _height, num_levels,
+             _stats.num_tiles, _stats.texture_bytes / 1048576.0);
+    return _pip.id != SG_INVALID_ID;
+}
+
+void Terrain::terminate() {
+    for (const Tile &tile : _tiles) {
+        sg_destroy_image(tile.image);
+    }
+    sg_destroy_buffer(_vertices);
+    sg_destroy_buffer(_indices);
+    _vertices = _indices = {SG_INVALID_ID};
+    _tiles.clear();
+    _node_heights.clear();
+    _nodes_x.clear();
+    _nodes_y.clear();
+    _chunks.clear();
+    _stats = TerrainStats();
+}
+
+AABB Terrain::bounds() const {
+    const math::Vector3f size = {(_width - 1) * params.spacing, (_height - 1) * params.spacing,
+                                 _max_height - _min_height};
+    return {math::Vector3f{size.x * 0.5f, size.y * 0.5f, (_min_height + _max_height) * 0.5f}, size};
+}
+
+void Terrain::node_bounds(uint32_t level, uint32_t x, uint32_t y, math::Vector3f &bbox_min,
+                          math::Vector3f &bbox_max) const {
+    const uint32_t extent = params.grid_resolution << level;
+    const math::Vector2f &heights = _node_heights[level][y * _nodes_x[level] + x];
+    bbox_min = {float(x * extent) * params.spacing, float(y * extent) * params.spacing, heights.x};
+    bbox_max = {float(std::min((x + 1) * extent, _width - 1)) * params.spacing,
+                float(std::min((y + 1) * extent, _height - 1)) * params.spacing, heights.y};
+}
+
+bool Terrain::select(const Selection &sel, uint32_t level, uint32_t x, uint32_t y) {
+    math::Vector3f bbox_min, bbox_max;
+    node_bounds(level, x, y, bbox_min, bbox_max);
+    // culled nodes are done, nothing is drawn in their place
+    if (!intersects(sel.planes, bbox_min, bbox_max)) {
+        return true;
+    }
+    if (!in_range(bbox_min, bbox_max, sel.cam_pos, _ranges[level])) {
+        return false;
+    }
+    if (level == sel.min_level || !in_range(bbox_min, bbox_max, sel.cam_pos, _ranges[level - 1])) {
+        add_chunk(level, x, y, 4);
+        return true;
+    }
+    // the children out of their range are drawn as quarters of this node
+    for (uint32_t quarter = 0; quarter < 4; quarter++) {
+        const uint32_t cx = x * 2 + (quarter & 1), cy = y * 2 + (quarter >> 1);
+        if (cx < _nodes_x[level - 1] && cy < _nodes_y[level - 1] && !select(sel, level - 1, cx, cy)) {
+            add_chunk(level, x, y, quarter);
+        }
+    }
+    return true;
+}
+
+void Terrain::add_chunk(uint32_t level, uint32_t x, uint32_t y, uint32_t quarter) {
+    const uint32_t extent = params.grid_resolution << level;
+    const uint32_t tile = extent <= params.tile_size
+                              ? (y * extent / params.tile_size) * _tiles_x + x * extent / params.tile_size
+                              : uint32_t(_tiles.size()) - 1;
+    _chunks.push_back({x * extent, y * extent, level, quarter, tile});
+}
+
+void Terrain::update(const Camera &cam) {
+    const double start = now_ms();
+    _chunks.clear();
+    if (_tiles.empty()) {
+        return;
+    }
+    const uint32_t num_levels = _stats.num_levels;
+    const uint32_t n = params.grid_resolution;
+    // the ranges double with the levels, the root always in range
+    _ranges.resize(num_levels);
+    float range = std::max(params.lod_distance, 4.5f * n * params.spacing);
+    for (uint32_t level = 0; level < num_levels; level++, range *= 2.0f) {
+        _ranges[level] = level + 1 < num_levels ? range : root_range;
+    }
+    math::Vector4f planes[6];
+    frustum_planes(cam.projection() * cam.inverse_transform(), planes);
+    const math::Matrix4f &cam_tf = cam.transform();
+    Selection sel = {.planes = planes, .cam_pos = {cam_tf(0, 3), cam_tf(1, 3), cam_tf(2, 3)}, .min_level = 0};
+    // over the triangle budget, the finest level is dropped
+    uint32_t num_triangles = 0;
+    for (;; sel.min_level++) {
+        _chunks.clear();
+        select(sel, num_levels - 1, 0, 0);
+        num_triangles = 0;
+        for (const Chunk &c : _chunks) {
+            num_triangles += c.quarter == 4 ? 2 * n * n : n * n / 2;
+        }
+        if (num_triangles <= params.triangle_budget || sel.min_level + 1 >= num_levels) {
+            break;
+        }
+    }
+    // fewer bindings
+    std::sort(_chunks.begin(), _chunks.end(), [](const Chunk &a, const Chunk &b) { return a.tile < b.tile; });
+    _stats.num_chunks = uint32_t(_chunks.size());
+    _stats.num_triangles = num_triangles;
+    _stats.min_level = sel.min_level;
+    _stats.select_ms = now_ms() - start;
+}
+
+void Terrain::draw(const Camera &cam) {
+    _stats.num_draws = 0;
+    if (_chunks.empty()) {
+        return;
+    }
+    const uint32_t n = params.grid_resolution;
+    const math::Matrix4f &cam_tf = cam.transform();
+    terrain_params_t terrain = {
+        .view_projection = cam.projection() * cam.inverse_transform(),
+        .camera_pos = {cam_tf(0, 3), cam_tf(1, 3), cam_tf(2, 3), 1.0f},
+        .terrain = {params.spacing, _min_height, _max_height - _min_height, float(n)},
+        .data_size = {float(_width - 1), float(_height - 1), 0.0f, 0.0f},
+        .light_pos = {light_pos.x, light_pos.y, light_pos.z, 1.0f}};
+    sg_apply_pipeline(_pip);
+    sg_apply_uniforms(SG_SHADERSTAGE_VS, SLOT_terrain_params, SG_RANGE(terrain));
+    sg_apply_uniforms(SG_SHADERSTAGE_FS, SLOT_terrain_params, SG_RANGE(terrain));
+    sg_bindings bind = {0};
+    bind.vertex_buffers[0] = _vertices;
+    bind.index_buffer = _indices;
+    const int quarter_indices = int(n * n / 4 * 6);
+    uint32_t bound_tile = uint32_t(-1);
+    for (const Chunk &c : _chunks) {
+        const Tile &tile = _tiles[c.tile];
+        if (c.tile != bound_tile) {
+            bind.vs_images[SLOT_height_tex] = tile.image;
+            sg_apply_bindings(bind);
+            bound_tile = c.tile;
+        }
+        // the morph ends with the range of the level, starting past the range of the finer one
+        const float end = _ranges[c.level];
+        const float prev = c.level > 0 ? _ranges[c.level - 1] : 0.0f;
+        const float start = end >= root_range ? root_range : prev + (end - prev) * params.morph_start;
+        chunk_params_t chunk = {.node = {float(c.x), float(c.y), float(n << c.level), 0.0f},
+                                .morph = {start, end >= root_range ? 2.0f * root_range : end, 0.0f, 0.0f},
+                                .tile = {float(tile.x), float(tile.y), float(tile.step), 0.0f}};
+        sg_apply_uniforms(SG_SHADERSTAGE_VS, SLOT_chunk_params, SG_RANGE(chunk));
+        if (c.quarter == 4) {
+            sg_draw(0, quarter_indices * 4, 1);
+        } else {
+            sg_draw(quarter_indices * int(c.quarter), quarter_indices, 1);
+        }
+        _stats.num_draws++;
+    }
+}
+
+} // namespace glengine
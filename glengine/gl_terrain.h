@@ -0,0 +1,117 @@
+#pragma once
+
+#include "gl_utils.h"
+#include "math/vmath.h"
+
+#include "sokol_gfx.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace glengine {
+
+class Camera;
+class GLEngine;
+
+/// heights of a terrain, quantized to 16 bits: the height of a sample s is min_height + s / 65535 * (max_height -
+/// min_height)
+struct Heightmap {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint16_t> samples; ///< row major
+    float min_height = 0.0f;
+    float max_height = 1.0f;
+};
+
+/// grayscale png, 16 or 8 bits, with heights from 0 to 1
+bool load_heightmap_png(const char *filename, Heightmap &heightmap);
+/// raw 32 bit floats, row major, with heights in world units
+bool load_heightmap_raw(const char *filename, uint32_t width, uint32_t height, Heightmap &heightmap);
+
+struct TerrainParams {
+    float spacing = 1.0f;                ///< between the samples, in world units
+    uint32_t grid_resolution = 64;       ///< cells per side of the chunks, a power of two (used by init)
+    uint32_t tile_size = 2048;           ///< samples per side of the height textures, a power of two (used by init)
+    float lod_distance = 0.0f;           ///< range of the finest level, doubled by each level (see Terrain)
+    float morph_start = 0.66f;           ///< fraction of the range of a level where the morph to the next one starts
+    uint32_t triangle_budget = 4000000;  ///< the finest levels are skipped until the chunks fit in it
+};
+
+struct TerrainStats {
+    uint32_t num_chunks = 0; ///< selected by the last update, whole or a quarter of a node
+    uint32_t num_triangles = 0;
+    uint32_t num_draws = 0;  ///< of the last frame
+    uint32_t num_levels = 0;
+    uint32_t min_level = 0;  ///< finest level of the last update, above 0 when over the triangle budget
+    uint32_t num_tiles = 0;  ///< height textures, the tiles and the overview
+    uint64_t texture_bytes = 0;
+    double select_ms = 0.0;
+};
+
+/// large heightmaps, with a continuous level of detail (CDLOD, see "Continuous Distance-Dependent Level of Detail for
+/// Rendering Heightmaps", F. Strugar). The heightmap is split in square tiles uploaded as 16 bit textures (the nodes
+/// too large for a tile use an overview with a sample every few), each with an apron of one texel so that the normals
+/// are continuous across the tiles, and covered by a quadtree of nodes, the leaves having the cells of the grid at the
+/// resolution of the heightmap. Each frame the nodes are selected by their distance from the camera, within the range
+/// of their level, and culled against the frustum. Every chunk is drawn with the same grid mesh, its heights fetched
+/// from the textures in the vertex shader, and its vertices morph to the grid of the next level before reaching the end
+/// of the range, so that there is neither popping nor cracks. The ranges are raised to 4.5 times the leaves when
+/// smaller, the minimum that keeps the morph continuous. The terrain spans from the origin to (width - 1, height - 1) *
+/// spacing, on the xy plane
+class Terrain {
+  public:
+    bool init(GLEngine &eng, const Heightmap &heightmap);
+    void terminate();
+
+    /// select the chunks seen by the camera (cpu only)
+    void update(const Camera &cam);
+    /// draw the selected chunks in the current pass
+    void draw(const Camera &cam);
+
+    AABB bounds() const;
+    const TerrainStats &stats() const { return _stats; }
+
+    TerrainParams params;
+    math::Vector3f light_pos = {100.0f, 100.0f, 100.0f}; ///< in world space, as the one of the diffuse material
+
+  private:
+    struct Tile {
+        sg_image image = {SG_INVALID_ID};
+        uint32_t x = 0, y = 0; ///< first sample
+        uint32_t step = 1;     ///< samples between the texels
+    };
+    struct Chunk {
+        uint32_t x, y;   ///< first sample of the node
+        uint32_t level;
+        uint32_t quarter; ///< 0-3, or 4 for the whole node
+        uint32_t tile;
+    };
+    struct Selection {
+        const math::Vector4f *planes;
+        math::Vector3f cam_pos;
+        uint32_t min_level;
+    };
+
+    /// extents of the node on the xy plane and between its min and max heights, in world space
+    void node_bounds(uint32_t level, uint32_t x, uint32_t y, math::Vector3f &bbox_min, math::Vector3f &bbox_max) const;
+    /// false when the node is out of the range of its level, so that its parent covers it
+    bool select(const Selection &sel, uint32_t level, uint32_t x, uint32_t y);
+    void add_chunk(uint32_t level, uint32_t x, uint32_t y, uint32_t quarter);
+
+    sg_pipeline _pip = {SG_INVALID_ID};
+    sg_buffer _vertices = {SG_INVALID_ID};
+    sg_buffer _indices = {SG_INVALID_ID};
+    std::vector<Tile> _tiles; ///< the overview is the last one, when there is one
+    uint32_t _tiles_x = 0;
+    uint32_t _width = 0, _height = 0;
+    float _min_height = 0.0f, _max_height = 0.0f;
+    /// min and max heights of the nodes of each level, level 0 having the leaves
+    std::vector<std::vector<math::Vector2f>> _node_heights;
+    std::vector<uint32_t> _nodes_x; ///< nodes per row, of each level
+    std::vector<uint32_t> _nodes_y;
+    std::vector<float> _ranges;
+    std::vector<Chunk> _chunks;
+    TerrainStats _stats;
+};
+
+} // namespace glengine
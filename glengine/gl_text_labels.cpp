@@ -0,0 +1,360 @@
+#include "gl_text_labels.h"
+
+#include "gl_camera.h"
+#include "gl_engine.h"
+#include "gl_logger.h"
+#include "generated/shaders/text_labels.glsl.h"
+
+#include "imgui/imgui.h"
+
+// own copy of the stb_truetype implementation vendored with imgui (imgui_draw.cpp keeps its functions static too)
+#if defined(__GNUC__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#endif
+#define STBTT_STATIC
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "imgui/imstb_truetype.h"
+#if defined(__GNUC__)
+#pragma GCC diagnostic pop
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+constexpr uint32_t atlas_size = 512;
+constexpr int cell_size = 4; ///< of the overlap culling grid, in pixels
+
+uint16_t unorm16(float v) {
+    return uint16_t(std::min(std::max(v, 0.0f), 1.0f) * 65535.0f + 0.5f);
+}
+
+bool read_file(const char *filename, std::vector<uint8_t> &data) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) {
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    const long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    bool ok = size > 0;
+    if (ok) {
+        data.resize(size_t(size));
+        ok = fread(data.data(), 1, data.size(), f) == data.size();
+    }
+    fclose(f);
+    return ok;
+}
+
+} // namespace
+
+namespace glengine {
+
+bool TextLabels::load_font(const char *ttf_file, float pixel_height) {
+    std::vector<uint8_t> ttf;
+    if (ttf_file && !read_file(ttf_file, ttf)) {
+        log_error("text labels: unable to read font '%s', using the default one", ttf_file);
+        ttf_file = nullptr;
+    }
+    _atlas_width = _atlas_height = atlas_size;
+    _atlas.assign(_atlas_width * _atlas_height, 0);
+    if (ttf_file) {
+        // glyphs packed with 2x2 oversampling, for smoother text at fractional positions
+        stbtt_fontinfo font;
+        stbtt_packedchar packed[num_chars];
+        stbtt_pack_context ctx;
+        bool ok = stbtt_InitFont(&font, ttf.data(), stbtt_GetFontOffsetForIndex(ttf.data(), 0)) &&
+                  stbtt_PackBegin(&ctx, _atlas.data(), int(_atlas_width), int(_atlas_height), 0, 1, nullptr);
+        if (ok) {
+            stbtt_PackSetOversampling(&ctx, 2, 2);
+            ok = stbtt_PackFontRange(&ctx, ttf.data(), 0, pixel_height, first_char, num_chars, packed);
+            stbtt_PackEnd(&ctx);
+        }
+        if (!ok) {
+            log_error("text labels: unable to rasterize font '%s'", ttf_file);
+            return load_font(nullptr, pixel_height);
+        }
+        int ascent, descent, line_gap;
+        stbtt_GetFontVMetrics(&font, &ascent, &descent, &line_gap);
+        const float scale = stbtt_ScaleForPixelHeight(&font, pixel_height);
+        _line_height = (ascent - descent) * scale;
+        for (int i = 0; i < num_chars; i++) {
+            // quads are relative to the baseline, moved to the top of the line
+            float x = 0.0f, y = ascent * scale;
+            stbtt_aligned_quad q;
+            stbtt_GetPackedQuad(packed, int(_atlas_width), int(_atlas_height), i, &x, &y, &q, 0);
+            _glyphs[i] = {q.x0, q.y0, q.x1, q.y1, {unorm16(q.s0), unorm16(q.t0), unorm16(q.s1), unorm16(q.t1)}, x};
+        }
+    } else {
+        // the fonts embedded in imgui are compressed, the atlas builder of imgui (stb_truetype as well) unpacks them
+        ImFontAtlas atlas;
+        ImFontConfig config;
+        config.SizePixels = std::round(pixel_height);
+        ImFont *font = atlas.AddFontDefault(&config);
+        unsigned char *pixels = nullptr;
+        int w = 0, h = 0;
+        atlas.GetTexDataAsAlpha8(&pixels, &w, &h);
+        if (!pixels) {
+            log_error("text labels: unable to build the default font");
+            return false;
+        }
+        _atlas_width = uint32_t(w);
+        _atlas_height = uint32_t(h);
+        _atlas.assign(pixels, pixels + w * h);
+        _line_height = font->FontSize;
+        for (int i = 0; i < num_chars; i++) {
+            const ImFontGlyph *g = font->FindGlyphNoFallback(ImWchar(first_char + i));
+            _glyphs[i] = g ? Glyph{g->X0, g->Y0, g->X1, g->Y1,
+                                   {unorm16(g->U0), unorm16(g->V0), unorm16(g->U1), unorm16(g->V1)}, g->AdvanceX}
+                           : Glyph{};
+        }
+    }
+    if (_eng) {
+        create_atlas_image();
+    }
+    return true;
+}
+
+void TextLabels::create_atlas_image() {
+    sg_destroy_image(_image);
+    sg_image_desc desc = {0};
+    desc.width = int(_atlas_width);
+    desc.height = int(_atlas_height);
+    desc.pixel_format = SG_PIXELFORMAT_R8;
+    desc.min_filter = SG_FILTER_LINEAR;
+    desc.mag_filter = SG_FILTER_LINEAR;
+    desc.wrap_u = SG_WRAP_CLAMP_TO_EDGE;
+    desc.wrap_v = SG_WRAP_CLAMP_TO_EDGE;
+    desc.data.subimage[0][0] = {_atlas.data(), _atlas.size()};
+    desc.label = "text-labels-atlas";
+    _image = sg_make_image(desc);
+    _atlas.clear();
+    _atlas.shrink_to_fit();
+}
+
+bool TextLabels::init(GLEngine &eng) {
+    _eng = &eng;
+    if (_line_height == 0.0f) {
+        // the default font is sharp at its native size
+        if (!load_font(nullptr, 13.0f)) {
+            return false;
+        }
+    } else {
+        create_atlas_image();
+    }
+    // quad corners, instanced for each glyph
+    const float corners[] = {0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 1.0f, 1.0f};
+    _corners = sg_make_buffer(
+        (sg_buffer_desc){.size = sizeof(corners), .data = SG_RANGE(corners), .label = "text-labels-corners"});
+
+    sg_pipeline_desc pip_desc = {0};
+    pip_desc.layout.buffers[1].stride = sizeof(GlyphInstance);
+    pip_desc.layout.buffers[1].step_func = SG_VERTEXSTEP_PER_INSTANCE;
+    pip_desc.layout.attrs[ATTR_vs_text_labels_corner] = {.buffer_index = 0, .format = SG_VERTEXFORMAT_FLOAT2};
+    pip_desc.layout.attrs[ATTR_vs_text_labels_glyph_rect] = {
+        .buffer_index = 1, .offset = offsetof(GlyphInstance, rect), .format = SG_VERTEXFORMAT_FLOAT4};
+    pip_desc.layout.attrs[ATTR_vs_text_labels_glyph_uv] = {
+        .buffer_index = 1, .offset = offsetof(GlyphInstance, uv), .format = SG_VERTEXFORMAT_USHORT4N};
+    pip_desc.layout.attrs[ATTR_vs_text_labels_glyph_color] = {
+        .buffer_index = 1, .offset = offsetof(GlyphInstance, color), .format = SG_VERTEXFORMAT_UBYTE4N};
+    pip_desc.shader = eng.resource_manager().get_or_create_shader(*text_labels_shader_desc(sg_query_backend()));
+    pip_desc.primitive_type = SG_PRIMITIVETYPE_TRIANGLE_STRIP;
+    pip_desc.colors[0].blend = {.enabled = true,
+                                .src_factor_rgb = SG_BLENDFACTOR_SRC_ALPHA,
+                                .dst_factor_rgb = SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA};
+    pip_desc.label = "text labels pipeline";
+    _pip = eng.resource_manager().get_or_create_pipeline(pip_desc);
+    return _pip.id != SG_INVALID_ID;
+}
+
+void TextLabels::terminate() {
+    sg_destroy_buffer(_buffer);
+    sg_destroy_buffer(_corners);
+    sg_destroy_image(_image);
+    _buffer = _corners = {SG_INVALID_ID};
+    _image = {SG_INVALID_ID};
+    _capacity = 0;
+    _num_uploaded = 0;
+    // the atlas pixels are gone with the image, the font has to be loaded again
+    _line_height = 0.0f;
+    clear();
+    _eng = nullptr;
+}
+
+void TextLabels::add(const math::Vector3f &pos, const char *text, Color color, float priority) {
+    const uint32_t size = uint32_t(strlen(text));
+    _labels.push_back({pos, uint32_t(_text.size()), size, color, priority, false});
+    _text.insert(_text.end(), text, text + size);
+}
+
+void TextLabels::add_screen(const math::Vector2f &pos, const char *text, Color color) {
+    const uint32_t size = uint32_t(strlen(text));
+    _labels.push_back({{pos.x, pos.y, 0.0f}, uint32_t(_text.size()), size, color, 0.0f, true});
+    _text.insert(_text.end(), text, text + size);
+}
+
+void TextLabels::clear() {
+    _labels.clear();
+    _text.clear();
+}
+
+float TextLabels::text_width(const Label &label) const {
+    float width = 0.0f;
+    for (uint32_t i = 0; i < label.text_size; i++) {
+        const int c = uint8_t(_text[label.text_offset + i]) - first_char;
+        if (c >= 0 && c < num_chars) {
+            width += _glyphs[c].advance;
+        }
+    }
+    return width;
+}
+
+void TextLabels::emit(const Label &label, float x, float y, uint8_t alpha) {
+    const Color color = {label.color.r, label.color.g, label.color.b, uint8_t(label.color.a * alpha / 255)};
+    for (uint32_t i = 0; i < label.text_size; i++) {
+        const int c = uint8_t(_text[label.text_offset + i]) - first_char;
+        if (c < 0 || c >= num_chars) {
+            continue;
+        }
+        const Glyph &g = _glyphs[c];
+        if (g.x1 > g.x0 && g.y1 > g.y0) {
+            _instances.push_back({{x + g.x0, y + g.y0, g.x1 - g.x0, g.y1 - g.y0},
+                                  {g.uv[0], g.uv[1], g.uv[2], g.uv[3]},
+                                  color});
+        }
+        x += g.advance;
+    }
+}
+
+void TextLabels::layout(const math::Matrix4f &view_projection, const math::Vector3f &cam_pos, float width,
+                        float height) {
+    const double start = now_ms();
+    _stats = TextLabelStats();
+    _stats.num_labels = uint32_t(_labels.size());
+    _instances.clear();
+    _candidates.clear();
+    // world labels in front of the camera, on screen and not faded out
+    const float fade_range = std::max(params.fade_end - params.fade_start, 1e-6f);
+    for (uint32_t i = 0; i < _labels.size(); i++) {
+        const Label &label = _labels[i];
+        if (label.screen) {
+            continue;
+        }
+        const math::Vector4f clip = view_projection * math::Vector4f{label.pos.x, label.pos.y, label.pos.z, 1.0f};
+        if (clip.w <= 1e-6f) {
+            continue;
+        }
+        const float distance = math::length(label.pos - cam_pos);
+        const float fade = std::min((params.fade_end - distance) / fade_range, 1.0f);
+        if (fade <= 0.0f) {
+            continue;
+        }
+        const float label_width = text_width(label);
+        // centered on the anchor, and snapped to whole pixels so that the glyphs stay sharp
+        const float x = std::round((clip.x / clip.w * 0.5f + 0.5f) * width - label_width * 0.5f);
+        const float y = std::round((0.5f - clip.y / clip.w * 0.5f) * height - _line_height * 0.5f);
+        if (x + label_width < 0.0f || x > width || y + _line_height < 0.0f || y > height) {
+            continue;
+        }
+        _candidates.push_back({i, x, y, label_width, label.priority, distance, uint8_t(fade * 255.0f)});
+    }
+    if (params.cull_overlaps) {
+        // greedy: the labels are placed by priority and distance, and hidden if they hit the cells of a placed one
+        std::sort(_candidates.begin(), _candidates.end(), [](const Candidate &a, const Candidate &b) {
+            return a.priority != b.priority ? a.priority > b.priority : a.distance < b.distance;
+        });
+        const int grid_w = int(width) / cell_size + 1;
+        const int grid_h = int(height) / cell_size + 1;
+        _occupancy.assign(size_t(grid_w * grid_h), 0);
+        size_t placed = 0;
+        for (const Candidate &c : _candidates) {
+            const int x0 = std::max(int(c.x) / cell_size, 0);
+            const int x1 = std::min(int(c.x + c.width) / cell_size, grid_w - 1);
+            const int y0 = std::max(int(c.y) / cell_size, 0);
+            const int y1 = std::min(int(c.y + _line_height) / cell_size, grid_h - 1);
+            bool free = true;
+            for (int y = y0; y <= y1 && free; y++) {
+                const uint8_t *row = &_occupancy[size_t(y * grid_w)];
+                free = std::find(row + x0, row + x1 + 1, 1) == row + x1 + 1;
+            }
+            if (!free) {
+                _stats.num_culled++;
+                continue;
+            }
+            for (int y = y0; y <= y1; y++) {
+                std::fill_n(&_occupancy[size_t(y * grid_w + x0)], x1 - x0 + 1, 1);
+            }
+            _candidates[placed++] = c;
+        }
+        _candidates.resize(placed);
+    }
+    for (const Candidate &c : _candidates) {
+        emit(_labels[c.label], c.x, c.y, c.alpha);
+    }
+    _stats.num_visible = uint32_t(_candidates.size());
+    // screen labels, on top of the world ones
+    for (const Label &label : _labels) {
+        if (label.screen) {
+            emit(label, label.pos.x, label.pos.y, 255);
+            _stats.num_visible++;
+        }
+    }
+    _stats.num_glyphs = uint32_t(_instances.size());
+    _stats.layout_ms = now_ms() - start;
+}
+
+void TextLabels::upload(const Camera &cam, float width, float height) {
+    _num_uploaded = 0;
+    _viewport = {width, height};
+    if (_labels.empty()) {
+        _stats = TextLabelStats();
+        return;
+    }
+    layout(cam.projection() * cam.inverse_transform(), cam.transform() * math::Vector3f{0.0f, 0.0f, 0.0f}, width,
+           height);
+    clear();
+    if (_instances.empty()) {
+        return;
+    }
+    // the buffer only grows, to the next power of two
+    if (_instances.size() > _capacity) {
+        uint32_t capacity = std::max<uint32_t>(_capacity, 1024);
+        while (capacity < _instances.size()) {
+            capacity *= 2;
+        }
+        sg_destroy_buffer(_buffer);
+        _buffer = sg_make_buffer((sg_buffer_desc){.size = capacity * sizeof(GlyphInstance),
+                                                  .type = SG_BUFFERTYPE_VERTEXBUFFER,
+                                                  .usage = SG_USAGE_STREAM,
+                                                  .label = "text-labels-glyphs"});
+        _capacity = capacity;
+    }
+    sg_update_buffer(_buffer, {_instances.data(), _instances.size() * sizeof(GlyphInstance)});
+    _num_uploaded = uint32_t(_instances.size());
+}
+
+void TextLabels::draw() {
+    if (_num_uploaded == 0) {
+        return;
+    }
+    sg_apply_pipeline(_pip);
+    sg_bindings bind = {0};
+    bind.vertex_buffers[0] = _corners;
+    bind.vertex_buffers[1] = _buffer;
+    bind.fs_images[SLOT_tex_atlas] = _image;
+    sg_apply_bindings(bind);
+    text_labels_params_t text_params = {.viewport = {_viewport.x, _viewport.y, 0.0f, 0.0f}};
+    sg_apply_uniforms(SG_SHADERSTAGE_VS, SLOT_text_labels_params, SG_RANGE(text_params));
+    sg_draw(0, 4, _num_uploaded);
+}
+
+} // namespace glengine
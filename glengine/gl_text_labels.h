@@ -0,0 +1,125 @@
+#pragma once
+
+#include "gl_types.h"
+#include "math/vmath.h"
+
+#include "sokol_gfx.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace glengine {
+
+class Camera;
+class GLEngine;
+
+struct TextLabelParams {
+    float fade_start = 50.0f; ///< distance from the camera where world labels start to fade out
+    float fade_end = 100.0f;  ///< distance from the camera beyond which world labels are hidden
+    bool cull_overlaps = true; ///< hide the labels overlapping a label with a higher priority, or closer
+};
+
+struct TextLabelStats {
+    uint32_t num_labels = 0;  ///< added for the last frame
+    uint32_t num_visible = 0; ///< drawn by the last frame
+    uint32_t num_culled = 0;  ///< hidden by overlap culling
+    uint32_t num_glyphs = 0;  ///< instances drawn by the last frame
+    double layout_ms = 0.0;
+};
+
+/// batched text annotations (see GLEngine::text_labels): labels are anchored to a world position (centered on its
+/// projection) or to a screen position, and drawn with a constant size in pixels on top of the final image. As with
+/// DebugDraw, the labels added during a frame are drawn by the next GLEngine::render() and discarded. The glyphs of
+/// all the labels are laid out on the cpu into a buffer of quad instances, drawn with a single instanced draw call.
+/// Only the printable ascii characters are supported, on a single line
+class TextLabels {
+  public:
+    /// quad of a glyph, in pixels from the top left corner of the screen
+    struct GlyphInstance {
+        float rect[4];    ///< x, y, width, height
+        uint16_t uv[4];   ///< u0, v0, u1, v1, normalized
+        Color color;
+    };
+
+    bool init(GLEngine &eng);
+    void terminate();
+
+    /// rasterize the glyph atlas from a ttf file, or from the embedded ImGui font (ProggyClean) when null. Can be
+    /// called before init (i.e. without a gpu, see benchmark_text_labels)
+    bool load_font(const char *ttf_file = nullptr, float pixel_height = 16.0f);
+
+    /// label centered on the projection of a world position. Higher priorities win overlap culling, closer labels win
+    /// among the same priority
+    void add(const math::Vector3f &pos, const char *text, Color color = {255, 255, 255, 255}, float priority = 0.0f);
+    /// label with its top left corner at a position in pixels, never faded or culled
+    void add_screen(const math::Vector2f &pos, const char *text, Color color = {255, 255, 255, 255});
+    void clear();
+
+    /// lay out the labels into glyph instances, for a viewport of the given size in pixels (cpu only)
+    void layout(const math::Matrix4f &view_projection, const math::Vector3f &cam_pos, float width, float height);
+    /// lay out and upload the labels, and discard them. Has to be called outside of the passes
+    void upload(const Camera &cam, float width, float height);
+    /// draw the uploaded labels in the current pass
+    void draw();
+
+    const std::vector<GlyphInstance> &instances() const { return _instances; }
+    const TextLabelStats &stats() const { return _stats; }
+    float line_height() const { return _line_height; }
+
+    TextLabelParams params;
+
+  private:
+    /// printable ascii, from ' ' to '~'
+    static constexpr int first_char = 32;
+    static constexpr int num_chars = 95;
+    struct Glyph {
+        float x0, y0, x1, y1; ///< quad from the pen position, at the top of the line
+        uint16_t uv[4];
+        float advance;
+    };
+    struct Label {
+        math::Vector3f pos;
+        uint32_t text_offset; ///< in _text
+        uint32_t text_size;
+        Color color;
+        float priority;
+        bool screen;
+    };
+
+    float text_width(const Label &label) const;
+    void emit(const Label &label, float x, float y, uint8_t alpha);
+    void create_atlas_image();
+
+    GLEngine *_eng = nullptr;
+    Glyph _glyphs[num_chars] = {};
+    float _line_height = 0.0f;
+    uint32_t _atlas_width = 0;
+    uint32_t _atlas_height = 0;
+    std::vector<uint8_t> _atlas; ///< alpha, kept until the image is created
+
+    std::vector<Label> _labels;
+    std::vector<char> _text; ///< of all the labels
+    std::vector<GlyphInstance> _instances;
+    // laid out labels
+    struct Candidate {
+        uint32_t label;
+        float x, y; ///< top left corner, in pixels
+        float width;
+        float priority;
+        float distance;
+        uint8_t alpha;
+    };
+    std::vector<Candidate> _candidates;
+    std::vector<uint8_t> _occupancy; ///< overlap culling grid
+    TextLabelStats _stats;
+
+    sg_image _image = {SG_INVALID_ID};
+    sg_pipeline _pip = {SG_INVALID_ID};
+    sg_buffer _corners = {SG_INVALID_ID};
+    sg_buffer _buffer = {SG_INVALID_ID};
+    uint32_t _capacity = 0;  ///< instances of the buffer
+    uint32_t _num_uploaded = 0;
+    math::Vector2f _viewport;
+};
+
+} // namespace glengine
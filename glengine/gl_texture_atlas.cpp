@@ -0,0 +1,98 @@
+#include "gl_texture_atlas.h"
+
+#include <algorithm>
+#include <cstring>
+
+// the implementation in imgui_draw.cpp is static
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imgui/imstb_rectpack.h"
+
+namespace glengine {
+
+namespace {
+
+// number of mip levels of an image placed at [begin, end) in a rect [rect_begin, rect_end) of the atlas (along one
+// axis) that don't bleed out of the rect: a texel of level n averages an aligned block of 2^n texels of level 0, and
+// bilinear filtering reads the next texel of the level around the image
+uint32_t levels_within(uint32_t begin, uint32_t end, uint32_t rect_begin, uint32_t rect_end) {
+    uint32_t levels = 0;
+    for (uint32_t block = 1; levels < 16; block *= 2, levels++) {
+        const uint32_t first = begin / block * block;
+        const uint32_t last = (end + block - 1) / block * block;
+        if (first < rect_begin + block || last + block > rect_end) {
+            break;
+        }
+    }
+    return std::max(levels, 1u);
+}
+
+} // namespace
+
+bool build_texture_atlas(const std::vector<AtlasImage> &images, uint32_t max_size, uint32_t padding,
+                         TextureAtlas &atlas) {
+    if (images.empty()) {
+        return false;
+    }
+    // rects are packed on a grid of cells of the smallest power of two not below the padding, and the padding is
+    // rounded up to a cell, so that the images start on the blocks of texels averaged by the coarser mip levels
+    uint32_t cell = 1;
+    while (cell < padding) {
+        cell *= 2;
+    }
+    const uint32_t border = padding > 0 ? cell : 0;
+    std::vector<stbrp_rect> rects(images.size());
+    uint64_t total_area = 0;
+    for (size_t i = 0; i < images.size(); i++) {
+        rects[i] = {};
+        rects[i].id = int(i);
+        rects[i].w = stbrp_coord((images[i].width + 2 * border + cell - 1) / cell);
+        rects[i].h = stbrp_coord((images[i].height + 2 * border + cell - 1) / cell);
+        total_area += uint64_t(rects[i].w) * rects[i].h * cell * cell;
+    }
+    // smallest power of two that can hold the images, doubled until everything fits
+    uint32_t size = 1;
+    while (uint64_t(size) * size < total_area) {
+        size *= 2;
+    }
+    size = std::max(size, cell);
+    bool packed = false;
+    for (; size <= std::min(max_size, 32768u) && !packed; size *= 2) {
+        const uint32_t cells = size / cell;
+        std::vector<stbrp_node> nodes(cells);
+        stbrp_context context;
+        stbrp_init_target(&context, int(cells), int(cells), nodes.data(), int(nodes.size()));
+        packed = stbrp_pack_rects(&context, rects.data(), int(rects.size())) != 0;
+        if (packed) {
+            break;
+        }
+    }
+    if (!packed) {
+        return false;
+    }
+    atlas.width = atlas.height = size;
+    atlas.pixels.assign(size_t(size) * size * 4, 0);
+    atlas.uv_rects.resize(images.size());
+    atlas.max_levels = 16;
+    for (const auto &rect : rects) {
+        const AtlasImage &img = images[rect.id];
+        const uint32_t x0 = rect.x * cell, y0 = rect.y * cell;
+        const uint32_t w = rect.w * cell, h = rect.h * cell;
+        // copy the image, replicating the edge texels in the padding
+        for (uint32_t y = 0; y < h; y++) {
+            const uint32_t sy = uint32_t(std::min(std::max(int(y) - int(border), 0), int(img.height) - 1));
+            uint8_t *dst = atlas.pixels.data() + (size_t(y0 + y) * size + x0) * 4;
+            for (uint32_t x = 0; x < w; x++) {
+                const uint32_t sx = uint32_t(std::min(std::max(int(x) - int(border), 0), int(img.width) - 1));
+                memcpy(dst + x * 4, img.pixels + (size_t(sy) * img.width + sx) * 4, 4);
+            }
+        }
+        const uint32_t ix = x0 + border, iy = y0 + border;
+        atlas.uv_rects[rect.id] = {float(ix) / size, float(iy) / size, float(img.width) / size,
+                                   float(img.height) / size};
+        atlas.max_levels = std::min({atlas.max_levels, levels_within(ix, ix + img.width, x0, x0 + w),
+                                     levels_within(iy, iy + img.height, y0, y0 + h)});
+    }
+    return true;
+}
+
+} // namespace glengine
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "math/vmath_types.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace glengine {
+
+/// rgba8 image to be packed in an atlas (the pixels must stay valid until the atlas is built)
+struct AtlasImage {
+    const uint8_t *pixels = nullptr;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+
+/// rgba8 atlas of rect-packed images
+struct TextureAtlas {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    /// number of mip levels that don't bleed across images, given the padding and the alignment of every image
+    uint32_t max_levels = 1;
+    std::vector<uint8_t> pixels;
+    /// placement of every image, in atlas texture coordinates: offset (x,y) and scale (z,w), so that
+    /// atlas_uv = uv_rect.xy + fract(uv) * uv_rect.zw. The materials wrap the uvs this way, as a repeat sampler
+    /// would, but bilinear filtering across the wrap reads the padding (clamped to the edge) instead of the other side
+    std::vector<math::Vector4f> uv_rects;
+};
+
+/// pack the images in a square power of two atlas, as small as possible and at most max_size wide. The padding
+/// around every image replicates its edge texels, to avoid bleeding with bilinear filtering and the first mip levels.
+/// The images are aligned to the smallest power of two not below the padding, which is rounded up to it
+bool build_texture_atlas(const std::vector<AtlasImage> &images, uint32_t max_size, uint32_t padding,
+                         TextureAtlas &atlas);
+
+} // namespace glengine
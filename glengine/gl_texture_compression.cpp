@@ -0,0 +1,592 @@
+#include "gl_texture_compression.h"
+#include "gl_mipmap.h"
+#include "gl_thread_pool.h"
+#include "gl_utils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+using namespace glengine;
+
+constexpr uint32_t TEXTURE_FILE_MAGIC = 0x58455447; // "GTEX"
+constexpr uint32_t TEXTURE_FILE_VERSION = 1;
+constexpr uint32_t TEXTURE_FILE_SRGB = 1;
+
+struct TextureFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t format;
+    uint32_t flags;
+    uint32_t num_levels;
+    uint32_t reserved;
+};
+
+struct TextureFileLevel {
+    uint32_t width;
+    uint32_t height;
+    uint64_t size;
+};
+
+bool valid_format(uint32_t format) {
+    return format <= uint32_t(TextureFormat::BC5);
+}
+
+uint32_t block_bytes(TextureFormat format) {
+    return (format == TextureFormat::BC1 || format == TextureFormat::BC4) ? 8 : 16;
+}
+
+// 4x4 texels of a block (rgba8, row major), edge texels are replicated for partial blocks
+void load_block(const uint8_t *rgba, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, uint8_t block[64]) {
+    for (uint32_t y = 0; y < 4; y++) {
+        const uint32_t sy = std::min(by * 4 + y, height - 1);
+        for (uint32_t x = 0; x < 4; x++) {
+            const uint32_t sx = std::min(bx * 4 + x, width - 1);
+            memcpy(block + (y * 4 + x) * 4, rgba + (size_t(sy) * width + sx) * 4, 4);
+        }
+    }
+}
+
+void store_block(const uint8_t block[64], uint32_t width, uint32_t height, uint32_t bx, uint32_t by, uint8_t *rgba) {
+    for (uint32_t y = 0; y < 4 && by * 4 + y < height; y++) {
+        for (uint32_t x = 0; x < 4 && bx * 4 + x < width; x++) {
+            memcpy(rgba + (size_t(by * 4 + y) * width + bx * 4 + x) * 4, block + (y * 4 + x) * 4, 4);
+        }
+    }
+}
+
+void write_u16(uint8_t *out, uint16_t v) {
+    out[0] = uint8_t(v & 0xFF);
+    out[1] = uint8_t(v >> 8);
+}
+
+void write_u32(uint8_t *out, uint32_t v) {
+    for (int i = 0; i < 4; i++) {
+        out[i] = uint8_t(v >> (i * 8));
+    }
+}
+
+uint16_t pack_565(const float c[3]) {
+    auto quantize = [](float v, int max) {
+        return int(std::min(std::max(v, 0.0f), 255.0f) * max / 255.0f + 0.5f);
+    };
+    return uint16_t((quantize(c[0], 31) << 11) | (quantize(c[1], 63) << 5) | quantize(c[2], 31));
+}
+
+void unpack_565(uint16_t v, int c[3]) {
+    const int r = (v >> 11) & 31, g = (v >> 5) & 63, b = v & 31;
+    c[0] = (r << 3) | (r >> 2);
+    c[1] = (g << 2) | (g >> 4);
+    c[2] = (b << 3) | (b >> 2);
+}
+
+// palette of a BC1 color block, as decoded by the GPU (rgba)
+void color_palette(uint16_t c0, uint16_t c1, bool four_colors, int palette[4][4]) {
+    unpack_565(c0, palette[0]);
+    unpack_565(c1, palette[1]);
+    for (int c = 0; c < 3; c++) {
+        if (four_colors) {
+            palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+            palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+        } else {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+            palette[3][c] = 0;
+        }
+    }
+    palette[0][3] = palette[1][3] = palette[2][3] = 255;
+    palette[3][3] = four_colors ? 255 : 0;
+}
+
+// nearest palette entry of every texel (four colors mode), returns the packed indices and the total error
+uint32_t color_indices(const uint8_t block[64], uint16_t c0, uint16_t c1, int &error) {
+    int palette[4][4];
+    color_palette(c0, c1, true, palette);
+    uint32_t indices = 0;
+    error = 0;
+    for (int i = 0; i < 16; i++) {
+        int best = 0, best_dist = 1 << 30;
+        for (int p = 0; p < 4; p++) {
+            int dist = 0;
+            for (int c = 0; c < 3; c++) {
+                const int d = int(block[i * 4 + c]) - palette[p][c];
+                dist += d * d;
+            }
+            if (dist < best_dist) {
+                best_dist = dist;
+                best = p;
+            }
+        }
+        indices |= uint32_t(best) << (i * 2);
+        error += best_dist;
+    }
+    return indices;
+}
+
+// least squares endpoints for a given set of indices (interpolation weights 0, 1, 1/3 and 2/3 for indices 0..3)
+bool refine_endpoints(const uint8_t block[64], uint32_t indices, float e0[3], float e1[3]) {
+    static const float weights[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+    float aa = 0, bb = 0, ab = 0;
+    float ax[3] = {0, 0, 0}, bx[3] = {0, 0, 0};
+    for (int i = 0; i < 16; i++) {
+        const float t = weights[(indices >> (i * 2)) & 3];
+        aa += (1 - t) * (1 - t);
+        bb += t * t;
+        ab += (1 - t) * t;
+        for (int c = 0; c < 3; c++) {
+            ax[c] += (1 - t) * block[i * 4 + c];
+            bx[c] += t * block[i * 4 + c];
+        }
+    }
+    const float det = aa * bb - ab * ab;
+    if (std::fabs(det) < 1e-6f) {
+        return false;
+    }
+    for (int c = 0; c < 3; c++) {
+        e0[c] = (ax[c] * bb - bx[c] * ab) / det;
+        e1[c] = (bx[c] * aa - ax[c] * ab) / det;
+    }
+    return true;
+}
+
+// BC1 color block (always four colors mode): endpoints along the principal axis of the texel colors, inset to
+// reduce the error at the extremes, then refined with a least squares fit on the selected indices
+void encode_color_block(const uint8_t block[64], uint8_t out[8]) {
+    float mean[3] = {0, 0, 0};
+    for (int i = 0; i < 16; i++) {
+        for (int c = 0; c < 3; c++) {
+            mean[c] += block[i * 4 + c] / 16.0f;
+        }
+    }
+    float cov[3][3] = {};
+    for (int i = 0; i < 16; i++) {
+        float d[3] = {block[i * 4] - mean[0], block[i * 4 + 1] - mean[1], block[i * 4 + 2] - mean[2]};
+        for (int r = 0; r < 3; r++) {
+            for (int c = 0; c < 3; c++) {
+                cov[r][c] += d[r] * d[c];
+            }
+        }
+    }
+    // principal axis with a few steps of power iteration
+    float axis[3] = {1.0f, 1.0f, 1.0f};
+    for (int iter = 0; iter < 8; iter++) {
+        float next[3];
+        for (int r = 0; r < 3; r++) {
+            next[r] = cov[r][0] * axis[0] + cov[r][1] * axis[1] + cov[r][2] * axis[2];
+        }
+        const float len = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+        if (len < 1e-6f) {
+            break;
+        }
+        for (int c = 0; c < 3; c++) {
+            axis[c] = next[c] / len;
+        }
+    }
+    float tmin = 0.0f, tmax = 0.0f;
+    for (int i = 0; i < 16; i++) {
+        const float t = (block[i * 4] - mean[0]) * axis[0] + (block[i * 4 + 1] - mean[1]) * axis[1] +
+                        (block[i * 4 + 2] - mean[2]) * axis[2];
+        tmin = std::min(tmin, t);
+        tmax = std::max(tmax, t);
+    }
+    const float inset = (tmax - tmin) / 16.0f;
+    float e0[3], e1[3];
+    for (int c = 0; c < 3; c++) {
+        e0[c] = mean[c] + axis[c] * (tmax - inset);
+        e1[c] = mean[c] + axis[c] * (tmin + inset);
+    }
+    uint16_t c0 = pack_565(e0), c1 = pack_565(e1);
+    int error;
+    uint32_t indices = color_indices(block, c0, c1, error);
+    for (int iter = 0; iter < 2 && error > 0; iter++) {
+        if (!refine_endpoints(block, indices, e0, e1)) {
+            break;
+        }
+        const uint16_t r0 = pack_565(e0), r1 = pack_565(e1);
+        int refined_error;
+        const uint32_t refined = color_indices(block, r0, r1, refined_error);
+        if (refined_error >= error) {
+            break;
+        }
+        c0 = r0;
+        c1 = r1;
+        indices = refined;
+        error = refined_error;
+    }
+    // the four colors mode requires c0 > c1: swapping the endpoints swaps indices 0<->1 and 2<->3
+    if (c0 < c1) {
+        std::swap(c0, c1);
+        indices ^= 0x55555555u;
+    } else if (c0 == c1) {
+        indices = 0;
+    }
+    write_u16(out, c0);
+    write_u16(out + 2, c1);
+    write_u32(out + 4, indices);
+}
+
+void channel_palette(int r0, int r1, int palette[8]) {
+    palette[0] = r0;
+    palette[1] = r1;
+    if (r0 > r1) {
+        for (int i = 2; i < 8; i++) {
+            palette[i] = ((8 - i) * r0 + (i - 1) * r1) / 7;
+        }
+    } else {
+        for (int i = 2; i < 6; i++) {
+            palette[i] = ((6 - i) * r0 + (i - 1) * r1) / 5;
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+// BC4 block (also the alpha block of BC3 and each half of BC5): min/max endpoints in eight values mode
+void encode_channel_block(const uint8_t block[64], int channel, uint8_t out[8]) {
+    int vmin = 255, vmax = 0;
+    for (int i = 0; i < 16; i++) {
+        vmin = std::min(vmin, int(block[i * 4 + channel]));
+        vmax = std::max(vmax, int(block[i * 4 + channel]));
+    }
+    out[0] = uint8_t(vmax);
+    out[1] = uint8_t(vmin);
+    uint64_t indices = 0;
+    if (vmax > vmin) {
+        int palette[8];
+        channel_palette(vmax, vmin, palette);
+        for (int i = 0; i < 16; i++) {
+            const int v = block[i * 4 + channel];
+            int best = 0, best_dist = 256;
+            for (int p = 0; p < 8; p++) {
+                const int dist = std::abs(v - palette[p]);
+                if (dist < best_dist) {
+                    best_dist = dist;
+                    best = p;
+                }
+            }
+            indices |= uint64_t(best) << (i * 3);
+        }
+    }
+    for (int i = 0; i < 6; i++) {
+        out[2 + i] = uint8_t(indices >> (i * 8));
+    }
+}
+
+void decode_color_block(const uint8_t in[8], bool force_four_colors, uint8_t block[64]) {
+    const uint16_t c0 = uint16_t(in[0] | (in[1] << 8));
+    const uint16_t c1 = uint16_t(in[2] | (in[3] << 8));
+    const uint32_t indices = uint32_t(in[4]) | (uint32_t(in[5]) << 8) | (uint32_t(in[6]) << 16) |
+                             (uint32_t(in[7]) << 24);
+    int palette[4][4];
+    color_palette(c0, c1, force_four_colors || c0 > c1, palette);
+    for (int i = 0; i < 16; i++) {
+        const int p = (indices >> (i * 2)) & 3;
+        for (int c = 0; c < 4; c++) {
+            block[i * 4 + c] = uint8_t(palette[p][c]);
+        }
+    }
+}
+
+void decode_channel_block(const uint8_t in[8], int channel, uint8_t block[64]) {
+    int palette[8];
+    channel_palette(in[0], in[1], palette);
+    uint64_t indices = 0;
+    for (int i = 0; i < 6; i++) {
+        indices |= uint64_t(in[2 + i]) << (i * 8);
+    }
+    for (int i = 0; i < 16; i++) {
+        block[i * 4 + channel] = uint8_t(palette[(indices >> (i * 3)) & 7]);
+    }
+}
+
+void compress_block_rows(TextureFormat format, const uint8_t *rgba, uint32_t width, uint32_t height, uint8_t *blocks,
+                         uint32_t by0, uint32_t by1) {
+    const uint32_t blocks_x = (width + 3) / 4;
+    const uint32_t bytes = block_bytes(format);
+    uint8_t block[64];
+    for (uint32_t by = by0; by < by1; by++) {
+        for (uint32_t bx = 0; bx < blocks_x; bx++) {
+            load_block(rgba, width, height, bx, by, block);
+            uint8_t *out = blocks + (size_t(by) * blocks_x + bx) * bytes;
+            switch (format) {
+            case TextureFormat::BC1:
+                encode_color_block(block, out);
+                break;
+            case TextureFormat::BC3:
+                encode_channel_block(block, 3, out);
+                encode_color_block(block, out + 8);
+                break;
+            case TextureFormat::BC4:
+                encode_channel_block(block, 0, out);
+                break;
+            case TextureFormat::BC5:
+                encode_channel_block(block, 0, out);
+                encode_channel_block(block, 1, out + 8);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+}
+
+} // namespace
+
+namespace glengine {
+
+const char *texture_format_name(TextureFormat format) {
+    switch (format) {
+    case TextureFormat::RGBA8:
+        return "rgba8";
+    case TextureFormat::BC1:
+        return "bc1";
+    case TextureFormat::BC3:
+        return "bc3";
+    case TextureFormat::BC4:
+        return "bc4";
+    case TextureFormat::BC5:
+        return "bc5";
+    }
+    return "unknown";
+}
+
+size_t texture_level_size(TextureFormat format, uint32_t width, uint32_t height) {
+    if (format == TextureFormat::RGBA8) {
+        return size_t(width) * height * 4;
+    }
+    return size_t((width + 3) / 4) * ((height + 3) / 4) * block_bytes(format);
+}
+
+void compress_image(TextureFormat format, const uint8_t *rgba, uint32_t width, uint32_t height, uint8_t *blocks) {
+    if (format == TextureFormat::RGBA8) {
+        memcpy(blocks, rgba, texture_level_size(format, width, height));
+        return;
+    }
+    compress_block_rows(format, rgba, width, height, blocks, 0, (height + 3) / 4);
+}
+
+void decompress_image(TextureFormat format, const uint8_t *blocks, uint32_t width, uint32_t height, uint8_t *rgba) {
+    if (format == TextureFormat::RGBA8) {
+        memcpy(rgba, blocks, texture_level_size(format, width, height));
+        return;
+    }
+    const uint32_t blocks_x = (width + 3) / 4;
+    const uint32_t blocks_y = (height + 3) / 4;
+    const uint32_t bytes = block_bytes(format);
+    uint8_t block[64];
+    for (uint32_t by = 0; by < blocks_y; by++) {
+        for (uint32_t bx = 0; bx < blocks_x; bx++) {
+            const uint8_t *in = blocks + (size_t(by) * blocks_x + bx) * bytes;
+            switch (format) {
+            case TextureFormat::BC1:
+                decode_color_block(in, false, block);
+                break;
+            case TextureFormat::BC3:
+                decode_color_block(in + 8, true, block);
+                decode_channel_block(in, 3, block);
+                break;
+            case TextureFormat::BC4:
+            case TextureFormat::BC5:
+                for (int i = 0; i < 16; i++) {
+                    block[i * 4 + 1] = block[i * 4 + 2] = 0;
+                    block[i * 4 + 3] = 255;
+                }
+                decode_channel_block(in, 0, block);
+                if (format == TextureFormat::BC5) {
+                    decode_channel_block(in + 8, 1, block);
+                }
+                break;
+            default:
+                break;
+            }
+            store_block(block, width, height, bx, by, rgba);
+        }
+    }
+}
+
+bool compress_mip_chain(const MipChain &chain, TextureFormat format, bool srgb, CompressedImage &image,
+                        bool parallel) {
+    if (chain.num_levels == 0) {
+        return false;
+    }
+    image.format = format;
+    image.srgb = srgb;
+    image.num_levels = std::min(chain.num_levels, CompressedImage::MAX_LEVELS);
+    size_t total_size = 0;
+    for (uint32_t level = 0; level < image.num_levels; level++) {
+        const auto &src = chain.levels[level];
+        image.levels[level] = {src.width, src.height, total_size, texture_level_size(format, src.width, src.height)};
+        total_size += image.levels[level].size;
+    }
+    image.data.resize(total_size);
+    for (uint32_t level = 0; level < image.num_levels; level++) {
+        const auto &lvl = image.levels[level];
+        const uint8_t *src = chain.level_data(level);
+        uint8_t *dst = image.level_data(level);
+        const uint32_t blocks_y = (lvl.height + 3) / 4;
+        if (format == TextureFormat::RGBA8) {
+            memcpy(dst, src, lvl.size);
+        } else if (parallel && blocks_y >= 32) {
+            parallel_for(0, blocks_y, 8, [&](uint32_t by0, uint32_t by1) {
+                compress_block_rows(format, src, lvl.width, lvl.height, dst, by0, by1);
+            });
+        } else {
+            compress_block_rows(format, src, lvl.width, lvl.height, dst, 0, blocks_y);
+        }
+    }
+    return true;
+}
+
+bool decompress_mip_chain(const CompressedImage &image, MipChain &chain) {
+    if (image.num_levels == 0) {
+        return false;
+    }
+    chain.num_levels = std::min(image.num_levels, MipChain::MAX_LEVELS);
+    size_t total_size = 0;
+    for (uint32_t level = 0; level < chain.num_levels; level++) {
+        const auto &lvl = image.levels[level];
+        chain.levels[level] = {lvl.width, lvl.height, total_size, size_t(lvl.width) * lvl.height * 4};
+        total_size += chain.levels[level].size;
+    }
+    chain.data.resize(total_size);
+    for (uint32_t level = 0; level < chain.num_levels; level++) {
+        const auto &lvl = image.levels[level];
+        decompress_image(image.format, image.level_data(level), lvl.width, lvl.height, chain.level_data(level));
+    }
+    return true;
+}
+
+bool is_texture_file(const uint8_t *data, size_t size) {
+    uint32_t magic = 0;
+    if (size >= sizeof(TextureFileHeader)) {
+        memcpy(&magic, data, sizeof(magic));
+    }
+    return magic == TEXTURE_FILE_MAGIC;
+}
+
+size_t texture_file_header_size(uint32_t num_levels) {
+    return sizeof(TextureFileHeader) + sizeof(TextureFileLevel) * num_levels;
+}
+
+bool load_texture_layout(const uint8_t *data, size_t size, CompressedImage &image, size_t &data_offset) {
+    if (!is_texture_file(data, size)) {
+        return false;
+    }
+    TextureFileHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.version != TEXTURE_FILE_VERSION || !valid_format(header.format) || header.num_levels == 0 ||
+        header.num_levels > CompressedImage::MAX_LEVELS) {
+        return false;
+    }
+    if (size < texture_file_header_size(header.num_levels)) {
+        return false;
+    }
+    image.format = TextureFormat(header.format);
+    image.srgb = (header.flags & TEXTURE_FILE_SRGB) != 0;
+    image.num_levels = header.num_levels;
+    image.data.clear();
+    size_t total_size = 0;
+    for (uint32_t level = 0; level < header.num_levels; level++) {
+        TextureFileLevel lvl;
+        memcpy(&lvl, data + sizeof(header) + level * sizeof(lvl), sizeof(lvl));
+        if (lvl.size != texture_level_size(image.format, lvl.width, lvl.height)) {
+            return false;
+        }
+        image.levels[level] = {lvl.width, lvl.height, total_size, size_t(lvl.size)};
+        total_size += lvl.size;
+    }
+    data_offset = texture_file_header_size(header.num_levels);
+    return true;
+}
+
+bool load_texture_file(const uint8_t *data, size_t size, CompressedImage &image) {
+    size_t data_offset = 0;
+    if (!load_texture_layout(data, size, image, data_offset)) {
+        return false;
+    }
+    const size_t total_size = image.levels[image.num_levels - 1].offset + image.levels[image.num_levels - 1].size;
+    if (size < data_offset + total_size) {
+        return false;
+    }
+    image.data.assign(data + data_offset, data + data_offset + total_size);
+    return true;
+}
+
+bool load_texture_file(const char *filename, CompressedImage &image) {
+    FILE *f = fopen(filename, "rb");
+    if (!f) {
+        return false;
+    }
+    std::vector<uint8_t> data;
+    const int64_t size = file_size(f);
+    bool ok = size > 0 && file_seek(f, 0);
+    if (ok) {
+        data.resize(size_t(size));
+        ok = fread(data.data(), 1, data.size(), f) == data.size();
+    }
+    fclose(f);
+    return ok && load_texture_file(data.data(), data.size(), image);
+}
+
+bool save_texture_file(const CompressedImage &image, std::vector<uint8_t> &data) {
+    if (image.num_levels == 0 || image.num_levels > CompressedImage::MAX_LEVELS) {
+        return false;
+    }
+    TextureFileHeader header = {TEXTURE_FILE_MAGIC, TEXTURE_FILE_VERSION, uint32_t(image.format),
+                                image.srgb ? TEXTURE_FILE_SRGB : 0, image.num_levels, 0};
+    const size_t table_size = sizeof(TextureFileLevel) * image.num_levels;
+    size_t total_size = 0;
+    for (uint32_t level = 0; level < image.num_levels; level++) {
+        total_size += image.levels[level].size;
+    }
+    data.resize(sizeof(header) + table_size + total_size);
+    memcpy(data.data(), &header, sizeof(header));
+    uint8_t *dst = data.data() + sizeof(header) + table_size;
+    for (uint32_t level = 0; level < image.num_levels; level++) {
+        const auto &lvl = image.levels[level];
+        TextureFileLevel file_level = {lvl.width, lvl.height, uint64_t(lvl.size)};
+        memcpy(data.data() + sizeof(header) + level * sizeof(file_level), &file_level, sizeof(file_level));
+        memcpy(dst, image.level_data(level), lvl.size);
+        dst += lvl.size;
+    }
+    return true;
+}
+
+bool save_texture_file(const char *filename, const CompressedImage &image) {
+    std::vector<uint8_t> data;
+    if (!save_texture_file(image, data)) {
+        return false;
+    }
+    FILE *f = fopen(filename, "wb");
+    if (!f) {
+        return false;
+    }
+    bool ok = fwrite(data.data(), 1, data.size(), f) == data.size();
+    fclose(f);
+    return ok;
+}
+
+void choose_texture_format(uint32_t usage, const uint8_t *rgba, size_t num_pixels, TextureFormat &format,
+                           bool &srgb) {
+    if (usage & TextureUsageNormal) {
+        format = TextureFormat::BC5;
+        srgb = false;
+    } else if (usage == TextureUsageOcclusion) {
+        format = TextureFormat::BC4;
+        srgb = false;
+    } else if (usage & (TextureUsageMetallicRoughness | TextureUsageOcclusion)) {
+        format = TextureFormat::BC1; // three channels of linear data (packed occlusion/roughness/metallic)
+        srgb = false;
+    } else {
+        bool has_alpha = false;
+        for (size_t i = 0; i < num_pixels && !has_alpha && (usage & TextureUsageColor); i++) {
+            has_alpha = rgba[i * 4 + 3] != 255;
+        }
+        format = has_alpha ? TextureFormat::BC3 : TextureFormat::BC1;
+        srgb = true;
+    }
+}
+
+} // namespace glengine
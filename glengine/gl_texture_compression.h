@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace glengine {
+
+struct MipChain;
+
+/// pixel formats of (possibly block compressed) textures
+enum class TextureFormat : uint32_t {
+    RGBA8 = 0, ///< uncompressed, 4 bytes per texel
+    BC1 = 1,   ///< rgb (1 bit alpha), 8 bytes per 4x4 block: color textures without alpha, ORM maps
+    BC3 = 2,   ///< rgba, 16 bytes per 4x4 block: color textures with alpha
+    BC4 = 3,   ///< single channel (r), 8 bytes per 4x4 block: occlusion, roughness, masks
+    BC5 = 4,   ///< two channels (rg), 16 bytes per 4x4 block: tangent space normal maps (z is reconstructed)
+};
+
+const char *texture_format_name(TextureFormat format);
+
+/// size in bytes of a texture level of the given size (for block formats, partial blocks are rounded up)
+size_t texture_level_size(TextureFormat format, uint32_t width, uint32_t height);
+
+/// mip chain of a texture in any TextureFormat, stored in a single contiguous buffer (level 0 first)
+struct CompressedImage {
+    static constexpr uint32_t MAX_LEVELS = 16;
+    struct Level {
+        uint32_t width = 0;
+        uint32_t height = 0;
+        size_t offset = 0;
+        size_t size = 0;
+    };
+
+    TextureFormat format = TextureFormat::RGBA8;
+    bool srgb = false; ///< the rgb channels hold sRGB colors
+    uint32_t num_levels = 0;
+    Level levels[MAX_LEVELS];
+    std::vector<uint8_t> data;
+
+    uint8_t *level_data(uint32_t level) { return data.data() + levels[level].offset; }
+    const uint8_t *level_data(uint32_t level) const { return data.data() + levels[level].offset; }
+};
+
+/// block compression of an rgba8 image (width and height don't need to be multiples of 4: the edge texels are
+/// replicated in partial blocks). BC4 encodes the r channel, BC5 the r and g channels
+void compress_image(TextureFormat format, const uint8_t *rgba, uint32_t width, uint32_t height, uint8_t *blocks);
+/// decompression to rgba8 (BC4 is expanded to (r,0,0,255), BC5 to (r,g,0,255))
+void decompress_image(TextureFormat format, const uint8_t *blocks, uint32_t width, uint32_t height, uint8_t *rgba);
+
+/// compress all the levels of an rgba8 mip chain; blocks rows are split across the worker threads when parallel
+bool compress_mip_chain(const MipChain &chain, TextureFormat format, bool srgb, CompressedImage &image,
+                        bool parallel = true);
+/// decompress all the levels of an image to an rgba8 mip chain (used when the backend can't sample the format)
+bool decompress_mip_chain(const CompressedImage &image, MipChain &chain);
+
+/// texture files (.gtex): a small header, the table of levels, then the level data as uploaded to the GPU
+bool is_texture_file(const uint8_t *data, size_t size);
+bool load_texture_file(const uint8_t *data, size_t size, CompressedImage &image);
+/// size of the header and table of levels of a texture file, reading texture_file_header_size(MAX_LEVELS) bytes (or
+/// the whole file if smaller) is enough for load_texture_layout
+size_t texture_file_header_size(uint32_t num_levels);
+/// format and levels of a texture file without their data (image.data is left empty). Level offsets are relative to
+/// data_offset, the position of the level data in the file, so that only some levels can be read (i.e. streamed)
+bool load_texture_layout(const uint8_t *data, size_t size, CompressedImage &image, size_t &data_offset);
+bool load_texture_file(const char *filename, CompressedImage &image);
+bool save_texture_file(const char *filename, const CompressedImage &image);
+/// same as above, to memory (i.e. to store the texture in a package)
+bool save_texture_file(const CompressedImage &image, std::vector<uint8_t> &data);
+
+/// ways materials use a texture, combined as flags when a texture is shared by several slots
+enum TextureUsage : uint32_t {
+    TextureUsageColor = 1,
+    TextureUsageEmissive = 2,
+    TextureUsageNormal = 4,
+    TextureUsageMetallicRoughness = 8,
+    TextureUsageOcclusion = 16,
+};
+
+/// block format and color space for a texture: BC5 for normal maps, BC4 when only used as occlusion, linear BC1 for
+/// metallic/roughness (and packed ORM) maps, sRGB BC1 for colors, or BC3 for base colors with an alpha channel
+void choose_texture_format(uint32_t usage, const uint8_t *rgba, size_t num_pixels, TextureFormat &format, bool &srgb);
+
+} // namespace glengine
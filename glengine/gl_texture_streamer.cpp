@@ -0,0 +1,324 @@
+#include "gl_texture_streamer.h"
+#include "gl_engine.h"
+#include "gl_logger.h"
+#include "gl_mesh.h"
+#include "gl_object.h"
+#include "gl_package.h"
+#include "gl_thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <mutex>
+
+namespace {
+
+// levels of a texture from the given one to the smallest, read from its package entry. Levels of the result start
+// at 0 with the requested one
+bool read_levels(glengine::Package &package, const glengine::PackageEntry &entry, uint64_t data_offset,
+                 const glengine::CompressedImage &layout, uint32_t level, glengine::CompressedImage &image) {
+    const auto &last = layout.levels[layout.num_levels - 1];
+    const size_t begin = layout.levels[level].offset, end = last.offset + last.size;
+    if (!package.read(entry, data_offset + begin, end - begin, image.data) || image.data.size() != end - begin) {
+        return false;
+    }
+    image.format = layout.format;
+    image.srgb = layout.srgb;
+    image.num_levels = layout.num_levels - level;
+    for (uint32_t i = 0; i < image.num_levels; i++) {
+        image.levels[i] = layout.levels[level + i];
+        image.levels[i].offset -= begin;
+    }
+    return true;
+}
+
+} // namespace
+
+namespace glengine {
+
+/// package of the textures, read by the worker threads one at a time
+struct TextureStreamer::PackageFile {
+    Package package;
+    bool open = false;
+    std::mutex mutex;
+};
+
+/// state shared with the loads running on the worker threads
+struct TextureStreamer::Shared {
+    struct Loaded {
+        uint32_t texture;
+        uint32_t level;
+        bool ok;
+        CompressedImage image;
+    };
+
+    std::mutex mutex;
+    std::deque<Loaded> loaded;
+};
+
+void TextureStreamer::init(GLEngine &eng) {
+    terminate();
+    _eng = &eng;
+    _shared = std::make_shared<Shared>();
+}
+
+void TextureStreamer::terminate() {
+    // the pending loads keep their own references, their results are never used
+    _shared.reset();
+    _textures.clear();
+    _texture_index.clear();
+    _materials.clear();
+    _mesh_bounds.clear();
+    _packages.clear();
+    _stats = TextureStreamingStats();
+}
+
+uint64_t TextureStreamer::level_bytes(const Texture &tex, uint32_t level) {
+    const auto &last = tex.layout.levels[tex.layout.num_levels - 1];
+    return last.offset + last.size - tex.layout.levels[level].offset;
+}
+
+sg_image TextureStreamer::create_image(Package &package, const std::string &name, uint64_t source_key,
+                                       const ImageParams &params) {
+    ResourceManager &rm = _eng->resource_manager();
+    sg_image img = rm.find_image(source_key, params);
+    if (img.id != SG_INVALID_ID) {
+        return img;
+    }
+    // only the layout of the texture and its smallest levels are read
+    Texture tex;
+    size_t data_offset = 0;
+    std::vector<uint8_t> header;
+    CompressedImage image;
+    const PackageEntry *entry = package.find(name);
+    if (!entry || entry->type != PackageEntryType::Texture ||
+        !package.read(*entry, 0, texture_file_header_size(CompressedImage::MAX_LEVELS), header) ||
+        !load_texture_layout(header.data(), header.size(), tex.layout, data_offset)) {
+        log_warning("texture streamer: invalid texture '%s'", name.c_str());
+        return {SG_INVALID_ID};
+    }
+    while (tex.initial_level + 1 < tex.layout.num_levels &&
+           std::max(tex.layout.levels[tex.initial_level].width, tex.layout.levels[tex.initial_level].height) >
+               this->params.initial_size) {
+        tex.initial_level++;
+    }
+    tex.entry_offset = data_offset;
+    if (!read_levels(package, *entry, tex.entry_offset, tex.layout, tex.initial_level, image)) {
+        log_warning("texture streamer: unable to read texture '%s'", name.c_str());
+        return {SG_INVALID_ID};
+    }
+    img = rm.create_image(source_key, params, image, name.c_str());
+    if (img.id == SG_INVALID_ID) {
+        return img;
+    }
+    auto &package_file = _packages[package.filename()];
+    if (!package_file) {
+        package_file = std::make_shared<PackageFile>();
+        package_file->open = package_file->package.open(package.filename().c_str());
+        if (!package_file->open) {
+            log_warning("texture streamer: unable to open package '%s', textures keep their smallest levels",
+                        package.filename().c_str());
+        }
+    }
+    tex.name = name;
+    tex.package = package_file;
+    tex.params = params;
+    tex.image = img;
+    tex.resident_level = tex.initial_level;
+    _texture_index[img.id] = uint32_t(_textures.size());
+    _stats.num_textures++;
+    _stats.resident_bytes += level_bytes(tex, tex.resident_level);
+    _stats.full_bytes += level_bytes(tex, 0);
+    _textures.push_back(std::move(tex));
+    return img;
+}
+
+void TextureStreamer::add_material(Material *material, const std::vector<sg_image> &images) {
+    for (const sg_image &img : images) {
+        auto it = _texture_index.find(img.id);
+        if (it != _texture_index.end()) {
+            auto &textures = _materials[material];
+            if (std::find(textures.begin(), textures.end(), it->second) == textures.end()) {
+                textures.push_back(it->second);
+            }
+        }
+    }
+}
+
+void TextureStreamer::request(uint32_t index, uint32_t level) {
+    Texture &tex = _textures[index];
+    tex.loading = true;
+    tex.loading_level = level;
+    _stats.pending_loads++;
+    default_thread_pool().submit([shared = _shared, package = tex.package, name = tex.name,
+                                  offset = tex.entry_offset, layout = tex.layout, index, level]() {
+        Shared::Loaded loaded = {index, level, false, {}};
+        {
+            std::lock_guard<std::mutex> lock(package->mutex);
+            const PackageEntry *entry = package->package.find(name);
+            loaded.ok = entry && read_levels(package->package, *entry, offset, layout, level, loaded.image);
+        }
+        if (!loaded.ok) {
+            log_warning("texture streamer: unable to read texture '%s'", name.c_str());
+        }
+        std::lock_guard<std::mutex> lock(shared->mutex);
+        shared->loaded.push_back(std::move(loaded));
+    });
+}
+
+const TextureStreamer::Bounds &TextureStreamer::mesh_bounds(const Mesh *mesh) {
+    auto it = _mesh_bounds.find(mesh->vbuf.id);
+    if (it != _mesh_bounds.end()) {
+        return it->second;
+    }
+    Bounds bounds = {{0.0f, 0.0f, 0.0f}, 0.0f};
+    const size_t n = mesh->num_vertices();
+    if (n > 0) {
+        math::Vector3f bbox_min = mesh->position(0), bbox_max = bbox_min;
+        for (size_t i = 1; i < n; i++) {
+            const math::Vector3f p = mesh->position(i);
+            bbox_min = {std::min(bbox_min.x, p.x), std::min(bbox_min.y, p.y), std::min(bbox_min.z, p.z)};
+            bbox_max = {std::max(bbox_max.x, p.x), std::max(bbox_max.y, p.y), std::max(bbox_max.z, p.z)};
+        }
+        bounds.center = (bbox_min + bbox_max) * 0.5f;
+        bounds.radius = math::length(bbox_max - bbox_min) * 0.5f;
+    }
+    return _mesh_bounds.emplace(mesh->vbuf.id, bounds).first->second;
+}
+
+void TextureStreamer::visit(Object *obj, const math::Matrix4f &parent_tf) {
+    if (!obj->visible()) {
+        return;
+    }
+    const math::Matrix4f tf = parent_tf * obj->transform() * obj->_scale;
+    for (const auto &r : obj->_renderables) {
+        auto it = _materials.find(r.material);
+        if (it == _materials.end() || !r.mesh) {
+            continue;
+        }
+        // bounding sphere of the mesh in world space, its on-screen size is the size of the textures if their
+        // coordinates cover the mesh once
+        const Bounds &bounds = mesh_bounds(r.mesh);
+        const float scale = std::max({math::length(math::Vector3f{tf(0, 0), tf(1, 0), tf(2, 0)}),
+                                      math::length(math::Vector3f{tf(0, 1), tf(1, 1), tf(2, 1)}),
+                                      math::length(math::Vector3f{tf(0, 2), tf(1, 2), tf(2, 2)})});
+        const float radius = bounds.radius * scale;
+        float size = 2.0f * radius * _pixel_scale;
+        if (_perspective) {
+            const float distance = math::length(tf * bounds.center - _cam_pos);
+            size = distance > radius ? size / distance : std::numeric_limits<float>::max();
+        }
+        for (uint32_t index : it->second) {
+            _textures[index].screen_size = std::max(_textures[index].screen_size, size);
+        }
+    }
+    for (auto *child : obj->children()) {
+        visit(child, tf);
+    }
+}
+
+void TextureStreamer::update(const Camera &cam, Object *root, float viewport_height) {
+    if (!_shared) {
+        return;
+    }
+    // upload the loaded levels
+    ResourceManager &rm = _eng->resource_manager();
+    for (uint32_t uploads = 0; uploads < params.max_uploads_per_frame;) {
+        Shared::Loaded loaded;
+        {
+            std::lock_guard<std::mutex> lock(_shared->mutex);
+            if (_shared->loaded.empty()) {
+                break;
+            }
+            loaded = std::move(_shared->loaded.front());
+            _shared->loaded.pop_front();
+        }
+        Texture &tex = _textures[loaded.texture];
+        tex.loading = false;
+        _stats.pending_loads--;
+        if (!loaded.ok || !rm.replace_image(tex.image, tex.params, loaded.image, tex.name.c_str())) {
+            continue;
+        }
+        _stats.resident_bytes -= level_bytes(tex, tex.resident_level);
+        _stats.resident_bytes += level_bytes(tex, loaded.level);
+        tex.resident_level = loaded.level;
+        _stats.num_loads++;
+        uploads++;
+    }
+
+    // on-screen size of the textures, from the objects using them
+    const math::Matrix4f &cam_tf = cam.transform();
+    const math::Matrix4f &proj = cam.projection();
+    _cam_pos = {cam_tf(0, 3), cam_tf(1, 3), cam_tf(2, 3)};
+    _perspective = proj(3, 3) == 0.0f;
+    _pixel_scale = proj(1, 1) * viewport_height * 0.5f;
+    for (auto &tex : _textures) {
+        tex.screen_size = 0.0f;
+    }
+    if (root) {
+        visit(root, math::matrix4_identity<float>());
+    }
+
+    // level matching the on-screen size of each texture (textures not visible keep only their initial levels), then
+    // the same number of levels is dropped from all the textures until they fit in the budget
+    std::vector<uint32_t> wanted(_textures.size());
+    for (size_t i = 0; i < _textures.size(); i++) {
+        const Texture &tex = _textures[i];
+        wanted[i] = tex.initial_level;
+        if (tex.screen_size > 0.0f) {
+            const float texels = float(std::max(tex.layout.levels[0].width, tex.layout.levels[0].height));
+            const float level = std::floor(std::log2(texels / tex.screen_size) + params.lod_bias);
+            wanted[i] = uint32_t(std::min(std::max(level, 0.0f), float(tex.initial_level)));
+        }
+    }
+    uint32_t bias = 0;
+    for (; bias < CompressedImage::MAX_LEVELS; bias++) {
+        uint64_t bytes = 0;
+        for (size_t i = 0; i < _textures.size(); i++) {
+            bytes += level_bytes(_textures[i], std::min(wanted[i] + bias, _textures[i].initial_level));
+        }
+        if (bytes <= params.memory_budget) {
+            break;
+        }
+    }
+    _stats.budget_bias = bias;
+
+    // coarser levels are loaded when two levels are not needed anymore (or to fit in the budget), so that textures
+    // don't go back and forth between two levels. Finer levels are loaded for the biggest textures on screen first
+    uint64_t pending_bytes = 0;
+    for (const auto &tex : _textures) {
+        if (tex.loading && tex.loading_level < tex.resident_level) {
+            pending_bytes += level_bytes(tex, tex.loading_level) - level_bytes(tex, tex.resident_level);
+        }
+    }
+    std::vector<uint32_t> finer;
+    for (uint32_t i = 0; i < _textures.size(); i++) {
+        const Texture &tex = _textures[i];
+        wanted[i] = std::min(wanted[i] + bias, tex.initial_level);
+        if (tex.loading || !tex.package->open) {
+            continue;
+        }
+        if (wanted[i] < tex.resident_level) {
+            finer.push_back(i);
+        } else if (wanted[i] > tex.resident_level + 1 || (bias > 0 && wanted[i] > tex.resident_level)) {
+            if (_stats.pending_loads < params.max_pending_loads) {
+                request(i, wanted[i]);
+            }
+        }
+    }
+    std::sort(finer.begin(), finer.end(),
+              [this](uint32_t a, uint32_t b) { return _textures[a].screen_size > _textures[b].screen_size; });
+    for (uint32_t i : finer) {
+        const Texture &tex = _textures[i];
+        const uint64_t extra = level_bytes(tex, wanted[i]) - level_bytes(tex, tex.resident_level);
+        if (_stats.pending_loads >= params.max_pending_loads ||
+            _stats.resident_bytes + pending_bytes + extra > params.memory_budget) {
+            break;
+        }
+        pending_bytes += extra;
+        request(i, wanted[i]);
+    }
+}
+
+} // namespace glengine
@@ -0,0 +1,112 @@
+#pragma once
+
+#include "gl_resource_manager.h"
+#include "gl_texture_compression.h"
+#include "math/vmath.h"
+
+#include "sokol_gfx.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace glengine {
+
+class Camera;
+class GLEngine;
+class Material;
+class Mesh;
+class Object;
+class Package;
+
+/// settings of the texture streaming, they can be changed at any time
+struct TextureStreamingParams {
+    uint64_t memory_budget = uint64_t(128) << 20; ///< resident levels of all the streamed textures
+    uint32_t initial_size = 64; ///< levels up to this size are loaded with the texture, and always stay resident
+    float lod_bias = 0.0f;      ///< added to the level computed from the on-screen size, positive values are blurrier
+    uint32_t max_pending_loads = 4;     ///< textures read on the worker threads at the same time
+    uint32_t max_uploads_per_frame = 2; ///< textures uploaded per update, to bound the cost of a frame
+};
+
+struct TextureStreamingStats {
+    uint32_t num_textures = 0;
+    uint32_t pending_loads = 0;
+    uint32_t budget_bias = 0;    ///< levels dropped from all the textures to fit in the budget, at the last update
+    uint64_t resident_bytes = 0; ///< of the levels resident on the gpu
+    uint64_t full_bytes = 0;     ///< of all the textures with their whole mip chain
+    uint64_t num_loads = 0;      ///< level changes uploaded since init
+};
+
+/// progressive streaming of the mip levels of package textures (Texture entries, see load_texture_layout): a texture
+/// is created with its smallest levels only, so it can be used right away, and update() streams in the finer levels
+/// as the objects using it get bigger on screen (and drops them as they get smaller), within a memory budget.
+/// Levels are read from the package on the worker threads, and the resource manager image is replaced on the main
+/// thread, keeping its handle (see ResourceManager::replace_image)
+class TextureStreamer {
+  public:
+    void init(GLEngine &eng);
+    /// discard the pending loads, the images stay in the resource manager with their resident levels
+    void terminate();
+
+    /// image of a Texture entry with its levels up to params.initial_size, registered in the image cache with the
+    /// given source key. Returns an invalid handle if the entry is missing or invalid
+    sg_image create_image(Package &package, const std::string &name, uint64_t source_key, const ImageParams &params);
+    /// declare the images used by a material, the finer levels of the streamed ones are loaded depending on the
+    /// on-screen size of the objects drawn with the material. Images not created by the streamer are ignored
+    void add_material(Material *material, const std::vector<sg_image> &images);
+
+    /// compute the levels needed by the visible objects under root seen from the camera (viewport_height in pixels),
+    /// request the loads and upload the levels loaded since the last update. Has to be called on the main thread,
+    /// once per frame before rendering
+    void update(const Camera &cam, Object *root, float viewport_height);
+
+    const TextureStreamingStats &stats() const { return _stats; }
+
+    TextureStreamingParams params;
+
+  private:
+    struct PackageFile;
+    struct Texture {
+        std::string name; ///< package entry
+        std::shared_ptr<PackageFile> package;
+        uint64_t entry_offset = 0; ///< of the level data, in the entry
+        ImageParams params;
+        sg_image image = {SG_INVALID_ID};
+        CompressedImage layout; ///< levels of the texture file, without data
+        uint32_t resident_level = 0; ///< finest level resident on the gpu
+        uint32_t initial_level = 0;  ///< finest level loaded with the texture, never dropped
+        bool loading = false;
+        uint32_t loading_level = 0;
+        float screen_size = 0.0f; ///< largest on-screen size in pixels of the objects using it, at the last update
+    };
+    struct Bounds {
+        math::Vector3f center;
+        float radius;
+    };
+    struct Shared;
+
+    /// size of the levels from level to the smallest one
+    static uint64_t level_bytes(const Texture &tex, uint32_t level);
+    void request(uint32_t index, uint32_t level);
+    /// update the on-screen size of the textures used by the visible objects of a subtree
+    void visit(Object *obj, const math::Matrix4f &parent_tf);
+    const Bounds &mesh_bounds(const Mesh *mesh);
+
+    GLEngine *_eng = nullptr;
+    std::vector<Texture> _textures;
+    std::unordered_map<uint32_t, uint32_t> _texture_index; ///< textures by image id
+    std::unordered_map<Material *, std::vector<uint32_t>> _materials;
+    std::unordered_map<uint32_t, Bounds> _mesh_bounds; ///< by vertex buffer id, computed on first use
+    std::map<std::string, std::shared_ptr<PackageFile>> _packages; ///< opened again for the worker threads
+    std::shared_ptr<Shared> _shared; ///< loaded levels, also owned by the pending loads
+    TextureStreamingStats _stats;
+    // camera of the current update
+    math::Vector3f _cam_pos;
+    float _pixel_scale = 0.0f; ///< on-screen size in pixels of an object of size 1 (at distance 1 in perspective)
+    bool _perspective = true;
+};
+
+} // namespace glengine
@@ -0,0 +1,140 @@
+#include "gl_thick_lines.h"
+#include "gl_camera.h"
+#include "gl_engine.h"
+#include "gl_logger.h"
+#include "generated/shaders/thick_lines.glsl.h"
+
+#include <algorithm>
+#include <cstddef>
+
+namespace glengine {
+
+bool ThickLines::init(GLEngine &eng) {
+    ResourceManager &rm = eng.resource_manager();
+    // x: 0 at the first end of the segment and 1 at the second, y: across
+    const float quad[] = {0.0f, -1.0f, 1.0f, -1.0f, 0.0f, 1.0f, 1.0f, 1.0f};
+    _quad = sg_make_buffer((sg_buffer_desc){.size = sizeof(quad), .data = SG_RANGE(quad), .label = "thick-lines-quad"});
+
+    // the quad is in buffer 0. The same vertices are bound to buffers 1 to 4, one vertex apart, so that instance i
+    // reads the vertices i to i + 3: the previous point, the segment, and the next point
+    sg_pipeline_desc pip_desc = {0};
+    for (int i = 1; i <= 4; i++) {
+        pip_desc.layout.buffers[i].stride = sizeof(LineVertex);
+        pip_desc.layout.buffers[i].step_func = SG_VERTEXSTEP_PER_INSTANCE;
+    }
+    pip_desc.layout.attrs[ATTR_vs_thick_lines_corner] = {.buffer_index = 0, .format = SG_VERTEXFORMAT_FLOAT2};
+    pip_desc.layout.attrs[ATTR_vs_thick_lines_prev_pos] = {.buffer_index = 1, .format = SG_VERTEXFORMAT_FLOAT4};
+    pip_desc.layout.attrs[ATTR_vs_thick_lines_a_pos] = {.buffer_index = 2, .format = SG_VERTEXFORMAT_FLOAT4};
+    pip_desc.layout.attrs[ATTR_vs_thick_lines_a_color] = {
+        .buffer_index = 2, .offset = offsetof(LineVertex, color), .format = SG_VERTEXFORMAT_UBYTE4N};
+    pip_desc.layout.attrs[ATTR_vs_thick_lines_a_style] = {
+        .buffer_index = 2, .offset = offsetof(LineVertex, style), .format = SG_VERTEXFORMAT_FLOAT4};
+    pip_desc.layout.attrs[ATTR_vs_thick_lines_b_pos] = {.buffer_index = 3, .format = SG_VERTEXFORMAT_FLOAT4};
+    pip_desc.layout.attrs[ATTR_vs_thick_lines_b_color] = {
+        .buffer_index = 3, .offset = offsetof(LineVertex, color), .format = SG_VERTEXFORMAT_UBYTE4N};
+    pip_desc.layout.attrs[ATTR_vs_thick_lines_next_pos] = {.buffer_index = 4, .format = SG_VERTEXFORMAT_FLOAT4};
+    pip_desc.shader = rm.get_or_create_shader(*thick_lines_shader_desc(sg_query_backend()));
+    pip_desc.primitive_type = SG_PRIMITIVETYPE_TRIANGLE_STRIP;
+    pip_desc.depth = {.pixel_format = SG_PIXELFORMAT_DEPTH_STENCIL,
+                      .compare = SG_COMPAREFUNC_LESS_EQUAL,
+                      .write_enabled = true};
+    pip_desc.color_count = eng._config.use_mrt ? 3 : 1;
+    pip_desc.sample_count = sg_query_features().msaa_render_targets ? eng._config.msaa_samples : 1;
+    pip_desc.label = "thick lines pipeline";
+    _pip = rm.get_or_create_pipeline(pip_desc);
+    pip_desc.depth.compare = SG_COMPAREFUNC_ALWAYS;
+    pip_desc.depth.write_enabled = false;
+    pip_desc.label = "thick lines overlay pipeline";
+    _overlay_pip = rm.get_or_create_pipeline(pip_desc);
+    return _pip.id != SG_INVALID_ID && _overlay_pip.id != SG_INVALID_ID;
+}
+
+void ThickLines::terminate() {
+    sg_destroy_buffer(_quad);
+    sg_destroy_buffer(_buffer);
+    _quad = _buffer = {SG_INVALID_ID};
+    _vertices.clear();
+    _num_vertices = _num_overlay_vertices = 0;
+    _stats = ThickLineStats();
+}
+
+void ThickLines::pack(const Polyline &line) {
+    const size_t n = line.points.size();
+    const LineStyle &s = line.style;
+    const math::Vector4f style = {s.width, s.dash, s.gap, float(int(s.join) + int(s.cap) * 4)};
+    auto color = [&](size_t i) { return i < line.colors.size() ? line.colors[i] : line.color; };
+    // the first and the last points are repeated as padding, the segments touching it are dropped by the shader
+    _vertices.push_back({line.points[0], -1.0f, color(0), style});
+    float distance = 0.0f;
+    for (size_t i = 0; i < n; i++) {
+        if (i > 0) {
+            distance += math::length(line.points[i] - line.points[i - 1]);
+        }
+        _vertices.push_back({line.points[i], distance, color(i), style});
+    }
+    _vertices.push_back({line.points[n - 1], -1.0f, color(n - 1), style});
+    _stats.num_polylines++;
+    _stats.num_segments += uint32_t(n - 1);
+}
+
+void ThickLines::update() {
+    _vertices.clear();
+    _stats.num_polylines = 0;
+    _stats.num_segments = 0;
+    for (bool depth_test : {true, false}) {
+        for (const Polyline &line : polylines) {
+            if (line.points.size() >= 2 && line.style.depth_test == depth_test) {
+                pack(line);
+            }
+        }
+        if (depth_test) {
+            _num_vertices = uint32_t(_vertices.size());
+        }
+    }
+    _num_overlay_vertices = uint32_t(_vertices.size()) - _num_vertices;
+    if (_vertices.empty()) {
+        return;
+    }
+    // the buffer only grows, to the next power of two
+    if (_vertices.size() > _stats.capacity) {
+        uint32_t capacity = std::max<uint32_t>(_stats.capacity, 4096);
+        while (capacity < _vertices.size()) {
+            capacity *= 2;
+        }
+        sg_destroy_buffer(_buffer);
+        _buffer = sg_make_buffer((sg_buffer_desc){.size = capacity * sizeof(LineVertex),
+                                                  .type = SG_BUFFERTYPE_VERTEXBUFFER,
+                                                  .usage = SG_USAGE_DYNAMIC,
+                                                  .label = "thick-lines-vertices"});
+        _stats.capacity = capacity;
+        log_debug("thick lines: %u vertices buffer", capacity);
+    }
+    sg_update_buffer(_buffer, {_vertices.data(), _vertices.size() * sizeof(LineVertex)});
+}
+
+void ThickLines::draw(const Camera &cam, float width, float height) {
+    _stats.num_draws = 0;
+    thick_lines_params_t params = {.view_projection = cam.projection() * cam.inverse_transform(),
+                                   .viewport = {width, height, 0.0f, 0.0f}};
+    auto draw_lines = [&](sg_pipeline pip, uint32_t first, uint32_t num) {
+        if (num == 0) {
+            return;
+        }
+        sg_apply_pipeline(pip);
+        sg_bindings bind = {0};
+        bind.vertex_buffers[0] = _quad;
+        for (int i = 1; i <= 4; i++) {
+            bind.vertex_buffers[i] = _buffer;
+            bind.vertex_buffer_offsets[i] = int((first + i - 1) * sizeof(LineVertex));
+        }
+        sg_apply_bindings(bind);
+        sg_apply_uniforms(SG_SHADERSTAGE_VS, SLOT_thick_lines_params, SG_RANGE(params));
+        // instance i reads the vertices i to i + 3
+        sg_draw(0, 4, int(num - 3));
+        _stats.num_draws++;
+    };
+    draw_lines(_pip, 0, _num_vertices);
+    draw_lines(_overlay_pip, _num_vertices, _num_overlay_vertices);
+}
+
+} // namespace glengine
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "gl_types.h"
+#include "math/vmath.h"
+
+#include "sokol_gfx.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace glengine {
+
+class Camera;
+class GLEngine;
+
+enum class LineJoin : uint8_t { Miter, Bevel, Round };
+enum class LineCap : uint8_t { Butt, Square, Round };
+
+struct LineStyle {
+    float width = 2.0f; ///< in pixels
+    LineJoin join = LineJoin::Miter;
+    LineCap cap = LineCap::Butt;
+    float dash = 0.0f; ///< length of the dashes in world units, 0 for a solid line
+    float gap = 0.0f;  ///< between the dashes, in world units
+    bool depth_test = true;
+};
+
+struct Polyline {
+    std::vector<math::Vector3f> points;
+    std::vector<Color> colors; ///< per point, or empty to use color
+    Color color = {255, 255, 255, 255};
+    LineStyle style;
+};
+
+struct ThickLineStats {
+    uint32_t num_polylines = 0; ///< uploaded by the last update
+    uint32_t num_segments = 0;
+    uint32_t num_draws = 0; ///< of the last frame
+    uint32_t capacity = 0;  ///< vertices of the buffer
+};
+
+/// lines of any width in pixels, with joins, caps, per point colors and dashes, for polylines and trajectories
+/// (SG_PRIMITIVETYPE_LINES is always 1px wide). All the polylines are packed in a single buffer, and each segment is
+/// an instance expanded to a quad in screen space by the vertex shader, reading its end points and their neighbours
+/// from the same buffer: a draw call for the depth tested lines and one for the overlay ones, whatever the number of
+/// polylines. The joins and caps are cut by the fragment shader. The polylines are in world space and retained:
+/// update() has to be called after changing them, and draw() in the offscreen pass (see GLEngine::add_draw_function)
+class ThickLines {
+  public:
+    bool init(GLEngine &eng);
+    void terminate();
+
+    /// pack and upload the polylines, has to be called outside of the passes, at most once per frame
+    void update();
+    /// draw the uploaded polylines in the current pass, of the given size in pixels
+    void draw(const Camera &cam, float width, float height);
+
+    const ThickLineStats &stats() const { return _stats; }
+
+    std::vector<Polyline> polylines;
+
+  private:
+    struct LineVertex {
+        math::Vector3f pos;
+        float distance;     ///< from the first point, for the dashes. Negative for the padding of the polylines
+        Color color;
+        math::Vector4f style; ///< width, dash, gap, join + cap * 4
+    };
+
+    void pack(const Polyline &line);
+
+    sg_pipeline _pip = {SG_INVALID_ID};
+    sg_pipeline _overlay_pip = {SG_INVALID_ID};
+    sg_buffer _quad = {SG_INVALID_ID};
+    sg_buffer _buffer = {SG_INVALID_ID};
+    std::vector<LineVertex> _vertices;
+    // vertices of the depth tested and of the overlay polylines, one after the other in the buffer
+    uint32_t _num_vertices = 0;
+    uint32_t _num_overlay_vertices = 0;
+    ThickLineStats _stats;
+};
+
+} // namespace glengine
@@ -0,0 +1,110 @@
+#include "gl_thread_pool.h"
+
+#include <algorithm>
+#include <memory>
+
+namespace glengine {
+
+ThreadPool::ThreadPool(uint32_t num_threads) {
+    if (num_threads == 0) {
+        uint32_t hw_threads = std::thread::hardware_concurrency();
+        num_threads = hw_threads > 1 ? hw_threads - 1 : 1;
+    }
+    for (uint32_t i = 0; i < num_threads; i++) {
+        _workers.emplace_back(&ThreadPool::worker_loop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _task_available.notify_all();
+    for (auto &w : _workers) {
+        w.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void(void)> task) {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _tasks.push_back(std::move(task));
+    }
+    _task_available.notify_one();
+}
+
+void ThreadPool::wait_idle() {
+    std::unique_lock<std::mutex> lock(_mutex);
+    _idle.wait(lock, [this]() { return _tasks.empty() && _busy == 0; });
+}
+
+void ThreadPool::worker_loop() {
+    while (true) {
+        std::function<void(void)> task;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _task_available.wait(lock, [this]() { return _stop || !_tasks.empty(); });
+            if (_stop && _tasks.empty()) {
+                return;
+            }
+            task = std::move(_tasks.front());
+            _tasks.pop_front();
+            _busy++;
+        }
+        task();
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _busy--;
+            if (_busy == 0 && _tasks.empty()) {
+                _idle.notify_all();
+            }
+        }
+    }
+}
+
+ThreadPool &default_thread_pool() {
+    static ThreadPool pool;
+    return pool;
+}
+
+void parallel_for(ThreadPool &pool, uint32_t begin, uint32_t end, uint32_t grain,
+                  const std::function<void(uint32_t, uint32_t)> &fun) {
+    if (end <= begin) {
+        return;
+    }
+    grain = std::max(grain, 1u);
+    const uint32_t num_chunks = (end - begin + grain - 1) / grain;
+    if (num_chunks == 1) {
+        fun(begin, end);
+        return;
+    }
+    // chunks are claimed through an atomic counter, so both the workers and the calling thread can pick them up
+    struct Shared {
+        std::atomic<uint32_t> next_chunk{0};
+        std::atomic<uint32_t> done_chunks{0};
+        std::mutex mutex;
+        std::condition_variable done;
+    };
+    auto shared = std::make_shared<Shared>();
+    auto run_chunks = [shared, begin, end, grain, num_chunks, &fun]() {
+        uint32_t chunk;
+        while ((chunk = shared->next_chunk.fetch_add(1)) < num_chunks) {
+            uint32_t chunk_begin = begin + chunk * grain;
+            fun(chunk_begin, std::min(chunk_begin + grain, end));
+            if (shared->done_chunks.fetch_add(1) + 1 == num_chunks) {
+                std::lock_guard<std::mutex> lock(shared->mutex);
+                shared->done.notify_all();
+            }
+        }
+    };
+    const uint32_t num_helpers = std::min(pool.size(), num_chunks - 1);
+    for (uint32_t i = 0; i < num_helpers; i++) {
+        pool.submit(run_chunks);
+    }
+    run_chunks();
+    std::unique_lock<std::mutex> lock(shared->mutex);
+    shared->done.wait(lock, [&shared, num_chunks]() { return shared->done_chunks.load() == num_chunks; });
+}
+
+} // namespace glengine
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace glengine {
+
+/// Minimal pool of worker threads used for CPU-heavy work (image processing, asset decoding, simulation).
+/// Tasks are plain functions executed in FIFO order; there is no work stealing and no dependency tracking.
+/// The pool never touches the gpu: anything that needs sokol_gfx has to be done on the main thread.
+class ThreadPool {
+  public:
+    /// create the pool with the given number of workers (0: one per hardware thread, minus the calling thread)
+    explicit ThreadPool(uint32_t num_threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /// enqueue a task, executed asynchronously by one of the workers
+    void submit(std::function<void(void)> task);
+    /// block until all the submitted tasks have been completed
+    void wait_idle();
+
+    /// number of worker threads
+    uint32_t size() const { return uint32_t(_workers.size()); }
+
+  private:
+    void worker_loop();
+
+    std::vector<std::thread> _workers;
+    std::deque<std::function<void(void)>> _tasks;
+    std::mutex _mutex;
+    std::condition_variable _task_available;
+    std::condition_variable _idle;
+    uint32_t _busy = 0;
+    bool _stop = false;
+};
+
+/// shared pool, lazily created the first time it is used
+ThreadPool &default_thread_pool();
+
+/// split the range [begin, end) in chunks of (at least) grain elements, and call fun(chunk_begin, chunk_end) for
+/// each of them using the worker threads. The calling thread takes part in the work, and the function returns only
+/// when the whole range has been processed.
+void parallel_for(ThreadPool &pool, uint32_t begin, uint32_t end, uint32_t grain,
+                  const std::function<void(uint32_t, uint32_t)> &fun);
+
+/// same as above, using the default thread pool
+inline void parallel_for(uint32_t begin, uint32_t end, uint32_t grain,
+                         const std::function<void(uint32_t, uint32_t)> &fun) {
+    parallel_for(default_thread_pool(), begin, end, grain, fun);
+}
+
+} // namespace glengine
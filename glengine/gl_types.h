@@ -26,6 +26,43 @@ struct Vertex {
     math::Vector3f tangent = {1, 0, 0};
 };
 
+/// compact vertex (24 bytes) used by meshes kept quantized up to the GPU: every attribute is a normalized integer,
+/// and the positions are mapped back to the mesh space by the dequantization transform of the mesh
+struct QuantizedVertex {
+    int16_t pos[4] = {0, 0, 0, 0}; ///< w unused
+    Color color = {180, 180, 180, 255};
+    int8_t normal[4] = {0, 0, 127, 0};    ///< w unused
+    uint16_t tex_coords[2] = {0, 0};      ///< [0,1]
+    int8_t tangent[4] = {127, 0, 0, 127}; ///< w is the handedness of the bitangent
+};
+
+/// vertex formats of the meshes, materials provide a pipeline for each layout they support
+enum class VertexLayout {
+    Default,   ///< Vertex
+    Quantized, ///< QuantizedVertex
+};
+
+/// level of detail of an indexed mesh: a range of its indices, all the levels index the same vertices
+struct MeshLod {
+    uint32_t first_index = 0;
+    uint32_t num_indices = 0;
+    float error = 0.0f;       ///< geometric error of the level, in mesh units
+    float screen_size = 0.0f; ///< used up to this size on screen: diameter of the bounding sphere / viewport height
+};
+
+/// cluster of neighbouring triangles of an indexed mesh (see build_meshlets): a range of its indices, with the bounds
+/// it is culled by, in mesh space
+struct Meshlet {
+    uint32_t first_index = 0;
+    uint32_t num_indices = 0;
+    math::Vector3f center;
+    float radius = 0.0f;
+    /// average normal of the triangles, they all face away from the points v where
+    /// dot(center - v, cone_axis) >= cone_cutoff * length(center - v) + radius
+    math::Vector3f cone_axis = {0.0f, 0.0f, 1.0f};
+    float cone_cutoff = 1.0f; ///< sine of the spread of the normals around the axis, 1 when it is too wide to cull
+};
+
 /// base class used for all the resources managed by the engine,
 /// for example shaders, textures, meshes, etc.
 class Resource {
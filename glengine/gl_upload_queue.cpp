@@ -0,0 +1,388 @@
+#include "gl_upload_queue.h"
+#include "gl_logger.h"
+#include "sokol_gfx_ext.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t num_faces(const sg_image_desc &desc) {
+    return desc.type == SG_IMAGETYPE_CUBE ? uint32_t(SG_CUBEFACE_NUM) : 1;
+}
+
+} // namespace
+
+namespace glengine {
+
+void UploadQueue::copy_image_data(const sg_image_data &data, uint32_t faces, uint32_t levels, Job &job) {
+    job.num_faces = faces;
+    job.num_levels = levels;
+    job.data.resize(faces * levels);
+    job.bytes = 0;
+    for (uint32_t face = 0; face < faces; face++) {
+        for (uint32_t level = 0; level < levels; level++) {
+            const sg_range &range = data.subimage[face][level];
+            const uint8_t *ptr = (const uint8_t *)range.ptr;
+            job.data[face * levels + level].assign(ptr, ptr ? ptr + range.size : ptr);
+            job.bytes += range.size;
+        }
+    }
+}
+
+UploadQueue::Job *UploadQueue::pending_update(JobType type, uint32_t id) {
+    for (auto &job : _jobs) {
+        if (job.type == type && job.id == id) {
+            return &job;
+        }
+    }
+    return nullptr;
+}
+
+void UploadQueue::queue(Job &&job) {
+    _stats.pending++;
+    _stats.pending_bytes += job.bytes;
+    _jobs.push_back(std::move(job));
+}
+
+sg_buffer UploadQueue::make_buffer(const sg_buffer_desc &desc, UploadCallback done) {
+    sg_buffer buf = sg_alloc_buffer();
+    Job job;
+    job.type = JobType::MakeBuffer;
+    job.id = buf.id;
+    job.buffer_desc = desc;
+    if (desc.label) {
+        job.label = desc.label;
+    }
+    const uint8_t *ptr = (const uint8_t *)desc.data.ptr;
+    job.data.emplace_back(ptr, ptr ? ptr + desc.data.size : ptr);
+    job.bytes = job.data[0].size();
+    if (done) {
+        job.done.push_back(std::move(done));
+    }
+    queue(std::move(job));
+    return buf;
+}
+
+sg_image UploadQueue::make_image(const sg_image_desc &desc, UploadCallback done) {
+    sg_image img = sg_alloc_image();
+    remake_image(img, desc, std::move(done));
+    return img;
+}
+
+void UploadQueue::remake_image(sg_image img, const sg_image_desc &desc, UploadCallback done) {
+    Job job;
+    job.type = JobType::MakeImage;
+    job.id = img.id;
+    job.image_desc = desc;
+    if (desc.label) {
+        job.label = desc.label;
+    }
+    copy_image_data(desc.data, num_faces(desc), uint32_t(std::max(desc.num_mipmaps, 1)), job);
+    job.uploaded_level = job.num_levels;
+    if (done) {
+        job.done.push_back(std::move(done));
+    }
+    queue(std::move(job));
+}
+
+void UploadQueue::update_buffer(sg_buffer buf, const sg_range &data, UploadCallback done) {
+    Job *job = pending_update(JobType::UpdateBuffer, buf.id);
+    if (!job) {
+        Job update;
+        update.type = JobType::UpdateBuffer;
+        update.id = buf.id;
+        update.data.resize(1);
+        queue(std::move(update));
+        job = &_jobs.back();
+    }
+    _stats.pending_bytes -= job->bytes;
+    const uint8_t *ptr = (const uint8_t *)data.ptr;
+    job->data[0].assign(ptr, ptr ? ptr + data.size : ptr);
+    job->bytes = data.size;
+    // a split update restarts, its ranges are in the buffer not in use
+    job->offset = 0;
+    _stats.pending_bytes += job->bytes;
+    if (done) {
+        job->done.push_back(std::move(done));
+    }
+}
+
+void UploadQueue::update_image(sg_image img, const sg_image_data &data, UploadCallback done) {
+    Job *job = pending_update(JobType::UpdateImage, img.id);
+    if (!job) {
+        Job update;
+        update.type = JobType::UpdateImage;
+        update.id = img.id;
+        queue(std::move(update));
+        job = &_jobs.back();
+    }
+    _stats.pending_bytes -= job->bytes;
+    // the number of levels isn't known for an image still being created, all the given ones are kept
+    uint32_t faces = 1, levels = 0;
+    for (uint32_t face = 0; face < SG_CUBEFACE_NUM; face++) {
+        for (uint32_t level = 0; level < SG_MAX_MIPMAPS; level++) {
+            if (data.subimage[face][level].ptr) {
+                faces = std::max(faces, face + 1);
+                levels = std::max(levels, level + 1);
+            }
+        }
+    }
+    copy_image_data(data, faces, levels, *job);
+    job->uploaded_level = job->num_levels;
+    job->face = 0;
+    job->offset = 0;
+    _stats.pending_bytes += job->bytes;
+    if (done) {
+        job->done.push_back(std::move(done));
+    }
+}
+
+void UploadQueue::finish(Job &job, bool ok) {
+    for (auto &done : job.done) {
+        done(ok);
+    }
+}
+
+size_t UploadQueue::write_buffer(Job &job, size_t bytes_left, bool first, bool &ok) {
+    const std::vector<uint8_t> &data = job.data[0];
+    size_t bytes = std::min(data.size() - job.offset, bytes_left);
+    if (bytes == 0 && first) {
+        bytes = data.size() - job.offset;
+    }
+    ok = bytes == 0 || sg_ext_write_buffer({job.id}, job.offset, {data.data() + job.offset, bytes});
+    job.offset += bytes;
+    return bytes;
+}
+
+size_t UploadQueue::write_image(Job &job, size_t bytes_left, bool first, bool &ok) {
+    const sg_image img = {job.id};
+    size_t bytes = 0;
+    ok = true;
+    // whole rows of blocks (or slices), coarsest level first
+    while (job.uploaded_level > 0) {
+        const uint32_t level = job.uploaded_level - 1;
+        const int parts = sg_ext_image_parts(img, int(level));
+        if (parts == 0) {
+            ok = false;
+            return bytes;
+        }
+        for (; job.face < job.num_faces; job.face++, job.offset = 0) {
+            const std::vector<uint8_t> &data = job.data[job.face * job.num_levels + level];
+            if (data.empty()) {
+                continue;
+            }
+            if (data.size() % size_t(parts) != 0) {
+                log_error("upload queue: level %u of image %u isn't made of %d rows or slices", level, job.id, parts);
+                ok = false;
+                return bytes;
+            }
+            const size_t part_bytes = data.size() / size_t(parts);
+            const int written = int(job.offset / part_bytes);
+            const int left = parts - written;
+            int count = int(std::min<size_t>(size_t(left), (bytes_left - std::min(bytes, bytes_left)) / part_bytes));
+            if (count == 0 && first && bytes == 0) {
+                count = 1;
+            }
+            if (count == 0) {
+                return bytes;
+            }
+            if (!sg_ext_write_image(img, int(job.face), int(level), written, count,
+                                    {data.data() + job.offset, count * part_bytes})) {
+                ok = false;
+                return bytes;
+            }
+            job.offset += count * part_bytes;
+            bytes += count * part_bytes;
+            if (count < left) {
+                return bytes;
+            }
+        }
+        job.face = 0;
+        job.uploaded_level = level;
+        // created images are sampled from their smallest level as soon as it is complete
+        if (job.type == JobType::MakeImage) {
+            sg_ext_set_image_base_level(img, int(level));
+            if (sg_query_image_state(img) == SG_RESOURCESTATE_ALLOC) {
+                sg_ext_commit_image(img);
+            }
+        }
+    }
+    return bytes;
+}
+
+size_t UploadQueue::run(Job &job, size_t bytes_left, bool first, bool &finished) {
+    finished = true;
+    switch (job.type) {
+    case JobType::MakeBuffer: {
+        // the buffer may have been destroyed before its creation
+        if (sg_query_buffer_state({job.id}) != SG_RESOURCESTATE_ALLOC) {
+            finish(job, false);
+            return 0;
+        }
+        sg_buffer_desc desc = job.buffer_desc;
+        desc.data = {job.data[0].empty() ? nullptr : job.data[0].data(), job.data[0].size()};
+        desc.label = job.label.empty() ? nullptr : job.label.c_str();
+        // larger than the bytes left, the buffer is allocated then written in ranges, and drawn once complete
+        if (!job.split &&
+            (job.data[0].empty() || job.bytes <= bytes_left || !sg_ext_init_buffer_storage({job.id}, &desc))) {
+            sg_init_buffer({job.id}, &desc);
+            finish(job, sg_query_buffer_state({job.id}) == SG_RESOURCESTATE_VALID);
+            return job.bytes;
+        }
+        job.split = true;
+        bool ok = true;
+        const size_t bytes = write_buffer(job, bytes_left, first, ok);
+        finished = !ok || job.offset == job.data[0].size();
+        if (ok && finished) {
+            sg_ext_commit_buffer({job.id});
+        }
+        if (finished) {
+            finish(job, ok);
+        }
+        return bytes;
+    }
+    case JobType::MakeImage: {
+        const sg_resource_state state = sg_query_image_state({job.id});
+        if (state == SG_RESOURCESTATE_INITIAL || state == SG_RESOURCESTATE_INVALID) {
+            finish(job, false);
+            return 0;
+        }
+        if (!job.split) {
+            if (state != SG_RESOURCESTATE_ALLOC) {
+                sg_uninit_image({job.id});
+            }
+            sg_image_desc desc = job.image_desc;
+            desc.label = job.label.empty() ? nullptr : job.label.c_str();
+            // larger than the bytes left, the levels of immutable images are allocated then written in parts
+            const bool immutable =
+                job.image_desc.usage == _SG_USAGE_DEFAULT || job.image_desc.usage == SG_USAGE_IMMUTABLE;
+            const bool split = immutable && !job.image_desc.render_target && job.bytes > bytes_left &&
+                               sg_ext_init_image_storage({job.id}, &desc);
+            if (!split) {
+                desc.data = {};
+                for (uint32_t face = 0; face < job.num_faces; face++) {
+                    for (uint32_t level = 0; level < job.num_levels; level++) {
+                        const auto &data = job.data[face * job.num_levels + level];
+                        desc.data.subimage[face][level] = {data.empty() ? nullptr : data.data(), data.size()};
+                    }
+                }
+                sg_init_image({job.id}, &desc);
+                finish(job, sg_query_image_state({job.id}) == SG_RESOURCESTATE_VALID);
+                return job.bytes;
+            }
+            job.split = true;
+        }
+        bool ok = true;
+        const size_t bytes = write_image(job, bytes_left, first, ok);
+        finished = !ok || job.uploaded_level == 0;
+        if (finished) {
+            finish(job, ok);
+        }
+        return bytes;
+    }
+    case JobType::UpdateBuffer: {
+        if (sg_query_buffer_state({job.id}) != SG_RESOURCESTATE_VALID) {
+            finish(job, false);
+            return 0;
+        }
+        // larger than the bytes left, the update is written in ranges to the buffer not in use
+        if (!job.split && job.bytes <= bytes_left) {
+            sg_update_buffer({job.id}, {job.data[0].data(), job.data[0].size()});
+            finish(job, true);
+            return job.bytes;
+        }
+        job.split = true;
+        bool ok = true;
+        const size_t bytes = write_buffer(job, bytes_left, first, ok);
+        finished = !ok || job.offset == job.data[0].size();
+        if (ok && finished) {
+            sg_ext_commit_buffer({job.id});
+        }
+        if (finished) {
+            finish(job, ok);
+        }
+        return bytes;
+    }
+    case JobType::UpdateImage: {
+        if (sg_query_image_state({job.id}) != SG_RESOURCESTATE_VALID) {
+            finish(job, false);
+            return 0;
+        }
+        if (!job.split && job.bytes <= bytes_left) {
+            sg_image_data data = {};
+            for (uint32_t face = 0; face < job.num_faces; face++) {
+                for (uint32_t level = 0; level < job.num_levels; level++) {
+                    const auto &d = job.data[face * job.num_levels + level];
+                    data.subimage[face][level] = {d.empty() ? nullptr : d.data(), d.size()};
+                }
+            }
+            sg_update_image({job.id}, &data);
+            finish(job, true);
+            return job.bytes;
+        }
+        job.split = true;
+        bool ok = true;
+        const size_t bytes = write_image(job, bytes_left, first, ok);
+        finished = !ok || job.uploaded_level == 0;
+        if (ok && finished) {
+            sg_ext_commit_image({job.id});
+        }
+        if (finished) {
+            finish(job, ok);
+        }
+        return bytes;
+    }
+    }
+    return 0;
+}
+
+void UploadQueue::process() {
+    const double start = now_ms();
+    _stats.frame_bytes = 0;
+    // a job waiting for a resource created by an earlier job stops the queue, to keep the order of the uploads
+    while (!_jobs.empty()) {
+        const size_t bytes_left =
+            _stats.frame_bytes < budget.bytes_per_frame ? budget.bytes_per_frame - _stats.frame_bytes : 0;
+        if (_stats.frame_bytes > 0 && (bytes_left == 0 || now_ms() - start >= budget.ms_per_frame)) {
+            _stats.num_deferred++;
+            break;
+        }
+        Job &job = _jobs.front();
+        bool finished = false;
+        const size_t bytes = std::min(run(job, bytes_left, _stats.frame_bytes == 0, finished), job.bytes);
+        _stats.frame_bytes += bytes;
+        _stats.total_bytes += bytes;
+        _stats.pending_bytes -= bytes;
+        job.bytes -= bytes;
+        if (finished) {
+            // what is left of a failed job
+            _stats.pending--;
+            _stats.pending_bytes -= job.bytes;
+            _jobs.pop_front();
+        } else if (bytes == 0) {
+            break;
+        }
+    }
+    _stats.frame_ms = now_ms() - start;
+}
+
+void UploadQueue::flush() {
+    const UploadBudget frame_budget = budget;
+    budget = {~size_t(0), 1e30};
+    process();
+    budget = frame_budget;
+}
+
+void UploadQueue::terminate() {
+    _jobs.clear();
+    const uint64_t total_bytes = _stats.total_bytes;
+    _stats = UploadStats();
+    _stats.total_bytes = total_bytes;
+}
+
+} // namespace glengine
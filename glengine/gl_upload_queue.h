@@ -0,0 +1,96 @@
+#pragma once
+
+#include "sokol_gfx.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace glengine {
+
+/// limits of the uploads done by a frame. The first upload of a frame is always done, even if it doesn't fit
+struct UploadBudget {
+    size_t bytes_per_frame = size_t(8) << 20;
+    double ms_per_frame = 2.0;
+};
+
+struct UploadStats {
+    uint32_t pending = 0;      ///< queued uploads
+    size_t pending_bytes = 0;  ///< of the queued uploads
+    size_t frame_bytes = 0;    ///< uploaded by the last process()
+    double frame_ms = 0.0;     ///< spent by the last process()
+    uint64_t total_bytes = 0;  ///< uploaded since init
+    uint64_t num_deferred = 0; ///< frames that left uploads for the next ones
+};
+
+/// called when an upload is done, with false if the resource couldn't be created or was destroyed before
+using UploadCallback = std::function<void(bool ok)>;
+
+/// deferred creation and update of buffers and images, drained once per frame (see GLEngine::render) within a
+/// budget so that loading content doesn't stall the frames. Resources are allocated right away and their handles can
+/// be bound immediately: sokol skips the draws using them until they are initialized. The data is copied.
+/// Uploads larger than the bytes left for the frame are split (see sokol_gfx_ext.h): buffers in byte ranges, drawn
+/// once complete, and images in rows (slices of 3D and array images) of one mip level at a time, smallest level
+/// first, each written once. Immutable images can be sampled (blurry) as soon as their smallest level is written, and
+/// get their finer levels in the following frames. Updates are written to the buffer or image not in use and swapped
+/// in when complete. Updates of a resource are coalesced, the latest data replaces the pending one (and restarts a
+/// split update), so there is at most one update per resource and frame
+class UploadQueue {
+  public:
+    sg_buffer make_buffer(const sg_buffer_desc &desc, UploadCallback done = nullptr);
+    sg_image make_image(const sg_image_desc &desc, UploadCallback done = nullptr);
+    /// same as make_image, for an image already created: its content is replaced, keeping its handle
+    void remake_image(sg_image img, const sg_image_desc &desc, UploadCallback done = nullptr);
+    void update_buffer(sg_buffer buf, const sg_range &data, UploadCallback done = nullptr);
+    void update_image(sg_image img, const sg_image_data &data, UploadCallback done = nullptr);
+
+    /// upload within the budget, has to be called once per frame before drawing
+    void process();
+    /// upload everything now, ignoring the budget (i.e. before taking a screenshot)
+    void flush();
+    /// discard the pending uploads, without calling their callbacks
+    void terminate();
+
+    const UploadStats &stats() const { return _stats; }
+
+    UploadBudget budget;
+
+  private:
+    enum class JobType { MakeBuffer, MakeImage, UpdateBuffer, UpdateImage };
+    struct Job {
+        JobType type;
+        uint32_t id = SG_INVALID_ID; ///< of the buffer or image
+        sg_buffer_desc buffer_desc = {};
+        sg_image_desc image_desc = {};
+        /// data of the buffer, or of the image levels (face major, then mip levels)
+        std::vector<std::vector<uint8_t>> data;
+        std::string label; ///< the label of the descriptor may not outlive the call
+        uint32_t num_faces = 1;
+        uint32_t num_levels = 1;
+        uint32_t uploaded_level = 0; ///< finest level written by the previous chunks, num_levels if none
+        uint32_t face = 0;           ///< of the level being written
+        size_t offset = 0;           ///< bytes written of the buffer, or of the face of the level being written
+        bool split = false;          ///< written in chunks, the storage of a created resource being allocated
+        std::vector<UploadCallback> done;
+        size_t bytes = 0; ///< left to upload
+    };
+
+    /// upload the job, or its next chunk if it doesn't fit in the bytes left for the frame (the first upload of a
+    /// frame always writes something). Returns the bytes uploaded, and sets finished when the job is done
+    size_t run(Job &job, size_t bytes_left, bool first, bool &finished);
+    /// next chunk of a split job, ok is false if the resource was destroyed
+    size_t write_buffer(Job &job, size_t bytes_left, bool first, bool &ok);
+    size_t write_image(Job &job, size_t bytes_left, bool first, bool &ok);
+    void finish(Job &job, bool ok);
+    void copy_image_data(const sg_image_data &data, uint32_t num_faces, uint32_t num_levels, Job &job);
+    void queue(Job &&job);
+    Job *pending_update(JobType type, uint32_t id);
+
+    std::deque<Job> _jobs;
+    UploadStats _stats;
+};
+
+} // namespace glengine
@@ -1,9 +1,18 @@
+// 64 bit off_t for fseeko and ftello on 32 bit platforms, before any system header
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+#endif
+
 #include "gl_utils.h"
 #include "gl_object.h"
 #include "gl_mesh.h"
 
+#include <sys/stat.h>
+#include <sys/types.h>
+
 #include <cstdint>
 #include <limits>
+#include <vector>
 
 namespace glengine {
 uint32_t murmur_hash2_32(const void *key, int len, uint32_t seed) {
@@ -82,30 +91,108 @@ uint64_t murmur_hash2_64(const void *key, int len, uint64_t seed) {
     return h;
 }
 
-// struct Extents {
-//     math::Vector3f bl;
-//     math::Vector3f tr;
-// };
-void calc_object_extents(const glengine::Object *obj, bool with_children, math::Vector3f &bl, math::Vector3f &tr) {
+// extents of the object in the space given by tf (children are placed with their own transform and scale)
+void calc_object_extents(const glengine::Object *obj, bool with_children, const math::Matrix4f &tf,
+                         math::Vector3f &bl, math::Vector3f &tr) {
     for (const auto &r : obj->_renderables) {
         const auto m = r.mesh;
         if (m) {
-            for (const auto &v : m->vertices) {
-                bl.x = std::min(bl.x, v.pos.x);
-                bl.y = std::min(bl.y, v.pos.y);
-                bl.z = std::min(bl.z, v.pos.z);
-                tr.x = std::max(tr.x, v.pos.x);
-                tr.y = std::max(tr.y, v.pos.y);
-                tr.z = std::max(tr.z, v.pos.z);
+            for (size_t i = 0; i < m->num_vertices(); i++) {
+                const math::Vector3f pos = tf * m->position(i);
+                bl.x = std::min(bl.x, pos.x);
+                bl.y = std::min(bl.y, pos.y);
+                bl.z = std::min(bl.z, pos.z);
+                tr.x = std::max(tr.x, pos.x);
+                tr.y = std::max(tr.y, pos.y);
+                tr.z = std::max(tr.z, pos.z);
             }
         }
-        // recurse into children
-        if (with_children) {
-            for (const auto &c : obj->_children) {
-                calc_object_extents(c, with_children, bl, tr);
+    }
+    // recurse into children
+    if (with_children) {
+        for (const auto &c : obj->_children) {
+            calc_object_extents(c, with_children, tf * c->_transform * c->_scale, bl, tr);
+        }
+    }
+}
+
+int64_t file_mtime(const char *filename) {
+    struct stat st;
+    if (stat(filename, &st) != 0) {
+        return -1;
+    }
+#if defined(__APPLE__)
+    return int64_t(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#else
+    return int64_t(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#endif
+}
+
+bool file_seek(FILE *f, uint64_t offset) {
+#ifdef _WIN32
+    return _fseeki64(f, int64_t(offset), SEEK_SET) == 0;
+#else
+    return fseeko(f, off_t(offset), SEEK_SET) == 0;
+#endif
+}
+
+int64_t file_size(FILE *f) {
+#ifdef _WIN32
+    return _fseeki64(f, 0, SEEK_END) == 0 ? int64_t(_ftelli64(f)) : -1;
+#else
+    return fseeko(f, 0, SEEK_END) == 0 ? int64_t(ftello(f)) : -1;
+#endif
+}
+
+std::string normalize_path(const std::string &path) {
+    std::vector<std::string> segments;
+    size_t start = 0;
+    while (start <= path.size()) {
+        size_t end = path.find_first_of("/\\", start);
+        if (end == std::string::npos) {
+            end = path.size();
+        }
+        std::string segment = path.substr(start, end - start);
+        if (segment == "..") {
+            if (!segments.empty() && segments.back() != ".." && !segments.back().empty()) {
+                segments.pop_back();
+            } else {
+                segments.push_back(segment);
             }
+        } else if (segment != "." && (!segment.empty() || segments.empty())) {
+            segments.push_back(segment);
+        }
+        start = end + 1;
+    }
+    std::string normalized;
+    for (size_t i = 0; i < segments.size(); i++) {
+        normalized += (i > 0 ? "/" : "") + segments[i];
+    }
+    return normalized;
+}
+
+void frustum_planes(const math::Matrix4f &m, math::Vector4f planes[6]) {
+    for (int i = 0; i < 3; i++) {
+        for (int side = 0; side < 2; side++) {
+            const float s = side ? -1.0f : 1.0f;
+            planes[i * 2 + side] = {m(3, 0) + s * m(i, 0), m(3, 1) + s * m(i, 1), m(3, 2) + s * m(i, 2),
+                                    m(3, 3) + s * m(i, 3)};
+        }
+    }
+}
+
+bool intersects(const math::Vector4f planes[6], const math::Vector3f &bbox_min, const math::Vector3f &bbox_max) {
+    for (int i = 0; i < 6; i++) {
+        const math::Vector4f &p = planes[i];
+        // corner of the box the furthest along the normal of the plane
+        const float x = p.x > 0.0f ? bbox_max.x : bbox_min.x;
+        const float y = p.y > 0.0f ? bbox_max.y : bbox_min.y;
+        const float z = p.z > 0.0f ? bbox_max.z : bbox_min.z;
+        if (p.x * x + p.y * y + p.z * z + p.w < 0.0f) {
+            return false;
         }
     }
+    return true;
 }
 
 // return the bounding box of this object
@@ -114,7 +201,7 @@ AABB calc_bounding_box(const glengine::Object *obj, bool include_children) {
                          std::numeric_limits<float>::max()}; // bottom left
     math::Vector3f tr = {std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(),
                          std::numeric_limits<float>::lowest()}; // top right
-    calc_object_extents(obj, include_children, bl, tr);
+    calc_object_extents(obj, include_children, math::matrix4_identity<float>(), bl, tr);
     return AABB{(tr+bl)/2.0f, tr-bl};
 }
 
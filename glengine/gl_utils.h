@@ -3,6 +3,8 @@
 #include "math/vmath_types.h"
 
 #include <cstdint>
+#include <cstdio>
+#include <string>
 
 namespace glengine {
 
@@ -14,14 +16,34 @@ uint32_t murmur_hash2_32(const void *key, int len, uint32_t seed);
 /// https://github.com/aappleby/smhasher/blob/master/src/MurmurHash2.h
 uint64_t murmur_hash2_64(const void *key, int len, uint64_t seed);
 
+/// last modification time of a file (nanoseconds since epoch), or -1 if the file can't be accessed. Edits within
+/// the same second still change it
+int64_t file_mtime(const char *filename);
+
+/// seek from the start of the file and size of the file (-1 on error), with 64 bit offsets: fseek and ftell take a
+/// long, which is 32 bit on windows, and files can be larger than 2GB. file_size leaves the position at the end
+bool file_seek(FILE *f, uint64_t offset);
+int64_t file_size(FILE *f);
+
+/// lexically remove "." and ".." segments from a path, so that different relative paths to the same file compare equal
+std::string normalize_path(const std::string &path);
+
 struct AABB {
     math::Vector3f center;
     math::Vector3f size;
 };
 
+/// planes of the frustum of a (model) view projection matrix, in the space of the model: a point p is inside when
+/// dot(plane.xyz, p) + plane.w >= 0 for all the planes
+void frustum_planes(const math::Matrix4f &m, math::Vector4f planes[6]);
+
+/// false when the box is completely outside of one of the frustum planes
+bool intersects(const math::Vector4f planes[6], const math::Vector3f &bbox_min, const math::Vector3f &bbox_max);
+
 class Object;
 
-/// return the bounding box of this object
+/// return the bounding box of this object, in its own space (the transform of the children is applied, not the one of
+/// the object itself)
 AABB calc_bounding_box(const glengine::Object *obj, bool include_children);
 
 
@@ -0,0 +1,344 @@
+#include "gl_volume.h"
+#include "gl_camera.h"
+#include "gl_engine.h"
+#include "gl_logger.h"
+#include "gl_thread_pool.h"
+#include "generated/shaders/volume.glsl.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+// corners of a unit box as a triangle strip of 14 vertices, all its triangles clockwise seen from the outside
+const float box_strip[14][3] = {{0, 0, 0}, {1, 0, 0}, {0, 1, 0}, {1, 1, 0}, {1, 1, 1}, {1, 0, 0}, {1, 0, 1},
+                                {0, 0, 0}, {0, 0, 1}, {0, 1, 0}, {0, 1, 1}, {1, 1, 1}, {0, 0, 1}, {1, 0, 1}};
+
+double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+namespace glengine {
+
+bool load_volume_raw(const char *filename, uint32_t width, uint32_t height, uint32_t depth, uint32_t bits,
+                     VolumeData &volume) {
+    const size_t num_voxels = size_t(width) * height * depth;
+    const size_t voxel_size = bits == 16 ? 2 : 1;
+    std::vector<uint8_t> bytes(num_voxels * voxel_size);
+    FILE *f = (bits == 8 || bits == 16) ? fopen(filename, "rb") : nullptr;
+    const bool ok = f && fread(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    if (f) {
+        fclose(f);
+    }
+    if (!ok || bytes.empty()) {
+        log_error("unable to read %ux%ux%u voxels of %u bits from '%s'", width, height, depth, bits, filename);
+        return false;
+    }
+    volume.width = width;
+    volume.height = height;
+    volume.depth = depth;
+    if (bits == 8) {
+        volume.voxels = std::move(bytes);
+        return true;
+    }
+    std::vector<uint16_t> values(num_voxels);
+    for (size_t i = 0; i < num_voxels; i++) {
+        values[i] = uint16_t(bytes[2 * i] | (bytes[2 * i + 1] << 8));
+    }
+    const auto minmax = std::minmax_element(values.begin(), values.end());
+    const float scale = *minmax.second > *minmax.first ? 255.0f / (*minmax.second - *minmax.first) : 0.0f;
+    volume.voxels.resize(num_voxels);
+    for (size_t i = 0; i < num_voxels; i++) {
+        volume.voxels[i] = uint8_t((values[i] - *minmax.first) * scale + 0.5f);
+    }
+    return true;
+}
+
+std::vector<Color> make_transfer_function(const std::vector<TransferKey> &keys) {
+    std::vector<Color> colors(256, Color{0, 0, 0, 0});
+    if (keys.empty()) {
+        return colors;
+    }
+    std::vector<TransferKey> sorted = keys;
+    std::stable_sort(sorted.begin(), sorted.end(),
+                     [](const TransferKey &a, const TransferKey &b) { return a.value < b.value; });
+    size_t k = 0;
+    for (int i = 0; i < 256; i++) {
+        while (k + 1 < sorted.size() && sorted[k + 1].value <= i) {
+            k++;
+        }
+        const TransferKey &a = sorted[k];
+        const TransferKey &b = sorted[std::min(k + 1, sorted.size() - 1)];
+        const float f = b.value > a.value ? std::min(std::max((i - a.value) / (b.value - a.value), 0.0f), 1.0f) : 0.0f;
+        auto lerp = [f](uint8_t x, uint8_t y) { return uint8_t(x + (float(y) - float(x)) * f + 0.5f); };
+        colors[i] = {lerp(a.color.r, b.color.r), lerp(a.color.g, b.color.g), lerp(a.color.b, b.color.b),
+                     lerp(a.color.a, b.color.a)};
+    }
+    return colors;
+}
+
+bool Volume::init(GLEngine &eng, const VolumeData &data) {
+    const size_t num_voxels = size_t(data.width) * data.height * data.depth;
+    if (num_voxels == 0 || data.voxels.size() != num_voxels) {
+        log_error("volume: %ux%ux%u voxels expected, %zu given", data.width, data.height, data.depth,
+                  data.voxels.size());
+        return false;
+    }
+    if (!sg_query_features().imagetype_3d) {
+        log_error("volume: 3D textures are not supported");
+        return false;
+    }
+    const uint32_t max_size = uint32_t(sg_query_limits().max_image_size_3d);
+    if (std::max({data.width, data.height, data.depth}) > max_size) {
+        log_error("volume: %ux%ux%u voxels, larger than the 3D textures (%u per side)", data.width, data.height,
+                  data.depth, max_size);
+        return false;
+    }
+    _eng = &eng;
+    _dims[0] = data.width;
+    _dims[1] = data.height;
+    _dims[2] = data.depth;
+    _cell_size = std::max(params.cell_size, 1u);
+    for (int i = 0; i < 3; i++) {
+        _cells[i] = (_dims[i] + _cell_size - 1) / _cell_size;
+    }
+    const uint32_t num_cells = _cells[0] * _cells[1] * _cells[2];
+
+    // range of each cell, over the voxels read by the trilinear filtering within it: one more on each side
+    _cell_min.assign(num_cells, 255);
+    _cell_max.assign(num_cells, 0);
+    parallel_for(0, _cells[2], 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t cz = begin; cz < end; cz++) {
+            const uint32_t z0 = cz * _cell_size > 0 ? cz * _cell_size - 1 : 0;
+            const uint32_t z1 = std::min((cz + 1) * _cell_size + 1, _dims[2]);
+            for (uint32_t cy = 0; cy < _cells[1]; cy++) {
+                const uint32_t y0 = cy * _cell_size > 0 ? cy * _cell_size - 1 : 0;
+                const uint32_t y1 = std::min((cy + 1) * _cell_size + 1, _dims[1]);
+                for (uint32_t cx = 0; cx < _cells[0]; cx++) {
+                    const uint32_t x0 = cx * _cell_size > 0 ? cx * _cell_size - 1 : 0;
+                    const uint32_t x1 = std::min((cx + 1) * _cell_size + 1, _dims[0]);
+                    uint8_t lo = 255, hi = 0;
+                    for (uint32_t z = z0; z < z1; z++) {
+                        for (uint32_t y = y0; y < y1; y++) {
+                            const uint8_t *row = &data.voxels[(size_t(z) * _dims[1] + y) * _dims[0]];
+                            const auto minmax = std::minmax_element(row + x0, row + x1);
+                            lo = std::min(lo, *minmax.first);
+                            hi = std::max(hi, *minmax.second);
+                        }
+                    }
+                    const size_t cell = (size_t(cz) * _cells[1] + cy) * _cells[0] + cx;
+                    _cell_min[cell] = lo;
+                    _cell_max[cell] = hi;
+                }
+            }
+        }
+    });
+    _cell_distances.assign(num_cells, 0);
+
+    sg_image_desc desc = {0};
+    desc.type = SG_IMAGETYPE_3D;
+    desc.width = int(_dims[0]);
+    desc.height = int(_dims[1]);
+    desc.num_slices = int(_dims[2]);
+    desc.pixel_format = SG_PIXELFORMAT_R8;
+    desc.min_filter = desc.mag_filter = SG_FILTER_LINEAR;
+    desc.wrap_u = desc.wrap_v = desc.wrap_w = SG_WRAP_CLAMP_TO_EDGE;
+    desc.data.subimage[0][0] = {data.voxels.data(), num_voxels};
+    desc.label = "volume-voxels";
+    _voxels = sg_make_image(desc);
+    // the distances and the transfer function are uploaded by update()
+    desc.width = int(_cells[0]);
+    desc.height = int(_cells[1]);
+    desc.num_slices = int(_cells[2]);
+    desc.usage = SG_USAGE_DYNAMIC;
+    desc.min_filter = desc.mag_filter = SG_FILTER_NEAREST;
+    desc.data = {};
+    desc.label = "volume-distances";
+    _distances = sg_make_image(desc);
+    desc.type = SG_IMAGETYPE_2D;
+    desc.width = 256;
+    desc.height = 1;
+    desc.num_slices = 1;
+    desc.pixel_format = SG_PIXELFORMAT_RGBA8;
+    desc.min_filter = desc.mag_filter = SG_FILTER_LINEAR;
+    desc.label = "volume-transfer";
+    _transfer = sg_make_image(desc);
+    _box = sg_make_buffer(
+        (sg_buffer_desc){.size = sizeof(box_strip), .data = SG_RANGE(box_strip), .label = "volume-box"});
+
+    ResourceManager &rm = eng.resource_manager();
+    sg_pipeline_desc pip_desc = {0};
+    pip_desc.layout.attrs[ATTR_vs_volume_corner].format = SG_VERTEXFORMAT_FLOAT3;
+    pip_desc.shader = rm.get_or_create_shader(*volume_shader_desc(sg_query_backend()));
+    pip_desc.primitive_type = SG_PRIMITIVETYPE_TRIANGLE_STRIP;
+    // only the back faces, the rays start at the front ones or at the camera. The depth of the scene is read in the
+    // shader, which stops the rays at the opaque objects
+    pip_desc.cull_mode = SG_CULLMODE_FRONT;
+    pip_desc.face_winding = SG_FACEWINDING_CW;
+    pip_desc.depth = {.pixel_format = SG_PIXELFORMAT_DEPTH_STENCIL,
+                      .compare = SG_COMPAREFUNC_ALWAYS,
+                      .write_enabled = false};
+    // premultiplied, over the scene, in the single color target of the post pass
+    pip_desc.colors[0].blend = {.enabled = true,
+                                .src_factor_rgb = SG_BLENDFACTOR_ONE,
+                                .dst_factor_rgb = SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA,
+                                .src_factor_alpha = SG_BLENDFACTOR_ONE,
+                                .dst_factor_alpha = SG_BLENDFACTOR_ONE_MINUS_SRC_ALPHA};
+    pip_desc.color_count = 1;
+    pip_desc.sample_count = sg_query_features().msaa_render_targets ? eng._config.msaa_samples : 1;
+    pip_desc.label = "volume pipeline";
+    _pip = rm.get_or_create_pipeline(pip_desc);
+
+    if (transfer_function.size() != 256) {
+        transfer_function = make_transfer_function({{0.0f, {0, 0, 0, 0}}, {255.0f, {255, 255, 255, 64}}});
+    }
+    _uploaded_transfer.clear();
+    _stats = VolumeStats();
+    _stats.num_cells = num_cells;
+    _stats.texture_bytes = num_voxels + num_cells + 256 * sizeof(Color);
+    log_debug("volume: %ux%ux%u voxels, %ux%ux%u cells", _dims[0], _dims[1], _dims[2], _cells[0], _cells[1],
+              _cells[2]);
+    return _pip.id != SG_INVALID_ID;
+}
+
+void Volume::terminate() {
+    for (sg_image image : {_voxels, _distances, _transfer}) {
+        sg_destroy_image(image);
+    }
+    sg_destroy_buffer(_box);
+    _voxels = _distances = _transfer = {SG_INVALID_ID};
+    _box = {SG_INVALID_ID};
+    _cell_min.clear();
+    _cell_max.clear();
+    _cell_distances.clear();
+    _uploaded_transfer.clear();
+    _stats = VolumeStats();
+    _eng = nullptr;
+}
+
+void Volume::classify() {
+    // number of opaque values up to each one, so that a range has one when the counts at its ends differ
+    uint32_t opaque[257] = {0};
+    for (int i = 0; i < 256; i++) {
+        opaque[i + 1] = opaque[i] + (transfer_function[i].a > 0 ? 1 : 0);
+    }
+    const uint32_t nx = _cells[0], ny = _cells[1], nz = _cells[2];
+    const uint32_t num_cells = nx * ny * nz;
+    std::vector<uint16_t> d(num_cells);
+    _stats.num_occupied = 0;
+    for (uint32_t i = 0; i < num_cells; i++) {
+        const bool occupied = opaque[_cell_max[i] + 1] > opaque[_cell_min[i]];
+        d[i] = occupied ? 0 : 0xffff;
+        _stats.num_occupied += occupied ? 1 : 0;
+    }
+    // Chebyshev distance to the occupied cells, in a forward and a backward pass over the 26 neighbours: within d - 1
+    // cells of a cell at distance d all the cells are empty
+    auto relax = [&](int x, int y, int z, int sign) {
+        uint16_t &v = d[(size_t(z) * ny + y) * nx + x];
+        for (int dz = -1; dz <= 0; dz++) {
+            for (int dy = -1; dy <= 1; dy++) {
+                for (int dx = -1; dx <= 1; dx++) {
+                    // the 13 neighbours before the cell in the order of the pass
+                    if (dz == 0 && (dy > 0 || (dy == 0 && dx >= 0))) {
+                        continue;
+                    }
+                    const int x1 = x + sign * dx, y1 = y + sign * dy, z1 = z + sign * dz;
+                    if (x1 < 0 || y1 < 0 || z1 < 0 || x1 >= int(nx) || y1 >= int(ny) || z1 >= int(nz)) {
+                        continue;
+                    }
+                    const uint16_t n = d[(size_t(z1) * ny + y1) * nx + x1];
+                    v = std::min<uint16_t>(v, n == 0xffff ? n : n + 1);
+                }
+            }
+        }
+    };
+    for (int z = 0; z < int(nz); z++) {
+        for (int y = 0; y < int(ny); y++) {
+            for (int x = 0; x < int(nx); x++) {
+                relax(x, y, z, 1);
+            }
+        }
+    }
+    for (int z = int(nz) - 1; z >= 0; z--) {
+        for (int y = int(ny) - 1; y >= 0; y--) {
+            for (int x = int(nx) - 1; x >= 0; x--) {
+                relax(x, y, z, -1);
+            }
+        }
+    }
+    for (uint32_t i = 0; i < num_cells; i++) {
+        _cell_distances[i] = uint8_t(std::min<uint16_t>(d[i], 255));
+    }
+}
+
+void Volume::update() {
+    if (_pip.id == SG_INVALID_ID || transfer_function.size() != 256) {
+        return;
+    }
+    if (_uploaded_transfer.size() == 256 &&
+        std::memcmp(transfer_function.data(), _uploaded_transfer.data(), 256 * sizeof(Color)) == 0) {
+        return;
+    }
+    const double start = now_ms();
+    classify();
+    _stats.classify_ms = now_ms() - start;
+    sg_image_data distances = {};
+    distances.subimage[0][0] = {_cell_distances.data(), _cell_distances.size()};
+    sg_update_image(_distances, distances);
+    sg_image_data transfer = {};
+    transfer.subimage[0][0] = {transfer_function.data(), transfer_function.size() * sizeof(Color)};
+    sg_update_image(_transfer, transfer);
+    _uploaded_transfer = transfer_function;
+}
+
+void Volume::draw(const Camera &cam) {
+    _stats.num_draws = 0;
+    if (_pip.id == SG_INVALID_ID || _uploaded_transfer.empty()) {
+        return;
+    }
+    const math::Matrix4f &proj = cam.projection();
+    const math::Matrix4f &cam_tf = cam.transform();
+    const bool perspective = proj(3, 2) != 0.0f;
+    const math::Matrix4f view_projection = proj * cam.inverse_transform();
+    // camera position, or view direction, in texture space
+    const math::Vector3f &o = params.origin;
+    const math::Vector3f &s = params.size;
+    math::Vector4f eye = {-cam_tf(0, 2) / s.x, -cam_tf(1, 2) / s.y, -cam_tf(2, 2) / s.z, 0.0f};
+    if (perspective) {
+        eye = {(cam_tf(0, 3) - o.x) / s.x, (cam_tf(1, 3) - o.y) / s.y, (cam_tf(2, 3) - o.z) / s.z, 1.0f};
+    }
+    // step in texture space, of the largest side, and the opacities corrected for it
+    const float step = std::max(params.step, 0.01f);
+    const float dt = step / float(std::max({_dims[0], _dims[1], _dims[2]}));
+    _stats.max_iterations = uint32_t(std::ceil(1.7321f / dt)) + 2;
+    volume_params_t vparams = {
+        .view_projection = view_projection,
+        .inverse_view_projection = math::inverse(view_projection),
+        .origin = {o.x, o.y, o.z, 1.0f},
+        .size = {s.x, s.y, s.z, 0.0f},
+        .eye = eye,
+        .cells = {float(_dims[0]) / _cell_size, float(_dims[1]) / _cell_size, float(_dims[2]) / _cell_size,
+                  params.skipping ? 1.0f : 0.0f},
+        .march = {dt, step * params.density, float(_stats.max_iterations), params.jitter ? 1.0f : 0.0f},
+        .options = {params.heatmap ? 1.0f : 0.0f, 0.0f, 0.0f, 0.0f}};
+
+    sg_apply_pipeline(_pip);
+    sg_bindings bind = {0};
+    bind.vertex_buffers[0] = _box;
+    bind.fs_images[SLOT_tex_voxels] = _voxels;
+    bind.fs_images[SLOT_tex_distances] = _distances;
+    bind.fs_images[SLOT_tex_transfer] = _transfer;
+    bind.fs_images[SLOT_tex_scene_depth] = _eng->scene_depth();
+    sg_apply_bindings(bind);
+    sg_apply_uniforms(SG_SHADERSTAGE_VS, SLOT_volume_params, SG_RANGE(vparams));
+    sg_apply_uniforms(SG_SHADERSTAGE_FS, SLOT_volume_params, SG_RANGE(vparams));
+    sg_draw(0, 14, 1);
+    _stats.num_draws++;
+}
+
+} // namespace glengine
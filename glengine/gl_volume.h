@@ -0,0 +1,102 @@
+#pragma once
+
+#include "gl_types.h"
+#include "math/vmath.h"
+
+#include "sokol_gfx.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace glengine {
+
+class Camera;
+class GLEngine;
+
+/// scalar field sampled on a regular grid, quantized to 8 bits
+struct VolumeData {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t depth = 0;
+    std::vector<uint8_t> voxels; ///< x first, then y, then z
+};
+
+/// raw voxels of 8 or 16 bits (little endian), the 16 bit ones rescaled from their range to 8 bits
+bool load_volume_raw(const char *filename, uint32_t width, uint32_t height, uint32_t depth, uint32_t bits,
+                     VolumeData &volume);
+
+/// key of a transfer function, at a value from 0 to 255
+struct TransferKey {
+    float value;
+    Color color;
+};
+
+/// transfer function of 256 colors, linearly interpolated between the keys sorted by value
+std::vector<Color> make_transfer_function(const std::vector<TransferKey> &keys);
+
+struct VolumeParams {
+    math::Vector3f origin = {0.0f, 0.0f, 0.0f}; ///< first corner of the volume, in world space
+    math::Vector3f size = {1.0f, 1.0f, 1.0f};   ///< extent of the volume along the axes, in world units
+    uint32_t cell_size = 8;                     ///< voxels per side of the macro cells (used by init)
+    float step = 0.5f;                          ///< between the samples along the rays, in voxels
+    float density = 1.0f;                       ///< scale of the opacities, given per voxel by the transfer function
+    bool skipping = true;                       ///< skip the empty macro cells, else every sample is taken
+    bool jitter = true;                         ///< random offset of the first sample of each ray, against banding
+    bool heatmap = false;                       ///< show the iterations per pixel instead of the volume
+};
+
+struct VolumeStats {
+    uint32_t num_cells = 0;      ///< macro cells
+    uint32_t num_occupied = 0;   ///< cells with a value of non zero opacity, for the current transfer function
+    uint32_t num_draws = 0;      ///< of the last frame
+    uint32_t max_iterations = 0; ///< per ray, skips and samples, as bounded by the step
+    uint64_t texture_bytes = 0;
+    double classify_ms = 0.0;    ///< of the last change of the transfer function
+};
+
+/// 3D scalar fields, ray marched through a transfer function in the fragment shader. The voxels are uploaded as a 3D
+/// texture, and grouped in macro cells of a few voxels per side whose min and max values (of the voxels read by the
+/// trilinear filtering) are computed by init. When the transfer function changes, the cells whose range has no
+/// opaque value are empty, and the Chebyshev distance in cells to the nearest occupied one is stored in a coarse 3D
+/// texture: the rays jump out of the empty cube of cells around their position in one step, so that the cost of the
+/// marching follows the visible content rather than the size of the volume. The rays stop at the depth of the scene
+/// and when almost opaque. The back faces of the bounds are drawn, so that the volume is seen from inside too. It has
+/// to be drawn in a post draw function of the engine (see GLEngine::add_post_draw_function), and composes with the
+/// opaque objects only with MRT, which gives the depth of the scene
+class Volume {
+  public:
+    bool init(GLEngine &eng, const VolumeData &data);
+    void terminate();
+
+    /// classify the macro cells and upload the transfer function when changed, has to be called outside of the passes
+    void update();
+    /// draw the volume, in a post draw function
+    void draw(const Camera &cam);
+
+    const VolumeStats &stats() const { return _stats; }
+
+    VolumeParams params;
+    /// colors of the 256 values, not premultiplied, with the opacity of a voxel (a ramp of gray when not set by init)
+    std::vector<Color> transfer_function;
+
+  private:
+    /// distances of the macro cells from the occupied ones, for the current transfer function
+    void classify();
+
+    GLEngine *_eng = nullptr;
+    sg_pipeline _pip = {SG_INVALID_ID};
+    sg_buffer _box = {SG_INVALID_ID};
+    sg_image _voxels = {SG_INVALID_ID};
+    sg_image _distances = {SG_INVALID_ID};
+    sg_image _transfer = {SG_INVALID_ID};
+    uint32_t _dims[3] = {0, 0, 0};
+    uint32_t _cells[3] = {0, 0, 0};        ///< macro cells per side
+    uint32_t _cell_size = 0;
+    std::vector<uint8_t> _cell_min;        ///< of each macro cell
+    std::vector<uint8_t> _cell_max;
+    std::vector<uint8_t> _cell_distances;  ///< 0 for the occupied cells, up to 255
+    std::vector<Color> _uploaded_transfer; ///< to detect the changes of the transfer function
+    VolumeStats _stats;
+};
+
+} // namespace glengine
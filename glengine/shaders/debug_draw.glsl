@@ -0,0 +1,38 @@
+@ctype mat4 math::Matrix4f
+
+@vs vs_debug_draw
+uniform debug_draw_params {
+    mat4 view_projection;
+};
+
+in vec4 vertex_pos;
+in vec4 vertex_color;
+
+out vec4 color;
+out vec4 proj_pos;
+
+void main() {
+    gl_Position = view_projection * vertex_pos;
+    proj_pos = gl_Position;
+    color = vertex_color;
+}
+@end
+
+@fs fs_debug_draw
+@include common.glsl.inc
+
+in vec4 color;
+in vec4 proj_pos;
+
+layout(location=0) out vec4 out_frag_color;
+layout(location=1) out vec4 out_frag_normal;
+layout(location=2) out vec4 out_frag_depth;
+
+void main() {
+    out_frag_color = color;
+    out_frag_normal = vec4(0.5, 0.5, 0.5, 1.0); // no normal, lines are not shaded
+    out_frag_depth = encodeDepth(proj_pos.z / proj_pos.w);
+}
+@end
+
+@program debug_draw vs_debug_draw fs_debug_draw
@@ -0,0 +1,185 @@
+@ctype mat4 math::Matrix4f
+@ctype vec4 math::Vector4f
+
+// spheres and capped cylinders ray cast in the fragment shader, everything is done in view space
+
+@block params
+uniform impostor_params {
+    mat4 view;
+    mat4 projection;
+    vec4 light_pos; // in view space
+    vec4 options;   // x: 1 for a perspective projection, y: distance of the quads from the camera, past the near plane
+};
+@end
+
+@block shading
+layout(location=0) out vec4 out_frag_color;
+layout(location=1) out vec4 out_frag_normal;
+layout(location=2) out vec4 out_frag_depth;
+
+// ray through the fragment, from the camera
+void view_ray(vec3 view_pos, out vec3 ro, out vec3 rd) {
+    ro = options.x > 0.0 ? vec3(0.0) : vec3(view_pos.xy, 0.0);
+    rd = options.x > 0.0 ? normalize(view_pos) : vec3(0.0, 0.0, -1.0);
+}
+
+// same lighting as the diffuse material, and the depth of the hit point instead of the one of the proxy geometry
+void write_outputs(vec3 hit, vec3 normal, vec4 color) {
+    vec4 clip = projection * vec4(hit, 1.0);
+    float ndc_depth = clip.z / clip.w;
+    gl_FragDepth = ndc_depth * 0.5 + 0.5;
+    float diff = (dot(normal, normalize(light_pos.xyz - hit)) + 1.0) / 2.0;
+    out_frag_color = vec4(vec3(0.1 + diff), 1.0) * color;
+    out_frag_normal = vec4(transpose(mat3(view)) * normal * 0.5 + 0.5, 1.0); // world space
+    out_frag_depth = encodeDepth(ndc_depth);
+}
+@end
+
+// /////// //
+// spheres //
+// /////// //
+
+@vs vs_impostor_sphere
+@include_block params
+
+in vec2 corner; // -1..1
+in vec4 center_radius;
+in vec4 instance_color;
+
+out vec3 view_pos;
+flat out vec4 sphere; // center in view space, radius
+flat out vec4 color;
+
+void main() {
+    vec3 c = (view * vec4(center_radius.xyz, 1.0)).xyz;
+    float r = center_radius.w;
+    // quad perpendicular to the view ray, in front of the sphere, covering the cone tangent to it (nothing is drawn
+    // when the camera is inside of the sphere)
+    vec3 dir = vec3(0.0, 0.0, -1.0);
+    vec3 quad_center = c + vec3(0.0, 0.0, r);
+    float size = r;
+    if (options.x > 0.0) {
+        float d = length(c);
+        dir = c / d;
+        float t = max(d - r, options.y);
+        quad_center = dir * t;
+        size = d > r ? t * r / sqrt(d * d - r * r) : 0.0;
+    }
+    vec3 u = normalize(cross(abs(dir.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0), dir));
+    vec3 v = cross(dir, u);
+    view_pos = quad_center + (u * corner.x + v * corner.y) * size;
+    gl_Position = projection * vec4(view_pos, 1.0);
+    sphere = vec4(c, r);
+    color = instance_color;
+}
+@end
+
+@fs fs_impostor_sphere
+@include common.glsl.inc
+@include_block params
+@include_block shading
+
+in vec3 view_pos;
+flat in vec4 sphere;
+flat in vec4 color;
+
+void main() {
+    vec3 ro, rd;
+    view_ray(view_pos, ro, rd);
+    vec3 oc = ro - sphere.xyz;
+    float b = dot(oc, rd);
+    float h = b * b - dot(oc, oc) + sphere.w * sphere.w;
+    if (h < 0.0) {
+        discard;
+    }
+    vec3 hit = ro + rd * (-b - sqrt(h));
+    write_outputs(hit, (hit - sphere.xyz) / sphere.w, color);
+}
+@end
+
+@program impostor_sphere vs_impostor_sphere fs_impostor_sphere
+
+// ///////// //
+// cylinders //
+// ///////// //
+
+@vs vs_impostor_cylinder
+@include_block params
+
+in vec4 corner; // 0..1, corners of a box
+in vec4 a_radius;
+in vec4 b_pos;
+in vec4 instance_color;
+
+out vec3 view_pos;
+flat out vec4 cylinder_a; // first end in view space, radius
+flat out vec4 cylinder_b;
+flat out vec4 color;
+
+void main() {
+    // box around the cylinder: its back faces are drawn, so that it is still covered with the camera inside
+    vec3 a = (view * vec4(a_radius.xyz, 1.0)).xyz;
+    vec3 b = (view * vec4(b_pos.xyz, 1.0)).xyz;
+    float r = a_radius.w;
+    vec3 axis = b - a;
+    float len = length(axis);
+    vec3 w = len > 0.0 ? axis / len : vec3(0.0, 0.0, 1.0);
+    vec3 u = normalize(cross(abs(w.y) < 0.99 ? vec3(0.0, 1.0, 0.0) : vec3(1.0, 0.0, 0.0), w));
+    vec3 v = cross(w, u);
+    view_pos = a + axis * corner.z + (u * (corner.x * 2.0 - 1.0) + v * (corner.y * 2.0 - 1.0)) * r;
+    gl_Position = projection * vec4(view_pos, 1.0);
+    cylinder_a = vec4(a, r);
+    cylinder_b = vec4(b, 0.0);
+    color = instance_color;
+}
+@end
+
+@fs fs_impostor_cylinder
+@include common.glsl.inc
+@include_block params
+@include_block shading
+
+in vec3 view_pos;
+flat in vec4 cylinder_a;
+flat in vec4 cylinder_b;
+flat in vec4 color;
+
+void main() {
+    vec3 ro, rd;
+    view_ray(view_pos, ro, rd);
+    // intersection with the capped cylinder, see https://iquilezles.org/articles/intersectors
+    float r = cylinder_a.w;
+    vec3 ba = cylinder_b.xyz - cylinder_a.xyz;
+    vec3 oc = ro - cylinder_a.xyz;
+    float baba = dot(ba, ba);
+    float bard = dot(ba, rd);
+    float baoc = dot(ba, oc);
+    float k2 = baba - bard * bard;
+    float k1 = baba * dot(oc, rd) - baoc * bard;
+    float k0 = baba * dot(oc, oc) - baoc * baoc - r * r * baba;
+    float h = k1 * k1 - k2 * k0;
+    if (h < 0.0) {
+        discard;
+    }
+    h = sqrt(h);
+    float t = (-k1 - h) / k2;
+    float y = baoc + t * bard;
+    vec3 normal;
+    if (y > 0.0 && y < baba) {
+        normal = (oc + t * rd - ba * y / baba) / r;
+    } else {
+        // caps
+        t = ((y < 0.0 ? 0.0 : baba) - baoc) / bard;
+        if (abs(k1 + k2 * t) >= h) {
+            discard;
+        }
+        normal = ba * sign(y) / sqrt(baba);
+    }
+    if (t < 0.0) {
+        discard;
+    }
+    write_outputs(ro + rd * t, normal, color);
+}
+@end
+
+@program impostor_cylinder vs_impostor_cylinder fs_impostor_cylinder
@@ -0,0 +1,95 @@
+@ctype mat4 math::Matrix4f
+@ctype vec4 math::Vector4f
+
+// grid on the plane z = height, ray cast from a fullscreen quad
+
+@block params
+uniform infinite_grid_params {
+    mat4 view_projection;
+    mat4 inv_view_projection;
+    vec4 minor_color;
+    vec4 major_color;
+    vec4 x_axis_color;
+    vec4 y_axis_color;
+    vec4 options; // x: step, y: major lines every, z: line width in pixels, w: height
+};
+@end
+
+@vs vs_infinite_grid
+@include_block params
+
+in vec2 corner;
+
+out vec3 near_pos;
+out vec3 far_pos;
+
+// the unprojection of the quad on the near and the far planes, linear in screen space
+vec3 unproject(vec2 ndc, float z) {
+    vec4 p = inv_view_projection * vec4(ndc, z, 1.0);
+    return p.xyz / p.w;
+}
+
+void main() {
+    gl_Position = vec4(corner, 0.0, 1.0);
+    near_pos = unproject(corner, -1.0);
+    far_pos = unproject(corner, 1.0);
+}
+@end
+
+@fs fs_infinite_grid
+@include common.glsl.inc
+@include_block params
+
+in vec3 near_pos;
+in vec3 far_pos;
+
+layout(location=0) out vec4 out_frag_color;
+layout(location=1) out vec4 out_frag_normal;
+layout(location=2) out vec4 out_frag_depth;
+
+// coverage of the lines at the integer coordinates, from their distance in pixels. When they get closer than a few
+// pixels they fade out instead of aliasing
+float grid_lines(vec2 coord, vec2 deriv, float width) {
+    vec2 dist = abs(fract(coord + 0.5) - 0.5) / deriv;
+    float line = clamp(width * 0.5 + 0.5 - min(dist.x, dist.y), 0.0, 1.0);
+    return line * (1.0 - smoothstep(0.15, 0.4, max(deriv.x, deriv.y)));
+}
+
+float axis_line(float coord, float deriv, float width) {
+    return clamp(width * 0.5 + 0.5 - abs(coord) / deriv, 0.0, 1.0);
+}
+
+void main() {
+    vec3 dir = far_pos - near_pos;
+    float t = (options.w - near_pos.z) / dir.z;
+    vec3 pos = near_pos + dir * t;
+    // the derivatives are taken before any discard
+    vec2 coord = pos.xy / options.x;
+    vec2 deriv = max(fwidth(coord), vec2(1e-6));
+    if (t <= 0.0 || t > 1.0) {
+        discard;
+    }
+    float width = options.z;
+    float minor = grid_lines(coord, deriv, width);
+    float major = grid_lines(coord / options.y, deriv / options.y, width);
+    float x_axis = axis_line(coord.y, deriv.y, width);
+    float y_axis = axis_line(coord.x, deriv.x, width);
+    vec4 color = vec4(minor_color.rgb, minor);
+    color = mix(color, vec4(major_color.rgb, 1.0), major);
+    color = mix(color, vec4(x_axis_color.rgb, 1.0), x_axis);
+    color = mix(color, vec4(y_axis_color.rgb, 1.0), y_axis);
+    // fade towards the far plane, where even the major lines are too dense
+    color.a *= 1.0 - smoothstep(0.5, 1.0, t);
+    if (color.a < 1.0 / 255.0) {
+        discard;
+    }
+    // the depth of the plane, for the depth test against the scene
+    vec4 clip = view_projection * vec4(pos, 1.0);
+    gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+    out_frag_color = color;
+    out_frag_normal = vec4(0.5, 0.5, 0.5, 1.0);
+    out_frag_depth = encodeDepth(clip.z / clip.w);
+}
+@end
+
+@program infinite_grid vs_infinite_grid fs_infinite_grid
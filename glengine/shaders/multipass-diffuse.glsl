@@ -44,9 +44,15 @@ void main() {
 @include common.glsl.inc
 uniform fs_params {
     vec4 color;
+    vec4 uv_rect; // offset (xy) and scale (zw) of the texture in an atlas (uvs wrap within it)
+    float layer;  // layer of the texture array
 };
 
+#ifdef TEXTURE_ARRAY
+uniform sampler2DArray tex_diffuse_array;
+#else
 uniform sampler2D tex_diffuse;
+#endif
 
 in vec3 frag_pos;
 in vec3 frag_normal;
@@ -75,7 +81,17 @@ void main() {
             
     vec4 tmp_color = color;
 #ifdef TEXTURED
-    tmp_color *= texture(tex_diffuse, frag_uv);
+    // uvs out of [0,1] repeat within the rect of a texture in an atlas (whole textures are wrapped by their
+    // sampler), the gradients of the unwrapped uvs keep the mip level continuous across the wrap
+    bool in_atlas = any(lessThan(uv_rect.zw, vec2(1.0)));
+    vec2 uv = uv_rect.xy + (in_atlas ? fract(frag_uv) : frag_uv) * uv_rect.zw;
+    vec2 uv_dx = dFdx(frag_uv) * uv_rect.zw;
+    vec2 uv_dy = dFdy(frag_uv) * uv_rect.zw;
+#ifdef TEXTURE_ARRAY
+    tmp_color *= textureGrad(tex_diffuse_array, vec3(uv, layer), uv_dx, uv_dy);
+#else
+    tmp_color *= textureGrad(tex_diffuse, uv, uv_dx, uv_dy);
+#endif
     if(tmp_color.a < 0.1)
         discard;
 #endif
@@ -117,3 +133,19 @@ void main() {
 
 @program offscreen_diffuse_textured vs_diffuse_textured fs_diffuse_textured
 
+// ///////////////////////////// //
+// diffuse-textured, array layer //
+// ///////////////////////////// //
+
+@vs vs_diffuse_texture_array
+#define TEXTURED
+@include_block vertex_shader
+@end
+
+@fs fs_diffuse_texture_array
+#define TEXTURED
+#define TEXTURE_ARRAY
+@include_block fragment_shader
+@end
+
+@program offscreen_diffuse_texture_array vs_diffuse_texture_array fs_diffuse_texture_array
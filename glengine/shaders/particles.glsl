@@ -0,0 +1,59 @@
+@ctype mat4 math::Matrix4f
+@ctype vec4 math::Vector4f
+
+// particles as billboards facing the camera, one instance per particle. The components of the particles are in
+// separate streams of the same buffer
+
+@block particle_params
+uniform particle_params {
+    mat4 view;
+    mat4 projection;
+};
+@end
+
+@vs vs_particles
+@include_block particle_params
+
+in vec2 corner; // -1..1
+in float pos_x;
+in float pos_y;
+in float pos_z;
+in float size;
+in vec4 instance_color;
+
+out vec2 uv;
+out vec4 color;
+
+void main() {
+    vec4 view_pos = view * vec4(pos_x, pos_y, pos_z, 1.0);
+    view_pos.xy += corner * size * 0.5;
+    gl_Position = projection * view_pos;
+    uv = corner;
+    color = instance_color;
+}
+@end
+
+@fs fs_particles
+@include common.glsl.inc
+
+in vec2 uv;
+in vec4 color;
+
+layout(location=0) out vec4 out_frag_color;
+layout(location=1) out vec4 out_frag_normal;
+layout(location=2) out vec4 out_frag_depth;
+
+void main() {
+    // round and soft, premultiplied for both the additive and the alpha blending
+    float r2 = dot(uv, uv);
+    float a = color.a * (1.0 - r2) * (1.0 - r2);
+    if (r2 >= 1.0 || a < 1.0 / 255.0) {
+        discard;
+    }
+    out_frag_color = vec4(color.rgb * a, a);
+    out_frag_normal = vec4(0.5, 0.5, 0.5, 1.0);
+    out_frag_depth = encodeDepth(gl_FragCoord.z * 2.0 - 1.0);
+}
+@end
+
+@program particles vs_particles fs_particles
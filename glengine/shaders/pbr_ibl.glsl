@@ -55,3 +55,12 @@
 
 @program offscreen_pbr_ibl vs_pbr_ibl fs_pbr_ibl
 
+// instanced variant, the fragment shader is shared
+@vs vs_pbr_ibl_instanced
+#define USE_IBL
+#define INSTANCING
+@include_block vertex_shader
+@end
+
+@program offscreen_pbr_ibl_instanced vs_pbr_ibl_instanced fs_pbr_ibl
+
@@ -0,0 +1,49 @@
+@ctype mat4 math::Matrix4f
+@ctype vec4 math::Vector4f
+
+@vs vs_point_cloud
+uniform point_cloud_params {
+    mat4 model_view_projection;
+    vec4 node_min;     // xyz: bounds of the node, w: spacing of its points
+    vec4 node_size;    // xyz: edge of the node bounds
+    vec4 point_params; // x: point size in pixels, y: pixels per unit at distance 1 (0 for a fixed size), z: max size
+};
+
+in vec4 vertex_pos; // quantized in the bounds of the node
+in vec4 vertex_color;
+
+out vec4 color;
+out vec4 proj_pos;
+
+void main() {
+    vec3 pos = node_min.xyz + vertex_pos.xyz * node_size.xyz;
+    gl_Position = model_view_projection * vec4(pos, 1.0);
+    proj_pos = gl_Position;
+    // adaptive size: the spacing of the node on screen, so that the coarse nodes have no holes
+    float size = point_params.x;
+    if (point_params.y > 0.0) {
+        size = clamp(node_min.w * point_params.y / gl_Position.w, point_params.x, point_params.z);
+    }
+    gl_PointSize = size;
+    color = vertex_color;
+}
+@end
+
+@fs fs_point_cloud
+@include common.glsl.inc
+
+in vec4 color;
+in vec4 proj_pos;
+
+layout(location=0) out vec4 out_frag_color;
+layout(location=1) out vec4 out_frag_normal;
+layout(location=2) out vec4 out_frag_depth;
+
+void main() {
+    out_frag_color = color;
+    out_frag_normal = vec4(0.5, 0.5, 0.5, 1.0); // no normal, points are not shaded
+    out_frag_depth = encodeDepth(proj_pos.z / proj_pos.w);
+}
+@end
+
+@program point_cloud vs_point_cloud fs_point_cloud
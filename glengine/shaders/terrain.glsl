@@ -0,0 +1,107 @@
+@ctype mat4 math::Matrix4f
+@ctype vec4 math::Vector4f
+
+// CDLOD terrain: a chunk is the shared grid, placed on a node of the quadtree, with the heights fetched from a tile
+// of the heightmap. Positions are in samples of the heightmap until they are scaled to world space
+
+@block terrain_params
+uniform terrain_params {
+    mat4 view_projection;
+    vec4 camera_pos;
+    vec4 terrain;   // x: spacing of the samples, y: height of 0, z: from 0 to the max sample, w: cells of the grid
+    vec4 data_size; // xy: last sample of the heightmap
+    vec4 light_pos;
+};
+@end
+
+@vs vs_terrain
+@include_block terrain_params
+
+uniform chunk_params {
+    vec4 node;  // xy: first sample of the chunk, z: samples covered by the chunk
+    vec4 morph; // x: distance where the morph to the parent level starts, y: where it ends
+    vec4 tile;  // xy: first sample of the height texture, z: samples between its texels
+};
+
+uniform sampler2D height_tex;
+
+in vec2 grid_pos; // 0..cells
+
+out vec3 world_pos;
+out vec3 normal;
+
+// texel of the sample nearest to s, after the apron of one texel around the samples of the tile
+ivec2 texel_at(vec2 s) {
+    ivec2 size = textureSize(height_tex, 0);
+    ivec2 texel = ivec2(floor((min(s, data_size.xy) - tile.xy) / tile.z + 0.5)) + 1;
+    // the border of the heightmap is the last sample, also when it is off the step of the overview
+    if (s.x >= data_size.x) {
+        texel.x = size.x - 2;
+    }
+    if (s.y >= data_size.y) {
+        texel.y = size.y - 2;
+    }
+    return clamp(texel, ivec2(1), size - 2);
+}
+
+float height_of(ivec2 texel) {
+    return terrain.y + texelFetch(height_tex, texel, 0).r * terrain.z;
+}
+
+float height_at(vec2 s) {
+    return height_of(texel_at(s));
+}
+
+// central differences at the spacing of the texels, the ones past the borders of the tile are in its apron
+vec3 normal_at(vec2 s) {
+    ivec2 texel = texel_at(s);
+    float dx = height_of(texel + ivec2(1, 0)) - height_of(texel - ivec2(1, 0));
+    float dy = height_of(texel + ivec2(0, 1)) - height_of(texel - ivec2(0, 1));
+    return normalize(vec3(-dx, -dy, 2.0 * tile.z * terrain.x));
+}
+
+void main() {
+    float cell = node.z / terrain.w;
+    // the vertices past the heightmap are clamped on its border
+    vec2 p = node.xy + grid_pos * cell;
+    vec2 s = min(p, data_size.xy);
+    float h = height_at(s);
+    // the odd vertices slide onto the even ones, the grid of the parent level, when getting further away
+    float k = clamp((distance(vec3(s * terrain.x, h), camera_pos.xyz) - morph.x) / (morph.y - morph.x), 0.0, 1.0);
+    vec2 target = min(p - mod(grid_pos, 2.0) * cell, data_size.xy);
+    normal = normalize(mix(normal_at(s), normal_at(target), k));
+    s = mix(s, target, k);
+    h = mix(h, height_at(target), k);
+    world_pos = vec3(s * terrain.x, h);
+    gl_Position = view_projection * vec4(world_pos, 1.0);
+}
+@end
+
+@fs fs_terrain
+@include common.glsl.inc
+@include_block terrain_params
+
+in vec3 world_pos;
+in vec3 normal;
+
+layout(location=0) out vec4 out_frag_color;
+layout(location=1) out vec4 out_frag_normal;
+layout(location=2) out vec4 out_frag_depth;
+
+void main() {
+    vec3 n = normalize(normal);
+    // tinted by height, and lit as the diffuse material
+    float t = clamp((world_pos.z - terrain.y) / max(terrain.z, 1e-6), 0.0, 1.0);
+    vec3 low = vec3(0.25, 0.45, 0.2);
+    vec3 mid = vec3(0.55, 0.45, 0.3);
+    vec3 high = vec3(0.9, 0.9, 0.9);
+    vec3 albedo = t < 0.5 ? mix(low, mid, t * 2.0) : mix(mid, high, t * 2.0 - 1.0);
+    float diff = (dot(n, normalize(light_pos.xyz - world_pos)) + 1.0) / 2.0;
+    out_frag_color = vec4(albedo * (0.1 + diff), 1.0);
+    out_frag_normal = vec4(n * 0.5 + 0.5, 1.0);
+    vec4 clip = view_projection * vec4(world_pos, 1.0);
+    out_frag_depth = encodeDepth(clip.z / clip.w);
+}
+@end
+
+@program terrain vs_terrain fs_terrain
@@ -0,0 +1,37 @@
+@ctype vec4 math::Vector4f
+
+@vs vs_text_labels
+uniform text_labels_params {
+    vec4 viewport; // width, height in pixels
+};
+
+in vec2 corner;
+in vec4 glyph_rect; // x, y, width, height in pixels from the top left corner
+in vec4 glyph_uv;
+in vec4 glyph_color;
+
+out vec2 uv;
+out vec4 color;
+
+void main() {
+    vec2 p = glyph_rect.xy + corner * glyph_rect.zw;
+    gl_Position = vec4(p.x / viewport.x * 2.0 - 1.0, 1.0 - p.y / viewport.y * 2.0, 0.0, 1.0);
+    uv = mix(glyph_uv.xy, glyph_uv.zw, corner);
+    color = glyph_color;
+}
+@end
+
+@fs fs_text_labels
+uniform sampler2D tex_atlas;
+
+in vec2 uv;
+in vec4 color;
+
+out vec4 frag_color;
+
+void main() {
+    frag_color = vec4(color.rgb, color.a * texture(tex_atlas, uv).r);
+}
+@end
+
+@program text_labels vs_text_labels fs_text_labels
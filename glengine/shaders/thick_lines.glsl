@@ -0,0 +1,155 @@
+@ctype mat4 math::Matrix4f
+@ctype vec4 math::Vector4f
+
+// each instance is a segment from a to b, expanded to a quad in screen space. Everything is in pixels, in the frame of
+// the segment: u along it from a, v across it
+
+@vs vs_thick_lines
+uniform thick_lines_params {
+    mat4 view_projection;
+    vec4 viewport; // width and height of the pass, in pixels
+};
+
+in vec2 corner; // x: 0 at a and 1 at b, y: -1..1 across
+in vec4 prev_pos; // xyz, distance along the polyline (negative for the padding between the polylines)
+in vec4 a_pos;
+in vec4 a_color;
+in vec4 a_style; // width, dash, gap, join + cap * 4
+in vec4 b_pos;
+in vec4 b_color;
+in vec4 next_pos;
+
+out vec2 local_pos;
+out vec4 color;
+out float proj_z;
+flat out vec4 segment;    // length, half width, 1 / w at a and b
+flat out vec4 dashes;     // distance at a and b, dash, gap
+flat out vec4 neighbours; // xy: prev segment at a, zw: next segment at b, in the frame of the segment (0 for caps)
+flat out vec2 shape;      // join, cap
+
+vec2 to_screen(vec4 clip) {
+    return (clip.xy / clip.w * 0.5 + 0.5) * viewport.xy;
+}
+
+// direction of the segment from p to q in screen space, 0 if p is padding or behind the near plane
+vec2 neighbour_dir(vec4 p, vec2 q, vec2 fallback) {
+    vec4 clip = view_projection * vec4(p.xyz, 1.0);
+    if (p.w < 0.0 || clip.z + clip.w < 0.0) {
+        return vec2(0.0);
+    }
+    vec2 d = q - to_screen(clip);
+    return dot(d, d) > 1e-8 ? normalize(d) : fallback;
+}
+
+void main() {
+    vec4 clip_a = view_projection * vec4(a_pos.xyz, 1.0);
+    vec4 clip_b = view_projection * vec4(b_pos.xyz, 1.0);
+    float near_a = clip_a.z + clip_a.w;
+    float near_b = clip_b.z + clip_b.w;
+    // segments across two polylines, or behind the near plane, are degenerate
+    if (a_pos.w < 0.0 || b_pos.w < 0.0 || (near_a < 0.0 && near_b < 0.0)) {
+        gl_Position = vec4(0.0);
+        return;
+    }
+    // clip against the near plane
+    float dist_a = a_pos.w;
+    float dist_b = b_pos.w;
+    bool clipped_a = near_a < 0.0;
+    bool clipped_b = near_b < 0.0;
+    if (clipped_a) {
+        float t = near_a / (near_a - near_b);
+        clip_a = mix(clip_a, clip_b, t);
+        dist_a = mix(a_pos.w, b_pos.w, t);
+    } else if (clipped_b) {
+        float t = near_b / (near_b - near_a);
+        clip_b = mix(clip_b, clip_a, t);
+        dist_b = mix(b_pos.w, a_pos.w, t);
+    }
+    vec2 sa = to_screen(clip_a);
+    vec2 sb = to_screen(clip_b);
+    vec2 dir = sb - sa;
+    float len = length(dir);
+    vec2 t = len > 1e-4 ? dir / len : vec2(1.0, 0.0);
+    vec2 n = vec2(-t.y, t.x);
+    vec2 prev_dir = clipped_a ? vec2(0.0) : neighbour_dir(prev_pos, sa, t);
+    vec2 next_dir = clipped_b ? vec2(0.0) : -neighbour_dir(next_pos, sb, -t);
+
+    // the quad is extended past the ends, enough for the caps and the joins up to the miter limit
+    float half_width = a_style.x * 0.5;
+    float ext = half_width * 2.0 + 1.0;
+    float u = corner.x < 0.5 ? -ext : len + ext;
+    float v = corner.y * (half_width + 1.0);
+    vec2 pos = sa + t * u + n * v;
+    float z = corner.x < 0.5 ? clip_a.z / clip_a.w : clip_b.z / clip_b.w;
+    gl_Position = vec4(pos / viewport.xy * 2.0 - 1.0, z, 1.0);
+
+    local_pos = vec2(u, v);
+    color = corner.x < 0.5 ? a_color : b_color;
+    proj_z = z;
+    segment = vec4(len, half_width, 1.0 / clip_a.w, 1.0 / clip_b.w);
+    dashes = vec4(dist_a, dist_b, a_style.y, a_style.z);
+    neighbours = vec4(dot(prev_dir, t), dot(prev_dir, n), dot(next_dir, t), dot(next_dir, n));
+    shape = vec2(mod(a_style.w, 4.0), floor(a_style.w / 4.0));
+}
+@end
+
+@fs fs_thick_lines
+@include common.glsl.inc
+
+in vec2 local_pos;
+in vec4 color;
+in float proj_z;
+flat in vec4 segment;
+flat in vec4 dashes;
+flat in vec4 neighbours;
+flat in vec2 shape;
+
+layout(location=0) out vec4 out_frag_color;
+layout(location=1) out vec4 out_frag_normal;
+layout(location=2) out vec4 out_frag_depth;
+
+// whether p is outside of the end of the segment at the origin, the segment coming from -x and going on along dir.
+// The other segment of a join cuts the complementary half
+bool outside_end(vec2 p, vec2 dir, float half_width) {
+    int join = int(shape.x + 0.5);
+    int cap = int(shape.y + 0.5);
+    if (dir == vec2(0.0)) {
+        // caps: butt, square, round
+        return cap == 0 ? p.x > 0.0 : (cap == 1 ? p.x > half_width : p.x > 0.0 && length(p) > half_width);
+    }
+    // joins sharper than the miter limit are round
+    if (join == 2 || abs(dir.y) > 2.0 * (1.0 + dir.x)) {
+        return p.x > 0.0 && length(p) > half_width;
+    }
+    // miter: cut along the bisector, bevel: and along the line between the outer corners
+    vec2 bisector = normalize(vec2(1.0, 0.0) + dir);
+    if (dot(p, bisector) > 0.0) {
+        return true;
+    }
+    vec2 outer = vec2(-bisector.y, bisector.x) * (dir.y > 0.0 ? -1.0 : 1.0);
+    return join == 1 && dot(p, outer) > half_width * bisector.x;
+}
+
+void main() {
+    float len = segment.x;
+    float half_width = segment.y;
+    if (abs(local_pos.y) > half_width || outside_end(local_pos - vec2(len, 0.0), neighbours.zw, half_width) ||
+        outside_end(-local_pos, neighbours.xy, half_width)) {
+        discard;
+    }
+    if (dashes.z > 0.0) {
+        // distance along the polyline, with the perspective correction
+        float s = len > 0.0 ? clamp(local_pos.x / len, 0.0, 1.0) : 0.0;
+        s = s * segment.w / mix(segment.z, segment.w, s);
+        float distance = mix(dashes.x, dashes.y, s);
+        if (mod(distance, dashes.z + dashes.w) > dashes.z) {
+            discard;
+        }
+    }
+    out_frag_color = color;
+    out_frag_normal = vec4(0.5, 0.5, 0.5, 1.0); // no normal, lines are not shaded
+    out_frag_depth = encodeDepth(proj_z);
+}
+@end
+
+@program thick_lines vs_thick_lines fs_thick_lines
@@ -0,0 +1,127 @@
+@ctype mat4 math::Matrix4f
+@ctype vec4 math::Vector4f
+
+// volumes ray marched from the back faces of their bounds, through a transfer function. The rays are in the texture
+// space of the volume, from 0 to 1 along each side
+
+@block volume_params
+uniform volume_params {
+    mat4 view_projection;
+    mat4 inverse_view_projection;
+    vec4 origin;  // xyz: first corner of the volume, in world space
+    vec4 size;    // xyz: extent of the volume, in world space
+    vec4 eye;     // camera position in texture space and 1, or the view direction and 0 for an orthographic projection
+    vec4 cells;   // xyz: macro cells per unit of texture space, w: 1 to skip the empty ones
+    vec4 march;   // x: step in texture space, y: exponent of the opacities, z: max iterations, w: 1 to jitter the rays
+    vec4 options; // x: 1 for the heatmap of the iterations
+};
+@end
+
+@vs vs_volume
+@include_block volume_params
+
+in vec3 corner; // 0..1, corners of a box
+
+out vec3 tex_pos;
+
+void main() {
+    tex_pos = corner;
+    gl_Position = view_projection * vec4(origin.xyz + corner * size.xyz, 1.0);
+}
+@end
+
+@fs fs_volume
+@include common.glsl.inc
+@include_block volume_params
+
+uniform sampler3D tex_voxels;
+uniform sampler3D tex_distances; // Chebyshev distance of the macro cells from the occupied ones, 0 when occupied
+uniform sampler2D tex_transfer;
+uniform sampler2D tex_scene_depth;
+
+in vec3 tex_pos;
+
+layout(location=0) out vec4 out_frag_color;
+
+// distances along the ray where it enters and leaves a box
+vec2 box_range(vec3 ro, vec3 inv_rd, vec3 lo, vec3 hi) {
+    vec3 t0 = (lo - ro) * inv_rd;
+    vec3 t1 = (hi - ro) * inv_rd;
+    vec3 tmin = min(t0, t1);
+    vec3 tmax = max(t0, t1);
+    return vec2(max(max(tmin.x, tmin.y), tmin.z), min(min(tmax.x, tmax.y), tmax.z));
+}
+
+void main() {
+    vec3 ro, rd;
+    if (eye.w > 0.0) {
+        ro = eye.xyz;
+        rd = normalize(tex_pos - eye.xyz);
+    } else {
+        rd = normalize(eye.xyz);
+        ro = tex_pos - rd * 2.0; // in front of the volume, its diagonal is shorter
+    }
+    vec3 inv_rd = 1.0 / (rd + step(abs(rd), vec3(1e-7)) * 1e-7);
+    vec2 range = box_range(ro, inv_rd, vec3(0.0), vec3(1.0));
+    // the opaque objects of the scene end the rays
+    vec2 screen_uv = gl_FragCoord.xy / vec2(textureSize(tex_scene_depth, 0));
+    float depth = min(decodeDepth(texture(tex_scene_depth, screen_uv)), 1.0);
+    vec4 scene = inverse_view_projection * vec4(screen_uv * 2.0 - 1.0, depth, 1.0);
+    vec3 scene_pos = (scene.xyz / scene.w - origin.xyz) / size.xyz;
+    float t_begin = max(range.x, 0.0);
+    float t_end = min(range.y, dot(scene_pos - ro, rd));
+    if (t_end <= t_begin) {
+        discard;
+    }
+
+    // samples at t0 + k * dt, the first one within a step from the start of the ray
+    float dt = march.x;
+    float offset = march.w > 0.0 ? fract(sin(dot(gl_FragCoord.xy, vec2(12.9898, 78.233))) * 43758.5453) : 0.5;
+    float t0 = t_begin + offset * dt;
+    vec3 last_cell = vec3(textureSize(tex_distances, 0) - 1);
+    vec4 acc = vec4(0.0);
+    float k = 0.0;
+    float iterations = 0.0;
+    for (; iterations < march.z; iterations += 1.0) {
+        float t = t0 + k * dt;
+        if (t >= t_end) {
+            break;
+        }
+        vec3 p = ro + rd * t;
+        if (cells.w > 0.0) {
+            vec3 cell = clamp(floor(p * cells.xyz), vec3(0.0), last_cell);
+            float d = floor(texelFetch(tex_distances, ivec3(cell), 0).r * 255.0 + 0.5);
+            if (d > 0.0) {
+                // all the cells within d - 1 of this one are empty, the ray jumps to the first sample out of them
+                vec3 lo = (cell - (d - 1.0)) / cells.xyz;
+                vec3 hi = (cell + d) / cells.xyz;
+                float t_exit = box_range(ro, inv_rd, lo, hi).y;
+                k = max(k + 1.0, ceil((t_exit - t0) / dt));
+                continue;
+            }
+        }
+        float value = texture(tex_voxels, p).r;
+        // the values at the centers of the texels of the transfer function
+        vec4 color = texture(tex_transfer, vec2((value * 255.0 + 0.5) / 256.0, 0.5));
+        float alpha = 1.0 - pow(1.0 - color.a, march.y);
+        acc += (1.0 - acc.a) * vec4(color.rgb * alpha, alpha);
+        if (acc.a > 0.99) {
+            break;
+        }
+        k += 1.0;
+    }
+
+    if (options.x > 0.0) {
+        // blue for a single iteration, red from 256
+        float h = clamp(iterations / 256.0, 0.0, 1.0);
+        out_frag_color = vec4(h, 0.0, 1.0 - h, 1.0);
+        return;
+    }
+    if (acc.a < 1.0 / 255.0) {
+        discard;
+    }
+    out_frag_color = acc;
+}
+@end
+
+@program volume vs_volume fs_volume
@@ -0,0 +1,282 @@
+#pragma once
+
+// uploads of buffers and images in parts, across frames, which sokol_gfx doesn't expose: the storage of a resource
+// is allocated without its content, which is then written piece by piece (byte ranges of buffers, rows or slices of
+// image levels). The implementation uses the internals of sokol_gfx, it is compiled with it (with SOKOL_IMPL). Only
+// the GL and dummy backends are supported, the other ones return false so that the caller uploads whole resources
+
+#if !defined(SOKOL_GFX_INCLUDED)
+#error "include sokol_gfx.h before sokol_gfx_ext.h"
+#endif
+
+#include <cstddef>
+
+/// allocate the backend storage of an allocated buffer or image, without content. The resource stays in the alloc
+/// state, and the draws using it are skipped, until sg_ext_commit_*. It can be destroyed as usual at any time
+bool sg_ext_init_buffer_storage(sg_buffer buf, const sg_buffer_desc *desc);
+bool sg_ext_init_image_storage(sg_image img, const sg_image_desc *desc);
+
+/// write a byte range of the buffer written by the next update: the only one of an immutable buffer, the one not in
+/// use of a dynamic or stream buffer (see sg_ext_commit_buffer)
+bool sg_ext_write_buffer(sg_buffer buf, size_t offset, sg_range data);
+/// rows of texel blocks (rows of texels for uncompressed formats) of a 2D or cube level, or slices of a 3D or array
+/// level, of the image written by the next update (as for buffers). data is tightly packed
+bool sg_ext_write_image(sg_image img, int face, int level, int first, int count, sg_range data);
+/// rows of texel blocks of a 2D or cube level, or slices of a 3D or array level, 0 if the image isn't allocated
+int sg_ext_image_parts(sg_image img, int level);
+/// finest level sampled from an image, the finer ones not being written yet
+bool sg_ext_set_image_base_level(sg_image img, int level);
+
+/// make the writes visible: a resource in the alloc state becomes valid, and the buffer or image written by the
+/// updates of a dynamic or stream resource becomes the one in use (as sg_update_*, at most once per frame)
+void sg_ext_commit_buffer(sg_buffer buf);
+void sg_ext_commit_image(sg_image img);
+
+#if defined(SOKOL_IMPL) && !defined(SOKOL_GFX_EXT_IMPL)
+#define SOKOL_GFX_EXT_IMPL
+#endif
+
+#if defined(SOKOL_GFX_EXT_IMPL) && !defined(SOKOL_GFX_EXT_IMPL_INCLUDED)
+#define SOKOL_GFX_EXT_IMPL_INCLUDED
+
+#if !defined(SOKOL_GFX_IMPL_INCLUDED)
+#error "the implementation of sokol_gfx_ext.h needs the one of sokol_gfx.h"
+#endif
+
+namespace {
+
+// the common attributes are cleared with the storage (see _sg_reset_buffer and _sg_reset_image)
+bool sg_ext_has_storage(const _sg_buffer_t *buf) {
+    return buf->cmn.size > 0;
+}
+
+bool sg_ext_has_storage(const _sg_image_t *img) {
+    return img->cmn.num_mipmaps > 0;
+}
+
+/// a buffer or image with storage, valid or not yet committed
+_sg_buffer_t *sg_ext_lookup(sg_buffer buf) {
+    _sg_buffer_t *b = _sg_lookup_buffer(&_sg.pools, buf.id);
+    return b && b->slot.state != SG_RESOURCESTATE_FAILED && sg_ext_has_storage(b) ? b : nullptr;
+}
+
+_sg_image_t *sg_ext_lookup(sg_image img) {
+    _sg_image_t *i = _sg_lookup_image(&_sg.pools, img.id);
+    return i && i->slot.state != SG_RESOURCESTATE_FAILED && sg_ext_has_storage(i) ? i : nullptr;
+}
+
+/// slot written by the next update
+int sg_ext_next_slot(int active_slot, int num_slots, sg_resource_state state) {
+    return state == SG_RESOURCESTATE_ALLOC || num_slots <= 1 ? active_slot : (active_slot + 1) % num_slots;
+}
+
+int sg_ext_mip_size(int size, int level) {
+    return size >> level > 0 ? size >> level : 1;
+}
+
+} // namespace
+
+bool sg_ext_init_buffer_storage(sg_buffer buf_id, const sg_buffer_desc *desc) {
+    _sg_buffer_t *buf = _sg_lookup_buffer(&_sg.pools, buf_id.id);
+    sg_buffer_desc def = _sg_buffer_desc_defaults(desc);
+    if (!buf || buf->slot.state != SG_RESOURCESTATE_ALLOC || sg_ext_has_storage(buf) || def.size == 0) {
+        return false;
+    }
+    def.data = {};
+#if defined(_SOKOL_ANY_GL)
+    if (def.gl_buffers[0]) {
+        return false;
+    }
+    _sg_buffer_common_init(&buf->cmn, &def);
+    const GLenum gl_target = _sg_gl_buffer_target(buf->cmn.type);
+    for (int slot = 0; slot < buf->cmn.num_slots; slot++) {
+        glGenBuffers(1, &buf->gl.buf[slot]);
+        _sg_gl_cache_store_buffer_binding(gl_target);
+        _sg_gl_cache_bind_buffer(gl_target, buf->gl.buf[slot]);
+        glBufferData(gl_target, buf->cmn.size, nullptr, _sg_gl_usage(buf->cmn.usage));
+        _sg_gl_cache_restore_buffer_binding(gl_target);
+    }
+    _SG_GL_CHECK_ERROR();
+#elif defined(SOKOL_DUMMY_BACKEND)
+    _sg_buffer_common_init(&buf->cmn, &def);
+#else
+    return false;
+#endif
+    // the destruction of the buffer needs its context
+    buf->slot.ctx_id = _sg.active_context.id;
+    return true;
+}
+
+bool sg_ext_init_image_storage(sg_image img_id, const sg_image_desc *desc) {
+    _sg_image_t *img = _sg_lookup_image(&_sg.pools, img_id.id);
+    if (!img || img->slot.state != SG_RESOURCESTATE_ALLOC || sg_ext_has_storage(img) || desc->render_target) {
+        return false;
+    }
+#if defined(_SOKOL_ANY_GL) || defined(SOKOL_DUMMY_BACKEND)
+    // the backend allocates the levels without data, the sizes of the compressed ones are still needed
+    sg_image_desc def = _sg_image_desc_defaults(desc);
+    const int num_faces = def.type == SG_IMAGETYPE_CUBE ? 6 : 1;
+    const int num_slices = def.type == SG_IMAGETYPE_ARRAY || def.type == SG_IMAGETYPE_3D ? def.num_slices : 1;
+    def.data = {};
+    for (int face = 0; face < num_faces; face++) {
+        for (int level = 0; level < def.num_mipmaps && level < SG_MAX_MIPMAPS; level++) {
+            const int depth = def.type == SG_IMAGETYPE_3D ? sg_ext_mip_size(num_slices, level) : num_slices;
+            def.data.subimage[face][level].size =
+                size_t(_sg_surface_pitch(def.pixel_format, sg_ext_mip_size(def.width, level),
+                                         sg_ext_mip_size(def.height, level), 1)) *
+                size_t(depth);
+        }
+    }
+    img->slot.ctx_id = _sg.active_context.id;
+    if (_sg_create_image(img, &def) != SG_RESOURCESTATE_VALID) {
+        img->slot.state = SG_RESOURCESTATE_FAILED;
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool sg_ext_write_buffer(sg_buffer buf_id, size_t offset, sg_range data) {
+    _sg_buffer_t *buf = sg_ext_lookup(buf_id);
+    if (!buf || !data.ptr || offset + data.size > size_t(buf->cmn.size)) {
+        return false;
+    }
+#if defined(_SOKOL_ANY_GL)
+    const GLenum gl_target = _sg_gl_buffer_target(buf->cmn.type);
+    const int slot = sg_ext_next_slot(buf->cmn.active_slot, buf->cmn.num_slots, buf->slot.state);
+    _sg_gl_cache_store_buffer_binding(gl_target);
+    _sg_gl_cache_bind_buffer(gl_target, buf->gl.buf[slot]);
+    glBufferSubData(gl_target, GLintptr(offset), GLsizeiptr(data.size), data.ptr);
+    _sg_gl_cache_restore_buffer_binding(gl_target);
+    _SG_GL_CHECK_ERROR();
+    return true;
+#elif defined(SOKOL_DUMMY_BACKEND)
+    return true;
+#else
+    return false;
+#endif
+}
+
+int sg_ext_image_parts(sg_image img_id, int level) {
+    _sg_image_t *img = sg_ext_lookup(img_id);
+    if (!img || level >= img->cmn.num_mipmaps) {
+        return 0;
+    }
+    if (img->cmn.type == SG_IMAGETYPE_3D) {
+        return sg_ext_mip_size(img->cmn.num_slices, level);
+    }
+    if (img->cmn.type == SG_IMAGETYPE_ARRAY) {
+        return img->cmn.num_slices;
+    }
+    return _sg_num_rows(img->cmn.pixel_format, sg_ext_mip_size(img->cmn.height, level));
+}
+
+bool sg_ext_write_image(sg_image img_id, int face, int level, int first, int count, sg_range data) {
+    const int parts = sg_ext_image_parts(img_id, level);
+    if (!data.ptr || first < 0 || count <= 0 || first + count > parts) {
+        return false;
+    }
+#if defined(_SOKOL_ANY_GL)
+    _sg_image_t *img = sg_ext_lookup(img_id);
+    const int slot = sg_ext_next_slot(img->cmn.active_slot, img->cmn.num_slots, img->slot.state);
+    const sg_pixel_format fmt = img->cmn.pixel_format;
+    const bool compressed = _sg_is_compressed_pixel_format(fmt);
+    const int width = sg_ext_mip_size(img->cmn.width, level);
+    const int height = sg_ext_mip_size(img->cmn.height, level);
+    _sg_gl_cache_store_texture_binding(0);
+    _sg_gl_cache_bind_texture(0, img->gl.target, img->gl.tex[slot]);
+    // the data is tightly packed, as in the whole uploads of sokol
+    GLint unpack_alignment = 4;
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpack_alignment);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    if (img->cmn.type == SG_IMAGETYPE_2D || img->cmn.type == SG_IMAGETYPE_CUBE) {
+        const GLenum target = img->cmn.type == SG_IMAGETYPE_CUBE ? _sg_gl_cubeface_target(face) : img->gl.target;
+        // rows of blocks of compressed formats are 4 texels high
+        const int block = compressed ? 4 : 1;
+        const int y = first * block;
+        const int rows = first + count == parts ? height - y : count * block;
+        if (compressed) {
+            glCompressedTexSubImage2D(target, level, 0, y, width, rows, _sg_gl_teximage_internal_format(fmt),
+                                      GLsizei(data.size), data.ptr);
+        } else {
+            glTexSubImage2D(target, level, 0, y, width, rows, _sg_gl_teximage_format(fmt),
+                            _sg_gl_teximage_type(fmt), data.ptr);
+        }
+    }
+#if !defined(SOKOL_GLES2)
+    else if (!_sg.gl.gles2) {
+        if (compressed) {
+            glCompressedTexSubImage3D(img->gl.target, level, 0, 0, first, width, height, count,
+                                      _sg_gl_teximage_internal_format(fmt), GLsizei(data.size), data.ptr);
+        } else {
+            glTexSubImage3D(img->gl.target, level, 0, 0, first, width, height, count, _sg_gl_teximage_format(fmt),
+                            _sg_gl_teximage_type(fmt), data.ptr);
+        }
+    }
+#endif
+    glPixelStorei(GL_UNPACK_ALIGNMENT, unpack_alignment);
+    _sg_gl_cache_restore_texture_binding(0);
+    _SG_GL_CHECK_ERROR();
+    return true;
+#elif defined(SOKOL_DUMMY_BACKEND)
+    (void)face;
+    return true;
+#else
+    (void)face;
+    return false;
+#endif
+}
+
+bool sg_ext_set_image_base_level(sg_image img_id, int level) {
+    _sg_image_t *img = sg_ext_lookup(img_id);
+    if (!img || level < 0 || level >= img->cmn.num_mipmaps) {
+        return false;
+    }
+#if defined(_SOKOL_ANY_GL) && !defined(SOKOL_GLES2)
+    if (_sg.gl.gles2) {
+        return false;
+    }
+    _sg_gl_cache_store_texture_binding(0);
+    for (int slot = 0; slot < img->cmn.num_slots; slot++) {
+        _sg_gl_cache_bind_texture(0, img->gl.target, img->gl.tex[slot]);
+        glTexParameteri(img->gl.target, GL_TEXTURE_BASE_LEVEL, level);
+    }
+    _sg_gl_cache_restore_texture_binding(0);
+    _SG_GL_CHECK_ERROR();
+    return true;
+#elif defined(SOKOL_DUMMY_BACKEND)
+    return true;
+#else
+    return false;
+#endif
+}
+
+void sg_ext_commit_buffer(sg_buffer buf_id) {
+    _sg_buffer_t *buf = sg_ext_lookup(buf_id);
+    if (!buf) {
+        return;
+    }
+    if (buf->slot.state == SG_RESOURCESTATE_ALLOC) {
+        buf->slot.state = SG_RESOURCESTATE_VALID;
+    } else {
+        buf->cmn.active_slot = sg_ext_next_slot(buf->cmn.active_slot, buf->cmn.num_slots, buf->slot.state);
+        buf->cmn.update_frame_index = _sg.frame_index;
+    }
+}
+
+void sg_ext_commit_image(sg_image img_id) {
+    _sg_image_t *img = sg_ext_lookup(img_id);
+    if (!img) {
+        return;
+    }
+    if (img->slot.state == SG_RESOURCESTATE_ALLOC) {
+        img->slot.state = SG_RESOURCESTATE_VALID;
+    } else {
+        img->cmn.active_slot = sg_ext_next_slot(img->cmn.active_slot, img->cmn.num_slots, img->slot.state);
+        img->cmn.upd_frame_index = _sg.frame_index;
+    }
+}
+
+#endif // SOKOL_GFX_EXT_IMPL
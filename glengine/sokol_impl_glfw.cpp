@@ -3,6 +3,7 @@
 #include "GLFW/glfw3.h"
 #define SOKOL_IMPL
 #include "sokol_gfx.h"
+#include "sokol_gfx_ext.h"
 #include "sokol_time.h"
 // imgui support
 #include "imgui/imgui.h"
@@ -3,6 +3,7 @@
 //#define SOKOL_NO_ENTRY
 #include "sokol_app.h"
 #include "sokol_gfx.h"
+#include "sokol_gfx_ext.h"
 #include "sokol_time.h"
 #include "sokol_glue.h"
 #include "imgui/imgui.h"
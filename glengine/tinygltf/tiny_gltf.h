@@ -3948,6 +3948,21 @@ static bool ParseBuffer(Buffer *buffer, std::string *err, const json &o,
   buffer->uri.clear();
   ParseStringProperty(&buffer->uri, err, o, "uri", false, "Buffer");
 
+  // fallback buffers of EXT_meshopt_compression have no data: the buffer
+  // views using them are decoded from compressed data by the application
+  if (buffer->uri.empty()) {
+    ExtensionMap extensions;
+    ParseExtensionsProperty(&extensions, err, o);
+    auto meshopt = extensions.find("EXT_meshopt_compression");
+    if (meshopt != extensions.end() && meshopt->second.Has("fallback") &&
+        meshopt->second.Get("fallback").IsBool() &&
+        meshopt->second.Get("fallback").Get<bool>()) {
+      buffer->extensions = extensions;
+      ParseStringProperty(&buffer->name, err, o, "name", false);
+      return true;
+    }
+  }
+
   // having an empty uri for a non embedded image should not be valid
   if (!is_binary && buffer->uri.empty()) {
     if (err) {
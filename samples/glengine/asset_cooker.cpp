@@ -0,0 +1,663 @@
+#include "stb/stb_image.h"
+#include "tinygltf/tiny_gltf.h"
+
+#include "gl_gltf_mesh.h"
+#include "gl_mesh_optimizer.h"
+#include "gl_mesh_simplifier.h"
+#include "gl_meshlets.h"
+#include "gl_mipmap.h"
+#include "gl_package.h"
+#include "gl_scene_streamer.h"
+#include "gl_texture_compression.h"
+#include "gl_thread_pool.h"
+#include "gl_utils.h"
+
+#include "cmdline.h"
+
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+using glengine::PackageData;
+using glengine::PackageEntryType;
+
+constexpr uint32_t CACHE_MAGIC = 0x48434B47; // "GKCH"
+constexpr uint32_t CACHE_VERSION = 2;
+
+double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool has_extension(const std::string &filename, const char *ext) {
+    const size_t len = strlen(ext);
+    return filename.size() >= len && filename.compare(filename.size() - len, len, ext) == 0;
+}
+
+std::string get_directory(const std::string &filename) {
+    size_t pos = filename.find_last_of("/\\");
+    return pos != std::string::npos ? filename.substr(0, pos + 1) : "";
+}
+
+int64_t file_size(const std::string &filename) {
+    struct stat st;
+    return stat(filename.c_str(), &st) == 0 ? int64_t(st.st_size) : -1;
+}
+
+// images are decoded by the cook jobs, not by tinygltf (see keep_encoded_image in the gltf loader)
+bool keep_encoded_image(tinygltf::Image *image, const int, std::string *, std::string *, int, int,
+                        const unsigned char *bytes, int size, void *) {
+    if (image->bufferView < 0) {
+        image->image.assign(bytes, bytes + size);
+    }
+    image->as_is = true;
+    return true;
+}
+
+struct Dependency {
+    std::string path;
+    int64_t mtime;
+};
+
+/// a source file (gltf scene or image) given on the command line, and the package entries cooked from it
+struct Input {
+    std::string path;       ///< normalized path, also the name of the model or texture entry
+    std::string cache_name; ///< prefix of the files of the input in the cache directory
+    bool gltf = false;
+    bool reused = false; ///< entries read back from the cache
+    bool ok = false;
+    std::vector<Dependency> dependencies;
+    std::vector<PackageData> entries;
+    // cooking state
+    tinygltf::Model model;
+    std::map<int, size_t> image_entries; ///< texture entry of each gltf image
+    glengine::PackageCells cells;        ///< when the scene is split in cells for streaming
+    size_t source_bytes = 0;
+    size_t triangles = 0;
+    size_t lod_triangles = 0; ///< of the levels of detail, besides the full meshes
+    size_t meshlets = 0;
+    double acmr_before = 0.0; ///< cache miss ratios weighted by the number of triangles
+    double acmr_after = 0.0;
+};
+
+/// unit of work of the cook, filling one entry of an input. Jobs of all the inputs run on the worker threads
+struct Job {
+    Input *input;
+    size_t entry;
+    std::function<bool(Input &, PackageData &)> cook;
+    bool ok = false;
+};
+
+uint64_t settings_hash(const cmdline::parser &cl) {
+    const std::string settings = cl.get<std::string>("filter") + (cl.exist("no-optimize") ? "-" : "+") +
+                                 std::to_string(cl.get<float>("cells")) + "/" +
+                                 std::to_string(cl.get<uint32_t>("lods")) + (cl.exist("meshlets") ? "m" : "");
+    return glengine::murmur_hash2_64(settings.data(), int(settings.size()), CACHE_VERSION);
+}
+
+// cache files: <name>.deps with the dependencies of the input and the settings used to cook it, and <name>.gpkg
+// with the cooked entries
+bool read_cache(const std::string &cache_dir, uint64_t settings, Input &input) {
+    FILE *f = fopen((cache_dir + input.cache_name + ".deps").c_str(), "rb");
+    if (!f) {
+        return false;
+    }
+    uint32_t header[2] = {0, 0}, num_dependencies = 0;
+    uint64_t cooked_settings = 0;
+    bool ok = fread(header, sizeof(header), 1, f) == 1 && header[0] == CACHE_MAGIC && header[1] == CACHE_VERSION &&
+              fread(&cooked_settings, sizeof(cooked_settings), 1, f) == 1 && cooked_settings == settings &&
+              fread(&num_dependencies, sizeof(num_dependencies), 1, f) == 1;
+    for (uint32_t i = 0; i < num_dependencies && ok; i++) {
+        Dependency dep;
+        uint32_t length = 0;
+        ok = fread(&dep.mtime, sizeof(dep.mtime), 1, f) == 1 && fread(&length, sizeof(length), 1, f) == 1 &&
+             length < 4096;
+        if (ok) {
+            dep.path.resize(length);
+            ok = fread(&dep.path[0], 1, length, f) == length && glengine::file_mtime(dep.path.c_str()) == dep.mtime;
+        }
+        input.dependencies.push_back(dep);
+    }
+    fclose(f);
+    glengine::Package package;
+    ok = ok && package.open((cache_dir + input.cache_name + ".gpkg").c_str());
+    for (size_t i = 0; ok && i < package.entries().size(); i++) {
+        const auto &entry = package.entries()[i];
+        input.entries.push_back({entry.name, entry.type, {}});
+        ok = package.read(entry, input.entries.back().data);
+    }
+    if (!ok) {
+        input.dependencies.clear();
+        input.entries.clear();
+    }
+    return ok;
+}
+
+bool write_cache(const std::string &cache_dir, uint64_t settings, const Input &input) {
+    if (!glengine::write_package((cache_dir + input.cache_name + ".gpkg").c_str(), input.entries)) {
+        return false;
+    }
+    // the dependencies are written last: an interrupted cook leaves no valid cache entry
+    FILE *f = fopen((cache_dir + input.cache_name + ".deps").c_str(), "wb");
+    if (!f) {
+        return false;
+    }
+    const uint32_t header[2] = {CACHE_MAGIC, CACHE_VERSION};
+    const uint32_t num_dependencies = uint32_t(input.dependencies.size());
+    bool ok = fwrite(header, sizeof(header), 1, f) == 1 && fwrite(&settings, sizeof(settings), 1, f) == 1 &&
+              fwrite(&num_dependencies, sizeof(num_dependencies), 1, f) == 1;
+    for (const auto &dep : input.dependencies) {
+        const uint32_t length = uint32_t(dep.path.size());
+        ok = ok && fwrite(&dep.mtime, sizeof(dep.mtime), 1, f) == 1 && fwrite(&length, sizeof(length), 1, f) == 1 &&
+             fwrite(dep.path.data(), 1, length, f) == length;
+    }
+    return fclose(f) == 0 && ok;
+}
+
+void add_dependency(Input &input, const std::string &path) {
+    const int64_t size = file_size(path);
+    input.dependencies.push_back({path, glengine::file_mtime(path.c_str())});
+    input.source_bytes += size > 0 ? size_t(size) : 0;
+}
+
+// decode an image, build its mip chain and compress it in the format matching its usage (see
+// choose_texture_format). The suffix of the entry name tells the format, so that an image used in different ways
+// by different models gets one entry per format
+bool cook_image(const uint8_t *encoded, size_t size, uint32_t usage, glengine::MipFilter filter, bool suffix,
+                PackageData &entry) {
+    stbi_set_flip_vertically_on_load_thread(false);
+    int width, height, num_channels;
+    uint8_t *pixels = stbi_load_from_memory(encoded, int(size), &width, &height, &num_channels, 4);
+    if (!pixels) {
+        printf("unable to decode image '%s'\n", entry.name.c_str());
+        return false;
+    }
+    glengine::TextureFormat format;
+    bool srgb;
+    glengine::choose_texture_format(usage, pixels, size_t(width) * height, format, srgb);
+    glengine::MipChainOptions options;
+    options.filter = filter;
+    options.srgb = srgb;
+    options.parallel = false;
+    glengine::MipChain chain;
+    glengine::CompressedImage image;
+    bool ok = glengine::build_mip_chain(pixels, width, height, chain, options) &&
+              glengine::compress_mip_chain(chain, format, srgb, image, false) &&
+              glengine::save_texture_file(image, entry.data);
+    stbi_image_free(pixels);
+    if (suffix) {
+        entry.name += std::string(".") + glengine::texture_format_name(format) + (srgb ? "-srgb" : "");
+    }
+    return ok;
+}
+
+// optimize each meshlet for the vertex cache on its own, with its vertices renumbered so that it costs its size
+void optimize_meshlets(glengine::MeshData &md) {
+    std::vector<uint32_t> local_index(md.vertices.size(), ~0u), vertices, local;
+    for (const auto &meshlet : md.meshlets) {
+        uint32_t *indices = md.indices.data() + meshlet.first_index;
+        vertices.clear();
+        local.resize(meshlet.num_indices);
+        for (uint32_t i = 0; i < meshlet.num_indices; i++) {
+            uint32_t &l = local_index[indices[i]];
+            if (l == ~0u) {
+                l = uint32_t(vertices.size());
+                vertices.push_back(indices[i]);
+            }
+            local[i] = l;
+        }
+        glengine::optimize_vertex_cache(local.data(), local.size(), vertices.size());
+        for (uint32_t i = 0; i < meshlet.num_indices; i++) {
+            indices[i] = vertices[local[i]];
+        }
+        for (uint32_t v : vertices) {
+            local_index[v] = ~0u;
+        }
+    }
+}
+
+// cell is the index of the cell of the mesh in the cells of the input, or -1. The levels of detail are simplified
+// from the deduplicated vertices, and each of them is optimized for the vertex cache, then each meshlet of the full
+// level once they are built
+bool cook_mesh(glengine::MeshData &md, int material, bool optimize, uint32_t lods, bool meshlets, Input &input,
+               int cell, PackageData &entry) {
+    const size_t triangles = md.indices.size() / 3;
+    const float before = glengine::average_cache_miss_ratio(md.indices.data(), md.indices.size(), md.vertices.size());
+    if (optimize || lods > 0) {
+        glengine::deduplicate_vertices(md.vertices, md.indices);
+    }
+    if (lods > 0) {
+        glengine::LodOptions options;
+        options.max_lods = lods;
+        glengine::generate_lods(md, options);
+    }
+    if (optimize) {
+        if (md.lods.empty()) {
+            glengine::optimize_vertex_cache(md.indices.data(), md.indices.size(), md.vertices.size());
+        }
+        for (const auto &lod : md.lods) {
+            glengine::optimize_vertex_cache(md.indices.data() + lod.first_index, lod.num_indices, md.vertices.size());
+        }
+    }
+    if (meshlets) {
+        glengine::build_meshlets(md);
+        if (optimize) {
+            optimize_meshlets(md);
+        }
+    }
+    if (optimize) {
+        glengine::optimize_vertex_fetch(md.vertices, md.indices);
+    }
+    const size_t full_indices = md.lods.empty() ? md.indices.size() : md.lods[0].num_indices;
+    const float after = glengine::average_cache_miss_ratio(md.indices.data(), full_indices, md.vertices.size());
+    glengine::encode_mesh(md, material, entry.data);
+    // stats of the input are updated by several jobs
+    static std::mutex stats_mutex;
+    std::lock_guard<std::mutex> lock(stats_mutex);
+    if (cell >= 0) {
+        input.cells.cells[cell].gpu_bytes +=
+            md.vertices.size() * sizeof(glengine::Vertex) + md.indices.size() * sizeof(uint32_t);
+    }
+    input.triangles += triangles;
+    input.lod_triangles += (md.indices.size() - full_indices) / 3;
+    input.meshlets += md.meshlets.size();
+    input.acmr_before += double(before) * triangles;
+    input.acmr_after += double(after) * triangles;
+    return true;
+}
+
+bool cook_mesh(const tinygltf::Model &model, const tinygltf::Primitive &primitive, const math::Matrix4f &tf,
+               bool optimize, uint32_t lods, bool meshlets, Input &input, PackageData &entry) {
+    glengine::MeshData md;
+    return glengine::gltf_primitive_mesh_data(model, primitive, tf, md) &&
+           cook_mesh(md, primitive.material, optimize, lods, meshlets, input, -1, entry);
+}
+
+// encoded data of a gltf image
+std::pair<const uint8_t *, size_t> encoded_image(const tinygltf::Model &model, const tinygltf::Image &img) {
+    if (img.bufferView >= 0 && img.bufferView < int(model.bufferViews.size())) {
+        const tinygltf::BufferView &view = model.bufferViews[img.bufferView];
+        return {model.buffers[view.buffer].data.data() + view.byteOffset, view.byteLength};
+    }
+    return {img.image.data(), img.image.size()};
+}
+
+// split the primitives of a scene (with the node transforms baked in) in cells, and create the jobs cooking the mesh
+// of each material of each cell. The Cells entry is written once the sizes of the meshes are known (see finish_gltf)
+void prepare_cells(Input &input, const std::vector<std::pair<const tinygltf::Primitive *, math::Matrix4f>> &primitives,
+                   float cell_size, bool optimize, uint32_t lods, bool meshlets, glengine::PackageModel &package_model,
+                   std::vector<Job> &jobs) {
+    using CellMeshes = std::map<std::array<int32_t, 3>, glengine::MeshData>;
+    std::map<int, CellMeshes> materials; // cell meshes of each material
+    glengine::MeshData md;
+    for (const auto &p : primitives) {
+        if (glengine::gltf_primitive_mesh_data(input.model, *p.first, p.second, md)) {
+            glengine::split_mesh_in_cells(md, cell_size, materials[p.first->material]);
+        }
+    }
+    std::map<std::array<int32_t, 3>, std::vector<std::pair<int, glengine::MeshData *>>> cells;
+    for (auto &m : materials) {
+        for (auto &c : m.second) {
+            cells[c.first].push_back({m.first, &c.second});
+        }
+    }
+    input.cells.materials = input.path + "#materials";
+    input.cells.cell_size = cell_size;
+    for (auto &c : cells) {
+        const int cell = int(input.cells.cells.size());
+        input.cells.cells.emplace_back();
+        glengine::PackageCell &pc = input.cells.cells.back();
+        bool first = true;
+        for (auto &m : c.second) {
+            for (const auto &v : m.second->vertices) {
+                pc.bbox_min = first ? v.pos : math::Vector3f{std::min(pc.bbox_min.x, v.pos.x),
+                                                             std::min(pc.bbox_min.y, v.pos.y),
+                                                             std::min(pc.bbox_min.z, v.pos.z)};
+                pc.bbox_max = first ? v.pos : math::Vector3f{std::max(pc.bbox_max.x, v.pos.x),
+                                                             std::max(pc.bbox_max.y, v.pos.y),
+                                                             std::max(pc.bbox_max.z, v.pos.z)};
+                first = false;
+            }
+            const std::string name = input.path + "#cell" + std::to_string(c.first[0]) + "_" +
+                                     std::to_string(c.first[1]) + "_" + std::to_string(c.first[2]) + "_material" +
+                                     std::to_string(m.first);
+            pc.meshes.push_back(name);
+            package_model.meshes.push_back(name);
+            input.entries.push_back({name, PackageEntryType::Mesh, {}});
+            auto cell_md = std::make_shared<glengine::MeshData>(std::move(*m.second));
+            const int material = m.first;
+            jobs.push_back({&input, input.entries.size() - 1,
+                            [cell_md, material, optimize, lods, meshlets, cell](Input &in, PackageData &e) {
+                                return cook_mesh(*cell_md, material, optimize, lods, meshlets, in, cell, e);
+                            }});
+        }
+    }
+}
+
+// load a gltf scene and create the jobs cooking its textures and meshes (one mesh entry per primitive instance,
+// with the node transforms baked in, like create_from_gltf does, or one per material and cell when cell_size > 0)
+bool prepare_gltf(Input &input, glengine::MipFilter filter, bool optimize, uint32_t lods, bool meshlets,
+                  float cell_size, std::vector<Job> &jobs) {
+    input.gltf = true;
+    tinygltf::TinyGLTF loader;
+    loader.SetImageLoader(keep_encoded_image, nullptr);
+    std::string err, warn;
+    tinygltf::Model &model = input.model;
+    bool ok = has_extension(input.path, ".glb") ? loader.LoadBinaryFromFile(&model, &err, &warn, input.path)
+                                                : loader.LoadASCIIFromFile(&model, &err, &warn, input.path);
+    if (!ok || !glengine::gltf_decode_meshopt(model)) {
+        printf("unable to load '%s': %s\n", input.path.c_str(), err.c_str());
+        return false;
+    }
+    add_dependency(input, input.path);
+    const std::string dir = get_directory(input.path);
+    for (const auto &buffer : model.buffers) {
+        if (!buffer.uri.empty() && buffer.uri.compare(0, 5, "data:") != 0) {
+            add_dependency(input, glengine::normalize_path(dir + buffer.uri));
+        }
+    }
+    // textures, with the usage of every image
+    std::map<int, uint32_t> usage;
+    auto use = [&](int texture, uint32_t u) {
+        if (texture >= 0 && texture < int(model.textures.size()) && model.textures[texture].source >= 0 &&
+            model.textures[texture].source < int(model.images.size())) {
+            usage[model.textures[texture].source] |= u;
+        }
+    };
+    for (const auto &mtl : model.materials) {
+        use(mtl.pbrMetallicRoughness.baseColorTexture.index, glengine::TextureUsageColor);
+        use(mtl.emissiveTexture.index, glengine::TextureUsageEmissive);
+        use(mtl.normalTexture.index, glengine::TextureUsageNormal);
+        use(mtl.pbrMetallicRoughness.metallicRoughnessTexture.index, glengine::TextureUsageMetallicRoughness);
+        use(mtl.occlusionTexture.index, glengine::TextureUsageOcclusion);
+    }
+    for (const auto &u : usage) {
+        const tinygltf::Image &img = model.images[u.first];
+        std::string name = input.path + "#image" + std::to_string(u.first);
+        if (img.bufferView < 0 && !img.uri.empty() && img.uri.compare(0, 5, "data:") != 0) {
+            name = glengine::normalize_path(dir + img.uri);
+            add_dependency(input, name);
+        }
+        input.image_entries[u.first] = input.entries.size();
+        input.entries.push_back({name, PackageEntryType::Texture, {}});
+        const int image = u.first;
+        const uint32_t image_usage = u.second;
+        jobs.push_back({&input, input.entries.size() - 1, [image, image_usage, filter](Input &in, PackageData &e) {
+                            auto encoded = encoded_image(in.model, in.model.images[image]);
+                            return cook_image(encoded.first, encoded.second, image_usage, filter, true, e);
+                        }});
+    }
+    // meshes
+    glengine::PackageModel package_model;
+    package_model.materials = input.path + "#materials";
+    std::vector<std::pair<const tinygltf::Primitive *, math::Matrix4f>> primitives; // instances of the primitives
+    std::function<void(int, const math::Matrix4f &)> add_node = [&](int index, const math::Matrix4f &parent_tf) {
+        if (index < 0 || index >= int(model.nodes.size())) {
+            return;
+        }
+        const tinygltf::Node &node = model.nodes[index];
+        const math::Matrix4f tf = parent_tf * glengine::gltf_node_transform(node);
+        if (node.mesh >= 0 && node.mesh < int(model.meshes.size())) {
+            // packages have no instancing: instances (EXT_mesh_gpu_instancing) are baked into copies of the mesh
+            std::vector<math::Matrix4f> instances;
+            if (!glengine::gltf_node_instances(model, node, instances)) {
+                instances = {math::matrix4_identity<float>()};
+            }
+            for (const auto &instance : instances) {
+                for (const auto &primitive : model.meshes[node.mesh].primitives) {
+                    primitives.push_back({&primitive, tf * instance});
+                }
+            }
+        }
+        for (int child : node.children) {
+            add_node(child, tf);
+        }
+    };
+    if (!model.scenes.empty()) {
+        const int scene = model.defaultScene >= 0 ? model.defaultScene : 0;
+        for (int node : model.scenes[scene].nodes) {
+            add_node(node, glengine::gltf_root_transform());
+        }
+    }
+    if (cell_size > 0.0f) {
+        prepare_cells(input, primitives, cell_size, optimize, lods, meshlets, package_model, jobs);
+    } else {
+        for (const auto &p : primitives) {
+            const std::string name = input.path + "#mesh" + std::to_string(package_model.meshes.size());
+            package_model.meshes.push_back(name);
+            input.entries.push_back({name, PackageEntryType::Mesh, {}});
+            const tinygltf::Primitive *primitive = p.first;
+            const math::Matrix4f mesh_tf = p.second;
+            jobs.push_back({&input, input.entries.size() - 1,
+                            [primitive, mesh_tf, optimize, lods, meshlets](Input &in, PackageData &e) {
+                                return cook_mesh(in.model, *primitive, mesh_tf, optimize, lods, meshlets, in, e);
+                            }});
+        }
+    }
+    input.entries.push_back({input.path, PackageEntryType::Model, {}});
+    glengine::encode_model(package_model, input.entries.back().data);
+    return true;
+}
+
+// material table of a gltf scene, once the names of its texture entries are known
+void finish_gltf(Input &input) {
+    const tinygltf::Model &model = input.model;
+    auto texture_name = [&](int texture) -> std::string {
+        if (texture < 0 || texture >= int(model.textures.size())) {
+            return "";
+        }
+        auto it = input.image_entries.find(model.textures[texture].source);
+        return it != input.image_entries.end() ? input.entries[it->second].name : "";
+    };
+    std::vector<glengine::PackageMaterial> materials;
+    for (const auto &mtl : model.materials) {
+        glengine::PackageMaterial m;
+        const auto &pbr = mtl.pbrMetallicRoughness;
+        m.name = mtl.name;
+        if (pbr.baseColorFactor.size() == 4) {
+            m.base_color = {float(pbr.baseColorFactor[0]), float(pbr.baseColorFactor[1]),
+                            float(pbr.baseColorFactor[2]), float(pbr.baseColorFactor[3])};
+        }
+        if (mtl.emissiveFactor.size() == 3) {
+            m.emissive = {float(mtl.emissiveFactor[0]), float(mtl.emissiveFactor[1]), float(mtl.emissiveFactor[2])};
+        }
+        m.metallic = float(pbr.metallicFactor);
+        m.roughness = float(pbr.roughnessFactor);
+        m.unlit = mtl.extensions.count("KHR_materials_unlit") > 0;
+        m.textures[glengine::PackageMaterial::BaseColor] = texture_name(pbr.baseColorTexture.index);
+        m.textures[glengine::PackageMaterial::MetallicRoughness] = texture_name(pbr.metallicRoughnessTexture.index);
+        m.textures[glengine::PackageMaterial::Normal] = texture_name(mtl.normalTexture.index);
+        m.textures[glengine::PackageMaterial::Occlusion] = texture_name(mtl.occlusionTexture.index);
+        m.textures[glengine::PackageMaterial::Emissive] = texture_name(mtl.emissiveTexture.index);
+        materials.push_back(std::move(m));
+    }
+    input.entries.push_back({input.path + "#materials", PackageEntryType::Materials, {}});
+    glengine::encode_materials(materials, input.entries.back().data);
+    if (!input.cells.cells.empty()) {
+        input.entries.push_back({input.path + "#cells", PackageEntryType::Cells, {}});
+        glengine::encode_cells(input.cells, input.entries.back().data);
+        printf("  %s: %zu cells of size %.1f\n", input.path.c_str(), input.cells.cells.size(), input.cells.cell_size);
+    }
+    input.model = tinygltf::Model();
+}
+
+// standalone images are cooked as color textures, under their own path
+bool prepare_image(Input &input, glengine::MipFilter filter, std::vector<Job> &jobs) {
+    if (file_size(input.path) <= 0) {
+        printf("unable to access '%s'\n", input.path.c_str());
+        return false;
+    }
+    add_dependency(input, input.path);
+    input.entries.push_back({input.path, PackageEntryType::Texture, {}});
+    jobs.push_back({&input, 0, [filter](Input &in, PackageData &e) {
+                        FILE *f = fopen(in.path.c_str(), "rb");
+                        std::vector<uint8_t> encoded(in.source_bytes);
+                        bool ok = f && fread(encoded.data(), 1, encoded.size(), f) == encoded.size();
+                        if (f) {
+                            fclose(f);
+                        }
+                        return ok && cook_image(encoded.data(), encoded.size(), glengine::TextureUsageColor, filter,
+                                                false, e);
+                    }});
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    cmdline::parser cl;
+    cl.add<std::string>("output", 'o', "output package (.gpkg)", true, "");
+    cl.add<std::string>("cache", 'c', "cache directory of the incremental cook (default: <output>.cache)", false, "");
+    cl.add<std::string>("filter", 'f', "mipmaps downsampling filter", false, "kaiser",
+                        cmdline::oneof<std::string>("box", "kaiser"));
+    cl.add("no-optimize", 'n', "don't reorder the meshes for the vertex cache and vertex fetch");
+    cl.add("force", 'F', "ignore the cache and cook all the inputs");
+    cl.add<float>("cells", 's', "split the gltf scenes in cells of this size for streaming (0: no cells)", false, 0.0f);
+    cl.add<uint32_t>("lods", 'l', "levels of detail of the meshes, besides the full ones", false, 0,
+                     cmdline::range(0, 8));
+    cl.add("meshlets", 'm', "split the full meshes in meshlets, culled when drawn");
+    cl.footer("inputs...");
+    cl.parse_check(argc, argv);
+    if (cl.rest().empty()) {
+        printf("no inputs\n%s", cl.usage().c_str());
+        return 1;
+    }
+
+    const double start = now_ms();
+    const std::string output = cl.get<std::string>("output");
+    std::string cache_dir = cl.get<std::string>("cache");
+    cache_dir = (cache_dir.empty() ? output + ".cache" : cache_dir) + "/";
+    mkdir(cache_dir.c_str(), 0755);
+    const glengine::MipFilter filter =
+        cl.get<std::string>("filter") == "box" ? glengine::MipFilter::Box : glengine::MipFilter::Kaiser;
+    const bool optimize = !cl.exist("no-optimize");
+    const float cell_size = cl.get<float>("cells");
+    const uint32_t lods = cl.get<uint32_t>("lods");
+    const bool meshlets = cl.exist("meshlets");
+    const uint64_t settings = settings_hash(cl);
+
+    // inputs with unchanged dependencies are read back from the cache, the others are loaded and split in jobs
+    std::vector<std::unique_ptr<Input>> inputs;
+    std::set<std::string> unique_paths;
+    for (const auto &arg : cl.rest()) {
+        const std::string path = glengine::normalize_path(arg);
+        if (unique_paths.insert(path).second) {
+            inputs.emplace_back(new Input());
+            inputs.back()->path = path;
+            char name[32];
+            snprintf(name, sizeof(name), "%016llx",
+                     (unsigned long long)glengine::murmur_hash2_64(path.data(), int(path.size()), 12345678));
+            inputs.back()->cache_name = name;
+        }
+    }
+    std::vector<std::vector<Job>> input_jobs(inputs.size());
+    glengine::parallel_for(0, uint32_t(inputs.size()), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            Input &input = *inputs[i];
+            if (!cl.exist("force") && read_cache(cache_dir, settings, input)) {
+                input.reused = input.ok = true;
+            } else if (has_extension(input.path, ".gltf") || has_extension(input.path, ".glb")) {
+                input.ok = prepare_gltf(input, filter, optimize, lods, meshlets, cell_size, input_jobs[i]);
+            } else {
+                input.ok = prepare_image(input, filter, input_jobs[i]);
+            }
+        }
+    });
+    std::vector<Job> jobs;
+    for (auto &j : input_jobs) {
+        jobs.insert(jobs.end(), std::make_move_iterator(j.begin()), std::make_move_iterator(j.end()));
+    }
+    const double prepared = now_ms();
+
+    // textures and meshes of all the inputs are cooked on the worker threads, one job per task
+    glengine::parallel_for(0, uint32_t(jobs.size()), 1, [&jobs](uint32_t begin, uint32_t end) {
+        for (uint32_t k = begin; k < end; k++) {
+            jobs[k].ok = jobs[k].cook(*jobs[k].input, jobs[k].input->entries[jobs[k].entry]);
+        }
+    });
+    for (const auto &job : jobs) {
+        if (!job.ok) {
+            job.input->ok = false;
+        }
+    }
+    const double cooked = now_ms();
+
+    // cache the cooked inputs, then write the package (entries shared by several inputs are written once)
+    std::vector<PackageData> entries;
+    std::set<std::string> names;
+    size_t source_bytes = 0, num_cooked = 0, num_reused = 0, num_failed = 0, triangles = 0, lod_triangles = 0;
+    size_t num_meshlets = 0;
+    double acmr_before = 0.0, acmr_after = 0.0;
+    for (auto &input : inputs) {
+        if (!input->ok) {
+            printf("  failed  %s\n", input->path.c_str());
+            num_failed++;
+            continue;
+        }
+        if (!input->reused) {
+            if (input->gltf) {
+                finish_gltf(*input);
+            }
+            if (!write_cache(cache_dir, settings, *input)) {
+                printf("unable to write the cache of '%s' to '%s'\n", input->path.c_str(), cache_dir.c_str());
+            }
+            source_bytes += input->source_bytes;
+            triangles += input->triangles;
+            lod_triangles += input->lod_triangles;
+            num_meshlets += input->meshlets;
+            acmr_before += input->acmr_before;
+            acmr_after += input->acmr_after;
+            num_cooked++;
+        } else {
+            num_reused++;
+        }
+        size_t bytes = 0;
+        for (auto &entry : input->entries) {
+            bytes += entry.data.size();
+            if (names.insert(entry.name).second) {
+                entries.push_back(std::move(entry));
+            }
+        }
+        printf("  %-6s  %s: %zu entries, %zu bytes\n", input->reused ? "cached" : "cooked", input->path.c_str(),
+               input->entries.size(), bytes);
+    }
+    if (!glengine::write_package(output.c_str(), entries)) {
+        return 1;
+    }
+    const double end = now_ms();
+    const int64_t package_size = file_size(output);
+
+    printf("%zu inputs cooked, %zu from the cache, %zu failed: %zu entries, package '%s' %lld bytes\n", num_cooked,
+           num_reused, num_failed, entries.size(), output.c_str(), (long long)package_size);
+    if (triangles > 0) {
+        printf("meshes: %zu triangles, average cache miss ratio %.3f -> %.3f\n", triangles, acmr_before / triangles,
+               acmr_after / triangles);
+    }
+    if (lod_triangles > 0) {
+        printf("levels of detail: %zu triangles, %.1f%% of the full meshes\n", lod_triangles,
+               100.0 * lod_triangles / std::max(triangles, size_t(1)));
+    }
+    if (num_meshlets > 0) {
+        printf("meshlets: %zu, %.1f triangles each\n", num_meshlets, double(triangles) / num_meshlets);
+    }
+    const double cook_ms = cooked - start;
+    printf("time: load %.1f ms, cook %.1f ms, write %.1f ms, total %.1f ms - %.1f MB/s of sources cooked on %u "
+           "threads\n",
+           prepared - start, cooked - prepared, end - cooked, end - start,
+           cook_ms > 0.0 ? source_bytes / (1024.0 * 1024.0) / (cook_ms / 1000.0) : 0.0,
+           glengine::default_thread_pool().size() + 1);
+    return num_failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,392 @@
+#include "tinygltf/json.hpp"
+#include "tinygltf/tiny_gltf.h"
+
+#include "gl_gltf_mesh.h"
+#include "gl_meshopt_codec.h"
+
+#include "cmdline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using json = nlohmann::json;
+
+double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool has_extension(const std::string &filename, const char *ext) {
+    const size_t len = strlen(ext);
+    return filename.size() > len && filename.compare(filename.size() - len, len, ext) == 0;
+}
+
+std::string get_directory(const std::string &filename) {
+    size_t pos = filename.find_last_of("/\\");
+    return pos != std::string::npos ? filename.substr(0, pos + 1) : "";
+}
+
+size_t file_size(const std::string &filename) {
+    std::ifstream f(filename, std::ios::binary | std::ios::ate);
+    return f ? size_t(f.tellg()) : 0;
+}
+
+// only the gltf file and its buffers are read: images don't take part in the comparison
+bool read_without_images(std::vector<unsigned char> *out, std::string *err, const std::string &path, void *data) {
+    for (const char *ext : {".png", ".jpg", ".jpeg", ".PNG", ".JPG", ".JPEG"}) {
+        if (has_extension(path, ext)) {
+            return false;
+        }
+    }
+    return tinygltf::ReadWholeFile(out, err, path, data);
+}
+
+bool ignore_image(tinygltf::Image *, const int, std::string *, std::string *, int, int, const unsigned char *, int,
+                  void *) {
+    return true;
+}
+
+bool load_model(const std::string &filename, tinygltf::Model &model) {
+    tinygltf::TinyGLTF loader;
+    loader.SetImageLoader(ignore_image, nullptr);
+    loader.SetFsCallbacks({tinygltf::FileExists, tinygltf::ExpandFilePath, read_without_images,
+                           tinygltf::WriteWholeFile, nullptr});
+    std::string err, warn;
+    if (!loader.LoadASCIIFromFile(&model, &err, &warn, filename)) {
+        printf("unable to load '%s': %s\n", filename.c_str(), err.c_str());
+        return false;
+    }
+    return true;
+}
+
+// disk size of the gltf file and of its external buffers
+size_t gltf_size(const std::string &filename, const tinygltf::Model &model) {
+    size_t size = file_size(filename);
+    for (const auto &buffer : model.buffers) {
+        if (!buffer.uri.empty() && buffer.uri.compare(0, 5, "data:") != 0) {
+            size += file_size(get_directory(filename) + buffer.uri);
+        }
+    }
+    return size;
+}
+
+// how a buffer view can be compressed, from the accessors using it
+struct ViewUsage {
+    bool attributes = false; ///< used by vertex attributes
+    bool indices = false;    ///< used by primitive indices
+    bool triangles = true;   ///< all the primitives using it as indices are triangle lists
+    bool other = false;      ///< used by anything else (animations, skins, sparse accessors, images...)
+    size_t element_size = 0; ///< of the accessors, 0 if they differ
+};
+
+std::vector<ViewUsage> view_usages(const tinygltf::Model &model) {
+    std::vector<ViewUsage> usages(model.bufferViews.size());
+    std::vector<int> accessor_use(model.accessors.size(), 0); // 1: attribute, 2: indices, 4: triangle indices
+    for (const auto &mesh : model.meshes) {
+        for (const auto &primitive : mesh.primitives) {
+            for (const auto &attribute : primitive.attributes) {
+                if (attribute.second >= 0 && attribute.second < int(accessor_use.size())) {
+                    accessor_use[attribute.second] |= 1;
+                }
+            }
+            for (const auto &target : primitive.targets) {
+                for (const auto &attribute : target) {
+                    if (attribute.second >= 0 && attribute.second < int(accessor_use.size())) {
+                        accessor_use[attribute.second] |= 1;
+                    }
+                }
+            }
+            if (primitive.indices >= 0 && primitive.indices < int(accessor_use.size())) {
+                accessor_use[primitive.indices] |= primitive.mode == TINYGLTF_MODE_TRIANGLES ? 2 | 4 : 2;
+            }
+        }
+    }
+    std::vector<bool> seen(model.bufferViews.size(), false);
+    for (size_t i = 0; i < model.accessors.size(); i++) {
+        const tinygltf::Accessor &acc = model.accessors[i];
+        if (acc.bufferView < 0 || acc.bufferView >= int(usages.size())) {
+            continue;
+        }
+        ViewUsage &usage = usages[acc.bufferView];
+        const size_t element_size = size_t(tinygltf::GetComponentSizeInBytes(acc.componentType)) *
+                                    tinygltf::GetNumComponentsInType(acc.type);
+        usage.element_size = !seen[acc.bufferView] || usage.element_size == element_size ? element_size : 0;
+        seen[acc.bufferView] = true;
+        usage.attributes |= (accessor_use[i] & 1) != 0;
+        usage.indices |= (accessor_use[i] & 2) != 0;
+        usage.triangles &= (accessor_use[i] & 4) != 0 || (accessor_use[i] & 2) == 0;
+        usage.other |= accessor_use[i] == 0 || acc.sparse.isSparse;
+    }
+    for (const auto &image : model.images) {
+        if (image.bufferView >= 0 && image.bufferView < int(usages.size())) {
+            usages[image.bufferView].other = true;
+        }
+    }
+    return usages;
+}
+
+// lossless copy of a gltf file with the vertex and index buffer views compressed with EXT_meshopt_compression.
+// Vertices and indices are compressed in their original order
+bool write_compressed(const std::string &filename, const tinygltf::Model &model, const std::string &output,
+                      size_t &num_compressed) {
+    std::ifstream in(filename);
+    std::stringstream text;
+    text << in.rdbuf();
+    json doc = json::parse(text.str(), nullptr, false);
+    if (doc.is_discarded() || doc.count("bufferViews") == 0) {
+        printf("unable to parse '%s'\n", filename.c_str());
+        return false;
+    }
+    const std::vector<ViewUsage> usages = view_usages(model);
+    std::vector<uint8_t> bin;     // compressed views, and views left as they are
+    size_t fallback_size = 0;     // size of the decoded views
+    std::vector<uint8_t> encoded; // reused across views
+    std::vector<uint32_t> indices;
+    num_compressed = 0;
+    for (size_t i = 0; i < model.bufferViews.size(); i++) {
+        const tinygltf::BufferView &view = model.bufferViews[i];
+        if (view.buffer < 0 || view.buffer >= int(model.buffers.size()) ||
+            view.byteOffset + view.byteLength > model.buffers[view.buffer].data.size()) {
+            printf("invalid buffer view %d in '%s'\n", int(i), filename.c_str());
+            return false;
+        }
+        const uint8_t *data = model.buffers[view.buffer].data.data() + view.byteOffset;
+        const ViewUsage &usage = usages[i];
+        json &jview = doc["bufferViews"][i];
+        const char *mode = nullptr;
+        size_t stride = 0;
+        encoded.clear();
+        if (!usage.other && usage.attributes && !usage.indices) {
+            stride = view.byteStride > 0 ? view.byteStride : usage.element_size;
+            if (stride > 0 && stride % 4 == 0 && stride <= 256 && view.byteLength % stride == 0) {
+                mode = "ATTRIBUTES";
+                glengine::meshopt_encode_vertex_buffer(data, view.byteLength / stride, stride, encoded);
+            }
+        } else if (!usage.other && usage.indices && !usage.attributes &&
+                   (usage.element_size == 2 || usage.element_size == 4)) {
+            stride = usage.element_size;
+            const size_t count = view.byteLength / stride;
+            indices.resize(count);
+            for (size_t k = 0; k < count; k++) {
+                uint16_t v16;
+                memcpy(stride == 2 ? (void *)&v16 : (void *)&indices[k], data + k * stride, stride);
+                indices[k] = stride == 2 ? v16 : indices[k];
+            }
+            if (usage.triangles && count % 3 == 0) {
+                mode = "TRIANGLES";
+                glengine::meshopt_encode_index_buffer(indices.data(), count, encoded);
+            } else {
+                mode = "INDICES";
+                glengine::meshopt_encode_index_sequence(indices.data(), count, encoded);
+            }
+        }
+        bin.resize((bin.size() + 3) & ~size_t(3), 0);
+        if (mode) {
+            jview["buffer"] = 1;
+            jview["byteOffset"] = fallback_size;
+            jview["extensions"]["EXT_meshopt_compression"] = {{"buffer", 0},
+                                                              {"byteOffset", bin.size()},
+                                                              {"byteLength", encoded.size()},
+                                                              {"byteStride", stride},
+                                                              {"count", view.byteLength / stride},
+                                                              {"mode", mode}};
+            bin.insert(bin.end(), encoded.begin(), encoded.end());
+            fallback_size += (view.byteLength + 3) & ~size_t(3);
+            num_compressed++;
+        } else {
+            jview["buffer"] = 0;
+            jview["byteOffset"] = bin.size();
+            bin.insert(bin.end(), data, data + view.byteLength);
+        }
+    }
+    const std::string bin_name = output.substr(get_directory(output).size(), output.find_last_of('.') -
+                                                                                   get_directory(output).size()) +
+                                 ".bin";
+    doc["buffers"] = json::array();
+    doc["buffers"].push_back({{"uri", bin_name}, {"byteLength", bin.size()}});
+    doc["buffers"].push_back(
+        {{"byteLength", fallback_size}, {"extensions", {{"EXT_meshopt_compression", {{"fallback", true}}}}}});
+    for (const char *list : {"extensionsUsed", "extensionsRequired"}) {
+        if (doc.count(list) == 0) {
+            doc[list] = json::array();
+        }
+        if (std::find(doc[list].begin(), doc[list].end(), "EXT_meshopt_compression") == doc[list].end()) {
+            doc[list].push_back("EXT_meshopt_compression");
+        }
+    }
+    std::ofstream out(output);
+    out << doc.dump(1);
+    std::ofstream out_bin(get_directory(output) + bin_name, std::ios::binary);
+    out_bin.write((const char *)bin.data(), std::streamsize(bin.size()));
+    return bool(out) && bool(out_bin);
+}
+
+uint32_t read_index(const uint8_t *data, size_t k, size_t index_size) {
+    uint16_t v16 = 0;
+    uint32_t v32 = 0;
+    memcpy(index_size == 2 ? (void *)&v16 : (void *)&v32, data + k * index_size, index_size);
+    return index_size == 2 ? v16 : v32;
+}
+
+// same triangles in the same order, but their vertices can be rotated by the index codec (keeping the winding)
+bool same_triangles(const uint8_t *a, const uint8_t *b, size_t count, size_t index_size) {
+    for (size_t t = 0; t + 2 < count; t += 3) {
+        const uint32_t ta[3] = {read_index(a, t, index_size), read_index(a, t + 1, index_size),
+                                read_index(a, t + 2, index_size)};
+        const uint32_t tb[3] = {read_index(b, t, index_size), read_index(b, t + 1, index_size),
+                                read_index(b, t + 2, index_size)};
+        bool rotated = false;
+        for (int r = 0; r < 3 && !rotated; r++) {
+            rotated = ta[0] == tb[r] && ta[1] == tb[(r + 1) % 3] && ta[2] == tb[(r + 2) % 3];
+        }
+        if (!rotated) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// the compression is lossless: once decoded, every buffer view of the compressed copy must hold the same bytes as the
+// original, but for the triangle lists that can be rotated. Returns the number of views that differ, -1 if the copy
+// can't be decoded
+int count_mismatches(const tinygltf::Model &original, tinygltf::Model &compressed) {
+    if (!glengine::gltf_decode_meshopt(compressed) || compressed.bufferViews.size() != original.bufferViews.size()) {
+        return -1;
+    }
+    const std::vector<ViewUsage> usages = view_usages(original);
+    int mismatches = 0;
+    for (size_t i = 0; i < original.bufferViews.size(); i++) {
+        const tinygltf::BufferView &a = original.bufferViews[i];
+        const tinygltf::BufferView &b = compressed.bufferViews[i];
+        if (a.byteLength != b.byteLength || b.byteOffset + b.byteLength > compressed.buffers[b.buffer].data.size()) {
+            printf("buffer view %zu: %zu bytes after decoding instead of %zu\n", i, b.byteLength, a.byteLength);
+            mismatches++;
+            continue;
+        }
+        const uint8_t *data_a = original.buffers[a.buffer].data.data() + a.byteOffset;
+        const uint8_t *data_b = compressed.buffers[b.buffer].data.data() + b.byteOffset;
+        const ViewUsage &usage = usages[i];
+        const bool triangles = usage.indices && usage.triangles && !usage.attributes && !usage.other &&
+                               (usage.element_size == 2 || usage.element_size == 4);
+        const bool same = memcmp(data_a, data_b, a.byteLength) == 0 ||
+                          (triangles && same_triangles(data_a, data_b, a.byteLength / usage.element_size,
+                                                       usage.element_size));
+        if (!same) {
+            printf("buffer view %zu differs after decoding\n", i);
+            mismatches++;
+        }
+    }
+    return mismatches;
+}
+
+struct LoadTimes {
+    double total_ms = 0.0;  ///< parsing, reading the buffers, decoding and extracting the meshes
+    double decode_ms = 0.0; ///< EXT_meshopt_compression decoding
+    size_t num_vertices = 0;
+};
+
+// best of the repetitions: the files are in the OS cache after the first load, so this measures parsing and
+// decoding rather than the disk itself (cold reads scale with the sizes reported)
+bool time_load(const std::string &filename, int repetitions, LoadTimes &times) {
+    times.total_ms = times.decode_ms = 1e30;
+    for (int r = 0; r < repetitions; r++) {
+        const double start = now_ms();
+        tinygltf::Model model;
+        if (!load_model(filename, model)) {
+            return false;
+        }
+        const double decode_start = now_ms();
+        if (!glengine::gltf_decode_meshopt(model)) {
+            return false;
+        }
+        const double decode_ms = now_ms() - decode_start;
+        glengine::MeshData md;
+        times.num_vertices = 0;
+        for (const auto &mesh : model.meshes) {
+            for (const auto &primitive : mesh.primitives) {
+                if (glengine::gltf_primitive_mesh_data(model, primitive, math::matrix4_identity<float>(), md)) {
+                    times.num_vertices += md.vertices.size();
+                }
+            }
+        }
+        times.total_ms = std::min(times.total_ms, now_ms() - start);
+        times.decode_ms = std::min(times.decode_ms, decode_ms);
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    cmdline::parser cl;
+    cl.add<int>("repetitions", 'r', "number of loads of each file (the best time is reported)", false, 5,
+                cmdline::range(1, 1000));
+    cl.footer("[gltf files...]\n\nwrites a copy of each file compressed with EXT_meshopt_compression next to it "
+              "(<name>.meshopt.gltf and .bin), and compares their size and load time (without images)");
+    cl.parse_check(argc, argv);
+
+    std::vector<std::string> inputs = cl.rest();
+    if (inputs.empty()) {
+        for (const char *name : {"BoomBox", "DamagedHelmet", "FlightHelmet", "WaterBottle"}) {
+            inputs.push_back(std::string("../resources/models/") + name + "/" + name + ".gltf");
+        }
+    }
+    const int repetitions = cl.get<int>("repetitions");
+    printf("%-32s %8s %12s %12s %6s %10s %10s %10s\n", "model", "vertices", "size", "compressed", "ratio", "load",
+           "compressed", "decode");
+    size_t total_size = 0, total_compressed = 0;
+    for (const auto &input : inputs) {
+        if (!has_extension(input, ".gltf")) {
+            printf("skipping '%s': only .gltf files with external or embedded buffers are supported\n",
+                   input.c_str());
+            continue;
+        }
+        tinygltf::Model model;
+        if (!load_model(input, model)) {
+            continue;
+        }
+        const std::string output = input.substr(0, input.size() - 5) + ".meshopt.gltf";
+        size_t num_compressed = 0;
+        if (!write_compressed(input, model, output, num_compressed)) {
+            continue;
+        }
+        tinygltf::Model compressed_model;
+        if (!load_model(output, compressed_model)) {
+            continue;
+        }
+        LoadTimes original, compressed;
+        if (!time_load(input, repetitions, original) || !time_load(output, repetitions, compressed)) {
+            printf("unable to decode '%s'\n", output.c_str());
+            continue;
+        }
+        if (original.num_vertices != compressed.num_vertices) {
+            printf("'%s': %zu vertices after decoding instead of %zu\n", output.c_str(), compressed.num_vertices,
+                   original.num_vertices);
+        }
+        const int mismatches = count_mismatches(model, compressed_model);
+        if (mismatches != 0) {
+            printf("'%s': %s\n", output.c_str(),
+                   mismatches < 0 ? "unable to decode" : "the decoded buffers differ from the original ones");
+            continue;
+        }
+        const size_t size = gltf_size(input, model);
+        const size_t compressed_size = gltf_size(output, compressed_model);
+        const std::string name = input.substr(get_directory(input).size());
+        printf("%-32.32s %8zu %12zu %12zu %5.1fx %8.2fms %8.2fms %8.2fms\n", name.c_str(), original.num_vertices, size,
+               compressed_size, double(size) / std::max<size_t>(compressed_size, 1), original.total_ms,
+               compressed.total_ms, compressed.decode_ms);
+        total_size += size;
+        total_compressed += compressed_size;
+    }
+    printf("total: %zu bytes, %zu bytes compressed (%.1fx smaller)\n", total_size, total_compressed,
+           double(total_size) / std::max<size_t>(total_compressed, 1));
+    return 0;
+}
@@ -0,0 +1,218 @@
+#include "tinygltf/tiny_gltf.h"
+
+#include "gl_gltf_reader.h"
+
+#include "cmdline.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+// allocations made through operator new (the standard containers, strings and nlohmann::json all use it). The size
+// is stored in front of each block to track the memory in use
+namespace {
+
+std::atomic<size_t> num_allocations{0};
+std::atomic<size_t> allocated_bytes{0};
+std::atomic<size_t> used_bytes{0};
+std::atomic<size_t> peak_bytes{0};
+constexpr size_t HEADER_SIZE = alignof(std::max_align_t);
+
+} // namespace
+
+void *operator new(size_t size) {
+    void *p = malloc(size + HEADER_SIZE);
+    if (!p) {
+        throw std::bad_alloc();
+    }
+    *(size_t *)p = size;
+    num_allocations++;
+    allocated_bytes += size;
+    const size_t used = used_bytes += size;
+    size_t peak = peak_bytes;
+    while (used > peak && !peak_bytes.compare_exchange_weak(peak, used)) {
+    }
+    return (char *)p + HEADER_SIZE;
+}
+
+void operator delete(void *p) noexcept {
+    if (p) {
+        void *block = (char *)p - HEADER_SIZE;
+        used_bytes -= *(size_t *)block;
+        free(block);
+    }
+}
+
+void operator delete(void *p, size_t) noexcept { operator delete(p); }
+
+namespace {
+
+double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// same image handling as the engine loader: images are kept encoded
+bool keep_encoded_image(tinygltf::Image *image, const int, std::string *, std::string *, int, int,
+                        const unsigned char *bytes, int size, void *) {
+    if (image->bufferView < 0) {
+        image->image.assign(bytes, bytes + size);
+    }
+    image->as_is = true;
+    return true;
+}
+
+bool load_tinygltf(const std::string &filename, tinygltf::Model &model) {
+    tinygltf::TinyGLTF loader;
+    loader.SetImageLoader(keep_encoded_image, nullptr);
+    std::string err, warn;
+    return loader.LoadASCIIFromFile(&model, &err, &warn, filename);
+}
+
+bool load_reader(const std::string &filename, tinygltf::Model &model) {
+    return glengine::gltf_read(filename.c_str(), model);
+}
+
+struct Result {
+    double ms = 1e30;       ///< best of the repetitions
+    size_t allocations = 0; ///< number of allocations during a load
+    size_t bytes = 0;       ///< bytes allocated during a load
+    size_t peak = 0;        ///< peak memory in use during a load, beyond the memory used before it
+    size_t model_bytes = 0; ///< memory still used by the model after the load
+    std::string summary;    ///< counts of the loaded elements, to compare the loaders
+};
+
+std::string summary(const tinygltf::Model &model) {
+    size_t buffer_bytes = 0, image_bytes = 0, primitives = 0;
+    for (const auto &b : model.buffers) {
+        buffer_bytes += b.data.size();
+    }
+    for (const auto &img : model.images) {
+        image_bytes += img.image.size();
+    }
+    for (const auto &m : model.meshes) {
+        primitives += m.primitives.size();
+    }
+    char s[256];
+    snprintf(s, sizeof(s), "%zu nodes, %zu meshes (%zu primitives), %zu accessors, %zu materials, %zu textures, "
+             "%zu buffer bytes, %zu image bytes", model.nodes.size(), model.meshes.size(), primitives,
+             model.accessors.size(), model.materials.size(), model.textures.size(), buffer_bytes, image_bytes);
+    return s;
+}
+
+bool measure(const std::string &filename, int repetitions,
+             const std::function<bool(const std::string &, tinygltf::Model &)> &load, Result &result) {
+    for (int r = 0; r < repetitions; r++) {
+        const size_t allocations = num_allocations, bytes = allocated_bytes, used = used_bytes;
+        peak_bytes = used;
+        const double start = now_ms();
+        {
+            tinygltf::Model model;
+            if (!load(filename, model)) {
+                return false;
+            }
+            result.ms = std::min(result.ms, now_ms() - start);
+            result.allocations = num_allocations - allocations;
+            result.bytes = allocated_bytes - bytes;
+            result.peak = peak_bytes - used;
+            result.model_bytes = used_bytes - used;
+            if (r == 0) {
+                result.summary = summary(model);
+            }
+        }
+    }
+    return true;
+}
+
+// a scene with many small nodes, meshes and materials: the json is large compared to the buffers, as in exported
+// scenes made of many objects
+void write_generated(const std::string &filename, int num_nodes) {
+    const std::string bin = filename.substr(0, filename.find_last_of('.')) + ".bin";
+    const float positions[] = {0, 0, 0, 1, 0, 0, 0, 1, 0};
+    FILE *f = fopen(bin.c_str(), "wb");
+    fwrite(positions, sizeof(positions), 1, f);
+    fclose(f);
+    f = fopen(filename.c_str(), "w");
+    fprintf(f, "{\"asset\": {\"version\": \"2.0\"}, \"scene\": 0,\n\"scenes\": [{\"nodes\": [");
+    for (int i = 0; i < num_nodes; i++) {
+        fprintf(f, "%s%d", i ? ", " : "", i);
+    }
+    fprintf(f, "]}],\n\"nodes\": [\n");
+    for (int i = 0; i < num_nodes; i++) {
+        fprintf(f, "  {\"name\": \"node_%d\", \"mesh\": %d, \"translation\": [%d.5, 0.25, -%d.125]}%s\n", i, i, i, i,
+                i + 1 < num_nodes ? "," : "");
+    }
+    fprintf(f, "],\n\"meshes\": [\n");
+    for (int i = 0; i < num_nodes; i++) {
+        fprintf(f, "  {\"name\": \"mesh_%d\", \"primitives\": [{\"attributes\": {\"POSITION\": %d}, "
+                "\"material\": %d}]}%s\n", i, i, i, i + 1 < num_nodes ? "," : "");
+    }
+    fprintf(f, "],\n\"materials\": [\n");
+    for (int i = 0; i < num_nodes; i++) {
+        fprintf(f, "  {\"name\": \"material_%d\", \"pbrMetallicRoughness\": {\"baseColorFactor\": "
+                "[0.8, 0.2, 0.%d, 1.0], \"metallicFactor\": 0.0, \"roughnessFactor\": 0.5}}%s\n", i, i % 10,
+                i + 1 < num_nodes ? "," : "");
+    }
+    fprintf(f, "],\n\"accessors\": [\n");
+    for (int i = 0; i < num_nodes; i++) {
+        fprintf(f, "  {\"bufferView\": 0, \"componentType\": 5126, \"count\": 3, \"type\": \"VEC3\", "
+                "\"min\": [0, 0, 0], \"max\": [1, 1, 0]}%s\n", i + 1 < num_nodes ? "," : "");
+    }
+    fprintf(f, "],\n\"bufferViews\": [{\"buffer\": 0, \"byteLength\": %d}],\n", int(sizeof(positions)));
+    fprintf(f, "\"buffers\": [{\"uri\": \"%s\", \"byteLength\": %d}]\n}\n",
+            bin.substr(bin.find_last_of("/\\") + 1).c_str(), int(sizeof(positions)));
+    fclose(f);
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    cmdline::parser cl;
+    cl.add<int>("repetitions", 'r', "number of loads of each file (the best time is reported)", false, 5,
+                cmdline::range(1, 1000));
+    cl.add<int>("generate", 'g', "also load a generated file with this number of nodes, meshes and materials", false,
+                0, cmdline::range(0, 10000000));
+    cl.footer("[gltf files...]\n\ncompares the streaming gltf reader of the engine with tinygltf: load time (json, "
+              "buffers and encoded images), number of allocations and memory");
+    cl.parse_check(argc, argv);
+
+    std::vector<std::string> inputs = cl.rest();
+    if (inputs.empty()) {
+        for (const char *name : {"BoomBox", "DamagedHelmet", "FlightHelmet", "WaterBottle"}) {
+            inputs.push_back(std::string("../resources/models/") + name + "/" + name + ".gltf");
+        }
+    }
+    if (cl.get<int>("generate") > 0) {
+        inputs.push_back("benchmark_gltf_reader.gltf");
+        write_generated(inputs.back(), cl.get<int>("generate"));
+    }
+    const int repetitions = cl.get<int>("repetitions");
+
+    printf("%-28s %-10s %10s %12s %14s %14s %14s\n", "model", "loader", "time", "allocations", "allocated", "peak",
+           "model");
+    for (const auto &input : inputs) {
+        Result tiny, reader;
+        if (!measure(input, repetitions, load_tinygltf, tiny) || !measure(input, repetitions, load_reader, reader)) {
+            printf("unable to load '%s'\n", input.c_str());
+            continue;
+        }
+        const std::string name = input.substr(input.find_last_of("/\\") + 1);
+        printf("%-28.28s %-10s %8.2fms %12zu %14zu %14zu %14zu\n", name.c_str(), "tinygltf", tiny.ms, tiny.allocations,
+               tiny.bytes, tiny.peak, tiny.model_bytes);
+        printf("%-28s %-10s %8.2fms %12zu %14zu %14zu %14zu  (%.1fx faster, %.1fx fewer allocations)\n", "",
+               "streaming", reader.ms, reader.allocations, reader.bytes, reader.peak, reader.model_bytes,
+               tiny.ms / std::max(reader.ms, 1e-6), double(tiny.allocations) / std::max<size_t>(reader.allocations, 1));
+        if (tiny.summary != reader.summary) {
+            printf("  different models:\n    tinygltf:  %s\n    streaming: %s\n", tiny.summary.c_str(),
+                   reader.summary.c_str());
+        }
+    }
+    return 0;
+}
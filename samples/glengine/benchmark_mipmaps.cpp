@@ -0,0 +1,123 @@
+#include "stb/stb_image.h"
+#include "stb/stb_image_resize.h"
+
+#include "gl_mipmap.h"
+
+#include "cmdline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace {
+
+double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// reference implementation: the way mipmaps were generated before, every level resized from the full resolution
+// image with stb, and one allocation per level
+int stb_mipmaps(const uint8_t *pixels, int width, int height) {
+    int level = 1;
+    for (level = 1; level < int(glengine::MipChain::MAX_LEVELS); level++) {
+        int w = width / (1 << level);
+        int h = height / (1 << level);
+        if (w < 1 || h < 1) {
+            break;
+        }
+        uint8_t *out = (uint8_t *)malloc(w * h * 4);
+        stbir_resize_uint8_generic(pixels, width, height, 0, out, w, h, 0, 4, 3, 0, STBIR_EDGE_CLAMP,
+                                   STBIR_FILTER_BOX, STBIR_COLORSPACE_SRGB, 0);
+        free(out);
+    }
+    return level;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    cmdline::parser cl;
+    cl.add<std::string>("input", 'i', "input image", false,
+                        "../resources/models/FlightHelmet/FlightHelmet_Materials_LeatherPartsMat_BaseColor.png");
+    cl.add<int>("iterations", 'n', "number of iterations per method", false, 10, cmdline::range(1, 1000));
+    cl.add<int>("size", 's', "size of the procedural image used when the input can't be loaded", false, 2048,
+                cmdline::range(1, 16384));
+    cl.parse_check(argc, argv);
+
+    const std::string filename = cl.get<std::string>("input");
+    const int iterations = cl.get<int>("iterations");
+
+    int width, height, channels;
+    uint8_t *pixels = stbi_load(filename.c_str(), &width, &height, &channels, 4);
+    std::vector<uint8_t> procedural;
+    if (!pixels) {
+        // fall back to a procedural image (smooth gradients plus some high frequency detail)
+        width = height = cl.get<int>("size");
+        printf("unable to load '%s', using a procedural %dx%d image\n", filename.c_str(), width, height);
+        procedural.resize(size_t(width) * height * 4);
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++) {
+                uint8_t *p = procedural.data() + (size_t(y) * width + x) * 4;
+                p[0] = uint8_t(x * 255 / width);
+                p[1] = uint8_t(y * 255 / height);
+                p[2] = ((x / 8 + y / 8) % 2) ? 230 : 20;
+                p[3] = 255;
+            }
+        }
+    }
+    const uint8_t *image = pixels ? pixels : procedural.data();
+    printf("image: %dx%d, %d iterations\n", width, height, iterations);
+
+    struct Method {
+        const char *name;
+        std::function<void(void)> run;
+    };
+    glengine::MipChain chain;
+    auto build = [&](glengine::MipFilter filter, bool parallel) {
+        glengine::MipChainOptions options;
+        options.filter = filter;
+        options.parallel = parallel;
+        glengine::build_mip_chain(image, width, height, chain, options);
+    };
+    std::vector<Method> methods = {
+        {"stb (from level 0)", [&]() { stb_mipmaps(image, width, height); }},
+        {"cascade box, 1 thread", [&]() { build(glengine::MipFilter::Box, false); }},
+        {"cascade box, threaded", [&]() { build(glengine::MipFilter::Box, true); }},
+        {"cascade kaiser, 1 thread", [&]() { build(glengine::MipFilter::Kaiser, false); }},
+        {"cascade kaiser, threaded", [&]() { build(glengine::MipFilter::Kaiser, true); }},
+    };
+    double reference_ms = 0.0;
+    for (auto &m : methods) {
+        m.run(); // warm up (lookup tables, thread pool, page faults)
+        double start = now_ms();
+        for (int i = 0; i < iterations; i++) {
+            m.run();
+        }
+        double ms = (now_ms() - start) / iterations;
+        if (reference_ms == 0.0) {
+            reference_ms = ms;
+        }
+        printf("  %-28s %9.2f ms  (x%.1f)\n", m.name, ms, reference_ms / ms);
+    }
+
+    // compare level 1 computed with the box filter against stb
+    build(glengine::MipFilter::Box, true);
+    const auto &lvl = chain.levels[1];
+    std::vector<uint8_t> reference(lvl.size);
+    stbir_resize_uint8_generic(image, width, height, 0, reference.data(), lvl.width, lvl.height, 0, 4, 3, 0,
+                               STBIR_EDGE_CLAMP, STBIR_FILTER_BOX, STBIR_COLORSPACE_SRGB, 0);
+    int max_diff = 0;
+    for (size_t i = 0; i < lvl.size; i++) {
+        max_diff = std::max(max_diff, std::abs(int(reference[i]) - int(chain.level_data(1)[i])));
+    }
+    printf("level 1 max abs difference vs stb: %d\n", max_diff);
+
+    if (pixels) {
+        stbi_image_free(pixels);
+    }
+    return 0;
+}
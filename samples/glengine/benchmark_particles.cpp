@@ -0,0 +1,52 @@
+#include "gl_particles.h"
+#include "gl_thread_pool.h"
+
+#include "cmdline.h"
+
+#include <cstdint>
+#include <cstdio>
+
+/// cpu cost of the particle simulation (spawn, kill, integration and the streams of the billboards), with the
+/// scalar and the SIMD kernels, on one core and on all of them. No gpu is needed, the upload is two buffer updates
+/// (the float streams and the colors)
+int main(int argc, char *argv[]) {
+    cmdline::parser cl;
+    cl.add<int>("iterations", 'n', "number of simulation steps per test", false, 100, cmdline::range(1, 10000));
+    cl.parse_check(argc, argv);
+
+    const int iterations = cl.get<int>("iterations");
+    const uint32_t num_cores = glengine::default_thread_pool().size() + 1;
+    const float dt = 1.0f / 60.0f;
+
+    for (uint32_t num_particles : {100000u, 1000000u, 4000000u}) {
+        printf("%u particles, %d steps, %u cores\n", num_particles, iterations, num_cores);
+        for (int mode = 0; mode < 3; mode++) {
+            glengine::ParticleSystem particles;
+            particles.params.max_particles = num_particles;
+            particles.params.attractor_strength = 10.0f;
+            particles.params.simd = mode > 0;
+            particles.params.parallel = mode == 2;
+            // full from the first step, the dead particles are replaced right away, and short lived so that some
+            // die at every step
+            particles.emitters.push_back(
+                {.radius = 1.0f, .rate = num_particles / dt, .life_min = 0.2f, .life_max = 0.4f});
+            for (int i = 0; i < 30; i++) {
+                particles.simulate(dt);
+            }
+            double total_ms = 0.0;
+            uint64_t updated = 0, killed = 0;
+            for (int i = 0; i < iterations; i++) {
+                particles.simulate(dt);
+                total_ms += particles.stats().simulate_ms;
+                updated += particles.stats().num_particles;
+                killed += particles.stats().num_killed;
+            }
+            const uint32_t cores = mode == 2 ? num_cores : 1;
+            const double per_ms = updated / total_ms;
+            printf("  %-18s %8.3f ms/step  %9.0f particles/ms  %9.0f particles/ms/core  (%.0f killed/step)\n",
+                   mode == 0 ? "scalar" : (mode == 1 ? "simd" : "simd, all cores"), total_ms / iterations, per_ms,
+                   per_ms / cores, double(killed) / iterations);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+#include "gl_camera.h"
+#include "gl_text_labels.h"
+
+#include "math/math_utils.h"
+#include "math/vmath.h"
+
+#include "cmdline.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+namespace {
+
+double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// labels on a grid in front of the camera, with a varying text length
+void add_labels(glengine::TextLabels &labels, int num_labels, int side) {
+    char text[32];
+    for (int i = 0; i < num_labels; i++) {
+        const float x = float(i % side) - side * 0.5f;
+        const float y = float(i / side) - side * 0.5f;
+        snprintf(text, sizeof(text), i % 3 ? "id %d" : "id %d: %.2f", i, i * 0.37f);
+        labels.add({x, y, 0.0f}, text, {255, 255, 255, 255}, float(i % 4));
+    }
+}
+
+} // namespace
+
+/// cpu cost of the text labels layout (projection, fading, overlap culling and glyph instances), the upload of the
+/// instances is a single buffer update
+int main(int argc, char *argv[]) {
+    cmdline::parser cl;
+    cl.add<std::string>("font", 'f', "ttf file, the default ImGui font if empty", false, "");
+    cl.add<int>("iterations", 'n', "number of iterations per test", false, 20, cmdline::range(1, 1000));
+    cl.add<int>("width", 'w', "viewport width", false, 1920, cmdline::range(1, 16384));
+    cl.add<int>("height", 'h', "viewport height", false, 1080, cmdline::range(1, 16384));
+    cl.parse_check(argc, argv);
+
+    const std::string font = cl.get<std::string>("font");
+    const int iterations = cl.get<int>("iterations");
+    const uint32_t width = uint32_t(cl.get<int>("width"));
+    const uint32_t height = uint32_t(cl.get<int>("height"));
+
+    glengine::TextLabels labels;
+    if (!labels.load_font(font.empty() ? nullptr : font.c_str(), 16.0f)) {
+        printf("unable to load the font\n");
+        return 1;
+    }
+
+    for (int num_labels : {10000, 100000}) {
+        const int side = int(std::sqrt(float(num_labels)));
+        // the whole grid in view, with overlaps in the distance
+        glengine::Camera cam;
+        cam.set_perspective(1.0f, 1000.0f, math::utils::deg2rad(45.0f));
+        cam.set_transform(math::create_lookat<float>({0.0f, -side * 0.8f, side * 0.6f}, {0.0f, 0.0f, 0.0f},
+                                                     {0.0f, 0.0f, 1.0f}));
+        cam.update(width, height);
+        const math::Matrix4f view_projection = cam.projection() * cam.inverse_transform();
+        const math::Vector3f cam_pos = cam.transform() * math::Vector3f{0.0f, 0.0f, 0.0f};
+        printf("%d labels, %ux%u viewport, %d iterations\n", num_labels, width, height, iterations);
+        for (bool cull : {false, true}) {
+            labels.params.cull_overlaps = cull;
+            labels.params.fade_start = float(side) * 2.0f;
+            labels.params.fade_end = float(side) * 3.0f;
+            double add_ms = 0.0, layout_ms = 0.0;
+            for (int i = 0; i < iterations; i++) {
+                double start = now_ms();
+                labels.clear();
+                add_labels(labels, num_labels, side);
+                add_ms += now_ms() - start;
+                start = now_ms();
+                labels.layout(view_projection, cam_pos, float(width), float(height));
+                layout_ms += now_ms() - start;
+            }
+            const glengine::TextLabelStats &stats = labels.stats();
+            printf("  overlap culling %-3s  add %7.2f ms  layout %7.2f ms  visible %6u  culled %6u  glyphs %7u"
+                   " (%.1f MB)\n",
+                   cull ? "on" : "off", add_ms / iterations, layout_ms / iterations, stats.num_visible,
+                   stats.num_culled, stats.num_glyphs,
+                   stats.num_glyphs * sizeof(glengine::TextLabels::GlyphInstance) / 1048576.0);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,166 @@
+#include "tinygltf/tiny_gltf.h"
+
+#include "gl_mipmap.h"
+#include "gl_texture_compression.h"
+
+#include "cmdline.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace {
+
+using glengine::TextureFormat;
+
+double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+struct TestImage {
+    std::string name;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels;
+    TextureFormat format = TextureFormat::BC1;
+    bool srgb = true;
+};
+
+// format chosen from the way materials use the image, the same choice the asset cooker makes
+void choose_format(TestImage &img, uint32_t usage) {
+    glengine::choose_texture_format(usage, img.pixels.data(), img.pixels.size() / 4, img.format, img.srgb);
+}
+
+bool load_gltf_images(const std::string &filename, std::vector<TestImage> &images) {
+    tinygltf::Model model;
+    tinygltf::TinyGLTF loader;
+    std::string err, warn;
+    const bool binary = filename.size() > 4 && filename.compare(filename.size() - 4, 4, ".glb") == 0;
+    bool ok = binary ? loader.LoadBinaryFromFile(&model, &err, &warn, filename)
+                     : loader.LoadASCIIFromFile(&model, &err, &warn, filename);
+    if (!ok) {
+        return false;
+    }
+    std::map<int, uint32_t> usage; // by image index
+    auto use = [&](int texture, uint32_t u) {
+        if (texture >= 0 && texture < int(model.textures.size()) && model.textures[texture].source >= 0) {
+            usage[model.textures[texture].source] |= u;
+        }
+    };
+    for (const auto &mtl : model.materials) {
+        use(mtl.pbrMetallicRoughness.baseColorTexture.index, glengine::TextureUsageColor);
+        use(mtl.emissiveTexture.index, glengine::TextureUsageEmissive);
+        use(mtl.normalTexture.index, glengine::TextureUsageNormal);
+        use(mtl.pbrMetallicRoughness.metallicRoughnessTexture.index, glengine::TextureUsageMetallicRoughness);
+        use(mtl.occlusionTexture.index, glengine::TextureUsageOcclusion);
+    }
+    for (auto &u : usage) {
+        const tinygltf::Image &src = model.images[u.first];
+        if (src.image.empty() || src.component != 4 || src.bits != 8) {
+            continue;
+        }
+        TestImage img;
+        img.name = src.uri.empty() ? src.name : src.uri;
+        img.width = src.width;
+        img.height = src.height;
+        img.pixels = src.image;
+        choose_format(img, u.second);
+        images.push_back(std::move(img));
+    }
+    return !images.empty();
+}
+
+// color, normal and packed occlusion/roughness/metallic maps, with gradients and some high frequency detail
+void procedural_images(uint32_t size, std::vector<TestImage> &images) {
+    const uint32_t usages[] = {glengine::TextureUsageColor, glengine::TextureUsageNormal,
+                               glengine::TextureUsageMetallicRoughness | glengine::TextureUsageOcclusion};
+    const char *names[] = {"procedural color", "procedural normal", "procedural orm"};
+    for (int k = 0; k < 3; k++) {
+        TestImage img;
+        img.name = names[k];
+        img.width = img.height = size;
+        img.pixels.resize(size_t(size) * size * 4);
+        for (uint32_t y = 0; y < size; y++) {
+            for (uint32_t x = 0; x < size; x++) {
+                uint8_t *p = img.pixels.data() + (size_t(y) * size + x) * 4;
+                const float fx = float(x) / size, fy = float(y) / size;
+                const float bump = std::sin(fx * 60.0f) * std::cos(fy * 45.0f);
+                if (usages[k] == glengine::TextureUsageNormal) {
+                    float nx = 0.4f * bump, ny = 0.4f * std::sin(fy * 30.0f);
+                    float nz = std::sqrt(std::max(1.0f - nx * nx - ny * ny, 0.0f));
+                    p[0] = uint8_t((nx * 0.5f + 0.5f) * 255);
+                    p[1] = uint8_t((ny * 0.5f + 0.5f) * 255);
+                    p[2] = uint8_t((nz * 0.5f + 0.5f) * 255);
+                } else {
+                    p[0] = uint8_t(fx * 255);
+                    p[1] = uint8_t((0.5f + 0.5f * bump) * 255);
+                    p[2] = ((x / 8 + y / 8) % 2) ? 230 : 20;
+                }
+                p[3] = 255;
+            }
+        }
+        choose_format(img, usages[k]);
+        images.push_back(std::move(img));
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    cmdline::parser cl;
+    cl.add<std::string>("input", 'i', "gltf model", false, "../resources/models/FlightHelmet/FlightHelmet.gltf");
+    cl.add<int>("size", 's', "size of the procedural images used when the model can't be loaded", false, 2048,
+                cmdline::range(4, 16384));
+    cl.parse_check(argc, argv);
+
+    std::vector<TestImage> images;
+    const std::string filename = cl.get<std::string>("input");
+    if (!load_gltf_images(filename, images)) {
+        printf("unable to load the images of '%s', using procedural images\n", filename.c_str());
+        procedural_images(cl.get<int>("size"), images);
+    }
+
+    size_t total_rgba8 = 0, total_compressed = 0;
+    double total_ms = 0.0;
+    printf("%-48s %11s %6s %12s %12s %7s %9s %7s\n", "image", "size", "format", "rgba8", "compressed", "ratio", "time",
+           "rmse");
+    for (const auto &img : images) {
+        glengine::MipChainOptions options;
+        options.srgb = img.srgb;
+        glengine::MipChain chain;
+        glengine::build_mip_chain(img.pixels.data(), img.width, img.height, chain, options);
+        glengine::CompressedImage compressed;
+        const double start = now_ms();
+        glengine::compress_mip_chain(chain, img.format, img.srgb, compressed);
+        const double ms = now_ms() - start;
+        // error of the base level, on the channels stored by the format
+        std::vector<uint8_t> decoded(chain.levels[0].size);
+        glengine::decompress_image(img.format, compressed.level_data(0), img.width, img.height, decoded.data());
+        const int channels = img.format == TextureFormat::BC4 ? 1
+                             : img.format == TextureFormat::BC5 ? 2
+                             : img.format == TextureFormat::BC1 ? 3
+                                                                 : 4;
+        double sq_error = 0.0;
+        for (size_t i = 0; i < size_t(img.width) * img.height; i++) {
+            for (int c = 0; c < channels; c++) {
+                const double d = double(decoded[i * 4 + c]) - double(img.pixels[i * 4 + c]);
+                sq_error += d * d;
+            }
+        }
+        const double rmse = std::sqrt(sq_error / (double(img.width) * img.height * channels));
+        char size[32];
+        snprintf(size, sizeof(size), "%ux%u", img.width, img.height);
+        printf("%-48.48s %11s %6s %12zu %12zu %6.1fx %7.1fms %7.2f\n", img.name.c_str(), size,
+               glengine::texture_format_name(img.format), chain.data.size(), compressed.data.size(),
+               double(chain.data.size()) / compressed.data.size(), ms, rmse);
+        total_rgba8 += chain.data.size();
+        total_compressed += compressed.data.size();
+        total_ms += ms;
+    }
+    printf("total: %zu bytes as rgba8, %zu bytes compressed (%.1fx smaller), encoded in %.1f ms\n", total_rgba8,
+           total_compressed, double(total_rgba8) / total_compressed, total_ms);
+    return 0;
+}
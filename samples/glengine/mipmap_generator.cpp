@@ -1,63 +1,104 @@
 #include "stb/stb_image.h"
 #include "stb/stb_image_write.h"
-#include "stb/stb_image_resize.h"
+
+#include "gl_mipmap.h"
+#include "gl_texture_compression.h"
 
 #include "cmdline.h"
 
 #include <string>
 #include <sstream>
 #include <cstdint>
+#include <chrono>
+
+namespace {
+
+double elapsed_ms(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+glengine::TextureFormat texture_format(const std::string &name) {
+    if (name == "bc1") {
+        return glengine::TextureFormat::BC1;
+    } else if (name == "bc3") {
+        return glengine::TextureFormat::BC3;
+    } else if (name == "bc4") {
+        return glengine::TextureFormat::BC4;
+    } else if (name == "bc5") {
+        return glengine::TextureFormat::BC5;
+    }
+    return glengine::TextureFormat::RGBA8;
+}
 
-constexpr int MAX_LEVELS = 15;
+} // namespace
 
 int main(int argc, char *argv[]) {
 
     cmdline::parser cl;
     cl.add<std::string>("input", 'i', "input file name", true, "");
-    cl.add<std::string>("output", 'o', "output file name", true, "");
+    cl.add<std::string>("output", 'o', "output file name (prefix of the png levels, or texture file)", true, "");
+    cl.add<std::string>("filter", 'f', "downsampling filter", false, "kaiser",
+                        cmdline::oneof<std::string>("box", "kaiser"));
+    cl.add("linear", 'l', "treat the image as linear data (normal maps, roughness/metallic, etc.) instead of sRGB");
+    cl.add<std::string>("format", 'c',
+                        "output format: png levels, or a texture file (.gtex) with the whole chain. bc1: color, "
+                        "bc3: color+alpha, bc4: single channel (r), bc5: two channels (rg, normal maps)",
+                        false, "png", cmdline::oneof<std::string>("png", "rgba8", "bc1", "bc3", "bc4", "bc5"));
+    cl.add("flip", 'y', "flip the image vertically (texture files are uploaded as stored)");
     cl.parse_check(argc, argv);
 
     std::string input_filename = cl.get<std::string>("input");
     std::string output_prefix = cl.get<std::string>("output");
+    const std::string format_name = cl.get<std::string>("format");
 
     int img_width, img_height, num_channels;
     const int out_channels = 4; // force rgba
-    // stbi_set_flip_vertically_on_load(true);
+    stbi_set_flip_vertically_on_load(cl.exist("flip"));
     stbi_uc *pixels = stbi_load(input_filename.c_str(), &img_width, &img_height, &num_channels, out_channels);
     if (pixels) {
-        // for (int i=0; i<10; i++) {
-        //     uint8_t *p = pixels + 4*(400*i);
-        //     printf("%x%x%x%x ",p[0], p[1], p[2], p[3]);
-        // }
-        // printf("\n");
         printf("loaded image '%s' - %dx%d %d channels\n", input_filename.c_str(), img_width, img_height, num_channels);
         // generate mipmaps
-        uint8_t *out_pixels = (uint8_t *)malloc(img_height * img_width * num_channels / 4);
-        int level = 1;
-        for (level = 1; level < MAX_LEVELS; level++) {
-            int w = img_width / (1 << level);
-            int h = img_height / (1 << level);
-            if (w < 1 || h < 1) {
-                break;
+        glengine::MipChainOptions options;
+        options.filter = cl.get<std::string>("filter") == "box" ? glengine::MipFilter::Box : glengine::MipFilter::Kaiser;
+        options.srgb = !cl.exist("linear");
+        glengine::MipChain chain;
+        auto start = std::chrono::steady_clock::now();
+        if (!glengine::build_mip_chain(pixels, img_width, img_height, chain, options)) {
+            printf("Error generating the mip chain\n");
+            stbi_image_free(pixels);
+            return 1;
+        }
+        printf("generated %d mipmap levels in %.2f ms\n", chain.num_levels, elapsed_ms(start));
+        if (format_name == "png") {
+            // write mipmap levels
+            for (uint32_t level = 1; level < chain.num_levels; level++) {
+                const auto &lvl = chain.levels[level];
+                std::stringstream out_fname;
+                out_fname << output_prefix << "_" << level << ".png";
+                printf("    writing level %d (%dx%d) to '%s'\n", level, lvl.width, lvl.height, out_fname.str().c_str());
+                stbi_write_png(out_fname.str().c_str(), lvl.width, lvl.height, out_channels, chain.level_data(level),
+                               0);
             }
-            printf("generate mipmap level %d with resolution %dx%d\n", level, w, h);
-            // resize image (starting from the original image)
-            // if (!stbir_resize_uint8(pixels, img_width, img_height, 0, out_pixels, w, h, 0, out_channels)) {
-            if (!stbir_resize_uint8_srgb(pixels, img_width, img_height, 0, out_pixels, w, h, 0, out_channels,
-                                         out_channels == 3 ? STBIR_ALPHA_CHANNEL_NONE : 3, 0)) {
-                printf("Error resizing image to %dx%d\n", w, h);
-                break;
+        } else {
+            // compress the whole chain into a texture file
+            glengine::CompressedImage image;
+            start = std::chrono::steady_clock::now();
+            glengine::compress_mip_chain(chain, texture_format(format_name), options.srgb, image);
+            printf("compressed to %s in %.2f ms: %zu bytes (rgba8: %zu bytes, %.1fx smaller)\n", format_name.c_str(),
+                   elapsed_ms(start), image.data.size(), chain.data.size(),
+                   double(chain.data.size()) / image.data.size());
+            std::string out_fname = output_prefix;
+            if (out_fname.size() < 5 || out_fname.compare(out_fname.size() - 5, 5, ".gtex") != 0) {
+                out_fname += ".gtex";
+            }
+            printf("    writing texture file '%s'\n", out_fname.c_str());
+            if (!glengine::save_texture_file(out_fname.c_str(), image)) {
+                printf("Error writing '%s'\n", out_fname.c_str());
+                stbi_image_free(pixels);
+                return 1;
             }
-            // write mipmap level
-            std::stringstream out_fname;
-            out_fname << output_prefix << "_" << level << ".png";
-            printf("    writing image '%s'\n", out_fname.str().c_str());
-            stbi_write_png(out_fname.str().c_str(), w, h, out_channels, out_pixels, 0);
         }
-        printf("generated %d mipmap levels\n", level);
         stbi_image_free(pixels);
-        free(out_pixels);
     }
     return 0;
 }
-
@@ -5,6 +5,8 @@
 #include "gl_context_glfw.h"
 #include "gl_mesh.h"
 #include "gl_prefabs.h"
+#include "gl_ring_mesh.h"
+#include "gl_utils.h"
 #include "gl_material_diffuse.h"
 #include "gl_material_flat.h"
 #include "gl_material_vertexcolor.h"
@@ -80,6 +82,11 @@ int main(void) {
     // polyline_mesh->update();
     glengine::Renderable polyline_renderable = {
         polyline_mesh, eng.create_material<glengine::MaterialFlat>(SG_PRIMITIVETYPE_LINES, SG_INDEXTYPE_NONE)};
+    // trail of a moving point: a fixed window of the last positions, only the newest ones are uploaded each frame
+    glengine::RingMesh trail;
+    trail.init(eng.create_mesh(), 2000, 256);
+    glengine::Renderable trail_renderable = {
+        trail.mesh(), eng.create_material<glengine::MaterialFlat>(SG_PRIMITIVETYPE_LINE_STRIP, SG_INDEXTYPE_NONE)};
     glengine::Mesh *triangle_mesh = eng.create_mesh();
     triangle_mesh->init(triangle_vertices);
     // triangle_mesh->update();
@@ -97,6 +104,7 @@ int main(void) {
     auto &box4 = *eng.create_object(box4_renderable, nullptr, 108);
     auto &axis = *eng.create_object(axis_renderable, nullptr, 109);
     auto &sphere = *eng.create_object(sphere_renderable, nullptr, 110);
+    eng.create_object(trail_renderable, nullptr, 111);
 
     // change object attributes
     auto *box2_mtl = (glengine::MaterialDiffuseTextured *)box2_renderable.material;
@@ -134,11 +142,19 @@ int main(void) {
 
     eng._camera_manipulator.set_azimuth(0.3f).set_elevation(1.0f);
 
+    bool show_bounds = true;
+    int num_debug_spheres = 0;
     eng.add_ui_function([&]() {
         ImGui::Begin("Object Info");
         auto id = 0; // eng.object_at_screen_coord(eng.cursor_pos());
         ImGui::Text("Object id: %d", id);
         ImGui::End();
+        const glengine::DebugDrawStats &stats = eng.debug_draw().stats();
+        ImGui::Begin("Debug Draw");
+        ImGui::Checkbox("bounding boxes", &show_bounds);
+        ImGui::SliderInt("spheres", &num_debug_spheres, 0, 20000);
+        ImGui::Text("vertices: %u, draws: %u, capacity: %u", stats.num_vertices, stats.num_draws, stats.capacity);
+        ImGui::End();
     });
 
     (void)grid; // unused var
@@ -154,6 +170,11 @@ int main(void) {
 
         // polyline
         polyline_renderable.material->color = {k2, 0, k1, 255};
+        // trail
+        trail.push({{2.0f * std::cos(t) + 0.5f * std::cos(7.1f * t), 2.0f * std::sin(t) + 0.5f * std::sin(5.3f * t),
+                     1.5f + 0.5f * std::sin(3.7f * t)}});
+        trail.update();
+        trail_renderable.material->color = {255, k1, 0, 255};
         // triangle
         triangle
             .set_transform(
@@ -207,6 +228,38 @@ int main(void) {
                                                        math::quat_from_euler_321(3 * t, 0.0f, 0.0f)))
             .set_visible((int(t * 2) % 2 == 1));
 
+        // debug annotations, added again every frame
+        auto &dd = eng.debug_draw();
+        if (show_bounds) {
+            for (auto *obj : {&box0, &box1, &box2, &box3}) {
+                const glengine::AABB aabb = glengine::calc_bounding_box(obj, false);
+                dd.box(obj->transform() * obj->_scale * math::create_translation(aabb.center), aabb.size,
+                       {255, 255, 0, 255});
+                dd.axes(obj->transform(), 0.75f, false);
+            }
+            dd.arrow({0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, 1.0f}, {255, 255, 255, 255}, false);
+        }
+        // text labels, added again every frame as well
+        auto &labels = eng.text_labels();
+        char text[32];
+        for (auto *obj : {&box0, &box1, &box2, &box3, &box4, &sphere}) {
+            const math::Vector3f pos = obj->transform() * math::Vector3f{0.0f, 0.0f, 0.0f};
+            snprintf(text, sizeof(text), "object %u (%.1f, %.1f)", obj->_id, pos.x, pos.y);
+            labels.add(pos, text, {255, 255, 255, 255}, 1.0f);
+        }
+        for (int i = 0; i < num_debug_spheres; i += 10) {
+            const float x = float(i % 100), y = float(i / 100 % 100), z = float(i / 10000);
+            snprintf(text, sizeof(text), "%d", i);
+            labels.add({x * 0.5f - 25.0f, y * 0.5f - 25.0f, z * 0.5f - 2.0f}, text, {200, 200, 255, 255});
+        }
+        snprintf(text, sizeof(text), "labels: %u/%u", labels.stats().num_visible, labels.stats().num_labels);
+        labels.add_screen({10.0f, 10.0f}, text, {255, 255, 0, 255});
+        for (int i = 0; i < num_debug_spheres; i++) {
+            const float x = float(i % 100), y = float(i / 100 % 100), z = float(i / 10000);
+            dd.sphere({x * 0.5f - 25.0f, y * 0.5f - 25.0f, z * 0.5f - 2.0f}, 0.2f,
+                      {uint8_t(x * 2.5f), uint8_t(y * 2.5f), 200, 255});
+        }
+
         cnt++;
     }
 
@@ -1,32 +1,56 @@
 #include "math/vmath.h"
 
 #include "gl_engine.h"
+#include "gl_gltf_loader.h"
 #include "gl_context_glfw.h"
 #include "gl_mesh.h"
+#include "gl_package.h"
 #include "gl_prefabs.h"
 #include "gl_material_diffuse.h"
-#include "gl_material_vertexcolor.h"
 #include "gl_material_pbr.h"
 #include "gl_material_pbr_ibl.h"
 #include "gl_renderable.h"
+#include "gl_texture_streamer.h"
 #include "gl_utils.h"
 #include "imgui/imgui.h"
 
 #include "cmdline.h"
 
-namespace glengine {
-std::vector<Renderable> create_from_gltf(GLEngine &eng, const char *filename);
+#include <chrono>
+
+namespace {
+
+double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
 }
 
+// first material of an object, or of its descendants
+glengine::Material *first_material(glengine::Object *obj) {
+    if (!obj->_renderables.empty()) {
+        return obj->_renderables[0].material;
+    }
+    for (auto *child : obj->children()) {
+        if (auto *mat = first_material(child)) {
+            return mat;
+        }
+    }
+    return nullptr;
+}
+
+} // namespace
+
 int main(int argc, char *argv[]) {
 
     cmdline::parser cl;
-    cl.add<std::string>("file", 'f', "gltf file name", false, "");
+    cl.add<std::string>("file", 'f', "gltf file name, or package (.gpkg) made by the asset cooker", false, "");
     cl.add<uint32_t>("width", 'w', "window width", false, 1280, cmdline::range(16, 65535));
     cl.add<uint32_t>("height", 'h', "window height", false, 720, cmdline::range(16, 65535));
     cl.add<float>("scaling", 's', "model scaling", false, 1.0f);
     cl.add("mrt", 'm', "use MRT and enable effects");
     cl.add("novsync", 'n', "disable vsync");
+    cl.add("hierarchy", 'g', "keep the gltf node hierarchy, sharing the meshes used by several nodes");
+    cl.add("stream", 't', "stream the mip levels of the package textures, depending on their size on screen");
+    cl.add("uploads", 'u', "upload the meshes and textures within a per-frame budget");
     cl.parse_check(argc, argv);
 
     std::string gltf_filename = cl.get<std::string>("file");
@@ -37,10 +61,11 @@ int main(int argc, char *argv[]) {
     bool use_mrt = cl.exist("mrt");
 
     // create context and engine
+    const double start = now_ms();
     glengine::ContextGLFW context;
     context.init({.window_width = width, .window_height = height, .vsync = vsync});
     glengine::GLEngine eng;
-    eng.init(&context, {.use_mrt = use_mrt});
+    eng.init(&context, {.use_mrt = use_mrt, .deferred_uploads = cl.exist("uploads")});
 
     eng._camera_manipulator.set_azimuth(0.6f).set_elevation(1.2f).set_distance(5.0f);
 
@@ -48,17 +73,33 @@ int main(int argc, char *argv[]) {
     // objects //
     // /////// //
     // grid
-    auto *grid = eng.create_object({eng.create_grid_mesh(100.0f, 2.0f),
-                                    eng.create_material<glengine::MaterialVertexColor>(SG_PRIMITIVETYPE_LINES)});
+    eng.grid().enabled = true;
+    eng.grid().step = 2.0f;
+
+    glengine::TextureStreamer textures;
+    textures.init(eng);
 
     // load a gltf file if passed in the command line
     glengine::Object *gltf_obj = nullptr;
     bool rotate = false;
     if (gltf_filename != "") {
         gltf_obj = eng.create_object();
-        auto gltf_renderables = glengine::create_from_gltf(eng, gltf_filename.c_str());
-        printf("loaded %d renderables from gltf file\n", (int)gltf_renderables.size());
-        gltf_obj->add_renderable(gltf_renderables.data(), gltf_renderables.size());
+        const bool package =
+            gltf_filename.size() > 5 && gltf_filename.compare(gltf_filename.size() - 5, 5, ".gpkg") == 0;
+        if (cl.exist("hierarchy") && !package) {
+            glengine::create_object_from_gltf(eng, gltf_filename.c_str(), gltf_obj);
+        } else {
+            auto gltf_renderables =
+                package ? glengine::create_from_package(eng, gltf_filename.c_str(), nullptr,
+                                                        cl.exist("stream") ? &textures : nullptr)
+                        : glengine::create_from_gltf(eng, gltf_filename.c_str());
+            printf("loaded %d renderables from gltf file\n", (int)gltf_renderables.size());
+            if (textures.stats().num_textures > 0) {
+                printf("streaming %u textures, %.1f MB resident of %.1f MB\n", textures.stats().num_textures,
+                       textures.stats().resident_bytes / 1048576.0, textures.stats().full_bytes / 1048576.0);
+            }
+            gltf_obj->add_renderable(gltf_renderables.data(), gltf_renderables.size());
+        }
 
         // approximate camera placement using object extent
         auto aabb = glengine::calc_bounding_box(gltf_obj, true);
@@ -74,15 +115,45 @@ int main(int argc, char *argv[]) {
         }
 
         // edit the first material
-        auto *mat = gltf_obj->_renderables[0].material;
+        auto *mat = first_material(gltf_obj);
 
         eng.add_ui_function([&]() {
             ImGui::Begin("Object Info");
-            auto *m = (glengine::MaterialPBRIBL *)mat;
-            ImGui::DragFloat("metallic factor", &m->metallic_factor, 0.01, 0, 1);
-            ImGui::DragFloat("roughness factor", &m->roughness_factor, 0.01, 0, 1);
+            if (auto *m = (glengine::MaterialPBRIBL *)mat) {
+                ImGui::DragFloat("metallic factor", &m->metallic_factor, 0.01, 0, 1);
+                ImGui::DragFloat("roughness factor", &m->roughness_factor, 0.01, 0, 1);
+            }
             ImGui::Checkbox("rotate", &rotate);
             ImGui::End();
+            if (eng._config.deferred_uploads) {
+                const glengine::UploadStats &uploads = eng.upload_queue().stats();
+                ImGui::Begin("Uploads");
+                ImGui::Text("pending: %u (%.1f MB)", uploads.pending, uploads.pending_bytes / 1048576.0);
+                ImGui::Text("last frame: %.1f MB in %.2f ms", uploads.frame_bytes / 1048576.0, uploads.frame_ms);
+                ImGui::Text("total: %.1f MB, deferred frames: %llu", uploads.total_bytes / 1048576.0,
+                            (unsigned long long)uploads.num_deferred);
+                int budget_mb = int(eng.upload_queue().budget.bytes_per_frame >> 20);
+                if (ImGui::DragInt("budget (MB/frame)", &budget_mb, 1.0f, 1, 1024)) {
+                    eng.upload_queue().budget.bytes_per_frame = size_t(budget_mb) << 20;
+                }
+                ImGui::DragScalar("budget (ms/frame)", ImGuiDataType_Double, &eng.upload_queue().budget.ms_per_frame,
+                                  0.1f);
+                ImGui::End();
+            }
+            if (textures.stats().num_textures > 0) {
+                const glengine::TextureStreamingStats &stats = textures.stats();
+                ImGui::Begin("Texture Streaming");
+                ImGui::Text("textures: %u, pending loads: %u", stats.num_textures, stats.pending_loads);
+                ImGui::Text("resident: %.1f MB / %.1f MB", stats.resident_bytes / 1048576.0,
+                            stats.full_bytes / 1048576.0);
+                ImGui::Text("loads: %llu, budget bias: %u", (unsigned long long)stats.num_loads, stats.budget_bias);
+                int budget_mb = int(textures.params.memory_budget >> 20);
+                if (ImGui::DragInt("budget (MB)", &budget_mb, 1.0f, 1, 65535)) {
+                    textures.params.memory_budget = uint64_t(budget_mb) << 20;
+                }
+                ImGui::DragFloat("lod bias", &textures.params.lod_bias, 0.05f, -4.0f, 4.0f);
+                ImGui::End();
+            }
             ImGui::Begin("Camera Info");
 
             float &azimuth = eng._camera_manipulator.azimuth();
@@ -98,7 +169,13 @@ int main(int argc, char *argv[]) {
     // main loop //
     // ///////// //
     int cnt = 0;
+    bool first_frame = true;
     while (eng.render()) {
+        if (first_frame) {
+            printf("time to first frame: %.1fms\n", now_ms() - start);
+            first_frame = false;
+        }
+        textures.update(eng._camera, eng._root, float(context.framebuffer_height()));
         if (gltf_obj && rotate) {
             gltf_obj->set_transform(
                 math::create_transformation<float>({0, 0, 0}, math::quat_from_euler_321<float>(0, 0, cnt / 50.0f)));
@@ -106,6 +183,7 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    textures.terminate();
     eng.terminate();
     return 0;
 }
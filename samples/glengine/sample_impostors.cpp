@@ -0,0 +1,143 @@
+#include "math/vmath.h"
+#include "math/math_utils.h"
+
+#include "gl_engine.h"
+#include "gl_context_glfw.h"
+#include "gl_impostors.h"
+#include "gl_prefabs.h"
+#include "imgui/imgui.h"
+
+#include "cmdline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// atoms on a jittered cubic lattice, bonded to some of their neighbours (the indices of the bonded atoms are returned)
+void create_lattice(uint32_t num_atoms, glengine::Impostors &impostors, std::vector<std::pair<int, int>> &bonds) {
+    const glengine::Color palette[] = {
+        {230, 230, 230, 255}, {220, 60, 50, 255}, {60, 90, 220, 255}, {240, 200, 40, 255}};
+    const int side = std::max(1, int(std::cbrt(float(num_atoms))));
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> jitter(-0.15f, 0.15f);
+    std::uniform_int_distribution<int> element(0, 3);
+    std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+    impostors.spheres.clear();
+    impostors.cylinders.clear();
+    bonds.clear();
+    for (int z = 0; z < side; z++) {
+        for (int y = 0; y < side; y++) {
+            for (int x = 0; x < side; x++) {
+                const math::Vector3f p = {x - side * 0.5f + jitter(rng), y - side * 0.5f + jitter(rng),
+                                          z - side * 0.5f + jitter(rng)};
+                const int e = element(rng);
+                impostors.spheres.push_back({p, 0.2f + 0.05f * e, palette[e]});
+            }
+        }
+    }
+    auto atom = [&](int x, int y, int z) { return (z * side + y) * side + x; };
+    for (int z = 0; z < side; z++) {
+        for (int y = 0; y < side; y++) {
+            for (int x = 0; x < side; x++) {
+                const int next[3][3] = {{x + 1, y, z}, {x, y + 1, z}, {x, y, z + 1}};
+                for (const auto &n : next) {
+                    if (n[0] < side && n[1] < side && n[2] < side && chance(rng) < 0.5f) {
+                        bonds.push_back({atom(x, y, z), atom(n[0], n[1], n[2])});
+                        impostors.cylinders.push_back({impostors.spheres[bonds.back().first].center, 0.06f,
+                                                       impostors.spheres[bonds.back().second].center,
+                                                       {160, 160, 160, 255}});
+                    }
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+
+    cmdline::parser cl;
+    cl.add<uint32_t>("atoms", 'a', "number of atoms (spheres), bonds are cylinders", false, 200000,
+                     cmdline::range(1, 10000000));
+    cl.add<uint32_t>("width", 'w', "window width", false, 1280, cmdline::range(16, 65535));
+    cl.add<uint32_t>("height", 'h', "window height", false, 720, cmdline::range(16, 65535));
+    cl.add("mrt", 'm', "use multiple render targets (normals and depth for the ssao)");
+    cl.add("novsync", 'n', "disable vsync");
+    cl.parse_check(argc, argv);
+
+    uint32_t width = cl.get<uint32_t>("width");
+    uint32_t height = cl.get<uint32_t>("height");
+    bool vsync = !cl.exist("novsync");
+
+    // create context and engine
+    glengine::ContextGLFW context;
+    context.init({.window_width = width, .window_height = height, .vsync = vsync});
+    glengine::GLEngine eng;
+    eng.init(&context, {.use_mrt = cl.exist("mrt")});
+
+    glengine::Impostors impostors;
+    if (!impostors.init(eng)) {
+        eng.terminate();
+        return 1;
+    }
+    std::vector<std::pair<int, int>> bonds;
+    create_lattice(cl.get<uint32_t>("atoms"), impostors, bonds);
+    impostors.update();
+    eng.add_draw_function([&]() { impostors.draw(eng._camera); });
+
+    // the grid intersects the atoms, showing the depth of the impostors
+    eng.grid().enabled = true;
+    eng.grid().step = 2.0f;
+    const float side = std::cbrt(float(impostors.spheres.size()));
+    eng._camera_manipulator.set_azimuth(0.6f).set_elevation(0.6f).set_distance(side * 2.0f);
+
+    // vertices of the same scene with meshed spheres (see create_sphere_mesh), for comparison
+    const glengine::MeshData sphere_mesh = glengine::create_sphere_data(1.0f, 10);
+    bool animate = false;
+    float time = 0.0f;
+    std::vector<math::Vector3f> rest;
+    eng.add_ui_function([&]() {
+        const glengine::ImpostorStats &stats = impostors.stats();
+        ImGui::Begin("Impostors");
+        ImGui::Text("spheres: %u, cylinders: %u, draw calls: %u", stats.num_spheres, stats.num_cylinders,
+                    stats.num_draws);
+        ImGui::Text("vertices per frame: %.2f M", stats.num_vertices / 1e6);
+        ImGui::Text("meshed spheres (subdiv 10): %.2f M vertices, %.2f M indices",
+                    double(stats.num_spheres) * sphere_mesh.vertices.size() / 1e6,
+                    double(stats.num_spheres) * sphere_mesh.indices.size() / 1e6);
+        ImGui::Checkbox("animate (upload every frame)", &animate);
+        ImGui::End();
+    });
+
+    // ///////// //
+    // main loop //
+    // ///////// //
+    while (eng.render()) {
+        eng._camera.set_perspective(0.1f, side * 10.0f, math::utils::deg2rad(45.0f));
+        if (animate) {
+            if (rest.empty()) {
+                for (const auto &s : impostors.spheres) {
+                    rest.push_back(s.center);
+                }
+            }
+            time += 1.0f / 60.0f;
+            for (size_t i = 0; i < impostors.spheres.size(); i++) {
+                impostors.spheres[i].center = rest[i] + math::Vector3f{0.0f, 0.0f, 0.1f * std::sin(time * 3.0f + i)};
+            }
+            for (size_t i = 0; i < bonds.size(); i++) {
+                impostors.cylinders[i].a = impostors.spheres[bonds[i].first].center;
+                impostors.cylinders[i].b = impostors.spheres[bonds[i].second].center;
+            }
+            impostors.update();
+        }
+    }
+
+    impostors.terminate();
+    eng.terminate();
+    return 0;
+}
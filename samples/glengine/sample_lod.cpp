@@ -0,0 +1,169 @@
+#include "math/vmath.h"
+#include "math/math_utils.h"
+
+#include "gl_engine.h"
+#include "gl_context_glfw.h"
+#include "gl_gltf_loader.h"
+#include "gl_material_diffuse.h"
+#include "gl_mesh.h"
+#include "gl_mesh_simplifier.h"
+#include "gl_prefabs.h"
+#include "gl_renderable.h"
+#include "gl_utils.h"
+#include "imgui/imgui.h"
+
+#include "cmdline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace {
+
+double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// knotted torus of about a hundred thousand triangles, with seams of texture coordinates along its two directions
+glengine::MeshData create_knot_data(uint32_t segments, uint32_t sides) {
+    auto curve = [](float t) {
+        return math::Vector3f{std::sin(t) + 2.0f * std::sin(2.0f * t), std::cos(t) - 2.0f * std::cos(2.0f * t),
+                              -std::sin(3.0f * t)};
+    };
+    glengine::MeshData md;
+    for (uint32_t i = 0; i <= segments; i++) {
+        const float t = 6.2831853f * (i % segments) / segments;
+        const math::Vector3f p = curve(t);
+        math::Vector3f tangent = curve(t + 1e-3f) - p;
+        math::normalize(tangent);
+        math::Vector3f side = tangent.cross(math::Vector3f{0.0f, 0.0f, 1.0f});
+        math::normalize(side);
+        const math::Vector3f up = side.cross(tangent);
+        for (uint32_t j = 0; j <= sides; j++) {
+            const float a = 6.2831853f * (j % sides) / sides;
+            glengine::Vertex v;
+            v.normal = side * std::cos(a) + up * std::sin(a);
+            v.pos = p + v.normal * 0.4f;
+            v.tex_coords = {8.0f * i / segments, float(j) / sides};
+            v.tangent = tangent;
+            md.vertices.push_back(v);
+        }
+    }
+    for (uint32_t i = 0; i < segments; i++) {
+        for (uint32_t j = 0; j < sides; j++) {
+            const uint32_t a = i * (sides + 1) + j, b = a + sides + 1;
+            md.indices.insert(md.indices.end(), {a, b, b + 1, a, b + 1, a + 1});
+        }
+    }
+    return md;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+
+    cmdline::parser cl;
+    cl.add<std::string>("file", 'f', "gltf file name (a generated knot without)", false, "");
+    cl.add<uint32_t>("count", 'c', "models per side of the field", false, 24, cmdline::range(1, 200));
+    cl.add<uint32_t>("lods", 'l', "levels of detail besides the full meshes", false, 4, cmdline::range(0, 8));
+    cl.add<float>("pixel_error", 'p', "error on screen of the levels when switched to, in pixels at 1080p", false,
+                  1.0f);
+    cl.add<uint32_t>("width", 'w', "window width", false, 1280, cmdline::range(16, 65535));
+    cl.add<uint32_t>("height", 'h', "window height", false, 720, cmdline::range(16, 65535));
+    cl.add("novsync", 'n', "disable vsync");
+    cl.parse_check(argc, argv);
+
+    uint32_t width = cl.get<uint32_t>("width");
+    uint32_t height = cl.get<uint32_t>("height");
+    bool vsync = !cl.exist("novsync");
+
+    // create context and engine
+    glengine::ContextGLFW context;
+    context.init({.window_width = width, .window_height = height, .vsync = vsync});
+    glengine::GLEngine eng;
+    eng.init(&context, {});
+
+    glengine::GltfImportOptions options;
+    options.generate_lods = cl.get<uint32_t>("lods") > 0;
+    options.lods.max_lods = cl.get<uint32_t>("lods");
+    options.lods.pixel_error = cl.get<float>("pixel_error");
+    const std::string filename = cl.get<std::string>("file");
+    const double start = now_ms();
+    std::vector<glengine::Renderable> model;
+    if (!filename.empty()) {
+        model = glengine::create_from_gltf(eng, filename.c_str(), options);
+    }
+    if (model.empty()) {
+        glengine::MeshData md = create_knot_data(512, 96);
+        if (options.generate_lods) {
+            glengine::generate_lods(md, options.lods);
+        }
+        glengine::Mesh *mesh = eng.create_mesh(md.vertices, md.indices);
+        if (!md.lods.empty()) {
+            mesh->set_lods(md.lods);
+        }
+        auto *mtl = eng.create_material<glengine::MaterialDiffuse>(SG_PRIMITIVETYPE_TRIANGLES, SG_INDEXTYPE_UINT32);
+        model.push_back({mesh, mtl});
+    }
+    const double loaded = now_ms();
+    for (const auto &r : model) {
+        printf("mesh of %zu vertices:", r.mesh->num_vertices());
+        for (const auto &lod : r.mesh->lods) {
+            printf(" %u triangles (error %.4f, screen size %.3f)", lod.num_indices / 3, lod.error, lod.screen_size);
+        }
+        printf("\n");
+    }
+    printf("loaded with the levels of detail in %.1f ms\n", loaded - start);
+
+    // a field of copies, each object selects its own levels
+    const uint32_t count = cl.get<uint32_t>("count");
+    std::vector<glengine::Object *> objects;
+    for (uint32_t i = 0; i < count * count; i++) {
+        objects.push_back(eng.create_object());
+        objects.back()->add_renderable(model.data(), model.size());
+    }
+    const auto aabb = glengine::calc_bounding_box(objects[0], true);
+    const float spacing = 1.5f * std::max({aabb.size.x, aabb.size.y, aabb.size.z});
+    for (uint32_t i = 0; i < count * count; i++) {
+        const math::Vector3f position = {spacing * (i % count), spacing * (i / count), 0.0f};
+        objects[i]->set_transform(math::create_translation<float>(position - aabb.center));
+    }
+
+    eng.grid().enabled = true;
+    eng.grid().step = spacing;
+    eng._camera_manipulator.set_azimuth(-2.4f).set_elevation(0.3f).set_distance(2.0f * spacing);
+
+    bool fly = false;
+    float fly_time = 0.0f;
+    eng.add_ui_function([&]() {
+        const glengine::RenderStats &stats = eng.render_stats();
+        ImGui::Begin("Levels of detail");
+        ImGui::Text("draws: %u, switches of level: %u", stats.num_draws, stats.num_lod_switches);
+        ImGui::Text("triangles: %.2f M submitted, %.2f M without the levels (%.1f%%)", stats.num_triangles / 1e6,
+                    stats.num_triangles_full / 1e6,
+                    stats.num_triangles_full > 0 ? 100.0 * stats.num_triangles / stats.num_triangles_full : 0.0);
+        ImGui::Checkbox("levels of detail", &eng._config.lod.enabled);
+        ImGui::SliderFloat("bias", &eng._config.lod.bias, 0.1f, 10.0f, "%.2f", ImGuiSliderFlags_Logarithmic);
+        ImGui::SliderFloat("hysteresis", &eng._config.lod.hysteresis, 0.0f, 0.5f);
+        ImGui::Checkbox("fly over", &fly);
+        ImGui::End();
+    });
+
+    // ///////// //
+    // main loop //
+    // ///////// //
+    while (eng.render()) {
+        eng._camera.set_perspective(0.1f, 10000.0f, math::utils::deg2rad(45.0f));
+        if (fly) {
+            // back and forth along the diagonal of the field
+            fly_time += 1.0f / 60.0f;
+            const float t = 0.5f - 0.5f * std::cos(fly_time * 0.2f);
+            eng._camera_manipulator.set_center({spacing * count * t, spacing * count * t, 0.0f});
+        }
+    }
+
+    eng.terminate();
+    return 0;
+}
@@ -0,0 +1,157 @@
+#include "math/vmath.h"
+#include "math/math_utils.h"
+
+#include "gl_engine.h"
+#include "gl_context_glfw.h"
+#include "gl_gltf_loader.h"
+#include "gl_material_diffuse.h"
+#include "gl_mesh.h"
+#include "gl_meshlets.h"
+#include "gl_prefabs.h"
+#include "gl_renderable.h"
+#include "gl_utils.h"
+#include "imgui/imgui.h"
+
+#include "cmdline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace {
+
+double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// hills on a grid of size x size quads of one unit, a single mesh
+glengine::MeshData create_hills_data(uint32_t size) {
+    auto height = [](float x, float y) {
+        return 12.0f * std::sin(x * 0.021f) * std::cos(y * 0.017f) + 4.0f * std::sin(x * 0.073f + y * 0.051f) +
+               1.5f * std::cos(x * 0.19f) * std::sin(y * 0.23f);
+    };
+    glengine::MeshData md;
+    md.vertices.reserve(size_t(size + 1) * (size + 1));
+    for (uint32_t y = 0; y <= size; y++) {
+        for (uint32_t x = 0; x <= size; x++) {
+            glengine::Vertex v;
+            v.pos = {float(x), float(y), height(float(x), float(y))};
+            // central differences
+            math::Vector3f n = {height(x - 0.5f, float(y)) - height(x + 0.5f, float(y)),
+                                height(float(x), y - 0.5f) - height(float(x), y + 0.5f), 1.0f};
+            math::normalize(n);
+            v.normal = n;
+            const uint8_t c = uint8_t(std::min(std::max(120.0f + v.pos.z * 6.0f, 0.0f), 255.0f));
+            v.color = {uint8_t(c / 2), c, uint8_t(c / 3), 255};
+            md.vertices.push_back(v);
+        }
+    }
+    md.indices.reserve(size_t(size) * size * 6);
+    for (uint32_t y = 0; y < size; y++) {
+        for (uint32_t x = 0; x < size; x++) {
+            const uint32_t a = y * (size + 1) + x, b = a + size + 1;
+            md.indices.insert(md.indices.end(), {a, a + 1, b + 1, a, b + 1, b});
+        }
+    }
+    return md;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+
+    cmdline::parser cl;
+    cl.add<std::string>("file", 'f', "gltf file name (generated hills without)", false, "");
+    cl.add<uint32_t>("size", 's', "quads per side of the generated hills", false, 1024, cmdline::range(16, 4096));
+    cl.add<uint32_t>("triangles", 't', "triangles per meshlet at most", false, 124, cmdline::range(16, 512));
+    cl.add<uint32_t>("width", 'w', "window width", false, 1280, cmdline::range(16, 65535));
+    cl.add<uint32_t>("height", 'h', "window height", false, 720, cmdline::range(16, 65535));
+    cl.add("novsync", 'n', "disable vsync");
+    cl.parse_check(argc, argv);
+
+    uint32_t width = cl.get<uint32_t>("width");
+    uint32_t height = cl.get<uint32_t>("height");
+    bool vsync = !cl.exist("novsync");
+
+    // create context and engine
+    glengine::ContextGLFW context;
+    context.init({.window_width = width, .window_height = height, .vsync = vsync});
+    glengine::GLEngine eng;
+    eng.init(&context, {});
+
+    glengine::GltfImportOptions options;
+    options.build_meshlets = true;
+    options.meshlets.max_triangles = cl.get<uint32_t>("triangles");
+    const std::string filename = cl.get<std::string>("file");
+    const double start = now_ms();
+    std::vector<glengine::Renderable> model;
+    if (!filename.empty()) {
+        model = glengine::create_from_gltf(eng, filename.c_str(), options);
+    }
+    if (model.empty()) {
+        glengine::MeshData md = create_hills_data(cl.get<uint32_t>("size"));
+        glengine::build_meshlets(md, options.meshlets);
+        glengine::Mesh *mesh = eng.create_mesh(md.vertices, md.indices);
+        mesh->set_meshlets(md.meshlets);
+        auto *mtl = eng.create_material<glengine::MaterialDiffuse>(SG_PRIMITIVETYPE_TRIANGLES, SG_INDEXTYPE_UINT32);
+        model.push_back({mesh, mtl});
+    }
+    const double loaded = now_ms();
+    for (const auto &r : model) {
+        size_t triangles = 0;
+        for (const auto &meshlet : r.mesh->meshlets) {
+            triangles += meshlet.num_indices / 3;
+        }
+        printf("mesh of %zu vertices: %zu meshlets, %.1f triangles each\n", r.mesh->num_vertices(),
+               r.mesh->meshlets.size(), r.mesh->meshlets.empty() ? 0.0 : double(triangles) / r.mesh->meshlets.size());
+    }
+    printf("loaded with the meshlets in %.1f ms\n", loaded - start);
+
+    glengine::Object *object = eng.create_object();
+    object->add_renderable(model.data(), model.size());
+    const auto aabb = glengine::calc_bounding_box(object, true);
+    const float extent = std::max({aabb.size.x, aabb.size.y, aabb.size.z});
+    eng._camera_manipulator.set_azimuth(0.8f).set_elevation(0.15f).set_distance(extent * 0.1f);
+    eng._camera_manipulator.set_center(aabb.center);
+
+    bool fly = false;
+    float fly_time = 0.0f;
+    eng.add_ui_function([&]() {
+        const glengine::RenderStats &stats = eng.render_stats();
+        ImGui::Begin("Meshlets");
+        ImGui::Text("meshlets: %u of %u visible (%.1f%%), culled in %.3f ms", stats.num_meshlets_visible,
+                    stats.num_meshlets,
+                    stats.num_meshlets > 0 ? 100.0 * stats.num_meshlets_visible / stats.num_meshlets : 0.0,
+                    stats.meshlet_cull_ms);
+        ImGui::Text("triangles: %.2f M submitted of %.2f M (%.1f%%), %u draws", stats.num_triangles / 1e6,
+                    stats.num_triangles_full / 1e6,
+                    stats.num_triangles_full > 0 ? 100.0 * stats.num_triangles / stats.num_triangles_full : 0.0,
+                    stats.num_draws);
+        ImGui::Checkbox("culling", &eng._config.meshlets.enabled);
+        ImGui::Checkbox("frustum", &eng._config.meshlets.frustum);
+        ImGui::Checkbox("back facing cones", &eng._config.meshlets.cone);
+        ImGui::Checkbox("simd", &eng._config.meshlets.simd);
+        ImGui::Checkbox("fly over", &fly);
+        ImGui::End();
+    });
+
+    // ///////// //
+    // main loop //
+    // ///////// //
+    while (eng.render()) {
+        eng._camera.set_perspective(0.1f, 10000.0f, math::utils::deg2rad(45.0f));
+        if (fly) {
+            // circles around the center, close to the ground
+            fly_time += 1.0f / 60.0f;
+            const math::Vector3f center = {aabb.center.x + 0.3f * aabb.size.x * std::cos(fly_time * 0.1f),
+                                           aabb.center.y + 0.3f * aabb.size.y * std::sin(fly_time * 0.1f),
+                                           aabb.center.z};
+            eng._camera_manipulator.set_center(center).set_azimuth(fly_time * 0.1f + 1.57f);
+        }
+    }
+
+    eng.terminate();
+    return 0;
+}
@@ -0,0 +1,119 @@
+#include "math/vmath.h"
+#include "math/math_utils.h"
+
+#include "gl_engine.h"
+#include "gl_context_glfw.h"
+#include "gl_particles.h"
+#include "imgui/imgui.h"
+
+#include "cmdline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+namespace {
+
+double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+
+    cmdline::parser cl;
+    cl.add<uint32_t>("particles", 'p', "max number of particles, in thousands", false, 1000,
+                     cmdline::range(1, 100000));
+    cl.add<uint32_t>("fountains", 'f', "number of emitters, on a circle", false, 8, cmdline::range(1, 1000));
+    cl.add<uint32_t>("width", 'w', "window width", false, 1280, cmdline::range(16, 65535));
+    cl.add<uint32_t>("height", 'h', "window height", false, 720, cmdline::range(16, 65535));
+    cl.add("novsync", 'n', "disable vsync");
+    cl.parse_check(argc, argv);
+
+    uint32_t width = cl.get<uint32_t>("width");
+    uint32_t height = cl.get<uint32_t>("height");
+    bool vsync = !cl.exist("novsync");
+
+    // create context and engine
+    glengine::ContextGLFW context;
+    context.init({.window_width = width, .window_height = height, .vsync = vsync});
+    glengine::GLEngine eng;
+    eng.init(&context, {});
+
+    glengine::ParticleSystem particles;
+    particles.params.max_particles = cl.get<uint32_t>("particles") * 1000;
+    if (!particles.init(eng)) {
+        eng.terminate();
+        return 1;
+    }
+    // fountains on a circle, filling the particle budget with a life of 2 seconds on average
+    const uint32_t num_fountains = cl.get<uint32_t>("fountains");
+    float rate = float(particles.params.max_particles) / 2.0f / num_fountains;
+    for (uint32_t i = 0; i < num_fountains; i++) {
+        const float angle = 6.2831853f * i / num_fountains;
+        particles.emitters.push_back({.position = {20.0f * std::cos(angle), 20.0f * std::sin(angle), 0.0f},
+                                      .radius = 0.2f,
+                                      .velocity = {0.0f, 0.0f, 12.0f},
+                                      .spread = 3.0f,
+                                      .rate = rate,
+                                      .life_min = 1.5f,
+                                      .life_max = 2.5f});
+    }
+    eng.add_draw_function([&]() { particles.draw(eng._camera); });
+
+    eng.grid().enabled = true;
+    eng.grid().step = 2.0f;
+    eng._camera_manipulator.set_azimuth(0.6f).set_elevation(0.4f).set_distance(70.0f);
+
+    bool paused = false;
+    bool orbit = true;
+    float orbit_time = 0.0f;
+    eng.add_ui_function([&]() {
+        const glengine::ParticleStats &stats = particles.stats();
+        ImGui::Begin("Particles");
+        ImGui::Text("particles: %.2f M, spawned: %u, killed: %u", stats.num_particles / 1e6, stats.num_spawned,
+                    stats.num_killed);
+        ImGui::Text("simulation: %.2f ms, draw calls: %u", stats.simulate_ms, stats.num_draws);
+        ImGui::Checkbox("paused", &paused);
+        ImGui::Checkbox("simd", &particles.params.simd);
+        ImGui::Checkbox("worker threads", &particles.params.parallel);
+        if (ImGui::SliderFloat("rate per fountain", &rate, 0.0f, float(particles.params.max_particles))) {
+            for (auto &emitter : particles.emitters) {
+                emitter.rate = rate;
+            }
+        }
+        ImGui::SliderFloat("gravity", &particles.params.gravity.z, -20.0f, 0.0f);
+        ImGui::SliderFloat("drag", &particles.params.drag, 0.0f, 2.0f);
+        ImGui::SliderFloat("wind", &particles.params.wind.x, -10.0f, 10.0f);
+        ImGui::SliderFloat("attractor", &particles.params.attractor_strength, 0.0f, 2000.0f);
+        ImGui::Checkbox("orbiting attractor", &orbit);
+        ImGui::SliderFloat("size start", &particles.params.size_start, 0.01f, 1.0f);
+        ImGui::SliderFloat("size end", &particles.params.size_end, 0.01f, 1.0f);
+        ImGui::End();
+    });
+
+    // ///////// //
+    // main loop //
+    // ///////// //
+    double last = now_ms();
+    while (eng.render()) {
+        eng._camera.set_perspective(0.1f, 1000.0f, math::utils::deg2rad(45.0f));
+        const double now = now_ms();
+        // long frames are not simulated in one step
+        const float dt = std::min(float(now - last) / 1000.0f, 0.1f);
+        last = now;
+        if (!paused) {
+            if (orbit) {
+                orbit_time += dt;
+                particles.params.attractor = {10.0f * std::cos(orbit_time), 10.0f * std::sin(orbit_time), 15.0f};
+            }
+            particles.simulate(dt);
+        }
+        particles.update();
+    }
+
+    particles.terminate();
+    eng.terminate();
+    return 0;
+}
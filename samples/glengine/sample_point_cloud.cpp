@@ -0,0 +1,216 @@
+#include "math/vmath.h"
+#include "math/math_utils.h"
+
+#include "gl_engine.h"
+#include "gl_context_glfw.h"
+#include "gl_package.h"
+#include "gl_point_cloud.h"
+#include "imgui/imgui.h"
+
+#include "cmdline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <functional>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+double now_ms() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// rolling hills, colored by height
+float terrain_height(float x, float y) {
+    return 8.0f * std::sin(x * 0.02f) * std::cos(y * 0.03f) + 2.0f * std::sin(x * 0.11f + y * 0.07f);
+}
+
+using AddPoint = std::function<void(const math::Vector3f &, glengine::Color)>;
+
+// the same points every time, passed to add one at a time
+void generate_terrain(uint32_t num_points, float size, const AddPoint &add) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> coord(-size * 0.5f, size * 0.5f);
+    std::normal_distribution<float> noise(0.0f, 0.05f);
+    for (uint32_t i = 0; i < num_points; i++) {
+        const float x = coord(rng), y = coord(rng);
+        const float z = terrain_height(x, y) + noise(rng);
+        const float t = std::min(std::max((z + 10.0f) / 20.0f, 0.0f), 1.0f);
+        add({x, y, z}, {uint8_t(60 + 150 * t), uint8_t(140 - 40 * t), uint8_t(60 + 60 * t), 255});
+    }
+}
+
+// ascii file with one point per line: x y z [r g b], colors in 0..255. Returns the number of points read
+size_t read_xyz(const std::string &filename, const AddPoint &add) {
+    FILE *f = fopen(filename.c_str(), "r");
+    if (!f) {
+        return 0;
+    }
+    char line[256];
+    size_t count = 0;
+    while (fgets(line, sizeof(line), f)) {
+        float x, y, z;
+        int r = 255, g = 255, b = 255;
+        if (sscanf(line, "%f %f %f %d %d %d", &x, &y, &z, &r, &g, &b) >= 3) {
+            add({x, y, z}, {uint8_t(r), uint8_t(g), uint8_t(b), 255});
+            count++;
+        }
+    }
+    fclose(f);
+    return count;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+
+    cmdline::parser cl;
+    cl.add<std::string>("file", 'f', "package (.gpkg) with a point cloud, streamed from the disk", false, "");
+    cl.add<std::string>("xyz", 'x', "ascii point cloud (x y z [r g b] per line) to build", false, "");
+    cl.add<uint32_t>("points", 'p', "points of the generated cloud, in millions (without file or xyz)", false, 5,
+                     cmdline::range(1, 1000));
+    cl.add<std::string>("output", 'o', "write the built cloud to this package", false, "");
+    cl.add("chunked", 'c', "build out of core by chunks, straight to the output package (needs output)");
+    cl.add<uint32_t>("width", 'w', "window width", false, 1280, cmdline::range(16, 65535));
+    cl.add<uint32_t>("height", 'h', "window height", false, 720, cmdline::range(16, 65535));
+    cl.add<uint32_t>("budget", 'b', "point budget, in millions", false, 5, cmdline::range(1, 100));
+    cl.add<uint32_t>("memory", 'm', "memory budget of the resident nodes, in MB", false, 512,
+                     cmdline::range(1, 65535));
+    cl.add("novsync", 'n', "disable vsync");
+    cl.parse_check(argc, argv);
+
+    uint32_t width = cl.get<uint32_t>("width");
+    uint32_t height = cl.get<uint32_t>("height");
+    bool vsync = !cl.exist("novsync");
+
+    // create context and engine
+    glengine::ContextGLFW context;
+    context.init({.window_width = width, .window_height = height, .vsync = vsync});
+    glengine::GLEngine eng;
+    // the nodes are uploaded within a per-frame budget
+    eng.init(&context, {.deferred_uploads = true});
+
+    glengine::PointCloud cloud;
+    cloud.params.point_budget = cl.get<uint32_t>("budget") * 1000000;
+    cloud.params.memory_budget = uint64_t(cl.get<uint32_t>("memory")) << 20;
+    bool ok = false;
+    const std::string xyz = cl.get<std::string>("xyz");
+    const std::string output = cl.get<std::string>("output");
+    // the points of the xyz file, or generated, one at a time
+    auto for_each_point = [&](const AddPoint &add) {
+        if (!xyz.empty()) {
+            return read_xyz(xyz, add);
+        }
+        generate_terrain(cl.get<uint32_t>("points") * 1000000, 1000.0f, add);
+        return size_t(cl.get<uint32_t>("points")) * 1000000;
+    };
+    math::Vector3f bbox_min = {0.0f, 0.0f, 0.0f}, bbox_max = {0.0f, 0.0f, 0.0f};
+    auto bounds = [&](const math::Vector3f &p, glengine::Color) {
+        bbox_min = {std::min(bbox_min.x, p.x), std::min(bbox_min.y, p.y), std::min(bbox_min.z, p.z)};
+        bbox_max = {std::max(bbox_max.x, p.x), std::max(bbox_max.y, p.y), std::max(bbox_max.z, p.z)};
+    };
+    if (!cl.get<std::string>("file").empty()) {
+        ok = cloud.init(eng, cl.get<std::string>("file").c_str());
+    } else if (cl.exist("chunked") && !output.empty()) {
+        // two passes over the points, the first one for the bounds, and only the largest chunk in memory
+        bbox_min = {1e30f, 1e30f, 1e30f};
+        bbox_max = -bbox_min;
+        if (for_each_point(bounds) == 0) {
+            printf("unable to read '%s'\n", xyz.c_str());
+        } else {
+            const double start = now_ms();
+            glengine::PointCloudChunkedBuilder builder;
+            builder.init(bbox_min, bbox_max, output);
+            for_each_point([&](const math::Vector3f &p, glengine::Color c) { builder.add(p, c); });
+            ok = builder.build(output.c_str(), "cloud");
+            printf("%llu points in %u nodes, built by chunks in %.1f ms\n", (unsigned long long)builder.num_points(),
+                   builder.num_nodes(), now_ms() - start);
+            ok = ok && cloud.init(eng, output.c_str());
+        }
+    } else {
+        // build the octree in memory
+        std::vector<math::Vector3f> positions;
+        std::vector<glengine::Color> colors;
+        if (for_each_point([&](const math::Vector3f &p, glengine::Color c) {
+                positions.push_back(p);
+                colors.push_back(c);
+            }) == 0) {
+            printf("unable to read '%s'\n", xyz.c_str());
+        }
+        if (!positions.empty()) {
+            bbox_min = bbox_max = positions[0];
+            for (const auto &p : positions) {
+                bounds(p, {});
+            }
+            const double start = now_ms();
+            glengine::PointCloudBuilder builder;
+            builder.init(bbox_min, bbox_max);
+            for (size_t i = 0; i < positions.size(); i++) {
+                builder.add(positions[i], colors[i]);
+            }
+            std::vector<glengine::PackageData> entries;
+            builder.build("cloud", entries);
+            printf("%llu points in %u nodes, built in %.1f ms\n", (unsigned long long)builder.num_points(),
+                   builder.num_nodes(), now_ms() - start);
+            if (!output.empty()) {
+                glengine::write_package(output.c_str(), entries);
+            }
+            glengine::PackagePointCloud octree;
+            ok = glengine::decode_point_cloud(entries[0].data.data(), entries[0].data.size(), octree) &&
+                 cloud.init(eng, octree, std::move(entries[1].data));
+        }
+    }
+    if (!ok) {
+        eng.terminate();
+        return 1;
+    }
+    eng.add_draw_function([&]() { cloud.draw(eng._camera); });
+
+    // grid, and the camera above the center of the cloud
+    eng.grid().enabled = true;
+    eng.grid().step = 2.0f;
+    const glengine::AABB aabb = cloud.bounds();
+    eng._camera_manipulator.set_azimuth(0.6f).set_elevation(0.6f).set_distance(aabb.size.x * 0.5f);
+    eng._camera_manipulator.set_center(aabb.center);
+
+    eng.add_ui_function([&]() {
+        const glengine::PointCloudStats &stats = cloud.stats();
+        ImGui::Begin("Point Cloud");
+        ImGui::Text("points: %.1f M / %.1f M", stats.visible_points / 1e6, stats.total_points / 1e6);
+        ImGui::Text("nodes: %u visible, %u resident / %u", stats.visible_nodes, stats.resident_nodes,
+                    stats.num_nodes);
+        ImGui::Text("resident: %.1f MB, pending loads: %u (%.1f MB)", stats.resident_bytes / 1048576.0,
+                    stats.pending_loads, stats.pending_bytes / 1048576.0);
+        ImGui::Text("loads: %llu, evictions: %llu", (unsigned long long)stats.num_loads,
+                    (unsigned long long)stats.num_evictions);
+        ImGui::Text("update: %.2f ms", stats.update_ms);
+        int budget = int(cloud.params.point_budget / 100000);
+        if (ImGui::SliderInt("point budget (100k)", &budget, 1, 500)) {
+            cloud.params.point_budget = uint32_t(budget) * 100000;
+        }
+        ImGui::SliderFloat("max error (px)", &cloud.params.max_error, 0.5f, 20.0f);
+        ImGui::SliderFloat("point size (px)", &cloud.params.point_size, 1.0f, 8.0f);
+        ImGui::Checkbox("adaptive point size", &cloud.params.adaptive_point_size);
+        int memory_mb = int(cloud.params.memory_budget >> 20);
+        if (ImGui::DragInt("memory budget (MB)", &memory_mb, 1.0f, 1, 65535)) {
+            cloud.params.memory_budget = uint64_t(memory_mb) << 20;
+        }
+        ImGui::End();
+    });
+
+    // ///////// //
+    // main loop //
+    // ///////// //
+    while (eng.render()) {
+        eng._camera.set_perspective(0.5f, aabb.size.x * 4.0f, math::utils::deg2rad(45.0f));
+        cloud.update(eng._camera, float(context.framebuffer_height()));
+    }
+
+    cloud.terminate();
+    eng.terminate();
+    return 0;
+}
@@ -0,0 +1,106 @@
+#include "math/vmath.h"
+#include "math/math_utils.h"
+
+#include "gl_engine.h"
+#include "gl_context_glfw.h"
+#include "gl_scene_streamer.h"
+#include "gl_texture_streamer.h"
+#include "gl_utils.h"
+#include "imgui/imgui.h"
+
+#include "cmdline.h"
+
+#include <algorithm>
+
+int main(int argc, char *argv[]) {
+
+    cmdline::parser cl;
+    cl.add<std::string>("file", 'f', "package (.gpkg) cooked with cells by the asset cooker (asset_cooker -s)", true);
+    cl.add<uint32_t>("width", 'w', "window width", false, 1280, cmdline::range(16, 65535));
+    cl.add<uint32_t>("height", 'h', "window height", false, 720, cmdline::range(16, 65535));
+    cl.add<float>("load", 'l', "distance under which the cells are loaded", false, 100.0f);
+    cl.add<float>("evict", 'e', "distance over which the cells are evicted", false, 150.0f);
+    cl.add<uint32_t>("budget", 'b', "memory budget of the resident cells, in MB", false, 256,
+                     cmdline::range(1, 65535));
+    cl.add("novsync", 'n', "disable vsync");
+    cl.parse_check(argc, argv);
+
+    uint32_t width = cl.get<uint32_t>("width");
+    uint32_t height = cl.get<uint32_t>("height");
+    bool vsync = !cl.exist("novsync");
+
+    // create context and engine
+    glengine::ContextGLFW context;
+    context.init({.window_width = width, .window_height = height, .vsync = vsync});
+    glengine::GLEngine eng;
+    // the cells are uploaded within a per-frame budget
+    eng.init(&context, {.deferred_uploads = true});
+
+    // grid
+    eng.grid().enabled = true;
+    eng.grid().step = 2.0f;
+
+    glengine::TextureStreamer textures;
+    textures.init(eng);
+    glengine::SceneStreamer streamer;
+    streamer.params.load_distance = cl.get<float>("load");
+    streamer.params.evict_distance = cl.get<float>("evict");
+    streamer.params.memory_budget = uint64_t(cl.get<uint32_t>("budget")) << 20;
+    if (!streamer.init(eng, cl.get<std::string>("file").c_str(), nullptr, nullptr, &textures)) {
+        eng.terminate();
+        return 1;
+    }
+
+    // start from the center of the model, far plane beyond the loaded cells
+    auto aabb = streamer.bounds();
+    printf("cells bbox - center (%f,%f,%f) - size (%f,%f,%f)\n", aabb.center.x, aabb.center.y, aabb.center.z,
+           aabb.size.x, aabb.size.y, aabb.size.z);
+    eng._camera_manipulator.set_azimuth(0.6f).set_elevation(1.2f).set_distance(0.5f * streamer.params.load_distance);
+    eng._camera_manipulator.set_center(aabb.center);
+
+    eng.add_ui_function([&]() {
+        const glengine::StreamingStats &stats = streamer.stats();
+        ImGui::Begin("Streaming");
+        ImGui::Text("resident cells: %u / %u", stats.resident_cells, stats.num_cells);
+        ImGui::Text("resident: %.1f MB / %.1f MB", stats.resident_bytes / 1048576.0, stats.total_bytes / 1048576.0);
+        ImGui::Text("pending loads: %u (%.1f MB)", stats.pending_loads, stats.pending_bytes / 1048576.0);
+        ImGui::Text("loads: %llu, evictions: %llu, cancelled: %llu", (unsigned long long)stats.num_loads,
+                    (unsigned long long)stats.num_evictions, (unsigned long long)stats.num_cancelled);
+        ImGui::Text("textures: %.1f MB / %.1f MB", textures.stats().resident_bytes / 1048576.0,
+                    textures.stats().full_bytes / 1048576.0);
+        ImGui::DragFloat("load distance", &streamer.params.load_distance, 1.0f, 0.0f, 10000.0f);
+        ImGui::DragFloat("evict distance", &streamer.params.evict_distance, 1.0f, 0.0f, 10000.0f);
+        int budget_mb = int(streamer.params.memory_budget >> 20);
+        if (ImGui::DragInt("budget (MB)", &budget_mb, 1.0f, 1, 65535)) {
+            streamer.params.memory_budget = uint64_t(budget_mb) << 20;
+        }
+        int pending = int(streamer.params.max_pending_loads);
+        if (ImGui::SliderInt("max pending loads", &pending, 1, 32)) {
+            streamer.params.max_pending_loads = uint32_t(pending);
+        }
+        int uploads = int(streamer.params.max_uploads_per_frame);
+        if (ImGui::SliderInt("max uploads per frame", &uploads, 1, 32)) {
+            streamer.params.max_uploads_per_frame = uint32_t(uploads);
+        }
+        ImGui::End();
+        ImGui::Begin("Camera Info");
+        ImGui::DragFloat3("center", &eng._camera_manipulator.center().x, 0.1f);
+        ImGui::DragFloat("distance", &eng._camera_manipulator.distance(), 0.1f, 0, 10000.0f);
+        ImGui::End();
+    });
+
+    // ///////// //
+    // main loop //
+    // ///////// //
+    while (eng.render()) {
+        eng._camera.set_perspective(1.0f, std::max(streamer.params.evict_distance, 100.0f) * 2.0f,
+                                    math::utils::deg2rad(45.0f));
+        streamer.update(eng._camera);
+        textures.update(eng._camera, eng._root, float(context.framebuffer_height()));
+    }
+
+    streamer.terminate();
+    textures.terminate();
+    eng.terminate();
+    return 0;
+}
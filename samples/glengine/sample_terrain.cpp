@@ -0,0 +1,142 @@
+#include "math/vmath.h"
+#include "math/math_utils.h"
+
+#include "gl_engine.h"
+#include "gl_context_glfw.h"
+#include "gl_terrain.h"
+#include "imgui/imgui.h"
+
+#include "cmdline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+// fractal sum of random waves, with ridges and a valley across the middle
+void generate_heightmap(uint32_t size, glengine::Heightmap &heightmap) {
+    std::mt19937 rng(11);
+    std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+    struct Wave {
+        float dx, dy, frequency, amplitude, phase;
+    };
+    std::vector<Wave> waves;
+    float frequency = 0.002f, amplitude = 1.0f;
+    for (int octave = 0; octave < 8; octave++, frequency *= 2.1f, amplitude *= 0.45f) {
+        for (int i = 0; i < 3; i++) {
+            const float a = angle(rng);
+            waves.push_back({std::cos(a), std::sin(a), frequency, amplitude, angle(rng)});
+        }
+    }
+    std::vector<float> heights(size_t(size) * size);
+    for (uint32_t y = 0; y < size; y++) {
+        for (uint32_t x = 0; x < size; x++) {
+            float h = 0.0f;
+            for (const Wave &w : waves) {
+                h += w.amplitude * (1.0f - std::fabs(std::sin((x * w.dx + y * w.dy) * w.frequency + w.phase)));
+            }
+            const float valley = std::fabs(float(y) / size - 0.5f) * 2.0f;
+            heights[size_t(y) * size + x] = h * (0.3f + 0.7f * valley);
+        }
+    }
+    const auto minmax = std::minmax_element(heights.begin(), heights.end());
+    heightmap.width = heightmap.height = size;
+    heightmap.min_height = 0.0f;
+    heightmap.max_height = 1.0f;
+    heightmap.samples.resize(heights.size());
+    for (size_t i = 0; i < heights.size(); i++) {
+        heightmap.samples[i] = uint16_t((heights[i] - *minmax.first) / (*minmax.second - *minmax.first) * 65535.0f);
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+
+    cmdline::parser cl;
+    cl.add<std::string>("png", 'p', "grayscale png heightmap (16 or 8 bits)", false, "");
+    cl.add<std::string>("raw", 'r', "raw heightmap of 32 bit floats (needs raw_width and raw_height)", false, "");
+    cl.add<uint32_t>("raw_width", 0, "samples per row of the raw heightmap", false, 0, cmdline::range(0, 1 << 20));
+    cl.add<uint32_t>("raw_height", 0, "rows of the raw heightmap", false, 0, cmdline::range(0, 1 << 20));
+    cl.add<uint32_t>("size", 's', "samples per side of the generated heightmap (without png or raw)", false, 4097,
+                     cmdline::range(64, 16385));
+    cl.add<float>("spacing", 0, "distance between the samples", false, 1.0f);
+    cl.add<float>("height_scale", 0, "scale of the heights of the png and generated heightmaps", false, 600.0f);
+    cl.add<uint32_t>("budget", 'b', "triangle budget, in thousands", false, 4000, cmdline::range(1, 100000));
+    cl.add<uint32_t>("width", 'w', "window width", false, 1280, cmdline::range(16, 65535));
+    cl.add<uint32_t>("height", 'h', "window height", false, 720, cmdline::range(16, 65535));
+    cl.add("novsync", 'n', "disable vsync");
+    cl.parse_check(argc, argv);
+
+    uint32_t width = cl.get<uint32_t>("width");
+    uint32_t height = cl.get<uint32_t>("height");
+    bool vsync = !cl.exist("novsync");
+
+    // create context and engine
+    glengine::ContextGLFW context;
+    context.init({.window_width = width, .window_height = height, .vsync = vsync});
+    glengine::GLEngine eng;
+    eng.init(&context, {});
+
+    glengine::Heightmap heightmap;
+    bool ok = true;
+    if (!cl.get<std::string>("png").empty()) {
+        ok = glengine::load_heightmap_png(cl.get<std::string>("png").c_str(), heightmap);
+        heightmap.max_height = cl.get<float>("height_scale");
+    } else if (!cl.get<std::string>("raw").empty()) {
+        ok = glengine::load_heightmap_raw(cl.get<std::string>("raw").c_str(), cl.get<uint32_t>("raw_width"),
+                                          cl.get<uint32_t>("raw_height"), heightmap);
+    } else {
+        generate_heightmap(cl.get<uint32_t>("size"), heightmap);
+        heightmap.max_height = cl.get<float>("height_scale");
+    }
+    glengine::Terrain terrain;
+    terrain.params.spacing = cl.get<float>("spacing");
+    terrain.params.triangle_budget = cl.get<uint32_t>("budget") * 1000;
+    if (!ok || !terrain.init(eng, heightmap)) {
+        eng.terminate();
+        return 1;
+    }
+    // the samples are on the gpu, the heightmap is no longer needed
+    heightmap = glengine::Heightmap();
+    eng.add_draw_function([&]() { terrain.draw(eng._camera); });
+
+    // the camera above a corner, looking at the center, and the sun high over it
+    const glengine::AABB aabb = terrain.bounds();
+    const float extent = std::max(aabb.size.x, aabb.size.y);
+    terrain.light_pos = aabb.center + math::Vector3f{extent, extent * 0.5f, extent * 2.0f};
+    eng._camera_manipulator.set_azimuth(0.8f).set_elevation(0.3f).set_distance(extent * 0.3f);
+    eng._camera_manipulator.set_center(aabb.center);
+
+    eng.add_ui_function([&]() {
+        const glengine::TerrainStats &stats = terrain.stats();
+        ImGui::Begin("Terrain");
+        ImGui::Text("levels: %u, height textures: %u (%.1f MB)", stats.num_levels, stats.num_tiles,
+                    stats.texture_bytes / 1048576.0);
+        ImGui::Text("chunks: %u, draw calls: %u", stats.num_chunks, stats.num_draws);
+        ImGui::Text("triangles: %.2f M, finest level: %u", stats.num_triangles / 1e6, stats.min_level);
+        ImGui::Text("selection: %.3f ms", stats.select_ms);
+        ImGui::SliderFloat("lod distance", &terrain.params.lod_distance, 0.0f, extent * 0.25f);
+        ImGui::SliderFloat("morph start", &terrain.params.morph_start, 0.0f, 0.95f);
+        int budget = int(terrain.params.triangle_budget / 1000);
+        if (ImGui::SliderInt("triangle budget (k)", &budget, 10, 20000)) {
+            terrain.params.triangle_budget = uint32_t(budget) * 1000;
+        }
+        ImGui::End();
+    });
+
+    // ///////// //
+    // main loop //
+    // ///////// //
+    while (eng.render()) {
+        eng._camera.set_perspective(0.5f, extent * 4.0f, math::utils::deg2rad(45.0f));
+        terrain.update(eng._camera);
+    }
+
+    terrain.terminate();
+    eng.terminate();
+    return 0;
+}
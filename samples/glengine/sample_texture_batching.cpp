@@ -0,0 +1,182 @@
+#include "math/vmath.h"
+#include "math/math_utils.h"
+
+#include "gl_engine.h"
+#include "gl_context_glfw.h"
+#include "gl_material_diffuse.h"
+#include "gl_mesh.h"
+#include "gl_prefabs.h"
+#include "gl_renderable.h"
+#include "gl_resource_manager.h"
+#include "gl_texture_atlas.h"
+#include "imgui/imgui.h"
+#include "stb/stb_image_resize.h"
+
+#include "cmdline.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Texture {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+// checkerboard of a random color, with a border so that the wrap of the uvs shows
+Texture create_texture(uint32_t width, uint32_t height, std::mt19937 &rng) {
+    std::uniform_int_distribution<int> channel(40, 255);
+    const uint8_t color[4] = {uint8_t(channel(rng)), uint8_t(channel(rng)), uint8_t(channel(rng)), 255};
+    Texture tex{width, height, std::vector<uint8_t>(size_t(width) * height * 4)};
+    const uint32_t square = std::max(width / 4, 1u);
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            uint8_t *p = tex.pixels.data() + (size_t(y) * width + x) * 4;
+            const bool border = x < 2 || y < 2 || x + 2 >= width || y + 2 >= height;
+            const bool dark = ((x / square) + (y / square)) % 2 == 1;
+            for (int c = 0; c < 3; c++) {
+                p[c] = border ? 255 : dark ? uint8_t(color[c] / 3) : color[c];
+            }
+            p[3] = 255;
+        }
+    }
+    return tex;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+
+    cmdline::parser cl;
+    cl.add<uint32_t>("count", 'c', "boxes per side, each with its own texture", false, 16, cmdline::range(1, 64));
+    cl.add<uint32_t>("width", 'w', "window width", false, 1280, cmdline::range(16, 65535));
+    cl.add<uint32_t>("height", 'h', "window height", false, 720, cmdline::range(16, 65535));
+    cl.add("novsync", 'n', "disable vsync");
+    cl.parse_check(argc, argv);
+
+    uint32_t width = cl.get<uint32_t>("width");
+    uint32_t height = cl.get<uint32_t>("height");
+    bool vsync = !cl.exist("novsync");
+
+    // create context and engine
+    glengine::ContextGLFW context;
+    context.init({.window_width = width, .window_height = height, .vsync = vsync});
+    glengine::GLEngine eng;
+    eng.init(&context, {});
+    glengine::ResourceManager &rm = eng.resource_manager();
+
+    // small textures of different sizes, not all powers of two
+    const uint32_t count = cl.get<uint32_t>("count");
+    const uint32_t sizes[] = {32, 48, 64, 96, 128};
+    std::mt19937 rng(1234);
+    std::vector<Texture> textures;
+    for (uint32_t i = 0; i < count * count; i++) {
+        textures.push_back(create_texture(sizes[rng() % 5], sizes[rng() % 5], rng));
+    }
+
+    // the same box for all, with uvs repeating twice per face
+    glengine::MeshData box_md = glengine::create_box_data({0.8f, 0.8f, 0.8f});
+    for (auto &v : box_md.vertices) {
+        v.tex_coords = v.tex_coords * 2.0f;
+    }
+    glengine::Mesh *box_mesh = eng.create_mesh(box_md.vertices, box_md.indices);
+
+    // source keys of the images: 1 to N for the textures, then the atlas and the array
+    glengine::ImageParams params;
+    // an image per texture
+    std::vector<glengine::Material *> separate;
+    for (uint32_t i = 0; i < textures.size(); i++) {
+        auto *mtl = eng.create_material<glengine::MaterialDiffuseTextured>(SG_PRIMITIVETYPE_TRIANGLES,
+                                                                            SG_INDEXTYPE_UINT32);
+        mtl->tex_diffuse = rm.create_image(i + 1, params, textures[i].pixels.data(), int(textures[i].width),
+                                           int(textures[i].height), "texture");
+        separate.push_back(mtl);
+    }
+    // all the textures in an atlas
+    std::vector<glengine::AtlasImage> atlas_images;
+    for (const auto &tex : textures) {
+        atlas_images.push_back({tex.pixels.data(), tex.width, tex.height});
+    }
+    glengine::TextureAtlas atlas;
+    if (!glengine::build_texture_atlas(atlas_images, 8192, 4, atlas)) {
+        printf("unable to pack %zu textures in an atlas\n", textures.size());
+        return 1;
+    }
+    const sg_image atlas_image = rm.create_atlas(textures.size() + 1, params, atlas, "atlas");
+    std::vector<glengine::Material *> atlased;
+    for (uint32_t i = 0; i < textures.size(); i++) {
+        auto *mtl = eng.create_material<glengine::MaterialDiffuseTextured>(SG_PRIMITIVETYPE_TRIANGLES,
+                                                                            SG_INDEXTYPE_UINT32);
+        mtl->tex_diffuse = atlas_image;
+        mtl->uv_rect = atlas.uv_rects[i];
+        atlased.push_back(mtl);
+    }
+    // all the textures, resized to the same size, in the layers of a texture array
+    const uint32_t layer_size = 64;
+    std::vector<std::vector<uint8_t>> resized(textures.size());
+    std::vector<const uint8_t *> layers;
+    for (uint32_t i = 0; i < textures.size(); i++) {
+        resized[i].resize(layer_size * layer_size * 4);
+        stbir_resize_uint8(textures[i].pixels.data(), int(textures[i].width), int(textures[i].height), 0,
+                           resized[i].data(), layer_size, layer_size, 0, 4);
+        layers.push_back(resized[i].data());
+    }
+    const sg_image array_image = rm.create_texture_array(textures.size() + 2, params, layers.data(),
+                                                         uint32_t(layers.size()), layer_size, layer_size,
+                                                         "texture array");
+    std::vector<glengine::Material *> arrayed;
+    for (uint32_t i = 0; i < textures.size(); i++) {
+        auto *mtl = eng.create_material<glengine::MaterialDiffuseTextureArray>(SG_PRIMITIVETYPE_TRIANGLES,
+                                                                                SG_INDEXTYPE_UINT32);
+        mtl->tex_diffuse_array = array_image;
+        mtl->layer = i;
+        arrayed.push_back(mtl);
+    }
+    printf("%zu textures, atlas of %ux%u with %u mip levels, array of %zu layers\n", textures.size(), atlas.width,
+           atlas.height, atlas.max_levels, layers.size());
+
+    // a field of boxes for each way of binding the textures, one object per box
+    const char *modes[] = {"an image per texture", "atlas", "texture array"};
+    const std::vector<glengine::Material *> *materials[] = {&separate, &atlased, &arrayed};
+    glengine::Object *fields[3];
+    for (int mode = 0; mode < 3; mode++) {
+        fields[mode] = eng.create_object();
+        for (uint32_t i = 0; i < textures.size(); i++) {
+            glengine::Object *box = eng.create_object({box_mesh, (*materials[mode])[i]}, fields[mode]);
+            box->set_transform(math::create_translation<float>({float(i % count), float(i / count), 0.0f}));
+        }
+        fields[mode]->set_visible(mode == 0);
+    }
+    eng._camera_manipulator.set_center({count * 0.5f, count * 0.5f, 0.0f}).set_distance(count * 1.5f);
+    eng._camera_manipulator.set_azimuth(0.3f).set_elevation(0.9f);
+
+    int mode = 0;
+    eng.add_ui_function([&]() {
+        const glengine::RenderStats &stats = eng.render_stats();
+        ImGui::Begin("Texture batching");
+        for (int m = 0; m < 3; m++) {
+            if (ImGui::RadioButton(modes[m], mode == m)) {
+                mode = m;
+                for (int k = 0; k < 3; k++) {
+                    fields[k]->set_visible(k == mode);
+                }
+            }
+        }
+        ImGui::Text("draws: %u, pipeline and bindings applied: %u", stats.num_draws, stats.num_bindings);
+        ImGui::End();
+    });
+
+    // ///////// //
+    // main loop //
+    // ///////// //
+    while (eng.render()) {
+        eng._camera.set_perspective(0.1f, 1000.0f, math::utils::deg2rad(45.0f));
+    }
+
+    eng.terminate();
+    return 0;
+}
@@ -0,0 +1,117 @@
+#include "math/vmath.h"
+#include "math/math_utils.h"
+
+#include "gl_engine.h"
+#include "gl_context_glfw.h"
+#include "gl_thick_lines.h"
+#include "imgui/imgui.h"
+
+#include "cmdline.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+
+// random walks starting around the origin, colored from blue to red along the way
+void create_trajectories(uint32_t num_lines, uint32_t num_points, glengine::ThickLines &lines) {
+    std::mt19937 rng(3);
+    std::normal_distribution<float> step(0.0f, 0.3f);
+    std::uniform_real_distribution<float> start(-10.0f, 10.0f);
+    lines.polylines.resize(num_lines);
+    for (auto &line : lines.polylines) {
+        math::Vector3f p = {start(rng), start(rng), 0.0f};
+        math::Vector3f velocity = {0.0f, 0.0f, 0.0f};
+        line.points.clear();
+        line.colors.clear();
+        for (uint32_t i = 0; i < num_points; i++) {
+            const float t = float(i) / float(num_points - 1);
+            line.points.push_back(p);
+            line.colors.push_back({uint8_t(255 * t), 60, uint8_t(255 * (1.0f - t)), 255});
+            velocity = velocity * 0.9f + math::Vector3f{step(rng), step(rng), step(rng) * 0.2f};
+            p += velocity;
+        }
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+
+    cmdline::parser cl;
+    cl.add<uint32_t>("lines", 'l', "number of trajectories", false, 2000, cmdline::range(1, 1000000));
+    cl.add<uint32_t>("points", 'p', "points per trajectory", false, 200, cmdline::range(2, 100000));
+    cl.add<uint32_t>("width", 'w', "window width", false, 1280, cmdline::range(16, 65535));
+    cl.add<uint32_t>("height", 'h', "window height", false, 720, cmdline::range(16, 65535));
+    cl.add("novsync", 'n', "disable vsync");
+    cl.parse_check(argc, argv);
+
+    uint32_t width = cl.get<uint32_t>("width");
+    uint32_t height = cl.get<uint32_t>("height");
+    bool vsync = !cl.exist("novsync");
+
+    // create context and engine
+    glengine::ContextGLFW context;
+    context.init({.window_width = width, .window_height = height, .vsync = vsync});
+    glengine::GLEngine eng;
+    eng.init(&context, {});
+
+    glengine::ThickLines lines;
+    if (!lines.init(eng)) {
+        eng.terminate();
+        return 1;
+    }
+    create_trajectories(cl.get<uint32_t>("lines"), cl.get<uint32_t>("points"), lines);
+    // the first trajectory is highlighted on top of the others
+    glengine::LineStyle style;
+    glengine::LineStyle highlight = {.width = 6.0f, .cap = glengine::LineCap::Round};
+    bool on_top = true;
+    bool dirty = true;
+    // the offscreen pass has the size of the window
+    eng.add_draw_function(
+        [&]() { lines.draw(eng._camera, float(context.window_width()), float(context.window_height())); });
+
+    eng.grid().enabled = true;
+    eng.grid().step = 2.0f;
+    eng._camera_manipulator.set_azimuth(0.6f).set_elevation(0.6f).set_distance(60.0f);
+
+    eng.add_ui_function([&]() {
+        const glengine::ThickLineStats &stats = lines.stats();
+        const char *joins[] = {"miter", "bevel", "round"};
+        const char *caps[] = {"butt", "square", "round"};
+        int join = int(style.join), cap = int(style.cap);
+        ImGui::Begin("Thick Lines");
+        ImGui::Text("polylines: %u, segments: %u, draw calls: %u", stats.num_polylines, stats.num_segments,
+                    stats.num_draws);
+        dirty |= ImGui::SliderFloat("width (px)", &style.width, 1.0f, 32.0f);
+        dirty |= ImGui::Combo("join", &join, joins, 3);
+        dirty |= ImGui::Combo("cap", &cap, caps, 3);
+        dirty |= ImGui::SliderFloat("dash", &style.dash, 0.0f, 2.0f);
+        dirty |= ImGui::SliderFloat("gap", &style.gap, 0.0f, 2.0f);
+        dirty |= ImGui::Checkbox("first trajectory on top", &on_top);
+        ImGui::End();
+        style.join = glengine::LineJoin(join);
+        style.cap = glengine::LineCap(cap);
+    });
+
+    // ///////// //
+    // main loop //
+    // ///////// //
+    while (eng.render()) {
+        eng._camera.set_perspective(0.1f, 1000.0f, math::utils::deg2rad(45.0f));
+        if (dirty) {
+            for (auto &line : lines.polylines) {
+                line.style = style;
+            }
+            highlight.depth_test = !on_top;
+            lines.polylines[0].style = highlight;
+            lines.update();
+            dirty = false;
+        }
+    }
+
+    lines.terminate();
+    eng.terminate();
+    return 0;
+}
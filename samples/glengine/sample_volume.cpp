@@ -0,0 +1,194 @@
+#include "math/vmath.h"
+#include "math/math_utils.h"
+
+#include "gl_engine.h"
+#include "gl_context_glfw.h"
+#include "gl_material_diffuse.h"
+#include "gl_thread_pool.h"
+#include "gl_volume.h"
+#include "imgui/imgui.h"
+
+#include "cmdline.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace {
+
+// phantom of a head: a shell of bone around soft tissue, with a few vessels and some noise, in air
+void generate_phantom(uint32_t size, glengine::VolumeData &volume) {
+    volume.width = volume.height = volume.depth = size;
+    volume.voxels.resize(size_t(size) * size * size);
+    glengine::parallel_for(0, size, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t z = begin; z < end; z++) {
+            for (uint32_t y = 0; y < size; y++) {
+                for (uint32_t x = 0; x < size; x++) {
+                    const float px = 2.0f * x / size - 1.0f, py = 2.0f * y / size - 1.0f, pz = 2.0f * z / size - 1.0f;
+                    const float r = std::sqrt(px * px / 0.55f + py * py / 0.75f + pz * pz / 0.8f);
+                    const uint32_t hash = (x * 73856093u) ^ (y * 19349663u) ^ (z * 83492791u);
+                    float v = float(hash % 16);
+                    if (r < 0.9f) {
+                        v = 100.0f + 10.0f * std::sin(px * 40.0f) * std::sin(py * 37.0f) + float(hash % 12);
+                        // vessels, along z and bending
+                        for (int i = 0; i < 3; i++) {
+                            const float cx = -0.3f + 0.3f * i + 0.1f * std::sin(pz * 4.0f + i);
+                            const float cy = 0.1f * std::cos(pz * 3.0f + 2.0f * i);
+                            if ((px - cx) * (px - cx) + (py - cy) * (py - cy) < 0.003f) {
+                                v = 170.0f;
+                            }
+                        }
+                    } else if (r < 1.0f) {
+                        v = 230.0f + float(hash % 20);
+                    } else if (r < 1.05f) {
+                        v = 60.0f; // skin
+                    }
+                    volume.voxels[(size_t(z) * size + y) * size + x] = uint8_t(std::min(v, 255.0f));
+                }
+            }
+        }
+    });
+}
+
+// band of values with a tent of opacity
+struct Band {
+    bool enabled;
+    float center;
+    float width;
+    float color[4];
+};
+
+std::vector<glengine::Color> transfer_from_bands(const Band *bands, int num_bands) {
+    std::vector<glengine::Color> colors(256, glengine::Color{0, 0, 0, 0});
+    for (int b = 0; b < num_bands; b++) {
+        if (!bands[b].enabled) {
+            continue;
+        }
+        const glengine::Color c = {uint8_t(bands[b].color[0] * 255.0f), uint8_t(bands[b].color[1] * 255.0f),
+                                   uint8_t(bands[b].color[2] * 255.0f), uint8_t(bands[b].color[3] * 255.0f)};
+        const auto band = glengine::make_transfer_function({{bands[b].center - bands[b].width, {c.r, c.g, c.b, 0}},
+                                                            {bands[b].center, c},
+                                                            {bands[b].center + bands[b].width, {c.r, c.g, c.b, 0}}});
+        for (int i = 0; i < 256; i++) {
+            if (band[i].a > colors[i].a) {
+                colors[i] = band[i];
+            }
+        }
+    }
+    return colors;
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+
+    cmdline::parser cl;
+    cl.add<std::string>("raw", 'r', "raw voxels (needs raw_width, raw_height and raw_depth)", false, "");
+    cl.add<uint32_t>("raw_width", 0, "voxels per row of the raw volume", false, 0, cmdline::range(0, 4096));
+    cl.add<uint32_t>("raw_height", 0, "rows per slice of the raw volume", false, 0, cmdline::range(0, 4096));
+    cl.add<uint32_t>("raw_depth", 0, "slices of the raw volume", false, 0, cmdline::range(0, 4096));
+    cl.add<uint32_t>("raw_bits", 0, "bits per voxel of the raw volume, 8 or 16", false, 8, cmdline::oneof(8u, 16u));
+    cl.add<uint32_t>("size", 's', "voxels per side of the generated phantom (without raw)", false, 256,
+                     cmdline::range(16, 1024));
+    cl.add<uint32_t>("cell", 'c', "voxels per side of the macro cells", false, 8, cmdline::range(1, 64));
+    cl.add<uint32_t>("width", 'w', "window width", false, 1280, cmdline::range(16, 65535));
+    cl.add<uint32_t>("height", 'h', "window height", false, 720, cmdline::range(16, 65535));
+    cl.add("novsync", 'n', "disable vsync");
+    cl.parse_check(argc, argv);
+
+    uint32_t width = cl.get<uint32_t>("width");
+    uint32_t height = cl.get<uint32_t>("height");
+    bool vsync = !cl.exist("novsync");
+
+    glengine::VolumeData data;
+    const std::string raw = cl.get<std::string>("raw");
+    if (!raw.empty()) {
+        if (!glengine::load_volume_raw(raw.c_str(), cl.get<uint32_t>("raw_width"), cl.get<uint32_t>("raw_height"),
+                                       cl.get<uint32_t>("raw_depth"), cl.get<uint32_t>("raw_bits"), data)) {
+            return 1;
+        }
+    } else {
+        generate_phantom(cl.get<uint32_t>("size"), data);
+    }
+
+    // create context and engine, MRT gives the depth of the scene to the volume
+    glengine::ContextGLFW context;
+    context.init({.window_width = width, .window_height = height, .vsync = vsync});
+    glengine::GLEngine eng;
+    eng.init(&context, {.use_mrt = true});
+
+    glengine::Volume volume;
+    volume.params.cell_size = cl.get<uint32_t>("cell");
+    // 10 world units along the largest side, centered on the origin
+    const float scale = 10.0f / std::max({data.width, data.height, data.depth});
+    volume.params.size = {data.width * scale, data.height * scale, data.depth * scale};
+    volume.params.origin = volume.params.size * -0.5f;
+    if (!volume.init(eng, data)) {
+        eng.terminate();
+        return 1;
+    }
+    eng.add_post_draw_function([&]() { volume.draw(eng._camera); });
+
+    // opaque objects across the volume
+    auto *sphere_mtl =
+        eng.create_material<glengine::MaterialDiffuse>(SG_PRIMITIVETYPE_TRIANGLES, SG_INDEXTYPE_UINT32);
+    auto *sphere = eng.create_object({eng.create_sphere_mesh(1.0f, 24), sphere_mtl});
+    auto *box = eng.create_object({eng.create_box_mesh({0.5f, 0.5f, 12.0f}), sphere_mtl});
+    box->set_transform(math::create_translation<float>({3.0f, 0.0f, 0.0f}));
+
+    eng.grid().enabled = true;
+    eng._camera_manipulator.set_azimuth(0.6f).set_elevation(0.4f).set_distance(20.0f);
+
+    Band bands[3] = {{true, 60.0f, 10.0f, {0.9f, 0.6f, 0.5f, 0.02f}},
+                     {true, 170.0f, 12.0f, {0.9f, 0.1f, 0.1f, 0.6f}},
+                     {true, 240.0f, 15.0f, {1.0f, 1.0f, 0.9f, 0.3f}}};
+    const char *band_names[3] = {"skin", "vessels", "bone"};
+    volume.transfer_function = transfer_from_bands(bands, 3);
+    bool move_sphere = true;
+    float sphere_time = 0.0f;
+    eng.add_ui_function([&]() {
+        const glengine::VolumeStats &stats = volume.stats();
+        ImGui::Begin("Volume");
+        ImGui::Text("%ux%ux%u voxels, %.1f MB of textures", data.width, data.height, data.depth,
+                    stats.texture_bytes / 1e6);
+        ImGui::Text("macro cells: %u, occupied: %u (%.1f%%), classified in %.2f ms", stats.num_cells,
+                    stats.num_occupied, 100.0f * stats.num_occupied / std::max(stats.num_cells, 1u),
+                    stats.classify_ms);
+        ImGui::Checkbox("empty space skipping", &volume.params.skipping);
+        ImGui::Checkbox("heatmap of the iterations", &volume.params.heatmap);
+        ImGui::Checkbox("jitter", &volume.params.jitter);
+        ImGui::SliderFloat("step (voxels)", &volume.params.step, 0.1f, 2.0f);
+        ImGui::SliderFloat("density", &volume.params.density, 0.1f, 10.0f);
+        bool changed = false;
+        for (int i = 0; i < 3; i++) {
+            ImGui::PushID(i);
+            changed |= ImGui::Checkbox(band_names[i], &bands[i].enabled);
+            changed |= ImGui::SliderFloat("center", &bands[i].center, 0.0f, 255.0f);
+            changed |= ImGui::SliderFloat("width", &bands[i].width, 1.0f, 64.0f);
+            changed |= ImGui::ColorEdit4("color", bands[i].color);
+            ImGui::PopID();
+        }
+        if (changed) {
+            volume.transfer_function = transfer_from_bands(bands, 3);
+        }
+        ImGui::Checkbox("moving sphere", &move_sphere);
+        ImGui::End();
+    });
+
+    // ///////// //
+    // main loop //
+    // ///////// //
+    while (eng.render()) {
+        eng._camera.set_perspective(0.1f, 1000.0f, math::utils::deg2rad(45.0f));
+        if (move_sphere) {
+            sphere_time += 1.0f / 60.0f;
+        }
+        sphere->set_transform(math::create_translation<float>({4.0f * std::cos(sphere_time), 0.0f, 0.0f}));
+        volume.update();
+    }
+
+    volume.terminate();
+    eng.terminate();
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include "gl_package.h"
+#include "gl_point_cloud.h"
+#include "test_utils.h"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace {
+
+// the index of a point is in its color, so that every point can be found back
+glengine::Color index_color(uint32_t i) {
+    return {uint8_t(i & 0xff), uint8_t((i >> 8) & 0xff), uint8_t((i >> 16) & 0xff), 255};
+}
+
+uint32_t color_index(const glengine::Color &c) {
+    return uint32_t(c.r) | uint32_t(c.g) << 8 | uint32_t(c.b) << 16;
+}
+
+// a noisy surface, and a few points far from it so that some nodes above the chunks are sparse
+std::vector<math::Vector3f> create_points(uint32_t count) {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> coord(0.0f, 100.0f);
+    std::normal_distribution<float> noise(0.0f, 0.2f);
+    std::vector<math::Vector3f> points;
+    for (uint32_t i = 0; i < count; i++) {
+        const float x = coord(rng), y = coord(rng);
+        points.push_back({x, y, 20.0f + 5.0f * std::sin(x * 0.1f) * std::cos(y * 0.1f) + noise(rng)});
+    }
+    for (uint32_t i = 0; i < 10; i++) {
+        points.push_back({coord(rng), coord(rng), 90.0f + i});
+    }
+    return points;
+}
+
+void test_chunked(const std::vector<math::Vector3f> &points, uint32_t chunk_level, const std::string &filename) {
+    glengine::PointCloudBuildParams params;
+    params.grid_resolution = 16;
+    params.max_leaf_points = 500;
+    glengine::PointCloudChunkedBuilder builder;
+    CHECK(builder.init({0.0f, 0.0f, 0.0f}, {100.0f, 100.0f, 100.0f}, filename, params, chunk_level), "init");
+    for (uint32_t i = 0; i < points.size(); i++) {
+        builder.add(points[i], index_color(i));
+    }
+    const bool built = builder.build(filename.c_str(), "cloud");
+    CHECK(built, "chunk level %u", chunk_level);
+    if (!built) {
+        return;
+    }
+    for (uint32_t c = 0; c < 4096; c++) {
+        FILE *f = fopen((filename + ".chunk" + std::to_string(c)).c_str(), "rb");
+        CHECK(!f, "chunk file %u left", c);
+        if (f) {
+            fclose(f);
+        }
+    }
+
+    glengine::Package package;
+    std::vector<uint8_t> data;
+    glengine::PackagePointCloud cloud;
+    const glengine::PackageEntry *entry = nullptr;
+    const bool opened = package.open(filename.c_str()) && (entry = package.find("cloud")) &&
+                        package.read(*entry, data) && glengine::decode_point_cloud(data.data(), data.size(), cloud);
+    CHECK(opened, "chunk level %u: invalid package", chunk_level);
+    const glengine::PackageEntry *points_entry = opened ? package.find(cloud.points) : nullptr;
+    CHECK(points_entry && package.read(*points_entry, data), "points entry '%s'", cloud.points.c_str());
+    if (!points_entry) {
+        return;
+    }
+    CHECK(cloud.num_points == points.size(), "%llu points", (unsigned long long)cloud.num_points);
+    CHECK(builder.num_nodes() == cloud.nodes.size(), "%u nodes", builder.num_nodes());
+
+    // bounds of the nodes from their parents, then every point found back once, close to where it was added, and
+    // at most one point per cell in the inner nodes
+    std::vector<math::Vector3f> mins(cloud.nodes.size());
+    std::vector<float> sizes(cloud.nodes.size());
+    mins[0] = cloud.bbox_min;
+    sizes[0] = cloud.size;
+    std::vector<uint32_t> found(points.size(), 0);
+    const uint32_t res = cloud.grid_resolution;
+    for (size_t i = 0; i < cloud.nodes.size(); i++) {
+        const glengine::PackagePointNode &node = cloud.nodes[i];
+        for (uint32_t octant = 0, child = node.first_child; octant < 8; octant++) {
+            if (node.child_mask & (1 << octant)) {
+                const float half = sizes[i] * 0.5f;
+                mins[child] = mins[i] + math::Vector3f{octant & 1 ? half : 0.0f, octant & 2 ? half : 0.0f,
+                                                       octant & 4 ? half : 0.0f};
+                sizes[child] = half;
+                child++;
+            }
+        }
+        CHECK(node.offset + node.num_points * sizeof(glengine::PointCloudPoint) <= data.size(), "node %zu", i);
+        const auto *pts = reinterpret_cast<const glengine::PointCloudPoint *>(data.data() + node.offset);
+        std::set<uint32_t> cells;
+        for (uint32_t k = 0; k < node.num_points; k++) {
+            const uint32_t index = color_index(pts[k].color);
+            CHECK(index < points.size(), "node %zu, point %u", i, index);
+            if (index >= points.size()) {
+                continue;
+            }
+            found[index]++;
+            const math::Vector3f p = mins[i] + math::Vector3f{float(pts[k].pos[0]), float(pts[k].pos[1]),
+                                                              float(pts[k].pos[2])} *
+                                                   (sizes[i] / 65535.0f);
+            const math::Vector3f d = p - points[index];
+            const float tolerance = sizes[i] / 32768.0f;
+            CHECK(std::fabs(d.x) <= tolerance && std::fabs(d.y) <= tolerance && std::fabs(d.z) <= tolerance,
+                  "node %zu, point %u moved by %g %g %g", i, index, d.x, d.y, d.z);
+            const math::Vector3f local = (points[index] - mins[i]) * (float(res) / sizes[i]);
+            const uint32_t cx = std::min(uint32_t(std::max(local.x, 0.0f)), res - 1);
+            const uint32_t cy = std::min(uint32_t(std::max(local.y, 0.0f)), res - 1);
+            const uint32_t cz = std::min(uint32_t(std::max(local.z, 0.0f)), res - 1);
+            CHECK(!node.child_mask || cells.insert((cz * res + cy) * res + cx).second,
+                  "node %zu has two points in a cell", i);
+        }
+    }
+    uint32_t missing = 0, repeated = 0;
+    for (uint32_t n : found) {
+        missing += n == 0 ? 1 : 0;
+        repeated += n > 1 ? 1 : 0;
+    }
+    CHECK(missing == 0 && repeated == 0, "chunk level %u: %u points missing, %u repeated", chunk_level, missing,
+          repeated);
+    package.close();
+    remove(filename.c_str());
+}
+
+} // namespace
+
+int main() {
+    const std::vector<math::Vector3f> points = create_points(200000);
+    for (uint32_t chunk_level : {0u, 1u, 2u, 3u}) {
+        test_chunked(points, chunk_level, "test_point_cloud_chunked.gpkg");
+    }
+    return test::test_result();
+}
@@ -0,0 +1,157 @@
+#include "gl_mipmap.h"
+#include "gl_texture_atlas.h"
+#include "test_utils.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+namespace {
+
+struct Image {
+    uint32_t width;
+    uint32_t height;
+    uint8_t color[4];
+    bool marked;
+    std::vector<uint8_t> pixels;
+};
+
+// solid color image, marked or not with a different texel at the origin to tell whether a copy is flipped or offset
+Image create_image(uint32_t width, uint32_t height, uint32_t index, bool marked) {
+    Image img{width, height, {uint8_t(20 + index * 7), uint8_t(200 - index * 5), uint8_t(index * 13), 255}, marked, {}};
+    img.pixels.resize(size_t(width) * height * 4);
+    for (size_t i = 0; i < img.pixels.size(); i += 4) {
+        std::copy(img.color, img.color + 4, img.pixels.begin() + i);
+    }
+    if (marked) {
+        img.pixels[0] = 255;
+    }
+    return img;
+}
+
+const uint8_t *texel(const uint8_t *pixels, uint32_t width, uint32_t x, uint32_t y) {
+    return pixels + (size_t(y) * width + x) * 4;
+}
+
+bool close_to(const uint8_t *a, const uint8_t *b) {
+    for (int c = 0; c < 4; c++) {
+        if (std::abs(int(a[c]) - int(b[c])) > 1) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_atlas(const std::vector<Image> &images, uint32_t padding) {
+    std::vector<glengine::AtlasImage> atlas_images;
+    for (const auto &img : images) {
+        atlas_images.push_back({img.pixels.data(), img.width, img.height});
+    }
+    glengine::TextureAtlas atlas;
+    const bool built = glengine::build_texture_atlas(atlas_images, 4096, padding, atlas);
+    CHECK(built, "padding %u", padding);
+    if (!built) {
+        return;
+    }
+    CHECK(atlas.width == atlas.height && (atlas.width & (atlas.width - 1)) == 0, "%ux%u", atlas.width, atlas.height);
+    CHECK(atlas.pixels.size() == size_t(atlas.width) * atlas.height * 4, "%zu bytes", atlas.pixels.size());
+    CHECK(atlas.uv_rects.size() == images.size(), "%zu rects", atlas.uv_rects.size());
+    uint32_t cell = 1;
+    while (cell < padding) {
+        cell *= 2;
+    }
+    const uint32_t border = padding > 0 ? cell : 0;
+    CHECK(padding == 0 || atlas.max_levels > 1, "padding %u, %u levels", padding, atlas.max_levels);
+
+    // placement: inside the atlas, aligned, the padded rects don't overlap
+    const uint32_t size = atlas.width;
+    std::vector<uint32_t> xs(images.size()), ys(images.size());
+    for (size_t i = 0; i < images.size(); i++) {
+        const math::Vector4f &r = atlas.uv_rects[i];
+        xs[i] = uint32_t(r.x * size + 0.5f);
+        ys[i] = uint32_t(r.y * size + 0.5f);
+        CHECK(uint32_t(r.z * size + 0.5f) == images[i].width && uint32_t(r.w * size + 0.5f) == images[i].height,
+              "image %zu scale", i);
+        CHECK(xs[i] % cell == 0 && ys[i] % cell == 0, "image %zu at %u,%u, cell %u", i, xs[i], ys[i], cell);
+        CHECK(xs[i] >= border && ys[i] >= border && xs[i] + images[i].width + border <= size &&
+                  ys[i] + images[i].height + border <= size,
+              "image %zu at %u,%u out of the atlas", i, xs[i], ys[i]);
+        for (size_t j = 0; j < i; j++) {
+            const bool apart = xs[i] + images[i].width + 2 * border <= xs[j] ||
+                               xs[j] + images[j].width + 2 * border <= xs[i] ||
+                               ys[i] + images[i].height + 2 * border <= ys[j] ||
+                               ys[j] + images[j].height + 2 * border <= ys[i];
+            CHECK(apart, "images %zu and %zu overlap", j, i);
+        }
+    }
+    if (test::failures > 0) {
+        return;
+    }
+
+    // pixels: copied, and the edge texels replicated in the padding
+    for (size_t i = 0; i < images.size(); i++) {
+        const Image &img = images[i];
+        for (uint32_t y = ys[i] - border; y < ys[i] + img.height + border; y++) {
+            for (uint32_t x = xs[i] - border; x < xs[i] + img.width + border; x++) {
+                const uint32_t sx = std::min(std::max(x, xs[i]) - xs[i], img.width - 1);
+                const uint32_t sy = std::min(std::max(y, ys[i]) - ys[i], img.height - 1);
+                const uint8_t *a = texel(atlas.pixels.data(), size, x, y);
+                const uint8_t *b = texel(img.pixels.data(), img.width, sx, sy);
+                CHECK(std::equal(a, a + 4, b), "image %zu, texel %u,%u", i, x, y);
+            }
+        }
+    }
+
+    // no bleeding up to max_levels: the texels of every level covering an image, and their neighbours read by
+    // bilinear filtering, hold the color of that image only
+    if (images[0].marked) {
+        return;
+    }
+    glengine::MipChain chain;
+    glengine::MipChainOptions options;
+    options.max_levels = atlas.max_levels;
+    options.parallel = false;
+    CHECK(glengine::build_mip_chain(atlas.pixels.data(), size, size, chain, options), "mip chain");
+    for (uint32_t level = 1; level < chain.num_levels; level++) {
+        const uint32_t block = 1u << level;
+        const uint32_t level_size = chain.levels[level].width;
+        for (size_t i = 0; i < images.size(); i++) {
+            const uint32_t x0 = xs[i] / block, y0 = ys[i] / block;
+            const uint32_t x1 = (xs[i] + images[i].width + block - 1) / block;
+            const uint32_t y1 = (ys[i] + images[i].height + block - 1) / block;
+            for (uint32_t y = y0 - 1; y <= y1; y++) {
+                for (uint32_t x = x0 - 1; x <= x1; x++) {
+                    const uint8_t *a = texel(chain.level_data(level), level_size, x, y);
+                    CHECK(close_to(a, images[i].color), "level %u, image %zu, texel %u,%u: %u %u %u %u", level, i,
+                          x, y, a[0], a[1], a[2], a[3]);
+                }
+            }
+        }
+    }
+}
+
+} // namespace
+
+int main() {
+    // sizes that are not multiples of the padding nor powers of two
+    const uint32_t sizes[][2] = {{32, 32}, {17, 45}, {64, 13}, {9, 9}, {100, 31}, {1, 1}, {48, 48}, {3, 70}};
+    for (bool marked : {true, false}) {
+        std::vector<Image> images;
+        for (uint32_t i = 0; i < 8; i++) {
+            images.push_back(create_image(sizes[i][0], sizes[i][1], i, marked));
+        }
+        for (uint32_t padding : {0u, 2u, 3u, 4u, 8u}) {
+            test_atlas(images, padding);
+        }
+    }
+
+    // too small
+    const Image large = create_image(100, 31, 0, false);
+    glengine::TextureAtlas atlas;
+    CHECK(!glengine::build_texture_atlas({{large.pixels.data(), large.width, large.height}}, 64, 4, atlas),
+          "100x31 image in a 64x64 atlas");
+
+    return test::test_result();
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdio>
+
+/// checks shared by the tests: a failed CHECK prints its location, the condition and the printf-style message, and is
+/// counted. main returns test_result(), which prints the outcome
+namespace test {
+
+inline int failures = 0;
+
+inline int test_result() {
+    printf("%s\n", failures == 0 ? "ok" : "failed");
+    return failures == 0 ? 0 : 1;
+}
+
+} // namespace test
+
+#define CHECK(cond, ...)                                                                                               \
+    do {                                                                                                               \
+        if (!(cond)) {                                                                                                 \
+            printf("%s:%d: check failed: %s: ", __FILE__, __LINE__, #cond);                                            \
+            printf(__VA_ARGS__);                                                                                       \
+            printf("\n");                                                                                              \
+            test::failures++;                                                                                          \
+        }                                                                                                              \
+    } while (0)